@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "module_thread.h"
+
+/*pthread names are limited to 16 bytes with the terminator*/
+#define THREAD_NAME_SIZE 16
+
+#ifdef __linux__
+/*nice values; raising above normal needs CAP_SYS_NICE or a suitable RLIMIT_NICE*/
+static int nice_of(MODULE_THREAD_PRIORITY priority)
+{
+    int result;
+    switch (priority)
+    {
+    case MODULE_THREAD_PRIORITY_LOWEST: result = 19; break;
+    case MODULE_THREAD_PRIORITY_BELOW_NORMAL: result = 10; break;
+    case MODULE_THREAD_PRIORITY_ABOVE_NORMAL: result = -10; break;
+    case MODULE_THREAD_PRIORITY_HIGHEST: result = -20; break;
+    default: result = 0; break;
+    }
+    return result;
+}
+
+static int apply_affinity(const MODULE_THREAD_CONFIG* config)
+{
+    int result;
+    int max_cpu = 0;
+    size_t i;
+    cpu_set_t* cpus;
+    for (i = 0; i < config->cpu_count; i++)
+    {
+        if (config->cpus[i] > max_cpu)
+        {
+            max_cpu = config->cpus[i];
+        }
+    }
+
+    /*dynamically sized, so that machines with more than CPU_SETSIZE CPUs work*/
+    cpus = CPU_ALLOC(max_cpu + 1);
+    if (cpus == NULL)
+    {
+        LogError("unable to allocate a CPU set");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t size = CPU_ALLOC_SIZE(max_cpu + 1);
+        int error;
+        CPU_ZERO_S(size, cpus);
+        for (i = 0; i < config->cpu_count; i++)
+        {
+            CPU_SET_S(config->cpus[i], size, cpus);
+        }
+
+        error = pthread_setaffinity_np(pthread_self(), size, cpus);
+        if (error != 0)
+        {
+            LogError("unable to set the CPU affinity of thread \"%s\", error %d", config->thread_name == NULL ? "" : config->thread_name, error);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        CPU_FREE(cpus);
+    }
+    return result;
+}
+
+static int apply_priority(const MODULE_THREAD_CONFIG* config)
+{
+    int result;
+    /*on Linux the nice value of a thread id only affects that thread*/
+    if (setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice_of(config->priority)) != 0)
+    {
+        LogError("unable to set the priority of thread \"%s\", errno %d", config->thread_name == NULL ? "" : config->thread_name, errno);
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+#endif
+
+static int apply_name(const char* thread_name)
+{
+    int result;
+    char name[THREAD_NAME_SIZE];
+    (void)strncpy(name, thread_name, THREAD_NAME_SIZE - 1);
+    name[THREAD_NAME_SIZE - 1] = '\0';
+#ifdef __APPLE__
+    result = pthread_setname_np(name);
+#else
+    result = pthread_setname_np(pthread_self(), name);
+#endif
+    if (result != 0)
+    {
+        LogError("unable to name thread \"%s\", error %d", thread_name, result);
+        result = __LINE__;
+    }
+    return result;
+}
+
+int ModuleThread_Apply(const MODULE_THREAD_CONFIG* config)
+{
+    int result = 0;
+    if (config == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_021: [ If config is NULL, ModuleThread_Apply shall do nothing and return 0. ]*/
+    }
+    else
+    {
+        /*Codes_SRS_MODULE_THREAD_29_022: [ ModuleThread_Apply shall restrict the calling thread to the CPUs of config if it has any. ]*/
+        if (config->cpu_count > 0)
+        {
+#ifdef __linux__
+            if (apply_affinity(config) != 0)
+            {
+                result = __LINE__;
+            }
+#else
+            /*Codes_SRS_MODULE_THREAD_29_025: [ If a setting cannot be applied, ModuleThread_Apply shall log an error, apply the remaining settings and return a non-zero value. ]*/
+            LogError("CPU affinity is not supported on this platform");
+            result = __LINE__;
+#endif
+        }
+
+        /*Codes_SRS_MODULE_THREAD_29_023: [ ModuleThread_Apply shall set the priority of the calling thread if the priority of config is not MODULE_THREAD_PRIORITY_DEFAULT. ]*/
+        if (config->priority != MODULE_THREAD_PRIORITY_DEFAULT)
+        {
+#ifdef __linux__
+            if (apply_priority(config) != 0)
+            {
+                result = __LINE__;
+            }
+#else
+            LogError("thread priorities are not supported on this platform");
+            result = __LINE__;
+#endif
+        }
+
+        /*Codes_SRS_MODULE_THREAD_29_024: [ ModuleThread_Apply shall name the calling thread if config has a thread_name. ]*/
+        if (config->thread_name != NULL && apply_name(config->thread_name) != 0)
+        {
+            result = __LINE__;
+        }
+    }
+    return result;
+}
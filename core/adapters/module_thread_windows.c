@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <windows.h>
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "module_thread.h"
+
+/*SetThreadDescription only exists on Windows 10 1607 and later, so it is looked up at run time*/
+typedef HRESULT (WINAPI *PF_SET_THREAD_DESCRIPTION)(HANDLE hThread, PCWSTR lpThreadDescription);
+
+static int priority_of(MODULE_THREAD_PRIORITY priority)
+{
+    int result;
+    switch (priority)
+    {
+    case MODULE_THREAD_PRIORITY_LOWEST: result = THREAD_PRIORITY_LOWEST; break;
+    case MODULE_THREAD_PRIORITY_BELOW_NORMAL: result = THREAD_PRIORITY_BELOW_NORMAL; break;
+    case MODULE_THREAD_PRIORITY_ABOVE_NORMAL: result = THREAD_PRIORITY_ABOVE_NORMAL; break;
+    case MODULE_THREAD_PRIORITY_HIGHEST: result = THREAD_PRIORITY_HIGHEST; break;
+    default: result = THREAD_PRIORITY_NORMAL; break;
+    }
+    return result;
+}
+
+static int apply_affinity(const MODULE_THREAD_CONFIG* config)
+{
+    int result = 0;
+    DWORD_PTR mask = 0;
+    size_t i;
+    for (i = 0; i < config->cpu_count; i++)
+    {
+        if (config->cpus[i] >= (int)(sizeof(DWORD_PTR) * 8))
+        {
+            /*processor groups are not supported, only the first 64 (32 on x86) CPUs can be used*/
+            LogError("CPU %d is outside of the processor group of the thread", config->cpus[i]);
+            result = __LINE__;
+        }
+        else
+        {
+            mask |= ((DWORD_PTR)1) << config->cpus[i];
+        }
+    }
+
+    if (mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) == 0)
+    {
+        LogError("unable to set the CPU affinity of the thread, error %lu", GetLastError());
+        result = __LINE__;
+    }
+    return result;
+}
+
+static int apply_name(const char* thread_name)
+{
+    int result;
+    PF_SET_THREAD_DESCRIPTION set_thread_description = (PF_SET_THREAD_DESCRIPTION)GetProcAddress(GetModuleHandleA("kernel32.dll"), "SetThreadDescription");
+    if (set_thread_description == NULL)
+    {
+        LogInfo("thread names are not supported on this version of Windows");
+        result = __LINE__;
+    }
+    else
+    {
+        WCHAR name[64];
+        if (MultiByteToWideChar(CP_UTF8, 0, thread_name, -1, name, sizeof(name) / sizeof(name[0])) == 0)
+        {
+            LogError("unable to convert thread name \"%s\"", thread_name);
+            result = __LINE__;
+        }
+        else if (FAILED(set_thread_description(GetCurrentThread(), name)))
+        {
+            LogError("unable to name thread \"%s\"", thread_name);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+int ModuleThread_Apply(const MODULE_THREAD_CONFIG* config)
+{
+    int result = 0;
+    if (config == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_021: [ If config is NULL, ModuleThread_Apply shall do nothing and return 0. ]*/
+    }
+    else
+    {
+        /*Codes_SRS_MODULE_THREAD_29_022: [ ModuleThread_Apply shall restrict the calling thread to the CPUs of config if it has any. ]*/
+        /*Codes_SRS_MODULE_THREAD_29_025: [ If a setting cannot be applied, ModuleThread_Apply shall log an error, apply the remaining settings and return a non-zero value. ]*/
+        if (config->cpu_count > 0 && apply_affinity(config) != 0)
+        {
+            result = __LINE__;
+        }
+
+        /*Codes_SRS_MODULE_THREAD_29_023: [ ModuleThread_Apply shall set the priority of the calling thread if the priority of config is not MODULE_THREAD_PRIORITY_DEFAULT. ]*/
+        if (config->priority != MODULE_THREAD_PRIORITY_DEFAULT &&
+            !SetThreadPriority(GetCurrentThread(), priority_of(config->priority)))
+        {
+            LogError("unable to set the priority of the thread, error %lu", GetLastError());
+            result = __LINE__;
+        }
+
+        /*Codes_SRS_MODULE_THREAD_29_024: [ ModuleThread_Apply shall name the calling thread if config has a thread_name. ]*/
+        if (config->thread_name != NULL && apply_name(config->thread_name) != 0)
+        {
+            result = __LINE__;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,144 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file       alloc_profile.h
+*   @brief      Attributes heap allocations to gateway modules and subsystems.
+*
+*   @details    The allocation profiler keeps a fixed table of scopes (one per
+*               module, plus one for everything that cannot be attributed).
+*               Each thread has a current scope and a current subsystem; the
+*               broker and the gateway switch them as a message travels from
+*               one module to the next. An allocator shim calls
+*               ::AllocProfile_OnAllocate and ::AllocProfile_OnFree, which
+*               never allocate themselves, so the shim can sit beneath
+*               gballoc or replace the C runtime allocator.
+*
+*               Profiling is off until ::AllocProfile_Enable is called. The
+*               broker and gateway hooks are only compiled in when the gateway
+*               is built with the enable_alloc_profiling CMake option.
+*/
+
+#ifndef ALLOC_PROFILE_H
+#define ALLOC_PROFILE_H
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "gateway_export.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+/** @brief Maximum number of scopes, including the unattributed scope. */
+#define ALLOC_PROFILE_MAX_SCOPES 64
+
+/** @brief Maximum length of a scope name, including the null terminator. */
+#define ALLOC_PROFILE_MAX_NAME_LENGTH 64
+
+/** @brief Name of the scope that collects allocations made outside of any module. */
+#define ALLOC_PROFILE_UNATTRIBUTED "(unattributed)"
+
+#define ALLOC_PROFILE_SUBSYSTEM_VALUES \
+    ALLOC_PROFILE_SUBSYSTEM_MODULE, \
+    ALLOC_PROFILE_SUBSYSTEM_MESSAGE, \
+    ALLOC_PROFILE_SUBSYSTEM_BROKER
+
+/** @brief Part of the gateway an allocation is charged to, within a scope. */
+DEFINE_ENUM(ALLOC_PROFILE_SUBSYSTEM, ALLOC_PROFILE_SUBSYSTEM_VALUES);
+
+/** @brief Number of values in #ALLOC_PROFILE_SUBSYSTEM. */
+#define ALLOC_PROFILE_SUBSYSTEM_COUNT 3
+
+/** @brief Handle to a profiling scope. */
+typedef struct ALLOC_PROFILE_SCOPE_TAG* ALLOC_PROFILE_SCOPE_HANDLE;
+
+/** @brief Snapshot of the counters of one scope. */
+typedef struct ALLOC_PROFILE_REPORT_ENTRY_TAG
+{
+    /** @brief Name of the scope, usually the module name. */
+    char name[ALLOC_PROFILE_MAX_NAME_LENGTH];
+    /** @brief Number of allocations, per subsystem. */
+    uint64_t allocations[ALLOC_PROFILE_SUBSYSTEM_COUNT];
+    /** @brief Number of bytes allocated, per subsystem. */
+    uint64_t bytes[ALLOC_PROFILE_SUBSYSTEM_COUNT];
+    /** @brief Number of frees. */
+    uint64_t frees;
+    /** @brief Number of messages delivered to the module. */
+    uint64_t hops;
+} ALLOC_PROFILE_REPORT_ENTRY;
+
+/** @brief  Starts counting allocations. */
+GATEWAY_EXPORT void AllocProfile_Enable(void);
+
+/** @brief  Stops counting allocations. Counters are kept. */
+GATEWAY_EXPORT void AllocProfile_Disable(void);
+
+/** @brief  Returns true when allocations are being counted. */
+GATEWAY_EXPORT bool AllocProfile_IsEnabled(void);
+
+/** @brief  Sets every counter of every scope back to zero. */
+GATEWAY_EXPORT void AllocProfile_Reset(void);
+
+/** @brief      Returns the scope named @c name, creating it if needed.
+*
+*   @return     The scope, or @c NULL if @c name is @c NULL or the scope table
+*               is full.
+*/
+GATEWAY_EXPORT ALLOC_PROFILE_SCOPE_HANDLE AllocProfile_GetScope(const char* name);
+
+/** @brief      Associates @c owner (usually a #MODULE_HANDLE) with @c scope
+*               so that ::AllocProfile_FindScope can find it. Passing a @c NULL
+*               scope removes any association with @c owner.
+*/
+GATEWAY_EXPORT void AllocProfile_BindScope(ALLOC_PROFILE_SCOPE_HANDLE scope, const void* owner);
+
+/** @brief      Returns the scope associated with @c owner, or @c NULL. */
+GATEWAY_EXPORT ALLOC_PROFILE_SCOPE_HANDLE AllocProfile_FindScope(const void* owner);
+
+/** @brief      Makes @c scope the current scope of the calling thread. A
+*               @c NULL scope charges the unattributed scope.
+*
+*   @return     The previous scope of the calling thread.
+*/
+GATEWAY_EXPORT ALLOC_PROFILE_SCOPE_HANDLE AllocProfile_SetThreadScope(ALLOC_PROFILE_SCOPE_HANDLE scope);
+
+/** @brief      Makes @c subsystem the current subsystem of the calling thread.
+*
+*   @return     The previous subsystem of the calling thread.
+*/
+GATEWAY_EXPORT ALLOC_PROFILE_SUBSYSTEM AllocProfile_SetThreadSubsystem(ALLOC_PROFILE_SUBSYSTEM subsystem);
+
+/** @brief      Counts one message delivered to the module of @c scope. */
+GATEWAY_EXPORT void AllocProfile_RecordHop(ALLOC_PROFILE_SCOPE_HANDLE scope);
+
+/** @brief      Called by the allocator shim for every successful allocation. */
+GATEWAY_EXPORT void AllocProfile_OnAllocate(size_t size);
+
+/** @brief      Called by the allocator shim for every free of a non-NULL pointer. */
+GATEWAY_EXPORT void AllocProfile_OnFree(void);
+
+/** @brief      Copies the counters of up to @c capacity scopes into @c entries.
+*
+*   @return     The number of scopes, which may be larger than @c capacity.
+*/
+GATEWAY_EXPORT size_t AllocProfile_GetReport(ALLOC_PROFILE_REPORT_ENTRY* entries, size_t capacity);
+
+#ifdef GATEWAY_ALLOC_PROFILING
+#define ALLOC_PROFILE_ENTER_SUBSYSTEM(subsystem) ALLOC_PROFILE_SUBSYSTEM alloc_profile_previous_subsystem = AllocProfile_SetThreadSubsystem(subsystem)
+#define ALLOC_PROFILE_LEAVE_SUBSYSTEM() (void)AllocProfile_SetThreadSubsystem(alloc_profile_previous_subsystem)
+#else
+#define ALLOC_PROFILE_ENTER_SUBSYSTEM(subsystem)
+#define ALLOC_PROFILE_LEAVE_SUBSYSTEM()
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*ALLOC_PROFILE_H*/
@@ -59,6 +59,26 @@ DEFINE_ENUM(BROKER_RESULT, BROKER_RESULT_VALUES);
 */
 GATEWAY_EXPORT BROKER_HANDLE Broker_Create(void);
 
+/** @brief        Creates a new message broker that delivers messages on a
+*                 shared pool of threads.
+*
+*    @details    Modules attached to this broker share @c worker_count
+*                threads instead of getting one each. A module's messages
+*                are still passed to its Module_Receive one at a time and in
+*                order, but a Module_Receive that blocks holds a thread the
+*                other modules need. Modules whose current
+*                #MODULE_THREAD_CONFIG has @c dedicated_thread set when they
+*                are added get a thread of their own, as with
+*                ::Broker_Create. The CPU affinity, priority and name of the
+*                other modules do not apply to the pool's threads.
+*
+*    @param      worker_count    Number of threads of the pool, 0 to create
+*                                the broker as ::Broker_Create does.
+*
+*    @return        A valid #BROKER_HANDLE upon success, or @c NULL upon failure.
+*/
+GATEWAY_EXPORT BROKER_HANDLE Broker_CreateWithWorkerPool(size_t worker_count);
+
 /** @brief        Increments the reference count of a message broker.
 *
 *    @details    This function will simply increment the internal reference
@@ -18,6 +18,7 @@
 
 #include "module.h"
 #include "module_loader.h"
+#include "module_thread.h"
 #include "gateway_export.h"
 
 #ifdef __cplusplus
@@ -97,6 +98,9 @@ typedef struct GATEWAY_MODULES_ENTRY_TAG
 
     /** @brief  The user-defined configuration object for the module */
     const void* module_configuration;
+
+    /** @brief  The (possibly @c NULL) placement of the module's threads */
+    const MODULE_THREAD_CONFIG* module_thread_config;
 } GATEWAY_MODULES_ENTRY;
 
 /** @brief      Struct representing the properties that should be used when
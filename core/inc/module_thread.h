@@ -0,0 +1,146 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file       module_thread.h
+*   @brief      Places module threads on CPUs, sets their priority and names
+*               them.
+*
+*   @details    A module entry in the gateway JSON may have "cpu_affinity",
+*               "priority", "thread_name" and "dedicated_thread" next to its
+*               "args". Each thread
+*               has a current #MODULE_THREAD_CONFIG. The gateway makes the
+*               module's settings current on its own thread while it creates,
+*               attaches and starts the module. ::ModuleThread_Create applies
+*               the current settings of the calling thread to the thread it
+*               creates and makes them current there too. The broker creates
+*               each module's worker thread with ::ModuleThread_Create, so
+*               modules that do the same get their own settings on their
+*               threads whether they create them in Module_Create,
+*               Module_Start or Module_Receive.
+*/
+
+#ifndef MODULE_THREAD_H
+#define MODULE_THREAD_H
+
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "parson.h"
+#include "gateway_export.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdbool>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+#define MODULE_THREAD_PRIORITY_VALUES \
+    MODULE_THREAD_PRIORITY_DEFAULT, \
+    MODULE_THREAD_PRIORITY_LOWEST, \
+    MODULE_THREAD_PRIORITY_BELOW_NORMAL, \
+    MODULE_THREAD_PRIORITY_NORMAL, \
+    MODULE_THREAD_PRIORITY_ABOVE_NORMAL, \
+    MODULE_THREAD_PRIORITY_HIGHEST
+
+/** @brief  Scheduling priority of a module thread. The default leaves the
+*           priority inherited from the process untouched.
+*/
+DEFINE_ENUM(MODULE_THREAD_PRIORITY, MODULE_THREAD_PRIORITY_VALUES);
+
+/** @brief  Placement settings of the threads of one module. */
+typedef struct MODULE_THREAD_CONFIG_TAG
+{
+    /** @brief  Number of entries in @c cpus, 0 to let the thread run on any CPU. */
+    size_t cpu_count;
+
+    /** @brief  Indexes of the CPUs the threads may run on. */
+    int* cpus;
+
+    /** @brief  Priority of the threads. */
+    MODULE_THREAD_PRIORITY priority;
+
+    /** @brief  The (possibly @c NULL) name given to the threads. Platforms
+    *           limit its length, Linux to 15 characters.
+    */
+    char* thread_name;
+
+    /** @brief  When the broker delivers messages on a shared worker pool,
+    *           gives the module a thread of its own anyway. Modules whose
+    *           Module_Receive blocks need one. Without it the other
+    *           settings of a pooled module only apply to the threads the
+    *           module creates itself.
+    */
+    bool dedicated_thread;
+} MODULE_THREAD_CONFIG;
+
+/** @brief      Reads the "cpu_affinity", "priority", "thread_name" and
+*               "dedicated_thread" members of a module's JSON object.
+*
+*   @details    "cpu_affinity" is an array of CPU indexes or a string of
+*               indexes and ranges such as "0-3,6". "priority" is one of
+*               "lowest", "below_normal", "normal", "above_normal" or
+*               "highest".
+*
+*   @param      module_json     The module's object in the gateway JSON.
+*   @param      config          Receives the settings, or @c NULL if the
+*                               module has none. Free with
+*                               ::ModuleThreadConfig_Destroy.
+*
+*   @return     0 on success, non-zero if a member is malformed or on an
+*               allocation failure.
+*/
+GATEWAY_EXPORT int ModuleThreadConfig_ParseFromJson(const JSON_Object* module_json, MODULE_THREAD_CONFIG** config);
+
+/** @brief      Returns a copy of @c config, or @c NULL on failure. */
+GATEWAY_EXPORT MODULE_THREAD_CONFIG* ModuleThreadConfig_Clone(const MODULE_THREAD_CONFIG* config);
+
+/** @brief      Frees settings returned by ::ModuleThreadConfig_ParseFromJson
+*               or ::ModuleThreadConfig_Clone.
+*/
+GATEWAY_EXPORT void ModuleThreadConfig_Destroy(MODULE_THREAD_CONFIG* config);
+
+/** @brief      Makes @c config the current settings of the calling thread,
+*               without applying them to it.
+*
+*   @param      config  The settings threads created by the calling thread
+*                       inherit, or @c NULL for none. The caller keeps
+*                       ownership and must keep them alive while they are
+*                       current.
+*
+*   @return     The previous current settings of the calling thread.
+*/
+GATEWAY_EXPORT const MODULE_THREAD_CONFIG* ModuleThread_SetCurrentConfig(const MODULE_THREAD_CONFIG* config);
+
+/** @brief      Returns the current settings of the calling thread, or
+*               @c NULL.
+*/
+GATEWAY_EXPORT const MODULE_THREAD_CONFIG* ModuleThread_GetCurrentConfig(void);
+
+/** @brief      Applies @c config to the calling thread.
+*
+*   @details    Settings the platform does not support, or that the process
+*               lacks the privilege for (such as raising the priority), are
+*               logged and skipped.
+*
+*   @return     0 if every setting was applied, non-zero otherwise.
+*/
+GATEWAY_EXPORT int ModuleThread_Apply(const MODULE_THREAD_CONFIG* config);
+
+/** @brief      Creates a thread like ThreadAPI_Create, with the current
+*               settings of the calling thread applied to it.
+*
+*   @details    Modules should create their threads with this function so
+*               that the "cpu_affinity", "priority" and "thread_name" of
+*               their gateway configuration apply to them. The thread is
+*               joined with ThreadAPI_Join.
+*/
+GATEWAY_EXPORT THREADAPI_RESULT ModuleThread_Create(THREAD_HANDLE* threadHandle, THREAD_START_FUNC func, void* arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*MODULE_THREAD_H*/
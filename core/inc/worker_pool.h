@@ -0,0 +1,115 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file       worker_pool.h
+*   @brief      A fixed set of threads that deliver messages to mailboxes,
+*               each mailbox being served by at most one thread at a time.
+*
+*   @details    A mailbox is a FIFO of messages with a receive callback.
+*               Posting to an idle mailbox schedules it on a worker: on the
+*               posting thread's own worker when it is one of the pool's
+*               threads, round robin otherwise. A worker runs the callback
+*               for a batch of messages of one mailbox, then moves on to the
+*               next scheduled mailbox, so one busy mailbox cannot hold a
+*               worker forever. Idle workers steal scheduled mailboxes from
+*               the others. Since a mailbox is only ever scheduled once, its
+*               callback is never called concurrently and sees the messages
+*               in the order they were posted.
+*
+*               Callbacks must not block for long: a blocked callback holds
+*               a worker that every other mailbox shares.
+*/
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include "message.h"
+#include "parson.h"
+#include "gateway_export.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#endif
+
+/** @brief  Struct representing a pool of worker threads. */
+typedef struct WORKER_POOL_TAG* WORKER_POOL_HANDLE;
+
+/** @brief  Struct representing a mailbox served by a worker pool. */
+typedef struct WORKER_MAILBOX_TAG* WORKER_MAILBOX_HANDLE;
+
+/** @brief  Called on a worker thread for each message posted to a mailbox.
+*           The message is destroyed when the callback returns, callbacks
+*           that keep it must clone it.
+*/
+typedef void(*WORKER_MAILBOX_RECEIVE)(void* context, MESSAGE_HANDLE message);
+
+/** @brief      Reads the number of worker threads from the "broker" object
+*               of the gateway JSON.
+*
+*   @details    The gateway JSON may have a top level
+*               <tt>"broker": { "worker_threads": 4 }</tt>.
+*
+*   @param      gateway_json    The root value of the gateway JSON.
+*   @param      worker_count    Receives "worker_threads", or 0 if it is
+*                               absent.
+*
+*   @return     0 on success, non-zero if "broker" or "worker_threads" is
+*               malformed.
+*/
+GATEWAY_EXPORT int WorkerPool_ParseFromJson(const JSON_Value* gateway_json, size_t* worker_count);
+
+/** @brief      Creates a pool of @c worker_count threads.
+*
+*   @details    The threads are created with ::ModuleThread_Create, so they
+*               get the current module thread settings of the calling
+*               thread.
+*
+*   @return     A valid #WORKER_POOL_HANDLE, or @c NULL on failure.
+*/
+GATEWAY_EXPORT WORKER_POOL_HANDLE WorkerPool_Create(size_t worker_count);
+
+/** @brief      Stops and joins the threads of the pool and frees it.
+*
+*   @details    Every mailbox of the pool must have been closed with
+*               ::WorkerMailbox_Close before.
+*/
+GATEWAY_EXPORT void WorkerPool_Destroy(WORKER_POOL_HANDLE pool);
+
+/** @brief      Creates a mailbox served by @c pool.
+*
+*   @param      pool        The pool whose threads call @c receive.
+*   @param      receive     The callback called for each posted message.
+*   @param      context     Passed to @c receive.
+*
+*   @return     A valid #WORKER_MAILBOX_HANDLE, or @c NULL on failure.
+*/
+GATEWAY_EXPORT WORKER_MAILBOX_HANDLE WorkerMailbox_Create(WORKER_POOL_HANDLE pool, WORKER_MAILBOX_RECEIVE receive, void* context);
+
+/** @brief      Queues @c message for delivery to the mailbox's callback.
+*
+*   @details    On success the mailbox owns @c message. It can be called
+*               from any thread, including from a mailbox callback.
+*
+*   @return     0 on success, non-zero if the mailbox is closed or on an
+*               allocation failure.
+*/
+GATEWAY_EXPORT int WorkerMailbox_Post(WORKER_MAILBOX_HANDLE mailbox, MESSAGE_HANDLE message);
+
+/** @brief      Closes a mailbox.
+*
+*   @details    Messages not yet delivered are destroyed. If a worker is
+*               running the callback of the mailbox, the function waits for
+*               it to return, so that @c context may be freed afterwards,
+*               unless it is called from that callback.
+*/
+GATEWAY_EXPORT void WorkerMailbox_Close(WORKER_MAILBOX_HANDLE mailbox);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*WORKER_POOL_H*/
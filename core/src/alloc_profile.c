@@ -0,0 +1,264 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "alloc_profile.h"
+
+/*
+ * Nothing in this file may allocate: AllocProfile_OnAllocate and
+ * AllocProfile_OnFree are called from inside the allocator.
+ */
+
+#ifdef _MSC_VER
+#include <windows.h>
+#define ALLOC_PROFILE_THREAD_LOCAL __declspec(thread)
+typedef volatile LONG64 ALLOC_PROFILE_COUNTER;
+#define ALLOC_PROFILE_ADD(counter, value) (void)InterlockedExchangeAdd64(&(counter), (LONG64)(value))
+#define ALLOC_PROFILE_READ(counter) ((uint64_t)InterlockedCompareExchange64(&(counter), 0, 0))
+#define ALLOC_PROFILE_BARRIER() MemoryBarrier()
+#define ALLOC_PROFILE_TRY_LOCK(lock) (InterlockedExchange(&(lock), 1) == 0)
+#define ALLOC_PROFILE_UNLOCK(lock) (void)InterlockedExchange(&(lock), 0)
+typedef volatile LONG ALLOC_PROFILE_SPINLOCK;
+#else
+/*initial-exec keeps the first access on a thread from calling the allocator*/
+#define ALLOC_PROFILE_THREAD_LOCAL __thread __attribute__((tls_model("initial-exec")))
+typedef volatile int64_t ALLOC_PROFILE_COUNTER;
+#define ALLOC_PROFILE_ADD(counter, value) (void)__sync_fetch_and_add(&(counter), (int64_t)(value))
+#define ALLOC_PROFILE_READ(counter) ((uint64_t)__sync_fetch_and_add(&(counter), 0))
+#define ALLOC_PROFILE_BARRIER() __sync_synchronize()
+#define ALLOC_PROFILE_TRY_LOCK(lock) (__sync_lock_test_and_set(&(lock), 1) == 0)
+#define ALLOC_PROFILE_UNLOCK(lock) __sync_lock_release(&(lock))
+typedef volatile int ALLOC_PROFILE_SPINLOCK;
+#endif
+
+typedef struct ALLOC_PROFILE_SCOPE_TAG
+{
+    char name[ALLOC_PROFILE_MAX_NAME_LENGTH];
+    const void* volatile owner;
+    ALLOC_PROFILE_COUNTER allocations[ALLOC_PROFILE_SUBSYSTEM_COUNT];
+    ALLOC_PROFILE_COUNTER bytes[ALLOC_PROFILE_SUBSYSTEM_COUNT];
+    ALLOC_PROFILE_COUNTER frees;
+    ALLOC_PROFILE_COUNTER hops;
+} ALLOC_PROFILE_SCOPE;
+
+/*scope 0 is the unattributed scope, scopes are never removed*/
+static ALLOC_PROFILE_SCOPE g_scopes[ALLOC_PROFILE_MAX_SCOPES] = { { ALLOC_PROFILE_UNATTRIBUTED } };
+static volatile size_t g_scope_count = 1;
+static ALLOC_PROFILE_SPINLOCK g_scopes_lock = 0;
+static volatile int g_enabled = 0;
+
+static ALLOC_PROFILE_THREAD_LOCAL ALLOC_PROFILE_SCOPE* t_scope = NULL;
+static ALLOC_PROFILE_THREAD_LOCAL ALLOC_PROFILE_SUBSYSTEM t_subsystem = ALLOC_PROFILE_SUBSYSTEM_MODULE;
+
+static void lock_scopes(void)
+{
+    while (!ALLOC_PROFILE_TRY_LOCK(g_scopes_lock))
+    {
+        /*registration is rare and short, spin*/
+    }
+}
+
+void AllocProfile_Enable(void)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_001: [ AllocProfile_Enable shall cause subsequent calls to AllocProfile_OnAllocate, AllocProfile_OnFree and AllocProfile_RecordHop to be counted. ]*/
+    g_enabled = 1;
+    ALLOC_PROFILE_BARRIER();
+}
+
+void AllocProfile_Disable(void)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_002: [ AllocProfile_Disable shall cause subsequent calls to AllocProfile_OnAllocate, AllocProfile_OnFree and AllocProfile_RecordHop to be ignored. ]*/
+    g_enabled = 0;
+    ALLOC_PROFILE_BARRIER();
+}
+
+bool AllocProfile_IsEnabled(void)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_003: [ AllocProfile_IsEnabled shall return true if the profiler is enabled and false otherwise. ]*/
+    return g_enabled != 0;
+}
+
+void AllocProfile_Reset(void)
+{
+    size_t i;
+    size_t count = g_scope_count;
+    /*Codes_SRS_ALLOC_PROFILE_27_004: [ AllocProfile_Reset shall set all the counters of all the scopes to 0. ]*/
+    for (i = 0; i < count; i++)
+    {
+        size_t s;
+        for (s = 0; s < ALLOC_PROFILE_SUBSYSTEM_COUNT; s++)
+        {
+            g_scopes[i].allocations[s] = 0;
+            g_scopes[i].bytes[s] = 0;
+        }
+        g_scopes[i].frees = 0;
+        g_scopes[i].hops = 0;
+    }
+    ALLOC_PROFILE_BARRIER();
+}
+
+ALLOC_PROFILE_SCOPE_HANDLE AllocProfile_GetScope(const char* name)
+{
+    ALLOC_PROFILE_SCOPE_HANDLE result;
+    if (name == NULL)
+    {
+        /*Codes_SRS_ALLOC_PROFILE_27_005: [ If name is NULL, AllocProfile_GetScope shall return NULL. ]*/
+        result = NULL;
+    }
+    else
+    {
+        size_t i;
+        lock_scopes();
+        /*Codes_SRS_ALLOC_PROFILE_27_006: [ If a scope with the same name exists, AllocProfile_GetScope shall return it. ]*/
+        for (i = 0; i < g_scope_count; i++)
+        {
+            if (strncmp(g_scopes[i].name, name, ALLOC_PROFILE_MAX_NAME_LENGTH - 1) == 0)
+            {
+                break;
+            }
+        }
+
+        if (i < g_scope_count)
+        {
+            result = &g_scopes[i];
+        }
+        else if (g_scope_count == ALLOC_PROFILE_MAX_SCOPES)
+        {
+            /*Codes_SRS_ALLOC_PROFILE_27_008: [ If there is no room left in the scope table, AllocProfile_GetScope shall return NULL. ]*/
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_ALLOC_PROFILE_27_007: [ Otherwise AllocProfile_GetScope shall add a scope named name, truncated to ALLOC_PROFILE_MAX_NAME_LENGTH - 1 characters, with all counters at 0. ]*/
+            result = &g_scopes[g_scope_count];
+            memset(result, 0, sizeof(ALLOC_PROFILE_SCOPE));
+            strncpy(result->name, name, ALLOC_PROFILE_MAX_NAME_LENGTH - 1);
+            /*the scope must be complete before lock-free readers can see it*/
+            ALLOC_PROFILE_BARRIER();
+            g_scope_count++;
+        }
+        ALLOC_PROFILE_UNLOCK(g_scopes_lock);
+    }
+    return result;
+}
+
+void AllocProfile_BindScope(ALLOC_PROFILE_SCOPE_HANDLE scope, const void* owner)
+{
+    if (owner == NULL)
+    {
+        /*Codes_SRS_ALLOC_PROFILE_27_009: [ If owner is NULL, AllocProfile_BindScope shall do nothing. ]*/
+    }
+    else
+    {
+        size_t i;
+        lock_scopes();
+        /*Codes_SRS_ALLOC_PROFILE_27_010: [ AllocProfile_BindScope shall remove any previous association of owner with a scope. ]*/
+        for (i = 0; i < g_scope_count; i++)
+        {
+            if (g_scopes[i].owner == owner)
+            {
+                g_scopes[i].owner = NULL;
+            }
+        }
+        /*Codes_SRS_ALLOC_PROFILE_27_011: [ If scope is not NULL, AllocProfile_BindScope shall associate owner with scope. ]*/
+        if (scope != NULL)
+        {
+            scope->owner = owner;
+        }
+        ALLOC_PROFILE_BARRIER();
+        ALLOC_PROFILE_UNLOCK(g_scopes_lock);
+    }
+}
+
+ALLOC_PROFILE_SCOPE_HANDLE AllocProfile_FindScope(const void* owner)
+{
+    ALLOC_PROFILE_SCOPE_HANDLE result = NULL;
+    if (owner != NULL)
+    {
+        size_t i;
+        size_t count = g_scope_count;
+        /*Codes_SRS_ALLOC_PROFILE_27_012: [ AllocProfile_FindScope shall return the scope associated with owner, or NULL if there is none. ]*/
+        for (i = 0; i < count; i++)
+        {
+            if (g_scopes[i].owner == owner)
+            {
+                result = &g_scopes[i];
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+ALLOC_PROFILE_SCOPE_HANDLE AllocProfile_SetThreadScope(ALLOC_PROFILE_SCOPE_HANDLE scope)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_013: [ AllocProfile_SetThreadScope shall make scope the current scope of the calling thread and return the previous one. ]*/
+    ALLOC_PROFILE_SCOPE_HANDLE result = t_scope;
+    t_scope = scope;
+    return result;
+}
+
+ALLOC_PROFILE_SUBSYSTEM AllocProfile_SetThreadSubsystem(ALLOC_PROFILE_SUBSYSTEM subsystem)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_014: [ AllocProfile_SetThreadSubsystem shall make subsystem the current subsystem of the calling thread and return the previous one. ]*/
+    ALLOC_PROFILE_SUBSYSTEM result = t_subsystem;
+    t_subsystem = subsystem;
+    return result;
+}
+
+void AllocProfile_RecordHop(ALLOC_PROFILE_SCOPE_HANDLE scope)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_015: [ When the profiler is enabled, AllocProfile_RecordHop shall increment the hop count of scope, or of the unattributed scope if scope is NULL. ]*/
+    if (g_enabled)
+    {
+        ALLOC_PROFILE_SCOPE* target = (scope == NULL) ? &g_scopes[0] : scope;
+        ALLOC_PROFILE_ADD(target->hops, 1);
+    }
+}
+
+void AllocProfile_OnAllocate(size_t size)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_016: [ When the profiler is enabled, AllocProfile_OnAllocate shall add one allocation and size bytes to the current subsystem of the current scope of the calling thread. ]*/
+    /*Codes_SRS_ALLOC_PROFILE_27_017: [ If the calling thread has no current scope, the unattributed scope shall be charged. ]*/
+    if (g_enabled)
+    {
+        ALLOC_PROFILE_SCOPE* target = (t_scope == NULL) ? &g_scopes[0] : t_scope;
+        ALLOC_PROFILE_ADD(target->allocations[t_subsystem], 1);
+        ALLOC_PROFILE_ADD(target->bytes[t_subsystem], size);
+    }
+}
+
+void AllocProfile_OnFree(void)
+{
+    /*Codes_SRS_ALLOC_PROFILE_27_018: [ When the profiler is enabled, AllocProfile_OnFree shall add one free to the current scope of the calling thread. ]*/
+    if (g_enabled)
+    {
+        ALLOC_PROFILE_SCOPE* target = (t_scope == NULL) ? &g_scopes[0] : t_scope;
+        ALLOC_PROFILE_ADD(target->frees, 1);
+    }
+}
+
+size_t AllocProfile_GetReport(ALLOC_PROFILE_REPORT_ENTRY* entries, size_t capacity)
+{
+    size_t i;
+    size_t result = g_scope_count;
+    /*Codes_SRS_ALLOC_PROFILE_27_019: [ AllocProfile_GetReport shall copy the name and counters of the first capacity scopes into entries, the unattributed scope first. ]*/
+    /*Codes_SRS_ALLOC_PROFILE_27_020: [ AllocProfile_GetReport shall return the number of scopes. ]*/
+    for (i = 0; entries != NULL && i < result && i < capacity; i++)
+    {
+        size_t s;
+        memcpy(entries[i].name, g_scopes[i].name, ALLOC_PROFILE_MAX_NAME_LENGTH);
+        for (s = 0; s < ALLOC_PROFILE_SUBSYSTEM_COUNT; s++)
+        {
+            entries[i].allocations[s] = ALLOC_PROFILE_READ(g_scopes[i].allocations[s]);
+            entries[i].bytes[s] = ALLOC_PROFILE_READ(g_scopes[i].bytes[s]);
+        }
+        entries[i].frees = ALLOC_PROFILE_READ(g_scopes[i].frees);
+        entries[i].hops = ALLOC_PROFILE_READ(g_scopes[i].hops);
+    }
+    return result;
+}
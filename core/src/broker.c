@@ -21,6 +21,11 @@
 #include "module.h"
 #include "module_access.h"
 #include "broker.h"
+#include "module_thread.h"
+#include "worker_pool.h"
+#ifdef GATEWAY_ALLOC_PROFILING
+#include "alloc_profile.h"
+#endif
 
 /* minimum size for a guid string, 36 characters + null terminator */
 #define BROKER_GUID_SIZE 37
@@ -35,6 +40,12 @@ typedef struct BROKER_HANDLE_DATA_TAG
     LOCK_HANDLE             modules_lock;
     int                     publish_socket;
     STRING_HANDLE           url;
+    /** Pool delivering messages to the modules without a thread of their
+     *  own, NULL when every module has one
+     */
+    WORKER_POOL_HANDLE      pool;
+    /** Number of modules with a thread of their own on a broker with a pool */
+    size_t                  dedicated_module_count;
 }BROKER_HANDLE_DATA;
 
 DEFINE_REFCOUNT_TYPE(BROKER_HANDLE_DATA);
@@ -53,9 +64,28 @@ typedef struct BROKER_MODULEINFO_TAG
     LOCK_HANDLE     socket_lock;
     /** Guid sent to module worker thread to close task */
     STRING_HANDLE   quit_message_guid;
-
+    /** Mailbox the worker pool delivers messages from, NULL if the module
+     *  has a thread of its own
+     */
+    WORKER_MAILBOX_HANDLE mailbox;
+    /** BROKER_POOLED_LINK of the pooled modules this module is a source of,
+     *  NULL on a broker without a pool
+     */
+    VECTOR_HANDLE   pooled_sinks;
+#ifdef GATEWAY_ALLOC_PROFILING
+    /** Scope of the module, looked up on the first pooled delivery */
+    ALLOC_PROFILE_SCOPE_HANDLE alloc_scope;
+#endif
 }BROKER_MODULEINFO;
 
+typedef struct BROKER_POOLED_LINK_TAG
+{
+    /** The pooled module receiving the messages of the source */
+    BROKER_MODULEINFO* sink;
+    /** Number of times the link was added, as nanomsg counts subscriptions */
+    size_t link_count;
+}BROKER_POOLED_LINK;
+
 static STRING_HANDLE construct_url()
 {
     STRING_HANDLE result;
@@ -103,6 +133,8 @@ BROKER_HANDLE Broker_Create(void)
     }
     else
     {
+        result->pool = NULL;
+        result->dedicated_module_count = 0;
         /*Codes_SRS_BROKER_13_007: [Broker_Create shall initialize BROKER_HANDLE_DATA::modules with a valid VECTOR_HANDLE.]*/
         result->modules = singlylinkedlist_create();
         if (result->modules == NULL)
@@ -174,6 +206,28 @@ BROKER_HANDLE Broker_Create(void)
     return result;
 }
 
+BROKER_HANDLE Broker_CreateWithWorkerPool(size_t worker_count)
+{
+    BROKER_HANDLE_DATA* result;
+
+    /*Codes_SRS_BROKER_30_001: [ If worker_count is 0, Broker_CreateWithWorkerPool shall return the result of Broker_Create. ]*/
+    /*Codes_SRS_BROKER_30_002: [ Otherwise Broker_CreateWithWorkerPool shall create the broker as Broker_Create does, then a worker pool of worker_count threads with WorkerPool_Create. ]*/
+    result = Broker_Create();
+    if (result == NULL)
+    {
+        LogError("Broker_Create failed");
+    }
+    else if (worker_count > 0 && (result->pool = WorkerPool_Create(worker_count)) == NULL)
+    {
+        /*Codes_SRS_BROKER_30_003: [ If the worker pool cannot be created, Broker_CreateWithWorkerPool shall destroy the broker and return NULL. ]*/
+        LogError("WorkerPool_Create failed for %zu workers", worker_count);
+        Broker_Destroy(result);
+        result = NULL;
+    }
+
+    return result;
+}
+
 void Broker_IncRef(BROKER_HANDLE broker)
 {
     /*Codes_SRS_BROKER_13_108: [If `broker` is NULL then Broker_IncRef shall do nothing.]*/
@@ -197,6 +251,10 @@ static int module_worker(void * user_data)
 {
     /*Codes_SRS_BROKER_13_026: [This function shall assign `user_data` to a local variable called `module_info` of type `BROKER_MODULEINFO*`.]*/
     BROKER_MODULEINFO* module_info = (BROKER_MODULEINFO*)user_data;
+#ifdef GATEWAY_ALLOC_PROFILING
+    /* looked up lazily: the gateway binds the scope to the module handle */
+    ALLOC_PROFILE_SCOPE_HANDLE alloc_scope = NULL;
+#endif
 
     int should_continue = 1;
     while (should_continue)
@@ -247,6 +305,14 @@ static int module_worker(void * user_data)
                 /*Codes_SRS_BROKER_17_024: [ The function shall strip off the topic from the message. ]*/
                 const unsigned char*buf_bytes = (const unsigned char*)buf;
                 buf_bytes += sizeof(MODULE_HANDLE);
+#ifdef GATEWAY_ALLOC_PROFILING
+                if (alloc_scope == NULL && AllocProfile_IsEnabled())
+                {
+                    alloc_scope = AllocProfile_FindScope(module_info->module->module_handle);
+                }
+                (void)AllocProfile_SetThreadScope(alloc_scope);
+                AllocProfile_RecordHop(alloc_scope);
+#endif
                 /*Codes_SRS_BROKER_17_017: [ The function shall deserialize the message received. ]*/
                 MESSAGE_HANDLE msg = Message_CreateFromByteArray(buf_bytes, nbytes - sizeof(MODULE_HANDLE));
                 /*Codes_SRS_BROKER_17_018: [ If the deserialization is not successful, the message loop shall continue. ]*/
@@ -266,6 +332,29 @@ static int module_worker(void * user_data)
     return 0;
 }
 
+/**
+* Called by the worker pool for each message of a module without a thread of
+* its own, never concurrently for the same module.
+*/
+static void pooled_module_receive(void* context, MESSAGE_HANDLE message)
+{
+    BROKER_MODULEINFO* module_info = (BROKER_MODULEINFO*)context;
+#ifdef GATEWAY_ALLOC_PROFILING
+    ALLOC_PROFILE_SCOPE_HANDLE previous_alloc_scope;
+    if (module_info->alloc_scope == NULL && AllocProfile_IsEnabled())
+    {
+        module_info->alloc_scope = AllocProfile_FindScope(module_info->module->module_handle);
+    }
+    previous_alloc_scope = AllocProfile_SetThreadScope(module_info->alloc_scope);
+    AllocProfile_RecordHop(module_info->alloc_scope);
+#endif
+    /*Codes_SRS_BROKER_30_007: [ The worker pool shall deliver the messages of a pooled module to its Module_Receive one at a time, in the order they were published. ]*/
+    MODULE_RECEIVE(module_info->module->module_apis)(module_info->module->module_handle, message);
+#ifdef GATEWAY_ALLOC_PROFILING
+    (void)AllocProfile_SetThreadScope(previous_alloc_scope);
+#endif
+}
+
 static BROKER_RESULT init_module(BROKER_MODULEINFO* module_info, const MODULE* module)
 {
     BROKER_RESULT result;
@@ -328,9 +417,13 @@ static void deinit_module(BROKER_MODULEINFO* module_info)
     Lock_Deinit(module_info->socket_lock);
     STRING_delete(module_info->quit_message_guid);
     free(module_info->module);
+    if (module_info->pooled_sinks != NULL)
+    {
+        VECTOR_destroy(module_info->pooled_sinks);
+    }
 }
 
-static BROKER_RESULT start_module(BROKER_MODULEINFO* module_info, STRING_HANDLE url)
+static BROKER_RESULT start_module_thread(BROKER_MODULEINFO* module_info, STRING_HANDLE url)
 {
     BROKER_RESULT result;
 
@@ -369,15 +462,15 @@ static BROKER_RESULT start_module(BROKER_MODULEINFO* module_info, STRING_HANDLE
             }
             else
             {
-                /*Codes_SRS_BROKER_13_102: [The function shall create a new thread for the module by calling ThreadAPI_Create using module_worker as the thread callback and using the newly allocated BROKER_MODULEINFO object as the thread context.*/
-                if (ThreadAPI_Create(
+                /*Codes_SRS_BROKER_13_102: [The function shall create a new thread for the module by calling ModuleThread_Create using module_worker as the thread callback and using the newly allocated BROKER_MODULEINFO object as the thread context.*/
+                if (ModuleThread_Create(
                     &(module_info->thread),
                     module_worker,
                     (void*)module_info
                 ) != THREADAPI_OK)
                 {
                     /*Codes_SRS_BROKER_13_047: [ This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise. ]*/
-                    LogError("ThreadAPI_Create failed");
+                    LogError("ModuleThread_Create failed");
                     nn_close(module_info->receive_socket);
                     result = BROKER_ERROR;
                 }
@@ -392,6 +485,65 @@ static BROKER_RESULT start_module(BROKER_MODULEINFO* module_info, STRING_HANDLE
     return result;
 }
 
+static BROKER_RESULT start_module(BROKER_HANDLE_DATA* broker_data, BROKER_MODULEINFO* module_info)
+{
+    BROKER_RESULT result;
+
+    if (broker_data->pool == NULL)
+    {
+        result = start_module_thread(module_info, broker_data->url);
+    }
+    /*Codes_SRS_BROKER_30_004: [ On a broker with a worker pool, Broker_AddModule shall create a vector for the pooled modules linked to the module as a source. ]*/
+    else if ((module_info->pooled_sinks = VECTOR_create(sizeof(BROKER_POOLED_LINK))) == NULL)
+    {
+        LogError("VECTOR_create failed");
+        result = BROKER_ERROR;
+    }
+    else
+    {
+        /*the gateway makes the module's thread configuration current while it adds the module*/
+        const MODULE_THREAD_CONFIG* thread_config = ModuleThread_GetCurrentConfig();
+        if (thread_config != NULL && thread_config->dedicated_thread)
+        {
+            /*Codes_SRS_BROKER_30_005: [ On a broker with a worker pool, Broker_AddModule shall give the module a thread of its own if the current module thread configuration has dedicated_thread set. ]*/
+            result = start_module_thread(module_info, broker_data->url);
+            if (result == BROKER_OK)
+            {
+                broker_data->dedicated_module_count++;
+            }
+        }
+        else
+        {
+            /*Codes_SRS_BROKER_30_006: [ Otherwise Broker_AddModule shall create a mailbox for the module on the worker pool, and no thread or socket. ]*/
+            if (thread_config != NULL &&
+                (thread_config->cpu_count > 0 || thread_config->priority != MODULE_THREAD_PRIORITY_DEFAULT || thread_config->thread_name != NULL))
+            {
+                /*the pool's threads are shared, so they are not placed for any one module*/
+                LogInfo("module [%p] runs on the worker pool, its \"cpu_affinity\", \"priority\" and \"thread_name\" apply only to the threads it creates; set \"dedicated_thread\" to apply them to Module_Receive", module_info->module->module_handle);
+            }
+            module_info->receive_socket = -1;
+            module_info->mailbox = WorkerMailbox_Create(broker_data->pool, pooled_module_receive, module_info);
+            if (module_info->mailbox == NULL)
+            {
+                LogError("WorkerMailbox_Create failed");
+                result = BROKER_ERROR;
+            }
+            else
+            {
+                result = BROKER_OK;
+            }
+        }
+
+        if (result != BROKER_OK)
+        {
+            VECTOR_destroy(module_info->pooled_sinks);
+            module_info->pooled_sinks = NULL;
+        }
+    }
+
+    return result;
+}
+
 /*stop module means: stop the thread that feeds messages to Module_Receive function + deletion of all queued messages */
 /*returns 0 if success, otherwise __LINE__*/
 static int stop_module(int publish_socket, BROKER_MODULEINFO* module_info)
@@ -475,6 +627,11 @@ BROKER_RESULT Broker_AddModule(BROKER_HANDLE broker, const MODULE* module)
         }
         else
         {
+            module_info->mailbox = NULL;
+            module_info->pooled_sinks = NULL;
+#ifdef GATEWAY_ALLOC_PROFILING
+            module_info->alloc_scope = NULL;
+#endif
             if (init_module(module_info, module) != BROKER_OK)
             {
                 /*Codes_SRS_BROKER_13_047: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
@@ -509,7 +666,7 @@ BROKER_RESULT Broker_AddModule(BROKER_HANDLE broker, const MODULE* module)
                     }
                     else
                     {
-                        if (start_module(module_info, broker_data->url) != BROKER_OK)
+                        if (start_module(broker_data, module_info) != BROKER_OK)
                         {
                             LogError("start_module failed");
                             deinit_module(module_info);
@@ -541,6 +698,27 @@ static bool find_module_predicate(LIST_ITEM_HANDLE list_item, const void* value)
     return element->module->module_handle == ((MODULE*)value)->module_handle;
 }
 
+static bool find_pooled_link_predicate(const void* element, const void* value)
+{
+    return ((const BROKER_POOLED_LINK*)element)->sink == (const BROKER_MODULEINFO*)value;
+}
+
+/*detaches a pooled module from every module it is linked to as a sink*/
+static void remove_pooled_sink(BROKER_HANDLE_DATA* broker_data, BROKER_MODULEINFO* sink)
+{
+    LIST_ITEM_HANDLE item = singlylinkedlist_get_head_item(broker_data->modules);
+    while (item != NULL)
+    {
+        BROKER_MODULEINFO* source = (BROKER_MODULEINFO*)singlylinkedlist_item_get_value(item);
+        BROKER_POOLED_LINK* link = (BROKER_POOLED_LINK*)VECTOR_find_if(source->pooled_sinks, find_pooled_link_predicate, sink);
+        if (link != NULL)
+        {
+            VECTOR_erase(source->pooled_sinks, link, 1);
+        }
+        item = singlylinkedlist_get_next_item(item);
+    }
+}
+
 BROKER_RESULT Broker_RemoveModule(BROKER_HANDLE broker, const MODULE* module)
 {
     /*Codes_SRS_BROKER_13_048: [If `broker` or `module` is NULL the function shall return BROKER_INVALIDARG.]*/
@@ -563,6 +741,7 @@ BROKER_RESULT Broker_RemoveModule(BROKER_HANDLE broker, const MODULE* module)
         }
         else
         {
+            BROKER_MODULEINFO* pooled_module_info = NULL;
             /*Codes_SRS_BROKER_13_049: [Broker_RemoveModule shall perform a linear search for module in BROKER_HANDLE_DATA::modules.]*/
             LIST_ITEM_HANDLE module_info_item = singlylinkedlist_find(broker_data->modules, find_module_predicate, module);
 
@@ -575,18 +754,36 @@ BROKER_RESULT Broker_RemoveModule(BROKER_HANDLE broker, const MODULE* module)
             else
             {
                 BROKER_MODULEINFO* module_info = (BROKER_MODULEINFO*)singlylinkedlist_item_get_value(module_info_item);
-                if (stop_module(broker_data->publish_socket, module_info) == 0)
+                if (module_info->mailbox != NULL)
                 {
-                    deinit_module(module_info);
+                    /*Codes_SRS_BROKER_30_008: [ For a pooled module, Broker_RemoveModule shall remove the module from the pooled modules of every source and from BROKER_HANDLE_DATA::modules, then release the lock before it closes the mailbox with WorkerMailbox_Close. ]*/
+                    /*the module may be publishing from the worker, so its mailbox is not waited on with the lock held*/
+                    remove_pooled_sink(broker_data, module_info);
+                    pooled_module_info = module_info;
                 }
                 else
                 {
-                    LogError("unable to stop module");
+                    if (stop_module(broker_data->publish_socket, module_info) == 0)
+                    {
+                        deinit_module(module_info);
+                    }
+                    else
+                    {
+                        LogError("unable to stop module");
+                    }
+
+                    if (broker_data->pool != NULL)
+                    {
+                        broker_data->dedicated_module_count--;
+                    }
                 }
 
                 /*Codes_SRS_BROKER_13_052: [The function shall remove the module from BROKER_HANDLE_DATA::modules.]*/
                 singlylinkedlist_remove(broker_data->modules, module_info_item);
-                free(module_info);
+                if (pooled_module_info == NULL)
+                {
+                    free(module_info);
+                }
 
                 /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
                 result = BROKER_OK;
@@ -594,6 +791,13 @@ BROKER_RESULT Broker_RemoveModule(BROKER_HANDLE broker, const MODULE* module)
 
             /*Codes_SRS_BROKER_13_054: [This function shall release the lock on BROKER_HANDLE_DATA::modules_lock.]*/
             Unlock(broker_data->modules_lock);
+
+            if (pooled_module_info != NULL)
+            {
+                WorkerMailbox_Close(pooled_module_info->mailbox);
+                deinit_module(pooled_module_info);
+                free(pooled_module_info);
+            }
         }
     }
 
@@ -659,6 +863,32 @@ BROKER_RESULT Broker_AddLink(BROKER_HANDLE broker, const BROKER_LINK_DATA* link)
                     LogError("Link->source is not attached to the broker");
                     result = BROKER_ADD_LINK_ERROR;
                 }
+                else if (module_info->mailbox != NULL)
+                {
+                    /*Codes_SRS_BROKER_30_009: [ If the sink is a pooled module, Broker_AddLink shall add it to the pooled modules of the source, or count the link again if it is already there. ]*/
+                    BROKER_POOLED_LINK* pooled_link = (BROKER_POOLED_LINK*)VECTOR_find_if(source_module->pooled_sinks, find_pooled_link_predicate, module_info);
+                    if (pooled_link != NULL)
+                    {
+                        pooled_link->link_count++;
+                        result = BROKER_OK;
+                    }
+                    else
+                    {
+                        BROKER_POOLED_LINK new_link;
+                        new_link.sink = module_info;
+                        new_link.link_count = 1;
+                        if (VECTOR_push_back(source_module->pooled_sinks, &new_link, 1) != 0)
+                        {
+                            /*Codes_SRS_BROKER_17_034: [ Upon an error, Broker_AddLink shall return BROKER_ADD_LINK_ERROR ]*/
+                            LogError("Unable to make link in Broker");
+                            result = BROKER_ADD_LINK_ERROR;
+                        }
+                        else
+                        {
+                            result = BROKER_OK;
+                        }
+                    }
+                }
                 else
                 {
                     /*Codes_SRS_BROKER_17_032: [ Broker_AddLink shall subscribe module_info->receive_socket to the link->source module handle. ]*/
@@ -721,6 +951,25 @@ BROKER_RESULT Broker_RemoveLink(BROKER_HANDLE broker, const BROKER_LINK_DATA* li
                     LogError("Link->source is not attached to the broker");
                     result = BROKER_REMOVE_LINK_ERROR;
                 }
+                else if (module_info->mailbox != NULL)
+                {
+                    /*Codes_SRS_BROKER_30_010: [ If the sink is a pooled module, Broker_RemoveLink shall count the link once less, and remove the sink from the pooled modules of the source when the count reaches 0. ]*/
+                    BROKER_POOLED_LINK* pooled_link = (BROKER_POOLED_LINK*)VECTOR_find_if(source_module_info->pooled_sinks, find_pooled_link_predicate, module_info);
+                    if (pooled_link == NULL)
+                    {
+                        /*Codes_SRS_BROKER_17_040: [ Upon an error, Broker_RemoveLink shall return BROKER_REMOVE_LINK_ERROR. ]*/
+                        LogError("Link is not in the Broker");
+                        result = BROKER_REMOVE_LINK_ERROR;
+                    }
+                    else
+                    {
+                        if (--pooled_link->link_count == 0)
+                        {
+                            VECTOR_erase(source_module_info->pooled_sinks, pooled_link, 1);
+                        }
+                        result = BROKER_OK;
+                    }
+                }
                 else
                 {
                     /*Codes_SRS_BROKER_17_038: [ Broker_RemoveLink shall unsubscribe module_info->receive_socket from the link->module_source_handle module handle. ]*/
@@ -758,6 +1007,11 @@ static void broker_decrement_ref(BROKER_HANDLE broker)
             {
                 LogError("WARNING: There are still active modules attached to the broker and the broker is being destroyed.");
             }
+            if (broker_data->pool != NULL)
+            {
+                /*Codes_SRS_BROKER_30_013: [ Broker_Destroy shall destroy the worker pool of the broker, if it has one. ]*/
+                WorkerPool_Destroy(broker_data->pool);
+            }
             /* May want to do nn_shutdown first for cleanliness. */
             nn_close(broker_data->publish_socket);
             STRING_delete(broker_data->url);
@@ -783,6 +1037,92 @@ extern void Broker_DecRef(BROKER_HANDLE broker)
     broker_decrement_ref(broker);
 }
 
+/*sends the message to the modules that have a thread of their own, called with modules_lock held*/
+static BROKER_RESULT publish_to_sockets(BROKER_HANDLE_DATA* broker_data, MODULE_HANDLE source, MESSAGE_HANDLE message)
+{
+    BROKER_RESULT result;
+    int32_t msg_size;
+    int32_t buf_size;
+    /*Codes_SRS_BROKER_17_007: [ Broker_Publish shall clone the message. ]*/
+    MESSAGE_HANDLE msg = Message_Clone(message);
+    /*Codes_SRS_BROKER_17_008: [ Broker_Publish shall serialize the message. ]*/
+    msg_size = Message_ToByteArray(message, NULL, 0);
+    if (msg_size < 0)
+    {
+        /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
+        LogError("unable to serialize a message [%p]", msg);
+        Message_Destroy(msg);
+        result = BROKER_ERROR;
+    }
+    else
+    {
+        /*Codes_SRS_BROKER_17_025: [ Broker_Publish shall allocate a nanomsg buffer the size of the serialized message + sizeof(MODULE_HANDLE). ]*/
+        buf_size = msg_size + sizeof(MODULE_HANDLE);
+        void* nn_msg = nn_allocmsg(buf_size, 0);
+        if (nn_msg == NULL)
+        {
+            /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
+            LogError("unable to serialize a message [%p]", msg);
+            result = BROKER_ERROR;
+        }
+        else
+        {
+            /*Codes_SRS_BROKER_17_026: [ Broker_Publish shall copy source into the beginning of the nanomsg buffer. ]*/
+            unsigned char *nn_msg_bytes = (unsigned char *)nn_msg;
+            memcpy(nn_msg_bytes, &source, sizeof(MODULE_HANDLE));
+            /*Codes_SRS_BROKER_17_027: [ Broker_Publish shall serialize the message into the remainder of the nanomsg buffer. ]*/
+            nn_msg_bytes += sizeof(MODULE_HANDLE);
+            Message_ToByteArray(message, nn_msg_bytes, msg_size);
+
+            /*Codes_SRS_BROKER_17_010: [ Broker_Publish shall send a message on the publish_socket. ]*/
+            int nbytes = nn_send(broker_data->publish_socket, &nn_msg, NN_MSG, 0);
+            if (nbytes != buf_size)
+            {
+                /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
+                LogError("unable to send a message [%p]", msg);
+                /*Codes_SRS_BROKER_17_012: [ Broker_Publish shall free the message. ]*/
+                nn_freemsg(nn_msg);
+                result = BROKER_ERROR;
+            }
+            else
+            {
+                result = BROKER_OK;
+            }
+        }
+        /*Codes_SRS_BROKER_17_012: [ Broker_Publish shall free the message. ]*/
+        Message_Destroy(msg);
+        /*Codes_SRS_BROKER_17_011: [ Broker_Publish shall free the serialized message data. ]*/
+    }
+    return result;
+}
+
+/*posts the message to the pooled modules linked to source, called with modules_lock held*/
+static BROKER_RESULT publish_to_mailboxes(BROKER_HANDLE_DATA* broker_data, MODULE_HANDLE source, MESSAGE_HANDLE message)
+{
+    BROKER_RESULT result = BROKER_OK;
+    BROKER_MODULEINFO* source_info = broker_locate_handle(broker_data, source);
+    if (source_info != NULL)
+    {
+        size_t i;
+        size_t count = VECTOR_size(source_info->pooled_sinks);
+        for (i = 0; i < count; i++)
+        {
+            BROKER_POOLED_LINK* link = (BROKER_POOLED_LINK*)VECTOR_element(source_info->pooled_sinks, i);
+            /*Codes_SRS_BROKER_30_011: [ On a broker with a worker pool, Broker_Publish shall post a clone of the message to the mailbox of every pooled module linked to source, without serializing it. ]*/
+            /*messages are immutable, so every sink shares the one reference counted message*/
+            MESSAGE_HANDLE msg = Message_Clone(message);
+            if (WorkerMailbox_Post(link->sink->mailbox, msg) != 0)
+            {
+                /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
+                LogError("unable to post a message [%p] to module [%p]", msg, link->sink->module->module_handle);
+                Message_Destroy(msg);
+                result = BROKER_ERROR;
+            }
+        }
+    }
+    return result;
+}
+
 BROKER_RESULT Broker_Publish(BROKER_HANDLE broker, MODULE_HANDLE source, MESSAGE_HANDLE message)
 {
     BROKER_RESULT result;
@@ -804,63 +1144,35 @@ BROKER_RESULT Broker_Publish(BROKER_HANDLE broker, MODULE_HANDLE source, MESSAGE
         }
         else
         {
-            int32_t msg_size;
-            int32_t buf_size;
-            /*Codes_SRS_BROKER_17_007: [ Broker_Publish shall clone the message. ]*/
-            MESSAGE_HANDLE msg = Message_Clone(message);
-            /*Codes_SRS_BROKER_17_008: [ Broker_Publish shall serialize the message. ]*/
-            msg_size = Message_ToByteArray(message, NULL, 0);
-            if (msg_size < 0)
+#ifdef GATEWAY_ALLOC_PROFILING
+            /* charge the publishing module, whichever thread it publishes from */
+            ALLOC_PROFILE_SCOPE_HANDLE previous_alloc_scope = AllocProfile_SetThreadScope(
+                AllocProfile_IsEnabled() ? AllocProfile_FindScope(source) : NULL);
+            ALLOC_PROFILE_ENTER_SUBSYSTEM(ALLOC_PROFILE_SUBSYSTEM_BROKER);
+#endif
+            if (broker_data->pool == NULL)
             {
-                /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
-                LogError("unable to serialize a message [%p]", msg);
-                Message_Destroy(msg);
-                result = BROKER_ERROR;
+                result = publish_to_sockets(broker_data, source, message);
             }
             else
             {
-                /*Codes_SRS_BROKER_17_025: [ Broker_Publish shall allocate a nanomsg buffer the size of the serialized message + sizeof(MODULE_HANDLE). ]*/
-                buf_size = msg_size + sizeof(MODULE_HANDLE);
-                void* nn_msg = nn_allocmsg(buf_size, 0);
-                if (nn_msg == NULL)
+                result = publish_to_mailboxes(broker_data, source, message);
+                /*Codes_SRS_BROKER_30_012: [ On a broker with a worker pool, Broker_Publish shall only send the message on the publish_socket if a module has a thread of its own. ]*/
+                if (broker_data->dedicated_module_count > 0 &&
+                    publish_to_sockets(broker_data, source, message) != BROKER_OK)
                 {
-                    /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
-                    LogError("unable to serialize a message [%p]", msg);
                     result = BROKER_ERROR;
                 }
-                else
-                {
-                    /*Codes_SRS_BROKER_17_026: [ Broker_Publish shall copy source into the beginning of the nanomsg buffer. ]*/
-                    unsigned char *nn_msg_bytes = (unsigned char *)nn_msg;
-                    memcpy(nn_msg_bytes, &source, sizeof(MODULE_HANDLE));
-                    /*Codes_SRS_BROKER_17_027: [ Broker_Publish shall serialize the message into the remainder of the nanomsg buffer. ]*/
-                    nn_msg_bytes += sizeof(MODULE_HANDLE);
-                    Message_ToByteArray(message, nn_msg_bytes, msg_size);
-
-                    /*Codes_SRS_BROKER_17_010: [ Broker_Publish shall send a message on the publish_socket. ]*/
-                    int nbytes = nn_send(broker_data->publish_socket, &nn_msg, NN_MSG, 0);
-                    if (nbytes != buf_size)
-                    {
-                        /*Codes_SRS_BROKER_13_053: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]*/
-                        LogError("unable to send a message [%p]", msg);
-                        /*Codes_SRS_BROKER_17_012: [ Broker_Publish shall free the message. ]*/
-                        nn_freemsg(nn_msg);
-                        result = BROKER_ERROR;
-                    }
-                    else
-                    {
-                        result = BROKER_OK;
-                    }
-                }
-                /*Codes_SRS_BROKER_17_012: [ Broker_Publish shall free the message. ]*/
-                Message_Destroy(msg);
-                /*Codes_SRS_BROKER_17_011: [ Broker_Publish shall free the serialized message data. ]*/
             }
             /*Codes_SRS_BROKER_17_023: [ Broker_Publish shall Unlock the modules lock. ]*/
             Unlock(broker_data->modules_lock);
+#ifdef GATEWAY_ALLOC_PROFILING
+            ALLOC_PROFILE_LEAVE_SUBSYSTEM();
+            (void)AllocProfile_SetThreadScope(previous_alloc_scope);
+#endif
         }
 
     }
     /*Codes_SRS_BROKER_13_037: [ This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise. ]*/
     return result;
-}
\ No newline at end of file
+}
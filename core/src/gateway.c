@@ -158,7 +158,7 @@ GATEWAY_HANDLE Gateway_Create(const GATEWAY_PROPERTIES* properties)
     }
     else
     {
-        result = gateway_create_internal(properties, false);
+        result = gateway_create_internal(properties, false, 0);
         if (result == NULL)
         {
             /* Codes_SRS_GATEWAY_27_027: [ Launch - This function shall join any spawned threads upon any failure. ] */
@@ -170,6 +170,21 @@ GATEWAY_HANDLE Gateway_Create(const GATEWAY_PROPERTIES* properties)
     return result;
 }
 
+static void start_module(MODULE_DATA* module_data, pfModule_Start pfStart)
+{
+    if (module_data->thread_config == NULL)
+    {
+        (pfStart)(module_data->module);
+    }
+    else
+    {
+        /*Codes_SRS_GATEWAY_29_004: [ If the module has a thread configuration, it shall be the current module thread configuration of the calling thread while Module_Start runs. ]*/
+        const MODULE_THREAD_CONFIG* previous_thread_config = ModuleThread_SetCurrentConfig(module_data->thread_config);
+        (pfStart)(module_data->module);
+        (void)ModuleThread_SetCurrentConfig(previous_thread_config);
+    }
+}
+
 GATEWAY_START_RESULT Gateway_Start(GATEWAY_HANDLE gw)
 {
     GATEWAY_START_RESULT result;
@@ -187,7 +202,7 @@ GATEWAY_START_RESULT Gateway_Start(GATEWAY_HANDLE gw)
             if (pfStart != NULL)
             {
                 /*Codes_SRS_GATEWAY_17_010: [ This function shall call Module_Start for every module which defines the start function. ]*/
-                (pfStart)((*module_data)->module);
+                start_module(*module_data, pfStart);
             }
         }
         /*Codes_SRS_GATEWAY_17_012: [ This function shall report a GATEWAY_STARTED event. ]*/
@@ -249,7 +264,7 @@ extern void Gateway_StartModule(GATEWAY_HANDLE gw, MODULE_HANDLE module)
             if (pfStart != NULL)
             {
                 /*Codes_SRS_GATEWAY_17_008: [ When module is found, if the Module_Start function is defined for this module, the Module_Start function shall be called. ]*/
-                (pfStart)((*module_data)->module);
+                start_module(*module_data, pfStart);
             }
         }
         else
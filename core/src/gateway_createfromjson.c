@@ -8,6 +8,8 @@
 #include "gateway.h"
 #include "parson.h"
 #include "experimental/event_system.h"
+#include "module_thread.h"
+#include "worker_pool.h"
 
 #include "module_loaders/dynamic_loader.h"
 #include "gateway_internal.h"
@@ -34,7 +36,7 @@
 
 DEFINE_ENUM(PARSE_JSON_RESULT, PARSE_JSON_RESULT_VALUES);
 
-GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, bool use_json);
+GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, bool use_json, size_t worker_threads);
 static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties, JSON_Value *root);
 static void destroy_properties_internal(GATEWAY_PROPERTIES* properties);
 void gateway_destroy_internal(GATEWAY_HANDLE gw);
@@ -65,13 +67,16 @@ GATEWAY_HANDLE Gateway_CreateFromJson(const char* file_path)
 
                 if (properties != NULL)
                 {
+                    size_t worker_threads;
                     properties->gateway_modules = NULL;
                     properties->gateway_links = NULL;
-                    if ((parse_json_internal(properties, root_value) == PARSE_JSON_SUCCESS) && properties->gateway_modules != NULL && properties->gateway_links != NULL)
+                    /*Codes_SRS_GATEWAY_JSON_30_001: [ The function shall read the number of broker worker threads from the optional "broker" object with WorkerPool_ParseFromJson, and fail if it is malformed. ]*/
+                    if ((parse_json_internal(properties, root_value) == PARSE_JSON_SUCCESS) && properties->gateway_modules != NULL && properties->gateway_links != NULL &&
+                        WorkerPool_ParseFromJson(root_value, &worker_threads) == 0)
                     {
                         /*Codes_SRS_GATEWAY_JSON_14_007: [The function shall use the GATEWAY_PROPERTIES instance to create and return a GATEWAY_HANDLE using the lower level API.]*/
                         /*Codes_SRS_GATEWAY_JSON_17_004: [ The function shall set the module loader to the default dynamically linked library module loader. ]*/
-                        gw = gateway_create_internal(properties, true);
+                        gw = gateway_create_internal(properties, true, worker_threads);
 
                         if (gw == NULL)
                         {
@@ -387,6 +392,10 @@ static void destroy_properties_internal(GATEWAY_PROPERTIES* properties)
             GATEWAY_MODULES_ENTRY* element = (GATEWAY_MODULES_ENTRY*)VECTOR_element(properties->gateway_modules, element_index);
             element->module_loader_info.loader->api->FreeEntrypoint(element->module_loader_info.loader, element->module_loader_info.entrypoint);
             json_free_serialized_string((char*)(element->module_configuration));
+            if (element->module_thread_config != NULL)
+            {
+                ModuleThreadConfig_Destroy((MODULE_THREAD_CONFIG*)(element->module_thread_config));
+            }
         }
 
         VECTOR_destroy(properties->gateway_modules);
@@ -495,25 +504,44 @@ static PARSE_JSON_RESULT parse_json_internal(GATEWAY_PROPERTIES* out_properties,
                                     JSON_Value *args = json_object_get_value(module, ARG_KEY);
                                     char* args_str = json_serialize_to_string(args);
 
-                                    GATEWAY_MODULES_ENTRY entry = {
-                                        module_name,
-                                        loader_info,
-                                        args_str
-                                    };
-
-                                    /*Codes_SRS_GATEWAY_JSON_14_006: [The function shall return NULL if the JSON_Value contains incomplete information.]*/
-                                    if (VECTOR_push_back(out_properties->gateway_modules, &entry, 1) == 0)
-                                    {
-                                        result = PARSE_JSON_SUCCESS;
-                                    }
-                                    else
+                                    /*Codes_SRS_GATEWAY_JSON_29_001: [ The function shall parse the "cpu_affinity", "priority" and "thread_name" of each module with ModuleThreadConfig_ParseFromJson into its module_thread_config. ]*/
+                                    MODULE_THREAD_CONFIG* thread_config;
+                                    if (ModuleThreadConfig_ParseFromJson(module, &thread_config) != 0)
                                     {
+                                        /*Codes_SRS_GATEWAY_JSON_29_002: [ If ModuleThreadConfig_ParseFromJson fails, the function shall fail with PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG. ]*/
                                         loader_info.loader->api->FreeEntrypoint(loader_info.loader, loader_info.entrypoint);
                                         json_free_serialized_string(args_str);
-                                        result = PARSE_JSON_VECTOR_FAILURE;
-                                        LogError("Failed to push data into properties vector.");
+                                        result = PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG;
+                                        LogError("The thread configuration of module \"%s\" is misconfigured.", module_name);
                                         break;
                                     }
+                                    else
+                                    {
+                                        GATEWAY_MODULES_ENTRY entry = {
+                                            module_name,
+                                            loader_info,
+                                            args_str,
+                                            thread_config
+                                        };
+
+                                        /*Codes_SRS_GATEWAY_JSON_14_006: [The function shall return NULL if the JSON_Value contains incomplete information.]*/
+                                        if (VECTOR_push_back(out_properties->gateway_modules, &entry, 1) == 0)
+                                        {
+                                            result = PARSE_JSON_SUCCESS;
+                                        }
+                                        else
+                                        {
+                                            loader_info.loader->api->FreeEntrypoint(loader_info.loader, loader_info.entrypoint);
+                                            json_free_serialized_string(args_str);
+                                            if (thread_config != NULL)
+                                            {
+                                                ModuleThreadConfig_Destroy(thread_config);
+                                            }
+                                            result = PARSE_JSON_VECTOR_FAILURE;
+                                            LogError("Failed to push data into properties vector.");
+                                            break;
+                                        }
+                                    }
                                 }
                                 /*Codes_SRS_GATEWAY_JSON_14_006: [The function shall return NULL if the JSON_Value contains incomplete information.]*/
                                 else
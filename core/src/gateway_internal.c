@@ -12,9 +12,13 @@
 #include "experimental/event_system.h"
 #include "broker.h"
 #include "module_access.h"
+#include "module_thread.h"
 #ifdef OUTPROCESS_ENABLED
   #include "module_loaders/outprocess_loader.h"
 #endif
+#ifdef GATEWAY_ALLOC_PROFILING
+  #include "alloc_profile.h"
+#endif
 
 #include "gateway_internal.h"
 
@@ -138,7 +142,7 @@ static int add_regular_link(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_L
     return result;
 }
 
-GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, bool use_json)
+GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, bool use_json, size_t worker_threads)
 {
     GATEWAY_HANDLE_DATA* gateway;
     /*Codes_SRS_GATEWAY_14_001: [This function shall create a GATEWAY_HANDLE representing the newly created gateway.]*/
@@ -150,7 +154,8 @@ GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, boo
         memset(gateway, 0, sizeof(GATEWAY_HANDLE_DATA));
 
         /*Codes_SRS_GATEWAY_14_003: [This function shall create a new BROKER_HANDLE for the gateway representing this gateway's message broker. ]*/
-        gateway->broker = Broker_Create();
+        /*Codes_SRS_GATEWAY_JSON_30_002: [ If "worker_threads" is greater than 0, the gateway's message broker shall be created with Broker_CreateWithWorkerPool. ]*/
+        gateway->broker = (worker_threads == 0) ? Broker_Create() : Broker_CreateWithWorkerPool(worker_threads);
         if (gateway->broker == NULL)
         {
             /*Codes_SRS_GATEWAY_14_004: [This function shall return NULL if a BROKER_HANDLE cannot be created.]*/
@@ -425,8 +430,37 @@ MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, co
                         module_configuration
                     );
 
-                    /*Codes_SRS_GATEWAY_14_015: [The function shall use the MODULE_API to create a MODULE_HANDLE using the GATEWAY_MODULES_ENTRY's module_configuration. ]*/
-                    MODULE_HANDLE module_handle = MODULE_CREATE(module_apis)(gateway_handle->broker, transformed_module_configuration);
+#ifdef GATEWAY_ALLOC_PROFILING
+                    /* charge what the module allocates while being created to the module itself */
+                    ALLOC_PROFILE_SCOPE_HANDLE alloc_scope = AllocProfile_GetScope(module_entry->module_name);
+                    ALLOC_PROFILE_SCOPE_HANDLE previous_alloc_scope = AllocProfile_SetThreadScope(alloc_scope);
+#endif
+                    MODULE_THREAD_CONFIG* thread_config = NULL;
+                    const MODULE_THREAD_CONFIG* previous_thread_config = NULL;
+                    MODULE_HANDLE module_handle;
+                    /*Codes_SRS_GATEWAY_29_001: [ If GATEWAY_MODULES_ENTRY's module_thread_config is not NULL, the function shall keep a copy of it with the module. ]*/
+                    if (module_entry->module_thread_config != NULL &&
+                        (thread_config = ModuleThreadConfig_Clone(module_entry->module_thread_config)) == NULL)
+                    {
+                        /*Codes_SRS_GATEWAY_29_003: [ If the copy fails, the function shall not create the module and shall return NULL. ]*/
+                        LogError("Unable to copy the thread configuration of module %s", module_entry->module_name);
+                        module_handle = NULL;
+                    }
+                    else
+                    {
+                        /*Codes_SRS_GATEWAY_29_002: [ The function shall make the copy the current module thread configuration of the calling thread while it creates the module and attaches it to the broker, so that threads created with ModuleThread_Create use it. ]*/
+                        if (thread_config != NULL)
+                        {
+                            previous_thread_config = ModuleThread_SetCurrentConfig(thread_config);
+                        }
+                        /*Codes_SRS_GATEWAY_14_015: [The function shall use the MODULE_API to create a MODULE_HANDLE using the GATEWAY_MODULES_ENTRY's module_configuration. ]*/
+                        module_handle = MODULE_CREATE(module_apis)(gateway_handle->broker, transformed_module_configuration);
+                    }
+#ifdef GATEWAY_ALLOC_PROFILING
+                    (void)AllocProfile_SetThreadScope(previous_alloc_scope);
+                    /* the broker finds the scope from the module handle when delivering messages */
+                    AllocProfile_BindScope(alloc_scope, module_handle);
+#endif
 
                     // free the configurations
                     /*Codes_SRS_GATEWAY_17_020: [ The function shall clean up any constructed resources. ]*/
@@ -486,7 +520,8 @@ MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, co
                                     name_copied,
                                     module_library_handle,
                                     module_entry->module_loader_info.loader,
-                                    module_handle
+                                    module_handle,
+                                    thread_config
                                 };
                                 *new_module_data = module_data;
                                 /*Codes_SRS_GATEWAY_14_032: [The function shall add the new MODULE_DATA to GATEWAY_HANDLE_DATA's modules if the module was successfully attached to the message broker. ]*/
@@ -535,6 +570,15 @@ MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, co
                             module_entry->module_loader_info.loader->api->Unload(module_entry->module_loader_info.loader, module_library_handle);
                         }
                     }
+
+                    if (thread_config != NULL)
+                    {
+                        (void)ModuleThread_SetCurrentConfig(previous_thread_config);
+                        if (module_result == NULL)
+                        {
+                            ModuleThreadConfig_Destroy(thread_config);
+                        }
+                    }
                 }
             }
         }
@@ -578,6 +622,14 @@ void gateway_removemodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, MODULE_D
 
     /*Codes_SRS_GATEWAY_14_024: [ The function shall use the MODULE_DATA's module_library_handle to retrieve the MODULE_API and destroy module. ]*/
     MODULE_DESTROY((*module_data_pptr)->module_loader->api->GetApi((*module_data_pptr)->module_loader, (*module_data_pptr)->module_library_handle))((*module_data_pptr)->module);
+#ifdef GATEWAY_ALLOC_PROFILING
+    AllocProfile_BindScope(NULL, (*module_data_pptr)->module);
+#endif
+    /*Codes_SRS_GATEWAY_29_005: [ The function shall free the module's copy of its thread configuration after destroying the module. ]*/
+    if ((*module_data_pptr)->thread_config != NULL)
+    {
+        ModuleThreadConfig_Destroy((*module_data_pptr)->thread_config);
+    }
 
     /*Codes_SRS_GATEWAY_14_025: [The function shall unload MODULE_DATA's module_library_handle. ]*/
     (*module_data_pptr)->module_loader->api->Unload((*module_data_pptr)->module_loader, (*module_data_pptr)->module_library_handle);
@@ -5,6 +5,7 @@
 #define GATEWAY_INTERNAL_H
 
 #include "module_loader.h"
+#include "module_thread.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -26,6 +27,11 @@ typedef struct MODULE_DATA_TAG {
      *          broker.
      */
     MODULE_HANDLE module;
+
+    /** @brief  The (possibly @c NULL) placement of the module's threads,
+     *          owned by the gateway.
+     */
+    MODULE_THREAD_CONFIG* thread_config;
 } MODULE_DATA;
 
 typedef struct GATEWAY_HANDLE_DATA_TAG {
@@ -49,7 +55,7 @@ typedef struct LINK_DATA_TAG {
     MODULE_DATA *module_sink;
 } LINK_DATA;
 
-GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, bool use_json);
+GATEWAY_HANDLE gateway_create_internal(const GATEWAY_PROPERTIES* properties, bool use_json, size_t worker_threads);
 void gateway_destroy_internal(GATEWAY_HANDLE gw);
 MODULE_HANDLE gateway_addmodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, const GATEWAY_MODULES_ENTRY* entry, bool use_json);
 void gateway_removemodule_internal(GATEWAY_HANDLE_DATA* gateway_handle, MODULE_DATA** module);
@@ -7,6 +7,7 @@
 #include "azure_c_shared_utility/gballoc.h"
 
 #include "message.h"
+#include "alloc_profile.h"
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/map.h"
 #include "azure_c_shared_utility/constmap.h"
@@ -73,6 +74,7 @@ static MESSAGE_HANDLE_DATA* Message_CreateImpl(const MESSAGE_CONFIG * cfg)
 MESSAGE_HANDLE Message_Create(const MESSAGE_CONFIG * cfg)
 {
     MESSAGE_HANDLE_DATA* result;
+    ALLOC_PROFILE_ENTER_SUBSYSTEM(ALLOC_PROFILE_SUBSYSTEM_MESSAGE);
     /*Codes_SRS_MESSAGE_02_002: [If cfg is NULL then Message_Create shall return NULL.]*/
     if (cfg == NULL)
     {
@@ -90,12 +92,14 @@ MESSAGE_HANDLE Message_Create(const MESSAGE_CONFIG * cfg)
         /*delegate to internal function that does not do validation*/
         result = Message_CreateImpl(cfg);
     }
+    ALLOC_PROFILE_LEAVE_SUBSYSTEM();
     return (MESSAGE_HANDLE)result;
 }
 
 MESSAGE_HANDLE Message_CreateFromBuffer(const MESSAGE_BUFFER_CONFIG* cfg)
 {
     MESSAGE_HANDLE_DATA* result;
+    ALLOC_PROFILE_ENTER_SUBSYSTEM(ALLOC_PROFILE_SUBSYSTEM_MESSAGE);
     /*Codes_SRS_MESSAGE_17_008: [ If cfg is NULL then Message_CreateFromBuffer shall return NULL.] */
     if (cfg == NULL)
     {
@@ -152,6 +156,7 @@ MESSAGE_HANDLE Message_CreateFromBuffer(const MESSAGE_BUFFER_CONFIG* cfg)
             }
         }
     }
+    ALLOC_PROFILE_LEAVE_SUBSYSTEM();
     return (MESSAGE_HANDLE)result;
 }
 
@@ -302,6 +307,7 @@ static int parse_null_terminated_const_char(const unsigned char* source, int32_t
 MESSAGE_HANDLE Message_CreateFromByteArray(const unsigned char* source, int32_t size)
 {
     MESSAGE_HANDLE_DATA* result;
+    ALLOC_PROFILE_ENTER_SUBSYSTEM(ALLOC_PROFILE_SUBSYSTEM_MESSAGE);
     /*Codes_SRS_MESSAGE_02_022: [ If source is NULL then Message_CreateFromByteArray shall fail and return NULL. ]*/
     /*Codes_SRS_MESSAGE_02_023: [ If source is not NULL and and size parameter is smaller than 14 then Message_CreateFromByteArray shall fail and return NULL. ]*/
     if (
@@ -456,6 +462,7 @@ MESSAGE_HANDLE Message_CreateFromByteArray(const unsigned char* source, int32_t
 			}
         }
     }
+    ALLOC_PROFILE_LEAVE_SUBSYSTEM();
     return (MESSAGE_HANDLE)result;
 
 }
@@ -0,0 +1,452 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <ctype.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+
+#include "module_thread.h"
+
+#define CPU_AFFINITY_KEY "cpu_affinity"
+#define PRIORITY_KEY "priority"
+#define THREAD_NAME_KEY "thread_name"
+#define DEDICATED_THREAD_KEY "dedicated_thread"
+
+/*large enough for any machine the gateway runs on, small enough to catch typos*/
+#define MODULE_THREAD_MAX_CPU 4095
+
+#ifdef _MSC_VER
+#define MODULE_THREAD_LOCAL __declspec(thread)
+#else
+#define MODULE_THREAD_LOCAL __thread
+#endif
+
+typedef struct PRIORITY_NAME_TAG
+{
+    const char* name;
+    MODULE_THREAD_PRIORITY priority;
+} PRIORITY_NAME;
+
+static const PRIORITY_NAME priority_names[] =
+{
+    { "lowest", MODULE_THREAD_PRIORITY_LOWEST },
+    { "below_normal", MODULE_THREAD_PRIORITY_BELOW_NORMAL },
+    { "normal", MODULE_THREAD_PRIORITY_NORMAL },
+    { "above_normal", MODULE_THREAD_PRIORITY_ABOVE_NORMAL },
+    { "highest", MODULE_THREAD_PRIORITY_HIGHEST }
+};
+
+typedef struct MODULE_THREAD_START_TAG
+{
+    THREAD_START_FUNC func;
+    void* arg;
+    MODULE_THREAD_CONFIG* config;
+} MODULE_THREAD_START;
+
+static MODULE_THREAD_LOCAL const MODULE_THREAD_CONFIG* current_config = NULL;
+
+static int add_cpu(MODULE_THREAD_CONFIG* config, size_t* capacity, long cpu)
+{
+    int result;
+    if (cpu < 0 || cpu > MODULE_THREAD_MAX_CPU)
+    {
+        LogError("CPU index %ld is out of range", cpu);
+        result = __LINE__;
+    }
+    else
+    {
+        if (config->cpu_count == *capacity)
+        {
+            size_t new_capacity = (*capacity == 0) ? 8 : *capacity * 2;
+            int* new_cpus = (int*)realloc(config->cpus, new_capacity * sizeof(int));
+            if (new_cpus == NULL)
+            {
+                LogError("unable to allocate the CPU list");
+                result = __LINE__;
+            }
+            else
+            {
+                config->cpus = new_cpus;
+                *capacity = new_capacity;
+                result = 0;
+            }
+        }
+        else
+        {
+            result = 0;
+        }
+
+        if (result == 0)
+        {
+            config->cpus[config->cpu_count++] = (int)cpu;
+        }
+    }
+    return result;
+}
+
+static int parse_cpu_array(MODULE_THREAD_CONFIG* config, const JSON_Array* cpus)
+{
+    int result = 0;
+    size_t capacity = 0;
+    size_t count = json_array_get_count(cpus);
+    size_t i;
+    for (i = 0; i < count && result == 0; i++)
+    {
+        JSON_Value* cpu = json_array_get_value(cpus, i);
+        if (json_value_get_type(cpu) != JSONNumber)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_004: [ If "cpu_affinity" is neither an array of numbers nor a string of CPU indexes and ranges, ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+            LogError("\"%s\" must only contain numbers", CPU_AFFINITY_KEY);
+            result = __LINE__;
+        }
+        else
+        {
+            double value = json_value_get_number(cpu);
+            if (value != (double)(long)value)
+            {
+                LogError("\"%s\" must only contain whole numbers", CPU_AFFINITY_KEY);
+                result = __LINE__;
+            }
+            else
+            {
+                result = add_cpu(config, &capacity, (long)value);
+            }
+        }
+    }
+    return result;
+}
+
+/*accepts the taskset/cpuset list syntax: "2", "0-3", "0-3,6,8-9"*/
+static int parse_cpu_list(MODULE_THREAD_CONFIG* config, const char* list)
+{
+    int result = (*list == '\0') ? __LINE__ : 0;
+    size_t capacity = 0;
+    const char* position = list;
+    while (result == 0 && *position != '\0')
+    {
+        char* end;
+        long first = strtol(position, &end, 10);
+        long last = first;
+        if (end == position || !isdigit((unsigned char)*position))
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            position = end;
+            if (*position == '-')
+            {
+                position++;
+                last = strtol(position, &end, 10);
+                if (end == position || !isdigit((unsigned char)*position) || last < first)
+                {
+                    result = __LINE__;
+                }
+                position = end;
+            }
+
+            while (result == 0 && first <= last)
+            {
+                result = add_cpu(config, &capacity, first++);
+            }
+
+            if (result == 0 && *position == ',')
+            {
+                position++;
+                if (*position == '\0')
+                {
+                    result = __LINE__;
+                }
+            }
+            else if (result == 0 && *position != '\0')
+            {
+                result = __LINE__;
+            }
+        }
+    }
+
+    if (result != 0)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_004: [ If "cpu_affinity" is neither an array of numbers nor a string of CPU indexes and ranges, ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+        LogError("\"%s\" is not a valid CPU list: \"%s\"", CPU_AFFINITY_KEY, list);
+    }
+    return result;
+}
+
+static int parse_priority(MODULE_THREAD_CONFIG* config, const char* priority)
+{
+    int result = __LINE__;
+    size_t i;
+    for (i = 0; i < sizeof(priority_names) / sizeof(priority_names[0]); i++)
+    {
+        if (strcmp(priority_names[i].name, priority) == 0)
+        {
+            config->priority = priority_names[i].priority;
+            result = 0;
+            break;
+        }
+    }
+
+    if (result != 0)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_006: [ If "priority" is not one of "lowest", "below_normal", "normal", "above_normal" or "highest", ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+        LogError("unknown \"%s\": \"%s\"", PRIORITY_KEY, priority);
+    }
+    return result;
+}
+
+int ModuleThreadConfig_ParseFromJson(const JSON_Object* module_json, MODULE_THREAD_CONFIG** config)
+{
+    int result;
+    if (module_json == NULL || config == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_001: [ If module_json or config is NULL, ModuleThreadConfig_ParseFromJson shall return a non-zero value. ]*/
+        LogError("invalid arg module_json=%p, config=%p", module_json, config);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Value* affinity = json_object_get_value(module_json, CPU_AFFINITY_KEY);
+        JSON_Value* priority = json_object_get_value(module_json, PRIORITY_KEY);
+        JSON_Value* thread_name = json_object_get_value(module_json, THREAD_NAME_KEY);
+        JSON_Value* dedicated_thread = json_object_get_value(module_json, DEDICATED_THREAD_KEY);
+        *config = NULL;
+
+        if (affinity == NULL && priority == NULL && thread_name == NULL && dedicated_thread == NULL)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_002: [ If module_json has none of "cpu_affinity", "priority", "thread_name" and "dedicated_thread", ModuleThreadConfig_ParseFromJson shall set *config to NULL and return 0. ]*/
+            result = 0;
+        }
+        else if ((*config = (MODULE_THREAD_CONFIG*)malloc(sizeof(MODULE_THREAD_CONFIG))) == NULL)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_008: [ If any allocation fails, ModuleThreadConfig_ParseFromJson shall return a non-zero value. ]*/
+            LogError("unable to allocate the module thread configuration");
+            result = __LINE__;
+        }
+        else
+        {
+            (*config)->cpu_count = 0;
+            (*config)->cpus = NULL;
+            (*config)->priority = MODULE_THREAD_PRIORITY_DEFAULT;
+            (*config)->thread_name = NULL;
+            (*config)->dedicated_thread = false;
+            result = 0;
+
+            /*Codes_SRS_MODULE_THREAD_29_003: [ ModuleThreadConfig_ParseFromJson shall read "cpu_affinity" as either an array of CPU indexes or a string of comma separated CPU indexes and ranges. ]*/
+            if (affinity != NULL)
+            {
+                if (json_value_get_type(affinity) == JSONArray)
+                {
+                    result = parse_cpu_array(*config, json_value_get_array(affinity));
+                }
+                else if (json_value_get_type(affinity) == JSONString)
+                {
+                    result = parse_cpu_list(*config, json_value_get_string(affinity));
+                }
+                else
+                {
+                    /*Codes_SRS_MODULE_THREAD_29_004: [ If "cpu_affinity" is neither an array of numbers nor a string of CPU indexes and ranges, ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+                    LogError("\"%s\" must be an array or a string", CPU_AFFINITY_KEY);
+                    result = __LINE__;
+                }
+            }
+
+            /*Codes_SRS_MODULE_THREAD_29_005: [ ModuleThreadConfig_ParseFromJson shall read "priority" as one of "lowest", "below_normal", "normal", "above_normal" or "highest". ]*/
+            if (result == 0 && priority != NULL)
+            {
+                if (json_value_get_type(priority) != JSONString)
+                {
+                    /*Codes_SRS_MODULE_THREAD_29_006: [ If "priority" is not one of "lowest", "below_normal", "normal", "above_normal" or "highest", ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+                    LogError("\"%s\" must be a string", PRIORITY_KEY);
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = parse_priority(*config, json_value_get_string(priority));
+                }
+            }
+
+            /*Codes_SRS_MODULE_THREAD_29_007: [ ModuleThreadConfig_ParseFromJson shall copy the "thread_name" string, and fail if it is not a string. ]*/
+            if (result == 0 && thread_name != NULL)
+            {
+                if (json_value_get_type(thread_name) != JSONString)
+                {
+                    LogError("\"%s\" must be a string", THREAD_NAME_KEY);
+                    result = __LINE__;
+                }
+                else if (mallocAndStrcpy_s(&((*config)->thread_name), json_value_get_string(thread_name)) != 0)
+                {
+                    /*Codes_SRS_MODULE_THREAD_29_008: [ If any allocation fails, ModuleThreadConfig_ParseFromJson shall return a non-zero value. ]*/
+                    LogError("unable to copy \"%s\"", THREAD_NAME_KEY);
+                    (*config)->thread_name = NULL;
+                    result = __LINE__;
+                }
+            }
+
+            /*Codes_SRS_MODULE_THREAD_30_001: [ ModuleThreadConfig_ParseFromJson shall read "dedicated_thread" as a boolean, and fail if it is not one. ]*/
+            if (result == 0 && dedicated_thread != NULL)
+            {
+                if (json_value_get_type(dedicated_thread) != JSONBoolean)
+                {
+                    LogError("\"%s\" must be true or false", DEDICATED_THREAD_KEY);
+                    result = __LINE__;
+                }
+                else
+                {
+                    (*config)->dedicated_thread = (json_value_get_boolean(dedicated_thread) == 1);
+                }
+            }
+
+            if (result != 0)
+            {
+                ModuleThreadConfig_Destroy(*config);
+                *config = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+MODULE_THREAD_CONFIG* ModuleThreadConfig_Clone(const MODULE_THREAD_CONFIG* config)
+{
+    MODULE_THREAD_CONFIG* result;
+    if (config == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_009: [ If config is NULL, ModuleThreadConfig_Clone shall return NULL. ]*/
+        LogError("invalid arg config=NULL");
+        result = NULL;
+    }
+    else if ((result = (MODULE_THREAD_CONFIG*)malloc(sizeof(MODULE_THREAD_CONFIG))) == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_011: [ If any allocation fails, ModuleThreadConfig_Clone shall return NULL. ]*/
+        LogError("unable to allocate the module thread configuration");
+    }
+    else
+    {
+        /*Codes_SRS_MODULE_THREAD_29_010: [ ModuleThreadConfig_Clone shall return a deep copy of config. ]*/
+        result->cpu_count = config->cpu_count;
+        result->cpus = NULL;
+        result->priority = config->priority;
+        result->thread_name = NULL;
+        result->dedicated_thread = config->dedicated_thread;
+        if (config->cpu_count > 0 &&
+            (result->cpus = (int*)malloc(config->cpu_count * sizeof(int))) == NULL)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_011: [ If any allocation fails, ModuleThreadConfig_Clone shall return NULL. ]*/
+            LogError("unable to allocate the CPU list");
+            free(result);
+            result = NULL;
+        }
+        else if (config->thread_name != NULL &&
+            mallocAndStrcpy_s(&(result->thread_name), config->thread_name) != 0)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_011: [ If any allocation fails, ModuleThreadConfig_Clone shall return NULL. ]*/
+            LogError("unable to copy the thread name");
+            free(result->cpus);
+            free(result);
+            result = NULL;
+        }
+        else if (config->cpu_count > 0)
+        {
+            memcpy(result->cpus, config->cpus, config->cpu_count * sizeof(int));
+        }
+    }
+    return result;
+}
+
+void ModuleThreadConfig_Destroy(MODULE_THREAD_CONFIG* config)
+{
+    /*Codes_SRS_MODULE_THREAD_29_012: [ ModuleThreadConfig_Destroy shall free config and its members, and do nothing if config is NULL. ]*/
+    if (config != NULL)
+    {
+        free(config->cpus);
+        free(config->thread_name);
+        free(config);
+    }
+}
+
+const MODULE_THREAD_CONFIG* ModuleThread_SetCurrentConfig(const MODULE_THREAD_CONFIG* config)
+{
+    /*Codes_SRS_MODULE_THREAD_29_013: [ ModuleThread_SetCurrentConfig shall make config the current settings of the calling thread and return the previous ones. ]*/
+    const MODULE_THREAD_CONFIG* result = current_config;
+    current_config = config;
+    return result;
+}
+
+const MODULE_THREAD_CONFIG* ModuleThread_GetCurrentConfig(void)
+{
+    /*Codes_SRS_MODULE_THREAD_29_014: [ ModuleThread_GetCurrentConfig shall return the current settings of the calling thread. ]*/
+    return current_config;
+}
+
+static int module_thread_start(void* context)
+{
+    MODULE_THREAD_START* start = (MODULE_THREAD_START*)context;
+    THREAD_START_FUNC func = start->func;
+    void* arg = start->arg;
+    MODULE_THREAD_CONFIG* config = start->config;
+    int result;
+    free(start);
+
+    /*Codes_SRS_MODULE_THREAD_29_017: [ The new thread shall apply the settings with ModuleThread_Apply and make them its current settings before calling func with arg. ]*/
+    (void)ModuleThread_Apply(config);
+    current_config = config;
+    result = func(arg);
+
+    /*Codes_SRS_MODULE_THREAD_29_018: [ The new thread shall free its copy of the settings when func returns, and return what func returned. ]*/
+    current_config = NULL;
+    ModuleThreadConfig_Destroy(config);
+    return result;
+}
+
+THREADAPI_RESULT ModuleThread_Create(THREAD_HANDLE* threadHandle, THREAD_START_FUNC func, void* arg)
+{
+    THREADAPI_RESULT result;
+    if (threadHandle == NULL || func == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_015: [ If threadHandle or func is NULL, ModuleThread_Create shall return THREADAPI_INVALID_ARG. ]*/
+        LogError("invalid arg threadHandle=%p, func=%p", threadHandle, func);
+        result = THREADAPI_INVALID_ARG;
+    }
+    else if (current_config == NULL)
+    {
+        /*Codes_SRS_MODULE_THREAD_29_016: [ If the calling thread has no current settings, ModuleThread_Create shall return the result of ThreadAPI_Create(threadHandle, func, arg). ]*/
+        result = ThreadAPI_Create(threadHandle, func, arg);
+    }
+    else
+    {
+        /*the new thread gets its own copy: the creating module may be destroyed while it runs*/
+        MODULE_THREAD_START* start = (MODULE_THREAD_START*)malloc(sizeof(MODULE_THREAD_START));
+        if (start == NULL)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_019: [ If any allocation fails, ModuleThread_Create shall return THREADAPI_NO_MEMORY. ]*/
+            LogError("unable to allocate the thread start context");
+            result = THREADAPI_NO_MEMORY;
+        }
+        else if ((start->config = ModuleThreadConfig_Clone(current_config)) == NULL)
+        {
+            /*Codes_SRS_MODULE_THREAD_29_019: [ If any allocation fails, ModuleThread_Create shall return THREADAPI_NO_MEMORY. ]*/
+            LogError("unable to copy the module thread configuration");
+            free(start);
+            result = THREADAPI_NO_MEMORY;
+        }
+        else
+        {
+            start->func = func;
+            start->arg = arg;
+            /*Codes_SRS_MODULE_THREAD_29_020: [ Otherwise ModuleThread_Create shall create the thread with ThreadAPI_Create, passing it a copy of the current settings of the calling thread. ]*/
+            result = ThreadAPI_Create(threadHandle, module_thread_start, start);
+            if (result != THREADAPI_OK)
+            {
+                LogError("ThreadAPI_Create failed");
+                ModuleThreadConfig_Destroy(start->config);
+                free(start);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,735 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+
+#include "worker_pool.h"
+#include "module_thread.h"
+
+#define BROKER_KEY "broker"
+#define WORKER_THREADS_KEY "worker_threads"
+
+/*more threads than this is a configuration mistake, not a use of the pool*/
+#define WORKER_POOL_MAX_WORKERS 256
+
+/*messages a worker delivers to one mailbox before it moves on to the next scheduled mailbox*/
+#define WORKER_MAILBOX_BATCH 32
+
+#define RING_INITIAL_CAPACITY 16
+
+#ifdef _MSC_VER
+#define WORKER_POOL_THREAD_LOCAL __declspec(thread)
+#else
+#define WORKER_POOL_THREAD_LOCAL __thread
+#endif
+
+/*growable circular FIFO of pointers*/
+typedef struct POINTER_RING_TAG
+{
+    void** items;
+    size_t capacity;
+    size_t head;
+    size_t count;
+} POINTER_RING;
+
+typedef struct WORKER_TAG
+{
+    struct WORKER_POOL_TAG* pool;
+    THREAD_HANDLE thread;
+    LOCK_HANDLE lock;
+    /*mailboxes scheduled on this worker, the owner runs them from the front, thieves take them from the back*/
+    POINTER_RING scheduled;
+} WORKER;
+
+typedef struct WORKER_POOL_TAG
+{
+    WORKER* workers;
+    size_t worker_count;
+    LOCK_HANDLE lock;
+    COND_HANDLE wake;
+    /*mailboxes scheduled on any worker and not taken yet*/
+    size_t pending;
+    size_t sleeping;
+    size_t mailbox_count;
+    size_t next_worker;
+    bool stopping;
+} WORKER_POOL;
+
+typedef struct WORKER_MAILBOX_TAG
+{
+    WORKER_POOL* pool;
+    /*the worker the mailbox is scheduled on when it is posted to from outside the pool*/
+    WORKER* home;
+    WORKER_MAILBOX_RECEIVE receive;
+    void* context;
+    LOCK_HANDLE lock;
+    COND_HANDLE idle;
+    POINTER_RING messages;
+    /*one for the owner until it closes the mailbox, one while the mailbox is scheduled or running*/
+    size_t references;
+    bool scheduled;
+    bool running;
+    bool closed;
+} WORKER_MAILBOX;
+
+static WORKER_POOL_THREAD_LOCAL WORKER* current_worker = NULL;
+static WORKER_POOL_THREAD_LOCAL WORKER_MAILBOX* running_mailbox = NULL;
+
+static int ring_reserve(POINTER_RING* ring, size_t capacity)
+{
+    int result;
+    if (capacity <= ring->capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        void** items = (void**)malloc(capacity * sizeof(void*));
+        if (items == NULL)
+        {
+            LogError("unable to allocate a ring of %zu items", capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            size_t i;
+            for (i = 0; i < ring->count; i++)
+            {
+                items[i] = ring->items[(ring->head + i) % ring->capacity];
+            }
+            free(ring->items);
+            ring->items = items;
+            ring->capacity = capacity;
+            ring->head = 0;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static int ring_push_back(POINTER_RING* ring, void* item)
+{
+    int result;
+    if (ring->count == ring->capacity &&
+        ring_reserve(ring, (ring->capacity == 0) ? RING_INITIAL_CAPACITY : ring->capacity * 2) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        ring->items[(ring->head + ring->count) % ring->capacity] = item;
+        ring->count++;
+        result = 0;
+    }
+    return result;
+}
+
+static void* ring_pop_front(POINTER_RING* ring)
+{
+    void* result;
+    if (ring->count == 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = ring->items[ring->head];
+        ring->head = (ring->head + 1) % ring->capacity;
+        ring->count--;
+    }
+    return result;
+}
+
+static void* ring_pop_back(POINTER_RING* ring)
+{
+    void* result;
+    if (ring->count == 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        ring->count--;
+        result = ring->items[(ring->head + ring->count) % ring->capacity];
+    }
+    return result;
+}
+
+int WorkerPool_ParseFromJson(const JSON_Value* gateway_json, size_t* worker_count)
+{
+    int result;
+    if (gateway_json == NULL || worker_count == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_001: [ If gateway_json or worker_count is NULL, WorkerPool_ParseFromJson shall return a non-zero value. ]*/
+        LogError("invalid arg gateway_json=%p, worker_count=%p", gateway_json, worker_count);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Object* root = json_value_get_object(gateway_json);
+        JSON_Value* broker = (root == NULL) ? NULL : json_object_get_value(root, BROKER_KEY);
+        *worker_count = 0;
+
+        if (broker == NULL)
+        {
+            /*Codes_SRS_WORKER_POOL_30_002: [ If the gateway JSON has no "broker" object or the object has no "worker_threads", WorkerPool_ParseFromJson shall set *worker_count to 0 and return 0. ]*/
+            result = 0;
+        }
+        else if (json_value_get_type(broker) != JSONObject)
+        {
+            /*Codes_SRS_WORKER_POOL_30_004: [ If "broker" is not an object, or "worker_threads" is not a whole number between 0 and 256, WorkerPool_ParseFromJson shall return a non-zero value. ]*/
+            LogError("\"%s\" must be an object", BROKER_KEY);
+            result = __LINE__;
+        }
+        else
+        {
+            JSON_Value* threads = json_object_get_value(json_value_get_object(broker), WORKER_THREADS_KEY);
+            if (threads == NULL)
+            {
+                /*Codes_SRS_WORKER_POOL_30_002: [ If the gateway JSON has no "broker" object or the object has no "worker_threads", WorkerPool_ParseFromJson shall set *worker_count to 0 and return 0. ]*/
+                result = 0;
+            }
+            else
+            {
+                double value = json_value_get_number(threads);
+                if (json_value_get_type(threads) != JSONNumber ||
+                    value < 0 || value > WORKER_POOL_MAX_WORKERS || value != (double)(size_t)value)
+                {
+                    /*Codes_SRS_WORKER_POOL_30_004: [ If "broker" is not an object, or "worker_threads" is not a whole number between 0 and 256, WorkerPool_ParseFromJson shall return a non-zero value. ]*/
+                    LogError("\"%s\" must be a whole number between 0 and %d", WORKER_THREADS_KEY, WORKER_POOL_MAX_WORKERS);
+                    result = __LINE__;
+                }
+                else
+                {
+                    /*Codes_SRS_WORKER_POOL_30_003: [ WorkerPool_ParseFromJson shall set *worker_count to the "worker_threads" number of the "broker" object. ]*/
+                    *worker_count = (size_t)value;
+                    result = 0;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+static void free_mailbox(WORKER_MAILBOX* mailbox)
+{
+    WORKER_POOL* pool = mailbox->pool;
+    if (Lock(pool->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the worker pool");
+    }
+    else
+    {
+        pool->mailbox_count--;
+        (void)Unlock(pool->lock);
+    }
+    free(mailbox->messages.items);
+    Condition_Deinit(mailbox->idle);
+    Lock_Deinit(mailbox->lock);
+    free(mailbox);
+}
+
+/*drops the reference of the scheduler, and frees the mailbox if it was the last one; called with the mailbox lock held, which it releases*/
+static void unschedule_and_unlock(WORKER_MAILBOX* mailbox)
+{
+    bool release;
+    mailbox->scheduled = false;
+    release = (--mailbox->references == 0);
+    (void)Unlock(mailbox->lock);
+    if (release)
+    {
+        free_mailbox(mailbox);
+    }
+}
+
+static void schedule_mailbox(WORKER* worker, WORKER_MAILBOX* mailbox)
+{
+    WORKER_POOL* pool = worker->pool;
+    if (Lock(pool->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the worker pool");
+    }
+    else
+    {
+        if (Lock(worker->lock) != LOCK_OK)
+        {
+            LogError("unable to lock the worker");
+        }
+        else
+        {
+            /*counted before another worker can take it, so that the taker never decrements first*/
+            pool->pending++;
+            /*every worker has room for every mailbox of the pool, so this does not allocate*/
+            (void)ring_push_back(&worker->scheduled, mailbox);
+            (void)Unlock(worker->lock);
+
+            if (pool->sleeping > 0)
+            {
+                (void)Condition_Post(pool->wake);
+            }
+        }
+        (void)Unlock(pool->lock);
+    }
+}
+
+static WORKER_MAILBOX* take_from(WORKER* worker, bool steal)
+{
+    WORKER_MAILBOX* result;
+    if (Lock(worker->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the worker");
+        result = NULL;
+    }
+    else
+    {
+        result = (WORKER_MAILBOX*)(steal ? ring_pop_back(&worker->scheduled) : ring_pop_front(&worker->scheduled));
+        (void)Unlock(worker->lock);
+    }
+    return result;
+}
+
+static WORKER_MAILBOX* take_scheduled(WORKER* worker)
+{
+    WORKER_POOL* pool = worker->pool;
+    size_t self = (size_t)(worker - pool->workers);
+    size_t i;
+    /*Codes_SRS_WORKER_POOL_30_013: [ A worker shall run the mailboxes scheduled on it in the order they were scheduled, and take a mailbox scheduled on another worker when it has none. ]*/
+    WORKER_MAILBOX* result = take_from(worker, false);
+    for (i = 1; result == NULL && i < pool->worker_count; i++)
+    {
+        result = take_from(&pool->workers[(self + i) % pool->worker_count], true);
+    }
+
+    if (result != NULL)
+    {
+        if (Lock(pool->lock) != LOCK_OK)
+        {
+            LogError("unable to lock the worker pool");
+        }
+        else
+        {
+            pool->pending--;
+            (void)Unlock(pool->lock);
+        }
+    }
+    return result;
+}
+
+static void run_mailbox(WORKER* worker, WORKER_MAILBOX* mailbox)
+{
+    if (Lock(mailbox->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the mailbox");
+    }
+    else
+    {
+        size_t delivered = 0;
+        mailbox->running = true;
+        running_mailbox = mailbox;
+
+        /*Codes_SRS_WORKER_POOL_30_014: [ A worker shall call the receive callback of a mailbox for at most 32 messages, in the order they were posted, then destroy each message. ]*/
+        while (!mailbox->closed && mailbox->messages.count > 0 && delivered < WORKER_MAILBOX_BATCH)
+        {
+            MESSAGE_HANDLE message = (MESSAGE_HANDLE)ring_pop_front(&mailbox->messages);
+            (void)Unlock(mailbox->lock);
+            mailbox->receive(mailbox->context, message);
+            Message_Destroy(message);
+            delivered++;
+            (void)Lock(mailbox->lock);
+        }
+
+        running_mailbox = NULL;
+        mailbox->running = false;
+        if (mailbox->closed)
+        {
+            (void)Condition_Post(mailbox->idle);
+        }
+
+        if (!mailbox->closed && mailbox->messages.count > 0)
+        {
+            /*Codes_SRS_WORKER_POOL_30_015: [ If messages remain after a batch, the worker shall schedule the mailbox again behind the mailboxes already scheduled on it. ]*/
+            (void)Unlock(mailbox->lock);
+            schedule_mailbox(worker, mailbox);
+        }
+        else
+        {
+            unschedule_and_unlock(mailbox);
+        }
+    }
+}
+
+static int worker_thread(void* context)
+{
+    WORKER* worker = (WORKER*)context;
+    WORKER_POOL* pool = worker->pool;
+    bool should_continue = true;
+    current_worker = worker;
+
+    while (should_continue)
+    {
+        WORKER_MAILBOX* mailbox = take_scheduled(worker);
+        if (mailbox != NULL)
+        {
+            run_mailbox(worker, mailbox);
+        }
+        else if (Lock(pool->lock) != LOCK_OK)
+        {
+            LogError("unable to lock the worker pool");
+            should_continue = false;
+        }
+        else
+        {
+            /*Codes_SRS_WORKER_POOL_30_016: [ A worker with no mailbox to run shall wait until a mailbox is scheduled or the pool is destroyed. ]*/
+            while (!pool->stopping && pool->pending == 0)
+            {
+                pool->sleeping++;
+                (void)Condition_Wait(pool->wake, pool->lock, 0);
+                pool->sleeping--;
+            }
+            should_continue = !pool->stopping;
+            (void)Unlock(pool->lock);
+        }
+    }
+
+    current_worker = NULL;
+    return 0;
+}
+
+/*stops and joins the first started workers, and frees everything*/
+static void destroy_pool(WORKER_POOL* pool, size_t started)
+{
+    size_t i;
+    if (Lock(pool->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the worker pool, workers are not stopped");
+    }
+    else
+    {
+        pool->stopping = true;
+        for (i = 0; i < pool->sleeping; i++)
+        {
+            (void)Condition_Post(pool->wake);
+        }
+        (void)Unlock(pool->lock);
+
+        for (i = 0; i < started; i++)
+        {
+            int thread_result;
+            if (ThreadAPI_Join(pool->workers[i].thread, &thread_result) != THREADAPI_OK)
+            {
+                LogError("ThreadAPI_Join failed for worker %zu", i);
+            }
+        }
+    }
+
+    for (i = 0; i < pool->worker_count; i++)
+    {
+        WORKER_MAILBOX* mailbox;
+        /*mailboxes closed while they were still scheduled are released by whoever takes them*/
+        while ((mailbox = (WORKER_MAILBOX*)ring_pop_front(&pool->workers[i].scheduled)) != NULL)
+        {
+            if (Lock(mailbox->lock) != LOCK_OK)
+            {
+                LogError("unable to lock the mailbox");
+            }
+            else
+            {
+                unschedule_and_unlock(mailbox);
+            }
+        }
+        free(pool->workers[i].scheduled.items);
+        /*workers after a failed Lock_Init have none*/
+        if (pool->workers[i].lock != NULL)
+        {
+            Lock_Deinit(pool->workers[i].lock);
+        }
+    }
+
+    if (pool->mailbox_count > 0)
+    {
+        LogError("WARNING: %zu mailboxes are still open and the worker pool is being destroyed.", pool->mailbox_count);
+    }
+    Condition_Deinit(pool->wake);
+    Lock_Deinit(pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+WORKER_POOL_HANDLE WorkerPool_Create(size_t worker_count)
+{
+    WORKER_POOL* result;
+    if (worker_count == 0 || worker_count > WORKER_POOL_MAX_WORKERS)
+    {
+        /*Codes_SRS_WORKER_POOL_30_005: [ If worker_count is 0 or more than 256, WorkerPool_Create shall return NULL. ]*/
+        LogError("invalid arg worker_count=%zu", worker_count);
+        result = NULL;
+    }
+    else if ((result = (WORKER_POOL*)malloc(sizeof(WORKER_POOL))) == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_007: [ If any underlying call fails, WorkerPool_Create shall free what it allocated and return NULL. ]*/
+        LogError("unable to allocate the worker pool");
+    }
+    else
+    {
+        memset(result, 0, sizeof(WORKER_POOL));
+        result->worker_count = worker_count;
+        if ((result->workers = (WORKER*)malloc(worker_count * sizeof(WORKER))) == NULL)
+        {
+            /*Codes_SRS_WORKER_POOL_30_007: [ If any underlying call fails, WorkerPool_Create shall free what it allocated and return NULL. ]*/
+            LogError("unable to allocate the workers");
+            free(result);
+            result = NULL;
+        }
+        else if ((result->lock = Lock_Init()) == NULL)
+        {
+            LogError("Lock_Init failed");
+            free(result->workers);
+            free(result);
+            result = NULL;
+        }
+        else if ((result->wake = Condition_Init()) == NULL)
+        {
+            LogError("Condition_Init failed");
+            Lock_Deinit(result->lock);
+            free(result->workers);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            size_t initialized;
+            size_t started;
+            memset(result->workers, 0, worker_count * sizeof(WORKER));
+            for (initialized = 0; initialized < worker_count; initialized++)
+            {
+                result->workers[initialized].pool = result;
+                if ((result->workers[initialized].lock = Lock_Init()) == NULL)
+                {
+                    LogError("Lock_Init failed for worker %zu", initialized);
+                    break;
+                }
+            }
+
+            /*Codes_SRS_WORKER_POOL_30_006: [ WorkerPool_Create shall create worker_count threads with ModuleThread_Create. ]*/
+            started = 0;
+            if (initialized == worker_count)
+            {
+                for (; started < worker_count; started++)
+                {
+                    if (ModuleThread_Create(&(result->workers[started].thread), worker_thread, &(result->workers[started])) != THREADAPI_OK)
+                    {
+                        LogError("ModuleThread_Create failed for worker %zu", started);
+                        break;
+                    }
+                }
+            }
+
+            if (started < worker_count)
+            {
+                /*Codes_SRS_WORKER_POOL_30_007: [ If any underlying call fails, WorkerPool_Create shall free what it allocated and return NULL. ]*/
+                destroy_pool(result, started);
+                result = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+void WorkerPool_Destroy(WORKER_POOL_HANDLE pool)
+{
+    if (pool == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_008: [ If pool is NULL, WorkerPool_Destroy shall do nothing. ]*/
+        LogError("invalid arg pool=NULL");
+    }
+    else
+    {
+        /*Codes_SRS_WORKER_POOL_30_009: [ WorkerPool_Destroy shall wake and join every worker thread, then free the pool. ]*/
+        destroy_pool(pool, pool->worker_count);
+    }
+}
+
+WORKER_MAILBOX_HANDLE WorkerMailbox_Create(WORKER_POOL_HANDLE pool, WORKER_MAILBOX_RECEIVE receive, void* context)
+{
+    WORKER_MAILBOX* result;
+    if (pool == NULL || receive == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_010: [ If pool or receive is NULL, WorkerMailbox_Create shall return NULL. ]*/
+        LogError("invalid arg pool=%p, receive=%p", pool, receive);
+        result = NULL;
+    }
+    else if ((result = (WORKER_MAILBOX*)malloc(sizeof(WORKER_MAILBOX))) == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_012: [ If any underlying call fails, WorkerMailbox_Create shall free what it allocated and return NULL. ]*/
+        LogError("unable to allocate the mailbox");
+    }
+    else
+    {
+        memset(result, 0, sizeof(WORKER_MAILBOX));
+        result->pool = pool;
+        result->receive = receive;
+        result->context = context;
+        result->references = 1;
+        if ((result->lock = Lock_Init()) == NULL)
+        {
+            LogError("Lock_Init failed");
+            free(result);
+            result = NULL;
+        }
+        else if ((result->idle = Condition_Init()) == NULL)
+        {
+            LogError("Condition_Init failed");
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else if (Lock(pool->lock) != LOCK_OK)
+        {
+            LogError("unable to lock the worker pool");
+            Condition_Deinit(result->idle);
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_WORKER_POOL_30_011: [ WorkerMailbox_Create shall make room for one more mailbox on every worker of the pool, so that scheduling a mailbox never allocates. ]*/
+            size_t i;
+            int reserve_result = 0;
+            size_t capacity = pool->workers[0].scheduled.capacity;
+            if (pool->mailbox_count + 1 > capacity)
+            {
+                capacity = (capacity == 0) ? RING_INITIAL_CAPACITY : capacity * 2;
+                for (i = 0; i < pool->worker_count && reserve_result == 0; i++)
+                {
+                    if (Lock(pool->workers[i].lock) != LOCK_OK)
+                    {
+                        LogError("unable to lock worker %zu", i);
+                        reserve_result = __LINE__;
+                    }
+                    else
+                    {
+                        reserve_result = ring_reserve(&(pool->workers[i].scheduled), capacity);
+                        (void)Unlock(pool->workers[i].lock);
+                    }
+                }
+            }
+
+            if (reserve_result != 0)
+            {
+                /*Codes_SRS_WORKER_POOL_30_012: [ If any underlying call fails, WorkerMailbox_Create shall free what it allocated and return NULL. ]*/
+                (void)Unlock(pool->lock);
+                Condition_Deinit(result->idle);
+                Lock_Deinit(result->lock);
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                pool->mailbox_count++;
+                result->home = &(pool->workers[pool->next_worker]);
+                pool->next_worker = (pool->next_worker + 1) % pool->worker_count;
+                (void)Unlock(pool->lock);
+            }
+        }
+    }
+    return result;
+}
+
+int WorkerMailbox_Post(WORKER_MAILBOX_HANDLE mailbox, MESSAGE_HANDLE message)
+{
+    int result;
+    if (mailbox == NULL || message == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_017: [ If mailbox or message is NULL, WorkerMailbox_Post shall return a non-zero value. ]*/
+        LogError("invalid arg mailbox=%p, message=%p", mailbox, message);
+        result = __LINE__;
+    }
+    else if (Lock(mailbox->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the mailbox");
+        result = __LINE__;
+    }
+    else
+    {
+        bool schedule = false;
+        if (mailbox->closed)
+        {
+            /*Codes_SRS_WORKER_POOL_30_018: [ If the mailbox is closed, WorkerMailbox_Post shall return a non-zero value. ]*/
+            LogError("the mailbox is closed");
+            result = __LINE__;
+        }
+        else if (ring_push_back(&mailbox->messages, message) != 0)
+        {
+            /*Codes_SRS_WORKER_POOL_30_019: [ WorkerMailbox_Post shall append message to the messages of the mailbox, and return a non-zero value if it cannot. ]*/
+            LogError("unable to queue the message");
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_WORKER_POOL_30_020: [ If the mailbox is neither scheduled nor running, WorkerMailbox_Post shall schedule it on the calling worker if the caller is a worker of the pool, or on the worker the mailbox was assigned at creation otherwise. ]*/
+            if (!mailbox->scheduled)
+            {
+                mailbox->scheduled = true;
+                mailbox->references++;
+                schedule = true;
+            }
+            result = 0;
+        }
+        (void)Unlock(mailbox->lock);
+
+        if (schedule)
+        {
+            schedule_mailbox(
+                (current_worker != NULL && current_worker->pool == mailbox->pool) ? current_worker : mailbox->home,
+                mailbox);
+        }
+    }
+    return result;
+}
+
+void WorkerMailbox_Close(WORKER_MAILBOX_HANDLE mailbox)
+{
+    if (mailbox == NULL)
+    {
+        /*Codes_SRS_WORKER_POOL_30_021: [ If mailbox is NULL, WorkerMailbox_Close shall do nothing. ]*/
+        LogError("invalid arg mailbox=NULL");
+    }
+    else if (Lock(mailbox->lock) != LOCK_OK)
+    {
+        LogError("unable to lock the mailbox");
+    }
+    else
+    {
+        MESSAGE_HANDLE message;
+        bool release;
+        /*Codes_SRS_WORKER_POOL_30_022: [ WorkerMailbox_Close shall mark the mailbox closed and destroy the messages that were not delivered. ]*/
+        mailbox->closed = true;
+        while ((message = (MESSAGE_HANDLE)ring_pop_front(&mailbox->messages)) != NULL)
+        {
+            Message_Destroy(message);
+        }
+
+        /*Codes_SRS_WORKER_POOL_30_023: [ If a worker is running the receive callback of the mailbox, WorkerMailbox_Close shall wait for it to return, unless it is called from that callback. ]*/
+        while (mailbox->running && running_mailbox != mailbox)
+        {
+            (void)Condition_Wait(mailbox->idle, mailbox->lock, 0);
+        }
+
+        /*Codes_SRS_WORKER_POOL_30_024: [ The mailbox shall be freed once it is closed and no worker holds it. ]*/
+        release = (--mailbox->references == 0);
+        (void)Unlock(mailbox->lock);
+        if (release)
+        {
+            free_mailbox(mailbox);
+        }
+    }
+}
@@ -0,0 +1,326 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GATEWAY_EXPORT_H
+#define GATEWAY_EXPORT
+
+#include "testrunnerswitcher.h"
+#include "alloc_profile.h"
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+static ALLOC_PROFILE_REPORT_ENTRY g_report[ALLOC_PROFILE_MAX_SCOPES];
+
+/*the scope table lives for the whole process, so every test uses its own scope names*/
+static const ALLOC_PROFILE_REPORT_ENTRY* find_entry(const char* name)
+{
+    const ALLOC_PROFILE_REPORT_ENTRY* result = NULL;
+    size_t count = AllocProfile_GetReport(g_report, ALLOC_PROFILE_MAX_SCOPES);
+    size_t i;
+    for (i = 0; i < count && i < ALLOC_PROFILE_MAX_SCOPES; i++)
+    {
+        if (strcmp(g_report[i].name, name) == 0)
+        {
+            result = &g_report[i];
+            break;
+        }
+    }
+    return result;
+}
+
+BEGIN_TEST_SUITE(alloc_profile_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    AllocProfile_Disable();
+    AllocProfile_Reset();
+    (void)AllocProfile_SetThreadScope(NULL);
+    (void)AllocProfile_SetThreadSubsystem(ALLOC_PROFILE_SUBSYSTEM_MODULE);
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    AllocProfile_Disable();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_001: [ AllocProfile_Enable shall cause subsequent calls to AllocProfile_OnAllocate, AllocProfile_OnFree and AllocProfile_RecordHop to be counted. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_003: [ AllocProfile_IsEnabled shall return true if the profiler is enabled and false otherwise. ]*/
+TEST_FUNCTION(AllocProfile_Enable_enables_counting)
+{
+    ///arrange
+    ASSERT_IS_FALSE(AllocProfile_IsEnabled());
+
+    ///act
+    AllocProfile_Enable();
+    AllocProfile_OnAllocate(10);
+    AllocProfile_OnFree();
+
+    ///assert
+    ASSERT_IS_TRUE(AllocProfile_IsEnabled());
+    const ALLOC_PROFILE_REPORT_ENTRY* entry = find_entry(ALLOC_PROFILE_UNATTRIBUTED);
+    ASSERT_IS_NOT_NULL(entry);
+    ASSERT_ARE_EQUAL(int, 1, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 10, (int)entry->bytes[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 1, (int)entry->frees);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_002: [ AllocProfile_Disable shall cause subsequent calls to AllocProfile_OnAllocate, AllocProfile_OnFree and AllocProfile_RecordHop to be ignored. ]*/
+TEST_FUNCTION(AllocProfile_Disable_stops_counting)
+{
+    ///arrange
+    AllocProfile_Enable();
+
+    ///act
+    AllocProfile_Disable();
+    AllocProfile_OnAllocate(10);
+    AllocProfile_OnFree();
+    AllocProfile_RecordHop(NULL);
+
+    ///assert
+    ASSERT_IS_FALSE(AllocProfile_IsEnabled());
+    const ALLOC_PROFILE_REPORT_ENTRY* entry = find_entry(ALLOC_PROFILE_UNATTRIBUTED);
+    ASSERT_IS_NOT_NULL(entry);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->frees);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->hops);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_004: [ AllocProfile_Reset shall set all the counters of all the scopes to 0. ]*/
+TEST_FUNCTION(AllocProfile_Reset_clears_counters)
+{
+    ///arrange
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope("reset");
+    AllocProfile_Enable();
+    (void)AllocProfile_SetThreadScope(scope);
+    AllocProfile_OnAllocate(10);
+    AllocProfile_RecordHop(scope);
+
+    ///act
+    AllocProfile_Reset();
+
+    ///assert
+    const ALLOC_PROFILE_REPORT_ENTRY* entry = find_entry("reset");
+    ASSERT_IS_NOT_NULL(entry);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->bytes[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->hops);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_005: [ If name is NULL, AllocProfile_GetScope shall return NULL. ]*/
+TEST_FUNCTION(AllocProfile_GetScope_with_NULL_name_returns_NULL)
+{
+    ///act
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope(NULL);
+
+    ///assert
+    ASSERT_IS_NULL(scope);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_006: [ If a scope with the same name exists, AllocProfile_GetScope shall return it. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_007: [ Otherwise AllocProfile_GetScope shall add a scope named name, truncated to ALLOC_PROFILE_MAX_NAME_LENGTH - 1 characters, with all counters at 0. ]*/
+TEST_FUNCTION(AllocProfile_GetScope_returns_the_same_scope_for_the_same_name)
+{
+    ///act
+    ALLOC_PROFILE_SCOPE_HANDLE scope1 = AllocProfile_GetScope("same name");
+    ALLOC_PROFILE_SCOPE_HANDLE scope2 = AllocProfile_GetScope("same name");
+    ALLOC_PROFILE_SCOPE_HANDLE scope3 = AllocProfile_GetScope("other name");
+
+    ///assert
+    ASSERT_IS_NOT_NULL(scope1);
+    ASSERT_ARE_EQUAL(void_ptr, scope1, scope2);
+    ASSERT_ARE_NOT_EQUAL(void_ptr, scope1, scope3);
+    ASSERT_IS_NOT_NULL(find_entry("same name"));
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_010: [ AllocProfile_BindScope shall remove any previous association of owner with a scope. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_011: [ If scope is not NULL, AllocProfile_BindScope shall associate owner with scope. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_012: [ AllocProfile_FindScope shall return the scope associated with owner, or NULL if there is none. ]*/
+TEST_FUNCTION(AllocProfile_BindScope_moves_the_owner_between_scopes)
+{
+    ///arrange
+    int owner;
+    ALLOC_PROFILE_SCOPE_HANDLE scope1 = AllocProfile_GetScope("bind 1");
+    ALLOC_PROFILE_SCOPE_HANDLE scope2 = AllocProfile_GetScope("bind 2");
+
+    ///act
+    AllocProfile_BindScope(scope1, &owner);
+    ALLOC_PROFILE_SCOPE_HANDLE found1 = AllocProfile_FindScope(&owner);
+    AllocProfile_BindScope(scope2, &owner);
+    ALLOC_PROFILE_SCOPE_HANDLE found2 = AllocProfile_FindScope(&owner);
+    AllocProfile_BindScope(NULL, &owner);
+    ALLOC_PROFILE_SCOPE_HANDLE found3 = AllocProfile_FindScope(&owner);
+
+    ///assert
+    ASSERT_ARE_EQUAL(void_ptr, scope1, found1);
+    ASSERT_ARE_EQUAL(void_ptr, scope2, found2);
+    ASSERT_IS_NULL(found3);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_009: [ If owner is NULL, AllocProfile_BindScope shall do nothing. ]*/
+TEST_FUNCTION(AllocProfile_FindScope_with_NULL_owner_returns_NULL)
+{
+    ///arrange
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope("null owner");
+
+    ///act
+    AllocProfile_BindScope(scope, NULL);
+
+    ///assert
+    ASSERT_IS_NULL(AllocProfile_FindScope(NULL));
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_013: [ AllocProfile_SetThreadScope shall make scope the current scope of the calling thread and return the previous one. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_016: [ When the profiler is enabled, AllocProfile_OnAllocate shall add one allocation and size bytes to the current subsystem of the current scope of the calling thread. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_018: [ When the profiler is enabled, AllocProfile_OnFree shall add one free to the current scope of the calling thread. ]*/
+TEST_FUNCTION(AllocProfile_OnAllocate_charges_the_thread_scope)
+{
+    ///arrange
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope("thread scope");
+    AllocProfile_Enable();
+
+    ///act
+    ALLOC_PROFILE_SCOPE_HANDLE previous = AllocProfile_SetThreadScope(scope);
+    AllocProfile_OnAllocate(100);
+    AllocProfile_OnAllocate(28);
+    AllocProfile_OnFree();
+    ALLOC_PROFILE_SCOPE_HANDLE current = AllocProfile_SetThreadScope(previous);
+
+    ///assert
+    ASSERT_IS_NULL(previous);
+    ASSERT_ARE_EQUAL(void_ptr, scope, current);
+    const ALLOC_PROFILE_REPORT_ENTRY* entry = find_entry("thread scope");
+    ASSERT_IS_NOT_NULL(entry);
+    ASSERT_ARE_EQUAL(int, 2, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 128, (int)entry->bytes[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 1, (int)entry->frees);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_014: [ AllocProfile_SetThreadSubsystem shall make subsystem the current subsystem of the calling thread and return the previous one. ]*/
+TEST_FUNCTION(AllocProfile_OnAllocate_charges_the_thread_subsystem)
+{
+    ///arrange
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope("subsystems");
+    AllocProfile_Enable();
+    (void)AllocProfile_SetThreadScope(scope);
+
+    ///act
+    ALLOC_PROFILE_SUBSYSTEM previous = AllocProfile_SetThreadSubsystem(ALLOC_PROFILE_SUBSYSTEM_MESSAGE);
+    AllocProfile_OnAllocate(1);
+    (void)AllocProfile_SetThreadSubsystem(ALLOC_PROFILE_SUBSYSTEM_BROKER);
+    AllocProfile_OnAllocate(2);
+    AllocProfile_OnAllocate(3);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, (int)ALLOC_PROFILE_SUBSYSTEM_MODULE, (int)previous);
+    const ALLOC_PROFILE_REPORT_ENTRY* entry = find_entry("subsystems");
+    ASSERT_IS_NOT_NULL(entry);
+    ASSERT_ARE_EQUAL(int, 0, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 1, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MESSAGE]);
+    ASSERT_ARE_EQUAL(int, 2, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_BROKER]);
+    ASSERT_ARE_EQUAL(int, 5, (int)entry->bytes[ALLOC_PROFILE_SUBSYSTEM_BROKER]);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_017: [ If the calling thread has no current scope, the unattributed scope shall be charged. ]*/
+TEST_FUNCTION(AllocProfile_OnAllocate_without_scope_charges_unattributed)
+{
+    ///arrange
+    AllocProfile_Enable();
+
+    ///act
+    AllocProfile_OnAllocate(7);
+
+    ///assert
+    const ALLOC_PROFILE_REPORT_ENTRY* entry = find_entry(ALLOC_PROFILE_UNATTRIBUTED);
+    ASSERT_IS_NOT_NULL(entry);
+    ASSERT_ARE_EQUAL(int, 1, (int)entry->allocations[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+    ASSERT_ARE_EQUAL(int, 7, (int)entry->bytes[ALLOC_PROFILE_SUBSYSTEM_MODULE]);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_015: [ When the profiler is enabled, AllocProfile_RecordHop shall increment the hop count of scope, or of the unattributed scope if scope is NULL. ]*/
+TEST_FUNCTION(AllocProfile_RecordHop_counts_hops)
+{
+    ///arrange
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope("hops");
+    AllocProfile_Enable();
+
+    ///act
+    AllocProfile_RecordHop(scope);
+    AllocProfile_RecordHop(scope);
+    AllocProfile_RecordHop(NULL);
+
+    ///assert
+    ASSERT_ARE_EQUAL(int, 2, (int)find_entry("hops")->hops);
+    ASSERT_ARE_EQUAL(int, 1, (int)find_entry(ALLOC_PROFILE_UNATTRIBUTED)->hops);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_019: [ AllocProfile_GetReport shall copy the name and counters of the first capacity scopes into entries, the unattributed scope first. ]*/
+/*Tests_SRS_ALLOC_PROFILE_27_020: [ AllocProfile_GetReport shall return the number of scopes. ]*/
+TEST_FUNCTION(AllocProfile_GetReport_returns_the_scope_count_beyond_capacity)
+{
+    ///arrange
+    ALLOC_PROFILE_REPORT_ENTRY entry;
+    (void)AllocProfile_GetScope("report");
+    memset(&entry, 0, sizeof(entry));
+
+    ///act
+    size_t count = AllocProfile_GetReport(&entry, 1);
+
+    ///assert
+    ASSERT_IS_TRUE(count > 1);
+    ASSERT_ARE_EQUAL(char_ptr, ALLOC_PROFILE_UNATTRIBUTED, entry.name);
+}
+
+/*Tests_SRS_ALLOC_PROFILE_27_008: [ If there is no room left in the scope table, AllocProfile_GetScope shall return NULL. ]*/
+/*this test fills the scope table, keep it last*/
+TEST_FUNCTION(AllocProfile_GetScope_returns_NULL_when_the_table_is_full)
+{
+    ///arrange
+    char name[32];
+    size_t i;
+    for (i = AllocProfile_GetReport(NULL, 0); i < ALLOC_PROFILE_MAX_SCOPES; i++)
+    {
+        (void)sprintf(name, "filler %u", (unsigned int)i);
+        ASSERT_IS_NOT_NULL(AllocProfile_GetScope(name));
+    }
+
+    ///act
+    ALLOC_PROFILE_SCOPE_HANDLE scope = AllocProfile_GetScope("one too many");
+
+    ///assert
+    ASSERT_IS_NULL(scope);
+    ASSERT_IS_NOT_NULL(AllocProfile_GetScope("filler 40"));
+}
+
+END_TEST_SUITE(alloc_profile_ut)
@@ -13,6 +13,8 @@
 #include "azure_c_shared_utility/singlylinkedlist.h"
 #include "message.h"
 #include "azure_c_shared_utility/threadapi.h"
+#include "module_thread.h"
+#include "worker_pool.h"
 #include "azure_c_shared_utility/uniqueid.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "nanomsg/nn.h"
@@ -86,8 +88,8 @@ static size_t whenShallCond_Init_fail;
 static size_t currentCond_Post_call;
 static size_t whenShallCond_Post_fail;
 
-static size_t currentThreadAPI_Create_call;
-static size_t whenShallThreadAPI_Create_fail;
+static size_t currentModuleThread_Create_call;
+static size_t whenShallModuleThread_Create_fail;
 
 static size_t nn_current_msg_size;
 
@@ -114,6 +116,13 @@ static void* nn_socket_memory[10];
 static THREAD_START_FUNC thread_func_to_call;
 static void* thread_func_args;
 
+static MODULE_THREAD_CONFIG current_thread_config;
+static WORKER_MAILBOX_RECEIVE mailbox_receive_to_call;
+static void* mailbox_receive_context;
+static MESSAGE_HANDLE mailbox_posted_message;
+static size_t currentWorkerPool_Create_call;
+static size_t whenShallWorkerPool_Create_fail;
+
 struct FakeModule_Receive_Call_Status
 {
     MODULE_HANDLE module;
@@ -309,11 +318,11 @@ public:
         size_t result2 = BASEIMPLEMENTATION::VECTOR_size(vector);
     MOCK_METHOD_END(size_t, result2)
 
-    MOCK_STATIC_METHOD_3(, THREADAPI_RESULT, ThreadAPI_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
+    MOCK_STATIC_METHOD_3(, THREADAPI_RESULT, ModuleThread_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
         THREADAPI_RESULT result2;
-        ++currentThreadAPI_Create_call;
-        if ((whenShallThreadAPI_Create_fail > 0) &&
-            (currentThreadAPI_Create_call == whenShallThreadAPI_Create_fail))
+        ++currentModuleThread_Create_call;
+        if ((whenShallModuleThread_Create_fail > 0) &&
+            (currentModuleThread_Create_call == whenShallModuleThread_Create_fail))
         {
             result2 = THREADAPI_ERROR;
         }
@@ -332,6 +341,41 @@ public:
         auto result2 = THREADAPI_OK;
     MOCK_METHOD_END(THREADAPI_RESULT, result2)
 
+    MOCK_STATIC_METHOD_0(, const MODULE_THREAD_CONFIG*, ModuleThread_GetCurrentConfig)
+    MOCK_METHOD_END(const MODULE_THREAD_CONFIG*, &current_thread_config)
+
+    MOCK_STATIC_METHOD_1(, WORKER_POOL_HANDLE, WorkerPool_Create, size_t, worker_count)
+        WORKER_POOL_HANDLE result2;
+        ++currentWorkerPool_Create_call;
+        if ((whenShallWorkerPool_Create_fail > 0) &&
+            (currentWorkerPool_Create_call == whenShallWorkerPool_Create_fail))
+        {
+            result2 = NULL;
+        }
+        else
+        {
+            result2 = (WORKER_POOL_HANDLE)malloc(1);
+        }
+    MOCK_METHOD_END(WORKER_POOL_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_1(, void, WorkerPool_Destroy, WORKER_POOL_HANDLE, pool)
+        free(pool);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_3(, WORKER_MAILBOX_HANDLE, WorkerMailbox_Create, WORKER_POOL_HANDLE, pool, WORKER_MAILBOX_RECEIVE, receive, void*, context)
+        mailbox_receive_to_call = receive;
+        mailbox_receive_context = context;
+        WORKER_MAILBOX_HANDLE result2 = (WORKER_MAILBOX_HANDLE)malloc(1);
+    MOCK_METHOD_END(WORKER_MAILBOX_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_2(, int, WorkerMailbox_Post, WORKER_MAILBOX_HANDLE, mailbox, MESSAGE_HANDLE, message)
+        mailbox_posted_message = message;
+    MOCK_METHOD_END(int, 0)
+
+    MOCK_STATIC_METHOD_1(, void, WorkerMailbox_Close, WORKER_MAILBOX_HANDLE, mailbox)
+        free(mailbox);
+    MOCK_VOID_METHOD_END()
+
     MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg)
         MESSAGE_HANDLE result2 = (MESSAGE_HANDLE)(new RefCountObject());
     MOCK_METHOD_END(MESSAGE_HANDLE, result2)
@@ -592,8 +636,15 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , void*, VECTOR_back, VECTOR_HANDLE,
 DECLARE_GLOBAL_MOCK_METHOD_3(CBrokerMocks, , void*, VECTOR_find_if, VECTOR_HANDLE, vector, PREDICATE_FUNCTION, pred, const void*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , size_t, VECTOR_size, VECTOR_HANDLE, vector);
 
-DECLARE_GLOBAL_MOCK_METHOD_3(CBrokerMocks, , THREADAPI_RESULT, ThreadAPI_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBrokerMocks, , THREADAPI_RESULT, ModuleThread_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBrokerMocks, , THREADAPI_RESULT, ThreadAPI_Join, THREAD_HANDLE, threadHandle, int*, res);
+DECLARE_GLOBAL_MOCK_METHOD_0(CBrokerMocks, , const MODULE_THREAD_CONFIG*, ModuleThread_GetCurrentConfig);
+
+DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , WORKER_POOL_HANDLE, WorkerPool_Create, size_t, worker_count);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , void, WorkerPool_Destroy, WORKER_POOL_HANDLE, pool);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBrokerMocks, , WORKER_MAILBOX_HANDLE, WorkerMailbox_Create, WORKER_POOL_HANDLE, pool, WORKER_MAILBOX_RECEIVE, receive, void*, context);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBrokerMocks, , int, WorkerMailbox_Post, WORKER_MAILBOX_HANDLE, mailbox, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , void, WorkerMailbox_Close, WORKER_MAILBOX_HANDLE, mailbox);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBrokerMocks, , MESSAGE_HANDLE, Message_Clone, MESSAGE_HANDLE, message);
@@ -688,8 +739,8 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     currentCond_Post_call = 0;
     whenShallCond_Post_fail = 0;
 
-    currentThreadAPI_Create_call = 0;
-    whenShallThreadAPI_Create_fail = 0;
+    currentModuleThread_Create_call = 0;
+    whenShallModuleThread_Create_fail = 0;
 
     current_nn_socket_index = 0;
     for (int l = 0; l < 10; l++)
@@ -702,6 +753,13 @@ TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
     thread_func_to_call = NULL;
     thread_func_args = NULL;
 
+    current_thread_config = MODULE_THREAD_CONFIG();
+    mailbox_receive_to_call = NULL;
+    mailbox_receive_context = NULL;
+    mailbox_posted_message = NULL;
+    currentWorkerPool_Create_call = 0;
+    whenShallWorkerPool_Create_fail = 0;
+
 
     call_status_for_FakeModule_Receive.messageHandle = NULL;
     call_status_for_FakeModule_Receive.module = NULL;
@@ -1498,7 +1556,7 @@ TEST_FUNCTION(Broker_AddModule_fails_when_nn_setSocketOpts_fails)
 }
 
 //Tests_SRS_BROKER_13_047: [This function shall return BROKER_ERROR if an underlying API call to the platform causes an error or BROKER_OK otherwise.]
-TEST_FUNCTION(Broker_AddModule_fails_when_ThreadAPI_Create_fails)
+TEST_FUNCTION(Broker_AddModule_fails_when_ModuleThread_Create_fails)
 {
     ///arrange
     CBrokerMocks mocks;
@@ -1545,8 +1603,8 @@ TEST_FUNCTION(Broker_AddModule_fails_when_ThreadAPI_Create_fails)
         .IgnoreArgument(4);
     STRICT_EXPECTED_CALL(mocks, nn_close(IGNORED_NUM_ARG))
         .IgnoreArgument(1);
-    whenShallThreadAPI_Create_fail = 1;
-    STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    whenShallModuleThread_Create_fail = 1;
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
 
     ///act
@@ -1567,7 +1625,7 @@ TEST_FUNCTION(Broker_AddModule_fails_when_ThreadAPI_Create_fails)
 //Tests_SRS_BROKER_17_014: [ The function shall bind the socket to the the BROKER_HANDLE_DATA::url. ]
 //Tests_SRS_BROKER_13_099: [ The function shall initialize BROKER_MODULEINFO::socket_lock with a valid lock handle. ]
 //Tests_SRS_BROKER_17_020: [ The function shall create a unique ID used as a quit signal. ]
-//Tests_SRS_BROKER_13_102 : [The function shall create a new thread for the module by calling ThreadAPI_Create using module_publish_worker as the thread callback and using the newly allocated BROKER_MODULEINFO object as the thread context.]
+//Tests_SRS_BROKER_13_102 : [The function shall create a new thread for the module by calling ModuleThread_Create using module_publish_worker as the thread callback and using the newly allocated BROKER_MODULEINFO object as the thread context.]
 //Tests_SRS_BROKER_13_039 : [This function shall acquire the lock on BROKER_HANDLE_DATA::modules_lock.]
 //Tests_SRS_BROKER_13_045 : [Broker_AddModule shall append the new instance of BROKER_MODULEINFO to BROKER_HANDLE_DATA::modules.]
 //Tests_SRS_BROKER_13_046 : [This function shall release the lock on BROKER_HANDLE_DATA::modules_lock.]
@@ -1608,7 +1666,7 @@ TEST_FUNCTION(Broker_AddModule_succeeds)
     STRICT_EXPECTED_CALL(mocks, nn_setsockopt(IGNORED_NUM_ARG, NN_SUB, NN_SUB_SUBSCRIBE, IGNORED_PTR_ARG, 36))
         .IgnoreArgument(1)
         .IgnoreArgument(4);
-    STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreAllArguments();
 
     ///act
@@ -3368,4 +3426,300 @@ TEST_FUNCTION(Broker_Publish_succeeds)
 }
 
 
+//Tests_SRS_BROKER_30_002: [ Otherwise Broker_CreateWithWorkerPool shall create the broker as Broker_Create does, then a worker pool of worker_count threads with WorkerPool_Create. ]
+TEST_FUNCTION(Broker_CreateWithWorkerPool_creates_a_worker_pool)
+{
+    ///arrange
+    CBrokerMocks mocks;
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_create());
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    STRICT_EXPECTED_CALL(mocks, nn_socket(AF_SP, NN_PUB));
+    STRICT_EXPECTED_CALL(mocks, UniqueId_Generate(IGNORED_PTR_ARG, 37))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_construct("inproc://"));
+    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, nn_bind(IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_Create(4));
+
+    ///act
+    auto r = Broker_CreateWithWorkerPool(4);
+
+    ///assert
+    ASSERT_IS_NOT_NULL(r);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    Broker_Destroy(r);
+}
+
+//Tests_SRS_BROKER_30_003: [ If the worker pool cannot be created, Broker_CreateWithWorkerPool shall destroy the broker and return NULL. ]
+TEST_FUNCTION(Broker_CreateWithWorkerPool_fails_when_WorkerPool_Create_fails)
+{
+    ///arrange
+    CBrokerMocks mocks;
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the structure*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_create());
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    STRICT_EXPECTED_CALL(mocks, nn_socket(AF_SP, NN_PUB));
+    STRICT_EXPECTED_CALL(mocks, UniqueId_Generate(IGNORED_PTR_ARG, 37))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_construct("inproc://"));
+    STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, nn_bind(IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    whenShallWorkerPool_Create_fail = 1;
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_Create(4));
+    STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, nn_close(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_get_head_item(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    auto r = Broker_CreateWithWorkerPool(4);
+
+    ///assert
+    ASSERT_IS_NULL(r);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+}
+
+//Tests_SRS_BROKER_30_004: [ On a broker with a worker pool, Broker_AddModule shall create a vector for the pooled modules linked to the module as a source. ]
+//Tests_SRS_BROKER_30_006: [ Otherwise Broker_AddModule shall create a mailbox for the module on the worker pool, and no thread or socket. ]
+TEST_FUNCTION(Broker_AddModule_with_worker_pool_creates_a_mailbox)
+{
+    ///arrange
+    CBrokerMocks mocks;
+    auto broker = Broker_CreateWithWorkerPool(2);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module_info*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    STRICT_EXPECTED_CALL(mocks, UniqueId_Generate(IGNORED_PTR_ARG, 37))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_construct(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_GetCurrentConfig());
+    STRICT_EXPECTED_CALL(mocks, WorkerMailbox_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    ///act
+    auto result = Broker_AddModule(broker, &fake_module);
+
+    ///assert
+    ASSERT_ARE_EQUAL(BROKER_RESULT, result, BROKER_OK);
+    ASSERT_IS_NOT_NULL((void*)mailbox_receive_to_call);
+    ASSERT_IS_NULL((void*)thread_func_to_call);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    Broker_RemoveModule(broker, &fake_module);
+    Broker_Destroy(broker);
+}
+
+//Tests_SRS_BROKER_30_005: [ On a broker with a worker pool, Broker_AddModule shall give the module a thread of its own if the current module thread configuration has dedicated_thread set. ]
+TEST_FUNCTION(Broker_AddModule_with_worker_pool_starts_a_thread_for_a_dedicated_module)
+{
+    ///arrange
+    CBrokerMocks mocks;
+    auto broker = Broker_CreateWithWorkerPool(2);
+    current_thread_config.dedicated_thread = true;
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module_info*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, Lock_Init());
+    STRICT_EXPECTED_CALL(mocks, UniqueId_Generate(IGNORED_PTR_ARG, 37))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_construct(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_GetCurrentConfig());
+    STRICT_EXPECTED_CALL(mocks, nn_socket(AF_SP, NN_SUB));
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, nn_connect(IGNORED_NUM_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, nn_setsockopt(IGNORED_NUM_ARG, NN_SUB, NN_SUB_SUBSCRIBE, IGNORED_PTR_ARG, 36))
+        .IgnoreArgument(1)
+        .IgnoreArgument(4);
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    ///act
+    auto result = Broker_AddModule(broker, &fake_module);
+
+    ///assert
+    ASSERT_ARE_EQUAL(BROKER_RESULT, result, BROKER_OK);
+    ASSERT_IS_NULL((void*)mailbox_receive_to_call);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    Broker_RemoveModule(broker, &fake_module);
+    Broker_Destroy(broker);
+}
+
+//Tests_SRS_BROKER_30_009: [ If the sink is a pooled module, Broker_AddLink shall add it to the pooled modules of the source, or count the link again if it is already there. ]
+//Tests_SRS_BROKER_30_011: [ On a broker with a worker pool, Broker_Publish shall post a clone of the message to the mailbox of every pooled module linked to source, without serializing it. ]
+//Tests_SRS_BROKER_30_012: [ On a broker with a worker pool, Broker_Publish shall only send the message on the publish_socket if a module has a thread of its own. ]
+//Tests_SRS_BROKER_30_007: [ The worker pool shall deliver the messages of a pooled module to its Module_Receive one at a time, in the order they were published. ]
+TEST_FUNCTION(Broker_Publish_with_worker_pool_posts_a_clone_to_the_linked_mailbox)
+{
+    ///arrange
+    CBrokerMocks mocks;
+    auto broker = Broker_CreateWithWorkerPool(2);
+
+    unsigned char fake;
+    MESSAGE_CONFIG c = { 1, &fake, (MAP_HANDLE)&fake };
+    auto message = Message_Create(&c);
+
+    auto result = Broker_AddModule(broker, &fake_module);
+    BROKER_LINK_DATA bld =
+    {
+        fake_module_handle,
+        fake_module_handle
+    };
+    result = Broker_AddLink(broker, &bld);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_find(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_item_get_value(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_item_get_value(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Message_Clone(message));
+    STRICT_EXPECTED_CALL(mocks, WorkerMailbox_Post(IGNORED_PTR_ARG, message))
+        .IgnoreArgument(1);
+
+    ///act
+    result = Broker_Publish(broker, fake_module_handle, message);
+
+    ///assert
+    ASSERT_ARE_EQUAL(BROKER_RESULT, result, BROKER_OK);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)message, (void*)mailbox_posted_message);
+    mocks.AssertActualAndExpectedCalls();
+
+    call_status_for_FakeModule_Receive.module = fake_module_handle;
+    mailbox_receive_to_call(mailbox_receive_context, mailbox_posted_message);
+    ASSERT_IS_TRUE(call_status_for_FakeModule_Receive.was_called);
+
+    ///cleanup
+    Message_Destroy(mailbox_posted_message);
+    Message_Destroy(message);
+    Broker_RemoveModule(broker, &fake_module);
+    Broker_Destroy(broker);
+}
+
+//Tests_SRS_BROKER_30_008: [ For a pooled module, Broker_RemoveModule shall remove the module from the pooled modules of every source and from BROKER_HANDLE_DATA::modules, then release the lock before it closes the mailbox with WorkerMailbox_Close. ]
+TEST_FUNCTION(Broker_RemoveModule_with_worker_pool_closes_the_mailbox)
+{
+    ///arrange
+    CBrokerMocks mocks;
+    auto broker = Broker_CreateWithWorkerPool(2);
+    auto result = Broker_AddModule(broker, &fake_module);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_find(IGNORED_PTR_ARG, IGNORED_PTR_ARG, &fake_module))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_item_get_value(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_item_get_value(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_get_head_item(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_item_get_value(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_get_next_item(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, singlylinkedlist_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, WorkerMailbox_Close(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    result = Broker_RemoveModule(broker, &fake_module);
+
+    ///assert
+    ASSERT_ARE_EQUAL(BROKER_RESULT, result, BROKER_OK);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    Broker_Destroy(broker);
+}
+
 END_TEST_SUITE(broker_ut)
@@ -13,6 +13,8 @@
 
 #include "gateway.h"
 #include "../src/gateway_internal.h"
+#include "module_thread.h"
+#include "worker_pool.h"
 #include <parson.h>
 
 #include "azure_c_shared_utility/vector_types_internal.h"
@@ -152,6 +154,27 @@ public:
         BASEIMPLEMENTATION::gballoc_free(string);
     MOCK_VOID_METHOD_END();
 
+    /*Module thread mocks*/
+
+    MOCK_STATIC_METHOD_2(, int, ModuleThreadConfig_ParseFromJson, const JSON_Object*, module_json, MODULE_THREAD_CONFIG**, config)
+        *config = NULL;
+    MOCK_METHOD_END(int, 0);
+
+    MOCK_STATIC_METHOD_1(, MODULE_THREAD_CONFIG*, ModuleThreadConfig_Clone, const MODULE_THREAD_CONFIG*, config)
+    MOCK_METHOD_END(MODULE_THREAD_CONFIG*, NULL);
+
+    MOCK_STATIC_METHOD_1(, void, ModuleThreadConfig_Destroy, MODULE_THREAD_CONFIG*, config)
+    MOCK_VOID_METHOD_END();
+
+    MOCK_STATIC_METHOD_1(, const MODULE_THREAD_CONFIG*, ModuleThread_SetCurrentConfig, const MODULE_THREAD_CONFIG*, config)
+    MOCK_METHOD_END(const MODULE_THREAD_CONFIG*, NULL);
+
+    /*Worker pool mocks*/
+
+    MOCK_STATIC_METHOD_2(, int, WorkerPool_ParseFromJson, const JSON_Value*, gateway_json, size_t*, worker_count)
+        *worker_count = 0;
+    MOCK_METHOD_END(int, 0);
+
     /*Gateway Mocks*/
 
     MOCK_STATIC_METHOD_2( , int, Gateway_RemoveModuleByName, GATEWAY_HANDLE, gw, const char *, module_name)
@@ -184,6 +207,11 @@ public:
         BROKER_HANDLE result1 = (BROKER_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
     MOCK_METHOD_END(BROKER_HANDLE, result1);
 
+    MOCK_STATIC_METHOD_1(, BROKER_HANDLE, Broker_CreateWithWorkerPool, size_t, worker_count)
+        ++currentBroker_ref_count;
+        BROKER_HANDLE result1 = (BROKER_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+    MOCK_METHOD_END(BROKER_HANDLE, result1);
+
     MOCK_STATIC_METHOD_1(, void, Broker_Destroy, BROKER_HANDLE, broker)
         if (currentBroker_ref_count > 0)
         {
@@ -380,6 +408,13 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , char*, json_serialize_to_string, c
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, json_value_free, JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, json_free_serialized_string, char*, string);
 
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , int, ModuleThreadConfig_ParseFromJson, const JSON_Object*, module_json, MODULE_THREAD_CONFIG**, config);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , MODULE_THREAD_CONFIG*, ModuleThreadConfig_Clone, const MODULE_THREAD_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, ModuleThreadConfig_Destroy, MODULE_THREAD_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , const MODULE_THREAD_CONFIG*, ModuleThread_SetCurrentConfig, const MODULE_THREAD_CONFIG*, config);
+
+DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , int, WorkerPool_ParseFromJson, const JSON_Value*, gateway_json, size_t*, worker_count);
+
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , void, Gateway_RemoveLink, GATEWAY_HANDLE, gw, const GATEWAY_LINK_ENTRY*, entryLink);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , GATEWAY_HANDLE, Gateway_Create, const GATEWAY_PROPERTIES*, properties);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, Gateway_Destroy, GATEWAY_HANDLE, gw);
@@ -387,6 +422,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , GATEWAY_START_RESULT, Gateway_Star
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayMocks, , int, Gateway_RemoveModuleByName, GATEWAY_HANDLE, gw, const char *, module_name);
 
 DECLARE_GLOBAL_MOCK_METHOD_0(CGatewayMocks, , BROKER_HANDLE, Broker_Create);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , BROKER_HANDLE, Broker_CreateWithWorkerPool, size_t, worker_count);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, Broker_Destroy, BROKER_HANDLE, broker);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, Broker_IncRef, BROKER_HANDLE, broker);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayMocks, , void, Broker_DecRef, BROKER_HANDLE, broker);
@@ -660,6 +696,8 @@ static void setup_parse_modules_entry(CGatewayMocks& mocks, size_t index, const
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
         .IgnoreArgument(1)
         .IgnoreArgument(2);
@@ -762,6 +800,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_Returns_NULL_on_gateway_create_internal_fai
     setup_links_entry(mocks, 0, "module1", "module2");
     setup_links_entry(mocks, 1, "module2", "module1");
 
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_HANDLE_DATA)))
         .SetFailReturn(nullptr);
 
@@ -800,6 +840,66 @@ TEST_FUNCTION(Gateway_CreateFromJson_Returns_NULL_on_gateway_create_internal_fai
 
 }
 
+/*Tests_SRS_GATEWAY_JSON_30_001: [ The function shall read the number of broker worker threads from the optional "broker" object with WorkerPool_ParseFromJson, and fail if it is malformed. ]*/
+TEST_FUNCTION(Gateway_CreateFromJson_Returns_NULL_on_WorkerPool_ParseFromJson_fail)
+{
+    //Arrange
+    CGatewayMocks mocks;
+
+    setup_2module_gw(mocks, (char *)VALID_JSON_PATH);
+
+    // modules array
+    setup_parse_modules_entry(mocks, 0, "module1");
+    setup_parse_modules_entry(mocks, 1, "module2");
+
+    // links entry
+    STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(GATEWAY_LINK_ENTRY)));
+    STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(2);
+
+    setup_links_entry(mocks, 0, "module1", "module2");
+    setup_links_entry(mocks, 1, "module2", "module1");
+
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments()
+        .SetFailReturn(1);
+
+    STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, json_free_serialized_string((char *)"[serialized string]"));
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, json_free_serialized_string((char *)"[serialized string]"));
+    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+	STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_FreeEntrypoint(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+        .IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_FreeEntrypoint(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleLoader_Destroy());
+
+
+    //Act
+    GATEWAY_HANDLE gateway = Gateway_CreateFromJson(VALID_JSON_PATH);
+
+    //Assert
+    ASSERT_IS_NULL(gateway);
+    mocks.AssertActualAndExpectedCalls();
+
+}
+
 /*Tests_SRS_GATEWAY_JSON_14_002: [The function shall use parson to read the file and parse the JSON string to a parson JSON_Value structure.]*/
 /*Tests_SRS_GATEWAY_JSON_17_005: [ The function shall parse the "loading args" for "module path" and fill a DYNAMIC_LOADER_CONFIG structure with the module path information. ]*/
 /*Tests_SRS_GATEWAY_JSON_14_004: [The function shall traverse the JSON_Value object to initialize a GATEWAY_PROPERTIES instance.]*/
@@ -835,6 +935,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_Parses_Valid_JSON_Configuration_File)
     setup_links_entry(mocks, 1, "module2", "module1");
 
 
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_HANDLE_DATA)));
     STRICT_EXPECTED_CALL(mocks, Broker_Create());
     STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(MODULE_DATA*)));
@@ -920,6 +1022,8 @@ TEST_FUNCTION(Gateway_Create_Start_fails_returns_null)
     setup_links_entry(mocks, 1, "module2", "module1");
 
 
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_HANDLE_DATA)));
     STRICT_EXPECTED_CALL(mocks, Broker_Create());
     STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(MODULE_DATA*)));
@@ -1108,6 +1212,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_Traverses_JSON_Push_Back_Fail)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
         .IgnoreArgument(1)
         .IgnoreArgument(2)
@@ -1144,6 +1250,74 @@ TEST_FUNCTION(Gateway_CreateFromJson_Traverses_JSON_Push_Back_Fail)
 
 }
 
+/*Tests_SRS_GATEWAY_JSON_29_001: [ The function shall parse the "cpu_affinity", "priority" and "thread_name" of each module with ModuleThreadConfig_ParseFromJson into its module_thread_config. ]*/
+/*Tests_SRS_GATEWAY_JSON_29_002: [ If ModuleThreadConfig_ParseFromJson fails, the function shall fail with PARSE_JSON_MISSING_OR_MISCONFIGURED_CONFIG. ]*/
+TEST_FUNCTION(Gateway_CreateFromJson_Thread_Config_Parse_Fail)
+{
+    //Arrange
+    CGatewayMocks mocks;
+
+    setup_2module_gw(mocks, (char *)VALID_JSON_PATH);
+
+    // modules array
+    setup_parse_modules_entry(mocks, 0, "module1");
+
+    STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 1))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "loader"))
+        .IgnoreArgument(1)
+        .SetReturn((JSON_Object*)0x42);
+    STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "name"))
+        .IgnoreArgument(1)
+        .SetReturn("loader1");
+    STRICT_EXPECTED_CALL(mocks, ModuleLoader_FindByName("loader1"));
+    STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "entrypoint"))
+        .IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_ParseEntrypointFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "name"))
+        .IgnoreArgument(1)
+        .SetReturn("Module2");
+    STRICT_EXPECTED_CALL(mocks, json_object_get_value(IGNORED_PTR_ARG, "args"))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments()
+        .SetFailReturn(__LINE__);
+
+    STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, json_free_serialized_string(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+	STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_FreeEntrypoint(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+        .IgnoreArgument(2);
+	STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_FreeEntrypoint(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleLoader_Destroy());
+
+    //Act
+    GATEWAY_HANDLE gateway = Gateway_CreateFromJson(VALID_JSON_PATH);
+
+    //Assert
+    ASSERT_IS_NULL(gateway);
+    mocks.AssertActualAndExpectedCalls();
+
+}
+
 /*Tests_SRS_GATEWAY_JSON_14_006: [The function shall return NULL if the JSON_Value contains incomplete information.]*/
 TEST_FUNCTION(Gateway_CreateFromJson_Traverses_JSON_Value_NULL_Modules_Array)
 {
@@ -1222,6 +1396,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_Traverses_JSON_Value_NULL_Loaders_Array_suc
     setup_links_entry(mocks, 0, "module1", "module2");
     setup_links_entry(mocks, 1, "module2", "module1");
 
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_HANDLE_DATA)));
     STRICT_EXPECTED_CALL(mocks, Broker_Create());
     STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(MODULE_DATA*)));
@@ -1505,6 +1681,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_uses_native_loader_when_loader_name_is_miss
     setup_links_entry(mocks, 0, "module1", "module2");
     setup_links_entry(mocks, 1, "module2", "module1");
 
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_HANDLE_DATA)));
     STRICT_EXPECTED_CALL(mocks, Broker_Create());
     STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(MODULE_DATA*)));
@@ -1634,6 +1812,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_fails_with_no_entry_point)
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(mocks, json_serialize_to_string(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
         .IgnoreArgument(1)
         .IgnoreArgument(2);
@@ -1650,6 +1830,8 @@ TEST_FUNCTION(Gateway_CreateFromJson_fails_with_no_entry_point)
     setup_links_entry(mocks, 1, "module2", "module1");
 
     // Create gateway until 1st module fails immediately
+    STRICT_EXPECTED_CALL(mocks, WorkerPool_ParseFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
     STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(GATEWAY_HANDLE_DATA)));
     STRICT_EXPECTED_CALL(mocks, Broker_Create());
     STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(MODULE_DATA*)));
@@ -154,6 +154,9 @@ BEGIN_TEST_SUITE(gateway_e2e)
         iotHubConfig.IoTHubName = IoTHubAccount_GetIoTHubName(g_iothubAcctInfo);
         iotHubConfig.IoTHubSuffix = IoTHubAccount_GetIoTHubSuffix(g_iothubAcctInfo);
         iotHubConfig.transportProvider = HTTP_Protocol;
+        iotHubConfig.store.enabled = false;
+        iotHubConfig.batch.enabled = false;
+        iotHubConfig.devices.max_clients = 0;
 
 
         E2EMODULE_CONFIG e2eModuleConfiguration;
@@ -182,6 +185,10 @@ BEGIN_TEST_SUITE(gateway_e2e)
                 ASSERT_FAIL("Could not push data into vector for identity map configuration.");
             }
         }
+
+        IDENTITY_MAP_MODULE_CONFIG e2eModuleMappingConfig;
+        e2eModuleMappingConfig.mapping = e2eModuleMappingVector;
+        e2eModuleMappingConfig.updateSource = NULL;
         
         GATEWAY_MODULES_ENTRY modules[3];
 		DYNAMIC_LOADER_ENTRYPOINT loader_info[3];
@@ -192,18 +199,21 @@ BEGIN_TEST_SUITE(gateway_e2e)
 		modules[0].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[0].moduleLibraryFileName = STRING_construct(iothub_module_path());
 		modules[0].module_loader_info.entrypoint = (void*)&(loader_info[0]);
+		modules[0].module_thread_config = NULL;
 
 		modules[1].module_name = GW_IDMAP_MODULE;
-		modules[1].module_configuration = e2eModuleMappingVector;
+		modules[1].module_configuration = &e2eModuleMappingConfig;
 		modules[1].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[1].moduleLibraryFileName = STRING_construct(identity_map_module_path());
 		modules[1].module_loader_info.entrypoint = (void*)&(loader_info[1]);
+		modules[1].module_thread_config = NULL;
 
 		modules[2].module_name = "E2ETest";
 		modules[2].module_configuration = &e2eModuleConfiguration;
 		modules[2].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[2].moduleLibraryFileName = STRING_construct(e2e_module_path());
 		modules[2].module_loader_info.entrypoint = (void*)&(loader_info[2]);
+		modules[2].module_thread_config = NULL;
 
         links[0].module_source = "E2ETest";
         links[0].module_sink = GW_IDMAP_MODULE;
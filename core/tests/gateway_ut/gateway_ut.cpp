@@ -13,6 +13,7 @@
 #include "broker.h"
 #include "experimental/event_system.h"
 #include "module_loader.h"
+#include "module_thread.h"
 
 #include "azure_c_shared_utility/vector_types_internal.h"
 #ifdef OUTPROCESS_ENABLED
@@ -76,6 +77,9 @@ static size_t whenShallVECTOR_find_if_fail;
 
 static MODULE_API_1 dummyAPIs;
 
+static MODULE_THREAD_CONFIG dummyThreadConfig = { 0, NULL, MODULE_THREAD_PRIORITY_HIGHEST, (char*)"module thread" };
+static MODULE_THREAD_CONFIG clonedThreadConfig = { 0, NULL, MODULE_THREAD_PRIORITY_HIGHEST, (char*)"module thread" };
+
 TYPED_MOCK_CLASS(CGatewayLLMocks, CGlobalMock)
 {
 public:
@@ -132,6 +136,11 @@ public:
     }
     MOCK_METHOD_END(BROKER_HANDLE, result1);
 
+    MOCK_STATIC_METHOD_1(, BROKER_HANDLE, Broker_CreateWithWorkerPool, size_t, worker_count)
+        ++currentBroker_ref_count;
+        BROKER_HANDLE result1 = (BROKER_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+    MOCK_METHOD_END(BROKER_HANDLE, result1);
+
     MOCK_STATIC_METHOD_1(, void, Broker_Destroy, BROKER_HANDLE, broker)
         if (currentBroker_ref_count > 0)
         {
@@ -330,6 +339,15 @@ public:
         (*destination) = (char*)malloc(strlen(source) + 1);
         strcpy(*destination, source);
     MOCK_METHOD_END(int, 0);
+
+    MOCK_STATIC_METHOD_1(, MODULE_THREAD_CONFIG*, ModuleThreadConfig_Clone, const MODULE_THREAD_CONFIG*, config)
+    MOCK_METHOD_END(MODULE_THREAD_CONFIG*, &clonedThreadConfig);
+
+    MOCK_STATIC_METHOD_1(, void, ModuleThreadConfig_Destroy, MODULE_THREAD_CONFIG*, config)
+    MOCK_VOID_METHOD_END();
+
+    MOCK_STATIC_METHOD_1(, const MODULE_THREAD_CONFIG*, ModuleThread_SetCurrentConfig, const MODULE_THREAD_CONFIG*, config)
+    MOCK_METHOD_END(const MODULE_THREAD_CONFIG*, NULL);
 };
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void*, mock_Module_ParseConfigurationFromJson, const char*, configuration);
@@ -339,7 +357,12 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, mock_Module_Destroy, MODUL
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , void, mock_Module_Receive, MODULE_HANDLE, moduleHandle, MESSAGE_HANDLE, messageHandle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, mock_Module_Start, MODULE_HANDLE, moduleHandle);
 
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , MODULE_THREAD_CONFIG*, ModuleThreadConfig_Clone, const MODULE_THREAD_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, ModuleThreadConfig_Destroy, MODULE_THREAD_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , const MODULE_THREAD_CONFIG*, ModuleThread_SetCurrentConfig, const MODULE_THREAD_CONFIG*, config);
+
 DECLARE_GLOBAL_MOCK_METHOD_0(CGatewayLLMocks, , BROKER_HANDLE, Broker_Create);
+DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , BROKER_HANDLE, Broker_CreateWithWorkerPool, size_t, worker_count);
 DECLARE_GLOBAL_MOCK_METHOD_1(CGatewayLLMocks, , void, Broker_Destroy, BROKER_HANDLE, broker);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , BROKER_RESULT, Broker_AddModule, BROKER_HANDLE, handle, const MODULE*, module);
 DECLARE_GLOBAL_MOCK_METHOD_2(CGatewayLLMocks, , BROKER_RESULT, Broker_RemoveModule, BROKER_HANDLE, handle, const MODULE*, module);
@@ -2084,6 +2107,123 @@ TEST_FUNCTION(Gateway_AddModule_Creates_Module_Using_Module_Properties)
     free(properties);
 }
 
+/*Tests_SRS_GATEWAY_29_001: [ If GATEWAY_MODULES_ENTRY's module_thread_config is not NULL, the function shall keep a copy of it with the module. ]*/
+/*Tests_SRS_GATEWAY_29_002: [ The function shall make the copy the current module thread configuration of the calling thread while it creates the module and attaches it to the broker, so that threads created with ModuleThread_Create use it. ]*/
+TEST_FUNCTION(Gateway_AddModule_makes_thread_config_current_while_creating_module)
+{
+    //Arrange
+    CGatewayLLMocks mocks;
+
+    GATEWAY_HANDLE gw = Gateway_Create(NULL);
+    mocks.ResetAllCalls();
+    bool* properties = (bool*)malloc(sizeof(bool));
+    *properties = true;
+    GATEWAY_MODULES_ENTRY entry = {
+        "Test module",
+        dummyLoaderInfo,
+        properties,
+        &dummyThreadConfig
+    };
+
+    //Expectations
+    STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_Load(IGNORED_PTR_ARG, dummyLoaderInfo.entrypoint))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_GetModuleApi(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_BuildModuleConfiguration(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_FreeModuleConfiguration(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_Clone(&dummyThreadConfig));
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_SetCurrentConfig(&clonedThreadConfig));
+    STRICT_EXPECTED_CALL(mocks, mock_Module_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, Broker_AddModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_SetCurrentConfig(NULL));
+    STRICT_EXPECTED_CALL(mocks, Broker_IncRef(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, EventSystem_ReportEvent(IGNORED_PTR_ARG, gw, GATEWAY_MODULE_LIST_CHANGED))
+        .IgnoreArgument(1);
+
+    //Act
+    MODULE_HANDLE handle = Gateway_AddModule(gw, &entry);
+
+    //Assert
+    ASSERT_IS_NOT_NULL(handle);
+    mocks.AssertActualAndExpectedCalls();
+
+    //Cleanup
+    Gateway_Destroy(gw);
+    free(properties);
+}
+
+/*Tests_SRS_GATEWAY_29_003: [ If the copy fails, the function shall not create the module and shall return NULL. ]*/
+TEST_FUNCTION(Gateway_AddModule_thread_config_clone_fails)
+{
+    //Arrange
+    CGatewayLLMocks mocks;
+
+    GATEWAY_HANDLE gw = Gateway_Create(NULL);
+    mocks.ResetAllCalls();
+    bool properties = true;
+    GATEWAY_MODULES_ENTRY entry = {
+        "Test module",
+        dummyLoaderInfo,
+        &properties,
+        &dummyThreadConfig
+    };
+
+    //Expectations
+    STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_Load(IGNORED_PTR_ARG, entry.module_loader_info.entrypoint))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_GetModuleApi(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_BuildModuleConfiguration(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_FreeModuleConfiguration(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_Clone(&dummyThreadConfig))
+        .SetFailReturn((MODULE_THREAD_CONFIG*)NULL);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_Unload(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+
+    //Act
+    MODULE_HANDLE handle = Gateway_AddModule(gw, &entry);
+
+    //Assert
+    ASSERT_IS_NULL(handle);
+    mocks.AssertActualAndExpectedCalls();
+
+    //Cleanup
+    Gateway_Destroy(gw);
+}
+
 /*Tests_SRS_GATEWAY_14_011: [ If gw, entry, or GATEWAY_MODULES_ENTRY's specified loader or entrypoint is NULL the function shall return NULL. ]*/
 TEST_FUNCTION(Gateway_AddModule_fails_on_null_loader_api)
 {
@@ -2375,6 +2515,57 @@ TEST_FUNCTION(Gateway_RemoveModule_Finds_Module_Data_Success)
     Gateway_Destroy(gw);
 }
 
+/*Tests_SRS_GATEWAY_29_005: [ The function shall free the module's copy of its thread configuration after destroying the module. ]*/
+TEST_FUNCTION(Gateway_RemoveModule_destroys_thread_config)
+{
+    //Arrange
+    CGatewayLLMocks mocks;
+    GATEWAY_HANDLE gw = Gateway_Create(NULL);
+    GATEWAY_MODULES_ENTRY entry = *(GATEWAY_MODULES_ENTRY*)BASEIMPLEMENTATION::VECTOR_front(dummyProps->gateway_modules);
+    entry.module_thread_config = &dummyThreadConfig;
+    MODULE_HANDLE handle = Gateway_AddModule(gw, &entry);
+    mocks.ResetAllCalls();
+
+    //Expectations
+    STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(mocks, Broker_RemoveModule(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, Broker_DecRef(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_GetModuleApi(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, mock_Module_Destroy(handle))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_Unload(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleThreadConfig_Destroy(&clonedThreadConfig));
+    STRICT_EXPECTED_CALL(mocks, VECTOR_erase(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(mocks, EventSystem_ReportEvent(IGNORED_PTR_ARG, gw, GATEWAY_MODULE_LIST_CHANGED))
+        .IgnoreArgument(1);
+    
+
+    //Act
+    Gateway_RemoveModule(gw, handle);
+
+    //Assert
+    mocks.AssertActualAndExpectedCalls();
+
+    //Cleanup
+    Gateway_Destroy(gw);
+}
+
 /*Tests_SRS_GATEWAY_14_023: [ The function shall locate the MODULE_DATA object in GATEWAY_HANDLE_DATA's modules containing module and return if it cannot be found. ]*/
 TEST_FUNCTION(Gateway_RemoveModule_Finds_Module_Data_Failure)
 {
@@ -5397,6 +5588,44 @@ TEST_FUNCTION(Gateway_StartModule_starts_module)
     free(properties);
 }
 
+//Tests_SRS_GATEWAY_29_004: [ If the module has a thread configuration, it shall be the current module thread configuration of the calling thread while Module_Start runs. ]
+TEST_FUNCTION(Gateway_StartModule_makes_thread_config_current_while_starting)
+{
+    //Arrange
+    CGatewayLLMocks mocks;
+
+    GATEWAY_HANDLE gw = Gateway_Create(NULL);
+    bool* properties = (bool*)malloc(sizeof(bool));
+    *properties = true;
+    GATEWAY_MODULES_ENTRY entry = {
+        "Test module",
+        dummyLoaderInfo,
+        properties,
+        &dummyThreadConfig
+    };
+    MODULE_HANDLE handle = Gateway_AddModule(gw, &entry);
+    mocks.ResetAllCalls();
+
+    STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, handle))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(mocks, DynamicModuleLoader_GetModuleApi(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .IgnoreArgument(2);
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_SetCurrentConfig(&clonedThreadConfig));
+    STRICT_EXPECTED_CALL(mocks, mock_Module_Start(handle));
+    STRICT_EXPECTED_CALL(mocks, ModuleThread_SetCurrentConfig(NULL));
+
+    //Act
+    Gateway_StartModule(gw, handle);
+
+    //Assert
+    mocks.AssertActualAndExpectedCalls();
+
+    //Cleanup
+    Gateway_Destroy(gw);
+    free(properties);
+}
+
 //Tests_SRS_GATEWAY_17_008: [ When module is found, if the Module_Start function is defined for this module, the Module_Start function shall be called. ]
 TEST_FUNCTION(Gateway_StartModule_no_start_for_null_start_func)
 {
@@ -0,0 +1,28 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct RECORDER_MODULE_CONFIG_TAG
+{
+    /* file the messages are appended to, shared with other recorders */
+    char * file;
+    /* name the messages are recorded under, usually the source module */
+    char * stream;
+} RECORDER_MODULE_CONFIG;
+
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(RECORDER_MODULE)(MODULE_API_VERSION gateway_api_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*RECORDER_H*/
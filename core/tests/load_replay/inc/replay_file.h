@@ -0,0 +1,91 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef REPLAY_FILE_H
+#define REPLAY_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "message.h"
+
+/*
+ * Recording file layout (all integers are unsigned LEB128 varints):
+ *
+ *   header  : "GWRP" <version byte = 1> <3 reserved zero bytes>
+ *   STREAM  : 0x01 <stream id> <name length> <name bytes>
+ *   MESSAGE : 0x02 <stream id> <microseconds since previous MESSAGE> <length> <message bytes>
+ *
+ * A STREAM record always precedes the first MESSAGE of that stream. Message
+ * bytes are the output of Message_ToByteArray.
+ */
+
+#define REPLAY_FILE_MAGIC "GWRP"
+#define REPLAY_FILE_VERSION 1
+#define REPLAY_RECORD_STREAM 0x01
+#define REPLAY_RECORD_MESSAGE 0x02
+
+/* property added by the replayer, microseconds since the system clock epoch */
+#define REPLAY_TIMESTAMP_PROPERTY "replay.timestamp"
+
+/* Appends messages from any number of recorders to one file. One writer is
+ * shared by every recorder that names the same file. */
+class ReplayWriter
+{
+public:
+    static std::shared_ptr<ReplayWriter> open(const std::string& path);
+    ~ReplayWriter();
+
+    uint32_t addStream(const std::string& name);
+    bool write(uint32_t stream, MESSAGE_HANDLE message);
+
+private:
+    explicit ReplayWriter(std::FILE* file);
+    void putVarint(uint64_t value);
+
+    std::mutex lock_;
+    std::FILE* file_;
+    uint32_t next_stream_;
+    bool has_previous_;
+    std::chrono::steady_clock::time_point previous_;
+    std::vector<unsigned char> buffer_;
+};
+
+struct ReplayRecord
+{
+    uint32_t stream;
+    /* microseconds since the first message of the recording */
+    uint64_t time_us;
+    std::vector<unsigned char> bytes;
+};
+
+/* Reads the messages of a recording in order. */
+class ReplayReader
+{
+public:
+    ReplayReader();
+    ~ReplayReader();
+
+    bool open(const std::string& path);
+    /* returns false at the end of the file or on a malformed record */
+    bool next(ReplayRecord& record);
+    const std::string& streamName(uint32_t stream) const;
+
+    /* reads a whole recording to list its streams and its duration */
+    static bool scan(const std::string& path, std::map<std::string, uint64_t>& messages_per_stream, uint64_t& duration_us);
+
+private:
+    bool getVarint(uint64_t& value);
+
+    std::FILE* file_;
+    uint64_t time_us_;
+    std::map<uint32_t, std::string> streams_;
+};
+
+#endif /*REPLAY_FILE_H*/
@@ -0,0 +1,28 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef REPLAY_PROBE_H
+#define REPLAY_PROBE_H
+
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct REPLAY_PROBE_MODULE_CONFIG_TAG
+{
+    /* name of the link being measured, for the report */
+    char * link;
+    /* optional file a JSON line with the link statistics is appended to */
+    char * report;
+} REPLAY_PROBE_MODULE_CONFIG;
+
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(REPLAY_PROBE_MODULE)(MODULE_API_VERSION gateway_api_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*REPLAY_PROBE_H*/
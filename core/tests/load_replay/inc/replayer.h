@@ -0,0 +1,30 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef REPLAYER_H
+#define REPLAYER_H
+
+#include "module.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct REPLAYER_MODULE_CONFIG_TAG
+{
+    /* recording to read */
+    char * file;
+    /* name of the recorded stream to publish */
+    char * stream;
+    /* replay speed factor, 0 publishes as fast as possible */
+    double speed;
+} REPLAYER_MODULE_CONFIG;
+
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(REPLAYER_MODULE)(MODULE_API_VERSION gateway_api_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*REPLAYER_H*/
@@ -0,0 +1,307 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <parson.h>
+
+#include "gateway.h"
+#include "azure_c_shared_utility/threadapi.h"
+
+#include "replay_file.h"
+
+#ifdef _WIN32
+#define PATH_SEPARATORS "\\/"
+#define MODULE_PREFIX ""
+#define MODULE_SUFFIX ".dll"
+#else
+#define PATH_SEPARATORS "/"
+#define MODULE_PREFIX "lib"
+#define MODULE_SUFFIX ".so"
+#endif
+
+#define DRAIN_TIME_IN_MS 1000
+
+/*the harness modules are built next to the executable*/
+static std::string module_path(const std::string& executable, const char* module)
+{
+    size_t separator = executable.find_last_of(PATH_SEPARATORS);
+    std::string directory = (separator == std::string::npos) ? "." : executable.substr(0, separator);
+    return directory + "/" + MODULE_PREFIX + module + MODULE_SUFFIX;
+}
+
+static JSON_Value* native_loader(const std::string& path)
+{
+    JSON_Value* loader = json_value_init_object();
+    JSON_Object* obj = json_value_get_object(loader);
+    (void)json_object_set_string(obj, "name", "native");
+    (void)json_object_set_value(obj, "entrypoint", json_value_init_object());
+    (void)json_object_set_string(json_object_get_object(obj, "entrypoint"), "module.path", path.c_str());
+    return loader;
+}
+
+static void add_module(JSON_Array* modules, const std::string& name, const std::string& path, JSON_Value* args)
+{
+    JSON_Value* module = json_value_init_object();
+    JSON_Object* obj = json_value_get_object(module);
+    (void)json_object_set_string(obj, "name", name.c_str());
+    (void)json_object_set_value(obj, "loader", native_loader(path));
+    (void)json_object_set_value(obj, "args", args);
+    (void)json_array_append_value(modules, module);
+}
+
+static void add_link(JSON_Array* links, const std::string& source, const std::string& sink)
+{
+    JSON_Value* link = json_value_init_object();
+    (void)json_object_set_string(json_value_get_object(link), "source", source.c_str());
+    (void)json_object_set_string(json_value_get_object(link), "sink", sink.c_str());
+    (void)json_array_append_value(links, link);
+}
+
+static JSON_Array* get_or_add_array(JSON_Object* root, const char* name)
+{
+    if (json_object_get_array(root, name) == NULL)
+    {
+        (void)json_object_set_value(root, name, json_value_init_array());
+    }
+    return json_object_get_array(root, name);
+}
+
+static JSON_Value* load_gateway_json(const std::string& path)
+{
+    JSON_Value* result = json_parse_file(path.c_str());
+    if (result == NULL || json_value_get_object(result) == NULL)
+    {
+        std::cout << "unable to parse " << path << std::endl;
+        json_value_free(result);
+        result = NULL;
+    }
+    return result;
+}
+
+/*the gateway loads its configuration from a file, so the rewritten one is kept next to the recording*/
+static int run_gateway(JSON_Value* json, const std::string& recording, unsigned int duration_in_ms)
+{
+    int result;
+    std::string path = recording + ".gateway.json";
+    if (json_serialize_to_file_pretty(json, path.c_str()) != JSONSuccess)
+    {
+        std::cout << "unable to write " << path << std::endl;
+        result = 1;
+    }
+    else
+    {
+        GATEWAY_HANDLE gateway = Gateway_CreateFromJson(path.c_str());
+        if (gateway == NULL)
+        {
+            std::cout << "failed to create the gateway from " << path << std::endl;
+            result = 1;
+        }
+        else
+        {
+            std::cout << "gateway shall run for " << duration_in_ms / 1000.0 << " seconds" << std::endl;
+            ThreadAPI_Sleep(duration_in_ms);
+            Gateway_Destroy(gateway);
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static int record(const std::string& executable, const std::vector<std::string>& args)
+{
+    int result;
+    JSON_Value* json = load_gateway_json(args[0]);
+    if (json == NULL)
+    {
+        result = 1;
+    }
+    else
+    {
+        const std::string& recording = args[1];
+        unsigned int duration_in_ms = (unsigned int)(std::stod(args[2]) * 1000);
+        JSON_Object* root = json_value_get_object(json);
+        JSON_Array* modules = get_or_add_array(root, "modules");
+        JSON_Array* links = get_or_add_array(root, "links");
+
+        for (size_t i = 3; i < args.size(); i++)
+        {
+            std::string recorder = args[i] + ".recorder";
+            JSON_Value* recorder_args = json_value_init_object();
+            (void)json_object_set_string(json_value_get_object(recorder_args), "file", recording.c_str());
+            (void)json_object_set_string(json_value_get_object(recorder_args), "stream", args[i].c_str());
+            add_module(modules, recorder, module_path(executable, "recorder"), recorder_args);
+            add_link(links, args[i], recorder);
+        }
+
+        result = run_gateway(json, recording, duration_in_ms);
+        json_value_free(json);
+    }
+    return result;
+}
+
+static int replay(const std::string& executable, const std::vector<std::string>& args)
+{
+    int result = 0;
+    double speed = 1.0;
+    double duration = -1;
+    std::string report;
+    std::set<std::string> replayed;
+
+    for (size_t i = 2; i < args.size() && result == 0; i++)
+    {
+        if ((args[i] == "--speed" || args[i] == "--duration" || args[i] == "--report") && i + 1 == args.size())
+        {
+            std::cout << args[i] << " needs a value" << std::endl;
+            result = 1;
+        }
+        else if (args[i] == "--speed")
+        {
+            speed = (args[++i] == "max") ? 0 : std::stod(args[i]);
+        }
+        else if (args[i] == "--duration")
+        {
+            duration = std::stod(args[++i]);
+        }
+        else if (args[i] == "--report")
+        {
+            report = args[++i];
+        }
+        else
+        {
+            replayed.insert(args[i]);
+        }
+    }
+
+    std::map<std::string, uint64_t> streams;
+    uint64_t recorded_us = 0;
+    JSON_Value* json = NULL;
+    if (result != 0)
+    {
+        /*already reported*/
+    }
+    else if (speed < 0)
+    {
+        std::cout << "--speed must be positive or max" << std::endl;
+        result = 1;
+    }
+    else if (!ReplayReader::scan(args[1], streams, recorded_us))
+    {
+        std::cout << "unable to read the recording " << args[1] << std::endl;
+        result = 1;
+    }
+    else if ((json = load_gateway_json(args[0])) == NULL)
+    {
+        result = 1;
+    }
+    else
+    {
+        if (replayed.empty())
+        {
+            for (auto& stream : streams)
+            {
+                replayed.insert(stream.first);
+            }
+        }
+
+        for (auto& stream : streams)
+        {
+            std::cout << "recording has " << stream.second << " messages from " << stream.first << std::endl;
+        }
+
+        JSON_Object* root = json_value_get_object(json);
+        JSON_Array* modules = get_or_add_array(root, "modules");
+        JSON_Array* links = get_or_add_array(root, "links");
+
+        /*replayers take the name of the module they stand in for, so the links do not change*/
+        std::set<std::string> found;
+        for (size_t i = 0; i < json_array_get_count(modules); i++)
+        {
+            JSON_Object* module = json_array_get_object(modules, i);
+            const char* name = json_object_get_string(module, "name");
+            if (name != NULL && replayed.count(name) != 0)
+            {
+                JSON_Value* replayer_args = json_value_init_object();
+                (void)json_object_set_string(json_value_get_object(replayer_args), "file", args[1].c_str());
+                (void)json_object_set_string(json_value_get_object(replayer_args), "stream", name);
+                (void)json_object_set_number(json_value_get_object(replayer_args), "speed", speed);
+                (void)json_object_set_value(module, "loader", native_loader(module_path(executable, "replayer")));
+                (void)json_object_set_value(module, "args", replayer_args);
+                found.insert(name);
+            }
+        }
+
+        for (auto& name : replayed)
+        {
+            if (found.count(name) == 0)
+            {
+                std::cout << name << " is not a module of " << args[0] << std::endl;
+                result = 1;
+            }
+        }
+
+        if (result == 0)
+        {
+            /*every link out of a replayed module gets a probe beside its sink*/
+            size_t link_count = json_array_get_count(links);
+            for (size_t i = 0; i < link_count; i++)
+            {
+                JSON_Object* link = json_array_get_object(links, i);
+                const char* source = json_object_get_string(link, "source");
+                const char* sink = json_object_get_string(link, "sink");
+                if (source != NULL && sink != NULL && replayed.count(source) != 0)
+                {
+                    std::string name = std::string(source) + "->" + sink;
+                    std::string probe = name + ".probe";
+                    JSON_Value* probe_args = json_value_init_object();
+                    (void)json_object_set_string(json_value_get_object(probe_args), "link", name.c_str());
+                    if (!report.empty())
+                    {
+                        (void)json_object_set_string(json_value_get_object(probe_args), "report", report.c_str());
+                    }
+                    add_module(modules, probe, module_path(executable, "replay_probe"), probe_args);
+                    add_link(links, source, probe);
+                }
+            }
+
+            if (duration < 0)
+            {
+                duration = (speed > 0) ? (recorded_us / 1e6) / speed : recorded_us / 1e6;
+            }
+            result = run_gateway(json, args[1], (unsigned int)(duration * 1000) + DRAIN_TIME_IN_MS);
+        }
+        json_value_free(json);
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    std::vector<std::string> args(argv + (argc > 2 ? 2 : argc), argv + argc);
+    std::string command = (argc > 1) ? argv[1] : "";
+
+    if (command == "record" && args.size() >= 4)
+    {
+        result = record(argv[0], args);
+    }
+    else if (command == "replay" && args.size() >= 2)
+    {
+        result = replay(argv[0], args);
+    }
+    else
+    {
+        std::cout
+            << "usage: gateway_replay record configFile recording duration module..." << std::endl
+            << "       gateway_replay replay configFile recording [--speed factor|max] [--duration seconds] [--report file] [module...]" << std::endl
+            << "where record runs the gateway for duration seconds and saves every message published by each module to recording" << std::endl
+            << "where replay swaps the modules (by default every module in the recording) for replayers that publish the recorded messages" << std::endl
+            << "      on their original schedule, scaled by --speed, and reports throughput and latency for every link out of them" << std::endl;
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,177 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <memory>
+#include <string>
+
+#include <parson.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "message.h"
+#include "module.h"
+
+#include "replay_file.h"
+#include "recorder.h"
+
+typedef struct RECORDER_MODULE_HANDLE_TAG
+{
+    std::shared_ptr<ReplayWriter> writer;
+    uint32_t stream;
+    std::string stream_name;
+    size_t messages_recorded;
+    size_t messages_failed;
+} RECORDER_MODULE_HANDLE;
+
+static void* RecorderModule_ParseConfigurationFromJson(const char* configuration)
+{
+    RECORDER_MODULE_CONFIG * result;
+    if (configuration == NULL)
+    {
+        LogError("Recorder module expects configuration");
+        result = NULL;
+    }
+    else
+    {
+        JSON_Value* json = json_parse_string((const char*)configuration);
+        if (json == NULL)
+        {
+            LogError("unable to json_parse_string");
+            result = NULL;
+        }
+        else
+        {
+            JSON_Object* obj = json_value_get_object(json);
+            const char* file = (obj == NULL) ? NULL : json_object_get_string(obj, "file");
+            const char* stream = (obj == NULL) ? NULL : json_object_get_string(obj, "stream");
+            if (file == NULL || stream == NULL)
+            {
+                LogError("file and stream are required fields in configuration");
+                result = NULL;
+            }
+            else
+            {
+                result = (RECORDER_MODULE_CONFIG *)malloc(sizeof(RECORDER_MODULE_CONFIG));
+                if (result == NULL)
+                {
+                    LogError("Could not allocate configuration");
+                }
+                else
+                {
+                    result->file = NULL;
+                    result->stream = NULL;
+                    if (mallocAndStrcpy_s(&(result->file), file) != 0 ||
+                        mallocAndStrcpy_s(&(result->stream), stream) != 0)
+                    {
+                        LogError("could not copy configuration strings");
+                        free(result->file);
+                        free(result);
+                        result = NULL;
+                    }
+                }
+            }
+            json_value_free(json);
+        }
+    }
+    return result;
+}
+
+static void RecorderModule_FreeConfiguration(void* configuration)
+{
+    if (configuration != NULL)
+    {
+        RECORDER_MODULE_CONFIG * conf = (RECORDER_MODULE_CONFIG*)configuration;
+        free(conf->file);
+        free(conf->stream);
+        free(conf);
+    }
+}
+
+static MODULE_HANDLE RecorderModule_Create(BROKER_HANDLE broker, const void* configuration)
+{
+    RECORDER_MODULE_HANDLE * module;
+    if ((broker == NULL) ||
+        (configuration == NULL))
+    {
+        LogError("Recorder had a null input. broker: [%p], configuration: [%p]", broker, configuration);
+        module = NULL;
+    }
+    else
+    {
+        const RECORDER_MODULE_CONFIG * conf = (const RECORDER_MODULE_CONFIG *)configuration;
+        std::shared_ptr<ReplayWriter> writer = ReplayWriter::open(conf->file);
+        if (!writer)
+        {
+            LogError("unable to open recording %s", conf->file);
+            module = NULL;
+        }
+        else
+        {
+            module = new RECORDER_MODULE_HANDLE();
+            module->writer = writer;
+            module->stream = writer->addStream(conf->stream);
+            module->stream_name = conf->stream;
+            module->messages_recorded = 0;
+            module->messages_failed = 0;
+        }
+    }
+    return module;
+}
+
+static void RecorderModule_Destroy(MODULE_HANDLE moduleHandle)
+{
+    if (moduleHandle == NULL)
+    {
+        LogError("Destroying a NULL module");
+    }
+    else
+    {
+        RECORDER_MODULE_HANDLE * module = (RECORDER_MODULE_HANDLE *)moduleHandle;
+        LogInfo("recorded %zu messages from %s (%zu failed)", module->messages_recorded, module->stream_name.c_str(), module->messages_failed);
+        /*the last recorder to go closes the file*/
+        delete module;
+    }
+}
+
+static void RecorderModule_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    if (moduleHandle == NULL || messageHandle == NULL)
+    {
+        LogError("Received NULL input. module: [%p], message: [%p]", moduleHandle, messageHandle);
+    }
+    else
+    {
+        RECORDER_MODULE_HANDLE * module = (RECORDER_MODULE_HANDLE *)moduleHandle;
+        if (module->writer->write(module->stream, messageHandle))
+        {
+            module->messages_recorded++;
+        }
+        else
+        {
+            module->messages_failed++;
+        }
+    }
+}
+
+static const MODULE_API_1 RECORDER_APIS_all =
+{
+    {MODULE_API_VERSION_1},
+
+    RecorderModule_ParseConfigurationFromJson,
+    RecorderModule_FreeConfiguration,
+    RecorderModule_Create,
+    RecorderModule_Destroy,
+    RecorderModule_Receive,
+    NULL
+};
+
+#ifdef BUILD_MODULE_TYPE_STATIC
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(RECORDER_MODULE)(MODULE_API_VERSION gateway_api_version)
+#else
+MODULE_EXPORT const MODULE_API* Module_GetApi(MODULE_API_VERSION gateway_api_version)
+#endif
+{
+    (void)gateway_api_version;
+    return reinterpret_cast< const MODULE_API *>(&RECORDER_APIS_all);
+}
@@ -0,0 +1,261 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <cstring>
+
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "replay_file.h"
+
+#define REPLAY_FILE_HEADER_SIZE 8
+#define REPLAY_WRITE_BUFFER_SIZE (1024 * 1024)
+
+static std::mutex writers_lock;
+static std::map<std::string, std::weak_ptr<ReplayWriter>> writers;
+
+std::shared_ptr<ReplayWriter> ReplayWriter::open(const std::string& path)
+{
+    std::shared_ptr<ReplayWriter> result;
+    std::lock_guard<std::mutex> guard(writers_lock);
+    auto existing = writers.find(path);
+    if (existing != writers.end())
+    {
+        result = existing->second.lock();
+    }
+
+    if (!result)
+    {
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == NULL)
+        {
+            LogError("unable to create recording file %s", path.c_str());
+        }
+        else
+        {
+            const unsigned char header[REPLAY_FILE_HEADER_SIZE] = { 'G', 'W', 'R', 'P', REPLAY_FILE_VERSION, 0, 0, 0 };
+            (void)std::setvbuf(file, NULL, _IOFBF, REPLAY_WRITE_BUFFER_SIZE);
+            if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header))
+            {
+                LogError("unable to write the header of %s", path.c_str());
+                std::fclose(file);
+            }
+            else
+            {
+                result.reset(new ReplayWriter(file));
+                writers[path] = result;
+            }
+        }
+    }
+    return result;
+}
+
+ReplayWriter::ReplayWriter(std::FILE* file) :
+    file_(file),
+    next_stream_(0),
+    has_previous_(false)
+{
+}
+
+ReplayWriter::~ReplayWriter()
+{
+    std::fclose(file_);
+}
+
+void ReplayWriter::putVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        std::fputc((int)((value & 0x7F) | 0x80), file_);
+        value >>= 7;
+    }
+    std::fputc((int)value, file_);
+}
+
+uint32_t ReplayWriter::addStream(const std::string& name)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    uint32_t result = next_stream_++;
+    std::fputc(REPLAY_RECORD_STREAM, file_);
+    putVarint(result);
+    putVarint(name.size());
+    (void)std::fwrite(name.data(), 1, name.size(), file_);
+    return result;
+}
+
+bool ReplayWriter::write(uint32_t stream, MESSAGE_HANDLE message)
+{
+    bool result;
+    int32_t size = Message_ToByteArray(message, NULL, 0);
+    if (size <= 0)
+    {
+        LogError("unable to serialize message");
+        result = false;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        auto now = std::chrono::steady_clock::now();
+        uint64_t delta_us = has_previous_ ?
+            (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - previous_).count() :
+            0;
+        previous_ = now;
+        has_previous_ = true;
+
+        if (buffer_.size() < (size_t)size)
+        {
+            buffer_.resize((size_t)size);
+        }
+        if (Message_ToByteArray(message, buffer_.data(), size) != size)
+        {
+            LogError("unable to serialize message");
+            result = false;
+        }
+        else
+        {
+            std::fputc(REPLAY_RECORD_MESSAGE, file_);
+            putVarint(stream);
+            putVarint(delta_us);
+            putVarint((uint64_t)size);
+            result = (std::fwrite(buffer_.data(), 1, (size_t)size, file_) == (size_t)size);
+        }
+    }
+    return result;
+}
+
+ReplayReader::ReplayReader() :
+    file_(NULL),
+    time_us_(0)
+{
+}
+
+ReplayReader::~ReplayReader()
+{
+    if (file_ != NULL)
+    {
+        std::fclose(file_);
+    }
+}
+
+bool ReplayReader::open(const std::string& path)
+{
+    bool result;
+    unsigned char header[REPLAY_FILE_HEADER_SIZE];
+    file_ = std::fopen(path.c_str(), "rb");
+    if (file_ == NULL)
+    {
+        LogError("unable to open recording file %s", path.c_str());
+        result = false;
+    }
+    else if (std::fread(header, 1, sizeof(header), file_) != sizeof(header) ||
+        std::memcmp(header, REPLAY_FILE_MAGIC, 4) != 0 ||
+        header[4] != REPLAY_FILE_VERSION)
+    {
+        LogError("%s is not a recording", path.c_str());
+        result = false;
+    }
+    else
+    {
+        result = true;
+    }
+    return result;
+}
+
+bool ReplayReader::getVarint(uint64_t& value)
+{
+    bool result = false;
+    int shift = 0;
+    int c;
+    value = 0;
+    while (shift < 64 && (c = std::fgetc(file_)) != EOF)
+    {
+        value |= (uint64_t)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0)
+        {
+            result = true;
+            break;
+        }
+        shift += 7;
+    }
+    return result;
+}
+
+bool ReplayReader::next(ReplayRecord& record)
+{
+    bool result = false;
+    int type;
+    while (file_ != NULL && (type = std::fgetc(file_)) != EOF)
+    {
+        uint64_t stream;
+        uint64_t length;
+        if (type == REPLAY_RECORD_STREAM)
+        {
+            if (!getVarint(stream) || !getVarint(length))
+            {
+                LogError("truncated stream record");
+                break;
+            }
+            std::string name((size_t)length, '\0');
+            if (length > 0 && std::fread(&name[0], 1, (size_t)length, file_) != length)
+            {
+                LogError("truncated stream record");
+                break;
+            }
+            streams_[(uint32_t)stream] = name;
+        }
+        else if (type == REPLAY_RECORD_MESSAGE)
+        {
+            uint64_t delta_us;
+            if (!getVarint(stream) || !getVarint(delta_us) || !getVarint(length))
+            {
+                LogError("truncated message record");
+                break;
+            }
+            record.bytes.resize((size_t)length);
+            if (length > 0 && std::fread(record.bytes.data(), 1, (size_t)length, file_) != length)
+            {
+                LogError("truncated message record");
+                break;
+            }
+            time_us_ += delta_us;
+            record.stream = (uint32_t)stream;
+            record.time_us = time_us_;
+            result = true;
+            break;
+        }
+        else
+        {
+            LogError("unknown record type %d", type);
+            break;
+        }
+    }
+    return result;
+}
+
+const std::string& ReplayReader::streamName(uint32_t stream) const
+{
+    static const std::string unknown;
+    auto found = streams_.find(stream);
+    return (found == streams_.end()) ? unknown : found->second;
+}
+
+bool ReplayReader::scan(const std::string& path, std::map<std::string, uint64_t>& messages_per_stream, uint64_t& duration_us)
+{
+    bool result;
+    ReplayReader reader;
+    if (!reader.open(path))
+    {
+        result = false;
+    }
+    else
+    {
+        ReplayRecord record;
+        duration_us = 0;
+        while (reader.next(record))
+        {
+            messages_per_stream[reader.streamName(record.stream)]++;
+            duration_us = record.time_us;
+        }
+        result = true;
+    }
+    return result;
+}
@@ -0,0 +1,289 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <parson.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/constmap.h"
+#include "message.h"
+#include "module.h"
+
+#include "replay_file.h"
+#include "replay_probe.h"
+
+/*latencies are binned per power of two, each split into 2^SUB_BUCKET_BITS linear steps (about 12% wide)*/
+#define SUB_BUCKET_BITS 3
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+#define HISTOGRAM_BUCKETS (64 * SUB_BUCKETS)
+
+typedef struct REPLAY_PROBE_MODULE_HANDLE_TAG
+{
+    std::string link;
+    std::string report;
+    size_t messages_received;
+    size_t messages_unstamped;
+    unsigned long long latency_sum_us;
+    unsigned long long latency_max_us;
+    long long first_receive_us;
+    long long last_receive_us;
+    unsigned long long histogram[HISTOGRAM_BUCKETS];
+} REPLAY_PROBE_MODULE_HANDLE;
+
+static size_t bucket_of(unsigned long long value)
+{
+    size_t result;
+    if (value < SUB_BUCKETS)
+    {
+        result = (size_t)value;
+    }
+    else
+    {
+        int msb = 63;
+        while ((value >> msb) == 0)
+        {
+            msb--;
+        }
+        result = (size_t)((msb - SUB_BUCKET_BITS + 1) * SUB_BUCKETS) + (size_t)((value >> (msb - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    }
+    return result;
+}
+
+/*returns the upper bound of a bucket, so percentiles err on the slow side*/
+static unsigned long long bucket_limit(size_t bucket)
+{
+    unsigned long long result;
+    if (bucket < SUB_BUCKETS)
+    {
+        result = bucket;
+    }
+    else
+    {
+        int msb = (int)(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+        unsigned long long step = 1ULL << (msb - SUB_BUCKET_BITS);
+        result = (1ULL << msb) + (bucket % SUB_BUCKETS) * step + step - 1;
+    }
+    return result;
+}
+
+static unsigned long long percentile(const REPLAY_PROBE_MODULE_HANDLE * module, double fraction)
+{
+    unsigned long long result = 0;
+    unsigned long long rank = (unsigned long long)(fraction * module->messages_received);
+    unsigned long long seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += module->histogram[i];
+        if (seen > rank)
+        {
+            result = bucket_limit(i);
+            break;
+        }
+    }
+    return (result > module->latency_max_us) ? module->latency_max_us : result;
+}
+
+static void* ReplayProbeModule_ParseConfigurationFromJson(const char* configuration)
+{
+    REPLAY_PROBE_MODULE_CONFIG * result;
+    if (configuration == NULL)
+    {
+        LogError("Replay probe module expects configuration");
+        result = NULL;
+    }
+    else
+    {
+        JSON_Value* json = json_parse_string((const char*)configuration);
+        if (json == NULL)
+        {
+            LogError("unable to json_parse_string");
+            result = NULL;
+        }
+        else
+        {
+            JSON_Object* obj = json_value_get_object(json);
+            const char* link = (obj == NULL) ? NULL : json_object_get_string(obj, "link");
+            const char* report = (obj == NULL) ? NULL : json_object_get_string(obj, "report");
+            if (link == NULL)
+            {
+                LogError("link is a required field in configuration");
+                result = NULL;
+            }
+            else
+            {
+                result = (REPLAY_PROBE_MODULE_CONFIG *)malloc(sizeof(REPLAY_PROBE_MODULE_CONFIG));
+                if (result == NULL)
+                {
+                    LogError("Could not allocate configuration");
+                }
+                else
+                {
+                    result->link = NULL;
+                    result->report = NULL;
+                    if (mallocAndStrcpy_s(&(result->link), link) != 0 ||
+                        (report != NULL && mallocAndStrcpy_s(&(result->report), report) != 0))
+                    {
+                        LogError("could not copy configuration strings");
+                        free(result->link);
+                        free(result);
+                        result = NULL;
+                    }
+                }
+            }
+            json_value_free(json);
+        }
+    }
+    return result;
+}
+
+static void ReplayProbeModule_FreeConfiguration(void* configuration)
+{
+    if (configuration != NULL)
+    {
+        REPLAY_PROBE_MODULE_CONFIG * conf = (REPLAY_PROBE_MODULE_CONFIG*)configuration;
+        free(conf->link);
+        free(conf->report);
+        free(conf);
+    }
+}
+
+static MODULE_HANDLE ReplayProbeModule_Create(BROKER_HANDLE broker, const void* configuration)
+{
+    REPLAY_PROBE_MODULE_HANDLE * module;
+    if ((broker == NULL) ||
+        (configuration == NULL))
+    {
+        LogError("Replay probe had a null input. broker: [%p], configuration: [%p]", broker, configuration);
+        module = NULL;
+    }
+    else
+    {
+        const REPLAY_PROBE_MODULE_CONFIG * conf = (const REPLAY_PROBE_MODULE_CONFIG *)configuration;
+        module = new REPLAY_PROBE_MODULE_HANDLE();
+        module->link = conf->link;
+        module->report = (conf->report == NULL) ? "" : conf->report;
+        module->messages_received = 0;
+        module->messages_unstamped = 0;
+        module->latency_sum_us = 0;
+        module->latency_max_us = 0;
+        module->first_receive_us = 0;
+        module->last_receive_us = 0;
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+        {
+            module->histogram[i] = 0;
+        }
+    }
+    return module;
+}
+
+static void ReplayProbeModule_Destroy(MODULE_HANDLE moduleHandle)
+{
+    if (moduleHandle == NULL)
+    {
+        LogError("Destroying a NULL module");
+    }
+    else
+    {
+        REPLAY_PROBE_MODULE_HANDLE * module = (REPLAY_PROBE_MODULE_HANDLE *)moduleHandle;
+        double seconds = (module->last_receive_us - module->first_receive_us) / 1e6;
+        double mean = (module->messages_received == 0) ? 0.0 : (double)module->latency_sum_us / module->messages_received;
+        double rate = (seconds > 0) ? module->messages_received / seconds : 0.0;
+        unsigned long long p50 = percentile(module, 0.50);
+        unsigned long long p99 = percentile(module, 0.99);
+
+        printf("link %-40s %10zu messages %10.1f msg/s latency us: mean %10.1f p50 %8llu p99 %8llu max %8llu\n",
+            module->link.c_str(), module->messages_received, rate, mean, p50, p99, module->latency_max_us);
+        if (module->messages_unstamped > 0)
+        {
+            LogInfo("%s received %zu messages without a replay timestamp", module->link.c_str(), module->messages_unstamped);
+        }
+
+        if (!module->report.empty())
+        {
+            FILE* report = fopen(module->report.c_str(), "a");
+            if (report == NULL)
+            {
+                LogError("unable to open report file %s", module->report.c_str());
+            }
+            else
+            {
+                fprintf(report,
+                    "{\"link\": \"%s\", \"messages\": %zu, \"messages_per_second\": %.1f, "
+                    "\"latency_us\": {\"mean\": %.1f, \"p50\": %llu, \"p99\": %llu, \"max\": %llu}}\n",
+                    module->link.c_str(), module->messages_received, rate, mean, p50, p99, module->latency_max_us);
+                fclose(report);
+            }
+        }
+        delete module;
+    }
+}
+
+static void ReplayProbeModule_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    if (moduleHandle == NULL || messageHandle == NULL)
+    {
+        LogError("Received NULL input. module: [%p], message: [%p]", moduleHandle, messageHandle);
+    }
+    else
+    {
+        REPLAY_PROBE_MODULE_HANDLE * module = (REPLAY_PROBE_MODULE_HANDLE *)moduleHandle;
+        auto now = std::chrono::time_point_cast<std::chrono::microseconds>(std::chrono::system_clock::now());
+        long long now_us = now.time_since_epoch().count();
+        CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
+        const char* stamp = (properties == NULL) ? NULL : ConstMap_GetValue(properties, REPLAY_TIMESTAMP_PROPERTY);
+        if (stamp == NULL)
+        {
+            module->messages_unstamped++;
+        }
+        else
+        {
+            long long sent_us = strtoll(stamp, NULL, 10);
+            unsigned long long latency = (now_us > sent_us) ? (unsigned long long)(now_us - sent_us) : 0;
+            if (module->messages_received == 0)
+            {
+                module->first_receive_us = now_us;
+            }
+            module->last_receive_us = now_us;
+            module->messages_received++;
+            module->latency_sum_us += latency;
+            if (latency > module->latency_max_us)
+            {
+                module->latency_max_us = latency;
+            }
+            module->histogram[bucket_of(latency)]++;
+        }
+
+        if (properties != NULL)
+        {
+            ConstMap_Destroy(properties);
+        }
+    }
+}
+
+static const MODULE_API_1 REPLAY_PROBE_APIS_all =
+{
+    {MODULE_API_VERSION_1},
+
+    ReplayProbeModule_ParseConfigurationFromJson,
+    ReplayProbeModule_FreeConfiguration,
+    ReplayProbeModule_Create,
+    ReplayProbeModule_Destroy,
+    ReplayProbeModule_Receive,
+    NULL
+};
+
+#ifdef BUILD_MODULE_TYPE_STATIC
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(REPLAY_PROBE_MODULE)(MODULE_API_VERSION gateway_api_version)
+#else
+MODULE_EXPORT const MODULE_API* Module_GetApi(MODULE_API_VERSION gateway_api_version)
+#endif
+{
+    (void)gateway_api_version;
+    return reinterpret_cast< const MODULE_API *>(&REPLAY_PROBE_APIS_all);
+}
@@ -0,0 +1,329 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <chrono>
+#include <string>
+
+#include <parson.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/constmap.h"
+#include "message.h"
+#include "module.h"
+#include "broker.h"
+
+#include "replay_file.h"
+#include "replayer.h"
+
+using SteadyClock = std::chrono::steady_clock;
+using MicroSeconds = std::chrono::microseconds;
+
+typedef struct REPLAYER_MODULE_HANDLE_TAG
+{
+    BROKER_HANDLE broker;
+    std::string file;
+    std::string stream;
+    double speed;
+    volatile bool thread_flag;
+    THREAD_HANDLE main_thread;
+    size_t messages_published;
+    long long max_lag_us;
+    long long elapsed_us;
+} REPLAYER_MODULE_HANDLE;
+
+static void* ReplayerModule_ParseConfigurationFromJson(const char* configuration)
+{
+    REPLAYER_MODULE_CONFIG * result;
+    if (configuration == NULL)
+    {
+        LogError("Replayer module expects configuration");
+        result = NULL;
+    }
+    else
+    {
+        JSON_Value* json = json_parse_string((const char*)configuration);
+        if (json == NULL)
+        {
+            LogError("unable to json_parse_string");
+            result = NULL;
+        }
+        else
+        {
+            JSON_Object* obj = json_value_get_object(json);
+            const char* file = (obj == NULL) ? NULL : json_object_get_string(obj, "file");
+            const char* stream = (obj == NULL) ? NULL : json_object_get_string(obj, "stream");
+            if (file == NULL || stream == NULL)
+            {
+                LogError("file and stream are required fields in configuration");
+                result = NULL;
+            }
+            else
+            {
+                result = (REPLAYER_MODULE_CONFIG *)malloc(sizeof(REPLAYER_MODULE_CONFIG));
+                if (result == NULL)
+                {
+                    LogError("Could not allocate configuration");
+                }
+                else
+                {
+                    result->file = NULL;
+                    result->stream = NULL;
+                    result->speed = 1.0;
+                    if (json_object_has_value_of_type(obj, "speed", JSONNumber))
+                    {
+                        result->speed = json_object_get_number(obj, "speed");
+                    }
+
+                    if (result->speed < 0)
+                    {
+                        LogError("speed must be 0 (as fast as possible) or positive");
+                        free(result);
+                        result = NULL;
+                    }
+                    else if (mallocAndStrcpy_s(&(result->file), file) != 0 ||
+                        mallocAndStrcpy_s(&(result->stream), stream) != 0)
+                    {
+                        LogError("could not copy configuration strings");
+                        free(result->file);
+                        free(result);
+                        result = NULL;
+                    }
+                }
+            }
+            json_value_free(json);
+        }
+    }
+    return result;
+}
+
+static void ReplayerModule_FreeConfiguration(void* configuration)
+{
+    if (configuration != NULL)
+    {
+        REPLAYER_MODULE_CONFIG * conf = (REPLAYER_MODULE_CONFIG*)configuration;
+        free(conf->file);
+        free(conf->stream);
+        free(conf);
+    }
+}
+
+static MODULE_HANDLE ReplayerModule_Create(BROKER_HANDLE broker, const void* configuration)
+{
+    REPLAYER_MODULE_HANDLE * module;
+    if ((broker == NULL) ||
+        (configuration == NULL))
+    {
+        LogError("Replayer had a null input. broker: [%p], configuration: [%p]", broker, configuration);
+        module = NULL;
+    }
+    else
+    {
+        const REPLAYER_MODULE_CONFIG * conf = (const REPLAYER_MODULE_CONFIG *)configuration;
+        module = new REPLAYER_MODULE_HANDLE();
+        module->broker = broker;
+        module->file = conf->file;
+        module->stream = conf->stream;
+        module->speed = conf->speed;
+        module->thread_flag = false;
+        module->main_thread = NULL;
+        module->messages_published = 0;
+        module->max_lag_us = 0;
+        module->elapsed_us = 0;
+    }
+    return module;
+}
+
+/*adds the replay timestamp to a recorded message, as late as possible before publishing it*/
+static MESSAGE_HANDLE stamp_message(MESSAGE_HANDLE recorded)
+{
+    MESSAGE_HANDLE result = NULL;
+    CONSTMAP_HANDLE properties = Message_GetProperties(recorded);
+    if (properties == NULL)
+    {
+        LogError("unable to get message properties");
+    }
+    else
+    {
+        MAP_HANDLE writable = ConstMap_CloneWriteable(properties);
+        if (writable == NULL)
+        {
+            LogError("unable to clone message properties");
+        }
+        else
+        {
+            auto now = std::chrono::time_point_cast<MicroSeconds>(std::chrono::system_clock::now());
+            std::string stamp = std::to_string(now.time_since_epoch().count());
+            if (Map_AddOrUpdate(writable, REPLAY_TIMESTAMP_PROPERTY, stamp.c_str()) != MAP_OK)
+            {
+                LogError("unable to add the replay timestamp");
+            }
+            else
+            {
+                MESSAGE_BUFFER_CONFIG config;
+                config.sourceContent = Message_GetContentHandle(recorded);
+                config.sourceProperties = writable;
+                if (config.sourceContent == NULL)
+                {
+                    LogError("unable to get message content");
+                }
+                else
+                {
+                    result = Message_CreateFromBuffer(&config);
+                    CONSTBUFFER_Destroy(config.sourceContent);
+                }
+            }
+            Map_Destroy(writable);
+        }
+        ConstMap_Destroy(properties);
+    }
+    return result;
+}
+
+static int ReplayerModule_thread(void * context)
+{
+    int thread_result = 0;
+    REPLAYER_MODULE_HANDLE * module = (REPLAYER_MODULE_HANDLE *)context;
+    ReplayReader reader;
+    if (!reader.open(module->file))
+    {
+        LogError("unable to open recording %s", module->file.c_str());
+        thread_result = -__LINE__;
+    }
+    else
+    {
+        ReplayRecord record;
+        auto start = SteadyClock::now();
+        while (module->thread_flag && reader.next(record))
+        {
+            if (reader.streamName(record.stream) != module->stream)
+            {
+                continue;
+            }
+
+            if (module->speed > 0)
+            {
+                /*sleep in short steps so that Destroy is not held up by long gaps*/
+                long long due_us = (long long)(record.time_us / module->speed);
+                long long now_us;
+                while (module->thread_flag &&
+                    (now_us = std::chrono::duration_cast<MicroSeconds>(SteadyClock::now() - start).count()) < due_us)
+                {
+                    long long wait_ms = (due_us - now_us) / 1000;
+                    ThreadAPI_Sleep((unsigned int)(wait_ms > 100 ? 100 : (wait_ms < 1 ? 1 : wait_ms)));
+                }
+                now_us = std::chrono::duration_cast<MicroSeconds>(SteadyClock::now() - start).count();
+                if (now_us - due_us > module->max_lag_us)
+                {
+                    module->max_lag_us = now_us - due_us;
+                }
+            }
+
+            MESSAGE_HANDLE recorded = Message_CreateFromByteArray(record.bytes.data(), (int32_t)record.bytes.size());
+            if (recorded == NULL)
+            {
+                LogError("unable to deserialize a recorded message");
+                continue;
+            }
+
+            MESSAGE_HANDLE message = stamp_message(recorded);
+            Message_Destroy(recorded);
+            if (message == NULL)
+            {
+                thread_result = -__LINE__;
+                break;
+            }
+            else
+            {
+                if (Broker_Publish(module->broker, module, message) != BROKER_OK)
+                {
+                    LogError("Unable to publish message");
+                    Message_Destroy(message);
+                    thread_result = -__LINE__;
+                    break;
+                }
+                Message_Destroy(message);
+                module->messages_published++;
+            }
+        }
+        module->elapsed_us = std::chrono::duration_cast<MicroSeconds>(SteadyClock::now() - start).count();
+    }
+    return thread_result;
+}
+
+static void ReplayerModule_Start(MODULE_HANDLE moduleHandle)
+{
+    if (moduleHandle != NULL)
+    {
+        REPLAYER_MODULE_HANDLE * module = (REPLAYER_MODULE_HANDLE *)moduleHandle;
+        module->thread_flag = true;
+        if (ThreadAPI_Create(&(module->main_thread), ReplayerModule_thread, module) != THREADAPI_OK)
+        {
+            LogError("Thread Creation failed");
+            module->main_thread = NULL;
+        }
+    }
+}
+
+static void ReplayerModule_Destroy(MODULE_HANDLE moduleHandle)
+{
+    if (moduleHandle == NULL)
+    {
+        LogError("Destroying a NULL module");
+    }
+    else
+    {
+        REPLAYER_MODULE_HANDLE * module = (REPLAYER_MODULE_HANDLE *)moduleHandle;
+        module->thread_flag = false;
+        if (module->main_thread != NULL)
+        {
+            int thread_result;
+            (void)ThreadAPI_Join(module->main_thread, &thread_result);
+            if (thread_result != 0)
+            {
+                LogInfo("Thread ended with non-zero result: %d", thread_result);
+            }
+        }
+
+        double seconds = module->elapsed_us / 1e6;
+        printf("replayed %-24s %10zu messages in %8.3f s (%10.1f msg/s), max lag behind schedule %lld us\n",
+            module->stream.c_str(),
+            module->messages_published,
+            seconds,
+            seconds > 0 ? module->messages_published / seconds : 0.0,
+            module->max_lag_us);
+        delete module;
+    }
+}
+
+static void ReplayerModule_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    /*the replayer stands in for a module that may also be a sink, drop what it is sent*/
+    (void)moduleHandle;
+    (void)messageHandle;
+}
+
+static const MODULE_API_1 REPLAYER_APIS_all =
+{
+    {MODULE_API_VERSION_1},
+
+    ReplayerModule_ParseConfigurationFromJson,
+    ReplayerModule_FreeConfiguration,
+    ReplayerModule_Create,
+    ReplayerModule_Destroy,
+    ReplayerModule_Receive,
+    ReplayerModule_Start
+};
+
+#ifdef BUILD_MODULE_TYPE_STATIC
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(REPLAYER_MODULE)(MODULE_API_VERSION gateway_api_version)
+#else
+MODULE_EXPORT const MODULE_API* Module_GetApi(MODULE_API_VERSION gateway_api_version)
+#endif
+{
+    (void)gateway_api_version;
+    return reinterpret_cast< const MODULE_API *>(&REPLAYER_APIS_all);
+}
@@ -0,0 +1,626 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/constmap.h"
+#include "message.h"
+#include "message_queue.h"
+
+/*
+ * Microbenchmarks for the message hot path: serialization, deserialization,
+ * cloning, property lookup and queueing. The command line and the JSON output
+ * follow the conventions of Google Benchmark so results can be fed to the
+ * same trend tracking tools.
+ */
+
+#define PROPERTY_VALUE_SIZE 16
+
+class BenchmarkState
+{
+public:
+    BenchmarkState(size_t max_iterations, const std::vector<int64_t>& args) :
+        max_iterations_(max_iterations),
+        iterations_(0),
+        started_(false),
+        paused_(false),
+        paused_real_ns_(0),
+        paused_cpu_ticks_(0),
+        bytes_processed_(0),
+        items_processed_(0),
+        error_(false),
+        args_(args),
+        real_time_ns_(0),
+        cpu_time_ns_(0)
+    {
+    }
+
+    bool KeepRunning()
+    {
+        bool result;
+        if (!started_)
+        {
+            started_ = true;
+            real_start_ = std::chrono::high_resolution_clock::now();
+            cpu_start_ = std::clock();
+        }
+
+        if (iterations_ < max_iterations_ && !error_)
+        {
+            iterations_++;
+            result = true;
+        }
+        else
+        {
+            std::clock_t cpu_end = std::clock();
+            auto real_end = std::chrono::high_resolution_clock::now();
+            real_time_ns_ = (double)(std::chrono::duration_cast<std::chrono::nanoseconds>(real_end - real_start_).count() - paused_real_ns_);
+            cpu_time_ns_ = (double)(cpu_end - cpu_start_ - paused_cpu_ticks_) * 1e9 / CLOCKS_PER_SEC;
+            result = false;
+        }
+        return result;
+    }
+
+    /*the work done between PauseTiming and ResumeTiming is left out of the reported times*/
+    void PauseTiming()
+    {
+        if (!paused_)
+        {
+            paused_ = true;
+            pause_real_start_ = std::chrono::high_resolution_clock::now();
+            pause_cpu_start_ = std::clock();
+        }
+    }
+
+    void ResumeTiming()
+    {
+        if (paused_)
+        {
+            paused_ = false;
+            paused_cpu_ticks_ += std::clock() - pause_cpu_start_;
+            paused_real_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - pause_real_start_).count();
+        }
+    }
+
+    int64_t range(size_t index) const { return args_.at(index); }
+    size_t iterations() const { return iterations_; }
+    void SetBytesProcessed(int64_t bytes) { bytes_processed_ = bytes; }
+    void SetItemsProcessed(int64_t items) { items_processed_ = items; }
+    void SkipWithError(const char* message) { error_ = true; error_message_ = message; }
+
+    bool error() const { return error_; }
+    const std::string& error_message() const { return error_message_; }
+    int64_t bytes_processed() const { return bytes_processed_; }
+    int64_t items_processed() const { return items_processed_; }
+    double real_time_ns() const { return real_time_ns_; }
+    double cpu_time_ns() const { return cpu_time_ns_; }
+
+private:
+    size_t max_iterations_;
+    size_t iterations_;
+    bool started_;
+    bool paused_;
+    std::chrono::high_resolution_clock::time_point pause_real_start_;
+    std::clock_t pause_cpu_start_;
+    int64_t paused_real_ns_;
+    std::clock_t paused_cpu_ticks_;
+    int64_t bytes_processed_;
+    int64_t items_processed_;
+    bool error_;
+    std::string error_message_;
+    std::vector<int64_t> args_;
+    std::chrono::high_resolution_clock::time_point real_start_;
+    std::clock_t cpu_start_;
+    double real_time_ns_;
+    double cpu_time_ns_;
+};
+
+typedef void(*BENCHMARK_FUNCTION)(BenchmarkState& state);
+
+typedef struct BENCHMARK_ENTRY_TAG
+{
+    const char* name;
+    BENCHMARK_FUNCTION function;
+    std::vector<std::vector<int64_t>> args;
+} BENCHMARK_ENTRY;
+
+typedef struct BENCHMARK_RESULT_TAG
+{
+    std::string name;
+    size_t iterations;
+    double real_time_ns;
+    double cpu_time_ns;
+    double bytes_per_second;
+    double items_per_second;
+    std::string error_message;
+} BENCHMARK_RESULT;
+
+/*builds a message with property_count properties and a payload of payload_size bytes*/
+static MESSAGE_HANDLE create_test_message(size_t property_count, size_t payload_size)
+{
+    MESSAGE_HANDLE result;
+    MAP_HANDLE properties = Map_Create(NULL);
+    if (properties == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        std::string value(PROPERTY_VALUE_SIZE, 'v');
+        size_t i;
+        for (i = 0; i < property_count; i++)
+        {
+            std::string key = "property" + std::to_string(i);
+            if (Map_Add(properties, key.c_str(), value.c_str()) != MAP_OK)
+            {
+                break;
+            }
+        }
+
+        if (i != property_count)
+        {
+            result = NULL;
+        }
+        else
+        {
+            std::vector<unsigned char> payload(payload_size, 0x5A);
+            MESSAGE_CONFIG config =
+            {
+                payload_size,
+                payload_size == 0 ? NULL : payload.data(),
+                properties
+            };
+            result = Message_Create(&config);
+        }
+        Map_Destroy(properties);
+    }
+    return result;
+}
+
+static void BM_Message_Create(BenchmarkState& state)
+{
+    size_t property_count = (size_t)state.range(0);
+    size_t payload_size = (size_t)state.range(1);
+    MAP_HANDLE properties = Map_Create(NULL);
+    std::string value(PROPERTY_VALUE_SIZE, 'v');
+    for (size_t i = 0; i < property_count; i++)
+    {
+        std::string key = "property" + std::to_string(i);
+        (void)Map_Add(properties, key.c_str(), value.c_str());
+    }
+    std::vector<unsigned char> payload(payload_size, 0x5A);
+    MESSAGE_CONFIG config = { payload_size, payload_size == 0 ? NULL : payload.data(), properties };
+
+    while (state.KeepRunning())
+    {
+        MESSAGE_HANDLE message = Message_Create(&config);
+        if (message == NULL)
+        {
+            state.SkipWithError("Message_Create failed");
+        }
+        Message_Destroy(message);
+    }
+    state.SetBytesProcessed((int64_t)(state.iterations() * payload_size));
+    Map_Destroy(properties);
+}
+
+static void BM_Message_ToByteArray(BenchmarkState& state)
+{
+    MESSAGE_HANDLE message = create_test_message((size_t)state.range(0), (size_t)state.range(1));
+    int32_t serialized_size = Message_ToByteArray(message, NULL, 0);
+    if (message == NULL || serialized_size < 0)
+    {
+        state.SkipWithError("unable to build the test message");
+    }
+    else
+    {
+        std::vector<unsigned char> buffer((size_t)serialized_size);
+        while (state.KeepRunning())
+        {
+            /*the broker always sizes first, then serializes*/
+            int32_t size = Message_ToByteArray(message, NULL, 0);
+            if (Message_ToByteArray(message, buffer.data(), size) != serialized_size)
+            {
+                state.SkipWithError("Message_ToByteArray failed");
+            }
+        }
+        state.SetBytesProcessed((int64_t)(state.iterations() * (size_t)serialized_size));
+    }
+    Message_Destroy(message);
+}
+
+static void BM_Message_CreateFromByteArray(BenchmarkState& state)
+{
+    MESSAGE_HANDLE message = create_test_message((size_t)state.range(0), (size_t)state.range(1));
+    int32_t serialized_size = Message_ToByteArray(message, NULL, 0);
+    if (message == NULL || serialized_size < 0)
+    {
+        state.SkipWithError("unable to build the test message");
+    }
+    else
+    {
+        std::vector<unsigned char> buffer((size_t)serialized_size);
+        (void)Message_ToByteArray(message, buffer.data(), serialized_size);
+        while (state.KeepRunning())
+        {
+            MESSAGE_HANDLE parsed = Message_CreateFromByteArray(buffer.data(), serialized_size);
+            if (parsed == NULL)
+            {
+                state.SkipWithError("Message_CreateFromByteArray failed");
+            }
+            Message_Destroy(parsed);
+        }
+        state.SetBytesProcessed((int64_t)(state.iterations() * (size_t)serialized_size));
+    }
+    Message_Destroy(message);
+}
+
+static void BM_Message_Clone(BenchmarkState& state)
+{
+    MESSAGE_HANDLE message = create_test_message((size_t)state.range(0), (size_t)state.range(1));
+    if (message == NULL)
+    {
+        state.SkipWithError("unable to build the test message");
+    }
+    else
+    {
+        while (state.KeepRunning())
+        {
+            MESSAGE_HANDLE clone = Message_Clone(message);
+            Message_Destroy(clone);
+        }
+        state.SetItemsProcessed((int64_t)state.iterations());
+    }
+    Message_Destroy(message);
+}
+
+static void BM_ConstMap_GetValue(BenchmarkState& state)
+{
+    size_t property_count = (size_t)state.range(0);
+    MESSAGE_HANDLE message = create_test_message(property_count, 0);
+    CONSTMAP_HANDLE properties = (message == NULL) ? NULL : Message_GetProperties(message);
+    if (properties == NULL)
+    {
+        state.SkipWithError("unable to build the test message");
+    }
+    else
+    {
+        /*look keys up round robin so the average position in the map is measured*/
+        std::vector<std::string> keys;
+        for (size_t i = 0; i < property_count; i++)
+        {
+            keys.push_back("property" + std::to_string(i));
+        }
+        keys.push_back("not a property");
+
+        size_t next = 0;
+        while (state.KeepRunning())
+        {
+            (void)ConstMap_GetValue(properties, keys[next].c_str());
+            next = (next + 1 == keys.size()) ? 0 : next + 1;
+        }
+        state.SetItemsProcessed((int64_t)state.iterations());
+        ConstMap_Destroy(properties);
+    }
+    Message_Destroy(message);
+}
+
+static void BM_MESSAGE_QUEUE_PushPop(BenchmarkState& state)
+{
+    size_t depth = (size_t)state.range(0);
+    MESSAGE_HANDLE message = create_test_message(4, 256);
+    MESSAGE_QUEUE_HANDLE queue = MESSAGE_QUEUE_create();
+    if (message == NULL || queue == NULL)
+    {
+        state.SkipWithError("unable to build the test queue");
+    }
+    else
+    {
+        std::vector<MESSAGE_HANDLE> clones(depth);
+        while (state.KeepRunning())
+        {
+            /*cloning is measured by BM_Message_Clone, only the queue is timed here*/
+            state.PauseTiming();
+            size_t cloned = 0;
+            while (cloned < depth && (clones[cloned] = Message_Clone(message)) != NULL)
+            {
+                cloned++;
+            }
+            state.ResumeTiming();
+            if (cloned < depth)
+            {
+                state.SkipWithError("Message_Clone failed");
+            }
+
+            for (size_t i = 0; i < cloned; i++)
+            {
+                if (MESSAGE_QUEUE_push(queue, clones[i]) != 0)
+                {
+                    state.SkipWithError("MESSAGE_QUEUE_push failed");
+                    Message_Destroy(clones[i]);
+                }
+            }
+            MESSAGE_HANDLE popped;
+            while ((popped = MESSAGE_QUEUE_pop(queue)) != NULL)
+            {
+                Message_Destroy(popped);
+            }
+        }
+        state.SetItemsProcessed((int64_t)(state.iterations() * depth));
+    }
+    if (queue != NULL)
+    {
+        MESSAGE_QUEUE_destroy(queue);
+    }
+    Message_Destroy(message);
+}
+
+static std::vector<std::vector<int64_t>> properties_by_payload()
+{
+    static const int64_t property_counts[] = { 0, 4, 16, 64 };
+    static const int64_t payload_sizes[] = { 0, 256, 4096, 65536 };
+    std::vector<std::vector<int64_t>> result;
+    for (int64_t property_count : property_counts)
+    {
+        for (int64_t payload_size : payload_sizes)
+        {
+            result.push_back({ property_count, payload_size });
+        }
+    }
+    return result;
+}
+
+static std::vector<BENCHMARK_ENTRY> register_benchmarks()
+{
+    std::vector<BENCHMARK_ENTRY> result;
+    result.push_back({ "BM_Message_Create", BM_Message_Create, properties_by_payload() });
+    result.push_back({ "BM_Message_ToByteArray", BM_Message_ToByteArray, properties_by_payload() });
+    result.push_back({ "BM_Message_CreateFromByteArray", BM_Message_CreateFromByteArray, properties_by_payload() });
+    result.push_back({ "BM_Message_Clone", BM_Message_Clone, { { 4, 256 }, { 64, 65536 } } });
+    result.push_back({ "BM_ConstMap_GetValue", BM_ConstMap_GetValue, { { 1 }, { 4 }, { 16 }, { 64 } } });
+    result.push_back({ "BM_MESSAGE_QUEUE_PushPop", BM_MESSAGE_QUEUE_PushPop, { { 1 }, { 16 }, { 256 } } });
+    return result;
+}
+
+static std::string benchmark_name(const BENCHMARK_ENTRY& entry, const std::vector<int64_t>& args)
+{
+    std::ostringstream name;
+    name << entry.name;
+    for (int64_t arg : args)
+    {
+        name << "/" << arg;
+    }
+    return name.str();
+}
+
+/*grows the iteration count until a run lasts at least min_time seconds, as Google Benchmark does*/
+static BENCHMARK_RESULT run_benchmark(const BENCHMARK_ENTRY& entry, const std::vector<int64_t>& args, double min_time)
+{
+    BENCHMARK_RESULT result;
+    result.name = benchmark_name(entry, args);
+
+    size_t iterations = 1;
+    while (true)
+    {
+        BenchmarkState state(iterations, args);
+        entry.function(state);
+
+        double seconds = state.real_time_ns() / 1e9;
+        if (state.error() || seconds >= min_time || iterations >= 1000000000)
+        {
+            result.iterations = state.iterations();
+            result.real_time_ns = state.iterations() == 0 ? 0 : state.real_time_ns() / state.iterations();
+            result.cpu_time_ns = state.iterations() == 0 ? 0 : state.cpu_time_ns() / state.iterations();
+            result.bytes_per_second = seconds > 0 ? state.bytes_processed() / seconds : 0;
+            result.items_per_second = seconds > 0 ? state.items_processed() / seconds : 0;
+            result.error_message = state.error() ? state.error_message() : "";
+            break;
+        }
+
+        double multiplier = (seconds <= min_time / 10) ? 10 : (min_time * 1.4 / seconds);
+        size_t next = (size_t)(iterations * multiplier);
+        iterations = (next > iterations) ? next : iterations + 1;
+    }
+    return result;
+}
+
+static void print_console(std::ostream& out, const std::vector<BENCHMARK_RESULT>& results)
+{
+    out << std::left << std::setw(48) << "Benchmark"
+        << std::right << std::setw(14) << "Time(ns)"
+        << std::setw(14) << "CPU(ns)"
+        << std::setw(14) << "Iterations"
+        << "  Throughput" << std::endl;
+    out << std::string(110, '-') << std::endl;
+    for (const BENCHMARK_RESULT& r : results)
+    {
+        out << std::left << std::setw(48) << r.name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(14) << r.real_time_ns
+            << std::setw(14) << r.cpu_time_ns
+            << std::setw(14) << r.iterations;
+        if (!r.error_message.empty())
+        {
+            out << "  ERROR: " << r.error_message;
+        }
+        else if (r.bytes_per_second > 0)
+        {
+            out << "  " << std::setprecision(2) << r.bytes_per_second / (1024 * 1024) << " MB/s";
+        }
+        else if (r.items_per_second > 0)
+        {
+            out << "  " << std::setprecision(0) << r.items_per_second << " items/s";
+        }
+        out << std::endl;
+    }
+}
+
+static void print_json(std::ostream& out, const std::vector<BENCHMARK_RESULT>& results, const char* executable)
+{
+    char date[64] = { 0 };
+    time_t now = time(NULL);
+    struct tm* t = localtime(&now);
+    if (t != NULL)
+    {
+        (void)strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", t);
+    }
+
+    out << "{" << std::endl;
+    out << "  \"context\": {" << std::endl;
+    out << "    \"date\": \"" << date << "\"," << std::endl;
+    out << "    \"executable\": \"" << executable << "\"," << std::endl;
+    out << "    \"num_cpus\": " << std::thread::hardware_concurrency() << "," << std::endl;
+#ifdef NDEBUG
+    out << "    \"library_build_type\": \"release\"" << std::endl;
+#else
+    out << "    \"library_build_type\": \"debug\"" << std::endl;
+#endif
+    out << "  }," << std::endl;
+    out << "  \"benchmarks\": [" << std::endl;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const BENCHMARK_RESULT& r = results[i];
+        out << "    {" << std::endl;
+        out << "      \"name\": \"" << r.name << "\"," << std::endl;
+        if (!r.error_message.empty())
+        {
+            out << "      \"error_occurred\": true," << std::endl;
+            out << "      \"error_message\": \"" << r.error_message << "\"," << std::endl;
+        }
+        out << "      \"iterations\": " << r.iterations << "," << std::endl;
+        out << std::fixed << std::setprecision(3);
+        out << "      \"real_time\": " << r.real_time_ns << "," << std::endl;
+        out << "      \"cpu_time\": " << r.cpu_time_ns << "," << std::endl;
+        if (r.bytes_per_second > 0)
+        {
+            out << "      \"bytes_per_second\": " << r.bytes_per_second << "," << std::endl;
+        }
+        if (r.items_per_second > 0)
+        {
+            out << "      \"items_per_second\": " << r.items_per_second << "," << std::endl;
+        }
+        out << "      \"time_unit\": \"ns\"" << std::endl;
+        out << "    }" << (i + 1 == results.size() ? "" : ",") << std::endl;
+    }
+    out << "  ]" << std::endl;
+    out << "}" << std::endl;
+}
+
+static int usage(const char* executable)
+{
+    std::cout
+        << "usage: " << executable << " [options]" << std::endl
+        << "  --benchmark_filter=<substring>   run only the benchmarks whose name contains <substring>" << std::endl
+        << "  --benchmark_min_time=<seconds>   minimum time to run each benchmark (default 0.5)" << std::endl
+        << "  --benchmark_format=<console|json> format of the report written to stdout" << std::endl
+        << "  --benchmark_out=<file>           also write a JSON report to <file>" << std::endl
+        << "  --benchmark_list_tests           list the benchmarks and exit" << std::endl;
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string format = "console";
+    std::string out_file;
+    double min_time = 0.5;
+    bool list_only = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg.compare(0, 19, "--benchmark_filter=") == 0)
+        {
+            filter = arg.substr(19);
+        }
+        else if (arg.compare(0, 21, "--benchmark_min_time=") == 0)
+        {
+            min_time = std::atof(arg.substr(21).c_str());
+        }
+        else if (arg.compare(0, 19, "--benchmark_format=") == 0)
+        {
+            format = arg.substr(19);
+        }
+        else if (arg.compare(0, 16, "--benchmark_out=") == 0)
+        {
+            out_file = arg.substr(16);
+        }
+        else if (arg == "--benchmark_list_tests")
+        {
+            list_only = true;
+        }
+        else
+        {
+            return usage(argv[0]);
+        }
+    }
+
+    if ((format != "console" && format != "json") || min_time <= 0)
+    {
+        return usage(argv[0]);
+    }
+
+    int result = 0;
+    std::vector<BENCHMARK_RESULT> results;
+    for (const BENCHMARK_ENTRY& entry : register_benchmarks())
+    {
+        for (const std::vector<int64_t>& args : entry.args)
+        {
+            std::string name = benchmark_name(entry, args);
+            if (filter.empty() || name.find(filter) != std::string::npos)
+            {
+                if (list_only)
+                {
+                    std::cout << name << std::endl;
+                }
+                else
+                {
+                    results.push_back(run_benchmark(entry, args, min_time));
+                    if (!results.back().error_message.empty())
+                    {
+                        result = 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!list_only)
+    {
+        if (format == "json")
+        {
+            print_json(std::cout, results, argv[0]);
+        }
+        else
+        {
+            print_console(std::cout, results);
+        }
+
+        if (!out_file.empty())
+        {
+            std::ofstream out(out_file.c_str());
+            if (!out)
+            {
+                std::cerr << "unable to open " << out_file << std::endl;
+                result = 1;
+            }
+            else
+            {
+                print_json(out, results, argv[0]);
+            }
+        }
+    }
+    return result;
+}
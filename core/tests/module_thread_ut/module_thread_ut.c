@@ -0,0 +1,306 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __linux__
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#endif
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define GATEWAY_EXPORT_H
+#define GATEWAY_EXPORT
+
+#include "testrunnerswitcher.h"
+#include "module_thread.h"
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+static MODULE_THREAD_CONFIG* parse(const char* module_json)
+{
+    MODULE_THREAD_CONFIG* result = (MODULE_THREAD_CONFIG*)0x1;
+    JSON_Value* json = json_parse_string(module_json);
+    ASSERT_IS_NOT_NULL(json);
+    ASSERT_ARE_EQUAL(int, 0, ModuleThreadConfig_ParseFromJson(json_value_get_object(json), &result));
+    json_value_free(json);
+    return result;
+}
+
+static int parse_fails(const char* module_json)
+{
+    MODULE_THREAD_CONFIG* config = (MODULE_THREAD_CONFIG*)0x1;
+    JSON_Value* json = json_parse_string(module_json);
+    int result;
+    ASSERT_IS_NOT_NULL(json);
+    result = ModuleThreadConfig_ParseFromJson(json_value_get_object(json), &config);
+    json_value_free(json);
+    ASSERT_IS_NULL(config);
+    return result;
+}
+
+typedef struct THREAD_OBSERVATION_TAG
+{
+    const MODULE_THREAD_CONFIG* current;
+    char name[16];
+} THREAD_OBSERVATION;
+
+static int observe_thread(void* context)
+{
+    THREAD_OBSERVATION* observation = (THREAD_OBSERVATION*)context;
+    observation->current = ModuleThread_GetCurrentConfig();
+#ifdef __linux__
+    (void)pthread_getname_np(pthread_self(), observation->name, sizeof(observation->name));
+#endif
+    return 42;
+}
+
+BEGIN_TEST_SUITE(module_thread_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    (void)ModuleThread_SetCurrentConfig(NULL);
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    (void)ModuleThread_SetCurrentConfig(NULL);
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_001: [ If module_json or config is NULL, ModuleThreadConfig_ParseFromJson shall return a non-zero value. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_fails_on_NULL)
+{
+    MODULE_THREAD_CONFIG* config;
+    JSON_Value* json = json_parse_string("{}");
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, ModuleThreadConfig_ParseFromJson(NULL, &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, ModuleThreadConfig_ParseFromJson(json_value_get_object(json), NULL));
+
+    json_value_free(json);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_002: [ If module_json has none of "cpu_affinity", "priority" and "thread_name", ModuleThreadConfig_ParseFromJson shall set *config to NULL and return 0. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_without_settings_returns_NULL)
+{
+    MODULE_THREAD_CONFIG* config = parse("{ \"name\": \"m\", \"args\": null }");
+
+    ASSERT_IS_NULL(config);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_003: [ ModuleThreadConfig_ParseFromJson shall read "cpu_affinity" as either an array of CPU indexes or a string of comma separated CPU indexes and ranges. ]*/
+/*Tests_SRS_MODULE_THREAD_29_005: [ ModuleThreadConfig_ParseFromJson shall read "priority" as one of "lowest", "below_normal", "normal", "above_normal" or "highest". ]*/
+/*Tests_SRS_MODULE_THREAD_29_007: [ ModuleThreadConfig_ParseFromJson shall copy the "thread_name" string, and fail if it is not a string. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_reads_array_priority_and_name)
+{
+    MODULE_THREAD_CONFIG* config = parse("{ \"cpu_affinity\": [ 2, 3 ], \"priority\": \"above_normal\", \"thread_name\": \"iothub\" }");
+
+    ASSERT_IS_NOT_NULL(config);
+    ASSERT_ARE_EQUAL(size_t, 2, config->cpu_count);
+    ASSERT_ARE_EQUAL(int, 2, config->cpus[0]);
+    ASSERT_ARE_EQUAL(int, 3, config->cpus[1]);
+    ASSERT_IS_TRUE(config->priority == MODULE_THREAD_PRIORITY_ABOVE_NORMAL);
+    ASSERT_ARE_EQUAL(char_ptr, "iothub", config->thread_name);
+
+    ModuleThreadConfig_Destroy(config);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_003: [ ModuleThreadConfig_ParseFromJson shall read "cpu_affinity" as either an array of CPU indexes or a string of comma separated CPU indexes and ranges. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_reads_cpu_list)
+{
+    static const int expected[] = { 0, 1, 2, 3, 6, 8, 9 };
+    MODULE_THREAD_CONFIG* config = parse("{ \"cpu_affinity\": \"0-3,6,8-9\" }");
+    size_t i;
+
+    ASSERT_IS_NOT_NULL(config);
+    ASSERT_ARE_EQUAL(size_t, sizeof(expected) / sizeof(expected[0]), config->cpu_count);
+    for (i = 0; i < config->cpu_count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, expected[i], config->cpus[i]);
+    }
+    ASSERT_IS_TRUE(config->priority == MODULE_THREAD_PRIORITY_DEFAULT);
+    ASSERT_IS_NULL(config->thread_name);
+
+    ModuleThreadConfig_Destroy(config);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_004: [ If "cpu_affinity" is neither an array of numbers nor a string of CPU indexes and ranges, ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_rejects_bad_affinity)
+{
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": 3 }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": [ \"1\" ] }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": [ 1.5 ] }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": [ -1 ] }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": [ 4096 ] }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": \"\" }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": \"3-1\" }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": \"1,\" }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": \"1;2\" }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": \"-1\" }"));
+}
+
+/*Tests_SRS_MODULE_THREAD_29_006: [ If "priority" is not one of "lowest", "below_normal", "normal", "above_normal" or "highest", ModuleThreadConfig_ParseFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_MODULE_THREAD_29_007: [ ModuleThreadConfig_ParseFromJson shall copy the "thread_name" string, and fail if it is not a string. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_rejects_bad_priority_and_name)
+{
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"priority\": \"realtime\" }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"priority\": 1 }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"thread_name\": 1 }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"cpu_affinity\": [ 0 ], \"thread_name\": [] }"));
+}
+
+/*Tests_SRS_MODULE_THREAD_30_001: [ ModuleThreadConfig_ParseFromJson shall read "dedicated_thread" as a boolean, and fail if it is not one. ]*/
+TEST_FUNCTION(ModuleThreadConfig_ParseFromJson_reads_dedicated_thread)
+{
+    MODULE_THREAD_CONFIG* config = parse("{ \"dedicated_thread\": true }");
+    MODULE_THREAD_CONFIG* clone;
+
+    ASSERT_IS_NOT_NULL(config);
+    ASSERT_IS_TRUE(config->dedicated_thread);
+    ASSERT_ARE_EQUAL(size_t, 0, config->cpu_count);
+    ASSERT_IS_NULL(config->thread_name);
+    clone = ModuleThreadConfig_Clone(config);
+    ASSERT_IS_NOT_NULL(clone);
+    ASSERT_IS_TRUE(clone->dedicated_thread);
+    ModuleThreadConfig_Destroy(clone);
+    ModuleThreadConfig_Destroy(config);
+
+    config = parse("{ \"thread_name\": \"filter\", \"dedicated_thread\": false }");
+    ASSERT_IS_NOT_NULL(config);
+    ASSERT_IS_FALSE(config->dedicated_thread);
+    ModuleThreadConfig_Destroy(config);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"dedicated_thread\": \"yes\" }"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_fails("{ \"dedicated_thread\": 1 }"));
+}
+
+/*Tests_SRS_MODULE_THREAD_29_009: [ If config is NULL, ModuleThreadConfig_Clone shall return NULL. ]*/
+TEST_FUNCTION(ModuleThreadConfig_Clone_NULL_returns_NULL)
+{
+    ASSERT_IS_NULL(ModuleThreadConfig_Clone(NULL));
+}
+
+/*Tests_SRS_MODULE_THREAD_29_010: [ ModuleThreadConfig_Clone shall return a deep copy of config. ]*/
+/*Tests_SRS_MODULE_THREAD_29_012: [ ModuleThreadConfig_Destroy shall free config and its members, and do nothing if config is NULL. ]*/
+TEST_FUNCTION(ModuleThreadConfig_Clone_copies_deeply)
+{
+    MODULE_THREAD_CONFIG* config = parse("{ \"cpu_affinity\": \"4-5\", \"priority\": \"lowest\", \"thread_name\": \"ble\" }");
+    MODULE_THREAD_CONFIG* clone = ModuleThreadConfig_Clone(config);
+
+    ASSERT_IS_NOT_NULL(clone);
+    ASSERT_ARE_EQUAL(size_t, 2, clone->cpu_count);
+    ASSERT_IS_TRUE(clone->cpus != config->cpus);
+    ASSERT_ARE_EQUAL(int, 4, clone->cpus[0]);
+    ASSERT_ARE_EQUAL(int, 5, clone->cpus[1]);
+    ASSERT_IS_TRUE(clone->priority == MODULE_THREAD_PRIORITY_LOWEST);
+    ASSERT_IS_TRUE(clone->thread_name != config->thread_name);
+    ASSERT_ARE_EQUAL(char_ptr, "ble", clone->thread_name);
+
+    ModuleThreadConfig_Destroy(config);
+    ModuleThreadConfig_Destroy(clone);
+    ModuleThreadConfig_Destroy(NULL);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_013: [ ModuleThread_SetCurrentConfig shall make config the current settings of the calling thread and return the previous ones. ]*/
+/*Tests_SRS_MODULE_THREAD_29_014: [ ModuleThread_GetCurrentConfig shall return the current settings of the calling thread. ]*/
+TEST_FUNCTION(ModuleThread_SetCurrentConfig_returns_previous)
+{
+    MODULE_THREAD_CONFIG first = { 0, NULL, MODULE_THREAD_PRIORITY_DEFAULT, NULL, false };
+    MODULE_THREAD_CONFIG second = { 0, NULL, MODULE_THREAD_PRIORITY_DEFAULT, NULL, false };
+
+    ASSERT_IS_NULL(ModuleThread_SetCurrentConfig(&first));
+    ASSERT_IS_TRUE(ModuleThread_GetCurrentConfig() == &first);
+    ASSERT_IS_TRUE(ModuleThread_SetCurrentConfig(&second) == &first);
+    ASSERT_IS_TRUE(ModuleThread_GetCurrentConfig() == &second);
+    ASSERT_IS_TRUE(ModuleThread_SetCurrentConfig(NULL) == &second);
+    ASSERT_IS_NULL(ModuleThread_GetCurrentConfig());
+}
+
+/*Tests_SRS_MODULE_THREAD_29_021: [ If config is NULL, ModuleThread_Apply shall do nothing and return 0. ]*/
+TEST_FUNCTION(ModuleThread_Apply_NULL_does_nothing)
+{
+    ASSERT_ARE_EQUAL(int, 0, ModuleThread_Apply(NULL));
+}
+
+/*Tests_SRS_MODULE_THREAD_29_015: [ If threadHandle or func is NULL, ModuleThread_Create shall return THREADAPI_INVALID_ARG. ]*/
+TEST_FUNCTION(ModuleThread_Create_fails_on_NULL)
+{
+    THREAD_HANDLE thread;
+    THREAD_OBSERVATION observation;
+
+    ASSERT_IS_TRUE(ModuleThread_Create(NULL, observe_thread, &observation) == THREADAPI_INVALID_ARG);
+    ASSERT_IS_TRUE(ModuleThread_Create(&thread, NULL, &observation) == THREADAPI_INVALID_ARG);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_016: [ If the calling thread has no current settings, ModuleThread_Create shall return the result of ThreadAPI_Create(threadHandle, func, arg). ]*/
+TEST_FUNCTION(ModuleThread_Create_without_settings_creates_plain_thread)
+{
+    THREAD_HANDLE thread;
+    THREAD_OBSERVATION observation;
+    int thread_result = 0;
+    memset(&observation, 0, sizeof(observation));
+    observation.current = (const MODULE_THREAD_CONFIG*)0x1;
+
+    ASSERT_IS_TRUE(ModuleThread_Create(&thread, observe_thread, &observation) == THREADAPI_OK);
+    ASSERT_IS_TRUE(ThreadAPI_Join(thread, &thread_result) == THREADAPI_OK);
+
+    ASSERT_ARE_EQUAL(int, 42, thread_result);
+    ASSERT_IS_NULL(observation.current);
+}
+
+/*Tests_SRS_MODULE_THREAD_29_017: [ The new thread shall apply the settings with ModuleThread_Apply and make them its current settings before calling func with arg. ]*/
+/*Tests_SRS_MODULE_THREAD_29_018: [ The new thread shall free its copy of the settings when func returns, and return what func returned. ]*/
+/*Tests_SRS_MODULE_THREAD_29_020: [ Otherwise ModuleThread_Create shall create the thread with ThreadAPI_Create, passing it a copy of the current settings of the calling thread. ]*/
+/*Tests_SRS_MODULE_THREAD_29_024: [ ModuleThread_Apply shall name the calling thread if config has a thread_name. ]*/
+TEST_FUNCTION(ModuleThread_Create_passes_current_settings_to_thread)
+{
+    MODULE_THREAD_CONFIG* config = parse("{ \"thread_name\": \"a_rather_long_module_name\" }");
+    THREAD_HANDLE thread;
+    THREAD_OBSERVATION observation;
+    int thread_result = 0;
+    memset(&observation, 0, sizeof(observation));
+    (void)ModuleThread_SetCurrentConfig(config);
+
+    ASSERT_IS_TRUE(ModuleThread_Create(&thread, observe_thread, &observation) == THREADAPI_OK);
+    ASSERT_IS_TRUE(ThreadAPI_Join(thread, &thread_result) == THREADAPI_OK);
+
+    ASSERT_ARE_EQUAL(int, 42, thread_result);
+    ASSERT_IS_NOT_NULL(observation.current);
+    ASSERT_IS_TRUE(observation.current != config);
+#ifdef __linux__
+    ASSERT_ARE_EQUAL(char_ptr, "a_rather_long_m", observation.name);
+#endif
+
+    (void)ModuleThread_SetCurrentConfig(NULL);
+    ModuleThreadConfig_Destroy(config);
+}
+
+END_TEST_SUITE(module_thread_ut)
@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+ * Replaces the C runtime allocator of the performance_e2e process so that
+ * every allocation, including those made by gballoc, nanomsg and dynamically
+ * loaded modules, is reported to the allocation profiler. The glibc entry
+ * points do the actual work.
+ */
+
+#include <stddef.h>
+
+#include "alloc_profile.h"
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+void* malloc(size_t size)
+{
+    void* result = __libc_malloc(size);
+    if (result != NULL)
+    {
+        AllocProfile_OnAllocate(size);
+    }
+    return result;
+}
+
+void* calloc(size_t nmemb, size_t size)
+{
+    void* result = __libc_calloc(nmemb, size);
+    if (result != NULL)
+    {
+        AllocProfile_OnAllocate(nmemb * size);
+    }
+    return result;
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    void* result = __libc_realloc(ptr, size);
+    /*a realloc is counted as a free of the old block and an allocation of the new one*/
+    if (ptr != NULL && (result != NULL || size == 0))
+    {
+        AllocProfile_OnFree();
+    }
+    if (result != NULL)
+    {
+        AllocProfile_OnAllocate(size);
+    }
+    return result;
+}
+
+void free(void* ptr)
+{
+    if (ptr != NULL)
+    {
+        AllocProfile_OnFree();
+    }
+    __libc_free(ptr);
+}
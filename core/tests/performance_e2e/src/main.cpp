@@ -2,43 +2,188 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <iostream>
+#include <fstream>
+#include <iomanip>
 #include <string>
+#include <vector>
 
 #include "gateway.h"
+#include "alloc_profile.h"
 #include "azure_c_shared_utility/threadapi.h"
 #include <nanomsg/nn.h>
 
+static const char* subsystem_names[ALLOC_PROFILE_SUBSYSTEM_COUNT] = { "module", "message", "broker" };
+
+static std::vector<ALLOC_PROFILE_REPORT_ENTRY> get_alloc_profile()
+{
+    std::vector<ALLOC_PROFILE_REPORT_ENTRY> entries(ALLOC_PROFILE_MAX_SCOPES);
+    size_t count = AllocProfile_GetReport(entries.data(), entries.size());
+    entries.resize(count < entries.size() ? count : entries.size());
+    return entries;
+}
+
+static uint64_t total_allocations(const ALLOC_PROFILE_REPORT_ENTRY& entry)
+{
+    uint64_t result = 0;
+    for (size_t s = 0; s < ALLOC_PROFILE_SUBSYSTEM_COUNT; s++)
+    {
+        result += entry.allocations[s];
+    }
+    return result;
+}
+
+static uint64_t total_bytes(const ALLOC_PROFILE_REPORT_ENTRY& entry)
+{
+    uint64_t result = 0;
+    for (size_t s = 0; s < ALLOC_PROFILE_SUBSYSTEM_COUNT; s++)
+    {
+        result += entry.bytes[s];
+    }
+    return result;
+}
+
+static double per_hop(uint64_t value, uint64_t hops)
+{
+    return hops == 0 ? 0.0 : (double)value / (double)hops;
+}
+
+static void print_alloc_profile(const std::vector<ALLOC_PROFILE_REPORT_ENTRY>& entries)
+{
+    std::cout << std::endl << "Allocations per scope (allocs/hop and bytes/hop count messages delivered to the module):" << std::endl;
+    std::cout << std::left << std::setw(24) << "scope"
+        << std::right << std::setw(12) << "hops"
+        << std::setw(12) << "allocs"
+        << std::setw(14) << "bytes"
+        << std::setw(12) << "frees"
+        << std::setw(12) << "allocs/hop"
+        << std::setw(12) << "bytes/hop"
+        << "  allocs/hop by subsystem" << std::endl;
+    for (const ALLOC_PROFILE_REPORT_ENTRY& entry : entries)
+    {
+        std::cout << std::left << std::setw(24) << entry.name
+            << std::right << std::setw(12) << entry.hops
+            << std::setw(12) << total_allocations(entry)
+            << std::setw(14) << total_bytes(entry)
+            << std::setw(12) << entry.frees
+            << std::fixed << std::setprecision(2)
+            << std::setw(12) << per_hop(total_allocations(entry), entry.hops)
+            << std::setw(12) << per_hop(total_bytes(entry), entry.hops)
+            << " ";
+        for (size_t s = 0; s < ALLOC_PROFILE_SUBSYSTEM_COUNT; s++)
+        {
+            std::cout << " " << subsystem_names[s] << "=" << per_hop(entry.allocations[s], entry.hops);
+        }
+        std::cout << std::endl;
+    }
+}
+
+static bool write_alloc_profile(const std::vector<ALLOC_PROFILE_REPORT_ENTRY>& entries, const std::string& file_name)
+{
+    std::ofstream out(file_name.c_str());
+    if (out)
+    {
+        out << "{" << std::endl << "  \"scopes\": [" << std::endl;
+        for (size_t i = 0; i < entries.size(); i++)
+        {
+            const ALLOC_PROFILE_REPORT_ENTRY& entry = entries[i];
+            out << "    {" << std::endl;
+            out << "      \"name\": \"" << entry.name << "\"," << std::endl;
+            out << "      \"hops\": " << entry.hops << "," << std::endl;
+            out << "      \"frees\": " << entry.frees << "," << std::endl;
+            out << "      \"allocations_per_hop\": " << per_hop(total_allocations(entry), entry.hops) << "," << std::endl;
+            out << "      \"bytes_per_hop\": " << per_hop(total_bytes(entry), entry.hops) << "," << std::endl;
+            out << "      \"subsystems\": {" << std::endl;
+            for (size_t s = 0; s < ALLOC_PROFILE_SUBSYSTEM_COUNT; s++)
+            {
+                out << "        \"" << subsystem_names[s] << "\": { \"allocations\": " << entry.allocations[s]
+                    << ", \"bytes\": " << entry.bytes[s] << " }"
+                    << (s + 1 == ALLOC_PROFILE_SUBSYSTEM_COUNT ? "" : ",") << std::endl;
+            }
+            out << "      }" << std::endl;
+            out << "    }" << (i + 1 == entries.size() ? "" : ",") << std::endl;
+        }
+        out << "  ]" << std::endl << "}" << std::endl;
+    }
+    return (bool)out;
+}
+
 int main(int argc, char** argv)
 {
     int sleep_in_ms = 5000;
     GATEWAY_HANDLE gateway;
-    if (argc != 2 && argc != 3)
+    bool alloc_profile = false;
+    std::string alloc_profile_file;
+    std::vector<std::string> args;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--alloc-profile")
+        {
+            alloc_profile = true;
+        }
+        else if (arg.compare(0, 16, "--alloc-profile=") == 0)
+        {
+            alloc_profile = true;
+            alloc_profile_file = arg.substr(16);
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    if (args.size() != 1 && args.size() != 2)
     {
-        std::cout 
-            << "usage: performance_sample configFile [duration]" << std::endl 
+        std::cout
+            << "usage: performance_sample configFile [duration] [--alloc-profile[=file]]" << std::endl
             << "where configFile is the name of the file that contains the gateway configuration" << std::endl
-            << "where duration is the length of time in seconds for the test to run" << std::endl;
+            << "where duration is the length of time in seconds for the test to run" << std::endl
+            << "where --alloc-profile reports allocations per module and per message hop, and optionally writes them to file as JSON" << std::endl;
     }
     else
     {
-        if (argc==3)
+        if (args.size() == 2)
         {
-            sleep_in_ms = std::stoi(argv[2]) * 1000;
+            sleep_in_ms = std::stoi(args[1]) * 1000;
         }
-        
-        if ((gateway = Gateway_CreateFromJson(argv[1])) == NULL)
+
+#ifndef GATEWAY_ALLOC_PROFILING
+        if (alloc_profile)
+        {
+            std::cout << "--alloc-profile requires a gateway built with enable_alloc_profiling, ignoring it" << std::endl;
+            alloc_profile = false;
+        }
+#endif
+        if (alloc_profile)
+        {
+            AllocProfile_Enable();
+        }
+
+        if ((gateway = Gateway_CreateFromJson(args[0].c_str())) == NULL)
         {
             std::cout << "failed to create the gateway from JSON" << std::endl;
         }
         else
         {
-            
+
             std::cout << "gateway successfully created from JSON" << std::endl;
             std::cout << "gateway shall run for " << sleep_in_ms/1000 << " seconds" << std::endl;
             ThreadAPI_Sleep(sleep_in_ms);
-            
+
             Gateway_Destroy(gateway);
         }
+
+        if (alloc_profile)
+        {
+            AllocProfile_Disable();
+            std::vector<ALLOC_PROFILE_REPORT_ENTRY> entries = get_alloc_profile();
+            print_alloc_profile(entries);
+            if (!alloc_profile_file.empty() && !write_alloc_profile(entries, alloc_profile_file))
+            {
+                std::cout << "unable to write the allocation profile to " << alloc_profile_file << std::endl;
+            }
+        }
     }
     return 0;
 }
@@ -74,6 +74,7 @@ TEST_FUNCTION(Performance_e2e_5_second_run)
 		modules[0].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[0].moduleLibraryFileName = STRING_construct(simulator_module_path());
 		modules[0].module_loader_info.entrypoint = (void*)&(loader_info[0]);
+		modules[0].module_thread_config = NULL;
 
         // metrics
 		modules[1].module_name = "metrics1";
@@ -81,6 +82,7 @@ TEST_FUNCTION(Performance_e2e_5_second_run)
 		modules[1].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[1].moduleLibraryFileName = STRING_construct(metrics_module_path());
 		modules[1].module_loader_info.entrypoint = (void*)&(loader_info[1]);
+		modules[1].module_thread_config = NULL;
 
         links[0].module_source = "simulator1";
         links[0].module_sink = "metrics1";
@@ -143,6 +145,7 @@ TEST_FUNCTION(Performance_e2e_10_second_run)
 		modules[0].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[0].moduleLibraryFileName = STRING_construct(simulator_module_path());
 		modules[0].module_loader_info.entrypoint = (void*)&(loader_info[0]);
+		modules[0].module_thread_config = NULL;
 
         // metrics
 		modules[1].module_name = "metrics1";
@@ -150,6 +153,7 @@ TEST_FUNCTION(Performance_e2e_10_second_run)
 		modules[1].module_loader_info.loader = DynamicLoader_Get();
 		loader_info[1].moduleLibraryFileName = STRING_construct(metrics_module_path());
 		modules[1].module_loader_info.entrypoint = (void*)&(loader_info[1]);
+		modules[1].module_thread_config = NULL;
 
         links[0].module_source = "simulator1";
         links[0].module_sink = "metrics1";
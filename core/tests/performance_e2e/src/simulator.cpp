@@ -14,6 +14,9 @@
 #include "azure_c_shared_utility/map.h"
 #include "message.h"
 #include "module.h"
+#ifdef GATEWAY_ALLOC_PROFILING
+#include "alloc_profile.h"
+#endif
 
 #include "simulator.h"
 
@@ -270,6 +273,10 @@ static int SimulatorModule_thread(void * context)
     int thread_result;
     SIMULATOR_MODULE_HANDLE * module = (SIMULATOR_MODULE_HANDLE *)context;
     MESSAGE_CONFIG message_to_send;
+#ifdef GATEWAY_ALLOC_PROFILING
+    /* messages built on this thread are charged to the simulator, not left unattributed */
+    (void)AllocProfile_SetThreadScope(AllocProfile_FindScope(module));
+#endif
 
     thread_result = SimulatorModule_create_message(module, &message_to_send);
     if (thread_result != 0)
@@ -0,0 +1,391 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define GATEWAY_EXPORT_H
+#define GATEWAY_EXPORT
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "worker_pool.h"
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define WAIT_TIMEOUT_MS 10000
+
+/*the pool only ever destroys messages, so the tests use messages that just count that*/
+struct MESSAGE_HANDLE_DATA_TAG
+{
+    size_t sequence;
+};
+
+static LOCK_HANDLE g_lock;
+static size_t g_destroyed_count;
+
+void Message_Destroy(MESSAGE_HANDLE message)
+{
+    (void)Lock(g_lock);
+    g_destroyed_count++;
+    (void)Unlock(g_lock);
+    free(message);
+}
+
+static MESSAGE_HANDLE create_message(size_t sequence)
+{
+    MESSAGE_HANDLE result = (MESSAGE_HANDLE)malloc(sizeof(struct MESSAGE_HANDLE_DATA_TAG));
+    ASSERT_IS_NOT_NULL(result);
+    result->sequence = sequence;
+    return result;
+}
+
+typedef struct TEST_RECEIVER_TAG
+{
+    size_t received_count;
+    size_t out_of_order_count;
+    size_t overlap_count;
+    bool in_receive;
+    /*messages are forwarded to this mailbox when it is not NULL*/
+    WORKER_MAILBOX_HANDLE forward_to;
+    /*the callback waits on this until g_gate_open when it is true*/
+    bool wait_for_gate;
+} TEST_RECEIVER;
+
+static COND_HANDLE g_gate;
+static bool g_gate_open;
+static bool g_gate_reached;
+
+static void test_receive(void* context, MESSAGE_HANDLE message)
+{
+    TEST_RECEIVER* receiver = (TEST_RECEIVER*)context;
+
+    (void)Lock(g_lock);
+    if (receiver->in_receive)
+    {
+        receiver->overlap_count++;
+    }
+    receiver->in_receive = true;
+    if (message->sequence != receiver->received_count)
+    {
+        receiver->out_of_order_count++;
+    }
+    if (receiver->wait_for_gate)
+    {
+        g_gate_reached = true;
+        while (!g_gate_open)
+        {
+            (void)Condition_Wait(g_gate, g_lock, 0);
+        }
+    }
+    (void)Unlock(g_lock);
+
+    if (receiver->forward_to != NULL)
+    {
+        ASSERT_ARE_EQUAL(int, 0, WorkerMailbox_Post(receiver->forward_to, create_message(message->sequence)));
+    }
+
+    (void)Lock(g_lock);
+    receiver->received_count++;
+    receiver->in_receive = false;
+    (void)Unlock(g_lock);
+}
+
+/*polls *value until it reaches expected, returns what it read last*/
+static size_t wait_for_count(const size_t* value, size_t expected)
+{
+    size_t result;
+    size_t waited = 0;
+    for (;;)
+    {
+        (void)Lock(g_lock);
+        result = *value;
+        (void)Unlock(g_lock);
+        if (result >= expected || waited >= WAIT_TIMEOUT_MS)
+        {
+            break;
+        }
+        ThreadAPI_Sleep(1);
+        waited++;
+    }
+    return result;
+}
+
+static bool read_flag(const bool* flag)
+{
+    bool result;
+    (void)Lock(g_lock);
+    result = *flag;
+    (void)Unlock(g_lock);
+    return result;
+}
+
+static int parse_worker_threads(const char* gateway_json, size_t* worker_count)
+{
+    JSON_Value* json = json_parse_string(gateway_json);
+    int result;
+    ASSERT_IS_NOT_NULL(json);
+    result = WorkerPool_ParseFromJson(json, worker_count);
+    json_value_free(json);
+    return result;
+}
+
+BEGIN_TEST_SUITE(worker_pool_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+    g_lock = Lock_Init();
+    ASSERT_IS_NOT_NULL(g_lock);
+    g_gate = Condition_Init();
+    ASSERT_IS_NOT_NULL(g_gate);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    Condition_Deinit(g_gate);
+    (void)Lock_Deinit(g_lock);
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_destroyed_count = 0;
+    g_gate_open = false;
+    g_gate_reached = false;
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_WORKER_POOL_30_001: [ If gateway_json or worker_count is NULL, WorkerPool_ParseFromJson shall return a non-zero value. ]*/
+/*Tests_SRS_WORKER_POOL_30_002: [ If the gateway JSON has no "broker" object or the object has no "worker_threads", WorkerPool_ParseFromJson shall set *worker_count to 0 and return 0. ]*/
+/*Tests_SRS_WORKER_POOL_30_003: [ WorkerPool_ParseFromJson shall set *worker_count to the "worker_threads" number of the "broker" object. ]*/
+TEST_FUNCTION(WorkerPool_ParseFromJson_reads_worker_threads)
+{
+    size_t worker_count;
+    JSON_Value* json = json_parse_string("{}");
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, WorkerPool_ParseFromJson(NULL, &worker_count));
+    ASSERT_ARE_NOT_EQUAL(int, 0, WorkerPool_ParseFromJson(json, NULL));
+
+    worker_count = 7;
+    ASSERT_ARE_EQUAL(int, 0, parse_worker_threads("{}", &worker_count));
+    ASSERT_ARE_EQUAL(size_t, 0, worker_count);
+
+    worker_count = 7;
+    ASSERT_ARE_EQUAL(int, 0, parse_worker_threads("{ \"broker\": {} }", &worker_count));
+    ASSERT_ARE_EQUAL(size_t, 0, worker_count);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_worker_threads("{ \"broker\": { \"worker_threads\": 4 } }", &worker_count));
+    ASSERT_ARE_EQUAL(size_t, 4, worker_count);
+
+    json_value_free(json);
+}
+
+/*Tests_SRS_WORKER_POOL_30_004: [ If "broker" is not an object, or "worker_threads" is not a whole number between 0 and 256, WorkerPool_ParseFromJson shall return a non-zero value. ]*/
+TEST_FUNCTION(WorkerPool_ParseFromJson_rejects_bad_values)
+{
+    size_t worker_count;
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_worker_threads("{ \"broker\": 4 }", &worker_count));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_worker_threads("{ \"broker\": { \"worker_threads\": \"4\" } }", &worker_count));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_worker_threads("{ \"broker\": { \"worker_threads\": -1 } }", &worker_count));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_worker_threads("{ \"broker\": { \"worker_threads\": 1.5 } }", &worker_count));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_worker_threads("{ \"broker\": { \"worker_threads\": 257 } }", &worker_count));
+}
+
+/*Tests_SRS_WORKER_POOL_30_005: [ If worker_count is 0 or more than 256, WorkerPool_Create shall return NULL. ]*/
+/*Tests_SRS_WORKER_POOL_30_008: [ If pool is NULL, WorkerPool_Destroy shall do nothing. ]*/
+/*Tests_SRS_WORKER_POOL_30_010: [ If pool or receive is NULL, WorkerMailbox_Create shall return NULL. ]*/
+/*Tests_SRS_WORKER_POOL_30_017: [ If mailbox or message is NULL, WorkerMailbox_Post shall return a non-zero value. ]*/
+/*Tests_SRS_WORKER_POOL_30_021: [ If mailbox is NULL, WorkerMailbox_Close shall do nothing. ]*/
+TEST_FUNCTION(WorkerPool_rejects_invalid_arguments)
+{
+    WORKER_POOL_HANDLE pool;
+    WORKER_MAILBOX_HANDLE mailbox;
+    TEST_RECEIVER receiver = { 0 };
+
+    ASSERT_IS_NULL(WorkerPool_Create(0));
+    ASSERT_IS_NULL(WorkerPool_Create(257));
+    WorkerPool_Destroy(NULL);
+    WorkerMailbox_Close(NULL);
+
+    pool = WorkerPool_Create(1);
+    ASSERT_IS_NOT_NULL(pool);
+    ASSERT_IS_NULL(WorkerMailbox_Create(NULL, test_receive, &receiver));
+    ASSERT_IS_NULL(WorkerMailbox_Create(pool, NULL, &receiver));
+    mailbox = WorkerMailbox_Create(pool, test_receive, &receiver);
+    ASSERT_IS_NOT_NULL(mailbox);
+    ASSERT_ARE_NOT_EQUAL(int, 0, WorkerMailbox_Post(NULL, (MESSAGE_HANDLE)&receiver));
+    ASSERT_ARE_NOT_EQUAL(int, 0, WorkerMailbox_Post(mailbox, NULL));
+
+    WorkerMailbox_Close(mailbox);
+    WorkerPool_Destroy(pool);
+    ASSERT_ARE_EQUAL(size_t, 0, receiver.received_count);
+}
+
+/*Tests_SRS_WORKER_POOL_30_006: [ WorkerPool_Create shall create worker_count threads with ModuleThread_Create. ]*/
+/*Tests_SRS_WORKER_POOL_30_009: [ WorkerPool_Destroy shall wake and join every worker thread, then free the pool. ]*/
+/*Tests_SRS_WORKER_POOL_30_014: [ A worker shall call the receive callback of a mailbox for at most 32 messages, in the order they were posted, then destroy each message. ]*/
+/*Tests_SRS_WORKER_POOL_30_019: [ WorkerMailbox_Post shall append message to the messages of the mailbox, and return a non-zero value if it cannot. ]*/
+TEST_FUNCTION(WorkerMailbox_delivers_messages_in_order)
+{
+    const size_t message_count = 1000;
+    TEST_RECEIVER receiver = { 0 };
+    WORKER_POOL_HANDLE pool = WorkerPool_Create(4);
+    WORKER_MAILBOX_HANDLE mailbox;
+    size_t i;
+    ASSERT_IS_NOT_NULL(pool);
+    mailbox = WorkerMailbox_Create(pool, test_receive, &receiver);
+    ASSERT_IS_NOT_NULL(mailbox);
+
+    for (i = 0; i < message_count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, WorkerMailbox_Post(mailbox, create_message(i)));
+    }
+
+    ASSERT_ARE_EQUAL(size_t, message_count, wait_for_count(&receiver.received_count, message_count));
+    ASSERT_ARE_EQUAL(size_t, message_count, wait_for_count(&g_destroyed_count, message_count));
+    ASSERT_ARE_EQUAL(size_t, 0, receiver.out_of_order_count);
+
+    WorkerMailbox_Close(mailbox);
+    WorkerPool_Destroy(pool);
+}
+
+/*Tests_SRS_WORKER_POOL_30_013: [ A worker shall run the mailboxes scheduled on it in the order they were scheduled, and take a mailbox scheduled on another worker when it has none. ]*/
+/*Tests_SRS_WORKER_POOL_30_015: [ If messages remain after a batch, the worker shall schedule the mailbox again behind the mailboxes already scheduled on it. ]*/
+/*Tests_SRS_WORKER_POOL_30_020: [ If the mailbox is neither scheduled nor running, WorkerMailbox_Post shall schedule it on the calling worker if the caller is a worker of the pool, or on the worker the mailbox was assigned at creation otherwise. ]*/
+TEST_FUNCTION(WorkerMailbox_callbacks_of_a_mailbox_never_overlap)
+{
+    #define MAILBOX_COUNT 8
+    const size_t message_count = 500;
+    TEST_RECEIVER receivers[MAILBOX_COUNT] = { { 0 } };
+    WORKER_MAILBOX_HANDLE mailboxes[MAILBOX_COUNT];
+    WORKER_POOL_HANDLE pool = WorkerPool_Create(4);
+    size_t i;
+    size_t j;
+    ASSERT_IS_NOT_NULL(pool);
+    for (j = 0; j < MAILBOX_COUNT; j++)
+    {
+        mailboxes[j] = WorkerMailbox_Create(pool, test_receive, &receivers[j]);
+        ASSERT_IS_NOT_NULL(mailboxes[j]);
+    }
+
+    for (i = 0; i < message_count; i++)
+    {
+        for (j = 0; j < MAILBOX_COUNT; j++)
+        {
+            ASSERT_ARE_EQUAL(int, 0, WorkerMailbox_Post(mailboxes[j], create_message(i)));
+        }
+    }
+
+    for (j = 0; j < MAILBOX_COUNT; j++)
+    {
+        ASSERT_ARE_EQUAL(size_t, message_count, wait_for_count(&receivers[j].received_count, message_count));
+        ASSERT_ARE_EQUAL(size_t, 0, receivers[j].out_of_order_count);
+        ASSERT_ARE_EQUAL(size_t, 0, receivers[j].overlap_count);
+        WorkerMailbox_Close(mailboxes[j]);
+    }
+    WorkerPool_Destroy(pool);
+    ASSERT_ARE_EQUAL(size_t, message_count * MAILBOX_COUNT, g_destroyed_count);
+    #undef MAILBOX_COUNT
+}
+
+/*Tests_SRS_WORKER_POOL_30_020: [ If the mailbox is neither scheduled nor running, WorkerMailbox_Post shall schedule it on the calling worker if the caller is a worker of the pool, or on the worker the mailbox was assigned at creation otherwise. ]*/
+TEST_FUNCTION(WorkerMailbox_Post_from_a_callback_delivers_in_order)
+{
+    const size_t message_count = 300;
+    TEST_RECEIVER sink = { 0 };
+    TEST_RECEIVER source = { 0 };
+    WORKER_POOL_HANDLE pool = WorkerPool_Create(2);
+    WORKER_MAILBOX_HANDLE sink_mailbox;
+    WORKER_MAILBOX_HANDLE source_mailbox;
+    size_t i;
+    ASSERT_IS_NOT_NULL(pool);
+    sink_mailbox = WorkerMailbox_Create(pool, test_receive, &sink);
+    ASSERT_IS_NOT_NULL(sink_mailbox);
+    source.forward_to = sink_mailbox;
+    source_mailbox = WorkerMailbox_Create(pool, test_receive, &source);
+    ASSERT_IS_NOT_NULL(source_mailbox);
+
+    for (i = 0; i < message_count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, WorkerMailbox_Post(source_mailbox, create_message(i)));
+    }
+
+    ASSERT_ARE_EQUAL(size_t, message_count, wait_for_count(&sink.received_count, message_count));
+    ASSERT_ARE_EQUAL(size_t, 0, sink.out_of_order_count);
+
+    WorkerMailbox_Close(source_mailbox);
+    WorkerMailbox_Close(sink_mailbox);
+    WorkerPool_Destroy(pool);
+    ASSERT_ARE_EQUAL(size_t, 2 * message_count, g_destroyed_count);
+}
+
+/*Tests_SRS_WORKER_POOL_30_022: [ WorkerMailbox_Close shall mark the mailbox closed and destroy the messages that were not delivered. ]*/
+/*Tests_SRS_WORKER_POOL_30_023: [ If a worker is running the receive callback of the mailbox, WorkerMailbox_Close shall wait for it to return, unless it is called from that callback. ]*/
+/*Tests_SRS_WORKER_POOL_30_024: [ The mailbox shall be freed once it is closed and no worker holds it. ]*/
+TEST_FUNCTION(WorkerMailbox_Close_drops_pending_messages_and_waits_for_the_callback)
+{
+    TEST_RECEIVER blocked = { 0 };
+    TEST_RECEIVER pending = { 0 };
+    WORKER_POOL_HANDLE pool = WorkerPool_Create(1);
+    WORKER_MAILBOX_HANDLE blocked_mailbox;
+    WORKER_MAILBOX_HANDLE pending_mailbox;
+    size_t i;
+    ASSERT_IS_NOT_NULL(pool);
+    blocked.wait_for_gate = true;
+    blocked_mailbox = WorkerMailbox_Create(pool, test_receive, &blocked);
+    ASSERT_IS_NOT_NULL(blocked_mailbox);
+    pending_mailbox = WorkerMailbox_Create(pool, test_receive, &pending);
+    ASSERT_IS_NOT_NULL(pending_mailbox);
+
+    /*the only worker blocks in the first callback, so nothing else is delivered*/
+    ASSERT_ARE_EQUAL(int, 0, WorkerMailbox_Post(blocked_mailbox, create_message(0)));
+    while (!read_flag(&g_gate_reached))
+    {
+        ThreadAPI_Sleep(1);
+    }
+    for (i = 0; i < 3; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, WorkerMailbox_Post(pending_mailbox, create_message(i)));
+    }
+
+    WorkerMailbox_Close(pending_mailbox);
+    ASSERT_ARE_EQUAL(size_t, 3, g_destroyed_count);
+
+    (void)Lock(g_lock);
+    g_gate_open = true;
+    (void)Condition_Post(g_gate);
+    (void)Unlock(g_lock);
+    WorkerMailbox_Close(blocked_mailbox);
+    ASSERT_IS_FALSE(read_flag(&blocked.in_receive));
+    ASSERT_ARE_EQUAL(size_t, 1, blocked.received_count);
+
+    WorkerPool_Destroy(pool);
+    ASSERT_ARE_EQUAL(size_t, 0, pending.received_count);
+    ASSERT_ARE_EQUAL(size_t, 4, g_destroyed_count);
+}
+
+END_TEST_SUITE(worker_pool_ut)
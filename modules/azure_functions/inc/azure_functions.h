@@ -6,6 +6,7 @@
 
 #include "module.h"
 #include "azure_c_shared_utility/strings.h"
+#include "azure_functions_sender.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -17,6 +18,7 @@ typedef struct AZURE_FUNCTIONS_CONFIG_TAG
     STRING_HANDLE hostAddress;
     STRING_HANDLE relativePath;
     STRING_HANDLE securityKey;
+    AZURE_FUNCTIONS_SENDER_CONFIG sender;
 } AZURE_FUNCTIONS_CONFIG;
 
 MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(AZUREFUNCTIONS_MODULE)(MODULE_API_VERSION gateway_api_version);
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef AZURE_FUNCTIONS_SENDER_H
+#define AZURE_FUNCTIONS_SENDER_H
+
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+#include "parson.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#endif
+
+#define AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_CONNECTIONS 2
+#define AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_BATCH 1
+#define AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_QUEUE 1000
+
+typedef struct AZURE_FUNCTIONS_SENDER_CONFIG_TAG
+{
+    /*requests in flight at once, each on its own kept alive connection*/
+    size_t maxConnections;
+    /*the most messages in one POST, 1 posts each message as it is, more post a JSON array*/
+    size_t maxBatch;
+    /*messages waiting to be posted, more are dropped*/
+    size_t maxQueue;
+} AZURE_FUNCTIONS_SENDER_CONFIG;
+
+typedef struct AZURE_FUNCTIONS_SENDER_TAG* AZURE_FUNCTIONS_SENDER_HANDLE;
+
+/* configuration */
+MOCKABLE_FUNCTION(, int, AzureFunctionsSender_ParseConfigurationFromJson, const JSON_Object*, json, AZURE_FUNCTIONS_SENDER_CONFIG*, config);
+
+/* creation, the strings are copied */
+MOCKABLE_FUNCTION(, AZURE_FUNCTIONS_SENDER_HANDLE, AzureFunctionsSender_Create, const AZURE_FUNCTIONS_SENDER_CONFIG*, config, STRING_HANDLE, hostAddress, STRING_HANDLE, relativePath, STRING_HANDLE, securityKey);
+
+/* queues a JSON object to be posted, the sender owns it when this returns 0 */
+MOCKABLE_FUNCTION(, int, AzureFunctionsSender_Send, AZURE_FUNCTIONS_SENDER_HANDLE, handle, STRING_HANDLE, json);
+
+/* destruction, posts what is queued first */
+MOCKABLE_FUNCTION(, void, AzureFunctionsSender_Destroy, AZURE_FUNCTIONS_SENDER_HANDLE, handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*AZURE_FUNCTIONS_SENDER_H*/
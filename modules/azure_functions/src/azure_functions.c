@@ -11,11 +11,10 @@
 #include "message.h"
 #include "broker.h"
 #include "azure_functions.h"
+#include "azure_functions_sender.h"
 #include "azure_c_shared_utility/constmap.h"
 #include "azure_c_shared_utility/constbuffer.h"
 #include "azure_c_shared_utility/xlogging.h"
-#include "azure_c_shared_utility/vector.h"
-#include "azure_c_shared_utility/httpapiex.h"
 #include "azure_c_shared_utility/base64.h"
 
 #include <parson.h>
@@ -24,6 +23,8 @@ typedef struct AZURE_FUNCTIONS_DATA_TAG
 {
     BROKER_HANDLE broker;
     AZURE_FUNCTIONS_CONFIG *azureFunctionsConfiguration;
+    /*posts the messages from its own threads*/
+    AZURE_FUNCTIONS_SENDER_HANDLE sender;
 } AZURE_FUNCTIONS_DATA;
 
 #define AZURE_FUNCTIONS_RESULT_VALUES \
@@ -114,22 +115,37 @@ static MODULE_HANDLE AzureFunctions_Create(BROKER_HANDLE broker, const void* con
                                     free(result);
                                     result = NULL;
                                 }
-                                else
-                                {
-                                    /* Codes_SRS_AZUREFUNCTIONS_04_001: [ Upon success, this function shall return a valid pointer to a MODULE_HANDLE. ] */
-                                    result->broker = broker;
-                                }
                             }
                             else
                             {
                                 result->azureFunctionsConfiguration->securityKey = NULL;
-                                /* Codes_SRS_AZUREFUNCTIONS_04_001: [ Upon success, this function shall return a valid pointer to a MODULE_HANDLE. ] */
-                                result->broker = broker;
                             }
                         }
                     }
                 }
             }
+
+            if (result != NULL)
+            {
+                /* Codes_SRS_AZUREFUNCTIONS_37_019: [ AzureFunctions_Create shall start posting by calling AzureFunctionsSender_Create with the sender settings of the configuration and the copied strings. ] */
+                result->sender = AzureFunctionsSender_Create(&config->sender, result->azureFunctionsConfiguration->hostAddress, result->azureFunctionsConfiguration->relativePath, result->azureFunctionsConfiguration->securityKey);
+                if (result->sender == NULL)
+                {
+                    /* Codes_SRS_AZUREFUNCTIONS_37_020: [ If AzureFunctionsSender_Create fails, AzureFunctions_Create shall fail and return NULL. ] */
+                    LogError("unable to create the sender.");
+                    STRING_delete(result->azureFunctionsConfiguration->securityKey);
+                    STRING_delete(result->azureFunctionsConfiguration->relativePath);
+                    STRING_delete(result->azureFunctionsConfiguration->hostAddress);
+                    free(result->azureFunctionsConfiguration);
+                    free(result);
+                    result = NULL;
+                }
+                else
+                {
+                    /* Codes_SRS_AZUREFUNCTIONS_04_001: [ Upon success, this function shall return a valid pointer to a MODULE_HANDLE. ] */
+                    result->broker = broker;
+                }
+            }
         }
     }
     return result;
@@ -211,6 +227,13 @@ static void * AzureFunctions_ParseConfigurationFromJson(const char* configuratio
                                 LogError("error buliding relative path String.");
                                 result = NULL;
                             }
+                            /* Codes_SRS_AZUREFUNCTIONS_37_017: [ AzureFunctions_ParseConfigurationFromJson shall read the sender settings by calling AzureFunctionsSender_ParseConfigurationFromJson. ] */
+                            else if (AzureFunctionsSender_ParseConfigurationFromJson(obj, &config.sender) != 0)
+                            {
+                                /* Codes_SRS_AZUREFUNCTIONS_37_018: [ If AzureFunctionsSender_ParseConfigurationFromJson fails, AzureFunctions_ParseConfigurationFromJson shall fail and return NULL. ] */
+                                LogError("invalid sender settings.");
+                                result = NULL;
+                            }
                             else
                             {
                                 /* Codes_SRS_AZUREFUNCTIONS_17_001: [ AzureFunctions_ParseConfigurationFromJson shall allocate an AZURE_FUNCTIONS_CONFIG structure. ]*/
@@ -269,6 +292,8 @@ static void AzureFunctions_Destroy(MODULE_HANDLE moduleHandle)
     {
         /* Codes_SRS_AZUREFUNCTIONS_04_009: [ azureFunctions_Destroy shall release all resources allocated for the module. ] */
         AZURE_FUNCTIONS_DATA * moduleData = (AZURE_FUNCTIONS_DATA*)moduleHandle;
+        /* Codes_SRS_AZUREFUNCTIONS_37_022: [ AzureFunctions_Destroy shall call AzureFunctionsSender_Destroy, which posts the queued messages, before releasing the strings. ] */
+        AzureFunctionsSender_Destroy(moduleData->sender);
         STRING_delete(moduleData->azureFunctionsConfiguration->hostAddress);
         STRING_delete(moduleData->azureFunctionsConfiguration->relativePath);
         STRING_delete(moduleData->azureFunctionsConfiguration->securityKey);
@@ -335,105 +360,20 @@ static void AzureFunctions_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE me
                         ))
                     {
                         LogError("STRING concatenation error");
+                        /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
+                        STRING_delete(jsonToBeAppended);
+                    }
+                    /* Codes_SRS_AZUREFUNCTIONS_37_021: [ AzureFunctions_Receive shall queue the JSON STRING to be posted by calling AzureFunctionsSender_Send, which does not wait for the network. ] */
+                    else if (AzureFunctionsSender_Send(module_data->sender, jsonToBeAppended) != 0)
+                    {
+                        /* Codes_SRS_AZUREFUNCTIONS_37_023: [ If AzureFunctionsSender_Send fails, AzureFunctions_Receive shall log the error and destroy the JSON STRING. ] */
+                        LogError("unable to queue the message, it is dropped.");
+                        STRING_delete(jsonToBeAppended);
                     }
                     else
                     {
-                        /* Codes_SRS_AZUREFUNCTIONS_04_014: [ azureFunctions_Receive shall call HTTPAPIEX_Create, passing hostAddress, it if fails it shall fail and return. ] */
-                        HTTPAPIEX_HANDLE myHTTPEXHandle = HTTPAPIEX_Create(STRING_c_str(module_data->azureFunctionsConfiguration->hostAddress));
-                        if (myHTTPEXHandle == NULL)
-                        {
-                            LogError("Failed to create HTTPAPIEX handle.");
-                        }
-                        else
-                        {
-                            /* Codes_SRS_AZUREFUNCTIONS_04_015: [ azureFunctions_Receive shall call allocate memory to receive data from HTTPAPI by calling BUFFER_new, if it fail it shall fail and return. ] */
-                            BUFFER_HANDLE myResponseBuffer = BUFFER_new();
-
-                            if (myResponseBuffer == NULL)
-                            {
-                                LogError("Failed to create response Buffer.");
-                            }
-                            else
-                            {
-                                /* Codes_SRS_AZUREFUNCTIONS_04_016: [ azureFunctions_Receive shall add name to relative path, if it fail it shall fail and return. ] */
-                                STRING_HANDLE relativePathInfoForRequest = STRING_clone(module_data->azureFunctionsConfiguration->relativePath);
-
-                                if (relativePathInfoForRequest == NULL)
-                                {
-                                    LogError("Error building request String.");
-                                }
-                                else
-                                {
-                                    if ((STRING_concat(relativePathInfoForRequest, "?name=myGatewayDevice") != 0))
-                                    {
-                                        LogError("Error building request String.");
-                                    }
-                                    else
-                                    {
-                                        //Adding HTTP HEaders here. 
-                                        HTTP_HEADERS_HANDLE httpHeaders = HTTPHeaders_Alloc();
-
-                                        if (httpHeaders == NULL)
-                                        {
-                                            LogError("Error creating HttpHeaders");
-                                        }
-                                        else
-                                        {
-                                            /* Codes_SRS_AZUREFUNCTIONS_04_025: [ AzureFunctions_Receive shall add 2 HTTP Headers to POST Request. Content-Type:application/json and, if securityKey exists x-functions-key:securityKey. If it fails it shall fail and return. ] */
-                                            if (HTTPHeaders_AddHeaderNameValuePair(httpHeaders, "Content-Type", "application/json") != HTTP_HEADERS_OK)
-                                            {
-                                                LogError("Error Adding Content-Type header.");
-                                            }
-                                            else if (module_data->azureFunctionsConfiguration->securityKey != NULL &&
-                                                (HTTPHeaders_AddHeaderNameValuePair(httpHeaders, "x-functions-key", STRING_c_str(module_data->azureFunctionsConfiguration->securityKey)) != HTTP_HEADERS_OK))
-                                            {
-                                                LogError("Error Adding Content-Type.");
-                                            }
-                                            else
-                                            {
-
-                                                //Add here the content on the body.
-                                                size_t appendLength = STRING_length(jsonToBeAppended);
-                                                BUFFER_HANDLE postContent = BUFFER_create((const unsigned char*)STRING_c_str(jsonToBeAppended), appendLength);
-
-                                                if (postContent == NULL)
-                                                {
-                                                    LogError("Error building post content.");
-                                                }
-                                                else
-                                                {
-                                                    unsigned int statuscodeBack = 0;
-                                                    /* Codes_SRS_AZUREFUNCTIONS_04_017: [ azureFunctions_Receive shall HTTPAPIEX_ExecuteRequest to send the HTTP POST to Azure Functions. If it fail it shall fail and return. ] */
-                                                    HTTPAPIEX_RESULT requestResult = HTTPAPIEX_ExecuteRequest(myHTTPEXHandle, HTTPAPI_REQUEST_POST, STRING_c_str(relativePathInfoForRequest), httpHeaders, postContent, &statuscodeBack, NULL, myResponseBuffer);
-
-                                                    if (requestResult != HTTPAPIEX_OK || statuscodeBack != 200)
-                                                    {
-                                                        LogError("Error Sending Request. Status Code: %d", statuscodeBack);
-                                                    }
-                                                    else
-                                                    {
-                                                        /* Codes_SRS_AZUREFUNCTIONS_04_018: [ Upon success azureFunctions_Receive shall log the response from HTTP POST and return. ] */
-                                                        LogInfo("Request Sent to Function Succesfully. Response from Functions: %s", BUFFER_u_char(myResponseBuffer));
-                                                    }
-                                                    BUFFER_delete(postContent);
-                                                }
-                                            }
-                                            /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
-                                            HTTPHeaders_Free(httpHeaders);
-                                        }
-                                    }
-                                    /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
-                                    STRING_delete(relativePathInfoForRequest);
-                                }
-                                /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
-                                BUFFER_delete(myResponseBuffer);
-                            }
-                            /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
-                            HTTPAPIEX_Destroy(myHTTPEXHandle);
-                        }
+                        /*the sender owns jsonToBeAppended now*/
                     }
-                    /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
-                    STRING_delete(jsonToBeAppended);
                 }
                 /* Codes_SRS_AZUREFUNCTIONS_04_019: [ azureFunctions_Receive shall destroy any allocated memory before returning. ] */
                 STRING_delete(contentAsJSON);
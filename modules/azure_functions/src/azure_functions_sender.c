@@ -0,0 +1,561 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "azure_functions_sender.h"
+#include "module_thread.h"
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/httpheaders.h"
+#include "azure_c_shared_utility/httpapiex.h"
+
+/*
+ * The broker thread only queues the JSON object of a message. Each worker
+ * owns one HTTPAPIEX handle, which keeps its connection open between
+ * requests, and posts whatever is queued when it gets to it: messages that
+ * arrive while every worker is busy go out together in the next POST.
+ */
+
+#define AZURE_FUNCTIONS_SENDER_MAX_CONNECTIONS 64
+#define AZURE_FUNCTIONS_SENDER_MAX_BATCH 1000
+#define AZURE_FUNCTIONS_SENDER_MAX_QUEUE 1000000
+
+typedef struct AZURE_FUNCTIONS_SENDER_TAG AZURE_FUNCTIONS_SENDER;
+
+typedef struct SENDER_WORKER_TAG
+{
+    AZURE_FUNCTIONS_SENDER* sender;
+    HTTPAPIEX_HANDLE connection;
+    HTTP_HEADERS_HANDLE headers;
+    /*maxBatch of them*/
+    STRING_HANDLE* batch;
+    THREAD_HANDLE thread;
+} SENDER_WORKER;
+
+struct AZURE_FUNCTIONS_SENDER_TAG
+{
+    size_t maxBatch;
+    size_t maxQueue;
+    STRING_HANDLE requestPath;
+    LOCK_HANDLE lock;
+    COND_HANDLE wake;
+    /*a ring of maxQueue JSON objects*/
+    STRING_HANDLE* queue;
+    size_t first;
+    size_t count;
+    bool stopping;
+    SENDER_WORKER* workers;
+    /*the workers that are running*/
+    size_t workerCount;
+};
+
+static int read_size(const JSON_Value* value, size_t minimum, size_t maximum, size_t* result_value)
+{
+    int result;
+    double number;
+    if (json_value_get_type(value) != JSONNumber)
+    {
+        result = __LINE__;
+    }
+    else if (
+        ((number = json_value_get_number(value)) < (double)minimum) ||
+        (number > (double)maximum) ||
+        ((double)(size_t)number != number)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *result_value = (size_t)number;
+        result = 0;
+    }
+    return result;
+}
+
+int AzureFunctionsSender_ParseConfigurationFromJson(const JSON_Object* json, AZURE_FUNCTIONS_SENDER_CONFIG* config)
+{
+    int result;
+    /*Codes_SRS_AZUREFUNCTIONS_37_001: [ If json or config is NULL then AzureFunctionsSender_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+    if (
+        (json == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg json=%p config=%p", json, config);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Value* maxConnections = json_object_get_value(json, "maxConnections");
+        JSON_Value* maxBatch = json_object_get_value(json, "maxBatch");
+        JSON_Value* maxQueue = json_object_get_value(json, "maxQueue");
+
+        /*Codes_SRS_AZUREFUNCTIONS_37_002: [ Values that are not present shall default to maxConnections AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_CONNECTIONS, maxBatch AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_BATCH and maxQueue AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_QUEUE. ]*/
+        config->maxConnections = AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_CONNECTIONS;
+        config->maxBatch = AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_BATCH;
+        config->maxQueue = AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_QUEUE;
+
+        /*Codes_SRS_AZUREFUNCTIONS_37_003: [ If a value is present and is not a whole number in range then AzureFunctionsSender_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        if (
+            (maxConnections != NULL) &&
+            (read_size(maxConnections, 1, AZURE_FUNCTIONS_SENDER_MAX_CONNECTIONS, &config->maxConnections) != 0)
+            )
+        {
+            LogError("\"maxConnections\" must be a whole number from 1 to %d", AZURE_FUNCTIONS_SENDER_MAX_CONNECTIONS);
+            result = __LINE__;
+        }
+        else if (
+            (maxBatch != NULL) &&
+            (read_size(maxBatch, 1, AZURE_FUNCTIONS_SENDER_MAX_BATCH, &config->maxBatch) != 0)
+            )
+        {
+            LogError("\"maxBatch\" must be a whole number from 1 to %d", AZURE_FUNCTIONS_SENDER_MAX_BATCH);
+            result = __LINE__;
+        }
+        else if (
+            (maxQueue != NULL) &&
+            (read_size(maxQueue, 1, AZURE_FUNCTIONS_SENDER_MAX_QUEUE, &config->maxQueue) != 0)
+            )
+        {
+            LogError("\"maxQueue\" must be a whole number from 1 to %d", AZURE_FUNCTIONS_SENDER_MAX_QUEUE);
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_AZUREFUNCTIONS_37_004: [ Otherwise AzureFunctionsSender_ParseConfigurationFromJson shall succeed and return 0. ]*/
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static BUFFER_HANDLE SENDER_build_body(const AZURE_FUNCTIONS_SENDER* sender, STRING_HANDLE* batch, size_t count)
+{
+    BUFFER_HANDLE result;
+    if (sender->maxBatch == 1)
+    {
+        /*Codes_SRS_AZUREFUNCTIONS_37_012: [ When maxBatch is 1 the body of the POST shall be the JSON object of the message, otherwise it shall be a JSON array of the JSON objects of the messages. ]*/
+        result = BUFFER_create((const unsigned char*)STRING_c_str(batch[0]), STRING_length(batch[0]));
+    }
+    else
+    {
+        size_t size = 2 + (count - 1);
+        size_t i;
+        for (i = 0; i < count; i++)
+        {
+            size += STRING_length(batch[i]);
+        }
+
+        result = BUFFER_new();
+        if (result == NULL)
+        {
+            /*return as is*/
+        }
+        else if (BUFFER_pre_build(result, size) != 0)
+        {
+            BUFFER_delete(result);
+            result = NULL;
+        }
+        else
+        {
+            unsigned char* body = BUFFER_u_char(result);
+            size_t offset = 0;
+            body[offset++] = '[';
+            for (i = 0; i < count; i++)
+            {
+                size_t length = STRING_length(batch[i]);
+                if (i > 0)
+                {
+                    body[offset++] = ',';
+                }
+                (void)memcpy(body + offset, STRING_c_str(batch[i]), length);
+                offset += length;
+            }
+            body[offset] = ']';
+        }
+    }
+    return result;
+}
+
+static void SENDER_post(SENDER_WORKER* worker, size_t count)
+{
+    AZURE_FUNCTIONS_SENDER* sender = worker->sender;
+    BUFFER_HANDLE body = SENDER_build_body(sender, worker->batch, count);
+    if (body == NULL)
+    {
+        LogError("unable to build the body of %lu messages, they are dropped", (unsigned long)count);
+    }
+    else
+    {
+        BUFFER_HANDLE response = BUFFER_new();
+        if (response == NULL)
+        {
+            LogError("unable to create the response buffer, %lu messages are dropped", (unsigned long)count);
+        }
+        else
+        {
+            unsigned int statusCode = 0;
+            /*Codes_SRS_AZUREFUNCTIONS_37_013: [ A worker shall POST the body to relativePath?name=myGatewayDevice by calling HTTPAPIEX_ExecuteRequest on its own connection, which it keeps open for its next requests. ]*/
+            HTTPAPIEX_RESULT requestResult = HTTPAPIEX_ExecuteRequest(worker->connection, HTTPAPI_REQUEST_POST, STRING_c_str(sender->requestPath), worker->headers, body, &statusCode, NULL, response);
+            if (
+                (requestResult != HTTPAPIEX_OK) ||
+                (statusCode != 200)
+                )
+            {
+                /*Codes_SRS_AZUREFUNCTIONS_37_014: [ If the request fails or its status code is not 200, the worker shall log the error and drop the messages it posted. ]*/
+                LogError("Error Sending Request of %lu messages. Status Code: %u", (unsigned long)count, statusCode);
+            }
+            else
+            {
+                size_t length = BUFFER_length(response);
+                LogInfo("Request of %lu messages Sent to Function Succesfully. Response from Functions: %.*s", (unsigned long)count, (int)length, (length == 0) ? "" : (const char*)BUFFER_u_char(response));
+            }
+            BUFFER_delete(response);
+        }
+        BUFFER_delete(body);
+    }
+}
+
+static int SENDER_worker(void* argument)
+{
+    SENDER_WORKER* worker = (SENDER_WORKER*)argument;
+    AZURE_FUNCTIONS_SENDER* sender = worker->sender;
+    bool running = true;
+    while (running)
+    {
+        size_t taken = 0;
+        if (Lock(sender->lock) != LOCK_OK)
+        {
+            LogError("unable to lock, the worker stops");
+            running = false;
+        }
+        else
+        {
+            while (
+                (sender->count == 0) &&
+                (!sender->stopping)
+                )
+            {
+                (void)Condition_Wait(sender->wake, sender->lock, 0);
+            }
+
+            /*Codes_SRS_AZUREFUNCTIONS_37_011: [ A worker shall take up to maxBatch queued messages, in the order they were sent. ]*/
+            while (
+                (taken < sender->maxBatch) &&
+                (sender->count > 0)
+                )
+            {
+                worker->batch[taken++] = sender->queue[sender->first];
+                sender->first = (sender->first + 1) % sender->maxQueue;
+                sender->count--;
+            }
+
+            if (taken == 0)
+            {
+                /*stopping and nothing left, pass the wake up on to the next worker*/
+                running = false;
+                (void)Condition_Post(sender->wake);
+            }
+            else if (sender->count > 0)
+            {
+                (void)Condition_Post(sender->wake);
+            }
+            (void)Unlock(sender->lock);
+
+            if (taken > 0)
+            {
+                size_t i;
+                SENDER_post(worker, taken);
+                for (i = 0; i < taken; i++)
+                {
+                    STRING_delete(worker->batch[i]);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static void SENDER_free_worker(SENDER_WORKER* worker)
+{
+    HTTPAPIEX_Destroy(worker->connection);
+    HTTPHeaders_Free(worker->headers);
+    free(worker->batch);
+}
+
+static int SENDER_start_worker(AZURE_FUNCTIONS_SENDER* sender, SENDER_WORKER* worker, STRING_HANDLE hostAddress, STRING_HANDLE securityKey)
+{
+    int result;
+    worker->sender = sender;
+    worker->batch = (STRING_HANDLE*)malloc(sender->maxBatch * sizeof(STRING_HANDLE));
+    if (worker->batch == NULL)
+    {
+        LogError("unable to allocate the batch of a worker");
+        result = __LINE__;
+    }
+    else
+    {
+        worker->headers = HTTPHeaders_Alloc();
+        if (worker->headers == NULL)
+        {
+            LogError("Error creating HttpHeaders");
+            free(worker->batch);
+            result = __LINE__;
+        }
+        else if (HTTPHeaders_AddHeaderNameValuePair(worker->headers, "Content-Type", "application/json") != HTTP_HEADERS_OK)
+        {
+            LogError("Error Adding Content-Type header.");
+            HTTPHeaders_Free(worker->headers);
+            free(worker->batch);
+            result = __LINE__;
+        }
+        else if (
+            (securityKey != NULL) &&
+            (HTTPHeaders_AddHeaderNameValuePair(worker->headers, "x-functions-key", STRING_c_str(securityKey)) != HTTP_HEADERS_OK)
+            )
+        {
+            LogError("Error Adding x-functions-key header.");
+            HTTPHeaders_Free(worker->headers);
+            free(worker->batch);
+            result = __LINE__;
+        }
+        else
+        {
+            worker->connection = HTTPAPIEX_Create(STRING_c_str(hostAddress));
+            if (worker->connection == NULL)
+            {
+                LogError("Failed to create HTTPAPIEX handle.");
+                HTTPHeaders_Free(worker->headers);
+                free(worker->batch);
+                result = __LINE__;
+            }
+            else if (ModuleThread_Create(&worker->thread, SENDER_worker, worker) != THREADAPI_OK)
+            {
+                LogError("unable to start a worker");
+                SENDER_free_worker(worker);
+                result = __LINE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+/*lets the running workers post what is queued and waits for them*/
+static void SENDER_stop_workers(AZURE_FUNCTIONS_SENDER* sender)
+{
+    size_t i;
+    if (Lock(sender->lock) != LOCK_OK)
+    {
+        LogError("unable to lock, stopping the workers anyway");
+        sender->stopping = true;
+        (void)Condition_Post(sender->wake);
+    }
+    else
+    {
+        sender->stopping = true;
+        (void)Condition_Post(sender->wake);
+        (void)Unlock(sender->lock);
+    }
+
+    for (i = 0; i < sender->workerCount; i++)
+    {
+        int notUsed;
+        if (ThreadAPI_Join(sender->workers[i].thread, &notUsed) != THREADAPI_OK)
+        {
+            LogError("unable to join worker %lu", (unsigned long)i);
+        }
+        SENDER_free_worker(&sender->workers[i]);
+    }
+    sender->workerCount = 0;
+}
+
+static void SENDER_free(AZURE_FUNCTIONS_SENDER* sender)
+{
+    /*only a worker that could not lock leaves messages behind*/
+    while (sender->count > 0)
+    {
+        STRING_delete(sender->queue[sender->first]);
+        sender->first = (sender->first + 1) % sender->maxQueue;
+        sender->count--;
+    }
+    free(sender->workers);
+    Condition_Deinit(sender->wake);
+    (void)Lock_Deinit(sender->lock);
+    free(sender->queue);
+    STRING_delete(sender->requestPath);
+    free(sender);
+}
+
+AZURE_FUNCTIONS_SENDER_HANDLE AzureFunctionsSender_Create(const AZURE_FUNCTIONS_SENDER_CONFIG* config, STRING_HANDLE hostAddress, STRING_HANDLE relativePath, STRING_HANDLE securityKey)
+{
+    AZURE_FUNCTIONS_SENDER* result;
+    /*Codes_SRS_AZUREFUNCTIONS_37_005: [ If config, hostAddress or relativePath is NULL, or any limit of config is 0, then AzureFunctionsSender_Create shall fail and return NULL. ]*/
+    if (
+        (config == NULL) ||
+        (hostAddress == NULL) ||
+        (relativePath == NULL)
+        )
+    {
+        LogError("invalid arg config=%p hostAddress=%p relativePath=%p", config, hostAddress, relativePath);
+        result = NULL;
+    }
+    else if (
+        (config->maxConnections == 0) ||
+        (config->maxBatch == 0) ||
+        (config->maxQueue == 0)
+        )
+    {
+        LogError("invalid limits maxConnections=%lu maxBatch=%lu maxQueue=%lu", (unsigned long)config->maxConnections, (unsigned long)config->maxBatch, (unsigned long)config->maxQueue);
+        result = NULL;
+    }
+    else
+    {
+        result = (AZURE_FUNCTIONS_SENDER*)malloc(sizeof(AZURE_FUNCTIONS_SENDER));
+        if (result == NULL)
+        {
+            /*Codes_SRS_AZUREFUNCTIONS_37_007: [ If any step fails then AzureFunctionsSender_Create shall release what it created, fail and return NULL. ]*/
+            LogError("unable to allocate the sender");
+        }
+        else
+        {
+            result->maxBatch = config->maxBatch;
+            result->maxQueue = config->maxQueue;
+            result->first = 0;
+            result->count = 0;
+            result->stopping = false;
+            result->workerCount = 0;
+            result->requestPath = STRING_clone(relativePath);
+            if (result->requestPath == NULL)
+            {
+                LogError("Error building request String.");
+                free(result);
+                result = NULL;
+            }
+            else if (STRING_concat(result->requestPath, "?name=myGatewayDevice") != 0)
+            {
+                LogError("Error building request String.");
+                STRING_delete(result->requestPath);
+                free(result);
+                result = NULL;
+            }
+            else if ((result->queue = (STRING_HANDLE*)malloc(config->maxQueue * sizeof(STRING_HANDLE))) == NULL)
+            {
+                LogError("unable to allocate a queue of %lu messages", (unsigned long)config->maxQueue);
+                STRING_delete(result->requestPath);
+                free(result);
+                result = NULL;
+            }
+            else if ((result->lock = Lock_Init()) == NULL)
+            {
+                LogError("unable to create the lock");
+                free(result->queue);
+                STRING_delete(result->requestPath);
+                free(result);
+                result = NULL;
+            }
+            else if ((result->wake = Condition_Init()) == NULL)
+            {
+                LogError("unable to create the condition");
+                (void)Lock_Deinit(result->lock);
+                free(result->queue);
+                STRING_delete(result->requestPath);
+                free(result);
+                result = NULL;
+            }
+            else if ((result->workers = (SENDER_WORKER*)malloc(config->maxConnections * sizeof(SENDER_WORKER))) == NULL)
+            {
+                LogError("unable to allocate %lu workers", (unsigned long)config->maxConnections);
+                Condition_Deinit(result->wake);
+                (void)Lock_Deinit(result->lock);
+                free(result->queue);
+                STRING_delete(result->requestPath);
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                /*Codes_SRS_AZUREFUNCTIONS_37_006: [ AzureFunctionsSender_Create shall open maxConnections connections with HTTPAPIEX_Create, each with the headers Content-Type: application/json and, if securityKey is not NULL, x-functions-key: securityKey, and start a worker thread for each with ModuleThread_Create. ]*/
+                while (
+                    (result->workerCount < config->maxConnections) &&
+                    (SENDER_start_worker(result, &result->workers[result->workerCount], hostAddress, securityKey) == 0)
+                    )
+                {
+                    result->workerCount++;
+                }
+
+                if (result->workerCount < config->maxConnections)
+                {
+                    /*Codes_SRS_AZUREFUNCTIONS_37_007: [ If any step fails then AzureFunctionsSender_Create shall release what it created, fail and return NULL. ]*/
+                    LogError("unable to start %lu workers", (unsigned long)config->maxConnections);
+                    SENDER_stop_workers(result);
+                    SENDER_free(result);
+                    result = NULL;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+int AzureFunctionsSender_Send(AZURE_FUNCTIONS_SENDER_HANDLE handle, STRING_HANDLE json)
+{
+    int result;
+    if (
+        (handle == NULL) ||
+        (json == NULL)
+        )
+    {
+        /*Codes_SRS_AZUREFUNCTIONS_37_008: [ If handle or json is NULL then AzureFunctionsSender_Send shall fail and return a non-zero value. ]*/
+        LogError("invalid arg handle=%p json=%p", handle, json);
+        result = __LINE__;
+    }
+    else if (Lock(handle->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+        result = __LINE__;
+    }
+    else
+    {
+        if (handle->count == handle->maxQueue)
+        {
+            /*Codes_SRS_AZUREFUNCTIONS_37_009: [ If maxQueue messages are already queued then AzureFunctionsSender_Send shall fail and return a non-zero value without waiting. ]*/
+            LogError("%lu messages are waiting to be posted, the message is dropped", (unsigned long)handle->maxQueue);
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_AZUREFUNCTIONS_37_010: [ Otherwise AzureFunctionsSender_Send shall queue json, wake a worker and return 0. ]*/
+            handle->queue[(handle->first + handle->count) % handle->maxQueue] = json;
+            handle->count++;
+            (void)Condition_Post(handle->wake);
+            result = 0;
+        }
+        (void)Unlock(handle->lock);
+    }
+    return result;
+}
+
+void AzureFunctionsSender_Destroy(AZURE_FUNCTIONS_SENDER_HANDLE handle)
+{
+    /*Codes_SRS_AZUREFUNCTIONS_37_015: [ If handle is NULL then AzureFunctionsSender_Destroy shall do nothing. ]*/
+    if (handle != NULL)
+    {
+        /*Codes_SRS_AZUREFUNCTIONS_37_016: [ AzureFunctionsSender_Destroy shall let the workers post what is queued, wait for them, close their connections and release all resources. ]*/
+        SENDER_stop_workers(handle);
+        SENDER_free(handle);
+    }
+}
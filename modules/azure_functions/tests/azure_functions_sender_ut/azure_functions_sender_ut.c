@@ -0,0 +1,403 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/httpapiex.h"
+#include "azure_functions_sender.h"
+
+#include <parson.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define TEST_MAX_REQUESTS 16
+
+/*
+ * A local stand-in for the Azure Function: these HTTPAPIEX functions take
+ * the place of the real ones, record every request and can hold requests
+ * back until the test opens the gate.
+ */
+static struct
+{
+    LOCK_HANDLE lock;
+    COND_HANDLE changed;
+    size_t connectionsCreated;
+    size_t connectionsOpen;
+    size_t requests;
+    char* bodies[TEST_MAX_REQUESTS];
+    char path[64];
+    char contentType[64];
+    char key[64];
+    bool keySent;
+    bool gateClosed;
+    unsigned int failedRequests;
+} g_function;
+
+typedef struct HTTPAPIEX_HANDLE_DATA_TAG
+{
+    char hostName[64];
+} HTTPAPIEX_HANDLE_DATA;
+
+HTTPAPIEX_HANDLE HTTPAPIEX_Create(const char* hostName)
+{
+    HTTPAPIEX_HANDLE_DATA* result = (HTTPAPIEX_HANDLE_DATA*)malloc(sizeof(HTTPAPIEX_HANDLE_DATA));
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, "function.azurewebsites.net", hostName);
+    (void)strcpy(result->hostName, hostName);
+    (void)Lock(g_function.lock);
+    g_function.connectionsCreated++;
+    g_function.connectionsOpen++;
+    (void)Unlock(g_function.lock);
+    return result;
+}
+
+HTTPAPIEX_RESULT HTTPAPIEX_ExecuteRequest(HTTPAPIEX_HANDLE handle, HTTPAPI_REQUEST_TYPE requestType, const char* relativePath, HTTP_HEADERS_HANDLE requestHttpHeadersHandle, BUFFER_HANDLE requestContent, unsigned int* statusCode, HTTP_HEADERS_HANDLE responseHttpHeadersHandle, BUFFER_HANDLE responseContent)
+{
+    const char* key = HTTPHeaders_FindHeaderValue(requestHttpHeadersHandle, "x-functions-key");
+    size_t length = BUFFER_length(requestContent);
+    char* body = (char*)malloc(length + 1);
+    ASSERT_IS_NOT_NULL(handle);
+    ASSERT_IS_NOT_NULL(body);
+    ASSERT_ARE_EQUAL(int, (int)HTTPAPI_REQUEST_POST, (int)requestType);
+    ASSERT_IS_NULL(responseHttpHeadersHandle);
+    ASSERT_IS_NOT_NULL(responseContent);
+    (void)memcpy(body, BUFFER_u_char(requestContent), length);
+    body[length] = '\0';
+
+    (void)Lock(g_function.lock);
+    ASSERT_IS_TRUE(g_function.requests < TEST_MAX_REQUESTS);
+    g_function.bodies[g_function.requests++] = body;
+    (void)strcpy(g_function.path, relativePath);
+    (void)strcpy(g_function.contentType, HTTPHeaders_FindHeaderValue(requestHttpHeadersHandle, "Content-Type"));
+    g_function.keySent = (key != NULL);
+    if (key != NULL)
+    {
+        (void)strcpy(g_function.key, key);
+    }
+    *statusCode = (g_function.failedRequests > 0) ? 500 : 200;
+    if (g_function.failedRequests > 0)
+    {
+        g_function.failedRequests--;
+    }
+    (void)Condition_Post(g_function.changed);
+    while (g_function.gateClosed)
+    {
+        (void)Condition_Wait(g_function.changed, g_function.lock, 100);
+    }
+    (void)Unlock(g_function.lock);
+    return HTTPAPIEX_OK;
+}
+
+void HTTPAPIEX_Destroy(HTTPAPIEX_HANDLE handle)
+{
+    (void)Lock(g_function.lock);
+    g_function.connectionsOpen--;
+    (void)Unlock(g_function.lock);
+    free(handle);
+}
+
+static void wait_for_requests(size_t requests)
+{
+    int tries = 0;
+    (void)Lock(g_function.lock);
+    while (
+        (g_function.requests < requests) &&
+        (tries++ < 100)
+        )
+    {
+        (void)Condition_Wait(g_function.changed, g_function.lock, 100);
+    }
+    ASSERT_ARE_EQUAL(size_t, requests, g_function.requests);
+    (void)Unlock(g_function.lock);
+}
+
+static void open_gate(void)
+{
+    (void)Lock(g_function.lock);
+    g_function.gateClosed = false;
+    (void)Condition_Post(g_function.changed);
+    (void)Unlock(g_function.lock);
+}
+
+static AZURE_FUNCTIONS_SENDER_CONFIG test_config(size_t maxConnections, size_t maxBatch, size_t maxQueue)
+{
+    AZURE_FUNCTIONS_SENDER_CONFIG config;
+    config.maxConnections = maxConnections;
+    config.maxBatch = maxBatch;
+    config.maxQueue = maxQueue;
+    return config;
+}
+
+static AZURE_FUNCTIONS_SENDER_HANDLE create_sender(size_t maxConnections, size_t maxBatch, size_t maxQueue, const char* key)
+{
+    AZURE_FUNCTIONS_SENDER_CONFIG config = test_config(maxConnections, maxBatch, maxQueue);
+    STRING_HANDLE hostAddress = STRING_construct("function.azurewebsites.net");
+    STRING_HANDLE relativePath = STRING_construct("api/HttpTrigger");
+    STRING_HANDLE securityKey = (key == NULL) ? NULL : STRING_construct(key);
+    AZURE_FUNCTIONS_SENDER_HANDLE result = AzureFunctionsSender_Create(&config, hostAddress, relativePath, securityKey);
+    ASSERT_IS_NOT_NULL(result);
+    STRING_delete(hostAddress);
+    STRING_delete(relativePath);
+    STRING_delete(securityKey);
+    return result;
+}
+
+static int send_message(AZURE_FUNCTIONS_SENDER_HANDLE sender, const char* content)
+{
+    int result;
+    STRING_HANDLE json = STRING_construct("{\"content\":\"");
+    ASSERT_IS_NOT_NULL(json);
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(json, content));
+    ASSERT_ARE_EQUAL(int, 0, STRING_concat(json, "\"}"));
+    result = AzureFunctionsSender_Send(sender, json);
+    if (result != 0)
+    {
+        /*the caller still owns it*/
+        STRING_delete(json);
+    }
+    return result;
+}
+
+static int parse_sender_config(const char* args, AZURE_FUNCTIONS_SENDER_CONFIG* config)
+{
+    int result;
+    JSON_Value* json = json_parse_string(args);
+    ASSERT_IS_NOT_NULL(json);
+    result = AzureFunctionsSender_ParseConfigurationFromJson(json_value_get_object(json), config);
+    json_value_free(json);
+    return result;
+}
+
+BEGIN_TEST_SUITE(azure_functions_sender_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+    g_function.lock = Lock_Init();
+    ASSERT_IS_NOT_NULL(g_function.lock);
+    g_function.changed = Condition_Init();
+    ASSERT_IS_NOT_NULL(g_function.changed);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    Condition_Deinit(g_function.changed);
+    (void)Lock_Deinit(g_function.lock);
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+    g_function.connectionsCreated = 0;
+    g_function.connectionsOpen = 0;
+    g_function.requests = 0;
+    g_function.path[0] = '\0';
+    g_function.contentType[0] = '\0';
+    g_function.key[0] = '\0';
+    g_function.keySent = false;
+    g_function.gateClosed = false;
+    g_function.failedRequests = 0;
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    size_t i;
+    for (i = 0; i < g_function.requests; i++)
+    {
+        free(g_function.bodies[i]);
+    }
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_001: [ If json or config is NULL then AzureFunctionsSender_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_002: [ Values that are not present shall default to maxConnections AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_CONNECTIONS, maxBatch AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_BATCH and maxQueue AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_QUEUE. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_004: [ Otherwise AzureFunctionsSender_ParseConfigurationFromJson shall succeed and return 0. ]*/
+TEST_FUNCTION(AzureFunctionsSender_ParseConfigurationFromJson_reads_settings)
+{
+    AZURE_FUNCTIONS_SENDER_CONFIG config;
+    JSON_Value* json = json_parse_string("{}");
+    ASSERT_IS_NOT_NULL(json);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, AzureFunctionsSender_ParseConfigurationFromJson(NULL, &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, AzureFunctionsSender_ParseConfigurationFromJson(json_value_get_object(json), NULL));
+    json_value_free(json);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_sender_config("{\"hostname\":\"function.azurewebsites.net\"}", &config));
+    ASSERT_ARE_EQUAL(size_t, AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_CONNECTIONS, config.maxConnections);
+    ASSERT_ARE_EQUAL(size_t, AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_BATCH, config.maxBatch);
+    ASSERT_ARE_EQUAL(size_t, AZURE_FUNCTIONS_SENDER_DEFAULT_MAX_QUEUE, config.maxQueue);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_sender_config("{\"maxConnections\":4,\"maxBatch\":50,\"maxQueue\":20000}", &config));
+    ASSERT_ARE_EQUAL(size_t, 4, config.maxConnections);
+    ASSERT_ARE_EQUAL(size_t, 50, config.maxBatch);
+    ASSERT_ARE_EQUAL(size_t, 20000, config.maxQueue);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_003: [ If a value is present and is not a whole number in range then AzureFunctionsSender_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(AzureFunctionsSender_ParseConfigurationFromJson_rejects_bad_values)
+{
+    AZURE_FUNCTIONS_SENDER_CONFIG config;
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxConnections\":0}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxConnections\":65}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxConnections\":\"2\"}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxBatch\":0}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxBatch\":1.5}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxBatch\":1001}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxQueue\":0}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_sender_config("{\"maxQueue\":-1}", &config));
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_005: [ If config, hostAddress or relativePath is NULL, or any limit of config is 0, then AzureFunctionsSender_Create shall fail and return NULL. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_008: [ If handle or json is NULL then AzureFunctionsSender_Send shall fail and return a non-zero value. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_015: [ If handle is NULL then AzureFunctionsSender_Destroy shall do nothing. ]*/
+TEST_FUNCTION(AzureFunctionsSender_rejects_invalid_arguments)
+{
+    STRING_HANDLE hostAddress = STRING_construct("function.azurewebsites.net");
+    STRING_HANDLE relativePath = STRING_construct("api/HttpTrigger");
+    STRING_HANDLE json = STRING_construct("{}");
+    AZURE_FUNCTIONS_SENDER_CONFIG config = test_config(1, 1, 1);
+    AZURE_FUNCTIONS_SENDER_CONFIG noConnections = test_config(0, 1, 1);
+    AZURE_FUNCTIONS_SENDER_CONFIG noBatch = test_config(1, 0, 1);
+    AZURE_FUNCTIONS_SENDER_CONFIG noQueue = test_config(1, 1, 0);
+    AZURE_FUNCTIONS_SENDER_HANDLE sender;
+
+    ASSERT_IS_NULL(AzureFunctionsSender_Create(NULL, hostAddress, relativePath, NULL));
+    ASSERT_IS_NULL(AzureFunctionsSender_Create(&config, NULL, relativePath, NULL));
+    ASSERT_IS_NULL(AzureFunctionsSender_Create(&config, hostAddress, NULL, NULL));
+    ASSERT_IS_NULL(AzureFunctionsSender_Create(&noConnections, hostAddress, relativePath, NULL));
+    ASSERT_IS_NULL(AzureFunctionsSender_Create(&noBatch, hostAddress, relativePath, NULL));
+    ASSERT_IS_NULL(AzureFunctionsSender_Create(&noQueue, hostAddress, relativePath, NULL));
+    ASSERT_ARE_EQUAL(size_t, 0, g_function.connectionsCreated);
+
+    sender = AzureFunctionsSender_Create(&config, hostAddress, relativePath, NULL);
+    ASSERT_IS_NOT_NULL(sender);
+    ASSERT_ARE_NOT_EQUAL(int, 0, AzureFunctionsSender_Send(NULL, json));
+    ASSERT_ARE_NOT_EQUAL(int, 0, AzureFunctionsSender_Send(sender, NULL));
+    AzureFunctionsSender_Destroy(sender);
+    AzureFunctionsSender_Destroy(NULL);
+
+    ASSERT_ARE_EQUAL(size_t, 0, g_function.requests);
+    STRING_delete(json);
+    STRING_delete(relativePath);
+    STRING_delete(hostAddress);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_006: [ AzureFunctionsSender_Create shall open maxConnections connections with HTTPAPIEX_Create, each with the headers Content-Type: application/json and, if securityKey is not NULL, x-functions-key: securityKey, and start a worker thread for each with ModuleThread_Create. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_013: [ A worker shall POST the body to relativePath?name=myGatewayDevice by calling HTTPAPIEX_ExecuteRequest on its own connection, which it keeps open for its next requests. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_016: [ AzureFunctionsSender_Destroy shall let the workers post what is queued, wait for them, close their connections and release all resources. ]*/
+TEST_FUNCTION(AzureFunctionsSender_keeps_a_connection_per_worker)
+{
+    AZURE_FUNCTIONS_SENDER_HANDLE sender = create_sender(3, 1, 100, "secret");
+    int i;
+    ASSERT_ARE_EQUAL(size_t, 3, g_function.connectionsCreated);
+
+    for (i = 0; i < 12; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, send_message(sender, "AAAA"));
+    }
+    AzureFunctionsSender_Destroy(sender);
+
+    ASSERT_ARE_EQUAL(size_t, 12, g_function.requests);
+    ASSERT_ARE_EQUAL(size_t, 3, g_function.connectionsCreated);
+    ASSERT_ARE_EQUAL(size_t, 0, g_function.connectionsOpen);
+    ASSERT_ARE_EQUAL(char_ptr, "api/HttpTrigger?name=myGatewayDevice", g_function.path);
+    ASSERT_ARE_EQUAL(char_ptr, "application/json", g_function.contentType);
+    ASSERT_IS_TRUE(g_function.keySent);
+    ASSERT_ARE_EQUAL(char_ptr, "secret", g_function.key);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_010: [ Otherwise AzureFunctionsSender_Send shall queue json, wake a worker and return 0. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_011: [ A worker shall take up to maxBatch queued messages, in the order they were sent. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_012: [ When maxBatch is 1 the body of the POST shall be the JSON object of the message, otherwise it shall be a JSON array of the JSON objects of the messages. ]*/
+TEST_FUNCTION(AzureFunctionsSender_posts_each_message_as_it_is_when_maxBatch_is_1)
+{
+    AZURE_FUNCTIONS_SENDER_HANDLE sender = create_sender(1, 1, 100, NULL);
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MQ=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "Mg=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "Mw=="));
+    AzureFunctionsSender_Destroy(sender);
+
+    ASSERT_ARE_EQUAL(size_t, 3, g_function.requests);
+    ASSERT_ARE_EQUAL(char_ptr, "{\"content\":\"MQ==\"}", g_function.bodies[0]);
+    ASSERT_ARE_EQUAL(char_ptr, "{\"content\":\"Mg==\"}", g_function.bodies[1]);
+    ASSERT_ARE_EQUAL(char_ptr, "{\"content\":\"Mw==\"}", g_function.bodies[2]);
+    ASSERT_IS_FALSE(g_function.keySent);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_011: [ A worker shall take up to maxBatch queued messages, in the order they were sent. ]*/
+/*Tests_SRS_AZUREFUNCTIONS_37_012: [ When maxBatch is 1 the body of the POST shall be the JSON object of the message, otherwise it shall be a JSON array of the JSON objects of the messages. ]*/
+TEST_FUNCTION(AzureFunctionsSender_posts_the_messages_queued_during_a_request_as_one_array)
+{
+    AZURE_FUNCTIONS_SENDER_HANDLE sender = create_sender(1, 3, 100, NULL);
+    g_function.gateClosed = true;
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MA=="));
+    wait_for_requests(1);
+
+    /*the only worker is busy, these wait and go out together*/
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MQ=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "Mg=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "Mw=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "NA=="));
+    open_gate();
+    AzureFunctionsSender_Destroy(sender);
+
+    ASSERT_ARE_EQUAL(size_t, 3, g_function.requests);
+    ASSERT_ARE_EQUAL(char_ptr, "[{\"content\":\"MA==\"}]", g_function.bodies[0]);
+    ASSERT_ARE_EQUAL(char_ptr, "[{\"content\":\"MQ==\"},{\"content\":\"Mg==\"},{\"content\":\"Mw==\"}]", g_function.bodies[1]);
+    ASSERT_ARE_EQUAL(char_ptr, "[{\"content\":\"NA==\"}]", g_function.bodies[2]);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_009: [ If maxQueue messages are already queued then AzureFunctionsSender_Send shall fail and return a non-zero value without waiting. ]*/
+TEST_FUNCTION(AzureFunctionsSender_Send_drops_the_message_when_the_queue_is_full)
+{
+    AZURE_FUNCTIONS_SENDER_HANDLE sender = create_sender(1, 1, 2, NULL);
+    g_function.gateClosed = true;
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MA=="));
+    wait_for_requests(1);
+
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MQ=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "Mg=="));
+    ASSERT_ARE_NOT_EQUAL(int, 0, send_message(sender, "Mw=="));
+    open_gate();
+    AzureFunctionsSender_Destroy(sender);
+
+    ASSERT_ARE_EQUAL(size_t, 3, g_function.requests);
+    ASSERT_ARE_EQUAL(char_ptr, "{\"content\":\"Mg==\"}", g_function.bodies[2]);
+}
+
+/*Tests_SRS_AZUREFUNCTIONS_37_014: [ If the request fails or its status code is not 200, the worker shall log the error and drop the messages it posted. ]*/
+TEST_FUNCTION(AzureFunctionsSender_keeps_posting_after_a_failed_request)
+{
+    AZURE_FUNCTIONS_SENDER_HANDLE sender = create_sender(1, 1, 100, NULL);
+    g_function.failedRequests = 1;
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MA=="));
+    ASSERT_ARE_EQUAL(int, 0, send_message(sender, "MQ=="));
+    AzureFunctionsSender_Destroy(sender);
+
+    ASSERT_ARE_EQUAL(size_t, 2, g_function.requests);
+    ASSERT_ARE_EQUAL(char_ptr, "{\"content\":\"MQ==\"}", g_function.bodies[1]);
+    ASSERT_ARE_EQUAL(size_t, 0, g_function.connectionsOpen);
+}
+
+END_TEST_SUITE(azure_functions_sender_ut)
@@ -35,11 +35,11 @@ static void my_gballoc_free(void* s)
 #include "module.h"
 #include "module_access.h"
 #include "azure_c_shared_utility/strings.h"
-#include "azure_c_shared_utility/httpapiex.h"
 #include "message.h"
 #include "azure_c_shared_utility/base64.h"
 #include "azure_c_shared_utility/gballoc.h"
 #include "parson.h"
+#include "azure_functions_sender.h"
 
 MOCKABLE_FUNCTION(, JSON_Value*, json_parse_string, const char *, string);
 MOCKABLE_FUNCTION(, const char*, json_object_get_string, const JSON_Object *, object, const char *, name);
@@ -56,6 +56,8 @@ static TEST_MUTEX_HANDLE g_dllByDll;
 #endif
 static TEST_MUTEX_HANDLE g_testByTest;
 
+#define TEST_SENDER_HANDLE ((AZURE_FUNCTIONS_SENDER_HANDLE)0x43)
+
 DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
 
 static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
@@ -86,17 +88,11 @@ TEST_SUITE_INITIALIZE(suite_init)
 
     REGISTER_UMOCK_ALIAS_TYPE(MESSAGE_HANDLE, void*);
 
-    REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_HANDLE, void*);
-
-    REGISTER_UMOCK_ALIAS_TYPE(HTTP_HEADERS_HANDLE, void*);
-
-    REGISTER_UMOCK_ALIAS_TYPE(HTTP_HEADERS_RESULT, int);
-
     REGISTER_UMOCK_ALIAS_TYPE(BUFFER_HANDLE, void*);
 
-    REGISTER_UMOCK_ALIAS_TYPE(HTTPAPI_REQUEST_TYPE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(AZURE_FUNCTIONS_SENDER_HANDLE, void*);
 
-    REGISTER_UMOCK_ALIAS_TYPE(HTTPAPIEX_RESULT, int);
+    REGISTER_GLOBAL_MOCK_RETURN(AzureFunctionsSender_Create, TEST_SENDER_HANDLE);
 }
 
 TEST_SUITE_CLEANUP(suite_cleanup)
@@ -391,6 +387,9 @@ TEST_FUNCTION(AZUREFUNCTIONS_CreateFromJson_returns_NULL_when_alloc_fails)
         .IgnoreAllArguments()
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_ParseConfigurationFromJson((const JSON_Object*)0x42, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+
     STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)))
         .SetReturn(NULL);
 
@@ -415,6 +414,67 @@ TEST_FUNCTION(AZUREFUNCTIONS_CreateFromJson_returns_NULL_when_alloc_fails)
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
+/* Tests_SRS_AZUREFUNCTIONS_37_017: [ AzureFunctions_ParseConfigurationFromJson shall read the sender settings by calling AzureFunctionsSender_ParseConfigurationFromJson. ] */
+/* Tests_SRS_AZUREFUNCTIONS_37_018: [ If AzureFunctionsSender_ParseConfigurationFromJson fails, AzureFunctions_ParseConfigurationFromJson shall fail and return NULL. ] */
+TEST_FUNCTION(AZUREFUNCTIONS_CreateFromJson_returns_NULL_when_sender_settings_are_invalid)
+{
+    // arrange
+    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
+
+
+    STRICT_EXPECTED_CALL(json_parse_string((const char*)0x42))
+        .SetReturn((JSON_Value*)0x42);
+    STRICT_EXPECTED_CALL(json_value_get_object((JSON_Value*)0x42))
+        .SetReturn((JSON_Object*)0x42);
+
+    STRICT_EXPECTED_CALL(json_object_get_string((const JSON_Object*)0x42, "hostname"))
+        .IgnoreArgument(2)
+        .SetReturn("HostName42");
+
+    STRICT_EXPECTED_CALL(json_object_get_string((const JSON_Object*)0x42, "relativePath"))
+        .IgnoreArgument(2)
+        .SetReturn("relativePath42");
+
+    STRICT_EXPECTED_CALL(json_object_get_string((const JSON_Object*)0x42, "key"))
+        .IgnoreArgument(2)
+        .SetReturn(NULL);
+ 
+    STRICT_EXPECTED_CALL(STRING_construct((const char *)IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(STRING_construct((const char *)IGNORED_PTR_ARG))
+        .IgnoreAllArguments()
+        .SetReturn((STRING_HANDLE)0x42);
+
+    STRICT_EXPECTED_CALL(STRING_construct((const char *)IGNORED_PTR_ARG))
+        .IgnoreAllArguments()
+        .SetReturn((STRING_HANDLE)0x42);
+
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_ParseConfigurationFromJson((const JSON_Object*)0x42, IGNORED_PTR_ARG))
+        .IgnoreArgument(2)
+        .SetReturn(__LINE__);
+
+    // cleanup after forced failure
+
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(json_value_free((JSON_Value*)0x42));
+
+    // act
+    void* result = MODULE_PARSE_CONFIGURATION_FROM_JSON(apis)((const char*)0x42);
+
+    //assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 /* Tests_SRS_AZUREFUNCTIONS_05_019: [ If the array object contains a value named "key" then Azure_Functions_CreateFromJson shall create a securityKey based on input key ] */
 /* Tests_SRS_AZUREFUNCTIONS_05_014: [ Azure_Functions_CreateFromJson shall release all data it allocated. ] */
 /*Tests_SRS_AZUREFUNCTIONS_17_001: [ AzureFunctions_ParseConfigurationFromJson shall allocate an AZURE_FUNCTIONS_CONFIG structure. ]*/
@@ -460,6 +520,9 @@ TEST_FUNCTION(AZUREFUNCTIONS_CreateFromJson_happy_path)
         .IgnoreAllArguments()
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_ParseConfigurationFromJson((const JSON_Object*)0x42, IGNORED_PTR_ARG))
+        .IgnoreArgument(2);
+
     STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
 
     STRICT_EXPECTED_CALL(json_value_free((JSON_Value*)0x42));
@@ -579,7 +642,9 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Create_happy_Path_with_key)
         .IgnoreArgument(1)
         .SetReturn((STRING_HANDLE)0x42);
 
-  //act
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42));
+
+    //act
     MODULE_HANDLE result = MODULE_CREATE(apis)((BROKER_HANDLE)0x42,  (const void*)&config);
 
     //assert
@@ -621,6 +686,8 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Create_happy_Path_without_key)
         .IgnoreArgument(1)
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, NULL));
+
     //act
     MODULE_HANDLE result = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, (const void*)&config);
 
@@ -893,6 +960,61 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Create_returns_NULL_failed_to_clone_securityKey)
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
+/* Tests_SRS_AZUREFUNCTIONS_37_019: [ AzureFunctions_Create shall start posting by calling AzureFunctionsSender_Create with the sender settings of the configuration and the copied strings. ] */
+/* Tests_SRS_AZUREFUNCTIONS_37_020: [ If AzureFunctionsSender_Create fails, AzureFunctions_Create shall fail and return NULL. ] */
+TEST_FUNCTION(AZURE_FUNCTIONS_Create_returns_NULL_when_AzureFunctionsSender_Create_fails)
+{
+    // arrange
+    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
+
+    AZURE_FUNCTIONS_CONFIG config;
+    config.relativePath = (STRING_HANDLE)0x42;
+    config.hostAddress = (STRING_HANDLE)0x42;
+    config.securityKey = (STRING_HANDLE)0x42;
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .IgnoreArgument(1);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
+
+    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn((STRING_HANDLE)0x42);
+
+    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn((STRING_HANDLE)0x42);
+
+    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn((STRING_HANDLE)0x42);
+
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
+        .SetReturn(NULL);
+
+    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+
+    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+
+    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+
+
+    //act
+    MODULE_HANDLE result = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, (const void*)&config);
+
+    //assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
 /* Tests_SRS_AZUREFUNCTIONS_04_008: [ If moduleHandle is NULL, azure_functions_Destroy shall return. ] */
 TEST_FUNCTION(AZURE_FUNCTIONS_Destroy_does_nothing_if_module_handle_null)
 {
@@ -934,11 +1056,15 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Destroy_happy_path_with_securityKey)
         .IgnoreArgument(1)
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42));
+
     MODULE_HANDLE result = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, (const void*)&config);
     ASSERT_IS_NOT_NULL(result);
 
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Destroy(TEST_SENDER_HANDLE));
+
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
@@ -982,11 +1108,15 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Destroy_happy_path_without_securityKey)
         .IgnoreArgument(1)
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, NULL));
+
     MODULE_HANDLE result = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, (const void*)&config);
     ASSERT_IS_NOT_NULL(result);
 
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Destroy(TEST_SENDER_HANDLE));
+
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
     STRICT_EXPECTED_CALL(STRING_delete(NULL));
@@ -1230,8 +1360,12 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fails_when_STRING_concat2_fail)
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/* Tests_SRS_AZUREFUNCTIONS_04_014: [ azure_functions_Receive shall call HTTPAPIEX_Create, passing hostAddress, it if fails it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPAPIEX_create_Fail)
+/* Tests_SRS_AZUREFUNCTIONS_37_021: [ AzureFunctions_Receive shall queue the JSON STRING to be posted by calling AzureFunctionsSender_Send, which does not wait for the network. ] */
+/* Tests_SRS_AZUREFUNCTIONS_04_024: [ AzureFunctions_Receive shall create a JSON STRING with the content of the message received. If it fails it shall fail and return. ] */
+/* Tests_SRS_AZUREFUNCTIONS_04_019: [ azure_functions_Receive shall destroy any allocated memory before returning. ] */
+/* Tests_SRS_AZUREFUNCTIONS_04_013: [ azure_functions_Receive shall base64 encode by calling Base64_Encode_Bytes, if it fails it shall fail and return. ] */
+/* Tests_SRS_AZUREFUNCTIONS_04_012: [ azure_functions_Receive shall get the message content by calling Message_GetContent, if it fails it shall fail and return. ] */
+TEST_FUNCTION(AZURE_FUNCTIONS_Receive_happy_path)
 {
     // arrange
     const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
@@ -1239,7 +1373,7 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPAPIEX_create_Fail)
     CONSTBUFFER buffer;
     buffer.buffer = (const unsigned char*)"12345";
     buffer.size = sizeof("12345");
-    
+
     AZURE_FUNCTIONS_CONFIG config;
     config.relativePath = (STRING_HANDLE)0x42;
     config.hostAddress = (STRING_HANDLE)0x42;
@@ -1262,6 +1396,8 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPAPIEX_create_Fail)
         .IgnoreArgument(1)
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42));
+
     MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
 
     umock_c_reset_all_calls();
@@ -1287,30 +1423,22 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPAPIEX_create_Fail)
         .IgnoreArgument(2)
         .SetReturn(0);
 
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn(NULL);
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Send(TEST_SENDER_HANDLE, (STRING_HANDLE)0x42));
 
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
 
-
     //act
     MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
 
     //assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    //Cleanup
+    //cleanup 
     MODULE_DESTROY(apis)(moduleInfo);
 }
 
-/* Tests_SRS_AZUREFUNCTIONS_04_015: [ azure_functions_Receive shall call allocate memory to receive data from HTTPAPI by calling BUFFER_new, if it fail it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_if_buffer_new_fails)
+/* Tests_SRS_AZUREFUNCTIONS_37_023: [ If AzureFunctionsSender_Send fails, AzureFunctions_Receive shall log the error and destroy the JSON STRING. ] */
+TEST_FUNCTION(AZURE_FUNCTIONS_Receive_deletes_the_message_when_AzureFunctionsSender_Send_fails)
 {
     // arrange
     const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
@@ -1341,6 +1469,8 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_if_buffer_new_fails)
         .IgnoreArgument(1)
         .SetReturn((STRING_HANDLE)0x42);
 
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42));
+
     MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
 
     umock_c_reset_all_calls();
@@ -1366,23 +1496,13 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_if_buffer_new_fails)
         .IgnoreArgument(2)
         .SetReturn(0);
 
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn(NULL);
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
+    STRICT_EXPECTED_CALL(AzureFunctionsSender_Send(TEST_SENDER_HANDLE, (STRING_HANDLE)0x42))
+        .SetReturn(__LINE__);
 
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
 
     STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
 
-
     //act
     MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
 
@@ -1393,1023 +1513,64 @@ TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_if_buffer_new_fails)
     MODULE_DESTROY(apis)(moduleInfo);
 }
 
-/* Tests_SRS_AZUREFUNCTIONS_04_016: [ azure_functions_Receive shall add name parameter to relative path, if it fail it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_String_clone_fails)
+/* Tests_SRS_AZUREFUNCTIONS_04_012: [ azure_functions_Receive shall get the message content by calling Message_GetContent, if it fails it shall fail and return. ] */
+TEST_FUNCTION(AZURE_FUNCTIONS_Receive_happy_path_empty_content)
 {
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
+	// arrange
+	const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
 
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
+	CONSTBUFFER buffer = { NULL, 0 };
 
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
+	AZURE_FUNCTIONS_CONFIG config;
+	config.relativePath = (STRING_HANDLE)0x42;
+	config.hostAddress = (STRING_HANDLE)0x42;
+	config.securityKey = (STRING_HANDLE)0x42;
 
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
+	STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+		.IgnoreArgument(1);
 
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn(NULL);
+	STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
 
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
+	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn((STRING_HANDLE)0x42);
 
+	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn((STRING_HANDLE)0x42);
 
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
+	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
+		.IgnoreArgument(1)
+		.SetReturn((STRING_HANDLE)0x42);
 
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+	STRICT_EXPECTED_CALL(AzureFunctionsSender_Create(&config.sender, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42, (STRING_HANDLE)0x42));
 
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+	MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
 
+	umock_c_reset_all_calls();
 
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
+	STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
+		.SetReturn(&buffer);
 
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+	STRICT_EXPECTED_CALL(STRING_construct_n(IGNORED_PTR_ARG, 0))
+		.IgnoreArgument(1).SetReturn((STRING_HANDLE)0x42);
 
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
+	STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
+		.IgnoreAllArguments()
+		.SetReturn((STRING_HANDLE)0x42);
 
-/* Tests_SRS_AZUREFUNCTIONS_04_016: [ azure_functions_Receive shall add name parameter to relative path, if it fail it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_String_concat1_fails)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
+	STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
+		.IgnoreArgument(2)
+		.SetReturn(0);
 
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
+	STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
+		.SetReturn(0);
 
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
+	STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
+		.IgnoreArgument(2)
+		.SetReturn(0);
 
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(-1);
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_025: [ AzureFunctions_Receive shall add 2 HTTP Headers to POST Request. Content-Type:application/json and, if securityKey exists x-functions-key:securityKey. If it fails it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPHeaders_Alloc_fails)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-        .SetReturn(NULL);
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_025: [ AzureFunctions_Receive shall add 2 HTTP Headers to POST Request. Content-Type:application/json and, if securityKey exists x-functions-key:securityKey. If it fails it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPHeaders_AddHeaderNameValuePair_fails)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-        .SetReturn((HTTP_HEADERS_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_ERROR);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Free((HTTP_HEADERS_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_025: [ AzureFunctions_Receive shall add 2 HTTP Headers to POST Request. Content-Type:application/json and, if securityKey exists x-functions-key:securityKey. If it fails it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_HTTPHeaders_AddHeaderNameValuePair2_fails)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-        .SetReturn((HTTP_HEADERS_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_ERROR);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Free((HTTP_HEADERS_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_017: [ azure_functions_Receive shall HTTPAPIEX_ExecuteRequest to send the HTTP POST to Azure Functions. If it fail it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_BUFFER_create_PostContent_fails)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-        .SetReturn((HTTP_HEADERS_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-
-    STRICT_EXPECTED_CALL(STRING_length((STRING_HANDLE)0x42))
-        .SetReturn(42);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .IgnoreAllArguments()
-        .SetReturn(NULL);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Free((HTTP_HEADERS_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_017: [ azure_functions_Receive shall HTTPAPIEX_ExecuteRequest to send the HTTP POST to Azure Functions. If it fail it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_fail_when_httpapiex_executeRequest_fail)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-        .SetReturn((HTTP_HEADERS_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-
-    STRICT_EXPECTED_CALL(STRING_length((STRING_HANDLE)0x42))
-        .SetReturn(42);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_ExecuteRequest((HTTPAPIEX_HANDLE)0x42, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, (HTTP_HEADERS_HANDLE)0x42, (BUFFER_HANDLE)0x42, IGNORED_PTR_ARG, NULL, (BUFFER_HANDLE)0x42))
-        .IgnoreArgument(3)
-        .IgnoreArgument(6)
-        .SetReturn(HTTPAPIEX_ERROR);
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Free((HTTP_HEADERS_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_025: [ AzureFunctions_Receive shall add 2 HTTP Headers to POST Request. Content-Type:application/json and, if securityKey exists x-functions-key:securityKey. If it fails it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_024: [ AzureFunctions_Receive shall create a JSON STRING with the content of the message received. If it fails it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_019: [ azure_functions_Receive shall destroy any allocated memory before returning. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_018: [ Upon success azure_functions_Receive shall log the response from HTTP POST and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_017: [ azure_functions_Receive shall HTTPAPIEX_ExecuteRequest to send the HTTP POST to Azure Functions. If it fail it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_016: [ azure_functions_Receive shall add name and content parameter to relative path, if it fail it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_015: [ azure_functions_Receive shall call allocate memory to receive data from HTTPAPI by calling BUFFER_new, if it fail it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_014: [ azure_functions_Receive shall call HTTPAPIEX_Create, passing hostAddress, it if fails it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_013: [ azure_functions_Receive shall base64 encode by calling Base64_Encode_Bytes, if it fails it shall fail and return. ] */
-/* Tests_SRS_AZUREFUNCTIONS_04_012: [ azure_functions_Receive shall get the message content by calling Message_GetContent, if it fails it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_happy_path)
-{
-    // arrange
-    const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-    CONSTBUFFER buffer;
-    buffer.buffer = (const unsigned char*)"12345";
-    buffer.size = sizeof("12345");
-
-    AZURE_FUNCTIONS_CONFIG config;
-    config.relativePath = (STRING_HANDLE)0x42;
-    config.hostAddress = (STRING_HANDLE)0x42;
-    config.securityKey = (STRING_HANDLE)0x42;
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-        .IgnoreArgument(1);
-
-    STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn((STRING_HANDLE)0x42);
-
-    MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-        .SetReturn(&buffer);
-
-    STRICT_EXPECTED_CALL(Base64_Encode_Bytes(buffer.buffer, buffer.size))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(BUFFER_new())
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-        .SetReturn((STRING_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .SetReturn(0);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-        .SetReturn((HTTP_HEADERS_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument(2)
-        .IgnoreArgument(3)
-        .SetReturn(HTTP_HEADERS_OK);
-
-
-    STRICT_EXPECTED_CALL(STRING_length((STRING_HANDLE)0x42))
-        .SetReturn(42);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-        .IgnoreAllArguments()
-        .SetReturn((BUFFER_HANDLE)0x42);
-
-    STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-        .SetReturn("AnyContent42");
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_ExecuteRequest((HTTPAPIEX_HANDLE)0x42, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, (HTTP_HEADERS_HANDLE)0x42, (BUFFER_HANDLE)0x42, IGNORED_PTR_ARG, NULL, (BUFFER_HANDLE)0x42))
-        .IgnoreArgument(3)
-        .IgnoreArgument(6)
-        .SetReturn(HTTPAPIEX_OK);
-
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPHeaders_Free((HTTP_HEADERS_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-    
-    STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-    //act
-    MODULE_RECEIVE(apis)(moduleInfo, (MESSAGE_HANDLE)0x42);
-
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-
-    //cleanup 
-    MODULE_DESTROY(apis)(moduleInfo);
-}
-
-/* Tests_SRS_AZUREFUNCTIONS_04_012: [ azure_functions_Receive shall get the message content by calling Message_GetContent, if it fails it shall fail and return. ] */
-TEST_FUNCTION(AZURE_FUNCTIONS_Receive_happy_path_empty_content)
-{
-	// arrange
-	const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
-
-	CONSTBUFFER buffer = { NULL, 0 };
-
-	AZURE_FUNCTIONS_CONFIG config;
-	config.relativePath = (STRING_HANDLE)0x42;
-	config.hostAddress = (STRING_HANDLE)0x42;
-	config.securityKey = (STRING_HANDLE)0x42;
-
-	STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
-		.IgnoreArgument(1);
-
-	STRICT_EXPECTED_CALL(gballoc_malloc(sizeof(AZURE_FUNCTIONS_CONFIG)));
-
-	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.SetReturn((STRING_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.SetReturn((STRING_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)IGNORED_PTR_ARG))
-		.IgnoreArgument(1)
-		.SetReturn((STRING_HANDLE)0x42);
-
-	MODULE_HANDLE moduleInfo = MODULE_CREATE(apis)((BROKER_HANDLE)0x42, &config);
-
-	umock_c_reset_all_calls();
-
-	STRICT_EXPECTED_CALL(Message_GetContent((MESSAGE_HANDLE)0x42))
-		.SetReturn(&buffer);
-
-	STRICT_EXPECTED_CALL(STRING_construct_n(IGNORED_PTR_ARG, 0))
-		.IgnoreArgument(1).SetReturn((STRING_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_construct(IGNORED_PTR_ARG))
-		.IgnoreAllArguments()
-		.SetReturn((STRING_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-		.IgnoreArgument(2)
-		.SetReturn(0);
-
-	STRICT_EXPECTED_CALL(STRING_concat_with_STRING((STRING_HANDLE)0x42, (STRING_HANDLE)0x42))
-		.SetReturn(0);
-
-	STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-		.IgnoreArgument(2)
-		.SetReturn(0);
-
-	STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-		.SetReturn("AnyContent42");
-
-	STRICT_EXPECTED_CALL(HTTPAPIEX_Create(IGNORED_PTR_ARG))
-		.IgnoreAllArguments()
-		.SetReturn((HTTPAPIEX_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(BUFFER_new())
-		.SetReturn((BUFFER_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_clone((STRING_HANDLE)0x42))
-		.SetReturn((STRING_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_concat((STRING_HANDLE)0x42, IGNORED_PTR_ARG))
-		.IgnoreArgument(2)
-		.SetReturn(0);
-
-	STRICT_EXPECTED_CALL(HTTPHeaders_Alloc())
-		.SetReturn((HTTP_HEADERS_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(2)
-		.IgnoreArgument(3)
-		.SetReturn(HTTP_HEADERS_OK);
-
-	STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-		.SetReturn("AnyContent42");
-
-	STRICT_EXPECTED_CALL(HTTPHeaders_AddHeaderNameValuePair((HTTP_HEADERS_HANDLE)0x42, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-		.IgnoreArgument(2)
-		.IgnoreArgument(3)
-		.SetReturn(HTTP_HEADERS_OK);
-
-
-	STRICT_EXPECTED_CALL(STRING_length((STRING_HANDLE)0x42))
-		.SetReturn(42);
-
-	STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-		.SetReturn("AnyContent42");
-
-	STRICT_EXPECTED_CALL(BUFFER_create(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
-		.IgnoreAllArguments()
-		.SetReturn((BUFFER_HANDLE)0x42);
-
-	STRICT_EXPECTED_CALL(STRING_c_str((STRING_HANDLE)0x42))
-		.SetReturn("AnyContent42");
-
-	STRICT_EXPECTED_CALL(HTTPAPIEX_ExecuteRequest((HTTPAPIEX_HANDLE)0x42, HTTPAPI_REQUEST_POST, IGNORED_PTR_ARG, (HTTP_HEADERS_HANDLE)0x42, (BUFFER_HANDLE)0x42, IGNORED_PTR_ARG, NULL, (BUFFER_HANDLE)0x42))
-		.IgnoreArgument(3)
-		.IgnoreArgument(6)
-		.SetReturn(HTTPAPIEX_OK);
-
-	STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-	STRICT_EXPECTED_CALL(HTTPHeaders_Free((HTTP_HEADERS_HANDLE)0x42));
-
-	STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
-
-	STRICT_EXPECTED_CALL(BUFFER_delete((BUFFER_HANDLE)0x42));
-
-	STRICT_EXPECTED_CALL(HTTPAPIEX_Destroy((HTTPAPIEX_HANDLE)0x42));
-
-	STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
+	STRICT_EXPECTED_CALL(AzureFunctionsSender_Send(TEST_SENDER_HANDLE, (STRING_HANDLE)0x42));
 
 	STRICT_EXPECTED_CALL(STRING_delete((STRING_HANDLE)0x42));
 
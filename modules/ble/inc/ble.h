@@ -11,6 +11,7 @@
 
 #include "ble_gatt_io.h"
 #include "bleio_seq.h"
+#include "ble_scheduler.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -43,12 +44,46 @@ typedef struct BLE_INSTRUCTION_TAG
         */
         BUFFER_HANDLE           buffer;
     }data;
+
+    /**
+    * If 'instruction_type' is equal to READ_ONCE or READ_PERIODIC then this
+    * is the name of the read group the instruction belongs to or NULL. The
+    * reads of a group are published together as a single message.
+    */
+    STRING_HANDLE               read_group;
 }BLE_INSTRUCTION;
 
-typedef struct BLE_CONFIG_TAG
+typedef struct BLE_FLEET_DEVICE_TAG
 {
     BLE_DEVICE_CONFIG   device_config;  // BLE device information
     VECTOR_HANDLE       instructions;   // array of BLE_INSTRUCTION objects to be executed
+}BLE_FLEET_DEVICE;
+
+typedef struct BLE_CONFIG_TAG
+{
+    BLE_DEVICE_CONFIG       device_config;      // BLE device information
+    VECTOR_HANDLE           instructions;       // array of BLE_INSTRUCTION objects to be executed
+
+    /**
+    * Array of BLE_FLEET_DEVICE objects. When this is not NULL the module
+    * drives all these devices through a connection scheduler and ignores
+    * 'device_config' and 'instructions'. Only supported on Linux.
+    */
+    VECTOR_HANDLE           devices;
+    BLE_SCHEDULER_CONFIG    scheduler_config;   // connection limits for 'devices'
+
+    /**
+    * How writes to a characteristic that is busy are queued up. Writes are
+    * coalesced so that only the latest one waits unless 'ordered' is true.
+    */
+    BLEIO_SEQ_WRITE_QUEUE_CONFIG    write_queue_config;
+
+    /**
+    * When true the module talks to virtual devices that behave as described
+    * by 'simulator' instead of real BLE devices; used for load testing.
+    */
+    bool                            use_simulator;
+    BLEIO_GATT_SIM_CONFIG           simulator;
 }BLE_CONFIG;
 
 MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(BLE_MODULE)(MODULE_API_VERSION gateway_api_version);
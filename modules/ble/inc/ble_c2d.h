@@ -6,6 +6,15 @@
 
 #include "module.h"
 
+/**
+ * Messages whose "contentType" property is "application/x-ble-instruction"
+ * carry a binary BLE instruction instead of a JSON object: a header of
+ * BLE_C2D_BINARY_HEADER_SIZE bytes followed by the characteristic UUID and
+ * the data to write. See devdoc/blemodule_c2d_requirements.md for the layout.
+ */
+#define BLE_C2D_BINARY_VERSION              1
+#define BLE_C2D_BINARY_HEADER_SIZE          8
+
 #ifdef __cplusplus
 extern "C"
 {
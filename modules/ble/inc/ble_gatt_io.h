@@ -37,6 +37,46 @@ typedef struct BLE_DEVICE_CONFIG_TAG
     uint8_t ble_controller_index;
 }BLE_DEVICE_CONFIG;
 
+/**
+* Behaviour of the virtual device behind a simulated GATT I/O handle.
+*/
+typedef struct BLEIO_GATT_SIM_CONFIG_TAG
+{
+    /**
+     * How long in milliseconds every operation takes to complete.
+     */
+    uint32_t latency_in_ms;
+
+    /**
+     * Upper bound in milliseconds of the random delay added to the latency
+     * of every operation.
+     */
+    uint32_t jitter_in_ms;
+
+    /**
+     * Probability between 0 and 1 that a connection attempt fails.
+     */
+    double connect_failure_rate;
+
+    /**
+     * Probability between 0 and 1 that a read, write or notification start
+     * fails.
+     */
+    double io_failure_rate;
+
+    /**
+     * How often in milliseconds a characteristic sends a notification once
+     * notifications have been started for it.
+     */
+    uint32_t notify_interval_in_ms;
+
+    /**
+     * Size in bytes of the values generated for characteristics that have
+     * not been written to.
+     */
+    size_t value_size;
+}BLEIO_GATT_SIM_CONFIG;
+
 typedef struct BLEIO_GATT_INSTANCE_TAG* BLEIO_GATT_HANDLE;
 
 #define BLEIO_GATT_RESULT_VALUES \
@@ -63,11 +103,18 @@ typedef void(*ON_BLEIO_GATT_CONNECT_COMPLETE)(BLEIO_GATT_HANDLE bleio_gatt_handl
 typedef void(*ON_BLEIO_GATT_DISCONNECT_COMPLETE)(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context);
 typedef void(*ON_BLEIO_GATT_ATTRIB_READ_COMPLETE)(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, BLEIO_GATT_RESULT result, const unsigned char* buffer, size_t size);
 typedef void(*ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE)(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, BLEIO_GATT_RESULT result);
+typedef void(*ON_BLEIO_GATT_NOTIFY_START_COMPLETE)(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, BLEIO_GATT_RESULT result);
+typedef void(*ON_BLEIO_GATT_ATTRIB_NOTIFY)(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, const unsigned char* buffer, size_t size);
 
 extern BLEIO_GATT_HANDLE BLEIO_gatt_create(
     const BLE_DEVICE_CONFIG* config
 );
 
+extern BLEIO_GATT_HANDLE BLEIO_gatt_sim_create(
+    const BLE_DEVICE_CONFIG* config,
+    const BLEIO_GATT_SIM_CONFIG* sim_config
+);
+
 extern void BLEIO_gatt_destroy(
     BLEIO_GATT_HANDLE bleio_gatt_handle
 );
@@ -100,6 +147,14 @@ extern int BLEIO_gatt_write_char_by_uuid(
     void* callback_context
 );
 
+extern int BLEIO_gatt_notify_char_by_uuid(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_bleio_gatt_notify_start_complete,
+    ON_BLEIO_GATT_ATTRIB_NOTIFY on_bleio_gatt_attrib_notify,
+    void* callback_context
+);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
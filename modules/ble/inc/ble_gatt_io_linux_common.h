@@ -5,6 +5,7 @@
 #define BLE_GATT_IO_LINUX_COMMON_H
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <glib.h>
 #include <gio/gio.h>
@@ -14,14 +15,75 @@
 #include "gio_async_seq.h"
 #include "ble_gatt_io.h"
 
+typedef struct BLEIO_GATT_SIM_DEVICE_TAG BLEIO_GATT_SIM_DEVICE;
+
 typedef struct BLEIO_GATT_HANDLE_DATA_TAG {
     BLE_MAC_ADDRESS             device_addr;            // MAC address of the BLE device.
-    GDBusConnection*            bus;                    // connection to system d-bus
-    GDBusObjectManagerClient*   object_manager;         // d-bus object manager for org.bluez
+    GDBusConnection*            bus;                    // connection to system d-bus (shared)
+    GDBusObjectManagerClient*   object_manager;         // d-bus object manager for org.bluez (shared)
     bluezdevice*                device;                 // the device to do I/O with
     BLEIO_GATT_STATE            state;                  // current connection state
     uint8_t                     ble_controller_index;   // index of the bluetooth controller to be used
     GTree*                      char_object_path_map;   // maps characteristic UUIDs to d-bus object paths
+    GTree*                      char_proxy_map;         // maps d-bus object paths to characteristic proxies
+    GTree*                      char_notify_map;        // maps d-bus object paths to notification subscriptions
+    BLEIO_GATT_SIM_DEVICE*      sim;                    // the virtual device if this is a simulated handle or NULL
 }BLEIO_GATT_HANDLE_DATA;
 
+// fetches the d-bus connection and object manager shared by all the
+// handles in the process; returns false if they have not been created yet
+bool get_shared_object_manager(GDBusConnection** bus, GDBusObjectManagerClient** object_manager);
+
+// makes 'bus' the shared d-bus connection unless there already is one in
+// which case 'bus' is released; returns the shared connection
+GDBusConnection* share_bus(GDBusConnection* bus);
+
+// makes 'object_manager' the shared object manager unless there already is
+// one in which case 'object_manager' is released; returns the shared one
+GDBusObjectManagerClient* share_object_manager(GDBusObjectManagerClient* object_manager);
+
+// frees a notification subscription; this is the value destroy
+// function of the 'char_notify_map' tree
+void free_notify_context(gpointer data);
+
+// the simulated counterparts of the public API (see ble_gatt_io_sim.c); the
+// public functions hand handles that have a 'sim' device over to these
+void sim_gatt_destroy(BLEIO_GATT_HANDLE_DATA* handle_data);
+
+int sim_gatt_connect(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    ON_BLEIO_GATT_CONNECT_COMPLETE on_connect_complete,
+    void* callback_context
+);
+
+void sim_gatt_disconnect(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    ON_BLEIO_GATT_DISCONNECT_COMPLETE on_disconnect_complete,
+    void* callback_context
+);
+
+int sim_gatt_read(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_ATTRIB_READ_COMPLETE on_read_complete,
+    void* callback_context
+);
+
+int sim_gatt_write(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    const char* ble_uuid,
+    const unsigned char* buffer,
+    size_t size,
+    ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE on_write_complete,
+    void* callback_context
+);
+
+int sim_gatt_notify(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_notify_start_complete,
+    ON_BLEIO_GATT_ATTRIB_NOTIFY on_notify,
+    void* callback_context
+);
+
 #endif // BLE_GATT_IO_LINUX_COMMON_H
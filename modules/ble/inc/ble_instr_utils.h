@@ -21,6 +21,7 @@ extern "C"
     VECTOR_HANDLE parse_instructions(JSON_Array* instructions);
     bool parse_read_periodic(JSON_Object* instr, BLE_INSTRUCTION* ble_instr);
     bool parse_write(JSON_Object* instr, BLEIO_SEQ_INSTRUCTION_TYPE type, BLE_INSTRUCTION* ble_instr, size_t index);
+    bool parse_read_group(JSON_Object* instr, BLE_INSTRUCTION* ble_instr, size_t index);
     void free_instruction(BLE_INSTRUCTION* instr);
     void free_instructions(VECTOR_HANDLE instructions);
 
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef BLE_SCHEDULER_H
+#define BLE_SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/buffer_.h"
+
+#include "ble_gatt_io.h"
+#include "bleio_seq.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct BLE_SCHEDULER_HANDLE_DATA_TAG* BLE_SCHEDULER_HANDLE;
+
+/**
+ * How long in milliseconds the scheduler waits for a disconnect to complete
+ * before it treats the device as disconnected anyway.
+ */
+#define BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS  3000
+
+typedef struct BLE_SCHEDULER_CONFIG_TAG
+{
+    /**
+     * The maximum number of devices that the BLE controller can hold open
+     * connections with at the same time.
+     */
+    size_t                      max_connections;
+
+    /**
+     * How long in milliseconds a device keeps its connection before it may
+     * be disconnected to make room for another device.
+     */
+    uint32_t                    min_connection_time_in_ms;
+
+    /**
+     * How long in milliseconds to wait before connecting to a device again
+     * after a connection attempt or an I/O operation on it failed.
+     */
+    uint32_t                    retry_interval_in_ms;
+
+    /**
+     * When true the devices are virtual devices that behave as described
+     * by 'simulator' instead of real BLE devices.
+     */
+    bool                        use_simulator;
+    BLEIO_GATT_SIM_CONFIG       simulator;
+}BLE_SCHEDULER_CONFIG;
+
+/**
+ * Callback invoked when the scheduler completes a read operation on one of
+ * the devices.
+ */
+typedef void(*ON_BLE_SCHEDULER_READ_COMPLETE)(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    void* context,
+    const BLE_DEVICE_CONFIG* device_config,
+    const char* characteristic_uuid,
+    BLEIO_SEQ_INSTRUCTION_TYPE type,
+    BLEIO_SEQ_RESULT result,
+    BUFFER_HANDLE data
+);
+
+/**
+ * Callback invoked when the scheduler has been destroyed.
+ */
+typedef void(*ON_BLE_SCHEDULER_DESTROY_COMPLETE)(BLE_SCHEDULER_HANDLE scheduler_handle, void* context);
+
+extern BLE_SCHEDULER_HANDLE BLE_Scheduler_Create(
+    const BLE_SCHEDULER_CONFIG* config,
+    ON_BLE_SCHEDULER_READ_COMPLETE on_read_complete
+);
+
+extern int BLE_Scheduler_AddDevice(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    const BLE_DEVICE_CONFIG* device_config,
+    VECTOR_HANDLE instructions
+);
+
+extern void BLE_Scheduler_Tick(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    uint64_t now_in_ms
+);
+
+extern void BLE_Scheduler_Destroy(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    ON_BLE_SCHEDULER_DESTROY_COMPLETE on_destroy_complete,
+    void* context
+);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BLE_SCHEDULER_H
@@ -4,6 +4,10 @@
 #ifndef BLEIO_SEQ_H
 #define BLEIO_SEQ_H
 
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
 #include "azure_c_shared_utility/macro_utils.h"
 #include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/strings.h"
@@ -19,7 +23,9 @@ typedef struct BLEIO_SEQ_HANDLE_DATA_TAG* BLEIO_SEQ_HANDLE;
 
 #define BLEIO_SEQ_RESULT_VALUES \
     BLEIO_SEQ_ERROR, \
-    BLEIO_SEQ_OK
+    BLEIO_SEQ_OK, \
+    BLEIO_SEQ_QUEUE_FULL, \
+    BLEIO_SEQ_SUPERSEDED
 DEFINE_ENUM(BLEIO_SEQ_RESULT, BLEIO_SEQ_RESULT_VALUES);
 
 #define BLEIO_SEQ_INSTRUCTION_TYPE_VALUES \
@@ -27,7 +33,8 @@ DEFINE_ENUM(BLEIO_SEQ_RESULT, BLEIO_SEQ_RESULT_VALUES);
     READ_PERIODIC, \
     WRITE_ONCE,    \
     WRITE_AT_INIT, \
-    WRITE_AT_EXIT
+    WRITE_AT_EXIT, \
+    NOTIFY
 DEFINE_ENUM(BLEIO_SEQ_INSTRUCTION_TYPE, BLEIO_SEQ_INSTRUCTION_TYPE_VALUES);
 
 typedef struct BLEIO_SEQ_INSTRUCTION_TAG
@@ -65,6 +72,30 @@ typedef struct BLEIO_SEQ_INSTRUCTION_TAG
     }data;
 }BLEIO_SEQ_INSTRUCTION;
 
+/**
+ * The maximum number of writes that are queued up behind the write in flight
+ * on a characteristic when writes are ordered, unless configured otherwise.
+ */
+#define BLEIO_SEQ_DEFAULT_WRITE_QUEUE_DEPTH 16
+
+typedef struct BLEIO_SEQ_WRITE_QUEUE_CONFIG_TAG
+{
+    /**
+     * If false (the default) then a write that is added while another write
+     * to the same characteristic is in flight replaces the write that is
+     * waiting for it, if any, which completes with BLEIO_SEQ_SUPERSEDED. If
+     * true then every write is executed in the order in which it was added.
+     */
+    bool                        ordered;
+
+    /**
+     * If 'ordered' is true then this is the maximum number of writes that
+     * can wait for the write in flight on a characteristic; beyond that
+     * BLEIO_Seq_AddInstruction returns BLEIO_SEQ_QUEUE_FULL.
+     */
+    size_t                      max_depth;
+}BLEIO_SEQ_WRITE_QUEUE_CONFIG;
+
 /**
  * Callback invoked when the sequencer completes a read operation.
  */
@@ -113,6 +144,11 @@ extern BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
     BLEIO_SEQ_INSTRUCTION* instruction
 );
 
+extern BLEIO_SEQ_RESULT BLEIO_Seq_SetWriteQueueConfig(
+    BLEIO_SEQ_HANDLE bleio_seq_handle,
+    const BLEIO_SEQ_WRITE_QUEUE_CONFIG* config
+);
+
 #ifdef __cplusplus
 }
 #endif
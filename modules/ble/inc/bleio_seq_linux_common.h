@@ -16,6 +16,9 @@
 
 DEFINE_ENUM(BLEIO_SEQ_STATE, BLEIO_SEQ_STATE_VALUES);
 
+typedef struct NOTIFY_CONTEXT_TAG NOTIFY_CONTEXT;
+typedef struct QUEUED_WRITE_TAG QUEUED_WRITE;
+
 typedef struct BLEIO_SEQ_HANDLE_DATA_TAG {
     BLEIO_GATT_HANDLE               bleio_gatt_handle;
     VECTOR_HANDLE                   instructions;
@@ -24,6 +27,16 @@ typedef struct BLEIO_SEQ_HANDLE_DATA_TAG {
     ON_BLEIO_SEQ_WRITE_COMPLETE     on_write_complete;
     ON_BLEIO_SEQ_DESTROY_COMPLETE   on_destroy_complete;
     void*                           destroy_context;
+    NOTIFY_CONTEXT*                 notify_contexts;
+
+    /**
+     * The writes added via BLEIO_Seq_AddInstruction that are in flight or
+     * waiting for the write in flight on the same characteristic, in the
+     * order in which they were added.
+     */
+    QUEUED_WRITE*                   queued_writes;
+    bool                            ordered_writes;
+    size_t                          max_write_queue_depth;
 }BLEIO_SEQ_HANDLE_DATA;
 
 /**
@@ -31,9 +44,40 @@ typedef struct BLEIO_SEQ_HANDLE_DATA_TAG {
  */
 typedef void(*ON_INTERNAL_IO_COMPLETE)(BLEIO_SEQ_HANDLE_DATA* bleio_seq_handle, BLEIO_SEQ_INSTRUCTION* instruction);
 
+/**
+ * The state of a read that is in flight. Reads started by schedule_read
+ * allocate one per read and free it when the read completes; the timer of a
+ * READ_PERIODIC instruction owns one that it reuses for every poll.
+ */
+typedef struct READ_CONTEXT_TAG {
+    BLEIO_SEQ_HANDLE_DATA*          handle_data;
+    BLEIO_SEQ_INSTRUCTION*          instruction;
+    ON_INTERNAL_IO_COMPLETE         on_internal_read_complete;
+
+    /**
+     * When true the context is not freed when the read completes because
+     * its owner reuses it for the next read.
+     */
+    bool                            is_owned;
+    bool                            is_in_flight;
+}READ_CONTEXT;
+
 BLEIO_SEQ_RESULT schedule_write(BLEIO_SEQ_HANDLE_DATA* handle_data, BLEIO_SEQ_INSTRUCTION* instruction, ON_INTERNAL_IO_COMPLETE on_internal_read_complete);
 BLEIO_SEQ_RESULT schedule_read(BLEIO_SEQ_HANDLE_DATA* handle_data, BLEIO_SEQ_INSTRUCTION* instruction, ON_INTERNAL_IO_COMPLETE on_internal_read_complete);
+
+/**
+ * Starts a read with a context that the caller has already filled in;
+ * 'context' is freed when the read completes unless it is owned.
+ */
+BLEIO_SEQ_RESULT start_read(READ_CONTEXT* context);
 BLEIO_SEQ_RESULT schedule_periodic(BLEIO_SEQ_HANDLE_DATA* handle_data, BLEIO_SEQ_INSTRUCTION* instruction, ON_INTERNAL_IO_COMPLETE on_internal_read_complete);
+BLEIO_SEQ_RESULT schedule_notify(BLEIO_SEQ_HANDLE_DATA* handle_data, BLEIO_SEQ_INSTRUCTION* instruction, ON_INTERNAL_IO_COMPLETE on_internal_read_complete);
+
+/**
+ * Frees the contexts of the NOTIFY instructions; notifications keep arriving
+ * till the GATT I/O handle is destroyed so this is called after that.
+ */
+void free_notify_contexts(BLEIO_SEQ_HANDLE_DATA* handle_data);
 
 void inc_ref_handle(BLEIO_SEQ_HANDLE_DATA* handle_data);
 void dec_ref_handle_only(BLEIO_SEQ_HANDLE_DATA* handle_data);
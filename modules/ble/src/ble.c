@@ -17,12 +17,14 @@
 #include "azure_c_shared_utility/map.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/threadapi.h"
+#include "module_thread.h"
 
 #include "module.h"
 #include "message.h"
 #include "broker.h"
 #include "ble_gatt_io.h"
 #include "bleio_seq.h"
+#include "ble_scheduler.h"
 #include "messageproperties.h"
 #include "ble_instr_utils.h"
 #include "ble_utils.h"
@@ -32,6 +34,61 @@
 
 DEFINE_ENUM_STRINGS(BLEIO_SEQ_INSTRUCTION_TYPE, BLEIO_SEQ_INSTRUCTION_TYPE_VALUES);
 
+// "YYYY:MM:DDTHH:MM:SS" without the terminator
+#define TIMESTAMP_LENGTH    19
+
+/**
+ * The message properties that never change for a device - the controller
+ * index, the MAC address and the source - formatted once, on the first
+ * read. Every telemetry message of the device is created from this map
+ * after the timestamp and characteristic UUID in it are updated;
+ * Message_Create copies the map so the next read can update it again.
+ *
+ * This is also the context of the read instructions of the device. The
+ * reads of a read group use the telemetry of the group instead, which has
+ * 'read_group' set and a 'readGroup' property in place of the
+ * characteristic UUID.
+ */
+typedef struct BLE_DEVICE_TELEMETRY_TAG
+{
+    struct BLE_HANDLE_DATA_TAG* module;
+    MAP_HANDLE                  properties;
+    struct BLE_READ_GROUP_TAG*  read_group;     // the group this telemetry publishes the reads of or NULL
+    VECTOR_HANDLE               read_groups;    // BLE_READ_GROUP pointers of the device, NULL if it has none
+}BLE_DEVICE_TELEMETRY;
+
+typedef struct BLE_READ_GROUP_MEMBER_TAG
+{
+    STRING_HANDLE   characteristic_uuid;
+    BUFFER_HANDLE   data;           // the value read in this round, NULL if the read failed
+    bool            has_completed;  // true once the read completed in this round
+}BLE_READ_GROUP_MEMBER;
+
+/**
+ * The reads of the instructions of a device that share a 'read_group'. A
+ * round ends once every member has completed a read and that is when the
+ * composite message is published.
+ */
+typedef struct BLE_READ_GROUP_TAG
+{
+    BLE_DEVICE_TELEMETRY        telemetry;
+    STRING_HANDLE               name;
+    BLEIO_SEQ_INSTRUCTION_TYPE  instruction_type;
+    uint32_t                    interval_in_ms;
+    VECTOR_HANDLE               members;            // BLE_READ_GROUP_MEMBER objects
+    size_t                      completed_count;
+}BLE_READ_GROUP;
+
+/**
+ * The last timestamp that was formatted. 'time' has a granularity of
+ * seconds so reads that complete within the same second share the string.
+ */
+typedef struct BLE_TIMESTAMP_CACHE_TAG
+{
+    time_t  second;
+    char    text[TIMESTAMP_LENGTH + 1];
+}BLE_TIMESTAMP_CACHE;
+
 typedef struct BLE_HANDLE_DATA_TAG
 {
     BROKER_HANDLE       broker;
@@ -40,16 +97,53 @@ typedef struct BLE_HANDLE_DATA_TAG
     BLEIO_SEQ_HANDLE    bleio_seq;
     bool                is_connected;
     bool                is_destroy_complete;
+
+    // when the module drives a fleet of devices the scheduler takes the
+    // place of 'bleio_gatt' and 'bleio_seq'
+    BLE_SCHEDULER_HANDLE    scheduler;
+    unsigned int            tick_source;
+
+    // 'telemetry' is used for a single device, 'fleet_telemetry' holds one
+    // entry per device of a fleet
+    BLE_DEVICE_TELEMETRY    telemetry;
+    BLE_DEVICE_TELEMETRY*   fleet_telemetry;
+    size_t                  fleet_size;
+    BLE_TIMESTAMP_CACHE     timestamp_cache;
+}BLE_HANDLE_DATA;
+
 #if __linux__
+/**
+ * The GLIB loop and the thread that pumps it are shared by all the BLE
+ * module instances in the process. The first instance to be created starts
+ * the thread and the last one to be destroyed stops it.
+ */
+typedef struct BLE_EVENT_LOOP_TAG
+{
+    size_t              ref_count;
     GMainLoop*          main_loop;
     THREAD_HANDLE       event_thread;
+}BLE_EVENT_LOOP;
+
+static BLE_EVENT_LOOP g_event_loop = { 0, NULL, NULL };
+G_LOCK_DEFINE_STATIC(g_event_loop);
 #endif
-}BLE_HANDLE_DATA;
 
 // how long to wait for a destroy complete callback to be invoked
 // in microseconds
 #define DESTROY_COMPLETE_TIMEOUT    (1000000 * 5)
 
+// how often the connection scheduler of a fleet gets to run in milliseconds
+#define SCHEDULER_TICK_IN_MS                10
+
+// connection scheduler settings used when the JSON does not specify them
+#define DEFAULT_MAX_CONNECTIONS             4
+#define DEFAULT_MIN_CONNECTION_TIME_IN_MS   1000
+#define DEFAULT_RETRY_INTERVAL_IN_MS        5000
+
+// simulated device settings used when the JSON does not specify them
+#define DEFAULT_SIM_NOTIFY_INTERVAL_IN_MS   1000
+#define DEFAULT_SIM_VALUE_SIZE              4
+
 static void on_connect_complete(
     BLEIO_GATT_HANDLE bleio_gatt_handle,
     void* context,
@@ -73,8 +167,21 @@ static void on_write_complete(
     BLEIO_SEQ_RESULT result
 );
 
+static void publish_read_result(
+    BLE_DEVICE_TELEMETRY* telemetry,
+    const BLE_DEVICE_CONFIG* device_config,
+    const char* characteristic_uuid,
+    BLEIO_SEQ_INSTRUCTION_TYPE type,
+    BLEIO_SEQ_RESULT result,
+    BUFFER_HANDLE data
+);
+
+static void init_telemetry(BLE_HANDLE_DATA* handle_data);
+
+static void free_telemetry(BLE_HANDLE_DATA* handle_data);
+
 static VECTOR_HANDLE ble_instr_to_bleioseq_instr(
-    BLE_HANDLE_DATA* module,
+    BLE_DEVICE_TELEMETRY* telemetry,
     VECTOR_HANDLE source_instructions
 );
 
@@ -82,16 +189,24 @@ static VECTOR_HANDLE ble_instr_to_bleioseq_instr(
 // how long to wait for a event dispatcher thread to start up
 #define EVENT_DISPATCHER_START_TIMEOUT    (G_USEC_PER_SEC * 5)
 
-static bool init_glib_loop(
-    BLE_HANDLE_DATA* handle_data
-);
+static bool init_glib_loop(void);
 
 static int event_dispatcher(
     void * user_data
 );
 
-static bool terminate_event_dispatcher(
-    BLE_HANDLE_DATA* handle_data
+static bool terminate_event_dispatcher(void);
+
+static void release_glib_loop(void);
+
+static void wait_for_destroy_complete(BLE_HANDLE_DATA* handle_data);
+
+static BLE_HANDLE_DATA* create_fleet(BROKER_HANDLE broker, const BLE_CONFIG* config);
+
+static BLE_CONFIG* parse_fleet_configuration(
+    JSON_Object* root,
+    JSON_Array* devices,
+    int controller_index
 );
 #endif
 
@@ -119,6 +234,18 @@ static void free_bleioseq_instr(VECTOR_HANDLE instructions)
     } 
 }
 
+static void free_fleet_devices(VECTOR_HANDLE devices)
+{
+    size_t len = VECTOR_size(devices);
+    for (size_t i = 0; i < len; ++i)
+    {
+        BLE_FLEET_DEVICE* device = (BLE_FLEET_DEVICE*)VECTOR_element(devices, i);
+        free_instructions(device->instructions);
+        VECTOR_destroy(device->instructions);
+    }
+    VECTOR_destroy(devices);
+}
+
 static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
 {
     BLE_HANDLE_DATA* result;
@@ -131,13 +258,28 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
     if (
             broker == NULL ||
             configuration == NULL ||
-            config->instructions == NULL ||
-            VECTOR_size(config->instructions) == 0
+            (
+                config->devices == NULL &&
+                (
+                    config->instructions == NULL ||
+                    VECTOR_size(config->instructions) == 0
+                )
+            )
        )
     {
         LogError("Invalid input");
         result = NULL;
     }
+    else if (config->devices != NULL)
+    {
+#if __linux__
+        result = create_fleet(broker, config);
+#else
+        /*Codes_SRS_BLE_44_001: [ BLE_Create shall return NULL if configuration->devices is not NULL on a platform that does not support device fleets. ]*/
+        LogError("Device fleets are only supported on Linux");
+        result = NULL;
+#endif
+    }
     else
     {
         /*Codes_SRS_BLE_13_009: [  BLE_Create  shall allocate memory for an instance of the  BLE_HANDLE_DATA  structure and use that as the backing structure for the module handle. ]*/
@@ -150,8 +292,13 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
         }
         else
         {
+            init_telemetry(result);
+
             /*Codes_SRS_BLE_13_008: [  BLE_Create  shall create and initialize the  bleio_gatt  field in the  BLE_HANDLE_DATA  object by calling  BLEIO_gatt_create . ]*/
-            result->bleio_gatt = BLEIO_gatt_create(&(config->device_config));
+            /*Codes_SRS_BLE_49_003: [ BLE_Create shall create the bleio_gatt field by calling BLEIO_gatt_sim_create with the simulator field of the configuration instead if the use_simulator field is true. ]*/
+            result->bleio_gatt = (config->use_simulator == true) ?
+                BLEIO_gatt_sim_create(&(config->device_config), &(config->simulator)) :
+                BLEIO_gatt_create(&(config->device_config));
             if (result->bleio_gatt == NULL)
             {
                 /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
@@ -162,12 +309,13 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
             else
             {
                 // transform BLE_INSTRUCTION objects into BLEIO_SEQ_INSTRUCTION objects
-                VECTOR_HANDLE instructions = ble_instr_to_bleioseq_instr(result, config->instructions);
+                VECTOR_HANDLE instructions = ble_instr_to_bleioseq_instr(&(result->telemetry), config->instructions);
                 if (instructions == NULL)
                 {
                     /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
                     LogError("Converting BLE_INSTRUCTION objects into BLEIO_SEQ_INSTRUCTION objects failed");
                     BLEIO_gatt_destroy(result->bleio_gatt);
+                    free_telemetry(result);
                     free(result);
                     result = NULL;
                 }
@@ -187,6 +335,20 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
                         BLEIO_gatt_destroy(result->bleio_gatt);
                         free_bleioseq_instr(instructions);
                         VECTOR_destroy(instructions);
+                        free_telemetry(result);
+                        free(result);
+                        result = NULL;
+                    }
+                    else if (
+                        config->write_queue_config.ordered == true &&
+                        BLEIO_Seq_SetWriteQueueConfig(result->bleio_seq, &(config->write_queue_config)) != BLEIO_SEQ_OK
+                    )
+                    {
+                        /*Codes_SRS_BLE_48_002: [ BLE_Create shall pass the write queue configuration to BLEIO_Seq_SetWriteQueueConfig if writes are ordered. ]*/
+                        /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
+                        LogError("BLEIO_Seq_SetWriteQueueConfig failed");
+                        BLEIO_Seq_Destroy(result->bleio_seq, NULL, NULL);
+                        free_telemetry(result);
                         free(result);
                         result = NULL;
                     }
@@ -195,12 +357,15 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
                         result->broker = broker;
                         memcpy(&(result->device_config), &(config->device_config), sizeof(result->device_config));
                         result->is_destroy_complete = false;
+                        result->scheduler = NULL;
+                        result->tick_source = 0;
 
 #if __linux__
-                        if (init_glib_loop(result) == false)
+                        if (init_glib_loop() == false)
                         {
                             LogError("init_glib_loop returned false");
                             BLEIO_Seq_Destroy(result->bleio_seq, NULL, NULL);
+                            free_telemetry(result);
                             free(result);
                             result = NULL;
                         }
@@ -214,12 +379,13 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
                                 /*Codes_SRS_BLE_13_012: [  BLE_Create  shall return  NULL  if  BLEIO_gatt_connect  returns a non-zero value. ]*/
                                 LogError("BLEIO_gatt_connect failed");
 #if __linux__
-                                if (terminate_event_dispatcher(result) == false)
+                                if (terminate_event_dispatcher() == false)
                                 {
                                     LogError("terminate_event_dispatcher returned false");
                                 }
 #endif
                                 BLEIO_Seq_Destroy(result->bleio_seq, NULL, NULL);
+                                free_telemetry(result);
                                 free(result);
                                 result = NULL;
 
@@ -242,6 +408,40 @@ static MODULE_HANDLE BLE_Create(BROKER_HANDLE broker, const void* configuration)
     return (MODULE_HANDLE)result;
 }
 
+static uint32_t get_positive_number(JSON_Object* root, const char* name, uint32_t default_value)
+{
+    double value = json_object_get_number(root, name);
+    return (value >= 1) ? (uint32_t)value : default_value;
+}
+
+static double get_rate(JSON_Object* root, const char* name)
+{
+    double value = json_object_get_number(root, name);
+    return (value < 0.0) ? 0.0 : ((value > 1.0) ? 1.0 : value);
+}
+
+static void parse_simulator(JSON_Object* root, bool* use_simulator, BLEIO_GATT_SIM_CONFIG* simulator)
+{
+    /*Codes_SRS_BLE_49_001: [ BLE_ParseConfigurationFromJson shall have the module talk to simulated devices if the JSON has a simulator object. ]*/
+    JSON_Object* simulator_json = json_object_get_object(root, "simulator");
+    if (simulator_json == NULL)
+    {
+        *use_simulator = false;
+        memset(simulator, 0, sizeof(BLEIO_GATT_SIM_CONFIG));
+    }
+    else
+    {
+        /*Codes_SRS_BLE_49_002: [ BLE_ParseConfigurationFromJson shall read the latency_in_ms, jitter_in_ms, connect_failure_rate, io_failure_rate, notify_interval_in_ms and value_size properties of the simulator object, clamp the rates to between 0 and 1 and use 0, 0, 0, 0, 1000 and 4 respectively when they are missing or not positive. ]*/
+        *use_simulator = true;
+        simulator->latency_in_ms = get_positive_number(simulator_json, "latency_in_ms", 0);
+        simulator->jitter_in_ms = get_positive_number(simulator_json, "jitter_in_ms", 0);
+        simulator->connect_failure_rate = get_rate(simulator_json, "connect_failure_rate");
+        simulator->io_failure_rate = get_rate(simulator_json, "io_failure_rate");
+        simulator->notify_interval_in_ms = get_positive_number(simulator_json, "notify_interval_in_ms", DEFAULT_SIM_NOTIFY_INTERVAL_IN_MS);
+        simulator->value_size = get_positive_number(simulator_json, "value_size", DEFAULT_SIM_VALUE_SIZE);
+    }
+}
+
 static void* BLE_ParseConfigurationFromJson(const char* configuration)
 {
 	BLE_CONFIG *result;
@@ -285,9 +485,20 @@ static void* BLE_ParseConfigurationFromJson(const char* configuration)
                     const char* mac_address = json_object_get_string(root, "device_mac_address");
                     if (mac_address == NULL)
                     {
-                        /*Codes_SRS_BLE_05_004: [ BLE_ParseConfigurationFromJson shall return NULL if there is no device_mac_address property in the JSON. ]*/
-                        LogError("json_object_get_string failed for property 'device_mac_address'");
-                        result = NULL;
+#if __linux__
+                        JSON_Array* devices = json_object_get_array(root, "devices");
+                        if (devices != NULL)
+                        {
+                            /*Codes_SRS_BLE_44_002: [ If there is no device_mac_address property in the JSON then BLE_ParseConfigurationFromJson shall parse the devices array into a fleet configuration. ]*/
+                            result = parse_fleet_configuration(root, devices, controller_index);
+                        }
+                        else
+#endif
+                        {
+                            /*Codes_SRS_BLE_05_004: [ BLE_ParseConfigurationFromJson shall return NULL if there is no device_mac_address property in the JSON. ]*/
+                            LogError("json_object_get_string failed for property 'device_mac_address'");
+                            result = NULL;
+                        }
                     }
                     else
                     {
@@ -324,6 +535,14 @@ static void* BLE_ParseConfigurationFromJson(const char* configuration)
                                 {
                                     ble_config.device_config.ble_controller_index = controller_index;
                                     ble_config.instructions = ble_instructions;
+                                    ble_config.devices = NULL;
+                                    memset(&(ble_config.scheduler_config), 0, sizeof(ble_config.scheduler_config));
+
+                                    /*Codes_SRS_BLE_48_001: [ BLE_ParseConfigurationFromJson shall read the max_queued_writes property from the JSON and, if it is a positive number, have writes to a characteristic executed in order with at most that many of them waiting; otherwise only the latest write waits. ]*/
+                                    ble_config.write_queue_config.max_depth = get_positive_number(root, "max_queued_writes", 0);
+                                    ble_config.write_queue_config.ordered = (ble_config.write_queue_config.max_depth > 0);
+
+                                    parse_simulator(root, &(ble_config.use_simulator), &(ble_config.simulator));
 
                                     /*Codes_SRS_BLE_17_001: [ BLE_ParseConfigurationFromJson shall allocate a new BLE_CONFIG structure containing BLE instructions and configuration as parsed from the JSON input. ] */
                                     result = malloc(sizeof(BLE_CONFIG));
@@ -359,8 +578,15 @@ void BLE_FreeConfiguration(void* configuration)
     {
         /*Codes_SRS_BLE_17_003: [ BLE_FreeConfiguration shall release all resources allocated in the BLE_CONFIG structure and release configuration. ]*/
         BLE_CONFIG * ble_config = (BLE_CONFIG*)configuration;
-        free_instructions(ble_config->instructions);
-        VECTOR_destroy(ble_config->instructions);
+        if (ble_config->devices != NULL)
+        {
+            free_fleet_devices(ble_config->devices);
+        }
+        else
+        {
+            free_instructions(ble_config->instructions);
+            VECTOR_destroy(ble_config->instructions);
+        }
         free(ble_config);
     }
 }
@@ -368,79 +594,106 @@ void BLE_FreeConfiguration(void* configuration)
 
 
 #if __linux__
-static bool init_glib_loop(BLE_HANDLE_DATA* handle_data)
+static bool init_glib_loop(void)
 {
     bool result;
-    handle_data->main_loop = g_main_loop_new(NULL, FALSE);
-    if (handle_data->main_loop == NULL)
+
+    G_LOCK(g_event_loop);
+    if (g_event_loop.ref_count > 0)
     {
-        LogError("g_main_loop_new returned NULL");
-        result = false;
+        /*Codes_SRS_BLE_43_001: [ BLE_Create shall reuse the GLIB loop and event dispatcher thread shared by all the BLE module instances in the process if they have already been started. ]*/
+        g_event_loop.ref_count++;
+        result = true;
     }
     else
     {
-        // start a thread to pump the message loop
-        if (ThreadAPI_Create(
-                &(handle_data->event_thread),
-                event_dispatcher,
-                (void*)handle_data
-            ) != THREADAPI_OK)
+        g_event_loop.main_loop = g_main_loop_new(NULL, FALSE);
+        if (g_event_loop.main_loop == NULL)
         {
-            LogError("ThreadAPI_Create failed");
-            g_main_loop_unref(handle_data->main_loop);
+            LogError("g_main_loop_new returned NULL");
             result = false;
         }
         else
         {
-            result = true;
+            // start a thread to pump the message loop
+            if (ModuleThread_Create(
+                    &(g_event_loop.event_thread),
+                    event_dispatcher,
+                    (void*)g_event_loop.main_loop
+                ) != THREADAPI_OK)
+            {
+                LogError("ModuleThread_Create failed");
+                g_main_loop_unref(g_event_loop.main_loop);
+                g_event_loop.main_loop = NULL;
+                result = false;
+            }
+            else
+            {
+                g_event_loop.ref_count = 1;
+                result = true;
+            }
         }
     }
+    G_UNLOCK(g_event_loop);
 
     return result;
 }
 
 static int event_dispatcher(void * user_data)
 {
-    BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)user_data;
-    g_main_loop_run(handle_data->main_loop);
-    g_main_loop_unref(handle_data->main_loop);
+    GMainLoop* main_loop = (GMainLoop*)user_data;
+    g_main_loop_run(main_loop);
+    g_main_loop_unref(main_loop);
     return 0;
 }
 
-static bool terminate_event_dispatcher(BLE_HANDLE_DATA* handle_data)
+static bool terminate_event_dispatcher(void)
 {
     bool result;
-    gint64 start_time = g_get_monotonic_time();
-    if (handle_data->main_loop != NULL)
+
+    G_LOCK(g_event_loop);
+    if (g_event_loop.main_loop != NULL)
     {
-        GMainContext* loop_context = g_main_loop_get_context(handle_data->main_loop);
-        if (loop_context != NULL)
+        if (--g_event_loop.ref_count > 0)
+        {
+            // other instances are still using the loop
+            result = true;
+        }
+        else
         {
-            while (
-                    (g_get_monotonic_time() - start_time) < EVENT_DISPATCHER_START_TIMEOUT
-                    &&
-                    g_main_loop_is_running(handle_data->main_loop) == FALSE
-                  )
+            gint64 start_time = g_get_monotonic_time();
+            GMainContext* loop_context = g_main_loop_get_context(g_event_loop.main_loop);
+            if (loop_context != NULL)
             {
-                // wait for quarter of a second
-                g_usleep(G_USEC_PER_SEC / 4);
-            }
+                while (
+                        (g_get_monotonic_time() - start_time) < EVENT_DISPATCHER_START_TIMEOUT
+                        &&
+                        g_main_loop_is_running(g_event_loop.main_loop) == FALSE
+                      )
+                {
+                    // wait for quarter of a second
+                    g_usleep(G_USEC_PER_SEC / 4);
+                }
 
-            if (g_main_loop_is_running(handle_data->main_loop) == TRUE)
-            {
-                g_main_loop_quit(handle_data->main_loop);
-                result = true;
+                if (g_main_loop_is_running(g_event_loop.main_loop) == TRUE)
+                {
+                    g_main_loop_quit(g_event_loop.main_loop);
+                    result = true;
+                }
+                else
+                {
+                    LogError("Timed out waiting for event dispatcher thread to initialize.");
+                    result = false;
+                }
             }
             else
             {
-                LogError("Timed out waiting for event dispatcher thread to initialize.");
+                LogError("g_main_loop_get_context returned NULL");
                 result = false;
             }
-        }
-        else
-        {
-            LogError("g_main_loop_get_context returned NULL");
-            result = false;
+
+            // the event dispatcher thread releases the loop
+            g_event_loop.main_loop = NULL;
         }
     }
     else
@@ -448,134 +701,812 @@ static bool terminate_event_dispatcher(BLE_HANDLE_DATA* handle_data)
         LogError("No GLIB loop to terminate.");
         result = false;
     }
+    G_UNLOCK(g_event_loop);
 
     return result;
 }
-#endif
 
-static VECTOR_HANDLE ble_instr_to_bleioseq_instr(BLE_HANDLE_DATA* module, VECTOR_HANDLE source_instructions)
+static void release_glib_loop(void)
 {
-    VECTOR_HANDLE result = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
-    if (result != NULL)
+    G_LOCK(g_event_loop);
+    if (g_event_loop.main_loop != NULL && --g_event_loop.ref_count == 0)
     {
-        size_t i, len = VECTOR_size(source_instructions);
-        for (i = 0; i < len; ++i)
-        {
-            BLE_INSTRUCTION* src_instr = (BLE_INSTRUCTION*)VECTOR_element(source_instructions, i);
-
-            // copy the data
-            BLEIO_SEQ_INSTRUCTION instr;
-            instr.instruction_type = src_instr->instruction_type;
-            instr.characteristic_uuid = STRING_clone(src_instr->characteristic_uuid);
-
-            if (
-                (
-                    src_instr->instruction_type == WRITE_AT_INIT ||
-                    src_instr->instruction_type == WRITE_ONCE ||
-                    src_instr->instruction_type == WRITE_AT_EXIT
-                )
-                &&
-                (
-                    src_instr->data.buffer != NULL
-                )
-              )
-            {
-                instr.data.buffer = BUFFER_clone(src_instr->data.buffer);
-                if(instr.data.buffer == NULL)
-                {
-                    LogError("BUFFER_clone failed");
-                    STRING_delete(instr.characteristic_uuid);
-                    break;
-                }
-            }
-            else
-            {
-                memcpy(&(instr.data), &(src_instr->data), sizeof(instr.data));
-            }
-
-            instr.context = (void*)module;
-
-            if (VECTOR_push_back(result, &instr, 1) != 0)
-            {
-                LogError("VECTOR_push_back failed");
-                STRING_delete(instr.characteristic_uuid);
-                break;
-            }
-        }
+        /*Codes_SRS_BLE_43_002: [ BLE_Destroy shall stop the shared GLIB loop and event dispatcher thread only when the last BLE module instance in the process is destroyed. ]*/
+        // terminate glib loop
+        g_main_loop_quit(g_event_loop.main_loop);
 
-        // if the loop terminated before all elements were processed,
-        // then something went wrong
-        if (i < len)
+        // wait for thread to exit
+        int thread_result;
+        if (ThreadAPI_Join(g_event_loop.event_thread, &thread_result) != THREADAPI_OK)
         {
-            free_bleioseq_instr(result);
-            VECTOR_destroy(result);
-            result = NULL;
+            LogError("ThreadAPI_Join() returned an error");
         }
-    }
-    else
-    {
-        LogError("VECTOR_create failed");
-    }
 
-    return result;
+        g_event_loop.main_loop = NULL;
+    }
+    G_UNLOCK(g_event_loop);
 }
 
-static void on_connect_complete(
-    BLEIO_GATT_HANDLE bleio_gatt_handle,
+static void on_scheduler_read_complete(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
     void* context,
-    BLEIO_GATT_CONNECT_RESULT connect_result
+    const BLE_DEVICE_CONFIG* device_config,
+    const char* characteristic_uuid,
+    BLEIO_SEQ_INSTRUCTION_TYPE type,
+    BLEIO_SEQ_RESULT result,
+    BUFFER_HANDLE data
 )
 {
-    (void)bleio_gatt_handle;
-    // this MUST NOT be NULL
+    (void)scheduler_handle;
+    /*Codes_SRS_BLE_44_005: [ BLE_Create shall publish the reads completed by the scheduler of a fleet the same way as the reads of a single device, with the MAC address of the device that was read from. ]*/
+    publish_read_result((BLE_DEVICE_TELEMETRY*)context, device_config, characteristic_uuid, type, result, data);
+}
+
+static gboolean on_scheduler_tick(gpointer user_data)
+{
+    BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)user_data;
+    BLE_Scheduler_Tick(handle_data->scheduler, (uint64_t)(g_get_monotonic_time() / 1000));
+
+    // keep the timer going till the scheduler is destroyed; it gives up on
+    // the disconnects that do not complete while it is being destroyed
+    return TRUE;
+}
+
+static void on_scheduler_destroy_complete(BLE_SCHEDULER_HANDLE scheduler_handle, void* context)
+{
+    (void)scheduler_handle;
     BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)context;
-    if (connect_result != BLEIO_GATT_CONNECT_OK)
-    {
-        LogError("BLEIO_gatt_connect asynchronously failed");
-    }
-    else
-    {
-        handle_data->is_connected = true;
 
-        /*Codes_SRS_BLE_13_014: [ If the asynchronous call to  BLEIO_gatt_connect  is successful then the  BLEIO_Seq_Run  function shall be called on the  bleio_seq  field from  BLE_HANDLE_DATA . ]*/
-        if (BLEIO_Seq_Run(handle_data->bleio_seq) != BLEIO_SEQ_OK)
-        {
-            LogError("BLEIO_Seq_Run failed");
-        }
-    }
+    // this may run from the tick itself which GLIB is fine with
+    g_source_remove(handle_data->tick_source);
+    handle_data->tick_source = 0;
+    handle_data->is_destroy_complete = true;
 }
 
-static int format_timestamp(char* dest, size_t dest_size)
+static gboolean on_scheduler_destroy(gpointer user_data)
 {
-    int result;
-    time_t t1 = time(NULL);
-    if (t1 == (time_t)-1)
+    BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)user_data;
+
+    // this runs on the GLIB loop like all the other calls into the
+    // scheduler so it cannot race with a tick or a GATT I/O callback
+    BLE_Scheduler_Destroy(handle_data->scheduler, on_scheduler_destroy_complete, handle_data);
+
+    // run only once
+    return FALSE;
+}
+
+static BLE_HANDLE_DATA* create_fleet(BROKER_HANDLE broker, const BLE_CONFIG* config)
+{
+    BLE_HANDLE_DATA* result = (BLE_HANDLE_DATA*)malloc(sizeof(BLE_HANDLE_DATA));
+    if (result == NULL)
     {
-        LogError("time() failed");
-        result = __LINE__;
+        /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
+        LogError("malloc failed");
     }
     else
     {
-        struct tm* t2 = localtime(&t1);
-        if (t2 == NULL)
+        result->broker = broker;
+        memset(&(result->device_config), 0, sizeof(result->device_config));
+        result->bleio_gatt = NULL;
+        result->bleio_seq = NULL;
+        result->is_connected = false;
+        result->is_destroy_complete = false;
+        result->tick_source = 0;
+        init_telemetry(result);
+
+        /*Codes_SRS_BLE_44_003: [ When configuration->devices is not NULL BLE_Create shall create a connection scheduler by calling BLE_Scheduler_Create and add every device to it by calling BLE_Scheduler_AddDevice. ]*/
+        result->scheduler = BLE_Scheduler_Create(&(config->scheduler_config), on_scheduler_read_complete);
+        if (result->scheduler == NULL)
         {
-            LogError("localtime() failed");
-            result = __LINE__;
+            /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
+            LogError("BLE_Scheduler_Create failed");
+            free(result);
+            result = NULL;
         }
         else
         {
-            /**
-             * Note: We record the time only with a granularity of seconds. We
-             * may want to increase this to include milliseconds.
-             */
-            if (strftime(dest, dest_size, "%Y:%m:%dT%H:%M:%S", t2) == 0)
+            size_t i, len = VECTOR_size(config->devices);
+            result->fleet_telemetry = (BLE_DEVICE_TELEMETRY*)malloc(len * sizeof(BLE_DEVICE_TELEMETRY));
+            if (result->fleet_telemetry == NULL)
             {
-                LogError("strftime() failed");
-                result = __LINE__;
+                /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
+                LogError("malloc failed");
+                BLE_Scheduler_Destroy(result->scheduler, NULL, NULL);
+                free(result);
+                result = NULL;
             }
             else
             {
-                result = 0;
+                // every device publishes its reads with its own properties;
+                // all of them are initialized up front so that free_telemetry
+                // can clean up after a device that fails to be added
+                result->fleet_size = len;
+                for (i = 0; i < len; ++i)
+                {
+                    result->fleet_telemetry[i].module = result;
+                    result->fleet_telemetry[i].properties = NULL;
+                    result->fleet_telemetry[i].read_group = NULL;
+                    result->fleet_telemetry[i].read_groups = NULL;
+                }
+
+                for (i = 0; i < len; ++i)
+                {
+                    BLE_FLEET_DEVICE* device = (BLE_FLEET_DEVICE*)VECTOR_element(config->devices, i);
+
+                    // transform BLE_INSTRUCTION objects into BLEIO_SEQ_INSTRUCTION objects
+                    VECTOR_HANDLE instructions = ble_instr_to_bleioseq_instr(&(result->fleet_telemetry[i]), device->instructions);
+                    if (instructions == NULL)
+                    {
+                        LogError("Converting BLE_INSTRUCTION objects into BLEIO_SEQ_INSTRUCTION objects failed");
+                        break;
+                    }
+                    else if (BLE_Scheduler_AddDevice(result->scheduler, &(device->device_config), instructions) != 0)
+                    {
+                        LogError("BLE_Scheduler_AddDevice failed");
+                        free_bleioseq_instr(instructions);
+                        VECTOR_destroy(instructions);
+                        break;
+                    }
+                }
+
+                if (i < len)
+                {
+                    /*Codes_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
+                    BLE_Scheduler_Destroy(result->scheduler, NULL, NULL);
+                    free_telemetry(result);
+                    free(result);
+                    result = NULL;
+                }
+                else if (init_glib_loop() == false)
+                {
+                    LogError("init_glib_loop returned false");
+                    BLE_Scheduler_Destroy(result->scheduler, NULL, NULL);
+                    free_telemetry(result);
+                    free(result);
+                    result = NULL;
+                }
+                else
+                {
+                    /*Codes_SRS_BLE_44_004: [ BLE_Create shall drive the scheduler of a fleet from a timer on the shared GLIB loop. ]*/
+                    result->tick_source = g_timeout_add(SCHEDULER_TICK_IN_MS, on_scheduler_tick, result);
+                    if (result->tick_source == 0)
+                    {
+                        LogError("g_timeout_add failed");
+                        release_glib_loop();
+                        BLE_Scheduler_Destroy(result->scheduler, NULL, NULL);
+                        free_telemetry(result);
+                        free(result);
+                        result = NULL;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static int parse_fleet_device(
+    JSON_Object* device_json,
+    JSON_Object* templates,
+    int controller_index,
+    VECTOR_HANDLE devices
+)
+{
+    int result;
+    BLE_FLEET_DEVICE device;
+    const char* mac_address = json_object_get_string(device_json, "device_mac_address");
+
+    // a device either lists its own instructions or names a template
+    JSON_Array* instructions = json_object_get_array(device_json, "instructions");
+    if (instructions == NULL && templates != NULL)
+    {
+        const char* template_name = json_object_get_string(device_json, "template");
+        if (template_name != NULL)
+        {
+            instructions = json_object_get_array(templates, template_name);
+        }
+    }
+
+    if (
+        mac_address == NULL ||
+        parse_mac_address(mac_address, &(device.device_config.device_addr)) == false
+       )
+    {
+        /*Codes_SRS_BLE_44_007: [ BLE_ParseConfigurationFromJson shall return NULL if an entry of the devices array does not have a well-formed device_mac_address property. ]*/
+        LogError("Invalid or missing 'device_mac_address' in a 'devices' entry");
+        result = __LINE__;
+    }
+    else if (instructions == NULL)
+    {
+        /*Codes_SRS_BLE_44_008: [ BLE_ParseConfigurationFromJson shall return NULL if an entry of the devices array has neither an instructions array nor a template property that names an array in instruction_templates. ]*/
+        LogError("No instructions found for device %s", mac_address);
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_BLE_44_009: [ BLE_ParseConfigurationFromJson shall give every device its own copy of the instructions of its template. ]*/
+        device.instructions = parse_instructions(instructions);
+        if (device.instructions == NULL)
+        {
+            LogError("parse_instructions returned NULL for device %s", mac_address);
+            result = __LINE__;
+        }
+        else
+        {
+            device.device_config.ble_controller_index = controller_index;
+            if (VECTOR_push_back(devices, &device, 1) != 0)
+            {
+                LogError("VECTOR_push_back failed");
+                free_instructions(device.instructions);
+                VECTOR_destroy(device.instructions);
+                result = __LINE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+static BLE_CONFIG* parse_fleet_configuration(
+    JSON_Object* root,
+    JSON_Array* devices,
+    int controller_index
+)
+{
+    BLE_CONFIG* result;
+    size_t count = json_array_get_count(devices);
+    if (count == 0)
+    {
+        /*Codes_SRS_BLE_44_006: [ BLE_ParseConfigurationFromJson shall return NULL if the devices array is empty. ]*/
+        LogError("The 'devices' array is empty");
+        result = NULL;
+    }
+    else
+    {
+        VECTOR_HANDLE fleet_devices = VECTOR_create(sizeof(BLE_FLEET_DEVICE));
+        if (fleet_devices == NULL)
+        {
+            /*Codes_SRS_BLE_05_002: [ BLE_ParseConfigurationFromJson shall return NULL if any of the underlying platform calls fail. ]*/
+            LogError("VECTOR_create failed");
+            result = NULL;
+        }
+        else
+        {
+            // templates are optional
+            JSON_Object* templates = json_object_get_object(root, "instruction_templates");
+
+            size_t i;
+            for (i = 0; i < count; ++i)
+            {
+                JSON_Object* device_json = json_array_get_object(devices, i);
+                if (
+                    device_json == NULL ||
+                    parse_fleet_device(device_json, templates, controller_index, fleet_devices) != 0
+                   )
+                {
+                    LogError("Parsing entry %zu of the 'devices' array failed", i);
+                    break;
+                }
+            }
+
+            if (i < count)
+            {
+                free_fleet_devices(fleet_devices);
+                result = NULL;
+            }
+            else
+            {
+                /*Codes_SRS_BLE_17_001: [ BLE_ParseConfigurationFromJson shall allocate a new BLE_CONFIG structure containing BLE instructions and configuration as parsed from the JSON input. ] */
+                result = (BLE_CONFIG*)malloc(sizeof(BLE_CONFIG));
+                if (result == NULL)
+                {
+                    LogError("allocation of configuration failed");
+                    free_fleet_devices(fleet_devices);
+                }
+                else
+                {
+                    memset(&(result->device_config), 0, sizeof(result->device_config));
+                    result->device_config.ble_controller_index = controller_index;
+                    result->instructions = NULL;
+                    result->devices = fleet_devices;
+
+                    /*Codes_SRS_BLE_44_010: [ BLE_ParseConfigurationFromJson shall read the max_connections, min_connection_time_in_ms and retry_interval_in_ms properties of a fleet from the JSON and use 4, 1000 and 5000 respectively when they are missing or not positive. ]*/
+                    result->scheduler_config.max_connections = get_positive_number(root, "max_connections", DEFAULT_MAX_CONNECTIONS);
+                    result->scheduler_config.min_connection_time_in_ms = get_positive_number(root, "min_connection_time_in_ms", DEFAULT_MIN_CONNECTION_TIME_IN_MS);
+                    result->scheduler_config.retry_interval_in_ms = get_positive_number(root, "retry_interval_in_ms", DEFAULT_RETRY_INTERVAL_IN_MS);
+
+                    parse_simulator(root, &(result->use_simulator), &(result->simulator));
+                    result->scheduler_config.use_simulator = result->use_simulator;
+                    result->scheduler_config.simulator = result->simulator;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+static void wait_for_destroy_complete(BLE_HANDLE_DATA* handle_data)
+{
+    // wait for the destroy complete callback to be called; bail after
+    // 5 seconds; this instance holds a reference on the shared loop so it
+    // cannot go away underneath us
+    gint64 start_time = g_get_monotonic_time();
+    if (g_event_loop.main_loop != NULL)
+    {
+        GMainContext* loop_context = g_main_loop_get_context(g_event_loop.main_loop);
+        if (loop_context != NULL)
+        {
+            LogInfo("Waiting for sequence to be destroyed...");
+            while (handle_data->is_destroy_complete == false)
+            {
+                g_main_context_iteration(loop_context, FALSE);
+                if ((g_get_monotonic_time() - start_time) >= DESTROY_COMPLETE_TIMEOUT)
+                {
+                    LogError("on_destroy_complete did not get called in time");
+                    break;
+                }
+            }
+            LogInfo("Done waiting for sequence to be destroyed.");
+        }
+        else
+        {
+            LogError("g_main_loop_get_context returned NULL");
+        }
+
+        release_glib_loop();
+    }
+}
+#endif
+
+static void free_read_group(BLE_READ_GROUP* group)
+{
+    if (group->telemetry.properties != NULL)
+    {
+        Map_Destroy(group->telemetry.properties);
+    }
+
+    size_t len = VECTOR_size(group->members);
+    for (size_t i = 0; i < len; ++i)
+    {
+        BLE_READ_GROUP_MEMBER* member = (BLE_READ_GROUP_MEMBER*)VECTOR_element(group->members, i);
+        STRING_delete(member->characteristic_uuid);
+        BUFFER_delete(member->data);
+    }
+
+    VECTOR_destroy(group->members);
+    STRING_delete(group->name);
+    free(group);
+}
+
+static BLE_READ_GROUP* create_read_group(BLE_DEVICE_TELEMETRY* telemetry, const BLE_INSTRUCTION* instruction)
+{
+    BLE_READ_GROUP* result = (BLE_READ_GROUP*)malloc(sizeof(BLE_READ_GROUP));
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        result->telemetry.module = telemetry->module;
+        result->telemetry.properties = NULL;
+        result->telemetry.read_group = result;
+        result->telemetry.read_groups = NULL;
+        result->instruction_type = instruction->instruction_type;
+        result->interval_in_ms = (instruction->instruction_type == READ_PERIODIC) ? instruction->data.interval_in_ms : 0;
+        result->completed_count = 0;
+        result->name = STRING_clone(instruction->read_group);
+        if (result->name == NULL)
+        {
+            LogError("STRING_clone failed");
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            result->members = VECTOR_create(sizeof(BLE_READ_GROUP_MEMBER));
+            if (result->members == NULL)
+            {
+                LogError("VECTOR_create failed");
+                STRING_delete(result->name);
+                free(result);
+                result = NULL;
+            }
+            else if (
+                (telemetry->read_groups == NULL) &&
+                ((telemetry->read_groups = VECTOR_create(sizeof(BLE_READ_GROUP*))) == NULL)
+            )
+            {
+                LogError("VECTOR_create failed");
+                free_read_group(result);
+                result = NULL;
+            }
+            else if (VECTOR_push_back(telemetry->read_groups, &result, 1) != 0)
+            {
+                LogError("VECTOR_push_back failed");
+                free_read_group(result);
+                result = NULL;
+            }
+        }
+    }
+
+    return result;
+}
+
+static BLE_READ_GROUP* add_to_read_group(BLE_DEVICE_TELEMETRY* telemetry, const BLE_INSTRUCTION* instruction)
+{
+    BLE_READ_GROUP* result = NULL;
+    size_t i, len = (telemetry->read_groups == NULL) ? 0 : VECTOR_size(telemetry->read_groups);
+    for (i = 0; i < len; ++i)
+    {
+        result = *(BLE_READ_GROUP**)VECTOR_element(telemetry->read_groups, i);
+        if (strcmp(STRING_c_str(result->name), STRING_c_str(instruction->read_group)) == 0)
+        {
+            break;
+        }
+    }
+
+    if (i == len)
+    {
+        // this is the first instruction of the group
+        result = create_read_group(telemetry, instruction);
+    }
+
+    if (result != NULL)
+    {
+        bool is_duplicate = false;
+        size_t member_count = VECTOR_size(result->members);
+        for (i = 0; i < member_count; ++i)
+        {
+            BLE_READ_GROUP_MEMBER* member = (BLE_READ_GROUP_MEMBER*)VECTOR_element(result->members, i);
+            if (strcmp(STRING_c_str(member->characteristic_uuid), STRING_c_str(instruction->characteristic_uuid)) == 0)
+            {
+                is_duplicate = true;
+                break;
+            }
+        }
+
+        if (
+            is_duplicate ||
+            instruction->instruction_type != result->instruction_type ||
+            (
+                instruction->instruction_type == READ_PERIODIC &&
+                instruction->data.interval_in_ms != result->interval_in_ms
+            )
+           )
+        {
+            /*Codes_SRS_BLE_46_002: [ BLE_Create shall return NULL if the instructions of a read group do not all have the same type and interval_in_ms or if a read group reads the same characteristic twice. ]*/
+            LogError("Instruction for characteristic %s does not match the other instructions of read group %s",
+                STRING_c_str(instruction->characteristic_uuid), STRING_c_str(result->name));
+            result = NULL;
+        }
+        else
+        {
+            BLE_READ_GROUP_MEMBER member;
+            member.data = NULL;
+            member.has_completed = false;
+            member.characteristic_uuid = STRING_clone(instruction->characteristic_uuid);
+            if (member.characteristic_uuid == NULL)
+            {
+                LogError("STRING_clone failed");
+                result = NULL;
+            }
+            else if (VECTOR_push_back(result->members, &member, 1) != 0)
+            {
+                LogError("VECTOR_push_back failed");
+                STRING_delete(member.characteristic_uuid);
+                result = NULL;
+            }
+        }
+    }
+
+    // the group stays with the telemetry of the device and is freed with it
+    return result;
+}
+
+static VECTOR_HANDLE ble_instr_to_bleioseq_instr(BLE_DEVICE_TELEMETRY* telemetry, VECTOR_HANDLE source_instructions)
+{
+    VECTOR_HANDLE result = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+    if (result != NULL)
+    {
+        size_t i, len = VECTOR_size(source_instructions);
+        for (i = 0; i < len; ++i)
+        {
+            BLE_INSTRUCTION* src_instr = (BLE_INSTRUCTION*)VECTOR_element(source_instructions, i);
+
+            // copy the data
+            BLEIO_SEQ_INSTRUCTION instr;
+            instr.instruction_type = src_instr->instruction_type;
+            instr.characteristic_uuid = STRING_clone(src_instr->characteristic_uuid);
+
+            if (
+                (
+                    src_instr->instruction_type == WRITE_AT_INIT ||
+                    src_instr->instruction_type == WRITE_ONCE ||
+                    src_instr->instruction_type == WRITE_AT_EXIT
+                )
+                &&
+                (
+                    src_instr->data.buffer != NULL
+                )
+              )
+            {
+                instr.data.buffer = BUFFER_clone(src_instr->data.buffer);
+                if(instr.data.buffer == NULL)
+                {
+                    LogError("BUFFER_clone failed");
+                    STRING_delete(instr.characteristic_uuid);
+                    break;
+                }
+            }
+            else
+            {
+                memcpy(&(instr.data), &(src_instr->data), sizeof(instr.data));
+            }
+
+            if (
+                src_instr->read_group == NULL ||
+                (
+                    src_instr->instruction_type != READ_ONCE &&
+                    src_instr->instruction_type != READ_PERIODIC
+                )
+               )
+            {
+                // only reads can be grouped
+                instr.context = telemetry;
+            }
+            else
+            {
+                // the reads of a group are published by the group
+                BLE_READ_GROUP* group = add_to_read_group(telemetry, src_instr);
+                if (group == NULL)
+                {
+                    LogError("add_to_read_group failed");
+                    STRING_delete(instr.characteristic_uuid);
+                    break;
+                }
+                instr.context = &(group->telemetry);
+            }
+
+            if (VECTOR_push_back(result, &instr, 1) != 0)
+            {
+                LogError("VECTOR_push_back failed");
+                STRING_delete(instr.characteristic_uuid);
+                break;
+            }
+        }
+
+        // if the loop terminated before all elements were processed,
+        // then something went wrong
+        if (i < len)
+        {
+            free_bleioseq_instr(result);
+            VECTOR_destroy(result);
+            result = NULL;
+        }
+    }
+    else
+    {
+        LogError("VECTOR_create failed");
+    }
+
+    return result;
+}
+
+static void on_connect_complete(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* context,
+    BLEIO_GATT_CONNECT_RESULT connect_result
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)context;
+    if (connect_result != BLEIO_GATT_CONNECT_OK)
+    {
+        LogError("BLEIO_gatt_connect asynchronously failed");
+    }
+    else
+    {
+        handle_data->is_connected = true;
+
+        /*Codes_SRS_BLE_13_014: [ If the asynchronous call to  BLEIO_gatt_connect  is successful then the  BLEIO_Seq_Run  function shall be called on the  bleio_seq  field from  BLE_HANDLE_DATA . ]*/
+        if (BLEIO_Seq_Run(handle_data->bleio_seq) != BLEIO_SEQ_OK)
+        {
+            LogError("BLEIO_Seq_Run failed");
+        }
+    }
+}
+
+static void init_telemetry(BLE_HANDLE_DATA* handle_data)
+{
+    handle_data->telemetry.module = handle_data;
+    handle_data->telemetry.properties = NULL;
+    handle_data->telemetry.read_group = NULL;
+    handle_data->telemetry.read_groups = NULL;
+    handle_data->fleet_telemetry = NULL;
+    handle_data->fleet_size = 0;
+
+    // 'time' returns -1 only when it fails and that is checked first
+    handle_data->timestamp_cache.second = (time_t)-1;
+    handle_data->timestamp_cache.text[0] = '\0';
+}
+
+static void free_device_telemetry(BLE_DEVICE_TELEMETRY* telemetry)
+{
+    if (telemetry->properties != NULL)
+    {
+        Map_Destroy(telemetry->properties);
+    }
+
+    if (telemetry->read_groups != NULL)
+    {
+        size_t len = VECTOR_size(telemetry->read_groups);
+        for (size_t i = 0; i < len; ++i)
+        {
+            free_read_group(*(BLE_READ_GROUP**)VECTOR_element(telemetry->read_groups, i));
+        }
+        VECTOR_destroy(telemetry->read_groups);
+    }
+}
+
+static void free_telemetry(BLE_HANDLE_DATA* handle_data)
+{
+    free_device_telemetry(&(handle_data->telemetry));
+
+    if (handle_data->fleet_telemetry != NULL)
+    {
+        for (size_t i = 0; i < handle_data->fleet_size; ++i)
+        {
+            free_device_telemetry(&(handle_data->fleet_telemetry[i]));
+        }
+        free(handle_data->fleet_telemetry);
+    }
+}
+
+static char* format_digits(char* dest, int value, size_t count)
+{
+    // fill in from the right so that the number is zero padded
+    for (size_t i = count; i > 0; --i)
+    {
+        dest[i - 1] = (char)('0' + (value % 10));
+        value /= 10;
+    }
+
+    return dest + count;
+}
+
+static int format_timestamp(BLE_TIMESTAMP_CACHE* cache)
+{
+    int result;
+    time_t t1 = time(NULL);
+    if (t1 == (time_t)-1)
+    {
+        LogError("time() failed");
+        result = __LINE__;
+    }
+    else if (t1 == cache->second)
+    {
+        // still the same second as the last read
+        result = 0;
+    }
+    else
+    {
+        struct tm* t2 = localtime(&t1);
+        if (t2 == NULL)
+        {
+            LogError("localtime() failed");
+            result = __LINE__;
+        }
+        else if (t2->tm_year < -1900 || t2->tm_year > (9999 - 1900))
+        {
+            LogError("year %d does not fit in the timestamp", t2->tm_year + 1900);
+            result = __LINE__;
+        }
+        else
+        {
+            /**
+             * This produces the same "%Y:%m:%dT%H:%M:%S" format strftime was
+             * used for without going through the locale machinery. Note: We
+             * record the time only with a granularity of seconds. We may want
+             * to increase this to include milliseconds.
+             */
+            char* p = cache->text;
+            p = format_digits(p, t2->tm_year + 1900, 4);
+            *p++ = ':';
+            p = format_digits(p, t2->tm_mon + 1, 2);
+            *p++ = ':';
+            p = format_digits(p, t2->tm_mday, 2);
+            *p++ = 'T';
+            p = format_digits(p, t2->tm_hour, 2);
+            *p++ = ':';
+            p = format_digits(p, t2->tm_min, 2);
+            *p++ = ':';
+            p = format_digits(p, t2->tm_sec, 2);
+            *p = '\0';
+
+            cache->second = t1;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static MAP_HANDLE create_telemetry_properties(const BLE_DEVICE_CONFIG* device_config, BLE_READ_GROUP* read_group)
+{
+    MAP_HANDLE result = Map_Create(NULL);
+    if (result == NULL)
+    {
+        LogError("Map_Create() failed");
+    }
+    else
+    {
+        // format BLE controller index
+        char ble_controller_index[80];
+        int ret = snprintf(ble_controller_index,
+            sizeof(ble_controller_index) / sizeof(ble_controller_index[0]),
+            "%d",
+            device_config->ble_controller_index
+        );
+        if(ret < 0 || (size_t)ret >= (sizeof(ble_controller_index) / sizeof(ble_controller_index[0])))
+        {
+            LogError("snprintf() failed");
+            Map_Destroy(result);
+            result = NULL;
+        }
+        else
+        {
+            // format MAC address
+            char mac_address[18] = "";
+            ret = snprintf(
+                mac_address,
+                sizeof(mac_address) / sizeof(mac_address[0]),
+                "%02X:%02X:%02X:%02X:%02X:%02X",
+                device_config->device_addr.address[0],
+                device_config->device_addr.address[1],
+                device_config->device_addr.address[2],
+                device_config->device_addr.address[3],
+                device_config->device_addr.address[4],
+                device_config->device_addr.address[5]
+            );
+            if (ret < 0 || (size_t)ret >= (sizeof(mac_address) / sizeof(mac_address[0])))
+            {
+                LogError("snprintf() failed");
+                Map_Destroy(result);
+                result = NULL;
+            }
+            else if (Map_Add(result, GW_BLE_CONTROLLER_INDEX_PROPERTY, ble_controller_index) != MAP_OK)
+            {
+                LogError("Map_Add() failed for property %s", GW_BLE_CONTROLLER_INDEX_PROPERTY);
+                Map_Destroy(result);
+                result = NULL;
+            }
+            else if (Map_Add(result, GW_MAC_ADDRESS_PROPERTY, mac_address) != MAP_OK)
+            {
+                LogError("Map_Add() failed for property %s", GW_MAC_ADDRESS_PROPERTY);
+                Map_Destroy(result);
+                result = NULL;
+            }
+            else if (Map_Add(result, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY) != MAP_OK)
+            {
+                LogError("Map_Add() failed for property %s", GW_SOURCE_PROPERTY);
+                Map_Destroy(result);
+                result = NULL;
+            }
+            else if (
+                read_group != NULL &&
+                Map_Add(result, GW_READ_GROUP_PROPERTY, STRING_c_str(read_group->name)) != MAP_OK
+            )
+            {
+                LogError("Map_Add() failed for property %s", GW_READ_GROUP_PROPERTY);
+                Map_Destroy(result);
+                result = NULL;
             }
         }
     }
@@ -593,121 +1524,250 @@ static void on_read_complete(
 )
 {
     (void)bleio_seq_handle;
-    (void)type;
     // this MUST NOT be NULL
-    BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)context;
-    if (result != BLEIO_SEQ_OK)
+    BLE_DEVICE_TELEMETRY* telemetry = (BLE_DEVICE_TELEMETRY*)context;
+    publish_read_result(telemetry, &(telemetry->module->device_config), characteristic_uuid, type, result, data);
+}
+
+static void publish_telemetry(
+    BLE_DEVICE_TELEMETRY* telemetry,
+    const BLE_DEVICE_CONFIG* device_config,
+    const char* characteristic_uuid,
+    const unsigned char* content,
+    size_t content_size
+)
+{
+    BLE_HANDLE_DATA* handle_data = telemetry->module;
+
+    /*Codes_SRS_BLE_45_001: [ BLE_Create shall format the ble_controller_index, mac_address and source properties of the messages it publishes for a device once, on the first successful read from that device. ]*/
+    if (telemetry->properties == NULL)
     {
-        LogError("A read instruction for characteristic %s of type %s failed.",
-            characteristic_uuid, ENUM_TO_STRING(BLEIO_SEQ_INSTRUCTION_TYPE, type));
+        telemetry->properties = create_telemetry_properties(device_config, telemetry->read_group);
+    }
+
+    if (telemetry->properties == NULL)
+    {
+        LogError("create_telemetry_properties() failed");
+    }
+    /*Codes_SRS_BLE_45_002: [ BLE_Create shall format the timestamp property of the messages it publishes at most once per second. ]*/
+    else if (format_timestamp(&(handle_data->timestamp_cache)) != 0)
+    {
+        LogError("format_timestamp() failed");
+    }
+    else if (Map_AddOrUpdate(telemetry->properties, GW_TIMESTAMP_PROPERTY, handle_data->timestamp_cache.text) != MAP_OK)
+    {
+        LogError("Map_AddOrUpdate() failed for property %s", GW_TIMESTAMP_PROPERTY);
+    }
+    else if (
+        characteristic_uuid != NULL &&
+        Map_AddOrUpdate(telemetry->properties, GW_CHARACTERISTIC_UUID_PROPERTY, characteristic_uuid) != MAP_OK
+    )
+    {
+        LogError("Map_AddOrUpdate() failed for property %s", GW_CHARACTERISTIC_UUID_PROPERTY);
     }
     else
     {
-        MAP_HANDLE message_properties = Map_Create(NULL);
-        if (message_properties == NULL)
+        MESSAGE_CONFIG message_config;
+        message_config.sourceProperties = telemetry->properties;
+        message_config.size = content_size;
+        message_config.source = content;
+
+        // this copies the properties so 'telemetry->properties' can be
+        // updated for the next read straight away
+        MESSAGE_HANDLE message = Message_Create(&message_config);
+        if (message == NULL)
         {
-            LogError("Map_Create() failed");
+            LogError("Message_Create() failed");
         }
         else
         {
-            // format BLE controller index
-            char ble_controller_index[80];
-            int ret = snprintf(ble_controller_index,
-                sizeof(ble_controller_index) / sizeof(ble_controller_index[0]),
-                "%d",
-                handle_data->device_config.ble_controller_index
-            );
-            if(ret < 0 || (size_t)ret >= (sizeof(ble_controller_index) / sizeof(ble_controller_index[0])))
+            /*Codes_SRS_BLE_13_019: [BLE_Create shall handle the ON_BLEIO_SEQ_READ_COMPLETE callback on the BLE I/O sequence. If the call is successful then a new message shall be published on the message broker with the buffer that was read as the content of the message along with the following properties:
+
+            | Property Name           | Description                                                   |
+            |-------------------------|---------------------------------------------------------------|
+            | ble_controller_index    | The index of the bluetooth radio hardware on the device.      |
+            | mac_address             | MAC address of the BLE device from which the data was read.   |
+            | timestamp               | Timestamp indicating when the data was read.                  |
+            | source                  | This property will always have the value `bleTelemetry`.      |
+
+            ]*/
+            if (Broker_Publish(handle_data->broker, (MODULE_HANDLE)handle_data, message) != BROKER_OK)
             {
-                LogError("snprintf() failed");
+                LogError("Broker_Publish() failed");
             }
-            else
+
+            Message_Destroy(message);
+        }
+    }
+}
+
+static STRING_HANDLE format_read_group_content(BLE_READ_GROUP* group)
+{
+    // {"<characteristic uuid>":"<base 64 encoded value>",...}
+    STRING_HANDLE result = STRING_construct("{");
+    if (result == NULL)
+    {
+        LogError("STRING_construct failed");
+    }
+    else
+    {
+        size_t i, len = VECTOR_size(group->members);
+        const char* separator = "\"";
+        for (i = 0; i < len; ++i)
+        {
+            BLE_READ_GROUP_MEMBER* member = (BLE_READ_GROUP_MEMBER*)VECTOR_element(group->members, i);
+            if (member->data != NULL)
             {
-                // format MAC address
-                char mac_address[18] = "";
-                ret = snprintf(
-                    mac_address,
-                    sizeof(mac_address) / sizeof(mac_address[0]),
-                    "%02X:%02X:%02X:%02X:%02X:%02X",
-                    handle_data->device_config.device_addr.address[0],
-                    handle_data->device_config.device_addr.address[1],
-                    handle_data->device_config.device_addr.address[2],
-                    handle_data->device_config.device_addr.address[3],
-                    handle_data->device_config.device_addr.address[4],
-                    handle_data->device_config.device_addr.address[5]
-                );
-                if (ret < 0 || (size_t)ret >= (sizeof(mac_address) / sizeof(mac_address[0])))
+                STRING_HANDLE value = Base64_Encode_Bytes(BUFFER_u_char(member->data), BUFFER_length(member->data));
+                if (value == NULL)
+                {
+                    LogError("Base64_Encode_Bytes failed");
+                    break;
+                }
+                else if (
+                    STRING_concat(result, separator) != 0 ||
+                    STRING_concat_with_STRING(result, member->characteristic_uuid) != 0 ||
+                    STRING_concat(result, "\":\"") != 0 ||
+                    STRING_concat_with_STRING(result, value) != 0 ||
+                    STRING_concat(result, "\"") != 0
+                )
                 {
-                    LogError("snprintf() failed");
+                    LogError("STRING_concat failed");
+                    STRING_delete(value);
+                    break;
                 }
                 else
                 {
-                    // format timestamp
-                    char timestamp[25] = "";
-                    if (format_timestamp(timestamp, sizeof(timestamp) / sizeof(timestamp[0])) != 0)
-                    {
-                        LogError("format_timestamp() failed");
-                    }
-                    else if (Map_Add(message_properties, GW_BLE_CONTROLLER_INDEX_PROPERTY, ble_controller_index) != MAP_OK)
-                    {
-                        LogError("Map_Add() failed for property %s", GW_BLE_CONTROLLER_INDEX_PROPERTY);
-                    }
-                    else if (Map_Add(message_properties, GW_MAC_ADDRESS_PROPERTY, mac_address) != MAP_OK)
-                    {
-                        LogError("Map_Add() failed for property %s", GW_MAC_ADDRESS_PROPERTY);
-                    }
-                    else if (Map_Add(message_properties, GW_TIMESTAMP_PROPERTY, timestamp) != MAP_OK)
-                    {
-                        LogError("Map_Add() failed for property %s", GW_TIMESTAMP_PROPERTY);
-                    }
-                    else if (Map_Add(message_properties, GW_CHARACTERISTIC_UUID_PROPERTY, characteristic_uuid) != MAP_OK)
-                    {
-                        LogError("Map_Add() failed for property %s", GW_CHARACTERISTIC_UUID_PROPERTY);
-                    }
-                    else if (Map_Add(message_properties, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY) != MAP_OK)
-                    {
-                        LogError("Map_Add() failed for property %s", GW_SOURCE_PROPERTY);
-                    }
-                    else
-                    {
-                        MESSAGE_CONFIG message_config;
-                        message_config.sourceProperties = message_properties;
-                        message_config.size = BUFFER_length(data); // "data" MUST NOT be NULL here
-                        message_config.source = (const unsigned char*)BUFFER_u_char(data);
+                    STRING_delete(value);
+                    separator = ",\"";
+                }
+            }
+        }
 
-                        MESSAGE_HANDLE message = Message_Create(&message_config);
-                        if (message == NULL)
-                        {
-                            LogError("Message_Create() failed");
-                        }
-                        else
-                        {
-                            /*Codes_SRS_BLE_13_019: [BLE_Create shall handle the ON_BLEIO_SEQ_READ_COMPLETE callback on the BLE I/O sequence. If the call is successful then a new message shall be published on the message broker with the buffer that was read as the content of the message along with the following properties:
+        if (i < len || STRING_concat(result, "}") != 0)
+        {
+            STRING_delete(result);
+            result = NULL;
+        }
+    }
+
+    return result;
+}
 
-                            | Property Name           | Description                                                   |
-                            |-------------------------|---------------------------------------------------------------|
-                            | ble_controller_index    | The index of the bluetooth radio hardware on the device.      |
-                            | mac_address             | MAC address of the BLE device from which the data was read.   |
-                            | timestamp               | Timestamp indicating when the data was read.                  |
-                            | source                  | This property will always have the value `bleTelemetry`.      |
+static void complete_group_read(
+    BLE_READ_GROUP* group,
+    const BLE_DEVICE_CONFIG* device_config,
+    const char* characteristic_uuid,
+    BUFFER_HANDLE data
+)
+{
+    size_t i, len = VECTOR_size(group->members);
+    BLE_READ_GROUP_MEMBER* member = NULL;
+    for (i = 0; i < len; ++i)
+    {
+        member = (BLE_READ_GROUP_MEMBER*)VECTOR_element(group->members, i);
+        if (strcmp(STRING_c_str(member->characteristic_uuid), characteristic_uuid) == 0)
+        {
+            break;
+        }
+    }
 
-                            ]*/
-                            if (Broker_Publish(handle_data->broker, (MODULE_HANDLE)handle_data, message) != BROKER_OK)
-                            {
-                                LogError("Broker_Publish() failed");
-                            }
+    if (i == len)
+    {
+        LogError("Characteristic %s is not part of read group %s", characteristic_uuid, STRING_c_str(group->name));
+        BUFFER_delete(data);
+    }
+    else
+    {
+        // a newer read of a characteristic replaces the value that has not
+        // been published yet
+        BUFFER_delete(member->data);
+        member->data = data;
+        if (member->has_completed == false)
+        {
+            member->has_completed = true;
+            group->completed_count++;
+        }
 
-                            Message_Destroy(message);
-                        }
-                    }
+        if (group->completed_count == len)
+        {
+            bool has_data = false;
+            for (i = 0; i < len; ++i)
+            {
+                member = (BLE_READ_GROUP_MEMBER*)VECTOR_element(group->members, i);
+                has_data = has_data || (member->data != NULL);
+            }
 
-                    Map_Destroy(message_properties);
+            if (has_data == false)
+            {
+                /*Codes_SRS_BLE_46_004: [ BLE_Create shall not publish a message for a round of reads of a read group in which every read failed. ]*/
+                LogError("Every read of read group %s failed", STRING_c_str(group->name));
+            }
+            else
+            {
+                STRING_HANDLE content = format_read_group_content(group);
+                if (content == NULL)
+                {
+                    LogError("format_read_group_content failed");
                 }
+                else
+                {
+                    /*Codes_SRS_BLE_46_003: [ Once every instruction of a read group has completed BLE_Create shall publish a single message whose content is a JSON object that maps the UUIDs of the characteristics that were read successfully to their base 64 encoded values, with the properties of a single read except characteristicUUID and with a readGroup property that has the name of the group. ]*/
+                    const char* text = STRING_c_str(content);
+                    publish_telemetry(&(group->telemetry), device_config, NULL, (const unsigned char*)text, strlen(text));
+                    STRING_delete(content);
+                }
+            }
+
+            // start the next round
+            for (i = 0; i < len; ++i)
+            {
+                member = (BLE_READ_GROUP_MEMBER*)VECTOR_element(group->members, i);
+                BUFFER_delete(member->data);
+                member->data = NULL;
+                member->has_completed = false;
             }
+            group->completed_count = 0;
+        }
+    }
+}
+
+static void publish_read_result(
+    BLE_DEVICE_TELEMETRY* telemetry,
+    const BLE_DEVICE_CONFIG* device_config,
+    const char* characteristic_uuid,
+    BLEIO_SEQ_INSTRUCTION_TYPE type,
+    BLEIO_SEQ_RESULT result,
+    BUFFER_HANDLE data
+)
+{
+    if (result != BLEIO_SEQ_OK)
+    {
+        LogError("A read instruction for characteristic %s of type %s failed.",
+            characteristic_uuid, ENUM_TO_STRING(BLEIO_SEQ_INSTRUCTION_TYPE, type));
+    }
+
+    if (telemetry->read_group != NULL)
+    {
+        // the group takes ownership of the data; a failed read still
+        // completes the round for its characteristic
+        if (result != BLEIO_SEQ_OK)
+        {
+            BUFFER_delete(data);
+            data = NULL;
         }
+        complete_group_read(telemetry->read_group, device_config, characteristic_uuid, data);
     }
+    else
+    {
+        if (result == BLEIO_SEQ_OK)
+        {
+            // "data" MUST NOT be NULL here
+            publish_telemetry(telemetry, device_config, characteristic_uuid, BUFFER_u_char(data), BUFFER_length(data));
+        }
 
-    BUFFER_delete(data);
+        BUFFER_delete(data);
+    }
 }
 
 void on_write_complete(
@@ -722,9 +1782,14 @@ void on_write_complete(
     (void)characteristic_uuid;
     (void)type;
     // this MUST NOT be NULL
-    BLE_HANDLE_DATA* handle_data = (BLE_HANDLE_DATA*)context;
+    BLE_HANDLE_DATA* handle_data = ((BLE_DEVICE_TELEMETRY*)context)->module;
 
-    if (result != BLEIO_SEQ_OK)
+    if (result == BLEIO_SEQ_SUPERSEDED)
+    {
+        /*Codes_SRS_BLE_48_004: [ A write that has been replaced by a newer write to the same characteristic before it started shall not be reported as an error. ]*/
+        LogInfo("Write to characteristic %s was superseded by a newer write", characteristic_uuid);
+    }
+    else if (result != BLEIO_SEQ_OK)
     {
         // format MAC address
         char mac_address[18];
@@ -797,7 +1862,12 @@ static void BLE_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message)
         {
             // fetch the 'macAddress' property
             const char* mac_address = ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY);
-            if (mac_address != NULL && is_message_for_module(mac_address, handle_data) == true)
+            if (handle_data->scheduler != NULL)
+            {
+                /*Codes_SRS_BLE_44_011: [ BLE_Receive shall ignore all messages when the module drives a fleet of devices. ]*/
+                LogError("Writing to the devices of a fleet is not supported");
+            }
+            else if (mac_address != NULL && is_message_for_module(mac_address, handle_data) == true)
             {
                 const CONSTBUFFER* content = Message_GetContent(message);
                 if (content != NULL && content->buffer != NULL && content->size > 0)
@@ -812,12 +1882,31 @@ static void BLE_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message)
 
                     // MUST set this as the context so on_read_complete and on_write_complete get
                     // access to BLE_HANDLE_DATA
-                    ble_seq_instruction.context = (void*)module;
+                    ble_seq_instruction.context = (void*)&(handle_data->telemetry);
 
                     /*Codes_SRS_BLE_13_021: [ BLE_Receive shall treat the content of the message as a BLE_INSTRUCTION and schedule it for execution by calling BLEIO_Seq_AddInstruction. ]*/
-                    if (BLEIO_Seq_AddInstruction(handle_data->bleio_seq, &ble_seq_instruction) != BLEIO_SEQ_OK)
+                    BLEIO_SEQ_RESULT add_result = BLEIO_Seq_AddInstruction(handle_data->bleio_seq, &ble_seq_instruction);
+                    if (add_result != BLEIO_SEQ_OK)
                     {
-                        LogError("BLEIO_Seq_AddInstruction failed");
+                        if (add_result == BLEIO_SEQ_QUEUE_FULL)
+                        {
+                            LogError("The write queue of the characteristic is full; dropping the instruction");
+                        }
+                        else
+                        {
+                            LogError("BLEIO_Seq_AddInstruction failed");
+                        }
+
+                        /*Codes_SRS_BLE_48_003: [ BLE_Receive shall free the characteristic UUID and the buffer of the instruction if BLEIO_Seq_AddInstruction fails. ]*/
+                        STRING_delete(ble_instruction->characteristic_uuid);
+                        if (
+                            ble_instruction->instruction_type == WRITE_AT_INIT ||
+                            ble_instruction->instruction_type == WRITE_AT_EXIT ||
+                            ble_instruction->instruction_type == WRITE_ONCE
+                           )
+                        {
+                            BUFFER_delete(ble_instruction->data.buffer);
+                        }
                     }
                 }
             }
@@ -875,44 +1964,32 @@ static void BLE_Destroy(MODULE_HANDLE module)
                 on_destroy_complete,
                 (void*)handle_data
             );
- #if __linux__
-            // wait for on_destroy_complete to be called; bail after 5 seconds
-            gint64 start_time = g_get_monotonic_time();
-            if (handle_data->main_loop != NULL)
+#if __linux__
+            wait_for_destroy_complete(handle_data);
+#endif
+        }
+#if __linux__
+        else if (handle_data->scheduler != NULL)
+        {
+            /*Codes_SRS_BLE_44_012: [ BLE_Destroy shall destroy the scheduler of a fleet on the GLIB loop by calling BLE_Scheduler_Destroy and stop the timer that drives it once the scheduler is destroyed or waiting for it times out. ]*/
+            if (g_idle_add(on_scheduler_destroy, handle_data) == 0)
             {
-                GMainContext* loop_context = g_main_loop_get_context(handle_data->main_loop);
-                if (loop_context != NULL)
-                {
-                    LogInfo("Waiting for sequence to be destroyed...");
-                    while (handle_data->is_destroy_complete == false)
-                    {
-                        g_main_context_iteration(loop_context, FALSE);
-                        if ((g_get_monotonic_time() - start_time) >= DESTROY_COMPLETE_TIMEOUT)
-                        {
-                            LogError("on_destroy_complete did not get called in time");
-                            break;
-                        }
-                    }
-                    LogInfo("Done waiting for sequence to be destroyed.");
-                }
-                else
-                {
-                    LogError("g_main_loop_get_context returned NULL");
-                }
-
-                // terminate glib loop
-                g_main_loop_quit(handle_data->main_loop);
+                LogError("g_idle_add failed");
+                release_glib_loop();
+            }
+            else
+            {
+                wait_for_destroy_complete(handle_data);
+            }
 
-                // wait for thread to exit
-                int thread_result;
-                if (ThreadAPI_Join(handle_data->event_thread, &thread_result) != THREADAPI_OK)
-                {
-                    LogError("ThreadAPI_Join() returned an error");
-                }
+            if (handle_data->tick_source != 0)
+            {
+                g_source_remove(handle_data->tick_source);
             }
-#endif
         }
+#endif
 
+        free_telemetry(handle_data);
         free(handle_data);
     }
     else
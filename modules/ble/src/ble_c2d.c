@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include <ctype.h>
+#include <stdint.h>
 #include "azure_c_shared_utility/gballoc.h"
 
 /*because it is linked statically, this include will bring in some uniquely (by convention) named functions*/
@@ -168,6 +170,616 @@ static int publish_instruction(BLE_C2D_HANDLE_DATA* handle_data, CONSTMAP_HANDLE
     return result;
 }
 
+/**
+ * A run of characters in the message content, used to refer to the values of
+ * a flat JSON object without copying them.
+ */
+typedef struct JSON_SPAN_TAG
+{
+    const char* start;
+    size_t      length;
+}JSON_SPAN;
+
+typedef struct FLAT_INSTRUCTION_TAG
+{
+    JSON_SPAN                   type;
+    JSON_SPAN                   characteristic_uuid;
+    JSON_SPAN                   data;
+    JSON_SPAN                   interval_in_ms;
+
+    /**
+     * Where the values of the properties that are not part of a BLE
+     * instruction go.
+     */
+    JSON_SPAN                   ignored;
+
+    BLEIO_SEQ_INSTRUCTION_TYPE  instruction_type;
+    uint32_t                    interval;
+    size_t                      data_size;
+}FLAT_INSTRUCTION;
+
+// value of each character in the base64 alphabet indexed by its code;
+// -1 for the characters that are not part of it
+static const signed char BASE64_VALUES[256] =
+{
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+static bool is_write_instruction(BLEIO_SEQ_INSTRUCTION_TYPE type)
+{
+    return type == WRITE_ONCE || type == WRITE_AT_INIT || type == WRITE_AT_EXIT;
+}
+
+static bool span_equals(const JSON_SPAN* span, const char* text)
+{
+    size_t length = strlen(text);
+    return span->length == length && memcmp(span->start, text, length) == 0;
+}
+
+static const char* skip_whitespace(const char* p, const char* end)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+    {
+        p++;
+    }
+
+    return p;
+}
+
+static bool scan_string(const char** p, const char* end, JSON_SPAN* span)
+{
+    bool result;
+    const char* q = *p;
+    if (q == end || *q != '"')
+    {
+        result = false;
+    }
+    else
+    {
+        q++;
+        span->start = q;
+
+        // strings with escape sequences are left to the JSON parser
+        while (q < end && *q != '"' && *q != '\\' && (unsigned char)*q >= 0x20)
+        {
+            q++;
+        }
+
+        if (q == end || *q != '"')
+        {
+            result = false;
+        }
+        else
+        {
+            span->length = (size_t)(q - span->start);
+            *p = q + 1;
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+static bool scan_scalar(const char** p, const char* end, JSON_SPAN* span)
+{
+    const char* q = *p;
+    span->start = q;
+    while (q < end && (isalnum((unsigned char)*q) || *q == '-' || *q == '+' || *q == '.'))
+    {
+        q++;
+    }
+
+    span->length = (size_t)(q - span->start);
+    *p = q;
+
+    // a number or one of the literals, nested objects and arrays are left to the JSON parser
+    return
+        span->length > 0 &&
+        (
+            span->start[0] == '-' ||
+            (span->start[0] >= '0' && span->start[0] <= '9') ||
+            span_equals(span, "true") ||
+            span_equals(span, "false") ||
+            span_equals(span, "null")
+        );
+}
+
+static bool scan_uint32(const JSON_SPAN* span, uint32_t* value)
+{
+    bool result;
+
+    // leading zeros, signs, fractions and exponents are left to the JSON parser
+    if (span->length == 0 || span->length > 10 || (span->length > 1 && span->start[0] == '0'))
+    {
+        result = false;
+    }
+    else
+    {
+        uint64_t accumulator = 0;
+        size_t i;
+        for (i = 0; i < span->length && span->start[i] >= '0' && span->start[i] <= '9'; i++)
+        {
+            accumulator = accumulator * 10 + (uint64_t)(span->start[i] - '0');
+        }
+
+        if (i < span->length || accumulator > UINT32_MAX)
+        {
+            result = false;
+        }
+        else
+        {
+            *value = (uint32_t)accumulator;
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+static int base64_value(char c)
+{
+    return BASE64_VALUES[(unsigned char)c];
+}
+
+static bool scan_base64(const JSON_SPAN* span, size_t* decoded_size)
+{
+    bool result;
+    if (span->length == 0 || span->length % 4 != 0)
+    {
+        result = false;
+    }
+    else
+    {
+        size_t padding = 0;
+        size_t i;
+        if (span->start[span->length - 1] == '=')
+        {
+            padding = (span->start[span->length - 2] == '=') ? 2 : 1;
+        }
+
+        for (i = 0; i < span->length - padding && base64_value(span->start[i]) >= 0; i++)
+        {
+        }
+
+        if (i < span->length - padding)
+        {
+            result = false;
+        }
+        else
+        {
+            *decoded_size = (span->length / 4) * 3 - padding;
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+static void decode_base64(const JSON_SPAN* span, unsigned char* destination, size_t decoded_size)
+{
+    size_t written = 0;
+    for (size_t i = 0; i < span->length && written < decoded_size; i += 4)
+    {
+        uint32_t quad = 0;
+        for (size_t j = 0; j < 4; j++)
+        {
+            int value = base64_value(span->start[i + j]);
+            quad = (quad << 6) | (uint32_t)(value < 0 ? 0 : value);
+        }
+
+        for (size_t j = 0; j < 3 && written < decoded_size; j++)
+        {
+            destination[written++] = (unsigned char)(quad >> (16 - 8 * j));
+        }
+    }
+}
+
+static JSON_SPAN* get_flat_field(FLAT_INSTRUCTION* fields, const JSON_SPAN* name, bool is_string)
+{
+    JSON_SPAN* result;
+    if (span_equals(name, "type"))
+    {
+        result = is_string ? &(fields->type) : NULL;
+    }
+    else if (span_equals(name, "characteristic_uuid"))
+    {
+        result = is_string ? &(fields->characteristic_uuid) : NULL;
+    }
+    else if (span_equals(name, "data"))
+    {
+        result = is_string ? &(fields->data) : NULL;
+    }
+    else if (span_equals(name, "interval_in_ms"))
+    {
+        result = is_string ? NULL : &(fields->interval_in_ms);
+    }
+    else
+    {
+        // other properties are ignored, just like the JSON parser path does
+        result = &(fields->ignored);
+    }
+
+    return result;
+}
+
+/**
+ * Scans a flat JSON object in place and records where the values of the
+ * properties of a BLE instruction are. Returns false for anything that the
+ * JSON parser has to look at: nested values, escape sequences, duplicate or
+ * mistyped properties, numbers that are not plain integers and so on.
+ */
+static bool scan_flat_object(const CONSTBUFFER* content, FLAT_INSTRUCTION* fields)
+{
+    bool result;
+    const char* p = (const char*)(content->buffer);
+    const char* end = p + content->size;
+
+    memset(fields, 0, sizeof(FLAT_INSTRUCTION));
+    p = skip_whitespace(p, end);
+    if (p == end || *p != '{')
+    {
+        result = false;
+    }
+    else
+    {
+        p = skip_whitespace(p + 1, end);
+        result = (p < end && *p == '"');
+        while (result == true)
+        {
+            JSON_SPAN name;
+            JSON_SPAN value;
+            bool is_string;
+            JSON_SPAN* field;
+
+            if (scan_string(&p, end, &name) == false)
+            {
+                result = false;
+                break;
+            }
+
+            p = skip_whitespace(p, end);
+            if (p == end || *p != ':')
+            {
+                result = false;
+                break;
+            }
+
+            p = skip_whitespace(p + 1, end);
+            is_string = (p < end && *p == '"');
+            if (
+                (is_string == true && scan_string(&p, end, &value) == false) ||
+                (is_string == false && scan_scalar(&p, end, &value) == false)
+               )
+            {
+                result = false;
+                break;
+            }
+
+            field = get_flat_field(fields, &name, is_string);
+            if (field == NULL || (field != &(fields->ignored) && field->start != NULL))
+            {
+                result = false;
+                break;
+            }
+            *field = value;
+
+            p = skip_whitespace(p, end);
+            if (p < end && *p == ',')
+            {
+                p = skip_whitespace(p + 1, end);
+            }
+            else if (p < end && *p == '}')
+            {
+                p++;
+                break;
+            }
+            else
+            {
+                result = false;
+            }
+        }
+
+        if (result == true)
+        {
+            // allow trailing whitespace and string terminators after the object
+            while (p < end && (*p == '\0' || *p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+            {
+                p++;
+            }
+            result = (p == end);
+        }
+    }
+
+    return result;
+}
+
+static bool scan_flat_instruction(const CONSTBUFFER* content, FLAT_INSTRUCTION* fields)
+{
+    bool result;
+    if (
+        scan_flat_object(content, fields) == false ||
+        fields->type.start == NULL ||
+        fields->characteristic_uuid.start == NULL
+       )
+    {
+        result = false;
+    }
+    else if (span_equals(&(fields->type), "read_once"))
+    {
+        fields->instruction_type = READ_ONCE;
+        result = true;
+    }
+    else if (span_equals(&(fields->type), "read_periodic"))
+    {
+        fields->instruction_type = READ_PERIODIC;
+        result =
+            scan_uint32(&(fields->interval_in_ms), &(fields->interval)) == true &&
+            fields->interval > 0;
+    }
+    else if (span_equals(&(fields->type), "notify"))
+    {
+        fields->instruction_type = NOTIFY;
+        result = true;
+    }
+    else if (
+        span_equals(&(fields->type), "write_once") ||
+        span_equals(&(fields->type), "write_at_init") ||
+        span_equals(&(fields->type), "write_at_exit")
+       )
+    {
+        fields->instruction_type =
+            span_equals(&(fields->type), "write_once") ? WRITE_ONCE :
+            span_equals(&(fields->type), "write_at_init") ? WRITE_AT_INIT :
+            WRITE_AT_EXIT;
+        result =
+            fields->data.start != NULL &&
+            scan_base64(&(fields->data), &(fields->data_size)) == true;
+    }
+    else
+    {
+        result = false;
+    }
+
+    return result;
+}
+
+static bool build_instruction(
+    BLEIO_SEQ_INSTRUCTION_TYPE instruction_type,
+    const char* characteristic_uuid,
+    size_t characteristic_uuid_length,
+    BLE_INSTRUCTION* ble_instr
+)
+{
+    bool result;
+    ble_instr->instruction_type = instruction_type;
+    ble_instr->characteristic_uuid = STRING_construct_n(characteristic_uuid, characteristic_uuid_length);
+    if (ble_instr->characteristic_uuid == NULL)
+    {
+        /*Codes_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+        LogError("Characteristic uuid string creation failed.");
+        result = false;
+    }
+    else
+    {
+        result = true;
+    }
+
+    return result;
+}
+
+static bool parse_flat_instruction(const FLAT_INSTRUCTION* fields, BLE_INSTRUCTION* ble_instr)
+{
+    bool result;
+    if (build_instruction(
+            fields->instruction_type,
+            fields->characteristic_uuid.start,
+            fields->characteristic_uuid.length,
+            ble_instr
+        ) == false)
+    {
+        LogError("build_instruction failed");
+        result = false;
+    }
+    else if (fields->instruction_type == READ_PERIODIC)
+    {
+        ble_instr->data.interval_in_ms = fields->interval;
+        result = true;
+    }
+    else if (is_write_instruction(fields->instruction_type) == false)
+    {
+        result = true;
+    }
+    else
+    {
+        ble_instr->data.buffer = BUFFER_new();
+        if (ble_instr->data.buffer == NULL)
+        {
+            /*Codes_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+            LogError("BUFFER_new failed");
+            free_instruction(ble_instr);
+            result = false;
+        }
+        else if (BUFFER_pre_build(ble_instr->data.buffer, fields->data_size) != 0)
+        {
+            /*Codes_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+            LogError("BUFFER_pre_build failed");
+            free_instruction(ble_instr);
+            result = false;
+        }
+        else
+        {
+            decode_base64(&(fields->data), BUFFER_u_char(ble_instr->data.buffer), fields->data_size);
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+static bool parse_binary_instruction(const CONSTBUFFER* content, BLE_INSTRUCTION* ble_instr)
+{
+    bool result;
+    const unsigned char* source = content->buffer;
+
+    if (
+        content->size < BLE_C2D_BINARY_HEADER_SIZE ||
+        source[0] != BLE_C2D_BINARY_VERSION ||
+        source[1] > (unsigned char)NOTIFY ||
+        source[2] == 0 ||
+        content->size < BLE_C2D_BINARY_HEADER_SIZE + (size_t)source[2]
+       )
+    {
+        /*Codes_SRS_BLE_CTOD_47_002: [ BLE_C2D_Receive shall do nothing if a binary BLE instruction is shorter than its header, has an unsupported version or instruction type, has an empty or truncated characteristic UUID, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction without data or is any other instruction with data. ]*/
+        LogError("Malformed binary BLE instruction of %zu bytes", content->size);
+        result = false;
+    }
+    else
+    {
+        BLEIO_SEQ_INSTRUCTION_TYPE instruction_type = (BLEIO_SEQ_INSTRUCTION_TYPE)source[1];
+        size_t uuid_length = source[2];
+        uint32_t interval =
+            (uint32_t)source[4] |
+            ((uint32_t)source[5] << 8) |
+            ((uint32_t)source[6] << 16) |
+            ((uint32_t)source[7] << 24);
+        const unsigned char* data = source + BLE_C2D_BINARY_HEADER_SIZE + uuid_length;
+        size_t data_size = content->size - BLE_C2D_BINARY_HEADER_SIZE - uuid_length;
+
+        if (
+            (instruction_type == READ_PERIODIC && interval == 0) ||
+            (is_write_instruction(instruction_type) == true && data_size == 0) ||
+            (is_write_instruction(instruction_type) == false && data_size != 0)
+           )
+        {
+            /*Codes_SRS_BLE_CTOD_47_002: [ BLE_C2D_Receive shall do nothing if a binary BLE instruction is shorter than its header, has an unsupported version or instruction type, has an empty or truncated characteristic UUID, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction without data or is any other instruction with data. ]*/
+            LogError("Invalid binary BLE instruction of type %d", (int)instruction_type);
+            result = false;
+        }
+        else if (build_instruction(
+                instruction_type,
+                (const char*)(source + BLE_C2D_BINARY_HEADER_SIZE),
+                uuid_length,
+                ble_instr
+            ) == false)
+        {
+            LogError("build_instruction failed");
+            result = false;
+        }
+        else if (instruction_type == READ_PERIODIC)
+        {
+            ble_instr->data.interval_in_ms = interval;
+            result = true;
+        }
+        else if (is_write_instruction(instruction_type) == false)
+        {
+            result = true;
+        }
+        else
+        {
+            ble_instr->data.buffer = BUFFER_create(data, data_size);
+            if (ble_instr->data.buffer == NULL)
+            {
+                /*Codes_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+                LogError("BUFFER_create failed");
+                free_instruction(ble_instr);
+                result = false;
+            }
+            else
+            {
+                result = true;
+            }
+        }
+    }
+
+    return result;
+}
+
+static bool parse_json_instruction(const CONSTBUFFER* content, BLE_INSTRUCTION* ble_instr)
+{
+    bool result;
+
+    /*Codes_SRS_BLE_CTOD_17_006: [ BLE_C2D_Receive shall parse the message contents as a JSON object. ]*/
+    JSON_Value* json = json_parse_string((const char*)(content->buffer));
+    if (json != NULL)
+    {
+        JSON_Object* instr = json_value_get_object(json);
+        if (instr != NULL)
+        {
+            const char* type = json_object_get_string(instr, "type");
+            if (type != NULL)
+            {
+                const char* characteristic_uuid = json_object_get_string(instr, "characteristic_uuid");
+                if (characteristic_uuid != NULL)
+                {
+                    ble_instr->characteristic_uuid = STRING_construct(characteristic_uuid);
+                    if (ble_instr->characteristic_uuid != NULL)
+                    {
+                        /*Codes_SRS_BLE_CTOD_17_014: [ BLE_C2D_Receive shall parse the json object to fill in a new BLE_INSTRUCTION. ]*/
+                        if (parse_instruction(type, instr, ble_instr, 0) == true)
+                        {
+                            result = true;
+                        }
+                        else
+                        {
+                            /*Codes_SRS_BLE_CTOD_17_026: [ If the json object does not parse, BLE_C2D_Receive shall return. ]*/
+                            LogError("Not a valid BLE instruction");
+                            free_instruction(ble_instr);
+                            result = false;
+                        }
+                    }
+                    else
+                    {
+                        /*Codes_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+                        LogError("Characteristic uuid string creation failed.");
+                        result = false;
+                    }
+                }
+                else
+                {
+                    /*Codes_SRS_BLE_CTOD_17_008: [ BLE_C2D_Receive shall return if the JSON object does not contain the following fields: "type" and "characteristic_uuid". ]*/
+                    LogError("Characteristic uuid not found");
+                    result = false;
+                }
+            }
+            else
+            {
+                /*Codes_SRS_BLE_CTOD_17_008: [ BLE_C2D_Receive shall return if the JSON object does not contain the following fields: "type" and "characteristic_uuid". ]*/
+                LogError("BLE Instruction type not found");
+                result = false;
+            }
+        }
+        else
+        {
+            LogError("JSON Object expected, not received.");
+            result = false;
+        }
+        json_value_free(json);
+    }
+    else
+    {
+        /*Codes_SRS_BLE_CTOD_17_007: [ If the message contents do not parse, then BLE_C2D_Receive shall do nothing. ]*/
+        LogError("JSON parsing failed");
+        result = false;
+    }
+
+    return result;
+}
+
 static void BLE_C2D_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message_handle)
 {
     if(module != NULL && message_handle != NULL)
@@ -181,75 +793,40 @@ static void BLE_C2D_Receive(MODULE_HANDLE module, MESSAGE_HANDLE message_handle)
                 const CONSTBUFFER * message_content = Message_GetContent(message_handle);
                 if (message_content != NULL)
                 {
-                    /*Codes_SRS_BLE_CTOD_17_006: [ BLE_C2D_Receive shall parse the message contents as a JSON object. ]*/
-                    JSON_Value* json = json_parse_string((const char*)(message_content->buffer));
-                    if (json != NULL)
+                    BLE_INSTRUCTION ble_instr = { 0 };
+                    FLAT_INSTRUCTION fields;
+                    bool parsed;
+                    const char* content_type = ConstMap_GetValue(properties, GW_CONTENT_TYPE_PROPERTY);
+                    if (content_type != NULL && strcmp(content_type, GW_CONTENT_TYPE_BLE_INSTRUCTION) == 0)
                     {
-                        JSON_Object* instr = json_value_get_object(json);
-                        if (instr != NULL)
-                        {
-                            const char* type = json_object_get_string(instr, "type");
-                            if (type != NULL)
-                            {
-                                const char* characteristic_uuid = json_object_get_string(instr, "characteristic_uuid");
-                                if (characteristic_uuid != NULL)
-                                {
-                                    BLE_INSTRUCTION ble_instr = { 0 };
-
-                                    ble_instr.characteristic_uuid = STRING_construct(characteristic_uuid);
-                                    if (ble_instr.characteristic_uuid != NULL)
-                                    {
-                                        /*Codes_SRS_BLE_CTOD_17_014: [ BLE_C2D_Receive shall parse the json object to fill in a new BLE_INSTRUCTION. ]*/
-                                        if (parse_instruction(type, instr, &ble_instr, 0) == true)
-                                        {
-                                            if (publish_instruction(handle_data, properties, &ble_instr) != 0)
-                                            {
-                                                free_instruction(&ble_instr);
-                                            }
-
-                                            /**
-                                             * NOTE:
-                                             *  We don't free the instruction if the publish is successful because the
-                                             *  BLE module will do that. Note that we are passing the string handle for
-                                             *  the characteristic UUID and the data buffer (in case of write instructions)
-                                             *  as pointers. This means that this won't really work with out-process modules.
-                                             */
-                                        }
-                                        else
-                                        {
-                                            /*Codes_SRS_BLE_CTOD_17_026: [ If the json object does not parse, BLE_C2D_Receive shall return. ]*/
-                                            LogError("Not a valid BLE instruction");
-                                            free_instruction(&ble_instr);
-                                        }
-                                    }
-                                    else
-                                    {
-                                        /*Codes_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
-                                        LogError("Characteristic uuid string creation failed.");
-                                    }
-                                }
-                                else
-                                {
-                                    /*Codes_SRS_BLE_CTOD_17_008: [ BLE_C2D_Receive shall return if the JSON object does not contain the following fields: "type" and "characteristic_uuid". ]*/
-                                    LogError("Characteristic uuid not found");
-                                }
-                            }
-                            else
-                            {
-                                /*Codes_SRS_BLE_CTOD_17_008: [ BLE_C2D_Receive shall return if the JSON object does not contain the following fields: "type" and "characteristic_uuid". ]*/
-                                LogError("BLE Instruction type not found");
-                            }
-                        }
-                        else
-                        {
-                            LogError("JSON Object expected, not received.");
-                        }
-                        json_value_free(json);
+                        /*Codes_SRS_BLE_CTOD_47_001: [ If the message has a "contentType" property whose value is "application/x-ble-instruction", BLE_C2D_Receive shall decode the message content as a binary BLE instruction instead of JSON. ]*/
+                        parsed = parse_binary_instruction(message_content, &ble_instr);
+                    }
+                    else if (scan_flat_instruction(message_content, &fields) == true)
+                    {
+                        /*Codes_SRS_BLE_CTOD_47_003: [ If the message contents are a flat JSON object whose strings contain no escape sequences, BLE_C2D_Receive shall fill in the BLE_INSTRUCTION directly from the message contents without building a JSON document. ]*/
+                        parsed = parse_flat_instruction(&fields, &ble_instr);
                     }
                     else
                     {
-                        /*Codes_SRS_BLE_CTOD_17_007: [ If the message contents do not parse, then BLE_C2D_Receive shall do nothing. ]*/
-                        LogError("JSON parsing failed");
+                        /*Codes_SRS_BLE_CTOD_47_004: [ If the message contents cannot be translated that way, BLE_C2D_Receive shall parse them with the JSON parser. ]*/
+                        parsed = parse_json_instruction(message_content, &ble_instr);
+                    }
+
+                    if (parsed == true)
+                    {
+                        if (publish_instruction(handle_data, properties, &ble_instr) != 0)
+                        {
+                            free_instruction(&ble_instr);
+                        }
+
+                        /**
+                         * NOTE:
+                         *  We don't free the instruction if the publish is successful because the
+                         *  BLE module will do that. Note that we are passing the string handle for
+                         *  the characteristic UUID and the data buffer (in case of write instructions)
+                         *  as pointers. This means that this won't really work with out-process modules.
+                         */
                     }
                 }
                 else
@@ -18,6 +18,22 @@
 
 static gint g_string_cmp(gconstpointer s1, gconstpointer s2, gpointer user_data);
 static void tree_key_value_destroy(gpointer data);
+static gint object_path_cmp(gconstpointer s1, gconstpointer s2, gpointer user_data);
+
+// The connection to the system d-bus and the object manager for org.bluez are
+// shared by all the GATT I/O handles in the process. The object manager keeps
+// a proxy for every object that bluez exports so having one of these for each
+// device gets expensive quickly. The shared objects are released when the last
+// handle is destroyed.
+typedef struct SHARED_BUS_TAG
+{
+    size_t                      ref_count;
+    GDBusConnection*            bus;
+    GDBusObjectManagerClient*   object_manager;
+}SHARED_BUS;
+
+static SHARED_BUS g_shared_bus = { 0, NULL, NULL };
+G_LOCK_DEFINE_STATIC(g_shared_bus);
 
 BLEIO_GATT_HANDLE BLEIO_gatt_create(
     const BLE_DEVICE_CONFIG* config
@@ -40,19 +56,64 @@ BLEIO_GATT_HANDLE BLEIO_gatt_create(
             );
             if(result->char_object_path_map != NULL)
             {
-                // save the device's MAC address
-                memcpy(
-                    &(result->device_addr),
-                    &(config->device_addr),
-                    sizeof(BLE_MAC_ADDRESS)
+                // create a map that caches the characteristic proxies
+                // used for reads and writes so that each I/O does not
+                // cost an extra d-bus round trip; the keys are copies
+                // of the object paths and the values are proxy references
+                result->char_proxy_map = g_tree_new_full(
+                    object_path_cmp,
+                    NULL,
+                    g_free,
+                    g_object_unref
                 );
-                result->bus = NULL;
-                result->object_manager = NULL;
-                result->device = NULL;
-                result->state = BLEIO_GATT_STATE_DISCONNECTED;
-                result->ble_controller_index = config->ble_controller_index;
+                if (result->char_proxy_map != NULL)
+                {
+                    // create a map of the characteristics that notifications
+                    // have been started for; the keys are copies of the object
+                    // paths and the values are the subscriptions
+                    result->char_notify_map = g_tree_new_full(
+                        object_path_cmp,
+                        NULL,
+                        g_free,
+                        free_notify_context
+                    );
+                    if (result->char_notify_map != NULL)
+                    {
+                        // save the device's MAC address
+                        memcpy(
+                            &(result->device_addr),
+                            &(config->device_addr),
+                            sizeof(BLE_MAC_ADDRESS)
+                        );
+                        result->bus = NULL;
+                        result->object_manager = NULL;
+                        result->device = NULL;
+                        result->state = BLEIO_GATT_STATE_DISCONNECTED;
+                        result->ble_controller_index = config->ble_controller_index;
+                        result->sim = NULL;
+
+                        G_LOCK(g_shared_bus);
+                        g_shared_bus.ref_count++;
+                        G_UNLOCK(g_shared_bus);
 
-                /*Codes_SRS_BLEIO_GATT_13_001: [ BLEIO_gatt_create shall return a non-NULL handle on successful execution. ]*/
+                        /*Codes_SRS_BLEIO_GATT_13_001: [ BLEIO_gatt_create shall return a non-NULL handle on successful execution. ]*/
+                    }
+                    else
+                    {
+                        LogError("g_tree_new failed");
+                        g_tree_unref(result->char_proxy_map);
+                        g_tree_unref(result->char_object_path_map);
+                        free(result);
+                        result = NULL;
+                    }
+                }
+                else
+                {
+                    LogError("g_tree_new failed");
+                    g_tree_unref(result->char_object_path_map);
+                    free(result);
+                    result = NULL;
+                }
             }
             else
             {
@@ -88,25 +149,124 @@ void BLEIO_gatt_destroy(
         /*Codes_SRS_BLEIO_GATT_13_004: [ BLEIO_gatt_destroy shall free all resources associated with the handle. ]*/
         BLEIO_GATT_HANDLE_DATA* handle_data = (BLEIO_GATT_HANDLE_DATA*)bleio_gatt_handle;
 
-        if (handle_data->bus != NULL)
-        {
-            g_object_unref(handle_data->bus);
-        }
-        if (handle_data->object_manager != NULL)
-        {
-            g_object_unref(handle_data->object_manager);
-        }
-        if (handle_data->device != NULL)
+        if (handle_data->sim != NULL)
         {
-            g_object_unref(handle_data->device);
+            /*Codes_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+            sim_gatt_destroy(handle_data);
         }
-        if (handle_data->char_object_path_map != NULL)
+        else
         {
-            g_tree_unref(handle_data->char_object_path_map);
+            /*Codes_SRS_BLEIO_GATT_43_003: [ BLEIO_gatt_destroy shall release the shared d-bus connection and object manager only when the last handle in the process is destroyed. ]*/
+            // 'bus' and 'object_manager' are borrowed from the shared objects
+            // which are released along with the last handle
+            GDBusConnection* bus = NULL;
+            GDBusObjectManagerClient* object_manager = NULL;
+            G_LOCK(g_shared_bus);
+            if (--g_shared_bus.ref_count == 0)
+            {
+                bus = g_shared_bus.bus;
+                object_manager = g_shared_bus.object_manager;
+                g_shared_bus.bus = NULL;
+                g_shared_bus.object_manager = NULL;
+            }
+            G_UNLOCK(g_shared_bus);
+
+            if (bus != NULL)
+            {
+                g_object_unref(bus);
+            }
+            if (object_manager != NULL)
+            {
+                g_object_unref(object_manager);
+            }
+            if (handle_data->device != NULL)
+            {
+                g_object_unref(handle_data->device);
+            }
+            if (handle_data->char_object_path_map != NULL)
+            {
+                g_tree_unref(handle_data->char_object_path_map);
+            }
+            if (handle_data->char_proxy_map != NULL)
+            {
+                g_tree_unref(handle_data->char_proxy_map);
+            }
+            if (handle_data->char_notify_map != NULL)
+            {
+                /*Codes_SRS_BLEIO_GATT_42_015: [ BLEIO_gatt_destroy shall stop the notifications that were started on a connected device by calling StopNotify on the characteristics. ]*/
+                g_tree_unref(handle_data->char_notify_map);
+            }
+
+            free(handle_data);
         }
+    }
+}
+
+bool get_shared_object_manager(
+    GDBusConnection** bus,
+    GDBusObjectManagerClient** object_manager
+)
+{
+    bool result;
+
+    G_LOCK(g_shared_bus);
+    if (g_shared_bus.bus != NULL && g_shared_bus.object_manager != NULL)
+    {
+        *bus = g_shared_bus.bus;
+        *object_manager = g_shared_bus.object_manager;
+        result = true;
+    }
+    else
+    {
+        result = false;
+    }
+    G_UNLOCK(g_shared_bus);
+
+    return result;
+}
 
-        free(handle_data);
+GDBusConnection* share_bus(GDBusConnection* bus)
+{
+    GDBusConnection* result;
+
+    G_LOCK(g_shared_bus);
+    if (g_shared_bus.bus == NULL)
+    {
+        g_shared_bus.bus = bus;
+        bus = NULL;
+    }
+    result = g_shared_bus.bus;
+    G_UNLOCK(g_shared_bus);
+
+    // another handle got there first
+    if (bus != NULL)
+    {
+        g_object_unref(bus);
     }
+
+    return result;
+}
+
+GDBusObjectManagerClient* share_object_manager(GDBusObjectManagerClient* object_manager)
+{
+    GDBusObjectManagerClient* result;
+
+    G_LOCK(g_shared_bus);
+    if (g_shared_bus.object_manager == NULL)
+    {
+        g_shared_bus.object_manager = object_manager;
+        object_manager = NULL;
+    }
+    result = g_shared_bus.object_manager;
+    G_UNLOCK(g_shared_bus);
+
+    // another handle got there first
+    if (object_manager != NULL)
+    {
+        g_object_unref(object_manager);
+    }
+
+    return result;
 }
 
 static gint g_string_cmp(gconstpointer s1, gconstpointer s2, gpointer user_data)
@@ -150,3 +310,9 @@ static void tree_key_value_destroy(gpointer data)
         g_string_free((GString*)data, TRUE);
     }
 }
+
+static gint object_path_cmp(gconstpointer s1, gconstpointer s2, gpointer user_data)
+{
+    (void)user_data;
+    return g_strcmp0((const gchar*)s1, (const gchar*)s2);
+}
@@ -54,6 +54,8 @@ static void free_context(CONNECT_CONTEXT* context);
 //  [*] Get a connection to the system d-bus
 //  [*] Get a reference to the d-bus object manager for the
 //      org.bluez root object
+//      (these first two steps are skipped when another handle in
+//      the process has already done them; see share_object_manager)
 //  [*] Get a device proxy object for the given mac address
 //  [*] Open a connection to the device
 //  [*] Load up all characteristics on the device and map
@@ -68,8 +70,13 @@ int BLEIO_gatt_connect(
     int result;
     BLEIO_GATT_HANDLE_DATA* handle_data = (BLEIO_GATT_HANDLE_DATA*)bleio_gatt_handle;
 
+    /*Codes_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+    if (bleio_gatt_handle != NULL && handle_data->sim != NULL)
+    {
+        result = sim_gatt_connect(handle_data, on_bleio_gatt_connect_complete, callback_context);
+    }
     /*Codes_SRS_BLEIO_GATT_13_047: [ If when BLEIO_gatt_connect is called, there's another connection request already in progress or if an open connection already exists, then this API shall return a non-zero error code. ]*/
-    if (
+    else if (
             bleio_gatt_handle != NULL &&
             on_bleio_gatt_connect_complete != NULL &&
             (
@@ -97,24 +104,45 @@ int BLEIO_gatt_connect(
             {
                 /*Codes_SRS_BLEIO_GATT_13_007: [ BLEIO_gatt_connect shall asynchronously attempt to open a connection with the BLE device. ]*/
                 // setup call sequence
-                GIO_ASYNCSEQ_RESULT seq_result = GIO_Async_Seq_Add(
-                    context->async_seq, NULL,
+                GIO_ASYNCSEQ_RESULT seq_result;
+                if (get_shared_object_manager(&(handle_data->bus), &(handle_data->object_manager)) == true)
+                {
+                    /*Codes_SRS_BLEIO_GATT_43_001: [ BLEIO_gatt_connect shall reuse the system d-bus connection and the org.bluez object manager that are shared by all the handles in the process if they have already been created. ]*/
+                    seq_result = GIO_Async_Seq_Add(
+                        context->async_seq, NULL,
+
+                        // create an instance of a device proxy object
+                        create_device_proxy, create_device_proxy_finish,
 
-                    // connect to the system bus
-                    connect_system_bus, connect_system_bus_finish,
+                        // connect to the device
+                        connect_device, connect_device_finish,
 
-                    // create an instance of the d-bus object manager
-                    create_object_manager, create_object_manager_finish,
+                        // sentinel value to signal end of sequence
+                        NULL
+                    );
+                }
+                else
+                {
+                    /*Codes_SRS_BLEIO_GATT_43_002: [ If the shared d-bus connection and object manager have not been created yet then BLEIO_gatt_connect shall create them and share them with the other handles in the process. ]*/
+                    seq_result = GIO_Async_Seq_Add(
+                        context->async_seq, NULL,
 
-                    // create an instance of a device proxy object
-                    create_device_proxy, create_device_proxy_finish,
+                        // connect to the system bus
+                        connect_system_bus, connect_system_bus_finish,
 
-                    // connect to the device
-                    connect_device, connect_device_finish,
+                        // create an instance of the d-bus object manager
+                        create_object_manager, create_object_manager_finish,
 
-                    // sentinel value to signal end of sequence
-                    NULL
-                );
+                        // create an instance of a device proxy object
+                        create_device_proxy, create_device_proxy_finish,
+
+                        // connect to the device
+                        connect_device, connect_device_finish,
+
+                        // sentinel value to signal end of sequence
+                        NULL
+                    );
+                }
                 if (seq_result == GIO_ASYNCSEQ_OK)
                 {
                     context->device_path = NULL;
@@ -203,7 +231,7 @@ static void create_object_manager(
 {
     (void)callback_context;
     CONNECT_CONTEXT* context = (CONNECT_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
-    context->handle_data->bus = (GDBusConnection*)previous_result;
+    context->handle_data->bus = share_bus((GDBusConnection*)previous_result);
 
     g_dbus_object_manager_client_new(
         context->handle_data->bus,
@@ -236,7 +264,15 @@ static void create_device_proxy(
 {
     (void)callback_context;
     CONNECT_CONTEXT* context = (CONNECT_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
-    context->handle_data->object_manager = (GDBusObjectManagerClient*)previous_result;
+
+    // 'previous_result' is NULL when this is the first step because the
+    // shared object manager is being reused
+    if (previous_result != NULL)
+    {
+        context->handle_data->object_manager = share_object_manager(
+            (GDBusObjectManagerClient*)previous_result
+        );
+    }
 
     // convert BLE MAC address to an object path
     context->device_path = g_string_new(NULL);
@@ -282,6 +318,12 @@ static void connect_device(
 {
     (void)callback_context;
     CONNECT_CONTEXT* context = (CONNECT_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+
+    /*Codes_SRS_BLEIO_GATT_44_001: [ BLEIO_gatt_connect shall release the device proxy left over from a previous connection when the handle is connected again. ]*/
+    if (context->handle_data->device != NULL)
+    {
+        g_object_unref(context->handle_data->device);
+    }
     context->handle_data->device = (bluezdevice*)previous_result;
 
     /*Codes_SRS_BLEIO_GATT_13_007: [ BLEIO_gatt_connect shall asynchronously attempt to open a connection with the BLE device. ]*/
@@ -35,7 +35,12 @@ void BLEIO_gatt_disconnect(
     BLEIO_GATT_HANDLE_DATA* handle_data = (BLEIO_GATT_HANDLE_DATA*)bleio_gatt_handle;
     if (bleio_gatt_handle != NULL)
     {
-        if (handle_data->state == BLEIO_GATT_STATE_CONNECTED)
+        /*Codes_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+        if (handle_data->sim != NULL)
+        {
+            sim_gatt_disconnect(handle_data, on_bleio_gatt_disconnect_complete, callback_context);
+        }
+        else if (handle_data->state == BLEIO_GATT_STATE_CONNECTED)
         {
             /*Codes_SRS_BLEIO_GATT_13_054: [ BLEIO_gatt_disconnect shall do nothing if an underlying platform call fails. ]*/
             DISCONNECT_CONTEXT* context = (DISCONNECT_CONTEXT*)malloc(sizeof(DISCONNECT_CONTEXT));
@@ -80,6 +85,19 @@ static void on_device_disconnect(
     (void)source_object;
     DISCONNECT_CONTEXT* context = (DISCONNECT_CONTEXT*)user_data;
     bluez_device__call_disconnect_finish(context->handle_data->device, result, NULL);
+    context->handle_data->state = BLEIO_GATT_STATE_DISCONNECTED;
+
+    /*Codes_SRS_BLEIO_GATT_41_005: [ When the disconnect operation has been completed, all the characteristic proxies in the cache shall be released. ]*/
+    // g_tree_destroy removes all the entries and drops a reference; we
+    // add one first so that the cache itself stays usable for the next
+    // connection
+    g_tree_ref(context->handle_data->char_proxy_map);
+    g_tree_destroy(context->handle_data->char_proxy_map);
+
+    /*Codes_SRS_BLEIO_GATT_42_013: [ When the disconnect operation has been completed, all the notification subscriptions shall be released. ]*/
+    // bluez stops the notifications itself when the device disconnects
+    g_tree_ref(context->handle_data->char_notify_map);
+    g_tree_destroy(context->handle_data->char_notify_map);
 
     /*Codes_SRS_BLEIO_GATT_13_050: [ When the disconnect operation has been completed, the callback function pointed at by on_bleio_gatt_disconnect_complete shall be invoked if it is not NULL. ]*/
     /*Codes_SRS_BLEIO_GATT_13_049: [ When on_bleio_gatt_disconnect_complete is invoked the value passed in callback_context to BLEIO_gatt_disconnect shall be passed along to on_bleio_gatt_disconnect_complete. ]*/
@@ -0,0 +1,484 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include "bluez_device.h"
+#include "bluez_characteristic.h"
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "gio_async_seq.h"
+#include "ble_gatt_io.h"
+#include "ble_gatt_io_linux_common.h"
+
+typedef struct NOTIFY_CONTEXT_TAG
+{
+    BLEIO_GATT_HANDLE_DATA*                 handle_data;
+    GString*                                object_path;
+    bluezcharacteristic*                    characteristic;
+    GIO_ASYNCSEQ_HANDLE                     async_seq;
+    gulong                                  signal_handler_id;
+    bool                                    is_notifying;
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE     on_notify_start_complete;
+    ON_BLEIO_GATT_ATTRIB_NOTIFY             on_notify;
+    void*                                   callback_context;
+}NOTIFY_CONTEXT;
+
+// called when an error occurs in an async call
+static void on_sequence_error(GIO_ASYNCSEQ_HANDLE async_seq_handle, const GError* error);
+
+// called when the entire async sequence completes
+static void on_sequence_complete(GIO_ASYNCSEQ_HANDLE async_seq_handle, gpointer previous_result);
+
+// async sequence functions
+static void create_characteristic(GIO_ASYNCSEQ_HANDLE async_seq_handle, gpointer previous_result, gpointer callback_context, GAsyncReadyCallback async_callback);
+static gpointer create_characteristic_finish(GIO_ASYNCSEQ_HANDLE async_seq_handle, GAsyncResult* result, GError** error);
+
+static void start_notify(GIO_ASYNCSEQ_HANDLE async_seq_handle, gpointer previous_result, gpointer callback_context, GAsyncReadyCallback async_callback);
+static gpointer start_notify_finish(GIO_ASYNCSEQ_HANDLE async_seq_handle, GAsyncResult* result, GError** error);
+
+// called by the proxy when bluez reports that properties of the characteristic changed
+static void on_properties_changed(GDBusProxy* proxy, GVariant* changed_properties, GStrv invalidated_properties, gpointer user_data);
+
+int BLEIO_gatt_notify_char_by_uuid(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_bleio_gatt_notify_start_complete,
+    ON_BLEIO_GATT_ATTRIB_NOTIFY on_bleio_gatt_attrib_notify,
+    void* callback_context
+)
+{
+    int result;
+    BLEIO_GATT_HANDLE_DATA* handle_data = (BLEIO_GATT_HANDLE_DATA*)bleio_gatt_handle;
+
+    /*Codes_SRS_BLEIO_GATT_42_001: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if bleio_gatt_handle is NULL. ]*/
+    /*Codes_SRS_BLEIO_GATT_42_002: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if ble_uuid is NULL. ]*/
+    /*Codes_SRS_BLEIO_GATT_42_003: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if on_bleio_gatt_notify_start_complete or on_bleio_gatt_attrib_notify is NULL. ]*/
+    /*Codes_SRS_BLEIO_GATT_42_004: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if the object is not in a connected state. ]*/
+    /*Codes_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+    if (bleio_gatt_handle != NULL && handle_data->sim != NULL)
+    {
+        result = sim_gatt_notify(handle_data, ble_uuid, on_bleio_gatt_notify_start_complete, on_bleio_gatt_attrib_notify, callback_context);
+    }
+    else if (
+            bleio_gatt_handle != NULL &&
+            ble_uuid != NULL &&
+            on_bleio_gatt_notify_start_complete != NULL &&
+            on_bleio_gatt_attrib_notify != NULL &&
+            handle_data->state == BLEIO_GATT_STATE_CONNECTED
+       )
+    {
+        GString* uuid = g_string_new(ble_uuid);
+        if (uuid != NULL)
+        {
+            GString* object_path = g_tree_lookup(handle_data->char_object_path_map, uuid);
+            if (object_path != NULL)
+            {
+                // now that we have the object path we don't need the UUID anymore
+                g_string_free(uuid, TRUE);
+
+                NOTIFY_CONTEXT *context = (NOTIFY_CONTEXT *)malloc(sizeof(NOTIFY_CONTEXT));
+                if (context != NULL)
+                {
+                    // create async sequence
+                    context->async_seq = GIO_Async_Seq_Create(
+                        context,
+                        on_sequence_error,
+                        on_sequence_complete
+                    );
+                    if (context->async_seq != NULL)
+                    {
+                        // reuse the proxy of an earlier I/O on this
+                        // characteristic if there is one, otherwise create it first
+                        bluezcharacteristic* characteristic = (bluezcharacteristic*)g_tree_lookup(
+                            handle_data->char_proxy_map,
+                            object_path->str
+                        );
+
+                        // setup call sequence
+                        GIO_ASYNCSEQ_RESULT seq_result;
+                        if (characteristic != NULL)
+                        {
+                            seq_result = GIO_Async_Seq_Add(
+                                context->async_seq, NULL,
+
+                                // start notifications on the cached characteristic
+                                start_notify, start_notify_finish,
+
+                                // sentinel value to signal end of sequence
+                                NULL
+                            );
+                        }
+                        else
+                        {
+                            seq_result = GIO_Async_Seq_Add(
+                                context->async_seq, NULL,
+
+                                // create an instance of the characteristic
+                                create_characteristic, create_characteristic_finish,
+
+                                // start notifications on the characteristic
+                                start_notify, start_notify_finish,
+
+                                // sentinel value to signal end of sequence
+                                NULL
+                            );
+                        }
+                        if (seq_result == GIO_ASYNCSEQ_OK)
+                        {
+                            context->handle_data = handle_data;
+                            context->object_path = object_path;
+                            context->characteristic = (characteristic != NULL) ?
+                                (bluezcharacteristic*)g_object_ref(characteristic) :
+                                NULL;
+                            context->signal_handler_id = 0;
+                            context->is_notifying = false;
+                            context->on_notify_start_complete = on_bleio_gatt_notify_start_complete;
+                            context->on_notify = on_bleio_gatt_attrib_notify;
+                            context->callback_context = callback_context;
+
+                            /*Codes_SRS_BLEIO_GATT_42_014: [ BLEIO_gatt_notify_char_by_uuid shall stop an earlier subscription for the characteristic by calling StopNotify on it before it starts notifications again. ]*/
+                            // d-bus delivers the calls of a connection in
+                            // order so bluez sees the StopNotify first
+                            (void)g_tree_remove(handle_data->char_notify_map, object_path->str);
+
+                            /*Codes_SRS_BLEIO_GATT_42_006: [ BLEIO_gatt_notify_char_by_uuid shall asynchronously start notifications for the characteristic with the specified UUID by calling StartNotify on it. ]*/
+                            // kick-off the sequence
+                            if (GIO_Async_Seq_Run_Async(context->async_seq) == GIO_ASYNCSEQ_OK)
+                            {
+                                /*Codes_SRS_BLEIO_GATT_42_007: [ BLEIO_gatt_notify_char_by_uuid shall return 0 (zero) if the start notifications operation is successfully initiated. ]*/
+                                result = 0;
+                            }
+                            else
+                            {
+                                result = __LINE__;
+                                if (context->characteristic != NULL)
+                                {
+                                    g_object_unref(context->characteristic);
+                                }
+                                GIO_Async_Seq_Destroy(context->async_seq);
+                                free(context);
+                                LogError("GIO_Async_Seq_Run failed.");
+                            }
+                        }
+                        else
+                        {
+                            /*Codes_SRS_BLEIO_GATT_42_005: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+                            result = __LINE__;
+                            GIO_Async_Seq_Destroy(context->async_seq);
+                            free(context);
+                            LogError("GIO_Async_Seq_Add failed.");
+                        }
+                    }
+                    else
+                    {
+                        /*Codes_SRS_BLEIO_GATT_42_005: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+                        result = __LINE__;
+                        free(context);
+                        LogError("GIO_Async_Seq_Create failed.");
+                    }
+                }
+                else
+                {
+                    /*Codes_SRS_BLEIO_GATT_42_005: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+                    result = __LINE__;
+                    LogError("malloc failed.");
+                }
+            }
+            else
+            {
+                /*Codes_SRS_BLEIO_GATT_42_005: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+                result = __LINE__;
+                g_string_free(uuid, TRUE);
+                LogError("g_tree_lookup() failed.");
+            }
+        }
+        else
+        {
+            /*Codes_SRS_BLEIO_GATT_42_005: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+            result = __LINE__;
+            LogError("g_string_new() failed.");
+        }
+    }
+    else
+    {
+        result = __LINE__;
+        LogError("Invalid args or the state of the object is unexpected.");
+    }
+
+    return result;
+}
+
+static void create_characteristic(
+    GIO_ASYNCSEQ_HANDLE async_seq_handle,
+    gpointer previous_result,
+    gpointer callback_context,
+    GAsyncReadyCallback async_callback
+)
+{
+    (void)previous_result;
+    (void)callback_context;
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+    bluez_characteristic__proxy_new(
+        context->handle_data->bus,
+        G_DBUS_PROXY_FLAGS_NONE,
+        "org.bluez",
+        context->object_path->str,
+        NULL,
+        async_callback,
+        async_seq_handle
+    );
+}
+
+static gpointer create_characteristic_finish(
+    GIO_ASYNCSEQ_HANDLE async_seq_handle,
+    GAsyncResult* result,
+    GError** error
+)
+{
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+    bluezcharacteristic* characteristic = bluez_characteristic__proxy_new_finish(result, error);
+
+    // the proxy is only cached while the device is connected because the
+    // cache is cleared when it disconnects
+    if (characteristic != NULL && context->handle_data->state == BLEIO_GATT_STATE_CONNECTED)
+    {
+        /*Codes_SRS_BLEIO_GATT_42_008: [ When a characteristic proxy has been created, BLEIO_gatt_notify_char_by_uuid shall add it to the cache of characteristic proxies if the object is in a connected state. ]*/
+        g_tree_insert(
+            context->handle_data->char_proxy_map,
+            g_strdup(context->object_path->str),
+            g_object_ref(characteristic)
+        );
+    }
+
+    return characteristic;
+}
+
+static void start_notify(
+    GIO_ASYNCSEQ_HANDLE async_seq_handle,
+    gpointer previous_result,
+    gpointer callback_context,
+    GAsyncReadyCallback async_callback
+)
+{
+    (void)callback_context;
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+    if (previous_result != NULL)
+    {
+        // this is the proxy made by create_characteristic; it is
+        // NULL when the cached proxy is used
+        context->characteristic = (bluezcharacteristic*)previous_result;
+    }
+
+    bluez_characteristic__call_start_notify(
+        context->characteristic,
+        NULL,
+        async_callback,
+        async_seq_handle
+    );
+}
+
+static gpointer start_notify_finish(
+    GIO_ASYNCSEQ_HANDLE async_seq_handle,
+    GAsyncResult* result,
+    GError** error
+)
+{
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+
+    // 'error' is set when this fails
+    (void)bluez_characteristic__call_start_notify_finish(
+        context->characteristic,
+        result,
+        error
+    );
+
+    return NULL;
+}
+
+static void on_sequence_complete(GIO_ASYNCSEQ_HANDLE async_seq_handle, gpointer previous_result)
+{
+    (void)previous_result;
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+
+    // the subscription outlives the sequence
+    GIO_Async_Seq_Destroy(context->async_seq);
+    context->async_seq = NULL;
+
+    BLEIO_GATT_RESULT result;
+    if (context->handle_data->state != BLEIO_GATT_STATE_CONNECTED)
+    {
+        LogError("The device was disconnected while notifications were being started.");
+        result = BLEIO_GATT_ERROR;
+    }
+    else
+    {
+        // bluez sends the notifications as changes to the 'Value' property
+        // of the characteristic
+        context->signal_handler_id = g_signal_connect(
+            context->characteristic,
+            "g-properties-changed",
+            G_CALLBACK(on_properties_changed),
+            context
+        );
+        if (context->signal_handler_id == 0)
+        {
+            LogError("g_signal_connect() failed.");
+            result = BLEIO_GATT_ERROR;
+        }
+        else
+        {
+            // a subscription that was started at the same time is replaced
+            // without StopNotify; bluez keeps one notification session per
+            // d-bus client so that would stop this subscription as well
+            NOTIFY_CONTEXT* replaced = (NOTIFY_CONTEXT*)g_tree_lookup(
+                context->handle_data->char_notify_map,
+                context->object_path->str
+            );
+            if (replaced != NULL)
+            {
+                replaced->is_notifying = false;
+            }
+
+            /*Codes_SRS_BLEIO_GATT_42_011: [ Starting notifications for a characteristic that notifications were already started for shall replace the earlier subscription. ]*/
+            context->is_notifying = true;
+            g_tree_insert(
+                context->handle_data->char_notify_map,
+                g_strdup(context->object_path->str),
+                context
+            );
+            result = BLEIO_GATT_OK;
+        }
+    }
+
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_notify_start_complete = context->on_notify_start_complete;
+    BLEIO_GATT_HANDLE_DATA* handle_data = context->handle_data;
+    void* callback_context = context->callback_context;
+    if (result != BLEIO_GATT_OK)
+    {
+        free_notify_context(context);
+    }
+
+    /*Codes_SRS_BLEIO_GATT_42_009: [ BLEIO_gatt_notify_char_by_uuid shall invoke on_bleio_gatt_notify_start_complete with the value passed in callback_context and the result of the operation once notifications have been started. ]*/
+    // the subscription belongs to the handle now so it MUST NOT be touched
+    // after this call; the callback may very well destroy the handle
+    on_notify_start_complete(
+        (BLEIO_GATT_HANDLE)handle_data,
+        callback_context,
+        result
+    );
+}
+
+static void on_sequence_error(GIO_ASYNCSEQ_HANDLE async_seq_handle, const GError* error)
+{
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+
+    if (error != NULL)
+    {
+        LogError("Start notify failed with - %s", error->message);
+    }
+
+    // the cached proxy may have gone stale; drop it so that the next
+    // I/O on this characteristic creates a new one
+    g_tree_remove(
+        context->handle_data->char_proxy_map,
+        context->object_path->str
+    );
+
+    /*Codes_SRS_BLEIO_GATT_42_009: [ BLEIO_gatt_notify_char_by_uuid shall invoke on_bleio_gatt_notify_start_complete with the value passed in callback_context and the result of the operation once notifications have been started. ]*/
+    /*Codes_SRS_BLEIO_GATT_42_010: [ When an error occurs asynchronously, BLEIO_gatt_notify_char_by_uuid shall remove the proxy of the characteristic from the cache and pass BLEIO_GATT_ERROR for the result parameter of on_bleio_gatt_notify_start_complete. ]*/
+    context->on_notify_start_complete(
+        (BLEIO_GATT_HANDLE)context->handle_data,
+        context->callback_context,
+        BLEIO_GATT_ERROR
+    );
+
+    free_notify_context(context);
+}
+
+static void on_properties_changed(
+    GDBusProxy* proxy,
+    GVariant* changed_properties,
+    GStrv invalidated_properties,
+    gpointer user_data
+)
+{
+    (void)proxy;
+    (void)invalidated_properties;
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)user_data;
+
+    // changes to the other properties, 'Notifying' for instance, are
+    // not notifications
+    GVariant* value = g_variant_lookup_value(
+        changed_properties,
+        "Value",
+        G_VARIANT_TYPE_BYTESTRING
+    );
+    if (value != NULL)
+    {
+        gsize size;
+        const unsigned char* buffer = (const unsigned char*)g_variant_get_fixed_array(
+            value,
+            &size,
+            sizeof(guchar)
+        );
+
+        /*Codes_SRS_BLEIO_GATT_42_012: [ Each time the value of the characteristic changes BLEIO_gatt_notify_char_by_uuid shall invoke on_bleio_gatt_attrib_notify with the new value and the value passed in callback_context. ]*/
+        context->on_notify(
+            (BLEIO_GATT_HANDLE)context->handle_data,
+            context->callback_context,
+            buffer,
+            size
+        );
+
+        g_variant_unref(value);
+    }
+}
+
+void free_notify_context(gpointer data)
+{
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)data;
+
+    // we don't free context->object_path because that string lives in
+    // the uuid->object_path map in the BLEIO_GATT_HANDLE
+
+    if (context->characteristic != NULL)
+    {
+        // bluez stops the notifications itself once the device has
+        // disconnected; while it is connected they have to be stopped here
+        // because the d-bus connection is shared by all the handles and
+        // stays up after this one is gone
+        if (
+            context->is_notifying == true &&
+            context->handle_data->state == BLEIO_GATT_STATE_CONNECTED
+            )
+        {
+            bluez_characteristic__call_stop_notify(
+                context->characteristic,
+                NULL,
+                NULL,
+                NULL
+            );
+        }
+
+        if (context->signal_handler_id != 0)
+        {
+            g_signal_handler_disconnect(context->characteristic, context->signal_handler_id);
+        }
+
+        g_object_unref(context->characteristic);
+    }
+
+    if (context->async_seq != NULL)
+    {
+        GIO_Async_Seq_Destroy(context->async_seq);
+    }
+
+    free(context);
+}
@@ -56,7 +56,12 @@ int BLEIO_gatt_read_char_by_uuid(
     /*Codes_SRS_BLEIO_GATT_13_028: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if on_bleio_gatt_attrib_read_complete is NULL. ]*/
     /*Codes_SRS_BLEIO_GATT_13_051: [BLEIO_gatt_read_char_by_uuid shall return a non - zero value if ble_uuid is NULL. ] */
     /*Codes_SRS_BLEIO_GATT_13_052: [BLEIO_gatt_read_char_by_uuid shall return a non - zero value if the object is not in a connected state. ] */
-    if (
+    /*Codes_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+    if (bleio_gatt_handle != NULL && handle_data->sim != NULL)
+    {
+        result = sim_gatt_read(handle_data, ble_uuid, on_bleio_gatt_attrib_read_complete, callback_context);
+    }
+    else if (
             bleio_gatt_handle != NULL &&
             ble_uuid != NULL &&
             on_bleio_gatt_attrib_read_complete != NULL &&
@@ -83,24 +88,50 @@ int BLEIO_gatt_read_char_by_uuid(
                     );
                     if (context->async_seq != NULL)
                     {
+                        // reuse the proxy of an earlier read or write of this
+                        // characteristic if there is one, otherwise create it first
+                        /*Codes_SRS_BLEIO_GATT_41_001: [ BLEIO_gatt_read_char_by_uuid shall use the characteristic proxy cached for the object path of the characteristic if there is one instead of creating a new proxy. ]*/
+                        bluezcharacteristic* characteristic = (bluezcharacteristic*)g_tree_lookup(
+                            handle_data->char_proxy_map,
+                            object_path->str
+                        );
+
                         // setup call sequence
-                        GIO_ASYNCSEQ_RESULT seq_result = GIO_Async_Seq_Add(
-                            context->async_seq, NULL,
+                        GIO_ASYNCSEQ_RESULT seq_result;
+                        if (characteristic != NULL)
+                        {
+                            seq_result = GIO_Async_Seq_Add(
+                                context->async_seq, NULL,
 
-                            // create an instance of the characteristic
-                            create_characteristic, create_characteristic_finish,
+                                // read the cached characteristic
+                                read_characteristic, read_characteristic_finish,
 
-                            // read the characteristic
-                            read_characteristic, read_characteristic_finish,
+                                // sentinel value to signal end of sequence
+                                NULL
+                            );
+                        }
+                        else
+                        {
+                            seq_result = GIO_Async_Seq_Add(
+                                context->async_seq, NULL,
 
-                            // sentinel value to signal end of sequence
-                            NULL
-                        );
+                                // create an instance of the characteristic
+                                create_characteristic, create_characteristic_finish,
+
+                                // read the characteristic
+                                read_characteristic, read_characteristic_finish,
+
+                                // sentinel value to signal end of sequence
+                                NULL
+                            );
+                        }
                         if (seq_result == GIO_ASYNCSEQ_OK)
                         {
                             context->handle_data = handle_data;
                             context->object_path = object_path;
-                            context->characteristic = NULL;
+                            context->characteristic = (characteristic != NULL) ?
+                                (bluezcharacteristic*)g_object_ref(characteristic) :
+                                NULL;
                             context->on_read_complete = on_bleio_gatt_attrib_read_complete;
                             context->callback_context = callback_context;
 
@@ -114,6 +145,10 @@ int BLEIO_gatt_read_char_by_uuid(
                             else
                             {
                                 result = __LINE__;
+                                if (context->characteristic != NULL)
+                                {
+                                    g_object_unref(context->characteristic);
+                                }
                                 GIO_Async_Seq_Destroy(context->async_seq);
                                 free(context);
                                 LogError("GIO_Async_Seq_Run failed.");
@@ -194,8 +229,22 @@ static gpointer create_characteristic_finish(
     GError** error
 )
 {
-    (void)async_seq_handle;
-    return bluez_characteristic__proxy_new_finish(result, error);
+    READ_CONTEXT* context = (READ_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+    bluezcharacteristic* characteristic = bluez_characteristic__proxy_new_finish(result, error);
+
+    // the proxy is only cached while the device is connected because the
+    // cache is cleared when it disconnects
+    if (characteristic != NULL && context->handle_data->state == BLEIO_GATT_STATE_CONNECTED)
+    {
+        /*Codes_SRS_BLEIO_GATT_41_003: [ When a characteristic proxy has been created, BLEIO_gatt_read_char_by_uuid and BLEIO_gatt_write_char_by_uuid shall add it to the cache of characteristic proxies if the object is in a connected state. ]*/
+        g_tree_insert(
+            context->handle_data->char_proxy_map,
+            g_strdup(context->object_path->str),
+            g_object_ref(characteristic)
+        );
+    }
+
+    return characteristic;
 }
 
 static void read_characteristic(
@@ -207,7 +256,12 @@ static void read_characteristic(
 {
     (void)callback_context;
     READ_CONTEXT* context = (READ_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
-    context->characteristic = (bluezcharacteristic*)previous_result;
+    if (previous_result != NULL)
+    {
+        // this is the proxy made by create_characteristic; it is
+        // NULL when the cached proxy is used
+        context->characteristic = (bluezcharacteristic*)previous_result;
+    }
 
     bluez_characteristic__call_read_value(
         context->characteristic,
@@ -284,6 +338,14 @@ static void on_sequence_error(GIO_ASYNCSEQ_HANDLE async_seq_handle, const GError
         LogError("Read characteristic failed with - %s", error->message);
     }
 
+    // the cached proxy may have gone stale; drop it so that the next
+    // I/O on this characteristic creates a new one
+    /*Codes_SRS_BLEIO_GATT_41_004: [ When an error occurs asynchronously, BLEIO_gatt_read_char_by_uuid and BLEIO_gatt_write_char_by_uuid shall remove the proxy of the characteristic from the cache. ]*/
+    g_tree_remove(
+        context->handle_data->char_proxy_map,
+        context->object_path->str
+    );
+
     /*Codes_SRS_BLEIO_GATT_13_032: [ BLEIO_gatt_read_char_by_uuid shall invoke on_bleio_gatt_attrib_read_complete when the read operation completes. ]*/
     /*Codes_SRS_BLEIO_GATT_13_033: [ BLEIO_gatt_read_char_by_uuid shall pass the value of the callback_context parameter to on_bleio_gatt_attrib_read_complete as the context parameter when it is invoked. ]*/
     /*Codes_SRS_BLEIO_GATT_13_035: [ When an error occurs asynchronously, the value BLEIO_GATT_ERROR shall be passed for the result parameter of the on_bleio_gatt_attrib_read_complete callback. ]*/
@@ -61,7 +61,12 @@ int BLEIO_gatt_write_char_by_uuid(
     /*Codes_SRS_BLEIO_GATT_13_046: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if size is equal to 0 (zero). ]*/
     /*Codes_SRS_BLEIO_GATT_13_037: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if on_bleio_gatt_attrib_write_complete is NULL. ]*/
     /*Codes_SRS_BLEIO_GATT_13_053: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if an active connection to the device does not exist. ]*/
-    if (
+    /*Codes_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+    if (bleio_gatt_handle != NULL && handle_data->sim != NULL)
+    {
+        result = sim_gatt_write(handle_data, ble_uuid, buffer, size, on_bleio_gatt_attrib_write_complete, callback_context);
+    }
+    else if (
             bleio_gatt_handle != NULL &&
             ble_uuid != NULL &&
             on_bleio_gatt_attrib_write_complete != NULL &&
@@ -93,24 +98,50 @@ int BLEIO_gatt_write_char_by_uuid(
                         );
                         if (context->async_seq != NULL)
                         {
+                            // reuse the proxy of an earlier read or write of this
+                            // characteristic if there is one, otherwise create it first
+                            /*Codes_SRS_BLEIO_GATT_41_002: [ BLEIO_gatt_write_char_by_uuid shall use the characteristic proxy cached for the object path of the characteristic if there is one instead of creating a new proxy. ]*/
+                            bluezcharacteristic* characteristic = (bluezcharacteristic*)g_tree_lookup(
+                                handle_data->char_proxy_map,
+                                object_path->str
+                            );
+
                             // setup call sequence
-                            GIO_ASYNCSEQ_RESULT seq_result = GIO_Async_Seq_Add(
-                                context->async_seq, NULL,
+                            GIO_ASYNCSEQ_RESULT seq_result;
+                            if (characteristic != NULL)
+                            {
+                                seq_result = GIO_Async_Seq_Add(
+                                    context->async_seq, NULL,
 
-                                // create an instance of the characteristic
-                                create_characteristic, create_characteristic_finish,
+                                    // write the cached characteristic
+                                    write_characteristic, write_characteristic_finish,
 
-                                // write the characteristic
-                                write_characteristic, write_characteristic_finish,
+                                    // sentinel value to signal end of sequence
+                                    NULL
+                                );
+                            }
+                            else
+                            {
+                                seq_result = GIO_Async_Seq_Add(
+                                    context->async_seq, NULL,
 
-                                // sentinel value to signal end of sequence
-                                NULL
-                            );
+                                    // create an instance of the characteristic
+                                    create_characteristic, create_characteristic_finish,
+
+                                    // write the characteristic
+                                    write_characteristic, write_characteristic_finish,
+
+                                    // sentinel value to signal end of sequence
+                                    NULL
+                                );
+                            }
                             if (seq_result == GIO_ASYNCSEQ_OK)
                             {
                                 context->handle_data = handle_data;
                                 context->object_path = object_path;
-                                context->characteristic = NULL;
+                                context->characteristic = (characteristic != NULL) ?
+                                    (bluezcharacteristic*)g_object_ref(characteristic) :
+                                    NULL;
                                 context->on_write_complete = on_bleio_gatt_attrib_write_complete;
                                 context->callback_context = callback_context;
 
@@ -124,6 +155,10 @@ int BLEIO_gatt_write_char_by_uuid(
                                 else
                                 {
                                     result = __LINE__;
+                                    if (context->characteristic != NULL)
+                                    {
+                                        g_object_unref(context->characteristic);
+                                    }
                                     GIO_Async_Seq_Destroy(context->async_seq);
                                     g_bytes_unref(context->data);
                                     free(context);
@@ -215,8 +250,22 @@ static gpointer create_characteristic_finish(
     GError** error
 )
 {
-    (void)async_seq_handle;
-    return bluez_characteristic__proxy_new_finish(result, error);
+    WRITE_CONTEXT* context = (WRITE_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
+    bluezcharacteristic* characteristic = bluez_characteristic__proxy_new_finish(result, error);
+
+    // the proxy is only cached while the device is connected because the
+    // cache is cleared when it disconnects
+    if (characteristic != NULL && context->handle_data->state == BLEIO_GATT_STATE_CONNECTED)
+    {
+        /*Codes_SRS_BLEIO_GATT_41_003: [ When a characteristic proxy has been created, BLEIO_gatt_read_char_by_uuid and BLEIO_gatt_write_char_by_uuid shall add it to the cache of characteristic proxies if the object is in a connected state. ]*/
+        g_tree_insert(
+            context->handle_data->char_proxy_map,
+            g_strdup(context->object_path->str),
+            g_object_ref(characteristic)
+        );
+    }
+
+    return characteristic;
 }
 
 static void write_characteristic(
@@ -228,7 +277,12 @@ static void write_characteristic(
 {
     (void)callback_context;
     WRITE_CONTEXT* context = (WRITE_CONTEXT*)GIO_Async_Seq_GetContext(async_seq_handle);
-    context->characteristic = (bluezcharacteristic*)previous_result;
+    if (previous_result != NULL)
+    {
+        // this is the proxy made by create_characteristic; it is
+        // NULL when the cached proxy is used
+        context->characteristic = (bluezcharacteristic*)previous_result;
+    }
 
     // we don't check if this fails; d-bus will raise an error if no params
     // are passed (which is what NULL would mean) for the "WriteValue"
@@ -297,6 +351,14 @@ static void on_sequence_error(GIO_ASYNCSEQ_HANDLE async_seq_handle, const GError
         LogError("Write characteristic failed with - %s", error->message);
     }
 
+    // the cached proxy may have gone stale; drop it so that the next
+    // I/O on this characteristic creates a new one
+    /*Codes_SRS_BLEIO_GATT_41_004: [ When an error occurs asynchronously, BLEIO_gatt_read_char_by_uuid and BLEIO_gatt_write_char_by_uuid shall remove the proxy of the characteristic from the cache. ]*/
+    g_tree_remove(
+        context->handle_data->char_proxy_map,
+        context->object_path->str
+    );
+
     /*Codes_SRS_BLEIO_GATT_13_041: [ BLEIO_gatt_write_char_by_uuid shall invoke on_bleio_gatt_attrib_write_complete when the write operation completes. ]*/
     /*Codes_SRS_BLEIO_GATT_13_042: [ BLEIO_gatt_write_char_by_uuid shall pass the value of the callback_context parameter to on_bleio_gatt_attrib_write_complete as the context parameter when it is invoked. ]*/
     /*Codes_SRS_BLEIO_GATT_13_044: [ When an error occurs asynchronously, the value BLEIO_GATT_ERROR shall be passed for the result parameter of the on_bleio_gatt_attrib_write_complete callback. ]*/
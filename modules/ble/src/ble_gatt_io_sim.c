@@ -0,0 +1,806 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "ble_gatt_io.h"
+#include "ble_gatt_io_linux_common.h"
+
+// The simulated GATT I/O backend serves BLEIO_gatt_* calls from virtual
+// devices that live in process memory instead of talking to bluez. It is
+// meant for load testing the gateway with many more devices than there is
+// hardware for. Every operation completes from a GLIB timeout on the default
+// main context after the configured latency and jitter and fails at the
+// configured rate. Like the real backend it expects to be called on the GLIB
+// event loop thread.
+
+typedef enum SIM_OPERATION_TYPE_TAG
+{
+    SIM_OPERATION_CONNECT,
+    SIM_OPERATION_DISCONNECT,
+    SIM_OPERATION_READ,
+    SIM_OPERATION_WRITE,
+    SIM_OPERATION_NOTIFY_START
+}SIM_OPERATION_TYPE;
+
+typedef struct SIM_CHARACTERISTIC_TAG SIM_CHARACTERISTIC;
+struct SIM_CHARACTERISTIC_TAG
+{
+    char*                           uuid;
+    unsigned char*                  value;          // last value written or NULL
+    size_t                          size;
+    ON_BLEIO_GATT_ATTRIB_NOTIFY     on_notify;
+    void*                           notify_context;
+    guint                           notify_source;  // notification timer or 0
+    BLEIO_GATT_HANDLE_DATA*         handle_data;
+    SIM_CHARACTERISTIC*             next;
+};
+
+typedef struct SIM_OPERATION_TAG SIM_OPERATION;
+struct SIM_OPERATION_TAG
+{
+    SIM_OPERATION_TYPE              type;
+    BLEIO_GATT_HANDLE_DATA*         handle_data;
+    SIM_CHARACTERISTIC*             characteristic; // NULL for connect and disconnect
+    union
+    {
+        ON_BLEIO_GATT_CONNECT_COMPLETE      on_connect_complete;
+        ON_BLEIO_GATT_DISCONNECT_COMPLETE   on_disconnect_complete;
+        ON_BLEIO_GATT_ATTRIB_READ_COMPLETE  on_read_complete;
+        ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE on_write_complete;
+        ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_notify_start_complete;
+    }callback;
+    ON_BLEIO_GATT_ATTRIB_NOTIFY     on_notify;      // only for notification starts
+    void*                           callback_context;
+    unsigned char*                  data;           // the value being written
+    size_t                          size;
+    guint                           source;         // the timer completing the operation
+    SIM_OPERATION*                  next;
+};
+
+struct BLEIO_GATT_SIM_DEVICE_TAG
+{
+    BLEIO_GATT_SIM_CONFIG   config;
+    uint64_t                random_state;
+    SIM_CHARACTERISTIC*     characteristics;
+    SIM_OPERATION*          operations;     // operations in flight
+};
+
+static uint64_t next_random(BLEIO_GATT_SIM_DEVICE* device);
+static bool roll_failure(BLEIO_GATT_SIM_DEVICE* device, double rate);
+static unsigned char* generate_value(BLEIO_GATT_SIM_DEVICE* device);
+static SIM_CHARACTERISTIC* get_characteristic(BLEIO_GATT_HANDLE_DATA* handle_data, const char* ble_uuid);
+static void stop_notifications(BLEIO_GATT_SIM_DEVICE* device);
+static int start_operation(BLEIO_GATT_HANDLE_DATA* handle_data, SIM_OPERATION* operation);
+static gboolean on_operation_due(gpointer user_data);
+static gboolean on_notify_due(gpointer user_data);
+
+BLEIO_GATT_HANDLE BLEIO_gatt_sim_create(
+    const BLE_DEVICE_CONFIG* config,
+    const BLEIO_GATT_SIM_CONFIG* sim_config
+)
+{
+    BLEIO_GATT_HANDLE_DATA* result;
+
+    /*Codes_SRS_BLEIO_GATT_49_001: [ BLEIO_gatt_sim_create shall return NULL if config or sim_config is NULL. ]*/
+    if (config == NULL || sim_config == NULL)
+    {
+        LogError("Invalid args - config = %p, sim_config = %p", config, sim_config);
+        result = NULL;
+    }
+    /*Codes_SRS_BLEIO_GATT_49_002: [ BLEIO_gatt_sim_create shall return NULL if the connect_failure_rate or the io_failure_rate field of sim_config is not between 0 and 1 or if the notify_interval_in_ms or the value_size field is zero. ]*/
+    else if (
+            !(sim_config->connect_failure_rate >= 0.0 && sim_config->connect_failure_rate <= 1.0) ||
+            !(sim_config->io_failure_rate >= 0.0 && sim_config->io_failure_rate <= 1.0) ||
+            sim_config->notify_interval_in_ms == 0 ||
+            sim_config->value_size == 0
+        )
+    {
+        LogError("Invalid simulator configuration");
+        result = NULL;
+    }
+    else
+    {
+        result = (BLEIO_GATT_HANDLE_DATA*)malloc(sizeof(BLEIO_GATT_HANDLE_DATA));
+        if (result == NULL)
+        {
+            /*Codes_SRS_BLEIO_GATT_49_003: [ BLEIO_gatt_sim_create shall return NULL when any of the underlying platform calls fail. ]*/
+            LogError("malloc failed");
+        }
+        else
+        {
+            result->sim = (BLEIO_GATT_SIM_DEVICE*)malloc(sizeof(BLEIO_GATT_SIM_DEVICE));
+            if (result->sim == NULL)
+            {
+                /*Codes_SRS_BLEIO_GATT_49_003: [ BLEIO_gatt_sim_create shall return NULL when any of the underlying platform calls fail. ]*/
+                LogError("malloc failed");
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                memcpy(
+                    &(result->device_addr),
+                    &(config->device_addr),
+                    sizeof(BLE_MAC_ADDRESS)
+                );
+                result->bus = NULL;
+                result->object_manager = NULL;
+                result->device = NULL;
+                result->state = BLEIO_GATT_STATE_DISCONNECTED;
+                result->ble_controller_index = config->ble_controller_index;
+                result->char_object_path_map = NULL;
+                result->char_proxy_map = NULL;
+                result->char_notify_map = NULL;
+
+                result->sim->config = *sim_config;
+                result->sim->characteristics = NULL;
+                result->sim->operations = NULL;
+
+                /*Codes_SRS_BLEIO_GATT_49_010: [ The random numbers of a simulated handle shall be seeded from the MAC address of the device so that runs are reproducible. ]*/
+                uint64_t seed = 0x9E3779B97F4A7C15ULL;
+                for (size_t i = 0; i < sizeof(config->device_addr.address); i++)
+                {
+                    seed = (seed ^ config->device_addr.address[i]) * 0x100000001B3ULL;
+                }
+                result->sim->random_state = seed != 0 ? seed : 0x9E3779B97F4A7C15ULL;
+
+                /*Codes_SRS_BLEIO_GATT_49_004: [ BLEIO_gatt_sim_create shall return a non-NULL handle that the other BLEIO_gatt_* functions accept and that does no I/O with a real device. ]*/
+            }
+        }
+    }
+
+    return (BLEIO_GATT_HANDLE)result;
+}
+
+void sim_gatt_destroy(BLEIO_GATT_HANDLE_DATA* handle_data)
+{
+    BLEIO_GATT_SIM_DEVICE* device = handle_data->sim;
+
+    /*Codes_SRS_BLEIO_GATT_49_011: [ BLEIO_gatt_destroy shall cancel the pending operations of a simulated handle without invoking their callbacks. ]*/
+    SIM_OPERATION* operation = device->operations;
+    while (operation != NULL)
+    {
+        SIM_OPERATION* next = operation->next;
+        g_source_remove(operation->source);
+        free(operation->data);
+        free(operation);
+        operation = next;
+    }
+
+    stop_notifications(device);
+
+    SIM_CHARACTERISTIC* characteristic = device->characteristics;
+    while (characteristic != NULL)
+    {
+        SIM_CHARACTERISTIC* next = characteristic->next;
+        free(characteristic->uuid);
+        free(characteristic->value);
+        free(characteristic);
+        characteristic = next;
+    }
+
+    free(device);
+    free(handle_data);
+}
+
+int sim_gatt_connect(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    ON_BLEIO_GATT_CONNECT_COMPLETE on_connect_complete,
+    void* callback_context
+)
+{
+    int result;
+
+    /*Codes_SRS_BLEIO_GATT_49_012: [ The functions shall validate their arguments and the connection state of a simulated handle the same way as they do for a real device. ]*/
+    if (
+            on_connect_complete == NULL ||
+            (
+                handle_data->state != BLEIO_GATT_STATE_DISCONNECTED &&
+                handle_data->state != BLEIO_GATT_STATE_ERROR
+            )
+        )
+    {
+        LogError("Invalid args or the device is already connected or connecting");
+        result = __LINE__;
+    }
+    else
+    {
+        SIM_OPERATION* operation = (SIM_OPERATION*)malloc(sizeof(SIM_OPERATION));
+        if (operation == NULL)
+        {
+            LogError("malloc failed");
+            result = __LINE__;
+        }
+        else
+        {
+            operation->type = SIM_OPERATION_CONNECT;
+            operation->characteristic = NULL;
+            operation->callback.on_connect_complete = on_connect_complete;
+            operation->on_notify = NULL;
+            operation->callback_context = callback_context;
+            operation->data = NULL;
+            operation->size = 0;
+
+            handle_data->state = BLEIO_GATT_STATE_CONNECTING;
+            if (start_operation(handle_data, operation) != 0)
+            {
+                LogError("start_operation failed");
+                handle_data->state = BLEIO_GATT_STATE_DISCONNECTED;
+                free(operation);
+                result = __LINE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+    }
+
+    return result;
+}
+
+void sim_gatt_disconnect(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    ON_BLEIO_GATT_DISCONNECT_COMPLETE on_disconnect_complete,
+    void* callback_context
+)
+{
+    /*Codes_SRS_BLEIO_GATT_49_012: [ The functions shall validate their arguments and the connection state of a simulated handle the same way as they do for a real device. ]*/
+    if (handle_data->state != BLEIO_GATT_STATE_CONNECTED)
+    {
+        LogError("Object is already disconnected from the device.");
+    }
+    else
+    {
+        SIM_OPERATION* operation = (SIM_OPERATION*)malloc(sizeof(SIM_OPERATION));
+        if (operation == NULL)
+        {
+            LogError("malloc failed");
+        }
+        else
+        {
+            operation->type = SIM_OPERATION_DISCONNECT;
+            operation->characteristic = NULL;
+            operation->callback.on_disconnect_complete = on_disconnect_complete;
+            operation->on_notify = NULL;
+            operation->callback_context = callback_context;
+            operation->data = NULL;
+            operation->size = 0;
+
+            if (start_operation(handle_data, operation) != 0)
+            {
+                LogError("start_operation failed");
+                free(operation);
+            }
+        }
+    }
+}
+
+int sim_gatt_read(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_ATTRIB_READ_COMPLETE on_read_complete,
+    void* callback_context
+)
+{
+    int result;
+
+    /*Codes_SRS_BLEIO_GATT_49_012: [ The functions shall validate their arguments and the connection state of a simulated handle the same way as they do for a real device. ]*/
+    if (
+            ble_uuid == NULL ||
+            on_read_complete == NULL ||
+            handle_data->state != BLEIO_GATT_STATE_CONNECTED
+        )
+    {
+        LogError("Invalid args or the device is not connected");
+        result = __LINE__;
+    }
+    else
+    {
+        SIM_CHARACTERISTIC* characteristic = get_characteristic(handle_data, ble_uuid);
+        if (characteristic == NULL)
+        {
+            LogError("get_characteristic failed");
+            result = __LINE__;
+        }
+        else
+        {
+            SIM_OPERATION* operation = (SIM_OPERATION*)malloc(sizeof(SIM_OPERATION));
+            if (operation == NULL)
+            {
+                LogError("malloc failed");
+                result = __LINE__;
+            }
+            else
+            {
+                operation->type = SIM_OPERATION_READ;
+                operation->characteristic = characteristic;
+                operation->callback.on_read_complete = on_read_complete;
+                operation->on_notify = NULL;
+                operation->callback_context = callback_context;
+                operation->data = NULL;
+                operation->size = 0;
+
+                if (start_operation(handle_data, operation) != 0)
+                {
+                    LogError("start_operation failed");
+                    free(operation);
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+int sim_gatt_write(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    const char* ble_uuid,
+    const unsigned char* buffer,
+    size_t size,
+    ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE on_write_complete,
+    void* callback_context
+)
+{
+    int result;
+
+    /*Codes_SRS_BLEIO_GATT_49_012: [ The functions shall validate their arguments and the connection state of a simulated handle the same way as they do for a real device. ]*/
+    if (
+            ble_uuid == NULL ||
+            on_write_complete == NULL ||
+            buffer == NULL ||
+            size == 0 ||
+            handle_data->state != BLEIO_GATT_STATE_CONNECTED
+        )
+    {
+        LogError("Invalid args or the device is not connected");
+        result = __LINE__;
+    }
+    else
+    {
+        SIM_CHARACTERISTIC* characteristic = get_characteristic(handle_data, ble_uuid);
+        if (characteristic == NULL)
+        {
+            LogError("get_characteristic failed");
+            result = __LINE__;
+        }
+        else
+        {
+            SIM_OPERATION* operation = (SIM_OPERATION*)malloc(sizeof(SIM_OPERATION));
+            if (operation == NULL)
+            {
+                LogError("malloc failed");
+                result = __LINE__;
+            }
+            else
+            {
+                operation->data = (unsigned char*)malloc(size);
+                if (operation->data == NULL)
+                {
+                    LogError("malloc failed");
+                    free(operation);
+                    result = __LINE__;
+                }
+                else
+                {
+                    memcpy(operation->data, buffer, size);
+                    operation->size = size;
+                    operation->type = SIM_OPERATION_WRITE;
+                    operation->characteristic = characteristic;
+                    operation->callback.on_write_complete = on_write_complete;
+                    operation->on_notify = NULL;
+                    operation->callback_context = callback_context;
+
+                    if (start_operation(handle_data, operation) != 0)
+                    {
+                        LogError("start_operation failed");
+                        free(operation->data);
+                        free(operation);
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        result = 0;
+                    }
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+int sim_gatt_notify(
+    BLEIO_GATT_HANDLE_DATA* handle_data,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_notify_start_complete,
+    ON_BLEIO_GATT_ATTRIB_NOTIFY on_notify,
+    void* callback_context
+)
+{
+    int result;
+
+    /*Codes_SRS_BLEIO_GATT_49_012: [ The functions shall validate their arguments and the connection state of a simulated handle the same way as they do for a real device. ]*/
+    if (
+            ble_uuid == NULL ||
+            on_notify_start_complete == NULL ||
+            on_notify == NULL ||
+            handle_data->state != BLEIO_GATT_STATE_CONNECTED
+        )
+    {
+        LogError("Invalid args or the device is not connected");
+        result = __LINE__;
+    }
+    else
+    {
+        SIM_CHARACTERISTIC* characteristic = get_characteristic(handle_data, ble_uuid);
+        if (characteristic == NULL)
+        {
+            LogError("get_characteristic failed");
+            result = __LINE__;
+        }
+        else
+        {
+            SIM_OPERATION* operation = (SIM_OPERATION*)malloc(sizeof(SIM_OPERATION));
+            if (operation == NULL)
+            {
+                LogError("malloc failed");
+                result = __LINE__;
+            }
+            else
+            {
+                operation->type = SIM_OPERATION_NOTIFY_START;
+                operation->characteristic = characteristic;
+                operation->callback.on_notify_start_complete = on_notify_start_complete;
+                operation->on_notify = on_notify;
+                operation->callback_context = callback_context;
+                operation->data = NULL;
+                operation->size = 0;
+
+                if (start_operation(handle_data, operation) != 0)
+                {
+                    LogError("start_operation failed");
+                    free(operation);
+                    result = __LINE__;
+                }
+                else
+                {
+                    result = 0;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+// xorshift64* - plenty for picking delays and failures and far cheaper than
+// having thousands of devices contend for the global GLIB generator
+static uint64_t next_random(BLEIO_GATT_SIM_DEVICE* device)
+{
+    uint64_t x = device->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    device->random_state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static bool roll_failure(BLEIO_GATT_SIM_DEVICE* device, double rate)
+{
+    bool result;
+    if (rate <= 0.0)
+    {
+        result = false;
+    }
+    else
+    {
+        // the top 53 bits make a uniformly distributed double in [0, 1)
+        double sample = (double)(next_random(device) >> 11) / 9007199254740992.0;
+        result = sample < rate;
+    }
+    return result;
+}
+
+static unsigned char* generate_value(BLEIO_GATT_SIM_DEVICE* device)
+{
+    unsigned char* result = (unsigned char*)malloc(device->config.value_size);
+    if (result == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        for (size_t i = 0; i < device->config.value_size; i++)
+        {
+            result[i] = (unsigned char)(next_random(device) >> 56);
+        }
+    }
+    return result;
+}
+
+// every UUID exists on a virtual device; the characteristic is created the
+// first time it is used
+static SIM_CHARACTERISTIC* get_characteristic(BLEIO_GATT_HANDLE_DATA* handle_data, const char* ble_uuid)
+{
+    SIM_CHARACTERISTIC* result = handle_data->sim->characteristics;
+    while (result != NULL && g_ascii_strcasecmp(result->uuid, ble_uuid) != 0)
+    {
+        result = result->next;
+    }
+
+    if (result == NULL)
+    {
+        result = (SIM_CHARACTERISTIC*)malloc(sizeof(SIM_CHARACTERISTIC));
+        if (result == NULL)
+        {
+            LogError("malloc failed");
+        }
+        else
+        {
+            size_t length = strlen(ble_uuid);
+            result->uuid = (char*)malloc(length + 1);
+            if (result->uuid == NULL)
+            {
+                LogError("malloc failed");
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                memcpy(result->uuid, ble_uuid, length + 1);
+                result->value = NULL;
+                result->size = 0;
+                result->on_notify = NULL;
+                result->notify_context = NULL;
+                result->notify_source = 0;
+                result->handle_data = handle_data;
+                result->next = handle_data->sim->characteristics;
+                handle_data->sim->characteristics = result;
+            }
+        }
+    }
+
+    return result;
+}
+
+static void stop_notifications(BLEIO_GATT_SIM_DEVICE* device)
+{
+    SIM_CHARACTERISTIC* characteristic = device->characteristics;
+    while (characteristic != NULL)
+    {
+        if (characteristic->notify_source != 0)
+        {
+            g_source_remove(characteristic->notify_source);
+            characteristic->notify_source = 0;
+        }
+        characteristic->on_notify = NULL;
+        characteristic->notify_context = NULL;
+        characteristic = characteristic->next;
+    }
+}
+
+static int start_operation(BLEIO_GATT_HANDLE_DATA* handle_data, SIM_OPERATION* operation)
+{
+    int result;
+    BLEIO_GATT_SIM_DEVICE* device = handle_data->sim;
+
+    /*Codes_SRS_BLEIO_GATT_49_005: [ Every operation on a simulated handle shall complete asynchronously after latency_in_ms milliseconds plus a random delay of at most jitter_in_ms milliseconds. ]*/
+    guint delay = device->config.latency_in_ms;
+    if (device->config.jitter_in_ms > 0)
+    {
+        delay += (guint)(next_random(device) % ((uint64_t)device->config.jitter_in_ms + 1));
+    }
+
+    operation->handle_data = handle_data;
+    operation->source = g_timeout_add(delay, on_operation_due, operation);
+    if (operation->source == 0)
+    {
+        LogError("g_timeout_add failed");
+        result = __LINE__;
+    }
+    else
+    {
+        operation->next = device->operations;
+        device->operations = operation;
+        result = 0;
+    }
+
+    return result;
+}
+
+static gboolean on_operation_due(gpointer user_data)
+{
+    SIM_OPERATION* operation = (SIM_OPERATION*)user_data;
+    BLEIO_GATT_HANDLE_DATA* handle_data = operation->handle_data;
+    BLEIO_GATT_SIM_DEVICE* device = handle_data->sim;
+    BLEIO_GATT_HANDLE handle = (BLEIO_GATT_HANDLE)handle_data;
+    SIM_CHARACTERISTIC* characteristic = operation->characteristic;
+
+    SIM_OPERATION** link = &(device->operations);
+    while (*link != operation)
+    {
+        link = &((*link)->next);
+    }
+    *link = operation->next;
+
+    // the callbacks are free to destroy the handle so nothing that belongs
+    // to it is touched once they have been invoked
+    switch (operation->type)
+    {
+        case SIM_OPERATION_CONNECT:
+        {
+            /*Codes_SRS_BLEIO_GATT_49_006: [ A simulated connection attempt shall fail with BLEIO_GATT_CONNECT_ERROR with a probability of connect_failure_rate. ]*/
+            bool failed = roll_failure(device, device->config.connect_failure_rate);
+            handle_data->state = failed ? BLEIO_GATT_STATE_ERROR : BLEIO_GATT_STATE_CONNECTED;
+            operation->callback.on_connect_complete(
+                handle,
+                operation->callback_context,
+                failed ? BLEIO_GATT_CONNECT_ERROR : BLEIO_GATT_CONNECT_OK
+            );
+            break;
+        }
+        case SIM_OPERATION_DISCONNECT:
+        {
+            stop_notifications(device);
+            handle_data->state = BLEIO_GATT_STATE_DISCONNECTED;
+            if (operation->callback.on_disconnect_complete != NULL)
+            {
+                operation->callback.on_disconnect_complete(handle, operation->callback_context);
+            }
+            break;
+        }
+        case SIM_OPERATION_READ:
+        {
+            /*Codes_SRS_BLEIO_GATT_49_007: [ Simulated reads, writes and notification starts shall fail with BLEIO_GATT_ERROR with a probability of io_failure_rate or if the handle was disconnected in the meantime. ]*/
+            if (
+                    handle_data->state != BLEIO_GATT_STATE_CONNECTED ||
+                    roll_failure(device, device->config.io_failure_rate)
+                )
+            {
+                operation->callback.on_read_complete(handle, operation->callback_context, BLEIO_GATT_ERROR, NULL, 0);
+            }
+            /*Codes_SRS_BLEIO_GATT_49_008: [ A simulated read shall return the last value written to the characteristic or, if it has not been written to, a generated value of value_size bytes. ]*/
+            else if (characteristic->value != NULL)
+            {
+                // the callback may destroy the handle and with it the value
+                unsigned char* value = (unsigned char*)malloc(characteristic->size);
+                if (value == NULL)
+                {
+                    LogError("malloc failed");
+                    operation->callback.on_read_complete(handle, operation->callback_context, BLEIO_GATT_ERROR, NULL, 0);
+                }
+                else
+                {
+                    size_t size = characteristic->size;
+                    memcpy(value, characteristic->value, size);
+                    operation->callback.on_read_complete(handle, operation->callback_context, BLEIO_GATT_OK, value, size);
+                    free(value);
+                }
+            }
+            else
+            {
+                unsigned char* value = generate_value(device);
+                if (value == NULL)
+                {
+                    operation->callback.on_read_complete(handle, operation->callback_context, BLEIO_GATT_ERROR, NULL, 0);
+                }
+                else
+                {
+                    operation->callback.on_read_complete(handle, operation->callback_context, BLEIO_GATT_OK, value, device->config.value_size);
+                    free(value);
+                }
+            }
+            break;
+        }
+        case SIM_OPERATION_WRITE:
+        {
+            /*Codes_SRS_BLEIO_GATT_49_007: [ Simulated reads, writes and notification starts shall fail with BLEIO_GATT_ERROR with a probability of io_failure_rate or if the handle was disconnected in the meantime. ]*/
+            if (
+                    handle_data->state != BLEIO_GATT_STATE_CONNECTED ||
+                    roll_failure(device, device->config.io_failure_rate)
+                )
+            {
+                operation->callback.on_write_complete(handle, operation->callback_context, BLEIO_GATT_ERROR);
+            }
+            else
+            {
+                // the characteristic takes over the written value
+                free(characteristic->value);
+                characteristic->value = operation->data;
+                characteristic->size = operation->size;
+                operation->data = NULL;
+                operation->callback.on_write_complete(handle, operation->callback_context, BLEIO_GATT_OK);
+            }
+            break;
+        }
+        case SIM_OPERATION_NOTIFY_START:
+        {
+            /*Codes_SRS_BLEIO_GATT_49_007: [ Simulated reads, writes and notification starts shall fail with BLEIO_GATT_ERROR with a probability of io_failure_rate or if the handle was disconnected in the meantime. ]*/
+            BLEIO_GATT_RESULT notify_result;
+            if (
+                    handle_data->state != BLEIO_GATT_STATE_CONNECTED ||
+                    roll_failure(device, device->config.io_failure_rate)
+                )
+            {
+                notify_result = BLEIO_GATT_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_BLEIO_GATT_49_009: [ Once notifications have been started for a characteristic of a simulated handle, on_bleio_gatt_attrib_notify shall be invoked with a generated value every notify_interval_in_ms milliseconds until the handle is disconnected or destroyed. ]*/
+                // starting notifications again replaces the earlier subscription
+                if (characteristic->notify_source != 0)
+                {
+                    g_source_remove(characteristic->notify_source);
+                }
+                characteristic->on_notify = operation->on_notify;
+                characteristic->notify_context = operation->callback_context;
+                characteristic->notify_source = g_timeout_add(
+                    device->config.notify_interval_in_ms,
+                    on_notify_due,
+                    characteristic
+                );
+                if (characteristic->notify_source == 0)
+                {
+                    LogError("g_timeout_add failed");
+                    characteristic->on_notify = NULL;
+                    characteristic->notify_context = NULL;
+                    notify_result = BLEIO_GATT_ERROR;
+                }
+                else
+                {
+                    notify_result = BLEIO_GATT_OK;
+                }
+            }
+            operation->callback.on_notify_start_complete(handle, operation->callback_context, notify_result);
+            break;
+        }
+        default:
+        {
+            LogError("Unknown operation type %d", (int)operation->type);
+            break;
+        }
+    }
+
+    free(operation->data);
+    free(operation);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_notify_due(gpointer user_data)
+{
+    SIM_CHARACTERISTIC* characteristic = (SIM_CHARACTERISTIC*)user_data;
+    BLEIO_GATT_HANDLE_DATA* handle_data = characteristic->handle_data;
+
+    unsigned char* value = generate_value(handle_data->sim);
+    if (value != NULL)
+    {
+        // the callback may destroy the handle; destroying it removes this
+        // source so the return value is ignored in that case
+        size_t size = handle_data->sim->config.value_size;
+        characteristic->on_notify(
+            (BLEIO_GATT_HANDLE)handle_data,
+            characteristic->notify_context,
+            value,
+            size
+        );
+        free(value);
+    }
+
+    return G_SOURCE_CONTINUE;
+}
@@ -17,6 +17,16 @@ BLEIO_GATT_HANDLE BLEIO_gatt_create(
     return NULL;
 }
 
+BLEIO_GATT_HANDLE BLEIO_gatt_sim_create(
+    const BLE_DEVICE_CONFIG* config,
+    const BLEIO_GATT_SIM_CONFIG* sim_config
+)
+{
+    /*Codes_SRS_BLEIO_GATT_49_014: [ On Windows BLEIO_gatt_sim_create shall return NULL. ]*/
+    LogError("BLEIO_gatt_sim_create not implemented on Windows yet.");
+    return NULL;
+}
+
 void BLEIO_gatt_destroy(
     BLEIO_GATT_HANDLE bleio_gatt_handle
 )
@@ -66,3 +76,15 @@ int BLEIO_gatt_write_char_by_uuid(
     LogError("BLEIO_gatt_write_char_by_uuid not implemented on Windows yet.");
     return __LINE__;
 }
+
+int BLEIO_gatt_notify_char_by_uuid(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    const char* ble_uuid,
+    ON_BLEIO_GATT_NOTIFY_START_COMPLETE on_bleio_gatt_notify_start_complete,
+    ON_BLEIO_GATT_ATTRIB_NOTIFY on_bleio_gatt_attrib_notify,
+    void* callback_context
+)
+{
+    LogError("BLEIO_gatt_notify_char_by_uuid not implemented on Windows yet.");
+    return __LINE__;
+}
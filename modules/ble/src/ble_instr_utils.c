@@ -17,6 +17,12 @@ void free_instruction(BLE_INSTRUCTION* instr)
         STRING_delete(instr->characteristic_uuid);
     }
 
+    // free the name of the read group
+    if (instr->read_group != NULL)
+    {
+        STRING_delete(instr->read_group);
+    }
+
     // free write buffer
     if (
         (
@@ -89,6 +95,53 @@ bool parse_write(
     return result;
 }
 
+bool parse_read_group(
+    JSON_Object* instr,
+    BLE_INSTRUCTION* ble_instr,
+    size_t index
+)
+{
+    bool result;
+    const char* read_group = json_object_get_string(instr, "read_group");
+    if (read_group == NULL)
+    {
+        // the instruction is not part of a read group
+        ble_instr->read_group = NULL;
+        result = true;
+    }
+    else if (
+        (
+            ble_instr->instruction_type != READ_ONCE &&
+            ble_instr->instruction_type != READ_PERIODIC
+        )
+        ||
+        (
+            read_group[0] == '\0'
+        )
+      )
+    {
+        /*Codes_SRS_BLE_46_001: [ BLE_ParseConfigurationFromJson shall return NULL if an instruction that is not of type read_once or read_periodic has a read_group property or if the read_group property is an empty string. ]*/
+        LogError("Invalid 'read_group' property for instruction %zu", index);
+        result = false;
+    }
+    else
+    {
+        ble_instr->read_group = STRING_construct(read_group);
+        if (ble_instr->read_group == NULL)
+        {
+            /*Codes_SRS_BLE_05_002: [ BLE_CreateFromJson shall return NULL if any of the underlying platform calls fail. ]*/
+            LogError("STRING_construct returned NULL while processing instruction %zu", index);
+            result = false;
+        }
+        else
+        {
+            result = true;
+        }
+    }
+
+    return result;
+}
+
 bool parse_instruction(
     const char* type,
     JSON_Object* instr,
@@ -116,6 +169,11 @@ bool parse_instruction(
             result = true;
         }
     }
+    else if (strcmp(type, "notify") == 0)
+    {
+        ble_instr->instruction_type = NOTIFY;
+        result = true;
+    }
     else if (strcmp(type, "write_at_init") == 0)
     {
         if (parse_write(instr, WRITE_AT_INIT, ble_instr, index) == false)
@@ -237,6 +295,15 @@ VECTOR_HANDLE parse_instructions(JSON_Array* instructions)
                                     result = NULL;
                                     break;
                                 }
+                                else if (parse_read_group(instr, &ble_instr, i) == false)
+                                {
+                                    LogError("parse_read_group returned false while processing instruction %zu", i);
+                                    free_instruction(&ble_instr);
+                                    free_instructions(result);
+                                    VECTOR_destroy(result);
+                                    result = NULL;
+                                    break;
+                                }
                                 else
                                 {
                                     // if we get here then we have a valid instruction
@@ -0,0 +1,855 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/strings.h"
+
+#include "ble_gatt_io.h"
+#include "bleio_seq.h"
+#include "ble_scheduler.h"
+
+// 'due_at' value of the instructions that do not run on a schedule
+#define NEVER   UINT64_MAX
+
+#define SCHEDULED_DEVICE_STATE_VALUES \
+    SCHEDULED_DEVICE_STATE_IDLE, \
+    SCHEDULED_DEVICE_STATE_CONNECTING, \
+    SCHEDULED_DEVICE_STATE_CONNECTED, \
+    SCHEDULED_DEVICE_STATE_CLOSING, \
+    SCHEDULED_DEVICE_STATE_DISCONNECTING
+
+DEFINE_ENUM(SCHEDULED_DEVICE_STATE, SCHEDULED_DEVICE_STATE_VALUES);
+
+typedef struct BLE_SCHEDULER_HANDLE_DATA_TAG BLE_SCHEDULER_HANDLE_DATA;
+typedef struct SCHEDULED_DEVICE_TAG SCHEDULED_DEVICE;
+
+// one of these is kept for each instruction of a device; it is passed as
+// the context of the GATT I/O calls so that starting an I/O operation does
+// not need an allocation
+typedef struct SCHEDULED_INSTRUCTION_TAG
+{
+    SCHEDULED_DEVICE*       device;
+    BLEIO_SEQ_INSTRUCTION*  instruction;
+    uint64_t                due_at;
+    bool                    in_flight;
+}SCHEDULED_INSTRUCTION;
+
+struct SCHEDULED_DEVICE_TAG
+{
+    BLE_SCHEDULER_HANDLE_DATA*  scheduler;
+    BLE_DEVICE_CONFIG           device_config;
+    BLEIO_GATT_HANDLE           bleio_gatt;
+    VECTOR_HANDLE               instructions;
+    SCHEDULED_INSTRUCTION*      scheduled;
+    size_t                      instruction_count;
+    SCHEDULED_DEVICE_STATE      state;
+    size_t                      pending_io;
+    bool                        io_failed;
+    uint64_t                    connected_at;
+    uint64_t                    disconnect_started_at;
+    uint64_t                    retry_at;
+};
+
+struct BLE_SCHEDULER_HANDLE_DATA_TAG
+{
+    BLE_SCHEDULER_CONFIG                config;
+    ON_BLE_SCHEDULER_READ_COMPLETE      on_read_complete;
+    VECTOR_HANDLE                       devices;
+    size_t                              open_connections;
+    uint64_t                            now;
+    bool                                is_destroying;
+    ON_BLE_SCHEDULER_DESTROY_COMPLETE   on_destroy_complete;
+    void*                               destroy_context;
+};
+
+static bool validate_instructions(VECTOR_HANDLE instructions);
+static void free_device(SCHEDULED_DEVICE* device);
+static void schedule_connections(BLE_SCHEDULER_HANDLE_DATA* handle_data);
+static void connect_device(SCHEDULED_DEVICE* device);
+static void start_due_io(SCHEDULED_DEVICE* device);
+static void start_io(SCHEDULED_INSTRUCTION* scheduled);
+static void release_io(SCHEDULED_DEVICE* device);
+static void begin_disconnect(SCHEDULED_DEVICE* device);
+static void check_destroy_complete(BLE_SCHEDULER_HANDLE_DATA* handle_data);
+static bool expire_disconnects(BLE_SCHEDULER_HANDLE_DATA* handle_data);
+static void complete_disconnect(SCHEDULED_DEVICE* device);
+
+static bool expire_disconnects(BLE_SCHEDULER_HANDLE_DATA* handle_data)
+{
+    // BLEIO_gatt_disconnect does not report failures so a disconnect that
+    // never calls back would otherwise hold on to its connection forever
+    bool result = false;
+    size_t len = VECTOR_size(handle_data->devices);
+    for (size_t i = 0; i < len; i++)
+    {
+        SCHEDULED_DEVICE* device = *(SCHEDULED_DEVICE**)VECTOR_element(handle_data->devices, i);
+        if (
+            device->state == SCHEDULED_DEVICE_STATE_DISCONNECTING &&
+            handle_data->now - device->disconnect_started_at >= BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS
+            )
+        {
+            LogError("Disconnecting from a device did not complete within %u ms; giving up on it.",
+                (unsigned int)BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS);
+            device->io_failed = true;
+            complete_disconnect(device);
+            result = true;
+        }
+    }
+
+    return result;
+}
+
+static void complete_disconnect(SCHEDULED_DEVICE* device)
+{
+    BLE_SCHEDULER_HANDLE_DATA* handle_data = device->scheduler;
+
+    device->state = SCHEDULED_DEVICE_STATE_IDLE;
+    handle_data->open_connections--;
+    device->retry_at = (device->io_failed == true) ?
+        handle_data->now + handle_data->config.retry_interval_in_ms :
+        handle_data->now;
+    device->io_failed = false;
+}
+
+static void on_connect_complete(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, BLEIO_GATT_CONNECT_RESULT connect_result);
+static void on_disconnect_complete(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context);
+static void on_read_complete(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, BLEIO_GATT_RESULT result, const unsigned char* buffer, size_t size);
+static void on_write_complete(BLEIO_GATT_HANDLE bleio_gatt_handle, void* context, BLEIO_GATT_RESULT result);
+
+BLE_SCHEDULER_HANDLE BLE_Scheduler_Create(
+    const BLE_SCHEDULER_CONFIG* config,
+    ON_BLE_SCHEDULER_READ_COMPLETE on_read_complete
+)
+{
+    BLE_SCHEDULER_HANDLE_DATA* result;
+
+    /*Codes_SRS_BLE_SCHEDULER_44_001: [ BLE_Scheduler_Create shall return NULL if config or on_read_complete is NULL. ]*/
+    if (config == NULL || on_read_complete == NULL)
+    {
+        LogError("Invalid args.");
+        result = NULL;
+    }
+    /*Codes_SRS_BLE_SCHEDULER_44_002: [ BLE_Scheduler_Create shall return NULL if the max_connections or the retry_interval_in_ms field of config is zero. ]*/
+    else if (config->max_connections == 0 || config->retry_interval_in_ms == 0)
+    {
+        LogError("max_connections and retry_interval_in_ms must be greater than zero.");
+        result = NULL;
+    }
+    else
+    {
+        result = (BLE_SCHEDULER_HANDLE_DATA*)malloc(sizeof(BLE_SCHEDULER_HANDLE_DATA));
+        if (result == NULL)
+        {
+            /*Codes_SRS_BLE_SCHEDULER_44_003: [ BLE_Scheduler_Create shall return NULL if any of the underlying platform calls fail. ]*/
+            LogError("malloc failed");
+        }
+        else
+        {
+            result->devices = VECTOR_create(sizeof(SCHEDULED_DEVICE*));
+            if (result->devices == NULL)
+            {
+                /*Codes_SRS_BLE_SCHEDULER_44_003: [ BLE_Scheduler_Create shall return NULL if any of the underlying platform calls fail. ]*/
+                LogError("VECTOR_create failed");
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                result->config = *config;
+                result->on_read_complete = on_read_complete;
+                result->open_connections = 0;
+                result->now = 0;
+                result->is_destroying = false;
+                result->on_destroy_complete = NULL;
+                result->destroy_context = NULL;
+
+                /*Codes_SRS_BLE_SCHEDULER_44_004: [ BLE_Scheduler_Create shall return a non-NULL handle on successful execution. ]*/
+            }
+        }
+    }
+
+    return (BLE_SCHEDULER_HANDLE)result;
+}
+
+int BLE_Scheduler_AddDevice(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    const BLE_DEVICE_CONFIG* device_config,
+    VECTOR_HANDLE instructions
+)
+{
+    int result;
+    BLE_SCHEDULER_HANDLE_DATA* handle_data = (BLE_SCHEDULER_HANDLE_DATA*)scheduler_handle;
+
+    /*Codes_SRS_BLE_SCHEDULER_44_005: [ BLE_Scheduler_AddDevice shall return a non-zero value if scheduler_handle, device_config or instructions is NULL. ]*/
+    if (scheduler_handle == NULL || device_config == NULL || instructions == NULL)
+    {
+        LogError("Invalid args.");
+        result = __LINE__;
+    }
+    /*Codes_SRS_BLE_SCHEDULER_44_006: [ BLE_Scheduler_AddDevice shall return a non-zero value if the vector instructions is empty. ]*/
+    else if (VECTOR_size(instructions) == 0)
+    {
+        LogError("Instructions vector is empty.");
+        result = __LINE__;
+    }
+    else if (validate_instructions(instructions) == false)
+    {
+        LogError("Invalid instruction found.");
+        result = __LINE__;
+    }
+    else
+    {
+        SCHEDULED_DEVICE* device = (SCHEDULED_DEVICE*)malloc(sizeof(SCHEDULED_DEVICE));
+        if (device == NULL)
+        {
+            /*Codes_SRS_BLE_SCHEDULER_44_009: [ BLE_Scheduler_AddDevice shall return a non-zero value if any of the underlying platform calls fail. ]*/
+            LogError("malloc failed");
+            result = __LINE__;
+        }
+        else
+        {
+            device->instruction_count = VECTOR_size(instructions);
+            device->scheduled = (SCHEDULED_INSTRUCTION*)malloc(sizeof(SCHEDULED_INSTRUCTION) * device->instruction_count);
+            if (device->scheduled == NULL)
+            {
+                /*Codes_SRS_BLE_SCHEDULER_44_009: [ BLE_Scheduler_AddDevice shall return a non-zero value if any of the underlying platform calls fail. ]*/
+                LogError("malloc failed");
+                free(device);
+                result = __LINE__;
+            }
+            else
+            {
+                /*Codes_SRS_BLE_SCHEDULER_44_008: [ BLE_Scheduler_AddDevice shall create a GATT I/O handle for the device by calling BLEIO_gatt_create. ]*/
+                /*Codes_SRS_BLE_SCHEDULER_49_001: [ BLE_Scheduler_AddDevice shall create the GATT I/O handle by calling BLEIO_gatt_sim_create with the simulator field of the configuration instead if the use_simulator field is true. ]*/
+                device->bleio_gatt = (handle_data->config.use_simulator == true) ?
+                    BLEIO_gatt_sim_create(device_config, &(handle_data->config.simulator)) :
+                    BLEIO_gatt_create(device_config);
+                if (device->bleio_gatt == NULL)
+                {
+                    /*Codes_SRS_BLE_SCHEDULER_44_009: [ BLE_Scheduler_AddDevice shall return a non-zero value if any of the underlying platform calls fail. ]*/
+                    LogError("BLEIO_gatt_create failed");
+                    free(device->scheduled);
+                    free(device);
+                    result = __LINE__;
+                }
+                else if (VECTOR_push_back(handle_data->devices, &device, 1) != 0)
+                {
+                    /*Codes_SRS_BLE_SCHEDULER_44_009: [ BLE_Scheduler_AddDevice shall return a non-zero value if any of the underlying platform calls fail. ]*/
+                    LogError("VECTOR_push_back failed");
+                    BLEIO_gatt_destroy(device->bleio_gatt);
+                    free(device->scheduled);
+                    free(device);
+                    result = __LINE__;
+                }
+                else
+                {
+                    device->scheduler = handle_data;
+                    device->device_config = *device_config;
+                    device->instructions = instructions;
+                    device->state = SCHEDULED_DEVICE_STATE_IDLE;
+                    device->pending_io = 0;
+                    device->io_failed = false;
+                    device->connected_at = 0;
+                    device->retry_at = 0;
+
+                    // the reads and the one time writes are all due right away
+                    for (size_t i = 0; i < device->instruction_count; i++)
+                    {
+                        SCHEDULED_INSTRUCTION* scheduled = &(device->scheduled[i]);
+                        scheduled->device = device;
+                        scheduled->instruction = (BLEIO_SEQ_INSTRUCTION*)VECTOR_element(instructions, i);
+                        scheduled->in_flight = false;
+                        scheduled->due_at = (
+                            scheduled->instruction->instruction_type == READ_ONCE ||
+                            scheduled->instruction->instruction_type == READ_PERIODIC ||
+                            scheduled->instruction->instruction_type == WRITE_ONCE
+                        ) ? handle_data->now : NEVER;
+                    }
+
+                    /*Codes_SRS_BLE_SCHEDULER_44_010: [ BLE_Scheduler_AddDevice shall take ownership of instructions and return zero when successful. ]*/
+                    result = 0;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void BLE_Scheduler_Tick(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    uint64_t now_in_ms
+)
+{
+    /*Codes_SRS_BLE_SCHEDULER_44_011: [ BLE_Scheduler_Tick shall do nothing if scheduler_handle is NULL. ]*/
+    if (scheduler_handle == NULL)
+    {
+        LogError("scheduler_handle is NULL");
+    }
+    else
+    {
+        BLE_SCHEDULER_HANDLE_DATA* handle_data = (BLE_SCHEDULER_HANDLE_DATA*)scheduler_handle;
+        handle_data->now = now_in_ms;
+
+        /*Codes_SRS_BLE_SCHEDULER_44_024: [ BLE_Scheduler_Tick shall consider a device disconnected when BLEIO_gatt_disconnect has not called back within BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS milliseconds, even after BLE_Scheduler_Destroy has been called. ]*/
+        if (expire_disconnects(handle_data) == true && handle_data->is_destroying == true)
+        {
+            // this may free the handle so nothing can touch it after this
+            check_destroy_complete(handle_data);
+        }
+        else if (handle_data->is_destroying == false)
+        {
+            /*Codes_SRS_BLE_SCHEDULER_44_012: [ BLE_Scheduler_Tick shall start the I/O operations that are due on every connected device; READ_ONCE and WRITE_ONCE instructions are executed once and READ_PERIODIC instructions every interval_in_ms milliseconds. ]*/
+            size_t len = VECTOR_size(handle_data->devices);
+            for (size_t i = 0; i < len; i++)
+            {
+                SCHEDULED_DEVICE* device = *(SCHEDULED_DEVICE**)VECTOR_element(handle_data->devices, i);
+                if (device->state == SCHEDULED_DEVICE_STATE_CONNECTED)
+                {
+                    start_due_io(device);
+                }
+            }
+
+            schedule_connections(handle_data);
+        }
+    }
+}
+
+void BLE_Scheduler_Destroy(
+    BLE_SCHEDULER_HANDLE scheduler_handle,
+    ON_BLE_SCHEDULER_DESTROY_COMPLETE on_destroy_complete,
+    void* context
+)
+{
+    /*Codes_SRS_BLE_SCHEDULER_44_021: [ BLE_Scheduler_Destroy shall do nothing if scheduler_handle is NULL. ]*/
+    if (scheduler_handle == NULL)
+    {
+        LogError("scheduler_handle is NULL");
+    }
+    else
+    {
+        BLE_SCHEDULER_HANDLE_DATA* handle_data = (BLE_SCHEDULER_HANDLE_DATA*)scheduler_handle;
+        handle_data->is_destroying = true;
+        handle_data->on_destroy_complete = on_destroy_complete;
+        handle_data->destroy_context = context;
+
+        // hold on to a connection of our own so that a disconnect that
+        // completes right away does not free the handle under this loop
+        handle_data->open_connections++;
+
+        /*Codes_SRS_BLE_SCHEDULER_44_022: [ BLE_Scheduler_Destroy shall disconnect all the connected devices, destroy their GATT I/O handles and free all resources before invoking on_destroy_complete if it is not NULL. ]*/
+        // devices that are still connecting are disconnected when the
+        // connect completes
+        size_t len = VECTOR_size(handle_data->devices);
+        for (size_t i = 0; i < len; i++)
+        {
+            SCHEDULED_DEVICE* device = *(SCHEDULED_DEVICE**)VECTOR_element(handle_data->devices, i);
+            if (device->state == SCHEDULED_DEVICE_STATE_CONNECTED)
+            {
+                begin_disconnect(device);
+            }
+        }
+
+        handle_data->open_connections--;
+        check_destroy_complete(handle_data);
+    }
+}
+
+static bool validate_instructions(VECTOR_HANDLE instructions)
+{
+    bool result = true;
+    size_t len = VECTOR_size(instructions);
+    for (size_t i = 0; i < len && result == true; i++)
+    {
+        BLEIO_SEQ_INSTRUCTION* instruction = (BLEIO_SEQ_INSTRUCTION*)VECTOR_element(instructions, i);
+
+        /*Codes_SRS_BLE_SCHEDULER_44_007: [ BLE_Scheduler_AddDevice shall return a non-zero value if an instruction has a NULL or empty characteristic_uuid, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction with a NULL buffer or is a NOTIFY instruction. ]*/
+        if (instruction->characteristic_uuid == NULL || STRING_length(instruction->characteristic_uuid) == 0)
+        {
+            LogError("Instruction %zu has no characteristic UUID.", i);
+            result = false;
+        }
+        else if (instruction->instruction_type == READ_PERIODIC && instruction->data.interval_in_ms == 0)
+        {
+            LogError("Instruction %zu is periodic with a zero interval.", i);
+            result = false;
+        }
+        else if (
+                    (
+                        instruction->instruction_type == WRITE_ONCE ||
+                        instruction->instruction_type == WRITE_AT_INIT ||
+                        instruction->instruction_type == WRITE_AT_EXIT
+                    )
+                    &&
+                    instruction->data.buffer == NULL
+                )
+        {
+            LogError("Instruction %zu is a write with no data.", i);
+            result = false;
+        }
+        else if (instruction->instruction_type == NOTIFY)
+        {
+            // notifications only arrive while the device stays connected
+            // which the scheduler cannot promise
+            LogError("Instruction %zu is a NOTIFY instruction which cannot be scheduled.", i);
+            result = false;
+        }
+    }
+
+    return result;
+}
+
+static void free_device(SCHEDULED_DEVICE* device)
+{
+    BLEIO_gatt_destroy(device->bleio_gatt);
+
+    for (size_t i = 0; i < device->instruction_count; i++)
+    {
+        BLEIO_SEQ_INSTRUCTION* instruction = device->scheduled[i].instruction;
+        STRING_delete(instruction->characteristic_uuid);
+        if (
+            instruction->instruction_type == WRITE_ONCE ||
+            instruction->instruction_type == WRITE_AT_INIT ||
+            instruction->instruction_type == WRITE_AT_EXIT
+           )
+        {
+            BUFFER_delete(instruction->data.buffer);
+        }
+    }
+
+    VECTOR_destroy(device->instructions);
+    free(device->scheduled);
+    free(device);
+}
+
+static uint64_t next_due_at(SCHEDULED_DEVICE* device)
+{
+    uint64_t result = NEVER;
+    for (size_t i = 0; i < device->instruction_count; i++)
+    {
+        if (device->scheduled[i].due_at < result)
+        {
+            result = device->scheduled[i].due_at;
+        }
+    }
+
+    return result;
+}
+
+static SCHEDULED_DEVICE* next_waiting_device(BLE_SCHEDULER_HANDLE_DATA* handle_data)
+{
+    SCHEDULED_DEVICE* result = NULL;
+    uint64_t result_due_at = NEVER;
+    size_t len = VECTOR_size(handle_data->devices);
+    for (size_t i = 0; i < len; i++)
+    {
+        SCHEDULED_DEVICE* device = *(SCHEDULED_DEVICE**)VECTOR_element(handle_data->devices, i);
+        if (
+            device->state == SCHEDULED_DEVICE_STATE_IDLE &&
+            device->retry_at <= handle_data->now
+           )
+        {
+            uint64_t due_at = next_due_at(device);
+            if (due_at <= handle_data->now && (result == NULL || due_at < result_due_at))
+            {
+                result = device;
+                result_due_at = due_at;
+            }
+        }
+    }
+
+    return result;
+}
+
+static SCHEDULED_DEVICE* idlest_connected_device(BLE_SCHEDULER_HANDLE_DATA* handle_data)
+{
+    SCHEDULED_DEVICE* result = NULL;
+    uint64_t result_due_at = 0;
+    size_t len = VECTOR_size(handle_data->devices);
+    for (size_t i = 0; i < len; i++)
+    {
+        SCHEDULED_DEVICE* device = *(SCHEDULED_DEVICE**)VECTOR_element(handle_data->devices, i);
+        if (
+            device->state == SCHEDULED_DEVICE_STATE_CONNECTED &&
+            device->pending_io == 0 &&
+            (handle_data->now - device->connected_at) >= handle_data->config.min_connection_time_in_ms
+           )
+        {
+            uint64_t due_at = next_due_at(device);
+            if (due_at > handle_data->now && (result == NULL || due_at > result_due_at))
+            {
+                result = device;
+                result_due_at = due_at;
+            }
+        }
+    }
+
+    return result;
+}
+
+static void schedule_connections(BLE_SCHEDULER_HANDLE_DATA* handle_data)
+{
+    SCHEDULED_DEVICE* waiting;
+    while ((waiting = next_waiting_device(handle_data)) != NULL)
+    {
+        if (handle_data->open_connections < handle_data->config.max_connections)
+        {
+            /*Codes_SRS_BLE_SCHEDULER_44_013: [ BLE_Scheduler_Tick shall connect to the devices that have I/O operations due, the one that has been due the longest first, as long as fewer than max_connections connections are open. ]*/
+            connect_device(waiting);
+        }
+        else
+        {
+            /*Codes_SRS_BLE_SCHEDULER_44_014: [ When max_connections connections are open and a device is waiting for a connection, BLE_Scheduler_Tick shall disconnect the connected device that has no I/O operations in flight or due, has been connected for at least min_connection_time_in_ms milliseconds and has the latest next I/O operation. ]*/
+            /*Codes_SRS_BLE_SCHEDULER_44_015: [ BLE_Scheduler_Tick shall not disconnect a device unless another device is waiting for a connection. ]*/
+            SCHEDULED_DEVICE* idlest = idlest_connected_device(handle_data);
+            if (idlest != NULL)
+            {
+                // the waiting device gets the connection when the
+                // disconnect completes
+                begin_disconnect(idlest);
+            }
+            break;
+        }
+    }
+}
+
+static void connect_device(SCHEDULED_DEVICE* device)
+{
+    BLE_SCHEDULER_HANDLE_DATA* handle_data = device->scheduler;
+    device->state = SCHEDULED_DEVICE_STATE_CONNECTING;
+    handle_data->open_connections++;
+
+    if (BLEIO_gatt_connect(device->bleio_gatt, on_connect_complete, device) != 0)
+    {
+        /*Codes_SRS_BLE_SCHEDULER_44_016: [ If connecting to a device fails then the scheduler shall not attempt to connect to it again for retry_interval_in_ms milliseconds. ]*/
+        LogError("BLEIO_gatt_connect failed");
+        device->state = SCHEDULED_DEVICE_STATE_IDLE;
+        handle_data->open_connections--;
+        device->retry_at = handle_data->now + handle_data->config.retry_interval_in_ms;
+    }
+}
+
+static void start_due_io(SCHEDULED_DEVICE* device)
+{
+    uint64_t now = device->scheduler->now;
+
+    // keep the device from being disconnected by an I/O operation that
+    // completes right away till all of them have been started
+    device->pending_io++;
+
+    for (size_t i = 0; i < device->instruction_count && device->io_failed == false; i++)
+    {
+        SCHEDULED_INSTRUCTION* scheduled = &(device->scheduled[i]);
+        if (scheduled->due_at <= now && scheduled->in_flight == false)
+        {
+            if (scheduled->instruction->instruction_type == READ_PERIODIC)
+            {
+                // polls missed while the device was disconnected are
+                // skipped rather than issued back to back
+                scheduled->due_at += scheduled->instruction->data.interval_in_ms;
+                if (scheduled->due_at <= now)
+                {
+                    scheduled->due_at = now + scheduled->instruction->data.interval_in_ms;
+                }
+            }
+            else
+            {
+                scheduled->due_at = NEVER;
+            }
+
+            start_io(scheduled);
+        }
+    }
+
+    release_io(device);
+}
+
+static void on_io_failed(SCHEDULED_INSTRUCTION* scheduled)
+{
+    /*Codes_SRS_BLE_SCHEDULER_44_019: [ If an I/O operation on a device fails then the scheduler shall disconnect the device once the I/O operations in flight complete and shall not connect to it again for retry_interval_in_ms milliseconds. ]*/
+    scheduled->device->io_failed = true;
+
+    // one time instructions are tried again on the next connection
+    if (
+        scheduled->instruction->instruction_type == READ_ONCE ||
+        scheduled->instruction->instruction_type == WRITE_ONCE
+       )
+    {
+        scheduled->due_at = scheduled->device->scheduler->now;
+    }
+}
+
+static void start_io(SCHEDULED_INSTRUCTION* scheduled)
+{
+    SCHEDULED_DEVICE* device = scheduled->device;
+    BLEIO_SEQ_INSTRUCTION* instruction = scheduled->instruction;
+    int io_result;
+
+    device->pending_io++;
+    scheduled->in_flight = true;
+
+    if (
+        instruction->instruction_type == READ_ONCE ||
+        instruction->instruction_type == READ_PERIODIC
+       )
+    {
+        io_result = BLEIO_gatt_read_char_by_uuid(
+            device->bleio_gatt,
+            STRING_c_str(instruction->characteristic_uuid),
+            on_read_complete,
+            scheduled
+        );
+    }
+    else
+    {
+        io_result = BLEIO_gatt_write_char_by_uuid(
+            device->bleio_gatt,
+            STRING_c_str(instruction->characteristic_uuid),
+            BUFFER_u_char(instruction->data.buffer),
+            BUFFER_length(instruction->data.buffer),
+            on_write_complete,
+            scheduled
+        );
+    }
+
+    if (io_result != 0)
+    {
+        LogError("Starting I/O on characteristic %s failed with %d.",
+            STRING_c_str(instruction->characteristic_uuid), io_result);
+        scheduled->in_flight = false;
+        on_io_failed(scheduled);
+        release_io(device);
+    }
+}
+
+static void release_io(SCHEDULED_DEVICE* device)
+{
+    if (--device->pending_io == 0)
+    {
+        if (device->state == SCHEDULED_DEVICE_STATE_CLOSING)
+        {
+            device->state = SCHEDULED_DEVICE_STATE_DISCONNECTING;
+            device->disconnect_started_at = device->scheduler->now;
+            BLEIO_gatt_disconnect(device->bleio_gatt, on_disconnect_complete, device);
+        }
+        else if (
+                    device->state == SCHEDULED_DEVICE_STATE_CONNECTED &&
+                    (device->io_failed == true || device->scheduler->is_destroying == true)
+                )
+        {
+            begin_disconnect(device);
+        }
+    }
+}
+
+static void begin_disconnect(SCHEDULED_DEVICE* device)
+{
+    device->state = SCHEDULED_DEVICE_STATE_CLOSING;
+
+    // see start_due_io for why this is done
+    device->pending_io++;
+
+    /*Codes_SRS_BLE_SCHEDULER_44_020: [ The scheduler shall execute the WRITE_AT_EXIT instructions of a device every time before it disconnects from it. ]*/
+    for (size_t i = 0; i < device->instruction_count; i++)
+    {
+        if (device->scheduled[i].instruction->instruction_type == WRITE_AT_EXIT)
+        {
+            start_io(&(device->scheduled[i]));
+        }
+    }
+
+    // the device gets disconnected when the last I/O operation completes
+    release_io(device);
+}
+
+static void check_destroy_complete(BLE_SCHEDULER_HANDLE_DATA* handle_data)
+{
+    if (handle_data->open_connections == 0)
+    {
+        size_t len = VECTOR_size(handle_data->devices);
+        for (size_t i = 0; i < len; i++)
+        {
+            free_device(*(SCHEDULED_DEVICE**)VECTOR_element(handle_data->devices, i));
+        }
+        VECTOR_destroy(handle_data->devices);
+
+        if (handle_data->on_destroy_complete != NULL)
+        {
+            handle_data->on_destroy_complete(
+                (BLE_SCHEDULER_HANDLE)handle_data,
+                handle_data->destroy_context
+            );
+        }
+
+        free(handle_data);
+    }
+}
+
+static void on_connect_complete(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* context,
+    BLEIO_GATT_CONNECT_RESULT connect_result
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    SCHEDULED_DEVICE* device = (SCHEDULED_DEVICE*)context;
+    BLE_SCHEDULER_HANDLE_DATA* handle_data = device->scheduler;
+
+    if (connect_result != BLEIO_GATT_CONNECT_OK)
+    {
+        /*Codes_SRS_BLE_SCHEDULER_44_016: [ If connecting to a device fails then the scheduler shall not attempt to connect to it again for retry_interval_in_ms milliseconds. ]*/
+        LogError("Connecting to a device failed; trying again in %u ms.",
+            (unsigned int)handle_data->config.retry_interval_in_ms);
+        device->state = SCHEDULED_DEVICE_STATE_IDLE;
+        handle_data->open_connections--;
+        device->retry_at = handle_data->now + handle_data->config.retry_interval_in_ms;
+
+        if (handle_data->is_destroying == true)
+        {
+            check_destroy_complete(handle_data);
+        }
+    }
+    else
+    {
+        device->state = SCHEDULED_DEVICE_STATE_CONNECTED;
+        device->connected_at = handle_data->now;
+        device->io_failed = false;
+
+        if (handle_data->is_destroying == true)
+        {
+            begin_disconnect(device);
+        }
+        else
+        {
+            device->pending_io++;
+
+            /*Codes_SRS_BLE_SCHEDULER_44_017: [ The scheduler shall execute the WRITE_AT_INIT instructions of a device every time it connects to it, followed by the I/O operations that are due. ]*/
+            for (size_t i = 0; i < device->instruction_count && device->io_failed == false; i++)
+            {
+                if (device->scheduled[i].instruction->instruction_type == WRITE_AT_INIT)
+                {
+                    start_io(&(device->scheduled[i]));
+                }
+            }
+            start_due_io(device);
+
+            release_io(device);
+        }
+    }
+}
+
+static void on_disconnect_complete(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* context
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    SCHEDULED_DEVICE* device = (SCHEDULED_DEVICE*)context;
+    BLE_SCHEDULER_HANDLE_DATA* handle_data = device->scheduler;
+
+    if (device->state != SCHEDULED_DEVICE_STATE_DISCONNECTING)
+    {
+        // BLE_Scheduler_Tick already gave up on this disconnect
+        LogError("Disconnecting from a device completed after it timed out.");
+    }
+    else
+    {
+        complete_disconnect(device);
+
+        if (handle_data->is_destroying == true)
+        {
+            check_destroy_complete(handle_data);
+        }
+        else
+        {
+            // hand the connection to whoever is waiting for it
+            schedule_connections(handle_data);
+        }
+    }
+}
+
+static void on_read_complete(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* context,
+    BLEIO_GATT_RESULT result,
+    const unsigned char* buffer,
+    size_t size
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    SCHEDULED_INSTRUCTION* scheduled = (SCHEDULED_INSTRUCTION*)context;
+    SCHEDULED_DEVICE* device = scheduled->device;
+    BLE_SCHEDULER_HANDLE_DATA* handle_data = device->scheduler;
+    BLEIO_SEQ_INSTRUCTION* instruction = scheduled->instruction;
+
+    scheduled->in_flight = false;
+    if (result != BLEIO_GATT_OK)
+    {
+        LogError("Reading characteristic %s failed.", STRING_c_str(instruction->characteristic_uuid));
+        on_io_failed(scheduled);
+    }
+
+    /*Codes_SRS_BLE_SCHEDULER_44_023: [ Reads that complete after BLE_Scheduler_Destroy has been called shall be dropped. ]*/
+    if (handle_data->is_destroying == false)
+    {
+        BUFFER_HANDLE data = NULL;
+        BLEIO_SEQ_RESULT seq_result = BLEIO_SEQ_ERROR;
+        if (result == BLEIO_GATT_OK)
+        {
+            data = BUFFER_create(buffer, size);
+            if (data == NULL)
+            {
+                LogError("BUFFER_create failed");
+            }
+            else
+            {
+                seq_result = BLEIO_SEQ_OK;
+            }
+        }
+
+        /*Codes_SRS_BLE_SCHEDULER_44_018: [ When a read completes the scheduler shall invoke on_read_complete passing in the configuration of the device, the context, characteristic UUID and type of the instruction, the status of the operation and the data that was read. ]*/
+        handle_data->on_read_complete(
+            (BLE_SCHEDULER_HANDLE)handle_data,
+            instruction->context,
+            &(device->device_config),
+            STRING_c_str(instruction->characteristic_uuid),
+            instruction->instruction_type,
+            seq_result,
+            data
+        );
+    }
+
+    release_io(device);
+}
+
+static void on_write_complete(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* context,
+    BLEIO_GATT_RESULT result
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    SCHEDULED_INSTRUCTION* scheduled = (SCHEDULED_INSTRUCTION*)context;
+
+    scheduled->in_flight = false;
+    if (result != BLEIO_GATT_OK)
+    {
+        LogError("Writing characteristic %s failed.",
+            STRING_c_str(scheduled->instruction->characteristic_uuid));
+        on_io_failed(scheduled);
+    }
+
+    release_io(scheduled->device);
+}
@@ -18,6 +18,15 @@
 
 static bool validate_instructions(VECTOR_HANDLE instructions);
 
+// An instruction added via BLEIO_Seq_AddInstruction. 'instruction' MUST be
+// the first field because the internal I/O complete callbacks are handed a
+// pointer to it and cast it back to a QUEUED_WRITE.
+struct QUEUED_WRITE_TAG
+{
+    BLEIO_SEQ_INSTRUCTION   instruction;
+    QUEUED_WRITE*           next;
+};
+
 
 // BLEIO_SEQ_HANDLE_DATA is a reference counted object. This is so because
 // at any given point in time there could be numerous asynchronous I/O
@@ -66,6 +75,10 @@ BLEIO_SEQ_HANDLE BLEIO_Seq_Create(
                 result->on_write_complete = on_write_complete;
                 result->on_destroy_complete = NULL;
                 result->destroy_context = NULL;
+                result->notify_contexts = NULL;
+                result->queued_writes = NULL;
+                result->ordered_writes = false;
+                result->max_write_queue_depth = BLEIO_SEQ_DEFAULT_WRITE_QUEUE_DEPTH;
             }
             else
             {
@@ -200,7 +213,23 @@ void dec_ref_handle(BLEIO_SEQ_HANDLE_DATA* handle_data)
         }
 
         VECTOR_destroy(handle_data->instructions);
+
+        /*Codes_SRS_BLEIO_SEQ_48_009: [ Writes that are waiting for the write in flight on their characteristic when BLEIO_Seq_Destroy is called shall be discarded. ]*/
+        // only writes that never started can still be queued since the ones
+        // in flight hold a reference to the handle
+        while (handle_data->queued_writes != NULL)
+        {
+            QUEUED_WRITE* queued_write = handle_data->queued_writes;
+            handle_data->queued_writes = queued_write->next;
+            STRING_delete(queued_write->instruction.characteristic_uuid);
+            BUFFER_delete(queued_write->instruction.data.buffer);
+            free(queued_write);
+        }
+
         BLEIO_gatt_destroy(handle_data->bleio_gatt_handle);
+
+        // no more notifications can arrive now that the GATT I/O handle is gone
+        free_notify_contexts(handle_data);
         free(handle_data);
     }
 }
@@ -267,6 +296,12 @@ static BLEIO_SEQ_RESULT schedule_instruction(
         result = schedule_periodic(handle_data, instruction, on_internal_read_complete);
         break;
 
+    case NOTIFY:
+        /*Codes_SRS_BLEIO_SEQ_42_001: [ BLEIO_Seq_Run shall start notifications for all NOTIFY instructions. ]*/
+        /*Codes_SRS_BLEIO_SEQ_42_005: [ BLEIO_Seq_AddInstruction shall start notifications if the instruction is a NOTIFY instruction. ]*/
+        result = schedule_notify(handle_data, instruction, on_internal_read_complete);
+        break;
+
     case WRITE_ONCE:
     case WRITE_AT_INIT:
         /*Codes_SRS_BLEIO_SEQ_13_016: [ BLEIO_Seq_Run shall schedule execution of all WRITE_AT_INIT instructions. ]*/
@@ -374,6 +409,182 @@ static void on_instruction_complete(
     free(instruction);
 }
 
+static bool is_queued_write(BLEIO_SEQ_INSTRUCTION* instruction)
+{
+    return
+    (
+        instruction->instruction_type == WRITE_ONCE ||
+        instruction->instruction_type == WRITE_AT_INIT
+    );
+}
+
+static bool is_same_characteristic(QUEUED_WRITE* queued_write, const char* characteristic_uuid)
+{
+    return strcmp(STRING_c_str(queued_write->instruction.characteristic_uuid), characteristic_uuid) == 0;
+}
+
+static void unlink_queued_write(BLEIO_SEQ_HANDLE_DATA* handle_data, QUEUED_WRITE* queued_write)
+{
+    QUEUED_WRITE** link = &(handle_data->queued_writes);
+    while (*link != NULL && *link != queued_write)
+    {
+        link = &((*link)->next);
+    }
+
+    if (*link != NULL)
+    {
+        *link = queued_write->next;
+    }
+}
+
+static void append_queued_write(BLEIO_SEQ_HANDLE_DATA* handle_data, QUEUED_WRITE* queued_write)
+{
+    QUEUED_WRITE** link = &(handle_data->queued_writes);
+    while (*link != NULL)
+    {
+        link = &((*link)->next);
+    }
+
+    queued_write->next = NULL;
+    *link = queued_write;
+}
+
+static void on_queued_write_complete(
+    BLEIO_SEQ_HANDLE_DATA* handle_data,
+    BLEIO_SEQ_INSTRUCTION* instruction
+)
+{
+    QUEUED_WRITE* completed = (QUEUED_WRITE*)instruction;
+    unlink_queued_write(handle_data, completed);
+
+    if (handle_data->queued_writes != NULL)
+    {
+        const char* characteristic_uuid = STRING_c_str(completed->instruction.characteristic_uuid);
+
+        /*Codes_SRS_BLEIO_SEQ_48_005: [ When a write completes BLEIO_Seq_AddInstruction shall start the next write to the same characteristic, if any, unless BLEIO_Seq_Destroy has been called. ]*/
+        // the first write left for this characteristic is the next one to go
+        QUEUED_WRITE* next = handle_data->queued_writes;
+        while (next != NULL && handle_data->state == BLEIO_SEQ_STATE_RUNNING)
+        {
+            QUEUED_WRITE* following = next->next;
+            if (is_same_characteristic(next, characteristic_uuid))
+            {
+                if (schedule_write(handle_data, &(next->instruction), on_queued_write_complete) == BLEIO_SEQ_OK)
+                {
+                    break;
+                }
+                else
+                {
+                    /*Codes_SRS_BLEIO_SEQ_48_006: [ If the next write cannot be started then the on_write_complete callback shall be invoked for it with BLEIO_SEQ_ERROR and the write after it shall be started instead. ]*/
+                    LogError("Starting a queued write for characteristic %s failed", characteristic_uuid);
+                    unlink_queued_write(handle_data, next);
+                    if (handle_data->on_write_complete != NULL)
+                    {
+                        handle_data->on_write_complete(
+                            (BLEIO_SEQ_HANDLE)handle_data,
+                            next->instruction.context,
+                            characteristic_uuid,
+                            next->instruction.instruction_type,
+                            BLEIO_SEQ_ERROR
+                        );
+                    }
+                    STRING_delete(next->instruction.characteristic_uuid);
+                    BUFFER_delete(next->instruction.data.buffer);
+                    free(next);
+                }
+            }
+
+            next = following;
+        }
+    }
+
+    // the buffer has already been freed in bleio_seq_linux_schedule_write.c
+    STRING_delete(completed->instruction.characteristic_uuid);
+    free(completed);
+}
+
+static BLEIO_SEQ_RESULT queue_write(BLEIO_SEQ_HANDLE_DATA* handle_data, QUEUED_WRITE* queued_write)
+{
+    BLEIO_SEQ_RESULT result;
+    QUEUED_WRITE* in_flight = NULL;
+    QUEUED_WRITE* last_waiting = NULL;
+    size_t waiting_count = 0;
+
+    // the list is only walked when there is something on it so that a write
+    // to an idle characteristic costs no more than it did without the queue
+    if (handle_data->queued_writes != NULL)
+    {
+        const char* characteristic_uuid = STRING_c_str(queued_write->instruction.characteristic_uuid);
+        for (QUEUED_WRITE* current = handle_data->queued_writes; current != NULL; current = current->next)
+        {
+            if (is_same_characteristic(current, characteristic_uuid))
+            {
+                if (in_flight == NULL)
+                {
+                    in_flight = current;
+                }
+                else
+                {
+                    last_waiting = current;
+                    waiting_count++;
+                }
+            }
+        }
+    }
+
+    if (in_flight == NULL)
+    {
+        // link the write before starting it since it might complete before
+        // schedule_write returns
+        append_queued_write(handle_data, queued_write);
+
+        /*Codes_SRS_BLEIO_SEQ_13_038: [ BLEIO_Seq_AddInstruction shall schedule execution of the instruction. ]*/
+        result = schedule_write(handle_data, &(queued_write->instruction), on_queued_write_complete);
+        if (result != BLEIO_SEQ_OK)
+        {
+            unlink_queued_write(handle_data, queued_write);
+        }
+    }
+    else if (handle_data->ordered_writes == false)
+    {
+        /*Codes_SRS_BLEIO_SEQ_48_003: [ If writes are not ordered then a WRITE_ONCE or WRITE_AT_INIT instruction added while another write to the same characteristic is in flight shall replace the write that is waiting for it, if any, and the on_write_complete callback shall be invoked for the replaced write with BLEIO_SEQ_SUPERSEDED. ]*/
+        if (last_waiting != NULL)
+        {
+            unlink_queued_write(handle_data, last_waiting);
+            if (handle_data->on_write_complete != NULL)
+            {
+                handle_data->on_write_complete(
+                    (BLEIO_SEQ_HANDLE)handle_data,
+                    last_waiting->instruction.context,
+                    STRING_c_str(last_waiting->instruction.characteristic_uuid),
+                    last_waiting->instruction.instruction_type,
+                    BLEIO_SEQ_SUPERSEDED
+                );
+            }
+            STRING_delete(last_waiting->instruction.characteristic_uuid);
+            BUFFER_delete(last_waiting->instruction.data.buffer);
+            free(last_waiting);
+        }
+
+        append_queued_write(handle_data, queued_write);
+        result = BLEIO_SEQ_OK;
+    }
+    else if (waiting_count >= handle_data->max_write_queue_depth)
+    {
+        /*Codes_SRS_BLEIO_SEQ_48_004: [ If writes are ordered then BLEIO_Seq_AddInstruction shall queue a WRITE_ONCE or WRITE_AT_INIT instruction behind the writes to the same characteristic and shall return BLEIO_SEQ_QUEUE_FULL if max_depth writes are already waiting. ]*/
+        LogError("The write queue for characteristic %s is full", STRING_c_str(queued_write->instruction.characteristic_uuid));
+        result = BLEIO_SEQ_QUEUE_FULL;
+    }
+    else
+    {
+        /*Codes_SRS_BLEIO_SEQ_48_004: [ If writes are ordered then BLEIO_Seq_AddInstruction shall queue a WRITE_ONCE or WRITE_AT_INIT instruction behind the writes to the same characteristic and shall return BLEIO_SEQ_QUEUE_FULL if max_depth writes are already waiting. ]*/
+        append_queued_write(handle_data, queued_write);
+        result = BLEIO_SEQ_OK;
+    }
+
+    return result;
+}
+
 BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
     BLEIO_SEQ_HANDLE bleio_seq_handle,
     BLEIO_SEQ_INSTRUCTION* instruction
@@ -405,9 +616,10 @@ BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
         }
         else
         {
-            // copy the instruction into a new struct
-            BLEIO_SEQ_INSTRUCTION* instr = (BLEIO_SEQ_INSTRUCTION*)malloc(sizeof(BLEIO_SEQ_INSTRUCTION));
-            if (instr == NULL)
+            // copy the instruction into a new struct; writes are linked into
+            // the write queue through it so every instruction gets the room
+            QUEUED_WRITE* queued_write = (QUEUED_WRITE*)malloc(sizeof(QUEUED_WRITE));
+            if (queued_write == NULL)
             {
                 /*Codes_SRS_BLEIO_SEQ_13_037: [ BLEIO_Seq_AddInstruction shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
                 LogError("malloc failed");
@@ -415,10 +627,12 @@ BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
             }
             else
             {
+                BLEIO_SEQ_INSTRUCTION* instr = &(queued_write->instruction);
                 instr->instruction_type = instruction->instruction_type;
                 instr->characteristic_uuid = instruction->characteristic_uuid;
                 instr->context = instruction->context;
                 instr->data = instruction->data;
+                queued_write->next = NULL;
 
                 // we save the result of this condition in a boolean because after the
                 // 'schedule_instruction' call below, there is no guarantee that "instr"
@@ -429,12 +643,21 @@ BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
                 // thread but we might potentially be working with other threading// models)
                 bool is_write_at_exit_instr = (instr->instruction_type == WRITE_AT_EXIT);
 
-                /*Codes_SRS_BLEIO_SEQ_13_038: [ BLEIO_Seq_AddInstruction shall schedule execution of the instruction. ]*/
                 LogInfo("Scheduling a new instruction.");
-                result = schedule_instruction(handle_data, instr, on_instruction_complete);
+                if (is_queued_write(instr))
+                {
+                    result = queue_write(handle_data, queued_write);
+                }
+                else
+                {
+                    /*Codes_SRS_BLEIO_SEQ_13_038: [ BLEIO_Seq_AddInstruction shall schedule execution of the instruction. ]*/
+                    result = schedule_instruction(handle_data, instr, on_instruction_complete);
+                }
+
                 if (result != BLEIO_SEQ_OK)
                 {
-                    free(instr);
+                    /*Codes_SRS_BLEIO_SEQ_48_007: [ If BLEIO_Seq_AddInstruction does not return BLEIO_SEQ_OK then the caller shall keep ownership of the characteristic_uuid and buffer of the instruction. ]*/
+                    free(queued_write);
                     LogError("An error occurred while scheduling an instruction of type %d for characteristic %s",
                         instruction->instruction_type, STRING_c_str(instruction->characteristic_uuid));
                 }
@@ -445,7 +668,7 @@ BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
                     // for "instr" since the vector maintains its own copy of the instruction
                     if (is_write_at_exit_instr == true)
                     {
-                        free(instr);
+                        free(queued_write);
                     }
                 }
             }
@@ -454,3 +677,33 @@ BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
 
     return result;
 }
+
+BLEIO_SEQ_RESULT BLEIO_Seq_SetWriteQueueConfig(
+    BLEIO_SEQ_HANDLE bleio_seq_handle,
+    const BLEIO_SEQ_WRITE_QUEUE_CONFIG* config
+)
+{
+    BLEIO_SEQ_RESULT result;
+
+    /*Codes_SRS_BLEIO_SEQ_48_001: [ BLEIO_Seq_SetWriteQueueConfig shall return BLEIO_SEQ_ERROR if bleio_seq_handle or config is NULL or if ordered is true and max_depth is zero. ]*/
+    if (
+            bleio_seq_handle == NULL ||
+            config == NULL ||
+            (config->ordered == true && config->max_depth == 0)
+       )
+    {
+        LogError("Invalid write queue configuration");
+        result = BLEIO_SEQ_ERROR;
+    }
+    else
+    {
+        BLEIO_SEQ_HANDLE_DATA* handle_data = (BLEIO_SEQ_HANDLE_DATA*)bleio_seq_handle;
+
+        /*Codes_SRS_BLEIO_SEQ_48_002: [ BLEIO_Seq_SetWriteQueueConfig shall apply config to the writes that are added after it returns and return BLEIO_SEQ_OK. ]*/
+        handle_data->ordered_writes = config->ordered;
+        handle_data->max_write_queue_depth = config->max_depth;
+        result = BLEIO_SEQ_OK;
+    }
+
+    return result;
+}
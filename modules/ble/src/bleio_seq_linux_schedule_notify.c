@@ -0,0 +1,164 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/buffer_.h"
+
+#include "ble_gatt_io.h"
+#include "bleio_seq.h"
+#include "bleio_seq_linux_common.h"
+
+// a NOTIFY instruction never completes; its context is kept in a list in
+// the handle data and is freed along with the handle
+struct NOTIFY_CONTEXT_TAG {
+    BLEIO_SEQ_HANDLE_DATA*  handle_data;
+    BLEIO_SEQ_INSTRUCTION*  instruction;
+    ON_INTERNAL_IO_COMPLETE on_internal_read_complete;
+    NOTIFY_CONTEXT*         next;
+};
+
+static void on_notify_start_complete(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* notify_context,
+    BLEIO_GATT_RESULT result
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)notify_context;
+    if (result != BLEIO_GATT_OK)
+    {
+        LogError("Starting notifications failed for characteristic %s",
+            STRING_c_str(context->instruction->characteristic_uuid)
+        );
+
+        /*Codes_SRS_BLEIO_SEQ_42_003: [ If notifications could not be started for a NOTIFY instruction then the on_read_complete callback shall be invoked with BLEIO_SEQ_ERROR as the status of the operation and NULL data. ]*/
+        if (context->handle_data->on_read_complete != NULL)
+        {
+            context->handle_data->on_read_complete(
+                (BLEIO_SEQ_HANDLE)(context->handle_data),
+                context->instruction->context,
+                STRING_c_str(context->instruction->characteristic_uuid),
+                context->instruction->instruction_type,
+                BLEIO_SEQ_ERROR,
+                NULL
+            );
+        }
+    }
+
+    // the notifications themselves do not keep the handle alive; they end
+    // when the GATT I/O handle is destroyed along with the handle data
+    dec_ref_handle(context->handle_data);
+}
+
+static void on_notify(
+    BLEIO_GATT_HANDLE bleio_gatt_handle,
+    void* notify_context,
+    const unsigned char* data,
+    size_t size
+)
+{
+    (void)bleio_gatt_handle;
+    // this MUST NOT be NULL
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)notify_context;
+
+    /*Codes_SRS_BLEIO_SEQ_42_004: [ Notifications that arrive after BLEIO_Seq_Destroy has been called shall be dropped. ]*/
+    if (
+            context->handle_data->state == BLEIO_SEQ_STATE_RUNNING &&
+            context->handle_data->on_read_complete != NULL
+       )
+    {
+        BUFFER_HANDLE buffer = BUFFER_create(data, size);
+        if (buffer == NULL)
+        {
+            LogError("BUFFER_create failed.");
+        }
+
+        /*Codes_SRS_BLEIO_SEQ_42_002: [ When a notification arrives for a NOTIFY instruction the on_read_complete callback shall be invoked passing in the value that was notified along with the status of the operation and the callback context that was passed in via the BLEIO_SEQ_INSTRUCTION structure. ]*/
+        context->handle_data->on_read_complete(
+            (BLEIO_SEQ_HANDLE)(context->handle_data),
+            context->instruction->context,
+            STRING_c_str(context->instruction->characteristic_uuid),
+            context->instruction->instruction_type,
+            (buffer != NULL) ? BLEIO_SEQ_OK : BLEIO_SEQ_ERROR,
+            buffer
+        );
+    }
+}
+
+BLEIO_SEQ_RESULT schedule_notify(
+    BLEIO_SEQ_HANDLE_DATA* handle_data,
+    BLEIO_SEQ_INSTRUCTION* instruction,
+    ON_INTERNAL_IO_COMPLETE on_internal_read_complete
+)
+{
+    BLEIO_SEQ_RESULT result;
+    NOTIFY_CONTEXT* context = (NOTIFY_CONTEXT*)malloc(sizeof(NOTIFY_CONTEXT));
+
+    /*Codes_SRS_BLEIO_SEQ_13_014: [ BLEIO_Seq_Run shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
+    if (context == NULL)
+    {
+        LogError("malloc failed");
+        result = BLEIO_SEQ_ERROR;
+    }
+    else
+    {
+        context->handle_data = handle_data;
+        context->instruction = instruction;
+        context->on_internal_read_complete = on_internal_read_complete;
+
+        // add ref to the handle data object since we now will have an
+        // outstanding I/O operation starting the notifications; see
+        // schedule_read for why this is done ahead of the call
+        inc_ref_handle(handle_data);
+
+        int notify_result = BLEIO_gatt_notify_char_by_uuid(
+            handle_data->bleio_gatt_handle,
+            STRING_c_str(instruction->characteristic_uuid),
+            on_notify_start_complete,
+            on_notify,
+            context
+        );
+
+        if (notify_result != 0)
+        {
+            /*Codes_SRS_BLEIO_SEQ_13_014: [ BLEIO_Seq_Run shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
+            result = BLEIO_SEQ_ERROR;
+            free(context);
+            dec_ref_handle_only(handle_data);
+            LogError("BLEIO_gatt_notify_char_by_uuid failed with %d.", notify_result);
+        }
+        else
+        {
+            context->next = handle_data->notify_contexts;
+            handle_data->notify_contexts = context;
+            result = BLEIO_SEQ_OK;
+        }
+    }
+
+    return result;
+}
+
+void free_notify_contexts(BLEIO_SEQ_HANDLE_DATA* handle_data)
+{
+    NOTIFY_CONTEXT* context = handle_data->notify_contexts;
+    while (context != NULL)
+    {
+        NOTIFY_CONTEXT* next = context->next;
+
+        // invoke the internal complete callback if we have one
+        if (context->on_internal_read_complete != NULL)
+        {
+            context->on_internal_read_complete(handle_data, context->instruction);
+        }
+
+        free(context);
+        context = next;
+    }
+
+    handle_data->notify_contexts = NULL;
+}
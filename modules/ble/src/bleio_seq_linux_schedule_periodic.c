@@ -15,40 +15,50 @@
 
 #include "bleio_seq_linux_common.h"
 
+// 'read_context' MUST be the first field because a read that is in flight
+// when the timer is cancelled frees the timer context through it.
 typedef struct TIMER_CONTEXT_TAG {
-    BLEIO_SEQ_HANDLE_DATA*  handle_data;
-    BLEIO_SEQ_INSTRUCTION*  instruction;
+    READ_CONTEXT            read_context;
     ON_INTERNAL_IO_COMPLETE on_internal_read_complete;
 }TIMER_CONTEXT;
 
 static gboolean on_timer(gpointer user_data)
 {
     TIMER_CONTEXT* context = (TIMER_CONTEXT*)user_data;
+    BLEIO_SEQ_HANDLE_DATA* handle_data = context->read_context.handle_data;
+    BLEIO_SEQ_INSTRUCTION* instruction = context->read_context.instruction;
 
     /*Codes_SRS_BLEIO_SEQ_13_009: [ If there are active instructions of type READ_PERIODIC in progress then the timers associated with those instructions shall be cancelled. ]*/
     // we cancel the timer when the sequencer is not in 'running' state
-    gboolean result = (context->handle_data->state == BLEIO_SEQ_STATE_RUNNING) ?
+    gboolean result = (handle_data->state == BLEIO_SEQ_STATE_RUNNING) ?
         G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
 
     if (result == G_SOURCE_CONTINUE)
     {
-        BLEIO_SEQ_RESULT read_result = schedule_read(
-            context->handle_data,
-            context->instruction,
-            NULL
-        );
+        BLEIO_SEQ_RESULT read_result;
+
+        /*Codes_SRS_BLEIO_SEQ_50_001: [ The timer of a READ_PERIODIC instruction shall allocate the state of a read once and reuse it for every read of the instruction; a read that is due while the previous read of the instruction is still in flight shall use state of its own. ]*/
+        if (context->read_context.is_in_flight)
+        {
+            read_result = schedule_read(handle_data, instruction, NULL);
+        }
+        else
+        {
+            read_result = start_read(&(context->read_context));
+        }
+
         if (read_result == BLEIO_SEQ_ERROR)
         {
             LogError("An error occurred while scheduling instruction of type %d for characteristic %s",
-                context->instruction->instruction_type,
-                STRING_c_str(context->instruction->characteristic_uuid)
+                instruction->instruction_type,
+                STRING_c_str(instruction->characteristic_uuid)
             );
 
-            context->handle_data->on_read_complete(
-                (BLEIO_SEQ_HANDLE)context->handle_data,
-                context->instruction->context,
-                STRING_c_str(context->instruction->characteristic_uuid),
-                context->instruction->instruction_type,
+            handle_data->on_read_complete(
+                (BLEIO_SEQ_HANDLE)handle_data,
+                instruction->context,
+                STRING_c_str(instruction->characteristic_uuid),
+                instruction->instruction_type,
                 read_result,
                 NULL
             );
@@ -59,12 +69,22 @@ static gboolean on_timer(gpointer user_data)
         // invoke the internal complete callback if we have one
         if (context->on_internal_read_complete != NULL)
         {
-            context->on_internal_read_complete(context->handle_data, context->instruction);
+            context->on_internal_read_complete(handle_data, instruction);
+        }
+
+        if (context->read_context.is_in_flight)
+        {
+            /*Codes_SRS_BLEIO_SEQ_50_002: [ When the timer of a READ_PERIODIC instruction is cancelled while a read of the instruction is in flight the state of the read shall be freed once the read completes. ]*/
+            context->read_context.is_owned = false;
+        }
+        else
+        {
+            free(context);
         }
 
-        // dec ref the handle data
-        dec_ref_handle(context->handle_data);
-        free(context);
+        // dec ref the handle data; a read in flight holds a reference of
+        // its own
+        dec_ref_handle(handle_data);
     }
 
     return result;
@@ -87,8 +107,13 @@ BLEIO_SEQ_RESULT schedule_periodic(
     }
     else
     {
-        context->handle_data = handle_data;
-        context->instruction = instruction;
+        // the reads of the instruction reuse this context and report to
+        // 'on_internal_read_complete' only when the timer is cancelled
+        context->read_context.handle_data = handle_data;
+        context->read_context.instruction = instruction;
+        context->read_context.on_internal_read_complete = NULL;
+        context->read_context.is_owned = true;
+        context->read_context.is_in_flight = false;
         context->on_internal_read_complete = on_internal_read_complete;
 
         // add ref to the handle data object since we now will have an
@@ -12,12 +12,6 @@
 #include "bleio_seq.h"
 #include "bleio_seq_linux_common.h"
 
-typedef struct READ_CONTEXT_TAG {
-    BLEIO_SEQ_HANDLE_DATA* handle_data;
-    BLEIO_SEQ_INSTRUCTION* instruction;
-    ON_INTERNAL_IO_COMPLETE on_internal_read_complete;
-}READ_CONTEXT;
-
 static void on_read_complete(
     BLEIO_GATT_HANDLE bleio_gatt_handle,
     void* read_context,
@@ -65,7 +59,55 @@ static void on_read_complete(
 
     // dec ref the handle data
     dec_ref_handle(context->handle_data);
-    free(context);
+
+    if (context->is_owned)
+    {
+        // the owner reuses the context for the next read
+        context->is_in_flight = false;
+    }
+    else
+    {
+        /*Codes_SRS_BLEIO_SEQ_50_002: [ When the timer of a READ_PERIODIC instruction is cancelled while a read of the instruction is in flight the state of the read shall be freed once the read completes. ]*/
+        free(context);
+    }
+}
+
+BLEIO_SEQ_RESULT start_read(READ_CONTEXT* context)
+{
+    BLEIO_SEQ_RESULT result;
+    BLEIO_SEQ_HANDLE_DATA* handle_data = context->handle_data;
+
+    // add ref to the handle data object since we now will have an
+    // outstanding I/O operation; the reason why we increment the
+    // reference here as opposed to when we know that BLEIO_gatt_read_char_by_uuid
+    // was successful is because the operation could potentially complete
+    // even before we hit the if check after this call and 'on_read_complete'
+    // might have run by then in which case it would have done a DEC_REF and
+    // the ref counts will be out of whack
+    inc_ref_handle(handle_data);
+    context->is_in_flight = true;
+
+    int read_result = BLEIO_gatt_read_char_by_uuid(
+        handle_data->bleio_gatt_handle,
+        STRING_c_str(context->instruction->characteristic_uuid),
+        on_read_complete,
+        context
+    );
+
+    if (read_result != 0)
+    {
+        /*Codes_SRS_BLEIO_SEQ_13_014: [ BLEIO_Seq_Run shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
+        result = BLEIO_SEQ_ERROR;
+        context->is_in_flight = false;
+        dec_ref_handle_only(handle_data);
+        LogError("BLEIO_gatt_read_char_by_uuid failed with %d.", read_result);
+    }
+    else
+    {
+        result = BLEIO_SEQ_OK;
+    }
+
+    return result;
 }
 
 BLEIO_SEQ_RESULT schedule_read(
@@ -88,34 +130,13 @@ BLEIO_SEQ_RESULT schedule_read(
         context->handle_data = handle_data;
         context->instruction = instruction;
         context->on_internal_read_complete = on_internal_read_complete;
+        context->is_owned = false;
+        context->is_in_flight = false;
 
-        // add ref to the handle data object since we now will have an
-        // outstanding I/O operation; the reason why we increment the
-        // reference here as opposed to when we know that BLEIO_gatt_read_char_by_uuid
-        // was successful is because the operation could potentially complete
-        // even before we hit the if check after this call and 'on_read_complete'
-        // might have run by then in which case it would have done a DEC_REF and
-        // the ref counts will be out of whack
-        inc_ref_handle(handle_data);
-
-        int read_result = BLEIO_gatt_read_char_by_uuid(
-            handle_data->bleio_gatt_handle,
-            STRING_c_str(instruction->characteristic_uuid),
-            on_read_complete,
-            context
-        );
-
-        if (read_result != 0)
+        result = start_read(context);
+        if (result != BLEIO_SEQ_OK)
         {
-            /*Codes_SRS_BLEIO_SEQ_13_014: [ BLEIO_Seq_Run shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
-            result = BLEIO_SEQ_ERROR;
             free(context);
-            dec_ref_handle_only(handle_data);
-            LogError("BLEIO_gatt_read_char_by_uuid failed with %d.", read_result);
-        }
-        else
-        {
-            result = BLEIO_SEQ_OK;
         }
     }
 
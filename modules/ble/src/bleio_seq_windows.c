@@ -45,4 +45,13 @@ BLEIO_SEQ_RESULT BLEIO_Seq_AddInstruction(
 {
     /*Codes_SRS_BLEIO_SEQ_13_044: [ On Windows this function shall return BLEIO_SEQ_ERROR. ]*/
     return BLEIO_SEQ_ERROR;
-}
\ No newline at end of file
+}
+
+BLEIO_SEQ_RESULT BLEIO_Seq_SetWriteQueueConfig(
+    BLEIO_SEQ_HANDLE bleio_seq_handle,
+    const BLEIO_SEQ_WRITE_QUEUE_CONFIG* config
+)
+{
+    /*Codes_SRS_BLEIO_SEQ_48_008: [ On Windows this function shall return BLEIO_SEQ_ERROR. ]*/
+    return BLEIO_SEQ_ERROR;
+}
@@ -32,6 +32,7 @@ static const unsigned char *gMessageSource;
 
 static BUFFER_HANDLE gLastBuffer = NULL;
 static STRING_HANDLE gLastString = NULL;
+static BLE_INSTRUCTION gLastInstruction;
 
 #define FAKE_CONFIG "" \
 "{" \
@@ -338,6 +339,10 @@ public:
         auto result2 = gLastString = BASEIMPLEMENTATION::STRING_construct(source);
     MOCK_METHOD_END(STRING_HANDLE, result2)
 
+    MOCK_STATIC_METHOD_2(, STRING_HANDLE, STRING_construct_n, const char*, psz, size_t, n)
+        auto result2 = gLastString = BASEIMPLEMENTATION::STRING_construct_n(psz, n);
+    MOCK_METHOD_END(STRING_HANDLE, result2)
+
     MOCK_STATIC_METHOD_1(, const char*, STRING_c_str, STRING_HANDLE, handle)
     MOCK_METHOD_END(const char*, BASEIMPLEMENTATION::STRING_c_str(handle))
 
@@ -349,6 +354,22 @@ public:
         BASEIMPLEMENTATION::BUFFER_delete(handle);
     MOCK_VOID_METHOD_END()
     
+    MOCK_STATIC_METHOD_0(, BUFFER_HANDLE, BUFFER_new)
+        auto result2 = gLastBuffer = BASEIMPLEMENTATION::BUFFER_new();
+    MOCK_METHOD_END(BUFFER_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_2(, BUFFER_HANDLE, BUFFER_create, const unsigned char*, source, size_t, size)
+        auto result2 = gLastBuffer = BASEIMPLEMENTATION::BUFFER_create(source, size);
+    MOCK_METHOD_END(BUFFER_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_2(, int, BUFFER_pre_build, BUFFER_HANDLE, handle, size_t, size)
+        auto result2 = BASEIMPLEMENTATION::BUFFER_pre_build(handle, size);
+    MOCK_METHOD_END(int, result2)
+
+    MOCK_STATIC_METHOD_1(, unsigned char*, BUFFER_u_char, BUFFER_HANDLE, handle)
+        auto result2 = BASEIMPLEMENTATION::BUFFER_u_char(handle);
+    MOCK_METHOD_END(unsigned char*, result2)
+
     MOCK_STATIC_METHOD_1(, BUFFER_HANDLE, Base64_Decoder, const char*, source)
         auto result2 = gLastBuffer = BASEIMPLEMENTATION::BUFFER_create((const unsigned char*)"abc", 3);
     MOCK_METHOD_END(BUFFER_HANDLE, result2)
@@ -451,6 +472,10 @@ public:
     MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg)
         gMessageSize = cfg->size;
         gMessageSource = cfg->source;
+        if (cfg->size == sizeof(BLE_INSTRUCTION))
+        {
+            memcpy(&gLastInstruction, cfg->source, sizeof(BLE_INSTRUCTION));
+        }
     MOCK_METHOD_END(MESSAGE_HANDLE, (MESSAGE_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
 
     MOCK_STATIC_METHOD_1(, CONSTMAP_HANDLE, Message_GetProperties, MESSAGE_HANDLE, message)
@@ -507,9 +532,14 @@ DECLARE_GLOBAL_MOCK_METHOD_3(CBLEC2DMocks, , int, VECTOR_push_back, VECTOR_HANDL
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , BUFFER_HANDLE, Base64_Decoder, const char*, source);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , STRING_HANDLE, STRING_construct, const char*, source);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEC2DMocks, , STRING_HANDLE, STRING_construct_n, const char*, psz, size_t, n);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , const char*, STRING_c_str, STRING_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , void, STRING_delete, STRING_HANDLE, handle);
 
+DECLARE_GLOBAL_MOCK_METHOD_0(CBLEC2DMocks, , BUFFER_HANDLE, BUFFER_new);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEC2DMocks, , BUFFER_HANDLE, BUFFER_create, const unsigned char*, source, size_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEC2DMocks, , int, BUFFER_pre_build, BUFFER_HANDLE, handle, size_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , unsigned char*, BUFFER_u_char, BUFFER_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , void, BUFFER_delete, BUFFER_HANDLE, handle);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEC2DMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
@@ -757,6 +787,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -807,6 +839,562 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
         STRING_delete(gLastString);
     }
 
+    /*Tests_SRS_BLE_CTOD_47_001: [ If the message has a "contentType" property whose value is "application/x-ble-instruction", BLE_C2D_Receive shall decode the message content as a binary BLE instruction instead of JSON. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_publishes_binary_write_instruction)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const unsigned char content[] =
+        {
+            BLE_C2D_BINARY_VERSION, (unsigned char)WRITE_ONCE, 3, 0, 0, 0, 0, 0,
+            'a', 'b', 'c',
+            0x01, 0x02
+        };
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_CONTENT_TYPE_BLE_INSTRUCTION);
+        STRICT_EXPECTED_CALL(mocks, STRING_construct_n(IGNORED_PTR_ARG, 3))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_create(IGNORED_PTR_ARG, 2))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((MAP_HANDLE)0x42);
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy((MAP_HANDLE)0x42));
+
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Broker_Publish((BROKER_HANDLE)0x42, module, IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, (int)WRITE_ONCE, (int)gLastInstruction.instruction_type);
+        ASSERT_ARE_EQUAL(char_ptr, "abc", BASEIMPLEMENTATION::STRING_c_str(gLastInstruction.characteristic_uuid));
+        ASSERT_ARE_EQUAL(int, 2, (int)BASEIMPLEMENTATION::BUFFER_length(gLastInstruction.data.buffer));
+        ASSERT_ARE_EQUAL(int, 0x02, (int)BASEIMPLEMENTATION::BUFFER_u_char(gLastInstruction.data.buffer)[1]);
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+        BUFFER_delete(gLastBuffer);
+        STRING_delete(gLastString);
+    }
+
+    /*Tests_SRS_BLE_CTOD_47_001: [ If the message has a "contentType" property whose value is "application/x-ble-instruction", BLE_C2D_Receive shall decode the message content as a binary BLE instruction instead of JSON. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_publishes_binary_read_periodic_instruction)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const unsigned char content[] =
+        {
+            BLE_C2D_BINARY_VERSION, (unsigned char)READ_PERIODIC, 3, 0, 0xE8, 0x03, 0, 0,
+            'a', 'b', 'c'
+        };
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_CONTENT_TYPE_BLE_INSTRUCTION);
+        STRICT_EXPECTED_CALL(mocks, STRING_construct_n(IGNORED_PTR_ARG, 3))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((MAP_HANDLE)0x42);
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy((MAP_HANDLE)0x42));
+
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Broker_Publish((BROKER_HANDLE)0x42, module, IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, (int)READ_PERIODIC, (int)gLastInstruction.instruction_type);
+        ASSERT_ARE_EQUAL(int, 1000, (int)gLastInstruction.data.interval_in_ms);
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+        STRING_delete(gLastString);
+    }
+
+    /*Tests_SRS_BLE_CTOD_47_002: [ BLE_C2D_Receive shall do nothing if a binary BLE instruction is shorter than its header, has an unsupported version or instruction type, has an empty or truncated characteristic UUID, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction without data or is any other instruction with data. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_does_nothing_when_binary_uuid_is_truncated)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const unsigned char content[] =
+        {
+            BLE_C2D_BINARY_VERSION, (unsigned char)READ_ONCE, 9, 0, 0, 0, 0, 0,
+            'a', 'b', 'c'
+        };
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_CONTENT_TYPE_BLE_INSTRUCTION);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+    }
+
+    /*Tests_SRS_BLE_CTOD_47_002: [ BLE_C2D_Receive shall do nothing if a binary BLE instruction is shorter than its header, has an unsupported version or instruction type, has an empty or truncated characteristic UUID, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction without data or is any other instruction with data. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_does_nothing_when_binary_interval_is_zero)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const unsigned char content[] =
+        {
+            BLE_C2D_BINARY_VERSION, (unsigned char)READ_PERIODIC, 3, 0, 0, 0, 0, 0,
+            'a', 'b', 'c'
+        };
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_CONTENT_TYPE_BLE_INSTRUCTION);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+    }
+
+    /*Tests_SRS_BLE_CTOD_47_002: [ BLE_C2D_Receive shall do nothing if a binary BLE instruction is shorter than its header, has an unsupported version or instruction type, has an empty or truncated characteristic UUID, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction without data or is any other instruction with data. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_does_nothing_when_binary_write_has_no_data)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const unsigned char content[] =
+        {
+            BLE_C2D_BINARY_VERSION, (unsigned char)WRITE_AT_INIT, 3, 0, 0, 0, 0, 0,
+            'a', 'b', 'c'
+        };
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_CONTENT_TYPE_BLE_INSTRUCTION);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+    }
+
+    /*Tests_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_does_nothing_when_binary_STRING_construct_n_fails)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const unsigned char content[] =
+        {
+            BLE_C2D_BINARY_VERSION, (unsigned char)READ_ONCE, 3, 0, 0, 0, 0, 0,
+            'a', 'b', 'c'
+        };
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_CONTENT_TYPE_BLE_INSTRUCTION);
+        STRICT_EXPECTED_CALL(mocks, STRING_construct_n(IGNORED_PTR_ARG, 3))
+            .IgnoreArgument(1)
+            .SetFailReturn((STRING_HANDLE)NULL);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+    }
+
+    /*Tests_SRS_BLE_CTOD_47_003: [ If the message contents are a flat JSON object whose strings contain no escape sequences, BLE_C2D_Receive shall fill in the BLE_INSTRUCTION directly from the message contents without building a JSON document. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_publishes_flat_json_without_parsing_a_document)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const char content[] = "{ \"type\": \"write_once\", \"characteristic_uuid\": \"F000AA02-0451-4000-B000-000000000000\", \"data\": \"AQI=\" }";
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content) - 1;
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_construct_n(IGNORED_PTR_ARG, 36))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_new());
+        STRICT_EXPECTED_CALL(mocks, BUFFER_pre_build(IGNORED_PTR_ARG, 2))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((MAP_HANDLE)0x42);
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy((MAP_HANDLE)0x42));
+
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Broker_Publish((BROKER_HANDLE)0x42, module, IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, (int)WRITE_ONCE, (int)gLastInstruction.instruction_type);
+        ASSERT_ARE_EQUAL(char_ptr, "F000AA02-0451-4000-B000-000000000000", BASEIMPLEMENTATION::STRING_c_str(gLastInstruction.characteristic_uuid));
+        ASSERT_ARE_EQUAL(int, 2, (int)BASEIMPLEMENTATION::BUFFER_length(gLastInstruction.data.buffer));
+        ASSERT_ARE_EQUAL(int, 0x01, (int)BASEIMPLEMENTATION::BUFFER_u_char(gLastInstruction.data.buffer)[0]);
+        ASSERT_ARE_EQUAL(int, 0x02, (int)BASEIMPLEMENTATION::BUFFER_u_char(gLastInstruction.data.buffer)[1]);
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+        BUFFER_delete(gLastBuffer);
+        STRING_delete(gLastString);
+    }
+
+    /*Tests_SRS_BLE_CTOD_13_024: [ BLE_C2D_Receive shall do nothing if an underlying API call fails. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_does_nothing_when_flat_json_BUFFER_pre_build_fails)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const char content[] = "{ \"type\": \"write_once\", \"characteristic_uuid\": \"F000AA02-0451-4000-B000-000000000000\", \"data\": \"AQI=\" }";
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content) - 1;
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_construct_n(IGNORED_PTR_ARG, 36))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_new());
+        STRICT_EXPECTED_CALL(mocks, BUFFER_pre_build(IGNORED_PTR_ARG, 2))
+            .IgnoreArgument(1)
+            .SetFailReturn((int)__LINE__);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+    }
+
+    /*Tests_SRS_BLE_CTOD_47_004: [ If the message contents cannot be translated that way, BLE_C2D_Receive shall parse them with the JSON parser. ]*/
+    TEST_FUNCTION(BLE_C2D_Receive_parses_nested_json_with_the_json_parser)
+    {
+        ///arrange
+        CBLEC2DMocks mocks;
+        const char content[] = "{ \"type\": \"read_once\", \"characteristic_uuid\": \"abc\", \"extra\": { \"a\": 1 } }";
+        CONSTBUFFER messageBuffer;
+        messageBuffer.buffer = (const unsigned char*)content;
+        messageBuffer.size = sizeof(content);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1)
+            .SetReturn((const char*)"write_at_init");
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((size_t)1);
+
+        auto module = BLE_C2D_Create((BROKER_HANDLE)0x42, (const void*)FAKE_CONFIG);
+        mocks.ResetAllCalls();
+
+        MESSAGE_HANDLE fakeMessage = (MESSAGE_HANDLE)0x42;
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(fakeMessage));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)"AA:BB:CC:DD:EE:FF");
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1)
+            .SetReturn((const char *)GW_IDMAP_MODULE);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
+            .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "type"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_CloneWriteable(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((MAP_HANDLE)0x42);
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy((MAP_HANDLE)0x42));
+
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Message_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Broker_Publish((BROKER_HANDLE)0x42, module, IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_C2D_Receive(module, (MESSAGE_HANDLE)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, (int)READ_ONCE, (int)gLastInstruction.instruction_type);
+
+        ///cleanup
+        BLE_C2D_Destroy(module);
+        STRING_delete(gLastString);
+    }
+
     /*Tests_SRS_BLE_CTOD_13_016: [ BLE_C2D_Receive shall do nothing if module is NULL. ]*/
     TEST_FUNCTION(BLE_C2D_Receive_does_nothing_for_NULL_module)
     {
@@ -1025,6 +1613,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetFailReturn((JSON_Value*)NULL);
@@ -1071,6 +1661,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1121,6 +1713,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1173,6 +1767,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1228,6 +1824,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1286,6 +1884,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1348,6 +1948,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1412,6 +2014,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1481,6 +2085,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1555,6 +2161,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1632,6 +2240,8 @@ BEGIN_TEST_SUITE(ble_c2d_ut)
             .SetReturn((const char *)GW_IDMAP_MODULE);
         STRICT_EXPECTED_CALL(mocks, Message_GetContent(fakeMessage))
             .SetReturn((const CONSTBUFFER *)&messageBuffer);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_CONTENT_TYPE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_parse_string(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
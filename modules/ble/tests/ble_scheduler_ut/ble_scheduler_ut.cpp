@@ -0,0 +1,1157 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <cstdlib>
+#include <cstddef>
+#include <cstdbool>
+#include <cstring>
+#include "testrunnerswitcher.h"
+#include "micromock.h"
+#include "micromockcharstararenullterminatedstrings.h"
+
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/vector_types_internal.h"
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "ble_gatt_io.h"
+#include "bleio_seq.h"
+#include "ble_scheduler.h"
+
+static MICROMOCK_MUTEX_HANDLE g_testByTest;
+static MICROMOCK_GLOBAL_SEMAPHORE_HANDLE g_dllByDll;
+
+#define GBALLOC_H
+
+extern "C" int gballoc_init(void);
+extern "C" void gballoc_deinit(void);
+extern "C" void* gballoc_malloc(size_t size);
+extern "C" void* gballoc_calloc(size_t nmemb, size_t size);
+extern "C" void* gballoc_realloc(void* ptr, size_t size);
+extern "C" void gballoc_free(void* ptr);
+
+namespace BASEIMPLEMENTATION
+{
+    /*if malloc is defined as gballoc_malloc at this moment, there'd be serious trouble*/
+#define Lock(x) (LOCK_OK + gballocState - gballocState) /*compiler warning about constant in if condition*/
+#define Unlock(x) (LOCK_OK + gballocState - gballocState)
+#define Lock_Init() (LOCK_HANDLE)0x42
+#define Lock_Deinit(x) (LOCK_OK + gballocState - gballocState)
+#include "gballoc.c"
+#undef Lock
+#undef Unlock
+#undef Lock_Init
+#undef Lock_Deinit
+
+#include "vector.c"
+#include "buffer.c"
+#include "strings.c"
+};
+
+#define FAKE_CHAR_UUID          "00002A24-0000-1000-8000-00805F9B34FB"
+#define READ_INTERVAL_IN_MS     1000
+#define RETRY_INTERVAL_IN_MS    3000
+#define MAX_FAKE_DEVICES        4
+#define MAX_PENDING_READS       16
+
+static BLE_DEVICE_CONFIG g_device_configs[MAX_FAKE_DEVICES] =
+{
+    { { 0x00, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+    { { 0x01, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+    { { 0x02, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+    { { 0x03, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 }
+};
+
+static const unsigned char g_read_data[] = { 0x01, 0x02, 0x03 };
+
+/**
+ * The fake GATT I/O layer; a handle is a pointer to one of these.
+ */
+typedef struct FAKE_GATT_TAG
+{
+    bool    is_connected;
+    bool    is_destroyed;
+    size_t  connects;
+    size_t  disconnects;
+    size_t  reads;
+    size_t  writes;
+}FAKE_GATT;
+
+static FAKE_GATT g_fake_gatts[MAX_FAKE_DEVICES];
+static size_t g_fake_gatt_count;
+
+// how the fake GATT I/O layer completes the operations
+static bool g_connect_succeeds;
+static bool g_defer_connects;
+static bool g_read_succeeds;
+static bool g_defer_reads;
+static bool g_drop_disconnects;
+
+// connections that have been asked for and not given back yet
+static size_t g_open_connections;
+static size_t g_max_open_connections;
+
+typedef struct PENDING_CONNECT_TAG
+{
+    BLEIO_GATT_HANDLE               handle;
+    ON_BLEIO_GATT_CONNECT_COMPLETE  callback;
+    void*                           context;
+}PENDING_CONNECT;
+
+static PENDING_CONNECT g_pending_connects[MAX_FAKE_DEVICES];
+static size_t g_pending_connect_count;
+
+typedef struct PENDING_READ_TAG
+{
+    BLEIO_GATT_HANDLE                   handle;
+    ON_BLEIO_GATT_ATTRIB_READ_COMPLETE  callback;
+    void*                               context;
+}PENDING_READ;
+
+static PENDING_READ g_pending_reads[MAX_PENDING_READS];
+static size_t g_pending_read_count;
+
+// reads reported through on_read_complete indexed by the first byte of
+// the MAC address of the device
+static size_t g_reads_by_device[MAX_FAKE_DEVICES];
+static size_t g_failed_reads;
+static bool g_was_destroy_complete_called;
+
+static void complete_connect(BLEIO_GATT_HANDLE handle, ON_BLEIO_GATT_CONNECT_COMPLETE callback, void* context)
+{
+    FAKE_GATT* fake = (FAKE_GATT*)handle;
+    if (g_connect_succeeds)
+    {
+        fake->is_connected = true;
+        callback(handle, context, BLEIO_GATT_CONNECT_OK);
+    }
+    else
+    {
+        g_open_connections--;
+        callback(handle, context, BLEIO_GATT_CONNECT_ERROR);
+    }
+}
+
+static void complete_read(BLEIO_GATT_HANDLE handle, ON_BLEIO_GATT_ATTRIB_READ_COMPLETE callback, void* context)
+{
+    if (g_read_succeeds)
+    {
+        callback(handle, context, BLEIO_GATT_OK, g_read_data, sizeof(g_read_data));
+    }
+    else
+    {
+        callback(handle, context, BLEIO_GATT_ERROR, NULL, 0);
+    }
+}
+
+static void complete_pending_connects(void)
+{
+    // completing a connect can start new ones
+    while (g_pending_connect_count > 0)
+    {
+        PENDING_CONNECT pending = g_pending_connects[0];
+        memmove(&g_pending_connects[0], &g_pending_connects[1], sizeof(PENDING_CONNECT) * (--g_pending_connect_count));
+        complete_connect(pending.handle, pending.callback, pending.context);
+    }
+}
+
+static void complete_pending_reads(void)
+{
+    while (g_pending_read_count > 0)
+    {
+        PENDING_READ pending = g_pending_reads[0];
+        memmove(&g_pending_reads[0], &g_pending_reads[1], sizeof(PENDING_READ) * (--g_pending_read_count));
+        complete_read(pending.handle, pending.callback, pending.context);
+    }
+}
+
+static void add_instruction(VECTOR_HANDLE instructions, BLEIO_SEQ_INSTRUCTION_TYPE type, uint32_t interval_in_ms)
+{
+    BLEIO_SEQ_INSTRUCTION instruction;
+    instruction.instruction_type = type;
+    instruction.characteristic_uuid = STRING_construct(FAKE_CHAR_UUID);
+    instruction.context = (void*)0x42;
+    if (type == WRITE_AT_INIT || type == WRITE_AT_EXIT || type == WRITE_ONCE)
+    {
+        instruction.data.buffer = BUFFER_create((const unsigned char*)"data", 4);
+    }
+    else
+    {
+        instruction.data.interval_in_ms = interval_in_ms;
+    }
+    VECTOR_push_back(instructions, &instruction, 1);
+}
+
+static void free_instructions(VECTOR_HANDLE instructions)
+{
+    size_t len = VECTOR_size(instructions);
+    for (size_t i = 0; i < len; i++)
+    {
+        BLEIO_SEQ_INSTRUCTION* instruction = (BLEIO_SEQ_INSTRUCTION*)VECTOR_element(instructions, i);
+        STRING_delete(instruction->characteristic_uuid);
+        if (
+            instruction->instruction_type == WRITE_AT_INIT ||
+            instruction->instruction_type == WRITE_AT_EXIT ||
+            instruction->instruction_type == WRITE_ONCE
+           )
+        {
+            BUFFER_delete(instruction->data.buffer);
+        }
+    }
+    VECTOR_destroy(instructions);
+}
+
+TYPED_MOCK_CLASS(CBLESchedulerMocks, CGlobalMock)
+{
+public:
+
+    // memory
+    MOCK_STATIC_METHOD_1(, void*, gballoc_malloc, size_t, size)
+        void* result2 = BASEIMPLEMENTATION::gballoc_malloc(size);
+    MOCK_METHOD_END(void*, result2);
+
+    MOCK_STATIC_METHOD_1(, void, gballoc_free, void*, ptr)
+        BASEIMPLEMENTATION::gballoc_free(ptr);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_7(, void, on_read_complete, BLE_SCHEDULER_HANDLE, scheduler_handle, void*, context, const BLE_DEVICE_CONFIG*, device_config, const char*, characteristic_uuid, BLEIO_SEQ_INSTRUCTION_TYPE, type, BLEIO_SEQ_RESULT, result2, BUFFER_HANDLE, data)
+        if (result2 == BLEIO_SEQ_OK)
+        {
+            g_reads_by_device[device_config->device_addr.address[0]]++;
+        }
+        else
+        {
+            g_failed_reads++;
+        }
+        if (data != NULL)
+        {
+            BUFFER_delete(data);
+        }
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_2(, void, on_destroy_complete, BLE_SCHEDULER_HANDLE, scheduler_handle, void*, context)
+        g_was_destroy_complete_called = true;
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, VECTOR_HANDLE, VECTOR_create, size_t, elementSize)
+        auto result2 = BASEIMPLEMENTATION::VECTOR_create(elementSize);
+    MOCK_METHOD_END(VECTOR_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_1(, size_t, VECTOR_size, VECTOR_HANDLE, vector)
+        size_t result2 = BASEIMPLEMENTATION::VECTOR_size(vector);
+    MOCK_METHOD_END(size_t, result2)
+
+    MOCK_STATIC_METHOD_3(, int, VECTOR_push_back, VECTOR_HANDLE, handle, const void*, elements, size_t, numElements)
+        auto result2 = BASEIMPLEMENTATION::VECTOR_push_back(handle, elements, numElements);
+    MOCK_METHOD_END(int, result2)
+
+    MOCK_STATIC_METHOD_2(, void*, VECTOR_element, VECTOR_HANDLE, vector, size_t, index)
+        void* result2 = BASEIMPLEMENTATION::VECTOR_element(vector, index);
+    MOCK_METHOD_END(void*, result2)
+
+    MOCK_STATIC_METHOD_1(, void, VECTOR_destroy, VECTOR_HANDLE, vector)
+        BASEIMPLEMENTATION::VECTOR_destroy(vector);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, size_t, STRING_length, STRING_HANDLE, handle)
+        auto result2 = BASEIMPLEMENTATION::STRING_length(handle);
+    MOCK_METHOD_END(size_t, result2)
+
+    MOCK_STATIC_METHOD_1(, void, STRING_delete, STRING_HANDLE, handle)
+        BASEIMPLEMENTATION::STRING_delete(handle);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, const char*, STRING_c_str, STRING_HANDLE, handle)
+        auto result2 = BASEIMPLEMENTATION::STRING_c_str(handle);
+    MOCK_METHOD_END(const char*, result2)
+
+    MOCK_STATIC_METHOD_1(, STRING_HANDLE, STRING_construct, const char*, psz)
+        auto result2 = BASEIMPLEMENTATION::STRING_construct(psz);
+    MOCK_METHOD_END(STRING_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_2(, BUFFER_HANDLE, BUFFER_create, const unsigned char*, source, size_t, size)
+        BUFFER_HANDLE result2 = BASEIMPLEMENTATION::BUFFER_create(source, size);
+    MOCK_METHOD_END(BUFFER_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_1(, void, BUFFER_delete, BUFFER_HANDLE, handle)
+        BASEIMPLEMENTATION::BUFFER_delete(handle);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, unsigned char*, BUFFER_u_char, BUFFER_HANDLE, handle)
+        auto result2 = BASEIMPLEMENTATION::BUFFER_u_char(handle);
+    MOCK_METHOD_END(unsigned char*, result2)
+
+    MOCK_STATIC_METHOD_1(, size_t, BUFFER_length, BUFFER_HANDLE, handle)
+        auto result2 = BASEIMPLEMENTATION::BUFFER_length(handle);
+    MOCK_METHOD_END(size_t, result2)
+
+    MOCK_STATIC_METHOD_1(, BLEIO_GATT_HANDLE, BLEIO_gatt_create, const BLE_DEVICE_CONFIG*, config)
+        BLEIO_GATT_HANDLE result2 = NULL;
+        if (config != NULL && g_fake_gatt_count < MAX_FAKE_DEVICES)
+        {
+            FAKE_GATT* fake = &g_fake_gatts[g_fake_gatt_count++];
+            memset(fake, 0, sizeof(FAKE_GATT));
+            result2 = (BLEIO_GATT_HANDLE)fake;
+        }
+    MOCK_METHOD_END(BLEIO_GATT_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_2(, BLEIO_GATT_HANDLE, BLEIO_gatt_sim_create, const BLE_DEVICE_CONFIG*, config, const BLEIO_GATT_SIM_CONFIG*, sim_config)
+        BLEIO_GATT_HANDLE result2 = NULL;
+        if (config != NULL && sim_config != NULL && g_fake_gatt_count < MAX_FAKE_DEVICES)
+        {
+            FAKE_GATT* fake = &g_fake_gatts[g_fake_gatt_count++];
+            memset(fake, 0, sizeof(FAKE_GATT));
+            result2 = (BLEIO_GATT_HANDLE)fake;
+        }
+    MOCK_METHOD_END(BLEIO_GATT_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_1(, void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle)
+        ((FAKE_GATT*)bleio_gatt_handle)->is_destroyed = true;
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_3(, int, BLEIO_gatt_connect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_CONNECT_COMPLETE, on_bleio_gatt_connect_complete, void*, callback_context)
+        ((FAKE_GATT*)bleio_gatt_handle)->connects++;
+        if (++g_open_connections > g_max_open_connections)
+        {
+            g_max_open_connections = g_open_connections;
+        }
+        if (g_defer_connects)
+        {
+            g_pending_connects[g_pending_connect_count].handle = bleio_gatt_handle;
+            g_pending_connects[g_pending_connect_count].callback = on_bleio_gatt_connect_complete;
+            g_pending_connects[g_pending_connect_count].context = callback_context;
+            g_pending_connect_count++;
+        }
+        else
+        {
+            complete_connect(bleio_gatt_handle, on_bleio_gatt_connect_complete, callback_context);
+        }
+        int result2 = 0;
+    MOCK_METHOD_END(int, result2)
+
+    MOCK_STATIC_METHOD_3(, void, BLEIO_gatt_disconnect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_DISCONNECT_COMPLETE, on_bleio_gatt_disconnect_complete, void*, callback_context)
+        FAKE_GATT* fake = (FAKE_GATT*)bleio_gatt_handle;
+        fake->is_connected = false;
+        fake->disconnects++;
+        g_open_connections--;
+        if (!g_drop_disconnects)
+        {
+            on_bleio_gatt_disconnect_complete(bleio_gatt_handle, callback_context);
+        }
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_4(, int, BLEIO_gatt_read_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, ON_BLEIO_GATT_ATTRIB_READ_COMPLETE, on_bleio_gatt_attrib_read_complete, void*, callback_context)
+        ((FAKE_GATT*)bleio_gatt_handle)->reads++;
+        if (g_defer_reads)
+        {
+            g_pending_reads[g_pending_read_count].handle = bleio_gatt_handle;
+            g_pending_reads[g_pending_read_count].callback = on_bleio_gatt_attrib_read_complete;
+            g_pending_reads[g_pending_read_count].context = callback_context;
+            g_pending_read_count++;
+        }
+        else
+        {
+            complete_read(bleio_gatt_handle, on_bleio_gatt_attrib_read_complete, callback_context);
+        }
+        int result2 = 0;
+    MOCK_METHOD_END(int, result2)
+
+    MOCK_STATIC_METHOD_6(, int, BLEIO_gatt_write_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, const unsigned char*, buffer, size_t, size, ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE, on_bleio_gatt_attrib_write_complete, void*, callback_context)
+        ((FAKE_GATT*)bleio_gatt_handle)->writes++;
+        on_bleio_gatt_attrib_write_complete(bleio_gatt_handle, callback_context, BLEIO_GATT_OK);
+        int result2 = 0;
+    MOCK_METHOD_END(int, result2)
+};
+
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , void*, gballoc_malloc, size_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , void, gballoc_free, void*, ptr);
+
+DECLARE_GLOBAL_MOCK_METHOD_7(CBLESchedulerMocks, , void, on_read_complete, BLE_SCHEDULER_HANDLE, scheduler_handle, void*, context, const BLE_DEVICE_CONFIG*, device_config, const char*, characteristic_uuid, BLEIO_SEQ_INSTRUCTION_TYPE, type, BLEIO_SEQ_RESULT, result, BUFFER_HANDLE, data);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLESchedulerMocks, , void, on_destroy_complete, BLE_SCHEDULER_HANDLE, scheduler_handle, void*, context);
+
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , VECTOR_HANDLE, VECTOR_create, size_t, elementSize);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , void, VECTOR_destroy, VECTOR_HANDLE, vector);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLESchedulerMocks, , void*, VECTOR_element, VECTOR_HANDLE, vector, size_t, index);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , size_t, VECTOR_size, VECTOR_HANDLE, vector);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLESchedulerMocks, , int, VECTOR_push_back, VECTOR_HANDLE, handle, const void*, elements, size_t, numElements);
+
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , STRING_HANDLE, STRING_construct, const char*, psz);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , size_t, STRING_length, STRING_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , void, STRING_delete, STRING_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , const char*, STRING_c_str, STRING_HANDLE, handle);
+
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLESchedulerMocks, , BUFFER_HANDLE, BUFFER_create, const unsigned char*, source, size_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , void, BUFFER_delete, BUFFER_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , unsigned char*, BUFFER_u_char, BUFFER_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , size_t, BUFFER_length, BUFFER_HANDLE, handle);
+
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , BLEIO_GATT_HANDLE, BLEIO_gatt_create, const BLE_DEVICE_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLESchedulerMocks, , BLEIO_GATT_HANDLE, BLEIO_gatt_sim_create, const BLE_DEVICE_CONFIG*, config, const BLEIO_GATT_SIM_CONFIG*, sim_config);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLESchedulerMocks, , void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLESchedulerMocks, , int, BLEIO_gatt_connect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_CONNECT_COMPLETE, on_bleio_gatt_connect_complete, void*, callback_context);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLESchedulerMocks, , void, BLEIO_gatt_disconnect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_DISCONNECT_COMPLETE, on_bleio_gatt_disconnect_complete, void*, callback_context);
+DECLARE_GLOBAL_MOCK_METHOD_4(CBLESchedulerMocks, , int, BLEIO_gatt_read_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, ON_BLEIO_GATT_ATTRIB_READ_COMPLETE, on_bleio_gatt_attrib_read_complete, void*, callback_context);
+DECLARE_GLOBAL_MOCK_METHOD_6(CBLESchedulerMocks, , int, BLEIO_gatt_write_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, const unsigned char*, buffer, size_t, size, ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE, on_bleio_gatt_attrib_write_complete, void*, callback_context);
+
+/**
+ * Creates a scheduler with 'device_count' devices that each poll one
+ * characteristic every READ_INTERVAL_IN_MS milliseconds.
+ */
+static BLE_SCHEDULER_HANDLE create_scheduler_with_devices(size_t device_count, size_t max_connections, uint32_t min_connection_time_in_ms)
+{
+    BLE_SCHEDULER_CONFIG config = { max_connections, min_connection_time_in_ms, RETRY_INTERVAL_IN_MS };
+    BLE_SCHEDULER_HANDLE result = BLE_Scheduler_Create(&config, on_read_complete);
+    for (size_t i = 0; i < device_count; i++)
+    {
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_PERIODIC, READ_INTERVAL_IN_MS);
+        (void)BLE_Scheduler_AddDevice(result, &g_device_configs[i], instructions);
+    }
+
+    return result;
+}
+
+BEGIN_TEST_SUITE(ble_scheduler_ut)
+    TEST_SUITE_INITIALIZE(TestClassInitialize)
+    {
+        TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+        g_testByTest = MicroMockCreateMutex();
+        ASSERT_IS_NOT_NULL(g_testByTest);
+    }
+
+    TEST_SUITE_CLEANUP(TestClassCleanup)
+    {
+        MicroMockDestroyMutex(g_testByTest);
+        TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    }
+
+    TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+    {
+        if (!MicroMockAcquireMutex(g_testByTest))
+        {
+            ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+        }
+
+        g_fake_gatt_count = 0;
+        g_connect_succeeds = true;
+        g_defer_connects = false;
+        g_read_succeeds = true;
+        g_defer_reads = false;
+        g_drop_disconnects = false;
+        g_open_connections = 0;
+        g_max_open_connections = 0;
+        g_pending_connect_count = 0;
+        g_pending_read_count = 0;
+        memset(g_reads_by_device, 0, sizeof(g_reads_by_device));
+        g_failed_reads = 0;
+        g_was_destroy_complete_called = false;
+    }
+
+    TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+    {
+        if (!MicroMockReleaseMutex(g_testByTest))
+        {
+            ASSERT_FAIL("failure in test framework at ReleaseMutex");
+        }
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_001: [ BLE_Scheduler_Create shall return NULL if config or on_read_complete is NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_returns_NULL_for_NULL_config)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+
+        ///act
+        auto result = BLE_Scheduler_Create(NULL, on_read_complete);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_001: [ BLE_Scheduler_Create shall return NULL if config or on_read_complete is NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_returns_NULL_for_NULL_callback)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 1, 0, RETRY_INTERVAL_IN_MS };
+
+        ///act
+        auto result = BLE_Scheduler_Create(&config, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_002: [ BLE_Scheduler_Create shall return NULL if the max_connections or the retry_interval_in_ms field of config is zero. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_returns_NULL_when_max_connections_is_zero)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 0, 0, RETRY_INTERVAL_IN_MS };
+
+        ///act
+        auto result = BLE_Scheduler_Create(&config, on_read_complete);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_002: [ BLE_Scheduler_Create shall return NULL if the max_connections or the retry_interval_in_ms field of config is zero. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_returns_NULL_when_retry_interval_is_zero)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 1, 0, 0 };
+
+        ///act
+        auto result = BLE_Scheduler_Create(&config, on_read_complete);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_003: [ BLE_Scheduler_Create shall return NULL if any of the underlying platform calls fail. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_returns_NULL_when_malloc_fails)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 1, 0, RETRY_INTERVAL_IN_MS };
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((void*)NULL);
+
+        ///act
+        auto result = BLE_Scheduler_Create(&config, on_read_complete);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_003: [ BLE_Scheduler_Create shall return NULL if any of the underlying platform calls fail. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_returns_NULL_when_VECTOR_create_fails)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 1, 0, RETRY_INTERVAL_IN_MS };
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((VECTOR_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLE_Scheduler_Create(&config, on_read_complete);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_004: [ BLE_Scheduler_Create shall return a non-NULL handle on successful execution. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Create_succeeds)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 1, 0, RETRY_INTERVAL_IN_MS };
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLE_Scheduler_Create(&config, on_read_complete);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(result);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(result, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_005: [ BLE_Scheduler_AddDevice shall return a non-zero value if scheduler_handle, device_config or instructions is NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_returns_non_zero_for_NULL_inputs)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result1 = BLE_Scheduler_AddDevice(NULL, &g_device_configs[0], (VECTOR_HANDLE)0x42);
+        auto result2 = BLE_Scheduler_AddDevice(handle, NULL, (VECTOR_HANDLE)0x42);
+        auto result3 = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_NOT_EQUAL(int, 0, result1);
+        ASSERT_ARE_NOT_EQUAL(int, 0, result2);
+        ASSERT_ARE_NOT_EQUAL(int, 0, result3);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_006: [ BLE_Scheduler_AddDevice shall return a non-zero value if the vector instructions is empty. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_returns_non_zero_when_instructions_is_empty)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));
+
+        ///act
+        auto result = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+        ///cleanup
+        VECTOR_destroy(instructions);
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_007: [ BLE_Scheduler_AddDevice shall return a non-zero value if an instruction has a NULL or empty characteristic_uuid, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction with a NULL buffer or is a NOTIFY instruction. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_returns_non_zero_for_NOTIFY_instructions)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_ONCE, 0);
+        add_instruction(instructions, NOTIFY, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 0, g_fake_gatt_count);
+
+        ///cleanup
+        free_instructions(instructions);
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_007: [ BLE_Scheduler_AddDevice shall return a non-zero value if an instruction has a NULL or empty characteristic_uuid, is a READ_PERIODIC instruction with a zero interval_in_ms, is a write instruction with a NULL buffer or is a NOTIFY instruction. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_returns_non_zero_for_zero_interval)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_PERIODIC, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 0, g_fake_gatt_count);
+
+        ///cleanup
+        free_instructions(instructions);
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_009: [ BLE_Scheduler_AddDevice shall return a non-zero value if any of the underlying platform calls fail. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_returns_non_zero_when_BLEIO_gatt_create_fails)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_ONCE, 0);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // in BLE_Scheduler_AddDevice
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // in validate_instructions
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // instruction count
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_create(&g_device_configs[0]))
+            .SetFailReturn((BLEIO_GATT_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+        ///cleanup
+        free_instructions(instructions);
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_008: [ BLE_Scheduler_AddDevice shall create a GATT I/O handle for the device by calling BLEIO_gatt_create. ]*/
+    /*Tests_SRS_BLE_SCHEDULER_44_010: [ BLE_Scheduler_AddDevice shall take ownership of instructions and return zero when successful. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_succeeds)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_ONCE, 0);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // in BLE_Scheduler_AddDevice
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // in validate_instructions
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // instruction count
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_create(&g_device_configs[0]));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+
+        ///act
+        auto result = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_49_001: [ BLE_Scheduler_AddDevice shall create the GATT I/O handle by calling BLEIO_gatt_sim_create with the simulator field of the configuration instead if the use_simulator field is true. ]*/
+    TEST_FUNCTION(BLE_Scheduler_AddDevice_creates_simulated_device_when_configured)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        BLE_SCHEDULER_CONFIG config = { 1, 0, RETRY_INTERVAL_IN_MS, true, { 10, 5, 0.0, 0.0, 1000, 4 } };
+        auto handle = BLE_Scheduler_Create(&config, on_read_complete);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_ONCE, 0);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // in BLE_Scheduler_AddDevice
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // in validate_instructions
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+        STRICT_EXPECTED_CALL(mocks, STRING_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions)); // instruction count
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_sim_create(&g_device_configs[0], IGNORED_PTR_ARG))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+
+        ///act
+        auto result = BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, 0, result);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_011: [ BLE_Scheduler_Tick shall do nothing if scheduler_handle is NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_does_nothing_for_NULL_input)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+
+        ///act
+        BLE_Scheduler_Tick(NULL, 0);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_012: [ BLE_Scheduler_Tick shall start the I/O operations that are due on every connected device; READ_ONCE and WRITE_ONCE instructions are executed once and READ_PERIODIC instructions every interval_in_ms milliseconds. ]*/
+    /*Tests_SRS_BLE_SCHEDULER_44_017: [ The scheduler shall execute the WRITE_AT_INIT instructions of a device every time it connects to it, followed by the I/O operations that are due. ]*/
+    /*Tests_SRS_BLE_SCHEDULER_44_018: [ When a read completes the scheduler shall invoke on_read_complete passing in the configuration of the device, the context, characteristic UUID and type of the instruction, the status of the operation and the data that was read. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_runs_the_instructions_that_are_due)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(0, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, WRITE_AT_INIT, 0);
+        add_instruction(instructions, READ_ONCE, 0);
+        add_instruction(instructions, READ_PERIODIC, READ_INTERVAL_IN_MS);
+        (void)BLE_Scheduler_AddDevice(handle, &g_device_configs[0], instructions);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        BLE_Scheduler_Tick(handle, READ_INTERVAL_IN_MS / 2);
+        BLE_Scheduler_Tick(handle, READ_INTERVAL_IN_MS);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].connects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].writes);
+        ASSERT_ARE_EQUAL(size_t, 3, g_fake_gatts[0].reads);
+        ASSERT_ARE_EQUAL(size_t, 3, g_reads_by_device[0]);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_013: [ BLE_Scheduler_Tick shall connect to the devices that have I/O operations due, the one that has been due the longest first, as long as fewer than max_connections connections are open. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_does_not_open_more_than_max_connections)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(3, 2, 0);
+        g_defer_connects = true;
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 2, g_pending_connect_count);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].connects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[1].connects);
+        ASSERT_ARE_EQUAL(size_t, 0, g_fake_gatts[2].connects);
+
+        ///cleanup
+        complete_pending_connects();
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_015: [ BLE_Scheduler_Tick shall not disconnect a device unless another device is waiting for a connection. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_keeps_devices_connected_when_nobody_waits)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(2, 2, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        for (uint64_t now = 0; now <= 5 * READ_INTERVAL_IN_MS; now += READ_INTERVAL_IN_MS / 2)
+        {
+            BLE_Scheduler_Tick(handle, now);
+        }
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].connects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[1].connects);
+        ASSERT_ARE_EQUAL(size_t, 0, g_fake_gatts[0].disconnects);
+        ASSERT_ARE_EQUAL(size_t, 0, g_fake_gatts[1].disconnects);
+        ASSERT_ARE_EQUAL(size_t, 6, g_reads_by_device[0]);
+        ASSERT_ARE_EQUAL(size_t, 6, g_reads_by_device[1]);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_014: [ When max_connections connections are open and a device is waiting for a connection, BLE_Scheduler_Tick shall disconnect the connected device that has no I/O operations in flight or due, has been connected for at least min_connection_time_in_ms milliseconds and has the latest next I/O operation. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_time_slices_the_connections)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(3, 1, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        BLE_Scheduler_Tick(handle, READ_INTERVAL_IN_MS);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_max_open_connections);
+        for (size_t i = 0; i < 3; i++)
+        {
+            ASSERT_ARE_EQUAL(size_t, 2, g_reads_by_device[i]);
+        }
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_014: [ When max_connections connections are open and a device is waiting for a connection, BLE_Scheduler_Tick shall disconnect the connected device that has no I/O operations in flight or due, has been connected for at least min_connection_time_in_ms milliseconds and has the latest next I/O operation. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_keeps_a_device_connected_for_min_connection_time)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(2, 1, 5000);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        BLE_Scheduler_Tick(handle, 4999);
+        size_t disconnects_before = g_fake_gatts[0].disconnects;
+        BLE_Scheduler_Tick(handle, 5000);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, disconnects_before);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].disconnects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[1].connects);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_020: [ The scheduler shall execute the WRITE_AT_EXIT instructions of a device every time before it disconnects from it. ]*/
+    TEST_FUNCTION(BLE_Scheduler_runs_WRITE_AT_EXIT_before_every_disconnect)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(1, 1, 0);
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        add_instruction(instructions, READ_PERIODIC, READ_INTERVAL_IN_MS);
+        add_instruction(instructions, WRITE_AT_EXIT, 0);
+        (void)BLE_Scheduler_AddDevice(handle, &g_device_configs[1], instructions);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        BLE_Scheduler_Tick(handle, READ_INTERVAL_IN_MS);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[1].disconnects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[1].writes);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_016: [ If connecting to a device fails then the scheduler shall not attempt to connect to it again for retry_interval_in_ms milliseconds. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_retries_a_failed_connect_after_the_retry_interval)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(1, 1, 0);
+        g_connect_succeeds = false;
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        BLE_Scheduler_Tick(handle, RETRY_INTERVAL_IN_MS - 1);
+        size_t connects_before = g_fake_gatts[0].connects;
+        g_connect_succeeds = true;
+        BLE_Scheduler_Tick(handle, RETRY_INTERVAL_IN_MS);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, connects_before);
+        ASSERT_ARE_EQUAL(size_t, 2, g_fake_gatts[0].connects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_reads_by_device[0]);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_024: [ BLE_Scheduler_Tick shall consider a device disconnected when BLEIO_gatt_disconnect has not called back within BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS milliseconds, even after BLE_Scheduler_Destroy has been called. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Tick_gives_up_on_a_disconnect_that_does_not_complete)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(2, 1, 0);
+        g_drop_disconnects = true;
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        BLE_Scheduler_Tick(handle, BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS - 1);
+        size_t connects_before = g_fake_gatts[1].connects;
+        BLE_Scheduler_Tick(handle, BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].disconnects);
+        ASSERT_ARE_EQUAL(size_t, 0, connects_before);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[1].connects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_reads_by_device[1]);
+
+        ///cleanup
+        g_drop_disconnects = false;
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_019: [ If an I/O operation on a device fails then the scheduler shall disconnect the device once the I/O operations in flight complete and shall not connect to it again for retry_interval_in_ms milliseconds. ]*/
+    TEST_FUNCTION(BLE_Scheduler_disconnects_a_device_when_a_read_fails)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(1, 1, 0);
+        g_read_succeeds = false;
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Tick(handle, 0);
+        size_t disconnects = g_fake_gatts[0].disconnects;
+        g_read_succeeds = true;
+        BLE_Scheduler_Tick(handle, READ_INTERVAL_IN_MS);
+        size_t connects_before_retry = g_fake_gatts[0].connects;
+        BLE_Scheduler_Tick(handle, RETRY_INTERVAL_IN_MS);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_failed_reads);
+        ASSERT_ARE_EQUAL(size_t, 1, disconnects);
+        ASSERT_ARE_EQUAL(size_t, 1, connects_before_retry);
+        ASSERT_ARE_EQUAL(size_t, 2, g_fake_gatts[0].connects);
+        ASSERT_ARE_EQUAL(size_t, 1, g_reads_by_device[0]);
+
+        ///cleanup
+        BLE_Scheduler_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_021: [ BLE_Scheduler_Destroy shall do nothing if scheduler_handle is NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Destroy_does_nothing_for_NULL_input)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+
+        ///act
+        BLE_Scheduler_Destroy(NULL, on_destroy_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_FALSE(g_was_destroy_complete_called);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_022: [ BLE_Scheduler_Destroy shall disconnect all the connected devices, destroy their GATT I/O handles and free all resources before invoking on_destroy_complete if it is not NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Destroy_disconnects_and_frees_the_devices)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(2, 2, 0);
+        BLE_Scheduler_Tick(handle, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Destroy(handle, on_destroy_complete, NULL);
+
+        ///assert
+        ASSERT_IS_TRUE(g_was_destroy_complete_called);
+        ASSERT_ARE_EQUAL(size_t, 0, g_open_connections);
+        for (size_t i = 0; i < 2; i++)
+        {
+            ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[i].disconnects);
+            ASSERT_IS_TRUE(g_fake_gatts[i].is_destroyed);
+        }
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_022: [ BLE_Scheduler_Destroy shall disconnect all the connected devices, destroy their GATT I/O handles and free all resources before invoking on_destroy_complete if it is not NULL. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Destroy_waits_for_connects_in_progress)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(1, 1, 0);
+        g_defer_connects = true;
+        BLE_Scheduler_Tick(handle, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Destroy(handle, on_destroy_complete, NULL);
+        bool was_called_before_connect = g_was_destroy_complete_called;
+        complete_pending_connects();
+
+        ///assert
+        ASSERT_IS_FALSE(was_called_before_connect);
+        ASSERT_IS_TRUE(g_was_destroy_complete_called);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].disconnects);
+        ASSERT_ARE_EQUAL(size_t, 0, g_fake_gatts[0].reads);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_023: [ Reads that complete after BLE_Scheduler_Destroy has been called shall be dropped. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Destroy_drops_reads_in_flight)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(1, 1, 0);
+        g_defer_reads = true;
+        BLE_Scheduler_Tick(handle, 0);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Destroy(handle, on_destroy_complete, NULL);
+        bool was_called_before_read = g_was_destroy_complete_called;
+        complete_pending_reads();
+
+        ///assert
+        ASSERT_IS_FALSE(was_called_before_read);
+        ASSERT_IS_TRUE(g_was_destroy_complete_called);
+        ASSERT_ARE_EQUAL(size_t, 0, g_reads_by_device[0]);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].disconnects);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_SCHEDULER_44_024: [ BLE_Scheduler_Tick shall consider a device disconnected when BLEIO_gatt_disconnect has not called back within BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS milliseconds, even after BLE_Scheduler_Destroy has been called. ]*/
+    TEST_FUNCTION(BLE_Scheduler_Destroy_completes_when_a_disconnect_times_out)
+    {
+        ///arrange
+        CBLESchedulerMocks mocks;
+        auto handle = create_scheduler_with_devices(1, 1, 0);
+        BLE_Scheduler_Tick(handle, 0);
+        g_drop_disconnects = true;
+        mocks.ResetAllCalls();
+
+        ///act
+        BLE_Scheduler_Destroy(handle, on_destroy_complete, NULL);
+        BLE_Scheduler_Tick(handle, BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS - 1);
+        bool was_called_before_timeout = g_was_destroy_complete_called;
+        BLE_Scheduler_Tick(handle, BLE_SCHEDULER_DISCONNECT_TIMEOUT_IN_MS);
+
+        ///assert
+        ASSERT_IS_FALSE(was_called_before_timeout);
+        ASSERT_IS_TRUE(g_was_destroy_complete_called);
+        ASSERT_ARE_EQUAL(size_t, 1, g_fake_gatts[0].disconnects);
+        ASSERT_IS_TRUE(g_fake_gatts[0].is_destroyed);
+
+        ///cleanup
+    }
+
+END_TEST_SUITE(ble_scheduler_ut)
@@ -23,10 +23,12 @@
 #include "azure_c_shared_utility/buffer_.h"
 #include "azure_c_shared_utility/strings.h"
 #include "azure_c_shared_utility/threadapi.h"
+#include "module_thread.h"
 #include "message.h"
 #include "broker.h"
 #include "ble_gatt_io.h"
 #include "bleio_seq.h"
+#include "ble_scheduler.h"
 #include "messageproperties.h"
 #include "ble.h"
 #include "module_access.h"
@@ -101,7 +103,6 @@ extern "C"
 {
     extern time_t gb_time(time_t *timer);
     extern struct tm* gb_localtime(const time_t *timer);
-    extern size_t gb_strftime(char * s, size_t maxsize, const char * format, const struct tm * timeptr);
 
     typedef union json_value_value {
         char        *string;
@@ -120,8 +121,6 @@ extern "C"
 }
 #endif
 
-#define TIME_IN_STRFTIME "time"
-
 namespace BASEIMPLEMENTATION
 {
     /*if malloc is defined as gballoc_malloc at this moment, there'd be serious trouble*/
@@ -174,11 +173,75 @@ namespace BASEIMPLEMENTATION
 static bool g_call_on_read_complete = false;
 static BLEIO_SEQ_RESULT g_read_result = BLEIO_SEQ_OK;
 
-static bool shouldThreadAPI_Create_invoke_callback = false;
+// have CBLEIOSequence::run complete a read for every instruction instead of
+// only the first one
+static bool g_read_all_instructions = false;
+
+static bool shouldModuleThread_Create_invoke_callback = false;
 static bool should_g_main_loop_quit_call_thread_func = false;
 static THREAD_START_FUNC thread_start_func = NULL;
 static void* thread_func_arg = NULL;
 
+// have the parson mocks describe a fleet of devices instead of a single one
+static bool g_parse_fleet = false;
+static bool g_fleet_uses_templates = false;
+
+// what the parson mocks report for the type and read group of an instruction
+static const char* g_instruction_type = "read_once";
+static const char* g_read_group = NULL;
+
+// what the parson mocks report for the max_queued_writes property
+static double g_max_queued_writes = 0;
+
+// what the parson mocks report for the simulator object; the numbers it
+// holds are chosen to exercise the clamping and the defaults
+static JSON_Object* g_simulator = NULL;
+
+// the timer that drives the scheduler of a fleet
+static GSourceFunc g_timeout_function = NULL;
+static gpointer g_timeout_data = NULL;
+
+static char g_published_mac_address[18] = "";
+static char g_published_timestamp[25] = "";
+static char g_published_read_group[32] = "";
+static char g_published_content[128] = "";
+static size_t g_publish_count = 0;
+
+// what localtime reports and how often it was asked
+static struct tm g_fake_local_time;
+static size_t g_localtime_call_count = 0;
+
+// how often the module created a map of message properties
+static size_t g_map_create_call_count = 0;
+
+static void free_bleioseq_instructions(VECTOR_HANDLE instructions)
+{
+    for (size_t i = 0, len = VECTOR_size(instructions); i < len; i++)
+    {
+        BLEIO_SEQ_INSTRUCTION *instruction = (BLEIO_SEQ_INSTRUCTION *)VECTOR_element(instructions, i);
+        if (instruction->characteristic_uuid != NULL)
+        {
+            STRING_delete(instruction->characteristic_uuid);
+        }
+        if (
+            (
+                instruction->instruction_type == WRITE_AT_INIT ||
+                instruction->instruction_type == WRITE_ONCE ||
+                instruction->instruction_type == WRITE_AT_EXIT
+            )
+            &&
+            (
+                instruction->data.buffer != NULL
+            )
+          )
+        {
+            BUFFER_delete(instruction->data.buffer);
+        }
+    }
+
+    VECTOR_destroy(instructions);
+}
+
 class CBLEIOSequence
 {
 public:
@@ -209,30 +272,7 @@ public:
 
         if (_instructions != NULL)
         {
-            for (size_t i = 0, len = VECTOR_size(_instructions); i < len; i++)
-            {
-                BLEIO_SEQ_INSTRUCTION *instruction = (BLEIO_SEQ_INSTRUCTION *)VECTOR_element(_instructions, i);
-                if (instruction->characteristic_uuid != NULL)
-                {
-                    STRING_delete(instruction->characteristic_uuid);
-                }
-                if (
-                    (
-                        instruction->instruction_type == WRITE_AT_INIT ||
-                        instruction->instruction_type == WRITE_ONCE ||
-                        instruction->instruction_type == WRITE_AT_EXIT
-                    )
-                    &&
-                    (
-                        instruction->data.buffer != NULL
-                    )
-                  )
-                {
-                    BUFFER_delete(instruction->data.buffer);
-                }
-            }
-
-            VECTOR_destroy(_instructions);
+            free_bleioseq_instructions(_instructions);
         }
     }
 
@@ -241,29 +281,128 @@ public:
         size_t len = VECTOR_size(_instructions);
         if (g_call_on_read_complete && _on_read_complete != NULL && len > 0)
         {
-            BLEIO_SEQ_INSTRUCTION* instr = (BLEIO_SEQ_INSTRUCTION*)VECTOR_element(_instructions, 0);
+            size_t count = g_read_all_instructions ? len : 1;
+            for (size_t i = 0; i < count; i++)
+            {
+                BLEIO_SEQ_INSTRUCTION* instr = (BLEIO_SEQ_INSTRUCTION*)VECTOR_element(_instructions, i);
+                unsigned char fake_data[] = "data";
+                size_t data_size = sizeof(fake_data) / sizeof(fake_data[0]);
+
+                _on_read_complete(
+                    (BLEIO_SEQ_HANDLE)this,
+                    instr->context,
+                    STRING_c_str(instr->characteristic_uuid),
+                    instr->instruction_type,
+                    g_read_result,
+                    BUFFER_create(fake_data, data_size)
+                );
+            }
+        }
+
+        return g_read_result;
+    }
+
+    BLEIO_SEQ_RESULT add_instruction(BLEIO_SEQ_INSTRUCTION* instruction)
+    {
+        (void)instruction;
+        return BLEIO_SEQ_OK;
+    }
+};
+
+#define MAX_FAKE_FLEET_DEVICES  4
+
+class CBLEScheduler
+{
+public:
+    ON_BLE_SCHEDULER_READ_COMPLETE _on_read_complete;
+    BLE_DEVICE_CONFIG _device_configs[MAX_FAKE_FLEET_DEVICES];
+    VECTOR_HANDLE _instructions[MAX_FAKE_FLEET_DEVICES];
+    size_t _device_count;
+
+public:
+    CBLEScheduler(ON_BLE_SCHEDULER_READ_COMPLETE on_read_complete) :
+        _on_read_complete(on_read_complete),
+        _device_count(0)
+    {}
+
+    ~CBLEScheduler()
+    {
+        for (size_t i = 0; i < _device_count; i++)
+        {
+            free_bleioseq_instructions(_instructions[i]);
+        }
+    }
+
+    int add_device(const BLE_DEVICE_CONFIG* device_config, VECTOR_HANDLE instructions)
+    {
+        int result;
+        if (_device_count == MAX_FAKE_FLEET_DEVICES)
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            _device_configs[_device_count] = *device_config;
+            _instructions[_device_count] = instructions;
+            _device_count++;
+            result = 0;
+        }
+
+        return result;
+    }
+
+    void tick()
+    {
+        // report a read on the last device so that tests can tell it
+        // apart from the first one
+        if (g_call_on_read_complete && _on_read_complete != NULL && _device_count > 0)
+        {
+            size_t last = _device_count - 1;
+            BLEIO_SEQ_INSTRUCTION* instr = (BLEIO_SEQ_INSTRUCTION*)VECTOR_element(_instructions[last], 0);
             unsigned char fake_data[] = "data";
             size_t data_size = sizeof(fake_data) / sizeof(fake_data[0]);
 
             _on_read_complete(
-                (BLEIO_SEQ_HANDLE)this,
+                (BLE_SCHEDULER_HANDLE)this,
                 instr->context,
+                &(_device_configs[last]),
                 STRING_c_str(instr->characteristic_uuid),
                 instr->instruction_type,
                 g_read_result,
                 BUFFER_create(fake_data, data_size)
             );
         }
+    }
+};
 
-        return g_read_result;
+static VECTOR_HANDLE create_fake_fleet(size_t device_count, BLE_INSTRUCTION* instruction)
+{
+    // every device gets its own vector with a copy of the same instruction
+    VECTOR_HANDLE devices = VECTOR_create(sizeof(BLE_FLEET_DEVICE));
+    for (size_t i = 0; i < device_count; i++)
+    {
+        BLE_FLEET_DEVICE device =
+        {
+            { { (uint8_t)(0xA0 + i), 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            VECTOR_create(sizeof(BLE_INSTRUCTION))
+        };
+        VECTOR_push_back(device.instructions, instruction, 1);
+        VECTOR_push_back(devices, &device, 1);
     }
 
-    BLEIO_SEQ_RESULT add_instruction(BLEIO_SEQ_INSTRUCTION* instruction)
+    return devices;
+}
+
+static void destroy_fake_fleet(VECTOR_HANDLE devices)
+{
+    for (size_t i = 0, len = VECTOR_size(devices); i < len; i++)
     {
-        (void)instruction;
-        return BLEIO_SEQ_OK;
+        BLE_FLEET_DEVICE* device = (BLE_FLEET_DEVICE*)VECTOR_element(devices, i);
+        VECTOR_destroy(device->instructions);
     }
-};
+
+    VECTOR_destroy(devices);
+}
 
 TYPED_MOCK_CLASS(CBLEMocks, CGlobalMock)
 {
@@ -329,6 +468,10 @@ public:
         auto result2 = BASEIMPLEMENTATION::BUFFER_create((const unsigned char*)"abc", 3);
     MOCK_METHOD_END(BUFFER_HANDLE, result2)
 
+    MOCK_STATIC_METHOD_2(, STRING_HANDLE, Base64_Encode_Bytes, const unsigned char*, source, size_t, size)
+        auto result2 = BASEIMPLEMENTATION::STRING_construct("ZGF0YQA=");
+    MOCK_METHOD_END(STRING_HANDLE, result2)
+
     MOCK_STATIC_METHOD_1(, MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg)
         MESSAGE_HANDLE result2 = BASEIMPLEMENTATION::Message_Create(cfg);
     MOCK_METHOD_END(MESSAGE_HANDLE, result2)
@@ -392,6 +535,10 @@ public:
     MOCK_STATIC_METHOD_1(, BLEIO_GATT_HANDLE, BLEIO_gatt_create, const BLE_DEVICE_CONFIG*, config)
         auto result2 = (BLEIO_GATT_HANDLE)malloc(1);
     MOCK_METHOD_END(BLEIO_GATT_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_2(, BLEIO_GATT_HANDLE, BLEIO_gatt_sim_create, const BLE_DEVICE_CONFIG*, config, const BLEIO_GATT_SIM_CONFIG*, sim_config)
+        auto result2 = (BLEIO_GATT_HANDLE)malloc(1);
+    MOCK_METHOD_END(BLEIO_GATT_HANDLE, result2)
     
     MOCK_STATIC_METHOD_1(, void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle)
         free(bleio_gatt_handle);
@@ -426,6 +573,26 @@ public:
         delete (CBLEIOSequence*)bleio_seq_handle;
     MOCK_VOID_METHOD_END()
     
+    MOCK_STATIC_METHOD_2(, BLE_SCHEDULER_HANDLE, BLE_Scheduler_Create, const BLE_SCHEDULER_CONFIG*, config, ON_BLE_SCHEDULER_READ_COMPLETE, on_read_complete)
+        auto result2 = (BLE_SCHEDULER_HANDLE)new CBLEScheduler(on_read_complete);
+    MOCK_METHOD_END(BLE_SCHEDULER_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_3(, int, BLE_Scheduler_AddDevice, BLE_SCHEDULER_HANDLE, scheduler_handle, const BLE_DEVICE_CONFIG*, device_config, VECTOR_HANDLE, instructions)
+        auto result2 = ((CBLEScheduler*)scheduler_handle)->add_device(device_config, instructions);
+    MOCK_METHOD_END(int, result2)
+
+    MOCK_STATIC_METHOD_2(, void, BLE_Scheduler_Tick, BLE_SCHEDULER_HANDLE, scheduler_handle, uint64_t, now_in_ms)
+        ((CBLEScheduler*)scheduler_handle)->tick();
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_3(, void, BLE_Scheduler_Destroy, BLE_SCHEDULER_HANDLE, scheduler_handle, ON_BLE_SCHEDULER_DESTROY_COMPLETE, on_destroy_complete, void*, context)
+        delete (CBLEScheduler*)scheduler_handle;
+        if (on_destroy_complete != NULL)
+        {
+            on_destroy_complete(scheduler_handle, context);
+        }
+    MOCK_VOID_METHOD_END()
+
     MOCK_STATIC_METHOD_2(, BLEIO_SEQ_RESULT, BLEIO_Seq_AddInstruction, BLEIO_SEQ_HANDLE, bleio_seq_handle, BLEIO_SEQ_INSTRUCTION*, instruction)
         CBLEIOSequence* seq = (CBLEIOSequence*)bleio_seq_handle;
         auto result2 = seq->add_instruction(instruction);
@@ -435,8 +602,39 @@ public:
         CBLEIOSequence* seq = (CBLEIOSequence*)bleio_seq_handle;
         auto result2 = seq->run();
     MOCK_METHOD_END(BLEIO_SEQ_RESULT, result2)
+
+    MOCK_STATIC_METHOD_2(, BLEIO_SEQ_RESULT, BLEIO_Seq_SetWriteQueueConfig, BLEIO_SEQ_HANDLE, bleio_seq_handle, const BLEIO_SEQ_WRITE_QUEUE_CONFIG*, config)
+        auto result2 = BLEIO_SEQ_OK;
+    MOCK_METHOD_END(BLEIO_SEQ_RESULT, result2)
     
     MOCK_STATIC_METHOD_3(, BROKER_RESULT, Broker_Publish, BROKER_HANDLE, broker, MODULE_HANDLE, source, MESSAGE_HANDLE, message)
+        if (message != NULL)
+        {
+            CONSTMAP_HANDLE properties = BASEIMPLEMENTATION::Message_GetProperties(message);
+            const char* mac_address = BASEIMPLEMENTATION::ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY);
+            if (mac_address != NULL && strlen(mac_address) < sizeof(g_published_mac_address))
+            {
+                strcpy(g_published_mac_address, mac_address);
+            }
+            const char* timestamp = BASEIMPLEMENTATION::ConstMap_GetValue(properties, GW_TIMESTAMP_PROPERTY);
+            if (timestamp != NULL && strlen(timestamp) < sizeof(g_published_timestamp))
+            {
+                strcpy(g_published_timestamp, timestamp);
+            }
+            const char* read_group = BASEIMPLEMENTATION::ConstMap_GetValue(properties, GW_READ_GROUP_PROPERTY);
+            if (read_group != NULL && strlen(read_group) < sizeof(g_published_read_group))
+            {
+                strcpy(g_published_read_group, read_group);
+            }
+            const CONSTBUFFER* content = BASEIMPLEMENTATION::Message_GetContent(message);
+            if (content != NULL && content->size < sizeof(g_published_content))
+            {
+                memcpy(g_published_content, content->buffer, content->size);
+                g_published_content[content->size] = '\0';
+            }
+            BASEIMPLEMENTATION::ConstMap_Destroy(properties);
+            g_publish_count++;
+        }
         auto result2 = BROKER_OK;
     MOCK_METHOD_END(BROKER_RESULT, result2)
     
@@ -497,12 +695,17 @@ public:
     MOCK_METHOD_END(MAP_RESULT, result2);
     
     MOCK_STATIC_METHOD_1(, MAP_HANDLE, Map_Create, MAP_FILTER_CALLBACK, mapFilterFunc)
+        g_map_create_call_count++;
         auto result2 = BASEIMPLEMENTATION::Map_Create(mapFilterFunc);
     MOCK_METHOD_END(MAP_HANDLE, result2)
     
     MOCK_STATIC_METHOD_3(, MAP_RESULT, Map_Add, MAP_HANDLE, handle, const char*, key, const char*, value)
         auto result2 = BASEIMPLEMENTATION::Map_Add(handle, key, value);
     MOCK_METHOD_END(MAP_RESULT, result2)
+
+    MOCK_STATIC_METHOD_3(, MAP_RESULT, Map_AddOrUpdate, MAP_HANDLE, handle, const char*, key, const char*, value)
+        auto result2 = BASEIMPLEMENTATION::Map_AddOrUpdate(handle, key, value);
+    MOCK_METHOD_END(MAP_RESULT, result2)
     
     MOCK_STATIC_METHOD_2(, int, mallocAndStrcpy_s, char**, destination, const char*, source)
         auto result2 = BASEIMPLEMENTATION::mallocAndStrcpy_s(destination, source);
@@ -524,11 +727,11 @@ public:
         auto result2 = BASEIMPLEMENTATION::STRING_concat_with_STRING(s1, s2);
     MOCK_METHOD_END(int, result2);
 
-    MOCK_STATIC_METHOD_3(, THREADAPI_RESULT, ThreadAPI_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
+    MOCK_STATIC_METHOD_3(, THREADAPI_RESULT, ModuleThread_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
         THREADAPI_RESULT result2 = THREADAPI_OK;
         thread_start_func = func;
         thread_func_arg = arg;
-        if (shouldThreadAPI_Create_invoke_callback == true)
+        if (shouldModuleThread_Create_invoke_callback == true)
         {
             func(arg);
         }
@@ -543,19 +746,10 @@ public:
     MOCK_METHOD_END(time_t, result2);
 
     MOCK_STATIC_METHOD_1(, struct tm*, gb_localtime, const time_t *, timer)
-        struct tm* result2 = (struct tm*)0x42;
+        g_localtime_call_count++;
+        struct tm* result2 = &g_fake_local_time;
     MOCK_METHOD_END(struct tm*, result2);
 
-    MOCK_STATIC_METHOD_4(, size_t, gb_strftime, char*, s, size_t, maxsize, const char *, format, const struct tm *, timeptr)
-        if (maxsize < strlen(TIME_IN_STRFTIME) + 1)
-        {
-            ASSERT_FAIL("what is this puny message size!");
-        }
-        else
-        {
-            strcpy(s, TIME_IN_STRFTIME);
-        }
-    MOCK_METHOD_END(size_t, maxsize);
 
     MOCK_STATIC_METHOD_0(, gint64, g_get_monotonic_time)
         gint64 result2 = 1;
@@ -594,6 +788,24 @@ public:
         gboolean result2 = TRUE;
     MOCK_METHOD_END(gboolean, result2);
 
+    MOCK_STATIC_METHOD_3(, guint, g_timeout_add, guint, interval, GSourceFunc, function, gpointer, data)
+        g_timeout_function = function;
+        g_timeout_data = data;
+        guint result2 = 1;
+    MOCK_METHOD_END(guint, result2);
+
+    MOCK_STATIC_METHOD_1(, gboolean, g_source_remove, guint, tag)
+        g_timeout_function = NULL;
+        g_timeout_data = NULL;
+        gboolean result2 = TRUE;
+    MOCK_METHOD_END(gboolean, result2);
+
+    MOCK_STATIC_METHOD_2(, guint, g_idle_add, GSourceFunc, function, gpointer, data)
+        // run the function right away as if the loop had picked it up
+        (void)function(data);
+        guint result2 = 2;
+    MOCK_METHOD_END(guint, result2);
+
     /*Parson Mocks*/
     MOCK_STATIC_METHOD_1(, JSON_Value*, json_parse_string, const char *, filename)
         JSON_Value* value = NULL;
@@ -613,13 +825,41 @@ public:
 
     MOCK_STATIC_METHOD_2(, double, json_object_get_number, const JSON_Object *, object, const char *, name)
         double result2 = 0;
+        if (name != NULL && strcmp(name, "max_queued_writes") == 0)
+        {
+            result2 = g_max_queued_writes;
+        }
+        else if (object != NULL && object == g_simulator)
+        {
+            if (strcmp(name, "latency_in_ms") == 0)
+            {
+                result2 = 20;
+            }
+            else if (strcmp(name, "jitter_in_ms") == 0)
+            {
+                result2 = 5;
+            }
+            else if (strcmp(name, "connect_failure_rate") == 0)
+            {
+                result2 = -1;
+            }
+            else if (strcmp(name, "io_failure_rate") == 0)
+            {
+                result2 = 0.25;
+            }
+        }
     MOCK_METHOD_END(double, result2);
 
     MOCK_STATIC_METHOD_2(, const char*, json_object_get_string, const JSON_Object*, object, const char*, name)
         const char* result2;
         if(strcmp(name, "device_mac_address") == 0)
         {
-            result2 = "AA:BB:CC:DD:EE:FF";
+            // the root object of a fleet has no MAC address, its devices do
+            result2 = (g_parse_fleet && object == (JSON_Object*)0x42) ? NULL : "AA:BB:CC:DD:EE:FF";
+        }
+        else if(strcmp(name, "template") == 0)
+        {
+            result2 = "sensor_tag";
         }
         else if(strcmp(name, "data") == 0)
         {
@@ -627,7 +867,11 @@ public:
         }
         else if(strcmp(name, "type") == 0)
         {
-            result2 = "read_once";
+            result2 = g_instruction_type;
+        }
+        else if(strcmp(name, "read_group") == 0)
+        {
+            result2 = g_read_group;
         }
         else if(strcmp(name, "characteristic_uuid") == 0)
         {
@@ -641,17 +885,30 @@ public:
     
     MOCK_STATIC_METHOD_2(, JSON_Array*, json_object_get_array, const JSON_Object*, object, const char*, name)
         JSON_Array* arr = NULL;
-        if (object != NULL && name != NULL)
+        if (
+            object != NULL && name != NULL &&
+            !(g_fleet_uses_templates && object == (JSON_Object*)0x43 && strcmp(name, "instructions") == 0)
+           )
         {
             arr = (JSON_Array*)0x42;
         }
     MOCK_METHOD_END(JSON_Array*, arr);
 
+    MOCK_STATIC_METHOD_2(, JSON_Object*, json_object_get_object, const JSON_Object*, object, const char*, name)
+        JSON_Object* result2 = NULL;
+        if (object != NULL && name != NULL)
+        {
+            result2 = (strcmp(name, "simulator") == 0) ? g_simulator : (JSON_Object*)0x44;
+        }
+    MOCK_METHOD_END(JSON_Object*, result2);
+
     MOCK_STATIC_METHOD_2(, JSON_Object*, json_array_get_object, const JSON_Array*, arr, size_t, index)
         JSON_Object* object = NULL;
         if (arr != NULL)
         {
-            object = (JSON_Object*)0x42;
+            // the devices and instructions of a fleet are told apart from
+            // its root object by their address
+            object = g_parse_fleet ? (JSON_Object*)0x43 : (JSON_Object*)0x42;
         }
     MOCK_METHOD_END(JSON_Object*, object);
 
@@ -689,6 +946,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , CONSTBUFFER_HANDLE, CONSTBUFFER_Create
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , const CONSTBUFFER*, CONSTBUFFER_GetContent, CONSTBUFFER_HANDLE, constbufferHandle);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , BUFFER_HANDLE, Base64_Decoder, const char*, source);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , STRING_HANDLE, Base64_Encode_Bytes, const unsigned char*, source, size_t, size);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , CONSTMAP_HANDLE, ConstMap_Create, MAP_HANDLE, sourceMap);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, ConstMap_Destroy, CONSTMAP_HANDLE, handle);
@@ -707,10 +965,11 @@ DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , MAP_RESULT, Map_ContainsValue, MAP_HAN
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , const char*, Map_GetValueFromKey, MAP_HANDLE, ptr, const char*, key);
 DECLARE_GLOBAL_MOCK_METHOD_4(CBLEMocks, , MAP_RESULT, Map_GetInternals, MAP_HANDLE, handle, const char*const**, keys, const char*const**, values, size_t*, count);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , MAP_RESULT, Map_Add, MAP_HANDLE, handle, const char*, key, const char*, value);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , MAP_RESULT, Map_AddOrUpdate, MAP_HANDLE, handle, const char*, key, const char*, value);
 
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , int, mallocAndStrcpy_s, char**, destination, const char*, source)
 
-DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , THREADAPI_RESULT, ThreadAPI_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , THREADAPI_RESULT, ModuleThread_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , THREADAPI_RESULT, ThreadAPI_Join, THREAD_HANDLE, threadHandle, int*, res);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , MESSAGE_HANDLE, Message_Create, const MESSAGE_CONFIG*, cfg);
@@ -730,6 +989,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , BUFFER_HANDLE, BUFFER_clone, BUFFER_HA
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, STRING_delete, STRING_HANDLE, handle);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , BLEIO_GATT_HANDLE, BLEIO_gatt_create, const BLE_DEVICE_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLEIO_GATT_HANDLE, BLEIO_gatt_sim_create, const BLE_DEVICE_CONFIG*, config, const BLEIO_GATT_SIM_CONFIG*, sim_config);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , int, BLEIO_gatt_connect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_CONNECT_COMPLETE, on_bleio_gatt_connect_complete, void*, callback_context);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , void, BLEIO_gatt_disconnect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_DISCONNECT_COMPLETE, on_bleio_gatt_disconnect_complete, void*, callback_context);
@@ -738,12 +998,17 @@ DECLARE_GLOBAL_MOCK_METHOD_4(CBLEMocks, , BLEIO_SEQ_HANDLE, BLEIO_Seq_Create, BL
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , void, BLEIO_Seq_Destroy, BLEIO_SEQ_HANDLE, bleio_seq_handle, ON_BLEIO_SEQ_DESTROY_COMPLETE, on_destroy_complete, void*, context);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , BLEIO_SEQ_RESULT, BLEIO_Seq_Run, BLEIO_SEQ_HANDLE, bleio_seq_handle);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLEIO_SEQ_RESULT, BLEIO_Seq_AddInstruction, BLEIO_SEQ_HANDLE, bleio_seq_handle, BLEIO_SEQ_INSTRUCTION*, instruction);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLEIO_SEQ_RESULT, BLEIO_Seq_SetWriteQueueConfig, BLEIO_SEQ_HANDLE, bleio_seq_handle, const BLEIO_SEQ_WRITE_QUEUE_CONFIG*, config);
+
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLE_SCHEDULER_HANDLE, BLE_Scheduler_Create, const BLE_SCHEDULER_CONFIG*, config, ON_BLE_SCHEDULER_READ_COMPLETE, on_read_complete);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , int, BLE_Scheduler_AddDevice, BLE_SCHEDULER_HANDLE, scheduler_handle, const BLE_DEVICE_CONFIG*, device_config, VECTOR_HANDLE, instructions);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , void, BLE_Scheduler_Tick, BLE_SCHEDULER_HANDLE, scheduler_handle, uint64_t, now_in_ms);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , void, BLE_Scheduler_Destroy, BLE_SCHEDULER_HANDLE, scheduler_handle, ON_BLE_SCHEDULER_DESTROY_COMPLETE, on_destroy_complete, void*, context);
 
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , BROKER_RESULT, Broker_Publish, BROKER_HANDLE, broker, MODULE_HANDLE, source, MESSAGE_HANDLE, message);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , time_t, gb_time, time_t*, timer);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , struct tm*, gb_localtime, const time_t*, timer);
-DECLARE_GLOBAL_MOCK_METHOD_4(CBLEMocks, , size_t, gb_strftime, char*, s, size_t, maxsize, const char *, format, const struct tm *, timeptr);
 
 DECLARE_GLOBAL_MOCK_METHOD_0(CBLEMocks, , gint64, g_get_monotonic_time);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, g_usleep, gulong, microseconds);
@@ -755,12 +1020,16 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, g_main_loop_unref, GMainLoop*, l
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, g_main_loop_run, GMainLoop*, loop);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , gboolean, g_main_loop_is_running, GMainLoop*, loop);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, g_main_loop_quit, GMainLoop*, loop);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , guint, g_timeout_add, guint, interval, GSourceFunc, function, gpointer, data);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , gboolean, g_source_remove, guint, tag);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , guint, g_idle_add, GSourceFunc, function, gpointer, data);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , JSON_Value*, json_parse_string, const char *, filename);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , JSON_Object*, json_value_get_object, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , double, json_object_get_number, const JSON_Object*, value, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , const char*, json_object_get_string, const JSON_Object*, object, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , JSON_Array*, json_object_get_array, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , JSON_Object*, json_object_get_object, const JSON_Object*, object, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , JSON_Object*, json_array_get_object, const JSON_Array*, arr, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , size_t, json_array_get_count, const JSON_Array*, arr);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, json_value_free, JSON_Value*, value);
@@ -796,9 +1065,34 @@ BEGIN_TEST_SUITE(ble_ut)
 
         g_call_on_read_complete = false;
         g_read_result = BLEIO_SEQ_OK;
-        shouldThreadAPI_Create_invoke_callback = false;
+        shouldModuleThread_Create_invoke_callback = false;
         thread_start_func = NULL;
         should_g_main_loop_quit_call_thread_func = false;
+        g_parse_fleet = false;
+        g_fleet_uses_templates = false;
+        g_timeout_function = NULL;
+        g_timeout_data = NULL;
+        g_published_mac_address[0] = '\0';
+        g_published_timestamp[0] = '\0';
+        g_published_read_group[0] = '\0';
+        g_published_content[0] = '\0';
+        g_publish_count = 0;
+        g_read_all_instructions = false;
+        g_instruction_type = "read_once";
+        g_read_group = NULL;
+        g_max_queued_writes = 0;
+        g_simulator = NULL;
+
+        // 2017-01-02 03:04:05
+        memset(&g_fake_local_time, 0, sizeof(g_fake_local_time));
+        g_fake_local_time.tm_year = 2017 - 1900;
+        g_fake_local_time.tm_mon = 0;
+        g_fake_local_time.tm_mday = 2;
+        g_fake_local_time.tm_hour = 3;
+        g_fake_local_time.tm_min = 4;
+        g_fake_local_time.tm_sec = 5;
+        g_localtime_call_count = 0;
+        g_map_create_call_count = 0;
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -912,6 +1206,9 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "device_mac_address"))
             .IgnoreArgument(1)
             .SetFailReturn((const char*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "devices"))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Array*)NULL);
 
         ///act
         auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
@@ -1444,6 +1741,8 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -1511,10 +1810,14 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
         // cause the second VECTOR_push_back to fail
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2)
@@ -1601,6 +1904,8 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1670,6 +1975,8 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1750,6 +2057,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1760,6 +2069,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1770,6 +2081,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1780,10 +2093,16 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, json_object_get_number(IGNORED_PTR_ARG, "max_queued_writes"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "simulator"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(BLE_CONFIG)));
 
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1826,6 +2145,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1836,6 +2157,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1846,6 +2169,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
@@ -1856,10 +2181,16 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "characteristic_uuid"))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_construct("00002A24-0000-1000-8000-00805F9B34FB"));
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "read_group"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, json_object_get_number(IGNORED_PTR_ARG, "max_queued_writes"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "simulator"))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(BLE_CONFIG)))
             .SetFailReturn(nullptr);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
@@ -1897,140 +2228,424 @@ BEGIN_TEST_SUITE(ble_ut)
         ///cleanup
     }
 
-    /*Tests_SRS_BLE_17_002: [ BLE_FreeConfiguration shall do nothing if configuration is NULL. ]*/
-    /*Tests_SRS_BLE_17_003: [ BLE_FreeConfiguration shall release all resources allocated in the BLE_CONFIG structure and release configuration. ]*/
-    TEST_FUNCTION(BLE_FreeConfiguration_does_nothing_with_null)
+    /*Tests_SRS_BLE_46_001: [ BLE_ParseConfigurationFromJson shall return NULL if an instruction that is not of type read_once or read_periodic has a read_group property or if the read_group property is an empty string. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_parses_the_read_group_of_an_instruction)
     {
+        ///arrange
         CBLEMocks mocks;
+        g_read_group = "environment";
 
-        BLE_FreeConfiguration(NULL);
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
 
-        mocks.AssertActualAndExpectedCalls();
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        BLE_INSTRUCTION* instr = (BLE_INSTRUCTION*)BASEIMPLEMENTATION::VECTOR_element(result->instructions, 0);
+        ASSERT_IS_NOT_NULL(instr->read_group);
+        ASSERT_ARE_EQUAL(char_ptr, "environment", BASEIMPLEMENTATION::STRING_c_str(instr->read_group));
+
+        ///cleanup
+        BLE_FreeConfiguration(result);
     }
 
-    TEST_FUNCTION(BLE_FreeConfiguration_frees_configuration)
+    /*Tests_SRS_BLE_48_001: [ BLE_ParseConfigurationFromJson shall read the max_queued_writes property from the JSON and, if it is a positive number, have writes to a characteristic executed in order with at most that many of them waiting; otherwise only the latest write waits. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_orders_writes_when_max_queued_writes_is_positive)
     {
+        ///arrange
         CBLEMocks mocks;
-        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
-
-        mocks.ResetAllCalls();
+        g_max_queued_writes = 8;
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
-            .IgnoreArgument(1); 
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1); 
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 2))
-            .IgnoreArgument(1); 
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 3))
-            .IgnoreArgument(1); 
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(result));
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
 
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_TRUE(result->write_queue_config.ordered);
+        ASSERT_ARE_EQUAL(size_t, 8, result->write_queue_config.max_depth);
 
+        ///cleanup
         BLE_FreeConfiguration(result);
-        mocks.AssertActualAndExpectedCalls();
     }
 
-    /*Tests_SRS_BLE_13_001: [ BLE_Create shall return NULL if broker is NULL. ]*/
-    TEST_FUNCTION(BLE_Create_returns_NULL_when_broker_is_NULL)
+    /*Tests_SRS_BLE_48_001: [ BLE_ParseConfigurationFromJson shall read the max_queued_writes property from the JSON and, if it is a positive number, have writes to a characteristic executed in order with at most that many of them waiting; otherwise only the latest write waits. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_coalesces_writes_when_max_queued_writes_is_missing)
     {
         ///arrange
         CBLEMocks mocks;
 
         ///act
-        auto result = BLE_Create(NULL, (const void*)0x42);
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
 
         ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_NULL(result);
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_FALSE(result->write_queue_config.ordered);
 
         ///cleanup
+        BLE_FreeConfiguration(result);
     }
 
-    /*Tests_SRS_BLE_13_002: [ BLE_Create shall return NULL if configuration is NULL. ]*/
-    TEST_FUNCTION(BLE_Create_returns_NULL_when_config_is_NULL)
+    /*Tests_SRS_BLE_49_001: [ BLE_ParseConfigurationFromJson shall have the module talk to simulated devices if the JSON has a simulator object. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_uses_real_devices_when_there_is_no_simulator)
     {
         ///arrange
         CBLEMocks mocks;
 
         ///act
-        auto result = BLE_Create((BROKER_HANDLE)0x42, NULL);
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
 
         ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_NULL(result);
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_FALSE(result->use_simulator);
 
         ///cleanup
+        BLE_FreeConfiguration(result);
     }
 
-    /*Tests_SRS_BLE_13_003: [  BLE_Create  shall return  NULL  if  configuration->instructions  is  NULL . ]*/
-    TEST_FUNCTION(BLE_Create_returns_NULL_when_config_instructions_is_NULL)
+    /*Tests_SRS_BLE_49_001: [ BLE_ParseConfigurationFromJson shall have the module talk to simulated devices if the JSON has a simulator object. ]*/
+    /*Tests_SRS_BLE_49_002: [ BLE_ParseConfigurationFromJson shall read the latency_in_ms, jitter_in_ms, connect_failure_rate, io_failure_rate, notify_interval_in_ms and value_size properties of the simulator object, clamp the rates to between 0 and 1 and use 0, 0, 0, 0, 1000 and 4 respectively when they are missing or not positive. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_parses_the_simulator_object)
     {
         ///arrange
         CBLEMocks mocks;
-        BLE_CONFIG config =
-        {
-            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
-            NULL
-        };
+        g_simulator = (JSON_Object*)0x45;
 
         ///act
-        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
 
         ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_NULL(result);
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_TRUE(result->use_simulator);
+        ASSERT_ARE_EQUAL(int, 20, (int)result->simulator.latency_in_ms);
+        ASSERT_ARE_EQUAL(int, 5, (int)result->simulator.jitter_in_ms);
+        ASSERT_IS_TRUE(result->simulator.connect_failure_rate == 0.0);
+        ASSERT_IS_TRUE(result->simulator.io_failure_rate == 0.25);
+        ASSERT_ARE_EQUAL(int, 1000, (int)result->simulator.notify_interval_in_ms);
+        ASSERT_ARE_EQUAL(size_t, 4, result->simulator.value_size);
 
         ///cleanup
+        BLE_FreeConfiguration(result);
     }
 
-    /*Tests_SRS_BLE_13_004: [BLE_Create  shall return  NULL  if the  configuration->instructions  vector is empty(size is zero).]*/
-    TEST_FUNCTION(BLE_Create_returns_NULL_when_config_instructions_is_empty)
+    /*Tests_SRS_BLE_49_002: [ BLE_ParseConfigurationFromJson shall read the latency_in_ms, jitter_in_ms, connect_failure_rate, io_failure_rate, notify_interval_in_ms and value_size properties of the simulator object, clamp the rates to between 0 and 1 and use 0, 0, 0, 0, 1000 and 4 respectively when they are missing or not positive. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_hands_the_simulator_to_the_scheduler_of_a_fleet)
     {
         ///arrange
         CBLEMocks mocks;
-        BLE_CONFIG config =
-        {
-           { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
-           VECTOR_create(sizeof(BLE_INSTRUCTION))
-        };
-        mocks.ResetAllCalls();
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(config.instructions));
+        g_parse_fleet = true;
+        g_simulator = (JSON_Object*)0x45;
 
         ///act
-        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
 
         ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_NULL(result);
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_NOT_NULL(result->devices);
+        ASSERT_IS_TRUE(result->scheduler_config.use_simulator);
+        ASSERT_ARE_EQUAL(int, 20, (int)result->scheduler_config.simulator.latency_in_ms);
 
         ///cleanup
-        VECTOR_destroy(config.instructions);
+        BLE_FreeConfiguration(result);
     }
 
-    /*Tests_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
-    TEST_FUNCTION(BLE_Create_returns_NULL_when_malloc_fails)
+    /*Tests_SRS_BLE_46_001: [ BLE_ParseConfigurationFromJson shall return NULL if an instruction that is not of type read_once or read_periodic has a read_group property or if the read_group property is an empty string. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_returns_NULL_when_a_write_instruction_has_a_read_group)
     {
         ///arrange
         CBLEMocks mocks;
-        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
-        BLE_INSTRUCTION instr1 =
-        {
-            READ_PERIODIC,
-            STRING_construct("fake_char_id"),
-            { 500 }
+        g_instruction_type = "write_at_init";
+        g_read_group = "environment";
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_46_001: [ BLE_ParseConfigurationFromJson shall return NULL if an instruction that is not of type read_once or read_periodic has a read_group property or if the read_group property is an empty string. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_returns_NULL_when_the_read_group_is_empty)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        g_read_group = "";
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_17_002: [ BLE_FreeConfiguration shall do nothing if configuration is NULL. ]*/
+    /*Tests_SRS_BLE_17_003: [ BLE_FreeConfiguration shall release all resources allocated in the BLE_CONFIG structure and release configuration. ]*/
+    TEST_FUNCTION(BLE_FreeConfiguration_does_nothing_with_null)
+    {
+        CBLEMocks mocks;
+
+        BLE_FreeConfiguration(NULL);
+
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    TEST_FUNCTION(BLE_FreeConfiguration_frees_configuration)
+    {
+        CBLEMocks mocks;
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1); 
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1); 
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 2))
+            .IgnoreArgument(1); 
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 3))
+            .IgnoreArgument(1); 
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(result));
+
+
+        BLE_FreeConfiguration(result);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_BLE_44_002: [ If there is no device_mac_address property in the JSON then BLE_ParseConfigurationFromJson shall parse the devices array into a fleet configuration. ]*/
+    /*Tests_SRS_BLE_44_010: [ BLE_ParseConfigurationFromJson shall read the max_connections, min_connection_time_in_ms and retry_interval_in_ms properties of a fleet from the JSON and use 4, 1000 and 5000 respectively when they are missing or not positive. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_parses_a_fleet)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        g_parse_fleet = true;
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_NULL(result->instructions);
+        ASSERT_IS_NOT_NULL(result->devices);
+        ASSERT_ARE_EQUAL(size_t, 4, BASEIMPLEMENTATION::VECTOR_size(result->devices));
+        for (size_t i = 0; i < 4; i++)
+        {
+            BLE_FLEET_DEVICE* device = (BLE_FLEET_DEVICE*)BASEIMPLEMENTATION::VECTOR_element(result->devices, i);
+            ASSERT_ARE_EQUAL(int, 0xAA, (int)device->device_config.device_addr.address[0]);
+            ASSERT_ARE_EQUAL(int, 0xFF, (int)device->device_config.device_addr.address[5]);
+            ASSERT_ARE_EQUAL(size_t, 4, BASEIMPLEMENTATION::VECTOR_size(device->instructions));
+        }
+        ASSERT_ARE_EQUAL(size_t, 4, result->scheduler_config.max_connections);
+        ASSERT_ARE_EQUAL(int, 1000, (int)result->scheduler_config.min_connection_time_in_ms);
+        ASSERT_ARE_EQUAL(int, 5000, (int)result->scheduler_config.retry_interval_in_ms);
+
+        ///cleanup
+        BLE_FreeConfiguration(result);
+    }
+
+    /*Tests_SRS_BLE_44_009: [ BLE_ParseConfigurationFromJson shall give every device its own copy of the instructions of its template. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_gives_every_fleet_device_a_copy_of_its_template)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        g_parse_fleet = true;
+        g_fleet_uses_templates = true;
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, 4, BASEIMPLEMENTATION::VECTOR_size(result->devices));
+        BLE_FLEET_DEVICE* first = (BLE_FLEET_DEVICE*)BASEIMPLEMENTATION::VECTOR_element(result->devices, 0);
+        for (size_t i = 0; i < 4; i++)
+        {
+            BLE_FLEET_DEVICE* device = (BLE_FLEET_DEVICE*)BASEIMPLEMENTATION::VECTOR_element(result->devices, i);
+            ASSERT_ARE_EQUAL(size_t, 4, BASEIMPLEMENTATION::VECTOR_size(device->instructions));
+            if (i > 0)
+            {
+                ASSERT_ARE_NOT_EQUAL(void_ptr, (void*)first->instructions, (void*)device->instructions);
+            }
+        }
+
+        ///cleanup
+        BLE_FreeConfiguration(result);
+    }
+
+    /*Tests_SRS_BLE_44_008: [ BLE_ParseConfigurationFromJson shall return NULL if an entry of the devices array has neither an instructions array nor a template property that names an array in instruction_templates. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_returns_NULL_when_a_fleet_device_has_no_instructions)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        g_parse_fleet = true;
+        g_fleet_uses_templates = true;
+
+        STRICT_EXPECTED_CALL(mocks, json_object_get_object(IGNORED_PTR_ARG, "instruction_templates"))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Object*)NULL);
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_44_006: [ BLE_ParseConfigurationFromJson shall return NULL if the devices array is empty. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_returns_NULL_when_the_devices_array_is_empty)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        g_parse_fleet = true;
+
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(FAKE_CONFIG));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_number(IGNORED_PTR_ARG, "controller_index"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "device_mac_address"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "devices"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((size_t)0);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_44_007: [ BLE_ParseConfigurationFromJson shall return NULL if an entry of the devices array does not have a well-formed device_mac_address property. ]*/
+    TEST_FUNCTION(BLE_ParseConfigurationFromJson_returns_NULL_when_a_fleet_device_has_no_mac_address)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        g_parse_fleet = true;
+
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string((JSON_Object*)0x43, "device_mac_address"))
+            .SetFailReturn((const char*)NULL);
+
+        ///act
+        auto result = BLE_ParseConfigurationFromJson(FAKE_CONFIG);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_13_001: [ BLE_Create shall return NULL if broker is NULL. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_broker_is_NULL)
+    {
+        ///arrange
+        CBLEMocks mocks;
+
+        ///act
+        auto result = BLE_Create(NULL, (const void*)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_13_002: [ BLE_Create shall return NULL if configuration is NULL. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_config_is_NULL)
+    {
+        ///arrange
+        CBLEMocks mocks;
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_13_003: [  BLE_Create  shall return  NULL  if  configuration->instructions  is  NULL . ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_config_instructions_is_NULL)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            NULL
+        };
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_13_004: [BLE_Create  shall return  NULL  if the  configuration->instructions  vector is empty(size is zero).]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_config_instructions_is_empty)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_CONFIG config =
+        {
+           { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+           VECTOR_create(sizeof(BLE_INSTRUCTION))
+        };
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(config.instructions));
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        VECTOR_destroy(config.instructions);
+    }
+
+    /*Tests_SRS_BLE_13_005: [  BLE_Create  shall return  NULL  if an underlying API call fails. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_malloc_fails)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
         };
         VECTOR_push_back(instructions, &instr1, 1);
         BLE_CONFIG config =
@@ -2336,7 +2951,7 @@ BEGIN_TEST_SUITE(ble_ut)
     }
 
     /*Tests_SRS_BLE_13_005: [ BLE_Create shall return NULL if an underlying API call fails. ]*/
-    TEST_FUNCTION(BLE_Create_returns_NULL_when_ThreadAPI_Create_fails)
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_ModuleThread_Create_fails)
     {
         ///arrange
         CBLEMocks mocks;
@@ -2383,7 +2998,7 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetFailReturn((THREADAPI_RESULT)THREADAPI_ERROR);
 
@@ -2486,7 +3101,7 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, g_main_loop_quit(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -2617,7 +3232,7 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(2);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -2690,7 +3305,7 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(2);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -2771,7 +3386,7 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(2);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -2850,11 +3465,16 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL))
             .SetFailReturn((MAP_HANDLE)NULL);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -2933,18 +3553,36 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
-        STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_BLE_CONTROLLER_INDEX_PROPERTY, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
             .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
         STRICT_EXPECTED_CALL(mocks, gb_time(NULL))
             .SetFailReturn((time_t)-1);
 
+        // mallocAndStrcpy_s is called twice for each of the 3 properties in the template
+        for (size_t i = 0; i < (3 * 2); i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
+
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -3020,12 +3658,23 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_BLE_CONTROLLER_INDEX_PROPERTY, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
             .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -3034,6 +3683,13 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .SetFailReturn((struct tm*)NULL);
 
+        // mallocAndStrcpy_s is called twice for each of the 3 properties in the template
+        for (size_t i = 0; i < (3 * 2); i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
+
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -3048,7 +3704,7 @@ BEGIN_TEST_SUITE(ble_ut)
         STRING_delete(instr1.characteristic_uuid);
     }
 
-    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_strftime_fails)
+    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_the_year_does_not_fit_the_timestamp)
     {
         ///arrange
         CBLEMocks mocks;
@@ -3070,6 +3726,9 @@ BEGIN_TEST_SUITE(ble_ut)
         g_read_result = BLEIO_SEQ_OK;
         g_call_on_read_complete = true;
 
+        // localtime reports a year that takes more than 4 digits
+        g_fake_local_time.tm_year = 10000 - 1900;
+
         mocks.ResetAllCalls();
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
@@ -3108,21 +3767,36 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_BLE_CONTROLLER_INDEX_PROPERTY, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
             .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
         STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
         STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments()
-            .SetFailReturn((size_t)0);
+
+        // mallocAndStrcpy_s is called twice for each of the 3 properties in the template
+        for (size_t i = 0; i < (3 * 2); i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
 
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
@@ -3198,6 +3872,11 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
         STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -3207,16 +3886,10 @@ BEGIN_TEST_SUITE(ble_ut)
             .SetFailReturn((MAP_RESULT)MAP_ERROR);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
-        STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
-        STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -3290,6 +3963,11 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
         STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -3302,20 +3980,16 @@ BEGIN_TEST_SUITE(ble_ut)
             .SetFailReturn((MAP_RESULT)MAP_ERROR);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
-        STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
-        STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
+        // mallocAndStrcpy_s is called twice for the first property
+        for (size_t i = 0; i < 2; i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
 
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
@@ -3390,6 +4064,11 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
         STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -3399,30 +4078,21 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
             .IgnoreArgument(1)
-            .IgnoreArgument(3)
             .SetFailReturn((MAP_RESULT)MAP_ERROR);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
-        STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
-        STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
+        // mallocAndStrcpy_s is called twice for each of the first 2 properties
+        for (size_t i = 0; i < (2 * 2); i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
 
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
@@ -3438,7 +4108,7 @@ BEGIN_TEST_SUITE(ble_ut)
         STRING_delete(instr1.characteristic_uuid);
     }
 
-    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_fourth_Map_Add_fails)
+    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_updating_the_timestamp_fails)
     {
         ///arrange
         CBLEMocks mocks;
@@ -3497,46 +4167,40 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
-        STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_BLE_CONTROLLER_INDEX_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3)
             .SetFailReturn((MAP_RESULT)MAP_ERROR);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
         STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
         STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
+        // mallocAndStrcpy_s is called twice for each of the 3 properties in the template
+        for (size_t i = 0; i < (3 * 2); i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
 
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
@@ -3552,7 +4216,7 @@ BEGIN_TEST_SUITE(ble_ut)
         STRING_delete(instr1.characteristic_uuid);
     }
     
-    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_fifth_Map_Add_fails)
+    TEST_FUNCTION(on_read_complete_does_not_publish_message_when_updating_the_characteristic_uuid_fails)
     {
         ///arrange
         CBLEMocks mocks;
@@ -3611,52 +4275,44 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
 
-        STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, BUFFER_u_char(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_length(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_BLE_CONTROLLER_INDEX_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
+            .IgnoreArgument(3)
             .SetFailReturn((MAP_RESULT)MAP_ERROR);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
         STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
         STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
+        // mallocAndStrcpy_s is called twice for each of the 3 properties in the template
+        // and for the timestamp
+        for (size_t i = 0; i < (4 * 2); i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
 
         ///act
         auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
@@ -3737,35 +4393,31 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(2);
 
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_BLE_CONTROLLER_INDEX_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
         STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
         STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
 
-        // mallocAndStrcpy_s is called twice for each property and we have 5 properties
+        // mallocAndStrcpy_s is called twice for each of the 5 properties
         for (size_t i = 0; i < (5 * 2); i++)
         {
             STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -3872,8 +4524,6 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(2);
 
         STRICT_EXPECTED_CALL(mocks, Map_Create(NULL));
-        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Map_Clone(IGNORED_PTR_ARG))
@@ -3884,14 +4534,14 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_TIMESTAMP_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, GW_CHARACTERISTIC_UUID_PROPERTY, IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .IgnoreArgument(3);
-        STRICT_EXPECTED_CALL(mocks, Map_Add(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY))
-            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -3901,11 +4551,9 @@ BEGIN_TEST_SUITE(ble_ut)
         STRICT_EXPECTED_CALL(mocks, gb_time(NULL));
         STRICT_EXPECTED_CALL(mocks, gb_localtime(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gb_strftime(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
 
-        // mallocAndStrcpy_s is called twice for each property and we have 5 properties
-        // and we do the whole thing twice
+        // mallocAndStrcpy_s is called twice for each of the 5 properties and Message_Create
+        // copies all of them again
         for (size_t i = 0; i < (5 * 2) * 2; i++)
         {
             STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
@@ -3922,7 +4570,7 @@ BEGIN_TEST_SUITE(ble_ut)
             .IgnoreArgument(3);
 
         STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments()
             .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
 
@@ -3940,23 +4588,8 @@ BEGIN_TEST_SUITE(ble_ut)
         STRING_delete(instr1.characteristic_uuid);
     }
 
-    /*Tests_SRS_BLE_13_016: [ If module is NULL BLE_Destroy shall do nothing. ]*/
-    TEST_FUNCTION(BLE_Destroy_does_nothing_with_NULL_input)
-    {
-        ///arrange
-        CBLEMocks mocks;
-
-        ///act
-        BLE_Destroy(NULL);
-
-        ///assert
-        mocks.AssertActualAndExpectedCalls();
-
-        ///cleanup
-    }
-
-    /*Tests_SRS_BLE_13_017: [ BLE_Destroy shall free all resources. ]*/
-    TEST_FUNCTION(BLE_Destroy_happy_path)
+    /*Tests_SRS_BLE_45_002: [ BLE_Create shall format the timestamp property of the messages it publishes at most once per second. ]*/
+    TEST_FUNCTION(on_read_complete_publishes_the_local_time_as_timestamp)
     {
         ///arrange
         CBLEMocks mocks;
@@ -3978,74 +4611,960 @@ BEGIN_TEST_SUITE(ble_ut)
         g_read_result = BLEIO_SEQ_OK;
         g_call_on_read_complete = true;
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
-
-        // we want thread func called from g_main_loop_quit
-        should_g_main_loop_quit_call_thread_func = true;
-
-        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
-        mocks.ResetAllCalls();
-
-        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_disconnect(IGNORED_PTR_ARG, NULL, NULL))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_Destroy(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, g_get_monotonic_time());
-        STRICT_EXPECTED_CALL(mocks, g_main_loop_get_context(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, g_main_loop_run(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, g_main_loop_unref(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, g_main_loop_quit(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
         ///act
-        BLE_Destroy(result);
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
 
         ///assert
-        mocks.AssertActualAndExpectedCalls();
         ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(char_ptr, "2017:01:02T03:04:05", g_published_timestamp);
 
         ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
         VECTOR_destroy(instructions);
         STRING_delete(instr1.characteristic_uuid);
     }
 
-    /*Tests_SRS_BLE_26_001: [ `Module_GetApi` shall return a pointer to a `MODULE_API` structure. ]*/
-    TEST_FUNCTION(Module_GetApi_returns_non_NULL_and_non_NULL_fields)
+    /*Tests_SRS_BLE_45_001: [ BLE_Create shall format the ble_controller_index, mac_address and source properties of the messages it publishes for a device once, on the first successful read from that device. ]*/
+    /*Tests_SRS_BLE_45_002: [ BLE_Create shall format the timestamp property of the messages it publishes at most once per second. ]*/
+    TEST_FUNCTION(BLE_reuses_the_message_properties_of_a_device_within_the_same_second)
     {
-        ///arrrange
+        ///arrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(1, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+        g_read_result = BLEIO_SEQ_OK;
+        g_call_on_read_complete = true;
+        (void)g_timeout_function(g_timeout_data);
+        mocks.ResetAllCalls();
+
+        // gb_time keeps reporting the same second
+        g_localtime_call_count = 0;
+        g_map_create_call_count = 0;
 
         ///act
-        const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
+        gboolean keep_going = g_timeout_function(g_timeout_data);
 
         ///assert
-        ASSERT_IS_NOT_NULL(apis);
-        ASSERT_IS_TRUE(MODULE_PARSE_CONFIGURATION_FROM_JSON(apis) != NULL);
-        ASSERT_IS_TRUE(MODULE_FREE_CONFIGURATION(apis) != NULL);
-        ASSERT_IS_TRUE(MODULE_CREATE(apis) != NULL);
-        ASSERT_IS_TRUE(MODULE_DESTROY(apis) != NULL);
-        ASSERT_IS_TRUE(MODULE_RECEIVE(apis) != NULL);
+        ASSERT_IS_TRUE(keep_going == TRUE);
+        ASSERT_ARE_EQUAL(int, 0, (int)g_localtime_call_count);
+        ASSERT_ARE_EQUAL(int, 0, (int)g_map_create_call_count);
+        ASSERT_ARE_EQUAL(char_ptr, "2017:01:02T03:04:05", g_published_timestamp);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
     }
 
-    /*Tests_SRS_BLE_13_018: [ BLE_Receive shall do nothing if module is NULL or if message is NULL. ]*/
+    /*Tests_SRS_BLE_46_003: [ Once every instruction of a read group has completed BLE_Create shall publish a single message whose content is a JSON object that maps the UUIDs of the characteristics that were read successfully to their base 64 encoded values, with the properties of a single read except characteristicUUID and with a readGroup property that has the name of the group. ]*/
+    TEST_FUNCTION(BLE_publishes_the_reads_of_a_read_group_as_one_message)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid1"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        BLE_INSTRUCTION instr2 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid2"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        VECTOR_push_back(instructions, &instr2, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        // have every read of the group complete
+        g_read_result = BLEIO_SEQ_OK;
+        g_call_on_read_complete = true;
+        g_read_all_instructions = true;
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(int, 1, (int)g_publish_count);
+        ASSERT_ARE_EQUAL(char_ptr, "environment", g_published_read_group);
+        ASSERT_ARE_EQUAL(char_ptr, "{\"uuid1\":\"ZGF0YQA=\",\"uuid2\":\"ZGF0YQA=\"}", g_published_content);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+        STRING_delete(instr1.read_group);
+        STRING_delete(instr2.characteristic_uuid);
+        STRING_delete(instr2.read_group);
+    }
+
+    /*Tests_SRS_BLE_46_003: [ Once every instruction of a read group has completed BLE_Create shall publish a single message whose content is a JSON object that maps the UUIDs of the characteristics that were read successfully to their base 64 encoded values, with the properties of a single read except characteristicUUID and with a readGroup property that has the name of the group. ]*/
+    TEST_FUNCTION(BLE_does_not_publish_a_read_group_before_every_read_completed)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid1"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        BLE_INSTRUCTION instr2 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid2"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        VECTOR_push_back(instructions, &instr2, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        // only the first read completes
+        g_read_result = BLEIO_SEQ_OK;
+        g_call_on_read_complete = true;
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(int, 0, (int)g_publish_count);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+        STRING_delete(instr1.read_group);
+        STRING_delete(instr2.characteristic_uuid);
+        STRING_delete(instr2.read_group);
+    }
+
+    /*Tests_SRS_BLE_46_004: [ BLE_Create shall not publish a message for a round of reads of a read group in which every read failed. ]*/
+    TEST_FUNCTION(BLE_does_not_publish_a_read_group_when_every_read_failed)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid1"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        BLE_INSTRUCTION instr2 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid2"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        VECTOR_push_back(instructions, &instr2, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        // every read of the group fails
+        g_read_result = BLEIO_SEQ_ERROR;
+        g_call_on_read_complete = true;
+        g_read_all_instructions = true;
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(int, 0, (int)g_publish_count);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+        STRING_delete(instr1.read_group);
+        STRING_delete(instr2.characteristic_uuid);
+        STRING_delete(instr2.read_group);
+    }
+
+    /*Tests_SRS_BLE_46_002: [ BLE_Create shall return NULL if the instructions of a read group do not all have the same type and interval_in_ms or if a read group reads the same characteristic twice. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_a_read_group_mixes_instruction_types)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("uuid1"),
+            { 0 },
+            STRING_construct("environment")
+        };
+        BLE_INSTRUCTION instr2 =
+        {
+            READ_PERIODIC,
+            STRING_construct("uuid2"),
+            { 500 },
+            STRING_construct("environment")
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        VECTOR_push_back(instructions, &instr2, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+        STRING_delete(instr1.read_group);
+        STRING_delete(instr2.characteristic_uuid);
+        STRING_delete(instr2.read_group);
+    }
+
+    /*Tests_SRS_BLE_46_002: [ BLE_Create shall return NULL if the instructions of a read group do not all have the same type and interval_in_ms or if a read group reads the same characteristic twice. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_a_read_group_reads_a_characteristic_twice)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("uuid1"),
+            { 500 },
+            STRING_construct("environment")
+        };
+        BLE_INSTRUCTION instr2 =
+        {
+            READ_PERIODIC,
+            STRING_construct("uuid1"),
+            { 500 },
+            STRING_construct("environment")
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        VECTOR_push_back(instructions, &instr2, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+        STRING_delete(instr1.read_group);
+        STRING_delete(instr2.characteristic_uuid);
+        STRING_delete(instr2.read_group);
+    }
+
+    /*Tests_SRS_BLE_13_016: [ If module is NULL BLE_Destroy shall do nothing. ]*/
+    TEST_FUNCTION(BLE_Destroy_does_nothing_with_NULL_input)
+    {
+        ///arrange
+        CBLEMocks mocks;
+
+        ///act
+        BLE_Destroy(NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLE_13_017: [ BLE_Destroy shall free all resources. ]*/
+    TEST_FUNCTION(BLE_Destroy_happy_path)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        // have the on_read_complete callback called
+        g_read_result = BLEIO_SEQ_OK;
+        g_call_on_read_complete = true;
+
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
+
+        // we want thread func called from g_main_loop_quit
+        should_g_main_loop_quit_call_thread_func = true;
+
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_disconnect(IGNORED_PTR_ARG, NULL, NULL))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_Destroy(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))   // the message properties of the device
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_get_monotonic_time());
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_get_context(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_run(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_quit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+
+        ///act
+        BLE_Destroy(result);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(result);
+
+        ///cleanup
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_48_002: [ BLE_Create shall pass the write queue configuration to BLEIO_Seq_SetWriteQueueConfig if writes are ordered. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_BLEIO_Seq_SetWriteQueueConfig_fails)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions,
+            NULL,
+            { 0 },
+            { true, 4 }
+        };
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_SetWriteQueueConfig(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetFailReturn(BLEIO_SEQ_ERROR);
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_49_003: [ BLE_Create shall create the bleio_gatt field by calling BLEIO_gatt_sim_create with the simulator field of the configuration instead if the use_simulator field is true. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_BLEIO_gatt_sim_create_fails)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions,
+            NULL,
+            { 0 },
+            { false, 0 },
+            true,
+            { 10, 0, 0.0, 0.0, 1000, 4 }
+        };
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_sim_create(&(config.device_config), &(config.simulator)))
+            .SetFailReturn((BLEIO_GATT_HANDLE)NULL);
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_43_001: [ BLE_Create shall reuse the GLIB loop and event dispatcher thread shared by all the BLE module instances in the process if they have already been started. ]*/
+    TEST_FUNCTION(BLE_Create_reuses_the_shared_glib_loop)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+        auto module1 = BLE_Create((BROKER_HANDLE)0x42, &config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_create(&(config.device_config)));
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_connect(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_Run(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION)));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(config.instructions));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(config.instructions));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)) // CBLEIOSequence::run
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+
+        STRICT_EXPECTED_CALL(mocks, STRING_clone(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+
+        // there should be no calls to g_main_loop_new or ModuleThread_Create
+
+        ///act
+        auto module2 = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(module2);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(module2);
+        BLE_Destroy(module1);
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_43_002: [ BLE_Destroy shall stop the shared GLIB loop and event dispatcher thread only when the last BLE module instance in the process is destroyed. ]*/
+    TEST_FUNCTION(BLE_Destroy_keeps_the_shared_glib_loop_while_other_modules_exist)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        // we want thread func called from g_main_loop_quit
+        should_g_main_loop_quit_call_thread_func = true;
+
+        auto module1 = BLE_Create((BROKER_HANDLE)0x42, &config);
+        auto module2 = BLE_Create((BROKER_HANDLE)0x42, &config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_disconnect(IGNORED_PTR_ARG, NULL, NULL))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_Destroy(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_get_monotonic_time());
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_get_context(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        // there should be no calls to g_main_loop_quit or ThreadAPI_Join
+
+        ///act
+        BLE_Destroy(module2);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLE_Destroy(module1);
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_44_003: [ When configuration->devices is not NULL BLE_Create shall create a connection scheduler by calling BLE_Scheduler_Create and add every device to it by calling BLE_Scheduler_AddDevice. ]*/
+    /*Tests_SRS_BLE_44_004: [ BLE_Create shall drive the scheduler of a fleet from a timer on the shared GLIB loop. ]*/
+    TEST_FUNCTION(BLE_Create_creates_a_fleet)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(2, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_Create(&(config.scheduler_config), IGNORED_PTR_ARG))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))   // the message properties of the devices
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(devices));
+        for (size_t i = 0; i < 2; i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, VECTOR_element(devices, i));
+            STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION)));
+            STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+                .IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+                .IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, STRING_clone(instr1.characteristic_uuid));
+            STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+                .IgnoreArgument(1)
+                .IgnoreArgument(2);
+            STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_AddDevice(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+                .IgnoreAllArguments();
+        }
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_new(NULL, FALSE));
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn((THREADAPI_RESULT)THREADAPI_OK);
+        STRICT_EXPECTED_CALL(mocks, g_timeout_add(10, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_IS_NOT_NULL((void*)g_timeout_function);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_13_005: [ BLE_Create shall return NULL if an underlying API call fails. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_BLE_Scheduler_Create_fails)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(1, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_Create(&(config.scheduler_config), IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .SetFailReturn((BLE_SCHEDULER_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_13_005: [ BLE_Create shall return NULL if an underlying API call fails. ]*/
+    TEST_FUNCTION(BLE_Create_returns_NULL_when_BLE_Scheduler_AddDevice_fails)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(1, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_Create(&(config.scheduler_config), IGNORED_PTR_ARG))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))   // the message properties of the devices
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(devices));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(devices, 0));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION)));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_clone(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_AddDevice(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetFailReturn(__LINE__);
+
+        // the converted instructions are freed
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_Destroy(IGNORED_PTR_ARG, NULL, NULL))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))   // the message properties of the devices
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_44_005: [ BLE_Create shall publish the reads completed by the scheduler of a fleet the same way as the reads of a single device, with the MAC address of the device that was read from. ]*/
+    TEST_FUNCTION(BLE_publishes_the_reads_of_a_fleet_with_the_MAC_address_of_the_device)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(2, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+        g_read_result = BLEIO_SEQ_OK;
+        g_call_on_read_complete = true;
+        mocks.ResetAllCalls();
+
+        ///act
+        gboolean keep_going = g_timeout_function(g_timeout_data);
+
+        ///assert
+        ASSERT_IS_TRUE(keep_going == TRUE);
+        ASSERT_ARE_EQUAL(char_ptr, "A1:BB:CC:DD:EE:FF", g_published_mac_address);
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(result);
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_44_012: [ BLE_Destroy shall destroy the scheduler of a fleet on the GLIB loop by calling BLE_Scheduler_Destroy and stop the timer that drives it once the scheduler is destroyed or waiting for it times out. ]*/
+    TEST_FUNCTION(BLE_Destroy_destroys_the_scheduler_of_a_fleet)
+    {
+        ///arrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(1, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+
+        // we want thread func called from g_main_loop_quit
+        should_g_main_loop_quit_call_thread_func = true;
+
+        auto result = BLE_Create((BROKER_HANDLE)0x42, &config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_idle_add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, BLE_Scheduler_Destroy(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, g_source_remove(1));
+
+        // the fake scheduler frees the instructions of its device
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))   // the message properties of the devices
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_get_monotonic_time());
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_get_context(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_run(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_main_loop_quit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+
+        ///act
+        BLE_Destroy(result);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL((void*)g_timeout_function);
+
+        ///cleanup
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_44_011: [ BLE_Receive shall ignore all messages when the module drives a fleet of devices. ]*/
+    TEST_FUNCTION(BLE_Receive_does_nothing_when_the_module_drives_a_fleet)
+    {
+        ///arrrange
+        CBLEMocks mocks;
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_HANDLE devices = create_fake_fleet(1, &instr1);
+        BLE_CONFIG config =
+        {
+            { { 0 }, 0 },
+            NULL,
+            devices,
+            { 4, 1000, 5000 }
+        };
+        auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        MAP_HANDLE properties = Map_Create(NULL);
+        Map_Add(properties, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND);
+        Map_Add(properties, GW_MAC_ADDRESS_PROPERTY, "A0:BB:CC:DD:EE:FF");
+        MESSAGE_CONFIG message_config =
+        {
+            0, NULL,
+            properties
+        };
+
+        MESSAGE_HANDLE message = Message_Create(&message_config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1);
+
+        ///act
+        BLE_Receive(handle, message);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(handle);
+        Map_Destroy(properties);
+        Message_Destroy(message);
+        destroy_fake_fleet(devices);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
+    /*Tests_SRS_BLE_26_001: [ `Module_GetApi` shall return a pointer to a `MODULE_API` structure. ]*/
+    TEST_FUNCTION(Module_GetApi_returns_non_NULL_and_non_NULL_fields)
+    {
+        ///arrrange
+
+        ///act
+        const MODULE_API* apis = Module_GetApi(MODULE_API_VERSION_1);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(apis);
+        ASSERT_IS_TRUE(MODULE_PARSE_CONFIGURATION_FROM_JSON(apis) != NULL);
+        ASSERT_IS_TRUE(MODULE_FREE_CONFIGURATION(apis) != NULL);
+        ASSERT_IS_TRUE(MODULE_CREATE(apis) != NULL);
+        ASSERT_IS_TRUE(MODULE_DESTROY(apis) != NULL);
+        ASSERT_IS_TRUE(MODULE_RECEIVE(apis) != NULL);
+    }
+
+    /*Tests_SRS_BLE_13_018: [ BLE_Receive shall do nothing if module is NULL or if message is NULL. ]*/
     TEST_FUNCTION(BLE_Receive_does_nothing_when_module_handle_is_NULL)
     {
         ///arrrange
@@ -4096,8 +5615,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4163,8 +5682,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4231,8 +5750,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4303,8 +5822,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4372,8 +5891,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4440,8 +5959,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4513,8 +6032,8 @@ BEGIN_TEST_SUITE(ble_ut)
             instructions
         };
 
-        // we don't want ThreadAPI_Create to call the callback
-        shouldThreadAPI_Create_invoke_callback = false;
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
 
         auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
 
@@ -4580,4 +6099,92 @@ BEGIN_TEST_SUITE(ble_ut)
         STRING_delete(instruction.characteristic_uuid);
     }
 
+    /*Tests_SRS_BLE_48_003: [ BLE_Receive shall free the characteristic UUID and the buffer of the instruction if BLEIO_Seq_AddInstruction fails. ]*/
+    TEST_FUNCTION(BLE_Receive_frees_the_instruction_when_the_write_queue_is_full)
+    {
+        ///arrrange
+        CBLEMocks mocks;
+
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLE_INSTRUCTION));
+        BLE_INSTRUCTION instr1 =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            { 500 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        BLE_CONFIG config =
+        {
+            { { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF }, 0 },
+            instructions
+        };
+
+        // we don't want ModuleThread_Create to call the callback
+        shouldModuleThread_Create_invoke_callback = false;
+
+        auto handle = BLE_Create((BROKER_HANDLE)0x42, &config);
+
+        MAP_HANDLE properties = Map_Create(NULL);
+        Map_Add(properties, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_COMMAND);
+        Map_Add(properties, GW_MAC_ADDRESS_PROPERTY, "AA:BB:CC:DD:EE:FF");
+
+        BLE_INSTRUCTION instruction =
+        {
+            WRITE_ONCE,
+            STRING_construct("fake_char_id"),
+            { .buffer = BUFFER_create((const unsigned char*)"data", 4) }
+        };
+
+        MESSAGE_CONFIG message_config =
+        {
+            sizeof(BLE_INSTRUCTION),
+            (const unsigned char*)&instruction,
+            properties
+        };
+
+        MESSAGE_HANDLE message = Message_Create(&message_config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(message));
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(message));
+
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Clone(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, CONSTBUFFER_GetContent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_GetValueFromKey(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_Seq_AddInstruction(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .SetFailReturn(BLEIO_SEQ_QUEUE_FULL);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(instruction.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(instruction.data.buffer));
+
+        ///act
+        BLE_Receive(handle, message);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        should_g_main_loop_quit_call_thread_func = true;
+        BLE_Destroy(handle);
+        Map_Destroy(properties);
+        Message_Destroy(message);
+        VECTOR_destroy(instructions);
+        STRING_delete(instr1.characteristic_uuid);
+    }
+
 END_TEST_SUITE(ble_ut)
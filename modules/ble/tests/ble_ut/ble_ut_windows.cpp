@@ -30,12 +30,9 @@ extern "C"
 {
     extern time_t gb_time(time_t *timer);
     extern struct tm* gb_localtime(const time_t *timer);
-    extern size_t gb_strftime(char * s, size_t maxsize, const char * format, const struct tm * timeptr);
 }
 #endif
 
-#define TIME_IN_STRFTIME "time"
-
 namespace BASEIMPLEMENTATION
 {
     /*if malloc is defined as gballoc_malloc at this moment, there'd be serious trouble*/
@@ -147,24 +144,18 @@ public:
     MOCK_METHOD_END(time_t, result2);
 
     MOCK_STATIC_METHOD_1(, struct tm*, gb_localtime, const time_t *, timer)
-        struct tm* result2 = (struct tm*)0x42;
+        static struct tm fake_local_time = { 0 };
+        struct tm* result2 = &fake_local_time;
     MOCK_METHOD_END(struct tm*, result2);
 
-    MOCK_STATIC_METHOD_4(, size_t, gb_strftime, char*, s, size_t, maxsize, const char *, format, const struct tm *, timeptr)
-        if (maxsize < strlen(TIME_IN_STRFTIME) + 1)
-        {
-            ASSERT_FAIL("what is this puny message size!");
-        }
-        else
-        {
-            strcpy(s, TIME_IN_STRFTIME);
-        }
-    MOCK_METHOD_END(size_t, maxsize);
-
     MOCK_STATIC_METHOD_1(, BLEIO_GATT_HANDLE, BLEIO_gatt_create, const BLE_DEVICE_CONFIG*, config)
         auto result2 = (BLEIO_GATT_HANDLE)malloc(1);
     MOCK_METHOD_END(BLEIO_GATT_HANDLE, result2)
 
+    MOCK_STATIC_METHOD_2(, BLEIO_GATT_HANDLE, BLEIO_gatt_sim_create, const BLE_DEVICE_CONFIG*, config, const BLEIO_GATT_SIM_CONFIG*, sim_config)
+        auto result2 = (BLEIO_GATT_HANDLE)malloc(1);
+    MOCK_METHOD_END(BLEIO_GATT_HANDLE, result2)
+
     MOCK_STATIC_METHOD_1(, void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle)
         free(bleio_gatt_handle);
     MOCK_VOID_METHOD_END()
@@ -207,6 +198,10 @@ public:
         CBLEIOSequence* seq = (CBLEIOSequence*)bleio_seq_handle;
         auto result2 = seq->run();
     MOCK_METHOD_END(BLEIO_SEQ_RESULT, result2)
+
+    MOCK_STATIC_METHOD_2(, BLEIO_SEQ_RESULT, BLEIO_Seq_SetWriteQueueConfig, BLEIO_SEQ_HANDLE, bleio_seq_handle, const BLEIO_SEQ_WRITE_QUEUE_CONFIG*, config)
+        auto result2 = BLEIO_SEQ_OK;
+    MOCK_METHOD_END(BLEIO_SEQ_RESULT, result2)
 };
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void*, gballoc_malloc, size_t, size);
@@ -214,9 +209,9 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, gballoc_free, void*, ptr);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , time_t, gb_time, time_t*, timer);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , struct tm*, gb_localtime, const time_t*, timer);
-DECLARE_GLOBAL_MOCK_METHOD_4(CBLEMocks, , size_t, gb_strftime, char*, s, size_t, maxsize, const char *, format, const struct tm *, timeptr);
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , BLEIO_GATT_HANDLE, BLEIO_gatt_create, const BLE_DEVICE_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLEIO_GATT_HANDLE, BLEIO_gatt_sim_create, const BLE_DEVICE_CONFIG*, config, const BLEIO_GATT_SIM_CONFIG*, sim_config);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , int, BLEIO_gatt_connect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_CONNECT_COMPLETE, on_bleio_gatt_connect_complete, void*, callback_context);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , void, BLEIO_gatt_disconnect, BLEIO_GATT_HANDLE, bleio_gatt_handle, ON_BLEIO_GATT_DISCONNECT_COMPLETE, on_bleio_gatt_disconnect_complete, void*, callback_context);
@@ -225,6 +220,7 @@ DECLARE_GLOBAL_MOCK_METHOD_4(CBLEMocks, , BLEIO_SEQ_HANDLE, BLEIO_Seq_Create, BL
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEMocks, , void, BLEIO_Seq_Destroy, BLEIO_SEQ_HANDLE, bleio_seq_handle, ON_BLEIO_SEQ_DESTROY_COMPLETE, on_destroy_complete, void*, context);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEMocks, , BLEIO_SEQ_RESULT, BLEIO_Seq_Run, BLEIO_SEQ_HANDLE, bleio_seq_handle);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLEIO_SEQ_RESULT, BLEIO_Seq_AddInstruction, BLEIO_SEQ_HANDLE, bleio_seq_handle, BLEIO_SEQ_INSTRUCTION*, instruction);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEMocks, , BLEIO_SEQ_RESULT, BLEIO_Seq_SetWriteQueueConfig, BLEIO_SEQ_HANDLE, bleio_seq_handle, const BLEIO_SEQ_WRITE_QUEUE_CONFIG*, config);
 
 BEGIN_TEST_SUITE(ble_ut)
 TEST_SUITE_INITIALIZE(TestClassInitialize)
@@ -63,6 +63,29 @@ struct
     BLEIO_GATT_RESULT result;
 } BLEIO_gatt_write_char_by_uuid_results;
 
+// when set BLEIO_gatt_read_char_by_uuid keeps the reads in flight till the
+// test calls g_read_complete
+#define MAX_DEFERRED_READS 2
+bool g_defer_read_complete = false;
+ON_BLEIO_GATT_ATTRIB_READ_COMPLETE g_read_complete = NULL;
+size_t g_deferred_read_count = 0;
+void* g_read_contexts[MAX_DEFERRED_READS];
+
+// when set BLEIO_gatt_write_char_by_uuid keeps the write in flight till the
+// test calls g_write_complete
+bool g_defer_write_complete = false;
+ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE g_write_complete = NULL;
+void* g_write_context = NULL;
+
+#define MAX_RECORDED_WRITES 8
+size_t g_write_complete_count = 0;
+void* g_write_complete_contexts[MAX_RECORDED_WRITES];
+BLEIO_SEQ_RESULT g_write_complete_results[MAX_RECORDED_WRITES];
+
+ON_BLEIO_GATT_NOTIFY_START_COMPLETE g_notify_start_complete = NULL;
+ON_BLEIO_GATT_ATTRIB_NOTIFY g_notify_callback = NULL;
+void* g_notify_context = NULL;
+
 gboolean g_expected_timer_return_value = TRUE;
 GSourceFunc g_timer_callback = NULL;
 gpointer g_timer_data = NULL;
@@ -81,6 +104,12 @@ public:
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_5(, void, on_write_complete, BLEIO_SEQ_HANDLE, bleio_seq_handle, void*, context, const char*, characteristic_uuid, BLEIO_SEQ_INSTRUCTION_TYPE, type, BLEIO_SEQ_RESULT, result2)
+        if (g_write_complete_count < MAX_RECORDED_WRITES)
+        {
+            g_write_complete_contexts[g_write_complete_count] = context;
+            g_write_complete_results[g_write_complete_count] = result2;
+        }
+        g_write_complete_count++;
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_6(, void, on_read_complete, BLEIO_SEQ_HANDLE, bleio_seq_handle, void*, context, const char*, characteristic_uuid, BLEIO_SEQ_INSTRUCTION_TYPE, type, BLEIO_SEQ_RESULT, result2, BUFFER_HANDLE, data)
@@ -147,22 +176,49 @@ public:
 
     MOCK_STATIC_METHOD_4(, int, BLEIO_gatt_read_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, ON_BLEIO_GATT_ATTRIB_READ_COMPLETE, on_bleio_gatt_attrib_read_complete, void*, callback_context)
         int result2 = 0;
-        on_bleio_gatt_attrib_read_complete(
-            bleio_gatt_handle,
-            callback_context,
-            BLEIO_gatt_read_char_by_uuid_results.result,
-            BLEIO_gatt_read_char_by_uuid_results.buffer,
-            BLEIO_gatt_read_char_by_uuid_results.size
-        );
+        if (g_defer_read_complete)
+        {
+            g_read_complete = on_bleio_gatt_attrib_read_complete;
+            if (g_deferred_read_count < MAX_DEFERRED_READS)
+            {
+                g_read_contexts[g_deferred_read_count] = callback_context;
+            }
+            g_deferred_read_count++;
+        }
+        else
+        {
+            on_bleio_gatt_attrib_read_complete(
+                bleio_gatt_handle,
+                callback_context,
+                BLEIO_gatt_read_char_by_uuid_results.result,
+                BLEIO_gatt_read_char_by_uuid_results.buffer,
+                BLEIO_gatt_read_char_by_uuid_results.size
+            );
+        }
     MOCK_METHOD_END(int, result2)
 
     MOCK_STATIC_METHOD_6(, int, BLEIO_gatt_write_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, const unsigned char*, buffer, size_t, size, ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE, on_bleio_gatt_attrib_write_complete, void*, callback_context)
         int result2 = 0;
-        on_bleio_gatt_attrib_write_complete(
-            bleio_gatt_handle,
-            callback_context,
-            BLEIO_gatt_write_char_by_uuid_results.result
-        );
+        if (g_defer_write_complete)
+        {
+            g_write_complete = on_bleio_gatt_attrib_write_complete;
+            g_write_context = callback_context;
+        }
+        else
+        {
+            on_bleio_gatt_attrib_write_complete(
+                bleio_gatt_handle,
+                callback_context,
+                BLEIO_gatt_write_char_by_uuid_results.result
+            );
+        }
+    MOCK_METHOD_END(int, result2)
+
+    MOCK_STATIC_METHOD_5(, int, BLEIO_gatt_notify_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, ON_BLEIO_GATT_NOTIFY_START_COMPLETE, on_bleio_gatt_notify_start_complete, ON_BLEIO_GATT_ATTRIB_NOTIFY, on_bleio_gatt_attrib_notify, void*, callback_context)
+        g_notify_start_complete = on_bleio_gatt_notify_start_complete;
+        g_notify_callback = on_bleio_gatt_attrib_notify;
+        g_notify_context = callback_context;
+        int result2 = 0;
     MOCK_METHOD_END(int, result2)
 
     MOCK_STATIC_METHOD_1(, void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle)
@@ -202,6 +258,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEIOSeqMocks, , size_t, BUFFER_length, BUFFER_HAN
 
 DECLARE_GLOBAL_MOCK_METHOD_4(CBLEIOSeqMocks, , int, BLEIO_gatt_read_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, ON_BLEIO_GATT_ATTRIB_READ_COMPLETE, on_bleio_gatt_attrib_read_complete, void*, callback_context);
 DECLARE_GLOBAL_MOCK_METHOD_6(CBLEIOSeqMocks, , int, BLEIO_gatt_write_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, const unsigned char*, buffer, size_t, size, ON_BLEIO_GATT_ATTRIB_WRITE_COMPLETE, on_bleio_gatt_attrib_write_complete, void*, callback_context);
+DECLARE_GLOBAL_MOCK_METHOD_5(CBLEIOSeqMocks, , int, BLEIO_gatt_notify_char_by_uuid, BLEIO_GATT_HANDLE, bleio_gatt_handle, const char*, ble_uuid, ON_BLEIO_GATT_NOTIFY_START_COMPLETE, on_bleio_gatt_notify_start_complete, ON_BLEIO_GATT_ATTRIB_NOTIFY, on_bleio_gatt_attrib_notify, void*, callback_context);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEIOSeqMocks, , void, BLEIO_gatt_destroy, BLEIO_GATT_HANDLE, bleio_gatt_handle);
 
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEIOSeqMocks, , guint, g_timeout_add, guint, interval, GSourceFunc, function, gpointer, data);
@@ -229,6 +286,16 @@ BEGIN_TEST_SUITE(bleio_seq_ut)
 
         g_timer_callback = NULL;
         g_timer_data = NULL;
+        g_notify_start_complete = NULL;
+        g_notify_callback = NULL;
+        g_notify_context = NULL;
+        g_defer_read_complete = false;
+        g_read_complete = NULL;
+        g_deferred_read_count = 0;
+        g_defer_write_complete = false;
+        g_write_complete = NULL;
+        g_write_context = NULL;
+        g_write_complete_count = 0;
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -909,13 +976,9 @@ BEGIN_TEST_SUITE(bleio_seq_ut)
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreArgument(1);                                         // in schedule_periodic
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);                                         // in schedule_read
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);                                         // in on_read_complete in bleio_seq_linux_schedule_read.c
         STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(3)
-            .IgnoreArgument(4);                                         // in schedule_read
+            .IgnoreArgument(4);                                         // in start_read
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));         // in BLEIO_Seq_Run
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));   // in BLEIO_Seq_Run
         STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
@@ -939,67 +1002,459 @@ BEGIN_TEST_SUITE(bleio_seq_ut)
         g_expected_timer_return_value = G_SOURCE_CONTINUE;
 
         ///act
-        auto result = BLEIO_Seq_Run(handle);
+        auto result = BLEIO_Seq_Run(handle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result);
+
+        ///cleanup
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+        
+        // call the timer callback once more to cancel the timer
+        g_expected_timer_return_value = G_SOURCE_REMOVE;
+        g_timer_callback(g_timer_data);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_13_009: [ If there are active instructions of type READ_PERIODIC in progress then the timers associated with those instructions shall be cancelled. ]*/
+    TEST_FUNCTION(timer_function_returns_G_SOURCE_REMOVE_after_shutdown_when_running_a_read_periodic_instruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 500 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+
+        // cause BLEIO_gatt_read_char_by_uuid to succeed
+        BLEIO_gatt_read_char_by_uuid_results.result = BLEIO_GATT_OK;
+        BLEIO_gatt_read_char_by_uuid_results.buffer = (const unsigned char*)"data";
+        BLEIO_gatt_read_char_by_uuid_results.size = 4;
+
+        g_expected_timer_return_value = G_SOURCE_CONTINUE;
+        (void)BLEIO_Seq_Run(handle);
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);                                         // in dec_ref_handle
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);                                         // in on_timer
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);                                         // in dec_ref_handle
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy((BLEIO_GATT_HANDLE)0x42));
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(instr1.characteristic_uuid));
+
+        ///act
+        g_expected_timer_return_value = G_SOURCE_REMOVE;
+        g_timer_callback(g_timer_data);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_50_001: [ The timer of a READ_PERIODIC instruction shall allocate the state of a read once and reuse it for every read of the instruction; a read that is due while the previous read of the instruction is still in flight shall use state of its own. ]*/
+    TEST_FUNCTION(timer_function_reuses_the_read_state_of_a_read_periodic_instruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 500 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+
+        // cause BLEIO_gatt_read_char_by_uuid to succeed
+        BLEIO_gatt_read_char_by_uuid_results.result = BLEIO_GATT_OK;
+        BLEIO_gatt_read_char_by_uuid_results.buffer = (const unsigned char*)"data";
+        BLEIO_gatt_read_char_by_uuid_results.size = 4;
+
+        g_expected_timer_return_value = G_SOURCE_CONTINUE;
+        (void)BLEIO_Seq_Run(handle);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);                                         // in start_read
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, NULL, fake_char_id, READ_PERIODIC, BLEIO_SEQ_OK, IGNORED_PTR_ARG))
+            .IgnoreArgument(6);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_create(IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = g_timer_callback(g_timer_data);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, G_SOURCE_CONTINUE, result);
+
+        ///cleanup
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+
+        // call the timer callback once more to cancel the timer
+        g_expected_timer_return_value = G_SOURCE_REMOVE;
+        g_timer_callback(g_timer_data);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_50_001: [ The timer of a READ_PERIODIC instruction shall allocate the state of a read once and reuse it for every read of the instruction; a read that is due while the previous read of the instruction is still in flight shall use state of its own. ]*/
+    TEST_FUNCTION(timer_function_allocates_read_state_when_the_previous_read_of_a_read_periodic_instruction_is_in_flight)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 500 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+
+        // keep the first read in flight
+        g_defer_read_complete = true;
+        g_expected_timer_return_value = G_SOURCE_CONTINUE;
+        (void)BLEIO_Seq_Run(handle);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);                                         // in schedule_read
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);                                         // in start_read
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+
+        ///act
+        auto result = g_timer_callback(g_timer_data);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, G_SOURCE_CONTINUE, result);
+        ASSERT_ARE_EQUAL(size_t, 2, g_deferred_read_count);
+        ASSERT_ARE_NOT_EQUAL(void_ptr, g_read_contexts[0], g_read_contexts[1]);
+
+        ///cleanup
+        g_read_complete((BLEIO_GATT_HANDLE)0x42, g_read_contexts[0], BLEIO_GATT_ERROR, NULL, 0);
+        g_read_complete((BLEIO_GATT_HANDLE)0x42, g_read_contexts[1], BLEIO_GATT_ERROR, NULL, 0);
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+        g_expected_timer_return_value = G_SOURCE_REMOVE;
+        g_timer_callback(g_timer_data);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_50_002: [ When the timer of a READ_PERIODIC instruction is cancelled while a read of the instruction is in flight the state of the read shall be freed once the read completes. ]*/
+    TEST_FUNCTION(read_state_of_a_read_periodic_instruction_is_freed_when_the_read_completes_after_the_timer_is_cancelled)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            READ_PERIODIC,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 500 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+
+        // keep the read in flight while the timer is cancelled
+        g_defer_read_complete = true;
+        g_expected_timer_return_value = G_SOURCE_CONTINUE;
+        (void)BLEIO_Seq_Run(handle);
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+        g_timer_callback(g_timer_data);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, NULL, fake_char_id, READ_PERIODIC, BLEIO_SEQ_OK, IGNORED_PTR_ARG))
+            .IgnoreArgument(6);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_create(IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);                                         // in dec_ref_handle
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);                                         // in on_read_complete
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);                                         // in dec_ref_handle
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy((BLEIO_GATT_HANDLE)0x42));
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(instr1.characteristic_uuid));
+
+        ///act
+        g_read_complete((BLEIO_GATT_HANDLE)0x42, g_read_contexts[0], BLEIO_GATT_OK, (const unsigned char*)"data", 4);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_13_014: [ BLEIO_Seq_Run shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Run_returns_error_when_malloc_fails_when_scheduling_a_notify_instruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((void*)NULL);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));         // in BLEIO_Seq_Run
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));   // in BLEIO_Seq_Run
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+
+        ///act
+        auto result = BLEIO_Seq_Run(handle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_ERROR, result);
+
+        ///cleanup
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_13_014: [ BLEIO_Seq_Run shall return BLEIO_SEQ_ERROR if an underlying platform call fails. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Run_returns_error_when_BLEIO_gatt_notify_char_by_uuid_fails_when_scheduling_a_notify_instruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));         // in BLEIO_Seq_Run
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));   // in BLEIO_Seq_Run
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_notify_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(5)
+            .SetFailReturn((int)1);
+
+        ///act
+        auto result = BLEIO_Seq_Run(handle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_ERROR, result);
+
+        ///cleanup
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_42_001: [ BLEIO_Seq_Run shall start notifications for all NOTIFY instructions. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Run_starts_notifications_for_notify_instruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));         // in BLEIO_Seq_Run
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));   // in BLEIO_Seq_Run
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_notify_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(5);
+
+        ///act
+        auto result = BLEIO_Seq_Run(handle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result);
+        ASSERT_IS_NOT_NULL((void*)g_notify_start_complete);
+        ASSERT_IS_NOT_NULL((void*)g_notify_callback);
+
+        ///cleanup
+        g_notify_start_complete((BLEIO_GATT_HANDLE)0x42, g_notify_context, BLEIO_GATT_OK);
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_42_003: [ If notifications could not be started for a NOTIFY instruction then the on_read_complete callback shall be invoked with BLEIO_SEQ_ERROR as the status of the operation and NULL data. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Run_calls_on_read_complete_with_error_when_notifications_fail_to_start)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            (void*)0x42,
+            { 0 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+        (void)BLEIO_Seq_Run(handle);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, (void*)0x42, fake_char_id, NOTIFY, BLEIO_SEQ_ERROR, NULL));
+
+        ///act
+        g_notify_start_complete((BLEIO_GATT_HANDLE)0x42, g_notify_context, BLEIO_GATT_ERROR);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLEIO_Seq_Destroy(handle, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_42_002: [ When a notification arrives for a NOTIFY instruction the on_read_complete callback shall be invoked passing in the value that was notified along with the status of the operation and the callback context that was passed in via the BLEIO_SEQ_INSTRUCTION structure. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Run_calls_on_read_complete_when_a_notification_arrives)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instr1 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            (void*)0x42,
+            { 0 }
+        };
+        const char* fake_char_id = STRING_c_str(instr1.characteristic_uuid);
+        VECTOR_push_back(instructions, &instr1, 1);
+        auto handle = BLEIO_Seq_Create(
+            (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
+        );
+        (void)BLEIO_Seq_Run(handle);
+        g_notify_start_complete((BLEIO_GATT_HANDLE)0x42, g_notify_context, BLEIO_GATT_OK);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instr1.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, BUFFER_create(IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, (void*)0x42, fake_char_id, NOTIFY, BLEIO_SEQ_OK, IGNORED_PTR_ARG))
+            .IgnoreArgument(6);
+        STRICT_EXPECTED_CALL(mocks, BUFFER_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        g_notify_callback((BLEIO_GATT_HANDLE)0x42, g_notify_context, (const unsigned char*)"data", 4);
 
         ///assert
         mocks.AssertActualAndExpectedCalls();
-        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result);
 
         ///cleanup
         BLEIO_Seq_Destroy(handle, NULL, NULL);
-        
-        // call the timer callback once more to cancel the timer
-        g_expected_timer_return_value = G_SOURCE_REMOVE;
-        g_timer_callback(g_timer_data);
     }
 
-    /*Tests_SRS_BLEIO_SEQ_13_009: [ If there are active instructions of type READ_PERIODIC in progress then the timers associated with those instructions shall be cancelled. ]*/
-    TEST_FUNCTION(timer_function_returns_G_SOURCE_REMOVE_after_shutdown_when_running_a_read_periodic_instruction)
+    /*Tests_SRS_BLEIO_SEQ_42_004: [ Notifications that arrive after BLEIO_Seq_Destroy has been called shall be dropped. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Destroy_drops_notifications_that_arrive_after_destroy)
     {
         ///arrange
         CBLEIOSeqMocks mocks;
         VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
         BLEIO_SEQ_INSTRUCTION instr1 =
         {
-            READ_PERIODIC,
+            NOTIFY,
             STRING_construct("fake_char_id"),
             NULL,
-            { 500 }
+            { 0 }
         };
         VECTOR_push_back(instructions, &instr1, 1);
         auto handle = BLEIO_Seq_Create(
             (BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete
         );
-
-        // cause BLEIO_gatt_read_char_by_uuid to succeed
-        BLEIO_gatt_read_char_by_uuid_results.result = BLEIO_GATT_OK;
-        BLEIO_gatt_read_char_by_uuid_results.buffer = (const unsigned char*)"data";
-        BLEIO_gatt_read_char_by_uuid_results.size = 4;
-
-        g_expected_timer_return_value = G_SOURCE_CONTINUE;
         (void)BLEIO_Seq_Run(handle);
+
+        // the pending start keeps the sequence alive past the destroy call
         BLEIO_Seq_Destroy(handle, NULL, NULL);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);                                         // in dec_ref_handle
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);                                         // in on_timer
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);                                         // in dec_ref_handle
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));
-        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy((BLEIO_GATT_HANDLE)0x42));
-        STRICT_EXPECTED_CALL(mocks, STRING_delete(instr1.characteristic_uuid));
-
         ///act
-        g_expected_timer_return_value = G_SOURCE_REMOVE;
-        g_timer_callback(g_timer_data);
+        g_notify_callback((BLEIO_GATT_HANDLE)0x42, g_notify_context, (const unsigned char*)"data", 4);
 
         ///assert
         mocks.AssertActualAndExpectedCalls();
 
         ///cleanup
+        g_notify_start_complete((BLEIO_GATT_HANDLE)0x42, g_notify_context, BLEIO_GATT_OK);
     }
 
     /*Tests_SRS_BLEIO_SEQ_13_016: [ BLEIO_Seq_Run shall schedule execution of all WRITE_AT_INIT instructions. ]*/
@@ -2424,15 +2879,11 @@ BEGIN_TEST_SUITE(bleio_seq_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+            .IgnoreArgument(1);                                         // in schedule_periodic
 
         STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(3)
-            .IgnoreArgument(4);                                         // in schedule_read
+            .IgnoreArgument(4);                                         // in start_read
 
         STRICT_EXPECTED_CALL(mocks, BUFFER_create(IGNORED_PTR_ARG, 4))
             .IgnoreArgument(1);
@@ -3283,4 +3734,310 @@ BEGIN_TEST_SUITE(bleio_seq_ut)
         BUFFER_delete(instruction2.data.buffer);
     }
 
+    /*Tests_SRS_BLEIO_SEQ_42_005: [ BLEIO_Seq_AddInstruction shall start notifications if the instruction is a NOTIFY instruction. ]*/
+    TEST_FUNCTION(BLEIO_Seq_AddInstruction_starts_notifications_for_notify_instruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instruction =
+        {
+            WRITE_ONCE,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { .buffer = BUFFER_create((const unsigned char*)"data", 4) }
+        };
+        VECTOR_push_back(instructions, &instruction, 1);
+        auto sequence = BLEIO_Seq_Create((BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete);
+        (void)BLEIO_Seq_Run(sequence);
+
+        BLEIO_SEQ_INSTRUCTION instruction2 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+
+        const char* fake_char_id = STRING_c_str(instruction2.characteristic_uuid);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, STRING_length(instruction2.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, STRING_c_str(instruction2.characteristic_uuid));
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_notify_char_by_uuid((BLEIO_GATT_HANDLE)0x42, fake_char_id, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(5);
+
+        ///act
+        auto result = BLEIO_Seq_AddInstruction(sequence, &instruction2);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result);
+
+        ///cleanup
+        g_notify_start_complete((BLEIO_GATT_HANDLE)0x42, g_notify_context, BLEIO_GATT_OK);
+        BLEIO_Seq_Destroy(sequence, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_13_006: [ BLEIO_Seq_Destroy shall free all resources associated with the handle once all the pending I/O operations are complete. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Destroy_frees_notify_instruction_added_via_BLEIO_Seq_AddInstruction)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instruction =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instruction, 1);
+        BLEIO_gatt_read_char_by_uuid_results.result = BLEIO_GATT_OK;
+        BLEIO_gatt_read_char_by_uuid_results.buffer = (unsigned char*)"data";
+        BLEIO_gatt_read_char_by_uuid_results.size = 4;
+        auto sequence = BLEIO_Seq_Create((BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete);
+        (void)BLEIO_Seq_Run(sequence);
+
+        BLEIO_SEQ_INSTRUCTION instruction2 =
+        {
+            NOTIFY,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        (void)BLEIO_Seq_AddInstruction(sequence, &instruction2);
+        g_notify_start_complete((BLEIO_GATT_HANDLE)0x42, g_notify_context, BLEIO_GATT_OK);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));         // in BLEIO_Seq_Destroy
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(instructions));         // in dec_ref_handle
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));   // in BLEIO_Seq_Destroy
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(instructions, 0));   // in dec_ref_handle
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(instructions));
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(instruction.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, BLEIO_gatt_destroy((BLEIO_GATT_HANDLE)0x42));
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(instruction2.characteristic_uuid));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))      // the copied instruction
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))      // the notify context
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))      // the handle data
+            .IgnoreArgument(1);
+
+        ///act
+        BLEIO_Seq_Destroy(sequence, NULL, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_48_003: [ If writes are not ordered then a WRITE_ONCE or WRITE_AT_INIT instruction added while another write to the same characteristic is in flight shall replace the write that is waiting for it, if any, and the on_write_complete callback shall be invoked for the replaced write with BLEIO_SEQ_SUPERSEDED. ]*/
+    /*Tests_SRS_BLEIO_SEQ_48_005: [ When a write completes BLEIO_Seq_AddInstruction shall start the next write to the same characteristic, if any, unless BLEIO_Seq_Destroy has been called. ]*/
+    TEST_FUNCTION(BLEIO_Seq_AddInstruction_supersedes_the_write_waiting_on_a_busy_characteristic)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instruction =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instruction, 1);
+        auto sequence = BLEIO_Seq_Create((BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete);
+        (void)BLEIO_Seq_Run(sequence);
+
+        BLEIO_gatt_write_char_by_uuid_results.result = BLEIO_GATT_OK;
+        g_defer_write_complete = true;
+
+        BLEIO_SEQ_INSTRUCTION writes[3];
+        for (size_t i = 0; i < 3; i++)
+        {
+            writes[i].instruction_type = WRITE_ONCE;
+            writes[i].characteristic_uuid = STRING_construct("fake_char_id");
+            writes[i].context = (void*)(i + 1);
+            writes[i].data.buffer = BUFFER_create((const unsigned char*)"data", 4);
+        }
+
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result1 = BLEIO_Seq_AddInstruction(sequence, &writes[0]);
+        auto result2 = BLEIO_Seq_AddInstruction(sequence, &writes[1]);
+        auto result3 = BLEIO_Seq_AddInstruction(sequence, &writes[2]);
+        size_t count_after_add = g_write_complete_count;
+        g_write_complete((BLEIO_GATT_HANDLE)0x42, g_write_context, BLEIO_GATT_OK);
+        g_write_complete((BLEIO_GATT_HANDLE)0x42, g_write_context, BLEIO_GATT_OK);
+
+        ///assert
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result1);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result2);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result3);
+        ASSERT_ARE_EQUAL(size_t, 1, count_after_add);
+        ASSERT_ARE_EQUAL(size_t, 3, g_write_complete_count);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)2, g_write_complete_contexts[0]);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_SUPERSEDED, g_write_complete_results[0]);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)1, g_write_complete_contexts[1]);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, g_write_complete_results[1]);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)3, g_write_complete_contexts[2]);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, g_write_complete_results[2]);
+
+        ///cleanup
+        BLEIO_Seq_Destroy(sequence, NULL, NULL);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_48_002: [ BLEIO_Seq_SetWriteQueueConfig shall apply config to the writes that are added after it returns and return BLEIO_SEQ_OK. ]*/
+    /*Tests_SRS_BLEIO_SEQ_48_004: [ If writes are ordered then BLEIO_Seq_AddInstruction shall queue a WRITE_ONCE or WRITE_AT_INIT instruction behind the writes to the same characteristic and shall return BLEIO_SEQ_QUEUE_FULL if max_depth writes are already waiting. ]*/
+    /*Tests_SRS_BLEIO_SEQ_48_007: [ If BLEIO_Seq_AddInstruction does not return BLEIO_SEQ_OK then the caller shall keep ownership of the characteristic_uuid and buffer of the instruction. ]*/
+    TEST_FUNCTION(BLEIO_Seq_AddInstruction_executes_ordered_writes_in_order_and_returns_queue_full_when_the_queue_is_full)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instruction =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instruction, 1);
+        auto sequence = BLEIO_Seq_Create((BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete);
+        (void)BLEIO_Seq_Run(sequence);
+
+        BLEIO_SEQ_WRITE_QUEUE_CONFIG config = { true, 2 };
+        auto config_result = BLEIO_Seq_SetWriteQueueConfig(sequence, &config);
+
+        BLEIO_gatt_write_char_by_uuid_results.result = BLEIO_GATT_OK;
+        g_defer_write_complete = true;
+
+        BLEIO_SEQ_INSTRUCTION writes[4];
+        for (size_t i = 0; i < 4; i++)
+        {
+            writes[i].instruction_type = WRITE_ONCE;
+            writes[i].characteristic_uuid = STRING_construct("fake_char_id");
+            writes[i].context = (void*)(i + 1);
+            writes[i].data.buffer = BUFFER_create((const unsigned char*)"data", 4);
+        }
+
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result1 = BLEIO_Seq_AddInstruction(sequence, &writes[0]);
+        auto result2 = BLEIO_Seq_AddInstruction(sequence, &writes[1]);
+        auto result3 = BLEIO_Seq_AddInstruction(sequence, &writes[2]);
+        auto result4 = BLEIO_Seq_AddInstruction(sequence, &writes[3]);
+        g_write_complete((BLEIO_GATT_HANDLE)0x42, g_write_context, BLEIO_GATT_OK);
+        g_write_complete((BLEIO_GATT_HANDLE)0x42, g_write_context, BLEIO_GATT_OK);
+        g_write_complete((BLEIO_GATT_HANDLE)0x42, g_write_context, BLEIO_GATT_OK);
+
+        ///assert
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, config_result);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result1);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result2);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_OK, result3);
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_QUEUE_FULL, result4);
+        ASSERT_ARE_EQUAL(size_t, 3, g_write_complete_count);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)1, g_write_complete_contexts[0]);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)2, g_write_complete_contexts[1]);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)3, g_write_complete_contexts[2]);
+
+        ///cleanup
+        BLEIO_Seq_Destroy(sequence, NULL, NULL);
+        STRING_delete(writes[3].characteristic_uuid);
+        BUFFER_delete(writes[3].data.buffer);
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_48_009: [ Writes that are waiting for the write in flight on their characteristic when BLEIO_Seq_Destroy is called shall be discarded. ]*/
+    TEST_FUNCTION(BLEIO_Seq_Destroy_discards_the_writes_waiting_on_a_busy_characteristic)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        VECTOR_HANDLE instructions = VECTOR_create(sizeof(BLEIO_SEQ_INSTRUCTION));
+        BLEIO_SEQ_INSTRUCTION instruction =
+        {
+            READ_ONCE,
+            STRING_construct("fake_char_id"),
+            NULL,
+            { 0 }
+        };
+        VECTOR_push_back(instructions, &instruction, 1);
+        auto sequence = BLEIO_Seq_Create((BLEIO_GATT_HANDLE)0x42, instructions, on_read_complete, on_write_complete);
+        (void)BLEIO_Seq_Run(sequence);
+
+        BLEIO_gatt_write_char_by_uuid_results.result = BLEIO_GATT_OK;
+        g_defer_write_complete = true;
+
+        BLEIO_SEQ_INSTRUCTION writes[2];
+        for (size_t i = 0; i < 2; i++)
+        {
+            writes[i].instruction_type = WRITE_ONCE;
+            writes[i].characteristic_uuid = STRING_construct("fake_char_id");
+            writes[i].context = (void*)(i + 1);
+            writes[i].data.buffer = BUFFER_create((const unsigned char*)"data", 4);
+        }
+        (void)BLEIO_Seq_AddInstruction(sequence, &writes[0]);
+        (void)BLEIO_Seq_AddInstruction(sequence, &writes[1]);
+
+        mocks.ResetAllCalls();
+
+        ///act
+        BLEIO_Seq_Destroy(sequence, NULL, NULL);
+        g_write_complete((BLEIO_GATT_HANDLE)0x42, g_write_context, BLEIO_GATT_OK);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_write_complete_count);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)1, g_write_complete_contexts[0]);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_48_001: [ BLEIO_Seq_SetWriteQueueConfig shall return BLEIO_SEQ_ERROR if bleio_seq_handle or config is NULL or if ordered is true and max_depth is zero. ]*/
+    TEST_FUNCTION(BLEIO_Seq_SetWriteQueueConfig_returns_error_for_NULL_bleio_seq_handle)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        BLEIO_SEQ_WRITE_QUEUE_CONFIG config = { true, 4 };
+
+        ///act
+        auto result = BLEIO_Seq_SetWriteQueueConfig(NULL, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_ERROR, result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_SEQ_48_001: [ BLEIO_Seq_SetWriteQueueConfig shall return BLEIO_SEQ_ERROR if bleio_seq_handle or config is NULL or if ordered is true and max_depth is zero. ]*/
+    TEST_FUNCTION(BLEIO_Seq_SetWriteQueueConfig_returns_error_for_ordered_writes_with_zero_depth)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+        BLEIO_SEQ_WRITE_QUEUE_CONFIG config = { true, 0 };
+
+        ///act
+        auto result = BLEIO_Seq_SetWriteQueueConfig((BLEIO_SEQ_HANDLE)0x42, &config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_ERROR, result);
+
+        ///cleanup
+    }
+
 END_TEST_SUITE(bleio_seq_ut)
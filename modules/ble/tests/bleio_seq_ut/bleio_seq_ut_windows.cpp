@@ -157,4 +157,20 @@ BEGIN_TEST_SUITE(bleio_seq_ut)
         ///cleanup
     }
 
+    /*Tests_SRS_BLEIO_SEQ_48_008: [ On Windows this function shall return BLEIO_SEQ_ERROR. ]*/
+    TEST_FUNCTION(BLEIO_Seq_SetWriteQueueConfig_returns_error)
+    {
+        ///arrange
+        CBLEIOSeqMocks mocks;
+
+        ///act
+        auto result = BLEIO_Seq_SetWriteQueueConfig((BLEIO_SEQ_HANDLE)0x42, (const BLEIO_SEQ_WRITE_QUEUE_CONFIG*)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(BLEIO_SEQ_RESULT, BLEIO_SEQ_ERROR, result);
+
+        ///cleanup
+    }
+
 END_TEST_SUITE(bleio_seq_ut)
@@ -166,6 +166,7 @@ public:
     std::map<gpointer, gpointer, GCompareFuncComparer> _tree;
     GDestroyNotify _key_destroy_func;
     GDestroyNotify _value_destroy_func;
+    size_t _ref_count;
 
 public:
     CGTree(GCompareDataFunc key_compare_func,
@@ -174,10 +175,16 @@ public:
            GDestroyNotify value_destroy_func) :
         _tree(GCompareFuncComparer(key_compare_func, key_compare_data)),
         _key_destroy_func(key_destroy_func),
-        _value_destroy_func(value_destroy_func)
+        _value_destroy_func(value_destroy_func),
+        _ref_count(1)
     {}
 
     ~CGTree()
+    {
+        clear();
+    }
+
+    void clear()
     {
         if (_key_destroy_func != NULL || _value_destroy_func != NULL)
         {
@@ -195,6 +202,20 @@ public:
                 }
             }
         }
+        _tree.clear();
+    }
+
+    void ref()
+    {
+        ++_ref_count;
+    }
+
+    void unref()
+    {
+        if (--_ref_count == 0)
+        {
+            delete this;
+        }
     }
 
     void insert(gpointer key, gpointer value)
@@ -222,6 +243,32 @@ public:
         auto it = _tree.find(key);
         return it == _tree.end() ? NULL : it->second;
     }
+
+    gboolean remove(const gpointer key)
+    {
+        gboolean result;
+        auto it = _tree.find(key);
+        if (it == _tree.end())
+        {
+            result = FALSE;
+        }
+        else
+        {
+            gpointer old_key = it->first;
+            gpointer old_value = it->second;
+            _tree.erase(it);
+            if (_key_destroy_func)
+            {
+                _key_destroy_func(old_key);
+            }
+            if (_value_destroy_func)
+            {
+                _value_destroy_func(old_value);
+            }
+            result = TRUE;
+        }
+        return result;
+    }
 };
 
 /*
@@ -1045,6 +1092,16 @@ static AsyncCallFinisherValueType<gboolean>             g_bluez_device__call_dis
 static AsyncCallFinisherRefType<bluezcharacteristic>    g_bluez_characteristic__proxy_new_finisher;
 static AsyncCallFinisherValueType<gboolean>             g_bluez_characteristic__call_read_value_finisher;
 static AsyncCallFinisherValueType<gboolean>             g_bluez_characteristic__call_write_value_finisher;
+static AsyncCallFinisherValueType<gboolean>             g_bluez_characteristic__call_start_notify_finisher;
+
+// StopNotify is not waited for so it has no finisher
+static size_t g_bluez_characteristic__call_stop_notify_count;
+
+// The handler and user data last connected to the "g-properties-changed"
+// signal of a characteristic proxy.
+typedef void(*PROPERTIES_CHANGED_HANDLER)(GDBusProxy*, GVariant*, GStrv, gpointer);
+static PROPERTIES_CHANGED_HANDLER g_properties_changed_handler = NULL;
+static gpointer g_properties_changed_data = NULL;
 
 // The BLE config we use in all tests.
 static BLE_DEVICE_CONFIG g_device_config =
@@ -1058,6 +1115,29 @@ static const char* g_bluez_device_path = "/org/bluez/hci0/dev_AA_BB_CC_DD_EE_FF"
 // use them in tests.
 std::vector<std::string> g_char_uuids;
 
+// The virtual device used by the simulator tests.
+static BLEIO_GATT_SIM_CONFIG g_sim_config =
+{
+    10,     // latency_in_ms
+    0,      // jitter_in_ms
+    0.0,    // connect_failure_rate
+    0.0,    // io_failure_rate
+    1000,   // notify_interval_in_ms
+    4       // value_size
+};
+
+// The last GLIB timeout that was added; the simulator tests fire it by hand.
+static GSourceFunc g_timeout_function = NULL;
+static gpointer g_timeout_data = NULL;
+static guint g_timeout_interval = 0;
+static guint g_timeout_source = 0;
+
+// What the completion callbacks were last invoked with.
+static BLEIO_GATT_CONNECT_RESULT g_connect_result = BLEIO_GATT_CONNECT_ERROR;
+static BLEIO_GATT_RESULT g_io_result = BLEIO_GATT_ERROR;
+static std::vector<unsigned char> g_value;
+static size_t g_callback_count = 0;
+
 TYPED_MOCK_CLASS(CBLEGATTIOMocks, CGlobalMock)
 {
 public:
@@ -1074,9 +1154,20 @@ public:
         GTree* result2 = (GTree*)new CGTree(key_compare_func, key_compare_data, key_destroy_func, value_destroy_func);
     MOCK_METHOD_END(GTree*, result2);
 
+    MOCK_STATIC_METHOD_1(, GTree*, g_tree_ref, GTree*, tree)
+        CGTree* gtree = (CGTree*)tree;
+        gtree->ref();
+    MOCK_METHOD_END(GTree*, tree);
+
     MOCK_STATIC_METHOD_1(, void, g_tree_unref, GTree*, tree)
         CGTree* gtree = (CGTree*)tree;
-        delete gtree;
+        gtree->unref();
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, void, g_tree_destroy, GTree*, tree)
+        CGTree* gtree = (CGTree*)tree;
+        gtree->clear();
+        gtree->unref();
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_3(, void, g_tree_insert, GTree*, tree, gpointer, key, gpointer, value)
@@ -1089,6 +1180,11 @@ public:
         gpointer result2 = const_cast<gpointer>(gtree->lookup((const gpointer)key));
     MOCK_METHOD_END(gpointer, result2);
 
+    MOCK_STATIC_METHOD_2(, gboolean, g_tree_remove, GTree*, tree, gconstpointer, key)
+        CGTree* gtree = (CGTree*)tree;
+        gboolean result2 = gtree->remove((const gpointer)key);
+    MOCK_METHOD_END(gboolean, result2);
+
     MOCK_STATIC_METHOD_1(, GString*, g_string_new, const gchar*, init)
         GString* result2 = (GString*)malloc(sizeof(GString));
         result2->str = init != NULL ? g_strdup(init) : (gchar*)g_new0(gchar, 4);
@@ -1124,17 +1220,44 @@ public:
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_5(, void, on_read_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_RESULT, result2, const unsigned char*, buffer, size_t, size)
+        g_io_result = result2;
+        g_value.assign(buffer, buffer == NULL ? buffer : buffer + size);
+        g_callback_count++;
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_3(, void, on_write_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_RESULT, result2)
+        g_io_result = result2;
+        g_callback_count++;
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_2(, void, on_disconnect_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context)
     MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_3(, void, on_gatt_connect_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_CONNECT_RESULT, connect_result)
+        g_connect_result = connect_result;
+        g_callback_count++;
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_3(, void, on_notify_start_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_RESULT, result2)
+        g_io_result = result2;
+        g_callback_count++;
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_4(, void, on_notify, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, const unsigned char*, buffer, size_t, size)
+        g_value.assign(buffer, buffer == NULL ? buffer : buffer + size);
+        g_callback_count++;
     MOCK_VOID_METHOD_END()
 
+    MOCK_STATIC_METHOD_3(, guint, g_timeout_add, guint, interval, GSourceFunc, function, gpointer, data)
+        g_timeout_function = function;
+        g_timeout_data = data;
+        g_timeout_interval = interval;
+        guint result2 = ++g_timeout_source;
+    MOCK_METHOD_END(guint, result2);
+
+    MOCK_STATIC_METHOD_1(, gboolean, g_source_remove, guint, tag)
+    MOCK_METHOD_END(gboolean, TRUE);
+
     MOCK_STATIC_METHOD_3(, GIO_ASYNCSEQ_HANDLE, GIO_Async_Seq_Create, gpointer, async_seq_context, GIO_ASYNCSEQ_ERROR_CALLBACK, error_callback, GIO_ASYNCSEQ_COMPLETE_CALLBACK, complete_callback)
         auto result2 = BASEIMPLEMENTATION::GIO_Async_Seq_Create(async_seq_context, error_callback, complete_callback);
     MOCK_METHOD_END(GIO_ASYNCSEQ_HANDLE, result2);
@@ -1151,6 +1274,11 @@ public:
         auto result2 = BASEIMPLEMENTATION::GIO_Async_Seq_Run_Async(async_seq_handle);
     MOCK_METHOD_END(GIO_ASYNCSEQ_RESULT, result2);
 
+    MOCK_STATIC_METHOD_1(, gpointer, g_object_ref, gpointer, object)
+        RefCountObjectBase* refobj = (RefCountObjectBase*)object;
+        refobj->inc_ref();
+    MOCK_METHOD_END(gpointer, object);
+
     MOCK_STATIC_METHOD_1(, void, g_object_unref, gpointer, object)
         RefCountObjectBase* refobj = (RefCountObjectBase*)object;
         refobj->dec_ref();
@@ -1222,6 +1350,27 @@ public:
         gboolean result2 = g_bluez_characteristic__call_write_value_finisher.async_call_finish(res, error);
     MOCK_METHOD_END(gboolean, result2);
 
+    MOCK_STATIC_METHOD_4(, void, bluez_characteristic__call_start_notify, bluezcharacteristic*, proxy, GCancellable*, cancellable, GAsyncReadyCallback, callback, gpointer, user_data)
+        callback(NULL, NULL, user_data);
+    MOCK_VOID_METHOD_END();
+
+    MOCK_STATIC_METHOD_3(, gboolean, bluez_characteristic__call_start_notify_finish, bluezcharacteristic*, proxy, GAsyncResult*, res, GError**, error)
+        gboolean result2 = g_bluez_characteristic__call_start_notify_finisher.async_call_finish(res, error);
+    MOCK_METHOD_END(gboolean, result2);
+
+    MOCK_STATIC_METHOD_4(, void, bluez_characteristic__call_stop_notify, bluezcharacteristic*, proxy, GCancellable*, cancellable, GAsyncReadyCallback, callback, gpointer, user_data)
+        g_bluez_characteristic__call_stop_notify_count++;
+    MOCK_VOID_METHOD_END();
+
+    MOCK_STATIC_METHOD_6(, gulong, g_signal_connect_data, gpointer, instance, const gchar*, detailed_signal, GCallback, c_handler, gpointer, data, GClosureNotify, destroy_data, GConnectFlags, connect_flags)
+        g_properties_changed_handler = (PROPERTIES_CHANGED_HANDLER)c_handler;
+        g_properties_changed_data = data;
+        gulong result2 = 1;
+    MOCK_METHOD_END(gulong, result2);
+
+    MOCK_STATIC_METHOD_2(, void, g_signal_handler_disconnect, gpointer, instance, gulong, handler_id)
+    MOCK_VOID_METHOD_END();
+
     MOCK_STATIC_METHOD_1(, GList*, g_dbus_object_manager_get_objects, GDBusObjectManager*, manager)
         auto om = (FakeObjectManager*)((RefCountObjectDelete<FakeObjectManager>*)manager)->object;
         GList* result2 = om->get_objects();
@@ -1317,6 +1466,21 @@ public:
         ((RefCountObjectDelete<CGVariant>*)value)->dec_ref();
     MOCK_VOID_METHOD_END();
 
+    // the tests pass the changed value itself as the dictionary of changed
+    // properties and pass NULL when the 'Value' property did not change
+    MOCK_STATIC_METHOD_3(, GVariant*, g_variant_lookup_value, GVariant*, dictionary, const gchar*, key, const GVariantType*, expected_type)
+        GVariant* result2 = dictionary;
+        if (result2 != NULL)
+        {
+            ((RefCountObjectDelete<CGVariant>*)result2)->inc_ref();
+        }
+    MOCK_METHOD_END(GVariant*, result2);
+
+    MOCK_STATIC_METHOD_3(, gconstpointer, g_variant_get_fixed_array, GVariant*, value, gsize*, n_elements, gsize, element_size)
+        CGVariant* var = ((RefCountObjectDelete<CGVariant>*)value)->object;
+        gconstpointer result2 = var->store.data.fixed_array->get_data(n_elements);
+    MOCK_METHOD_END(gconstpointer, result2);
+
     MOCK_STATIC_METHOD_1(, const gchar*, g_dbus_object_get_object_path, GDBusObject*, object)
         DBUSObject* dbus_object = (DBUSObject*)((RefCountObjectDelete<DBUSObject>*)object)->object;
         const gchar* result2 = dbus_object->object_path.c_str();
@@ -1347,9 +1511,12 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void*, gballoc_malloc, size_t, s
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void, gballoc_free, void*, ptr);
 
 DECLARE_GLOBAL_MOCK_METHOD_4(CBLEGATTIOMocks, , GTree*, g_tree_new_full, GCompareDataFunc, key_compare_func, gpointer, key_compare_data, GDestroyNotify, key_destroy_func, GDestroyNotify, value_destroy_func);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , GTree*, g_tree_ref, GTree*, tree);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void, g_tree_unref, GTree*, tree);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void, g_tree_destroy, GTree*, tree);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , void, g_tree_insert, GTree*, tree, gpointer, key, gpointer, value);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , gpointer, g_tree_lookup, GTree*, tree, gconstpointer, key);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , gboolean, g_tree_remove, GTree*, tree, gconstpointer, key);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , GList*, g_list_find_custom, GList*, list, gconstpointer, data, GCompareFunc, func);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , void, g_list_foreach, GList*, list, GFunc, func, gpointer, user_data);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void, g_list_free, GList*, list);
@@ -1368,6 +1535,8 @@ DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , const gchar*, g_variant_get_stri
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , GVariant*, g_variant_new_from_bytes, const GVariantType*, type, GBytes*, bytes, gboolean, trusted);
 DECLARE_GLOBAL_MOCK_METHOD_4(CBLEGATTIOMocks, , GVariant*, g_variant_new_fixed_array, const GVariantType*, element_type, gconstpointer, elements, gsize, n_elements, gsize, element_size);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , GVariant*, g_variant_new_tuple, GVariant * const *, children, gsize, n_children);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , GVariant*, g_variant_lookup_value, GVariant*, dictionary, const gchar*, key, const GVariantType*, expected_type);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , gconstpointer, g_variant_get_fixed_array, GVariant*, value, gsize*, n_elements, gsize, element_size);
 
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , GIO_ASYNCSEQ_HANDLE, GIO_Async_Seq_Create, gpointer, async_seq_context, GIO_ASYNCSEQ_ERROR_CALLBACK, error_callback, GIO_ASYNCSEQ_COMPLETE_CALLBACK, complete_callback);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void, GIO_Async_Seq_Destroy, GIO_ASYNCSEQ_HANDLE, async_seq_handle);
@@ -1399,6 +1568,13 @@ DECLARE_GLOBAL_MOCK_METHOD_4(CBLEGATTIOMocks, , gboolean, bluez_characteristic__
 DECLARE_GLOBAL_MOCK_METHOD_5(CBLEGATTIOMocks, , void, bluez_characteristic__call_write_value, bluezcharacteristic*, proxy, const gchar *, arg_value, GCancellable *, cancellable, GAsyncReadyCallback, callback, gpointer, user_data);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , gboolean, bluez_characteristic__call_write_value_finish, bluezcharacteristic*, proxy, GAsyncResult*, res, GError**, error);
 
+DECLARE_GLOBAL_MOCK_METHOD_4(CBLEGATTIOMocks, , void, bluez_characteristic__call_start_notify, bluezcharacteristic*, proxy, GCancellable*, cancellable, GAsyncReadyCallback, callback, gpointer, user_data);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , gboolean, bluez_characteristic__call_start_notify_finish, bluezcharacteristic*, proxy, GAsyncResult*, res, GError**, error);
+DECLARE_GLOBAL_MOCK_METHOD_4(CBLEGATTIOMocks, , void, bluez_characteristic__call_stop_notify, bluezcharacteristic*, proxy, GCancellable*, cancellable, GAsyncReadyCallback, callback, gpointer, user_data);
+
+DECLARE_GLOBAL_MOCK_METHOD_6(CBLEGATTIOMocks, , gulong, g_signal_connect_data, gpointer, instance, const gchar*, detailed_signal, GCallback, c_handler, gpointer, data, GClosureNotify, destroy_data, GConnectFlags, connect_flags);
+DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , void, g_signal_handler_disconnect, gpointer, instance, gulong, handler_id);
+
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , const gchar*, g_dbus_proxy_get_object_path, GDBusProxy*, proxy);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , const gchar*, g_dbus_proxy_get_interface_name, GDBusProxy*, proxy);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , const gchar*, g_dbus_object_get_object_path, GDBusObject*, object);
@@ -1407,12 +1583,18 @@ DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , GVariant*, g_dbus_proxy_get_cach
 DECLARE_GLOBAL_MOCK_METHOD_8(CBLEGATTIOMocks, , void, g_dbus_proxy_call, GDBusProxy*, proxy, const gchar*, method_name, GVariant*, parameters, GDBusCallFlags, flags, gint, timeout_msec, GCancellable*, cancellable, GAsyncReadyCallback, callback, gpointer, user_data)
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , GVariant*, g_dbus_proxy_call_finish, GDBusProxy*, proxy, GAsyncResult*, res, GError**, error);
 
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , gpointer, g_object_ref, gpointer, object);
 DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , void, g_object_unref, gpointer, object);
 
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , void, on_gatt_connect_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_CONNECT_RESULT, connect_result);
 DECLARE_GLOBAL_MOCK_METHOD_5(CBLEGATTIOMocks, , void, on_read_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_RESULT, result2, const unsigned char*, buffer, size_t, size);
 DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , void, on_write_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_RESULT, result2);
 DECLARE_GLOBAL_MOCK_METHOD_2(CBLEGATTIOMocks, , void, on_disconnect_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context);
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , void, on_notify_start_complete, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, BLEIO_GATT_RESULT, result2);
+DECLARE_GLOBAL_MOCK_METHOD_4(CBLEGATTIOMocks, , void, on_notify, BLEIO_GATT_HANDLE, bleio_gatt_handle, void*, context, const unsigned char*, buffer, size_t, size);
+
+DECLARE_GLOBAL_MOCK_METHOD_3(CBLEGATTIOMocks, , guint, g_timeout_add, guint, interval, GSourceFunc, function, gpointer, data);
+DECLARE_GLOBAL_MOCK_METHOD_1(CBLEGATTIOMocks, , gboolean, g_source_remove, guint, tag);
 
 /**
  * Poor man's mock for the var args function GIO_Async_Seq_Add.
@@ -1444,6 +1626,21 @@ GIO_ASYNCSEQ_RESULT GIO_Async_Seq_Add(
     return result;
 }
 
+// runs the operation that the simulator scheduled last
+static void fire_last_timeout(void)
+{
+    (void)g_timeout_function(g_timeout_data);
+}
+
+static BLEIO_GATT_HANDLE create_connected_sim_handle(const BLEIO_GATT_SIM_CONFIG* sim_config)
+{
+    BLEIO_GATT_HANDLE result = BLEIO_gatt_sim_create(&g_device_config, sim_config);
+    (void)BLEIO_gatt_connect(result, on_gatt_connect_complete, NULL);
+    fire_last_timeout();
+    g_callback_count = 0;
+    return result;
+}
+
 BEGIN_TEST_SUITE(gatt_io_ut)
     TEST_SUITE_INITIALIZE(TestClassInitialize)
     {
@@ -1476,6 +1673,19 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         g_bluez_characteristic__proxy_new_finisher.reset();
         g_bluez_characteristic__call_read_value_finisher.reset();
         g_bluez_characteristic__call_write_value_finisher.reset();
+        g_bluez_characteristic__call_start_notify_finisher.reset();
+        g_bluez_characteristic__call_stop_notify_count = 0;
+
+        g_properties_changed_handler = NULL;
+        g_properties_changed_data = NULL;
+
+        g_timeout_function = NULL;
+        g_timeout_data = NULL;
+        g_timeout_interval = 0;
+        g_connect_result = BLEIO_GATT_CONNECT_ERROR;
+        g_io_result = BLEIO_GATT_ERROR;
+        g_value.clear();
+        g_callback_count = 0;
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -1548,6 +1758,67 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         ///cleanup
     }
 
+    /*Tests_SRS_BLEIO_GATT_13_002: [ BLEIO_gatt_create shall return NULL when any of the underlying platform calls fail. ]*/
+    TEST_FUNCTION(BLEIO_gatt_create_returns_NULL_when_proxy_cache_g_tree_new_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, NULL, g_free, g_object_unref))
+            .IgnoreArgument(1)
+            .SetFailReturn((GTree*)NULL);
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLEIO_gatt_create(&g_device_config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_002: [ BLEIO_gatt_create shall return NULL when any of the underlying platform calls fail. ]*/
+    TEST_FUNCTION(BLEIO_gatt_create_returns_NULL_when_notify_map_g_tree_new_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, NULL, g_free, g_object_unref))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, NULL, g_free, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(4)
+            .SetFailReturn((GTree*)NULL);
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLEIO_gatt_create(&g_device_config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
     /*Tests_SRS_BLEIO_GATT_13_001: [ BLEIO_gatt_create shall return a non-NULL handle on successful execution. ]*/
     TEST_FUNCTION(BLEIO_gatt_create_succeeds)
     {
@@ -1558,6 +1829,11 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, NULL, g_free, g_object_unref))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_new_full(IGNORED_PTR_ARG, NULL, g_free, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(4); // notification subscriptions
 
         ///act
         auto result = BLEIO_gatt_create(&g_device_config);
@@ -1595,6 +1871,10 @@ BEGIN_TEST_SUITE(gatt_io_ut)
 
         STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
@@ -1608,6 +1888,7 @@ BEGIN_TEST_SUITE(gatt_io_ut)
     }
 
     /*Tests_SRS_BLEIO_GATT_13_004: [ BLEIO_gatt_destroy shall free all resources associated with the handle. ]*/
+    /*Tests_SRS_BLEIO_GATT_43_003: [ BLEIO_gatt_destroy shall release the shared d-bus connection and object manager only when the last handle in the process is destroyed. ]*/
     TEST_FUNCTION(BLEIO_gatt_destroy_frees_things_with_connected_handle)
     {
         ///arrange
@@ -1624,6 +1905,10 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(1); // device
         STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
@@ -2187,6 +2472,7 @@ BEGIN_TEST_SUITE(gatt_io_ut)
     /*Tests_SRS_BLEIO_GATT_13_007: [ BLEIO_gatt_connect shall asynchronously attempt to open a connection with the BLE device. ]*/
     /*Tests_SRS_BLEIO_GATT_13_008: [ On initiating the connect successfully, BLEIO_gatt_connect shall return 0 (zero). ]*/
     /*Tests_SRS_BLEIO_GATT_13_011: [ When the connect operation to the device has been completed, the callback function pointed at by on_bleio_gatt_connect_complete shall be invoked. ]*/
+    /*Tests_SRS_BLEIO_GATT_43_002: [ If the shared d-bus connection and object manager have not been created yet then BLEIO_gatt_connect shall create them and share them with the other handles in the process. ]*/
     TEST_FUNCTION(BLEIO_gatt_connect_succeeds)
     {
         ///arrange
@@ -2528,108 +2814,288 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         BLEIO_gatt_destroy(handle);
     }
 
-    /*Tests_SRS_BLEIO_GATT_13_027: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if bleio_gatt_handle is NULL. ]*/
-    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_for_NULL_input1)
-    {
-        ///arrange
-        CBLEGATTIOMocks mocks;
-
-        ///act
-        auto result = BLEIO_gatt_read_char_by_uuid(NULL, "fake_uuid", on_read_complete, NULL);
-
-        ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_TRUE(result != 0);
-
-        ///cleanup
-    }
-
-    /*Tests_SRS_BLEIO_GATT_13_051: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if ble_uuid is NULL. ]*/
-    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_for_NULL_input2)
+    /*Tests_SRS_BLEIO_GATT_43_001: [ BLEIO_gatt_connect shall reuse the system d-bus connection and the org.bluez object manager that are shared by all the handles in the process if they have already been created. ]*/
+    TEST_FUNCTION(BLEIO_gatt_connect_reuses_the_shared_bus_and_object_manager)
     {
         ///arrange
         CBLEGATTIOMocks mocks;
+        auto handle1 = BLEIO_gatt_create(&g_device_config);
+        auto handle2 = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle1, on_gatt_connect_complete, NULL);
+        mocks.ResetAllCalls();
 
-        ///act
-        auto result = BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, NULL, on_read_complete, NULL);
-
-        ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_TRUE(result != 0);
-
-        ///cleanup
-    }
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
 
-    /*Tests_SRS_BLEIO_GATT_13_028: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if on_bleio_gatt_attrib_read_complete is NULL. ]*/
-    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_for_NULL_input3)
-    {
-        ///arrange
-        CBLEGATTIOMocks mocks;
+        // there should be no calls to g_bus_get or g_dbus_object_manager_client_new
+        STRICT_EXPECTED_CALL(mocks, bluez_device__proxy_new(
+            IGNORED_PTR_ARG,
+            G_DBUS_PROXY_FLAGS_NONE,
+            IGNORED_PTR_ARG,
+            IGNORED_PTR_ARG,
+            NULL,
+            IGNORED_PTR_ARG,
+            IGNORED_PTR_ARG
+            ))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(6)
+            .IgnoreArgument(7);
+        g_bluez_device__proxy_new_finisher.when_shall_call_fail = 2;
+        STRICT_EXPECTED_CALL(mocks, bluez_device__proxy_new_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, on_gatt_connect_complete(handle2, NULL, BLEIO_GATT_CONNECT_ERROR));
+        STRICT_EXPECTED_CALL(mocks, g_string_new(NULL)); // create_device_proxy
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
 
         ///act
-        auto result = BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, "fake_uuid", NULL, NULL);
+        auto result = BLEIO_gatt_connect(handle2, on_gatt_connect_complete, NULL);
 
         ///assert
         mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_TRUE(result != 0);
+        ASSERT_IS_TRUE(result == 0);
 
         ///cleanup
+        BLEIO_gatt_destroy(handle2);
+        BLEIO_gatt_destroy(handle1);
     }
 
-    /*Tests_SRS_BLEIO_GATT_13_052: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if the object is not in a connected state. ]*/
-    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_when_not_connected)
+    /*Tests_SRS_BLEIO_GATT_43_003: [ BLEIO_gatt_destroy shall release the shared d-bus connection and object manager only when the last handle in the process is destroyed. ]*/
+    TEST_FUNCTION(BLEIO_gatt_destroy_keeps_the_shared_bus_and_object_manager_while_other_handles_exist)
     {
         ///arrange
         CBLEGATTIOMocks mocks;
-        auto handle = BLEIO_gatt_create(&g_device_config);
+        auto handle1 = BLEIO_gatt_create(&g_device_config);
+        auto handle2 = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle1, on_gatt_connect_complete, NULL);
+        (void)BLEIO_gatt_connect(handle2, on_gatt_connect_complete, NULL);
         mocks.ResetAllCalls();
 
-        ///act
-        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_uuid", on_read_complete, NULL);
-
-        ///assert
-        mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_TRUE(result != 0);
-
-        ///cleanup
-        BLEIO_gatt_destroy(handle);
-    }
-
-    /*Tests_SRS_BLEIO_GATT_13_029: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
-    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_when_g_string_new_fails)
-    {
-        ///arrange
-        CBLEGATTIOMocks mocks;
-        auto handle = BLEIO_gatt_create(&g_device_config);
-        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
-        mocks.ResetAllCalls();
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // device
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, g_string_new("fake_uuid"))
-            .SetFailReturn((GString*)NULL);
+        // this is the number of g_string_free calls we expect
+        const size_t EXPECTED_STRING_FREES = (
+            (sizeof(g_dbus_objects) / sizeof(g_dbus_objects[0])) + 5
+        );
+        for (size_t i = 0; i < EXPECTED_STRING_FREES; i++)
+        {
+            STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+                .IgnoreArgument(1);
+        }
 
         ///act
-        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_uuid", on_read_complete, NULL);
+        BLEIO_gatt_destroy(handle2);
 
         ///assert
         mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_TRUE(result != 0);
 
         ///cleanup
-        BLEIO_gatt_destroy(handle);
+        BLEIO_gatt_destroy(handle1);
     }
 
-    /*Tests_SRS_BLEIO_GATT_13_029: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
-    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_when_char_uuid_lookup_fails)
+    /*Tests_SRS_BLEIO_GATT_44_001: [ BLEIO_gatt_connect shall release the device proxy left over from a previous connection when the handle is connected again. ]*/
+    TEST_FUNCTION(BLEIO_gatt_connect_releases_the_previous_device_proxy_on_reconnect)
     {
         ///arrange
         CBLEGATTIOMocks mocks;
         auto handle = BLEIO_gatt_create(&g_device_config);
         (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        BLEIO_gatt_disconnect(handle, NULL, NULL);
         mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, g_string_new("fake_uuid"));
-        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreArgument(1)
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, bluez_device__proxy_new(
+            IGNORED_PTR_ARG,
+            G_DBUS_PROXY_FLAGS_NONE,
+            IGNORED_PTR_ARG,
+            IGNORED_PTR_ARG,
+            NULL,
+            IGNORED_PTR_ARG,
+            IGNORED_PTR_ARG
+            ))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(6)
+            .IgnoreArgument(7);
+        STRICT_EXPECTED_CALL(mocks, bluez_device__proxy_new_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // the device proxy of the previous connection
+        STRICT_EXPECTED_CALL(mocks, bluez_device__call_connect(
+            IGNORED_PTR_ARG,
+            NULL,
+            IGNORED_PTR_ARG,
+            IGNORED_PTR_ARG
+            ))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        g_bluez_device__call_connect_finisher.when_shall_call_fail = 2;
+        STRICT_EXPECTED_CALL(mocks, bluez_device__call_connect_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, on_gatt_connect_complete(handle, NULL, BLEIO_GATT_CONNECT_ERROR));
+        STRICT_EXPECTED_CALL(mocks, g_string_new(NULL)); // create_device_proxy
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result == 0);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_027: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if bleio_gatt_handle is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_for_NULL_input1)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(NULL, "fake_uuid", on_read_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_051: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if ble_uuid is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_for_NULL_input2)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, NULL, on_read_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_028: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if on_bleio_gatt_attrib_read_complete is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_for_NULL_input3)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid((BLEIO_GATT_HANDLE)0x42, "fake_uuid", NULL, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_052: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if the object is not in a connected state. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_when_not_connected)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_uuid", on_read_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_029: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_when_g_string_new_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_string_new("fake_uuid"))
+            .SetFailReturn((GString*)NULL);
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_uuid", on_read_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_029: [ BLEIO_gatt_read_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_returns_non_zero_when_char_uuid_lookup_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_string_new("fake_uuid"));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
             .IgnoreArgument(2);
         STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
             .IgnoreArgument(1);
@@ -2740,6 +3206,9 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         // since GIO_Async_Seq_Add has not been mocked because it's a varargs
         // function, we use this variable to control it's execution
         g_when_shall_GIO_Async_Seq_Add_fail = g_GIO_Async_Seq_Add_call + 1;
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
@@ -2781,6 +3250,9 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetFailReturn((GIO_ASYNCSEQ_RESULT)GIO_ASYNCSEQ_ERROR);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
@@ -2837,6 +3309,13 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
         STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, NULL, BLEIO_GATT_ERROR, NULL, 0));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // on_sequence_error
 
         ///act
         (void)BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
@@ -2909,6 +3388,19 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .SetFailReturn((GVariant*)NULL)
             .CopyOutArgumentBuffer(3, &expected_error, sizeof(GError*));
         STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, NULL, BLEIO_GATT_ERROR, NULL, 0));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // on_sequence_error
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // cached proxy removed by on_sequence_error
 
         ///act
         (void)BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
@@ -2997,6 +3489,15 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, NULL, BLEIO_GATT_OK, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(4)
             .IgnoreArgument(5);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
@@ -3087,6 +3588,15 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, (void*)0x42, BLEIO_GATT_OK, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
             .IgnoreArgument(4)
             .IgnoreArgument(5);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, (void*)0x42);
@@ -3100,27 +3610,109 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         BLEIO_gatt_destroy(handle);
     }
 
-    /*Tests_SRS_BLEIO_GATT_13_036: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if bleio_gatt_handle is NULL. ]*/
-    TEST_FUNCTION(BLEIO_gatt_write_char_by_uuid_returns_non_zero_for_NULL_input1)
+    /*Tests_SRS_BLEIO_GATT_41_001: [ BLEIO_gatt_read_char_by_uuid shall use the characteristic proxy cached for the object path of the characteristic if there is one instead of creating a new proxy. ]*/
+    /*Tests_SRS_BLEIO_GATT_41_003: [ When a characteristic proxy has been created, BLEIO_gatt_read_char_by_uuid and BLEIO_gatt_write_char_by_uuid shall add it to the cache of characteristic proxies if the object is in a connected state. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_char_by_uuid_reuses_cached_proxy)
     {
         ///arrange
         CBLEGATTIOMocks mocks;
-        unsigned char fake_data[] = "fake data";
-        size_t size_data = sizeof(fake_data) / sizeof(unsigned char);
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        auto char_uuid = g_char_uuids[0].c_str();
+        (void)BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_string_new(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // cached proxy
+        STRICT_EXPECTED_CALL(mocks, g_bytes_new(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_bytes_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_variant_new_from_bytes(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, g_variant_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_variant_get_data_as_bytes(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_bytes_get_data(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // read_characteristic
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // read_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // on_sequence_complete
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // free_context
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__call_read_value(IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        STRICT_EXPECTED_CALL(mocks, g_dbus_proxy_call_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, on_read_complete(handle, NULL, BLEIO_GATT_OK, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(4)
+            .IgnoreArgument(5);
 
         ///act
-        auto result = BLEIO_gatt_write_char_by_uuid(NULL, "fake_uuid", fake_data, size_data, on_write_complete, NULL);
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
 
         ///assert
         mocks.AssertActualAndExpectedCalls();
-        ASSERT_IS_TRUE(result != 0);
+        ASSERT_IS_TRUE(result == 0);
+        ASSERT_ARE_EQUAL(size_t, 1, g_bluez_characteristic__proxy_new_finisher.call_count);
 
         ///cleanup
+        BLEIO_gatt_destroy(handle);
     }
 
-    /*Tests_SRS_BLEIO_GATT_13_048: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if ble_uuid is NULL. ]*/
-    TEST_FUNCTION(BLEIO_gatt_write_char_by_uuid_returns_non_zero_for_NULL_input2)
-    {
+    /*Tests_SRS_BLEIO_GATT_13_036: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if bleio_gatt_handle is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_write_char_by_uuid_returns_non_zero_for_NULL_input1)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        unsigned char fake_data[] = "fake data";
+        size_t size_data = sizeof(fake_data) / sizeof(unsigned char);
+
+        ///act
+        auto result = BLEIO_gatt_write_char_by_uuid(NULL, "fake_uuid", fake_data, size_data, on_write_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_13_048: [ BLEIO_gatt_write_char_by_uuid shall return a non-zero value if ble_uuid is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_write_char_by_uuid_returns_non_zero_for_NULL_input2)
+    {
         ///arrange
         CBLEGATTIOMocks mocks;
         auto handle = BLEIO_gatt_create(&g_device_config);
@@ -3431,6 +4023,9 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         // since GIO_Async_Seq_Add has not been mocked because it's a varargs
         // function, we use this variable to control it's execution
         g_when_shall_GIO_Async_Seq_Add_fail = g_GIO_Async_Seq_Add_call + 1;
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, NULL);
@@ -3479,6 +4074,9 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetFailReturn((GIO_ASYNCSEQ_RESULT)GIO_ASYNCSEQ_ERROR);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, NULL);
@@ -3543,6 +4141,13 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
         STRICT_EXPECTED_CALL(mocks, on_write_complete(handle, NULL, BLEIO_GATT_ERROR));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // on_sequence_error
 
         ///act
         (void)BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, NULL);
@@ -3633,6 +4238,19 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(2)
             .IgnoreArgument(3);
         STRICT_EXPECTED_CALL(mocks, on_write_complete(handle, NULL, BLEIO_GATT_ERROR));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // on_sequence_error
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // cached proxy removed by on_sequence_error
 
         ///act
         (void)BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, NULL);
@@ -3723,6 +4341,15 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(2)
             .IgnoreArgument(3);
         STRICT_EXPECTED_CALL(mocks, on_write_complete(handle, NULL, BLEIO_GATT_OK));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, NULL);
@@ -3815,6 +4442,15 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(2)
             .IgnoreArgument(3);
         STRICT_EXPECTED_CALL(mocks, on_write_complete(handle, (void*)0x42, BLEIO_GATT_OK));
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
 
         ///act
         auto result = BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, (void*)0x42);
@@ -3828,6 +4464,89 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         BLEIO_gatt_destroy(handle);
     }
 
+    /*Tests_SRS_BLEIO_GATT_41_002: [ BLEIO_gatt_write_char_by_uuid shall use the characteristic proxy cached for the object path of the characteristic if there is one instead of creating a new proxy. ]*/
+    TEST_FUNCTION(BLEIO_gatt_write_char_by_uuid_reuses_proxy_cached_by_read)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        const char* char_uuid = g_char_uuids[0].c_str();
+        unsigned char fake_data[] = "fake data";
+        size_t size_data = sizeof(fake_data) / sizeof(unsigned char);
+        (void)BLEIO_gatt_read_char_by_uuid(handle, char_uuid, on_read_complete, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_string_new(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // cached proxy
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_bytes_new(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_bytes_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_bytes_get_data(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // write_characteristic
+        STRICT_EXPECTED_CALL(mocks, g_variant_new_fixed_array(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG, sizeof(unsigned char)))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3); // write_characteristic
+        STRICT_EXPECTED_CALL(mocks, g_variant_new_tuple(IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1); // write_characteristic
+        STRICT_EXPECTED_CALL(mocks, g_variant_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // from mock implementation of g_dbus_proxy_call
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // free_context
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // write_characteristic
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // write_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // on_sequence_complete
+        STRICT_EXPECTED_CALL(mocks, g_dbus_proxy_call(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, G_DBUS_CALL_FLAGS_NONE, -1, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3)
+            .IgnoreArgument(7)
+            .IgnoreArgument(8);
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__call_write_value_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, on_write_complete(handle, NULL, BLEIO_GATT_OK));
+
+        ///act
+        auto result = BLEIO_gatt_write_char_by_uuid(handle, char_uuid, fake_data, size_data, on_write_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result == 0);
+        ASSERT_ARE_EQUAL(size_t, 1, g_bluez_characteristic__proxy_new_finisher.call_count);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
     /*Tests_SRS_BLEIO_GATT_13_016: [ BLEIO_gatt_disconnect shall do nothing if bleio_gatt_handle is NULL. ]*/
     TEST_FUNCTION(BLEIO_gatt_disconnect_does_nothing_for_NULL_input1)
     {
@@ -3906,6 +4625,14 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
         STRICT_EXPECTED_CALL(mocks, on_disconnect_complete(handle, NULL));
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
 
         ///act
         BLEIO_gatt_disconnect(handle, on_disconnect_complete, NULL);
@@ -3940,6 +4667,14 @@ BEGIN_TEST_SUITE(gatt_io_ut)
             .IgnoreArgument(1)
             .IgnoreArgument(2);
         STRICT_EXPECTED_CALL(mocks, on_disconnect_complete(handle, (void*)0x42));
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
 
         ///act
         BLEIO_gatt_disconnect(handle, on_disconnect_complete, (void*)0x42);
@@ -3951,4 +4686,887 @@ BEGIN_TEST_SUITE(gatt_io_ut)
         BLEIO_gatt_destroy(handle);
     }
 
+    /*Tests_SRS_BLEIO_GATT_41_005: [ When the disconnect operation has been completed, all the characteristic proxies in the cache shall be released. ]*/
+    TEST_FUNCTION(BLEIO_gatt_disconnect_releases_cached_proxies)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        (void)BLEIO_gatt_read_char_by_uuid(handle, g_char_uuids[0].c_str(), on_read_complete, NULL);
+        (void)BLEIO_gatt_read_char_by_uuid(handle, g_char_uuids[1].c_str(), on_read_complete, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, bluez_device__call_disconnect(IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        STRICT_EXPECTED_CALL(mocks, bluez_device__call_disconnect_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // first cached proxy
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // second cached proxy
+        STRICT_EXPECTED_CALL(mocks, on_disconnect_complete(handle, NULL));
+
+        ///act
+        BLEIO_gatt_disconnect(handle, on_disconnect_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_001: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if bleio_gatt_handle is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_returns_non_zero_for_NULL_input1)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid(NULL, "fake_uuid", on_notify_start_complete, on_notify, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_002: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if ble_uuid is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_returns_non_zero_for_NULL_input2)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid((BLEIO_GATT_HANDLE)0x42, NULL, on_notify_start_complete, on_notify, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_003: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if on_bleio_gatt_notify_start_complete or on_bleio_gatt_attrib_notify is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_returns_non_zero_for_NULL_input3)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid((BLEIO_GATT_HANDLE)0x42, "fake_uuid", NULL, on_notify, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_003: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if on_bleio_gatt_notify_start_complete or on_bleio_gatt_attrib_notify is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_returns_non_zero_for_NULL_input4)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid((BLEIO_GATT_HANDLE)0x42, "fake_uuid", on_notify_start_complete, NULL, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_004: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if the object is not in a connected state. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_returns_non_zero_when_not_connected)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, "fake_uuid", on_notify_start_complete, on_notify, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_005: [ BLEIO_gatt_notify_char_by_uuid shall return a non-zero value if an underlying platform call fails. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_returns_non_zero_when_malloc_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        auto char_uuid = g_char_uuids[0].c_str();
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_string_new(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((void*)NULL);
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result != 0);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_006: [ BLEIO_gatt_notify_char_by_uuid shall asynchronously start notifications for the characteristic with the specified UUID by calling StartNotify on it. ]*/
+    /*Tests_SRS_BLEIO_GATT_42_007: [ BLEIO_gatt_notify_char_by_uuid shall return 0 (zero) if the start notifications operation is successfully initiated. ]*/
+    /*Tests_SRS_BLEIO_GATT_42_008: [ When a characteristic proxy has been created, BLEIO_gatt_notify_char_by_uuid shall add it to the cache of characteristic proxies if the object is in a connected state. ]*/
+    /*Tests_SRS_BLEIO_GATT_42_009: [ BLEIO_gatt_notify_char_by_uuid shall invoke on_bleio_gatt_notify_start_complete with the value passed in callback_context and the result of the operation once notifications have been started. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_succeeds)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        auto char_uuid = g_char_uuids[0].c_str();
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_string_new(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // earlier subscription
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // start_notify
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // start_notify_finish
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // on_sequence_complete
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__proxy_new(IGNORED_PTR_ARG, G_DBUS_PROXY_FLAGS_NONE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(6)
+            .IgnoreArgument(7);
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__proxy_new_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__call_start_notify(IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__call_start_notify_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, g_signal_connect_data(IGNORED_PTR_ARG, "g-properties-changed", IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, (GConnectFlags)0))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // subscription started at the same time
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, on_notify_start_complete(handle, (void*)0x42, BLEIO_GATT_OK));
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, (void*)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result == 0);
+        ASSERT_IS_TRUE(g_was_GIO_Async_Seq_Add_called);
+        ASSERT_IS_NOT_NULL((void*)g_properties_changed_handler);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_012: [ Each time the value of the characteristic changes BLEIO_gatt_notify_char_by_uuid shall invoke on_bleio_gatt_attrib_notify with the new value and the value passed in callback_context. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_passes_changed_value_to_callback)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        (void)BLEIO_gatt_notify_char_by_uuid(handle, g_char_uuids[0].c_str(), on_notify_start_complete, on_notify, (void*)0x42);
+        GVariant* changed = (GVariant*)(new RefCountObjectDelete<CGVariant>(
+                new CGVariant(new CGBytes("data", 4))
+            )
+        );
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_variant_lookup_value(changed, "Value", IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, g_variant_get_fixed_array(changed, IGNORED_PTR_ARG, sizeof(guchar)))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, on_notify(handle, (void*)0x42, IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, g_variant_unref(changed));
+
+        ///act
+        g_properties_changed_handler(NULL, changed, NULL, g_properties_changed_data);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        ((RefCountObjectDelete<CGVariant>*)changed)->dec_ref();
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_012: [ Each time the value of the characteristic changes BLEIO_gatt_notify_char_by_uuid shall invoke on_bleio_gatt_attrib_notify with the new value and the value passed in callback_context. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_ignores_changes_to_other_properties)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        (void)BLEIO_gatt_notify_char_by_uuid(handle, g_char_uuids[0].c_str(), on_notify_start_complete, on_notify, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_variant_lookup_value(NULL, "Value", IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+
+        ///act
+        g_properties_changed_handler(NULL, NULL, NULL, g_properties_changed_data);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_010: [ When an error occurs asynchronously, BLEIO_gatt_notify_char_by_uuid shall remove the proxy of the characteristic from the cache and pass BLEIO_GATT_ERROR for the result parameter of on_bleio_gatt_notify_start_complete. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_calls_callback_with_error_when_start_notify_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        auto char_uuid = g_char_uuids[0].c_str();
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_string_new(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_string_free(IGNORED_PTR_ARG, TRUE))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_lookup(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2); // earlier subscription
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_Run_Async(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // create_characteristic_finish
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // start_notify
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // start_notify_finish
+        STRICT_EXPECTED_CALL(mocks, GIO_Async_Seq_GetContext(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // on_sequence_error
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__proxy_new(IGNORED_PTR_ARG, G_DBUS_PROXY_FLAGS_NONE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4)
+            .IgnoreArgument(6)
+            .IgnoreArgument(7);
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__proxy_new_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_insert(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__call_start_notify(IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        STRICT_EXPECTED_CALL(mocks, bluez_characteristic__call_start_notify_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, g_tree_remove(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments(); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // free_notify_context
+        STRICT_EXPECTED_CALL(mocks, on_notify_start_complete(handle, (void*)0x42, BLEIO_GATT_ERROR));
+
+        g_bluez_characteristic__call_start_notify_finisher.when_shall_call_fail = 1;
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, (void*)0x42);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result == 0);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_011: [ Starting notifications for a characteristic that notifications were already started for shall replace the earlier subscription. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_replaces_earlier_subscription)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        auto char_uuid = g_char_uuids[0].c_str();
+        (void)BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, NULL);
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, (void*)0x42);
+        GVariant* changed = (GVariant*)(new RefCountObjectDelete<CGVariant>(
+                new CGVariant(new CGBytes("data", 4))
+            )
+        );
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_variant_lookup_value(changed, "Value", IGNORED_PTR_ARG))
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, g_variant_get_fixed_array(changed, IGNORED_PTR_ARG, sizeof(guchar)))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, on_notify(handle, (void*)0x42, IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, g_variant_unref(changed));
+
+        ///act
+        g_properties_changed_handler(NULL, changed, NULL, g_properties_changed_data);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_TRUE(result == 0);
+        ASSERT_ARE_EQUAL(size_t, 1, g_bluez_characteristic__proxy_new_finisher.call_count);
+        ASSERT_ARE_EQUAL(size_t, 2, g_bluez_characteristic__call_start_notify_finisher.call_count);
+
+        ///cleanup
+        ((RefCountObjectDelete<CGVariant>*)changed)->dec_ref();
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_014: [ BLEIO_gatt_notify_char_by_uuid shall stop an earlier subscription for the characteristic by calling StopNotify on it before it starts notifications again. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_char_by_uuid_stops_earlier_subscription)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        auto char_uuid = g_char_uuids[0].c_str();
+        (void)BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, NULL);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, char_uuid, on_notify_start_complete, on_notify, (void*)0x42);
+
+        ///assert
+        ASSERT_IS_TRUE(result == 0);
+        ASSERT_ARE_EQUAL(size_t, 1, g_bluez_characteristic__call_stop_notify_count);
+        ASSERT_ARE_EQUAL(size_t, 2, g_bluez_characteristic__call_start_notify_finisher.call_count);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_015: [ BLEIO_gatt_destroy shall stop the notifications that were started on a connected device by calling StopNotify on the characteristics. ]*/
+    TEST_FUNCTION(BLEIO_gatt_destroy_stops_notifications_of_connected_device)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        (void)BLEIO_gatt_notify_char_by_uuid(handle, g_char_uuids[0].c_str(), on_notify_start_complete, on_notify, NULL);
+        mocks.ResetAllCalls();
+
+        ///act
+        BLEIO_gatt_destroy(handle);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_bluez_characteristic__call_stop_notify_count);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_42_013: [ When the disconnect operation has been completed, all the notification subscriptions shall be released. ]*/
+    TEST_FUNCTION(BLEIO_gatt_disconnect_releases_notification_subscriptions)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_create(&g_device_config);
+        (void)BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        (void)BLEIO_gatt_notify_char_by_uuid(handle, g_char_uuids[0].c_str(), on_notify_start_complete, on_notify, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // free_notify_context
+        STRICT_EXPECTED_CALL(mocks, bluez_device__call_disconnect(IGNORED_PTR_ARG, NULL, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3)
+            .IgnoreArgument(4);
+        STRICT_EXPECTED_CALL(mocks, bluez_device__call_disconnect_finish(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic proxy cache
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // cached proxy
+        STRICT_EXPECTED_CALL(mocks, g_tree_ref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, g_tree_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // notification subscriptions
+        STRICT_EXPECTED_CALL(mocks, g_signal_handler_disconnect(IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_object_unref(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // subscription's proxy
+        STRICT_EXPECTED_CALL(mocks, on_disconnect_complete(handle, NULL));
+
+        ///act
+        BLEIO_gatt_disconnect(handle, on_disconnect_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_001: [ BLEIO_gatt_sim_create shall return NULL if config or sim_config is NULL. ]*/
+    TEST_FUNCTION(BLEIO_gatt_sim_create_returns_NULL_for_NULL_input)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        ///act
+        auto result1 = BLEIO_gatt_sim_create(NULL, &g_sim_config);
+        auto result2 = BLEIO_gatt_sim_create(&g_device_config, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result1);
+        ASSERT_IS_NULL(result2);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_002: [ BLEIO_gatt_sim_create shall return NULL if the connect_failure_rate or the io_failure_rate field of sim_config is not between 0 and 1 or if the notify_interval_in_ms or the value_size field is zero. ]*/
+    TEST_FUNCTION(BLEIO_gatt_sim_create_returns_NULL_for_invalid_config)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        BLEIO_GATT_SIM_CONFIG bad_connect_rate = g_sim_config;
+        bad_connect_rate.connect_failure_rate = 1.5;
+        BLEIO_GATT_SIM_CONFIG bad_io_rate = g_sim_config;
+        bad_io_rate.io_failure_rate = -0.1;
+        BLEIO_GATT_SIM_CONFIG zero_interval = g_sim_config;
+        zero_interval.notify_interval_in_ms = 0;
+        BLEIO_GATT_SIM_CONFIG zero_size = g_sim_config;
+        zero_size.value_size = 0;
+
+        ///act
+        auto result1 = BLEIO_gatt_sim_create(&g_device_config, &bad_connect_rate);
+        auto result2 = BLEIO_gatt_sim_create(&g_device_config, &bad_io_rate);
+        auto result3 = BLEIO_gatt_sim_create(&g_device_config, &zero_interval);
+        auto result4 = BLEIO_gatt_sim_create(&g_device_config, &zero_size);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result1);
+        ASSERT_IS_NULL(result2);
+        ASSERT_IS_NULL(result3);
+        ASSERT_IS_NULL(result4);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_003: [ BLEIO_gatt_sim_create shall return NULL when any of the underlying platform calls fail. ]*/
+    TEST_FUNCTION(BLEIO_gatt_sim_create_returns_NULL_when_malloc_fails)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((void*)NULL);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLEIO_gatt_sim_create(&g_device_config, &g_sim_config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(result);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_004: [ BLEIO_gatt_sim_create shall return a non-NULL handle that the other BLEIO_gatt_* functions accept and that does no I/O with a real device. ]*/
+    TEST_FUNCTION(BLEIO_gatt_sim_create_succeeds)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = BLEIO_gatt_sim_create(&g_device_config, &g_sim_config);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(result);
+
+        ///cleanup
+        BLEIO_gatt_destroy(result);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_005: [ Every operation on a simulated handle shall complete asynchronously after latency_in_ms milliseconds plus a random delay of at most jitter_in_ms milliseconds. ]*/
+    /*Tests_SRS_BLEIO_GATT_49_013: [ The BLEIO_gatt_* functions shall hand handles created by BLEIO_gatt_sim_create over to the simulator. ]*/
+    TEST_FUNCTION(BLEIO_gatt_connect_on_sim_handle_completes_after_latency)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_sim_create(&g_device_config, &g_sim_config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, g_timeout_add(10, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+
+        ///act
+        auto result = BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 0, g_callback_count);
+
+        fire_last_timeout();
+        ASSERT_ARE_EQUAL(size_t, 1, g_callback_count);
+        ASSERT_ARE_EQUAL(int, (int)BLEIO_GATT_CONNECT_OK, (int)g_connect_result);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_005: [ Every operation on a simulated handle shall complete asynchronously after latency_in_ms milliseconds plus a random delay of at most jitter_in_ms milliseconds. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_on_sim_handle_adds_jitter_to_latency)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        BLEIO_GATT_SIM_CONFIG sim_config = g_sim_config;
+        sim_config.jitter_in_ms = 5;
+        auto handle = create_connected_sim_handle(&sim_config);
+
+        for (int i = 0; i < 20; i++)
+        {
+            ///act
+            auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_char_uuid", on_read_complete, NULL);
+
+            ///assert
+            ASSERT_ARE_EQUAL(int, 0, result);
+            ASSERT_IS_TRUE(g_timeout_interval >= 10 && g_timeout_interval <= 15);
+            fire_last_timeout();
+        }
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_006: [ A simulated connection attempt shall fail with BLEIO_GATT_CONNECT_ERROR with a probability of connect_failure_rate. ]*/
+    TEST_FUNCTION(BLEIO_gatt_connect_on_sim_handle_fails_at_the_configured_rate)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        BLEIO_GATT_SIM_CONFIG sim_config = g_sim_config;
+        sim_config.connect_failure_rate = 1.0;
+        auto handle = BLEIO_gatt_sim_create(&g_device_config, &sim_config);
+
+        ///act
+        auto result = BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL);
+        fire_last_timeout();
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(int, (int)BLEIO_GATT_CONNECT_ERROR, (int)g_connect_result);
+        // a failed connection can be retried
+        ASSERT_ARE_EQUAL(int, 0, BLEIO_gatt_connect(handle, on_gatt_connect_complete, NULL));
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_007: [ Simulated reads, writes and notification starts shall fail with BLEIO_GATT_ERROR with a probability of io_failure_rate or if the handle was disconnected in the meantime. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_on_sim_handle_fails_at_the_configured_rate)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        BLEIO_GATT_SIM_CONFIG sim_config = g_sim_config;
+        sim_config.io_failure_rate = 1.0;
+        auto handle = create_connected_sim_handle(&sim_config);
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_char_uuid", on_read_complete, NULL);
+        fire_last_timeout();
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, g_callback_count);
+        ASSERT_ARE_EQUAL(BLEIO_GATT_RESULT, BLEIO_GATT_ERROR, g_io_result);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_007: [ Simulated reads, writes and notification starts shall fail with BLEIO_GATT_ERROR with a probability of io_failure_rate or if the handle was disconnected in the meantime. ]*/
+    TEST_FUNCTION(BLEIO_gatt_write_on_sim_handle_fails_when_disconnected_in_the_meantime)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = create_connected_sim_handle(&g_sim_config);
+        unsigned char value[] = { 1, 2, 3 };
+        (void)BLEIO_gatt_write_char_by_uuid(handle, "fake_char_uuid", value, sizeof(value), on_write_complete, NULL);
+        GSourceFunc write_function = g_timeout_function;
+        gpointer write_data = g_timeout_data;
+        BLEIO_gatt_disconnect(handle, NULL, NULL);
+        fire_last_timeout();
+
+        ///act
+        (void)write_function(write_data);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, g_callback_count);
+        ASSERT_ARE_EQUAL(BLEIO_GATT_RESULT, BLEIO_GATT_ERROR, g_io_result);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_008: [ A simulated read shall return the last value written to the characteristic or, if it has not been written to, a generated value of value_size bytes. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_on_sim_handle_returns_generated_value)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = create_connected_sim_handle(&g_sim_config);
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_char_uuid", on_read_complete, NULL);
+        fire_last_timeout();
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(size_t, 1, g_callback_count);
+        ASSERT_ARE_EQUAL(BLEIO_GATT_RESULT, BLEIO_GATT_OK, g_io_result);
+        ASSERT_ARE_EQUAL(size_t, g_sim_config.value_size, g_value.size());
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_008: [ A simulated read shall return the last value written to the characteristic or, if it has not been written to, a generated value of value_size bytes. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_on_sim_handle_returns_written_value)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = create_connected_sim_handle(&g_sim_config);
+        unsigned char value[] = { 1, 2, 3, 4, 5, 6 };
+        (void)BLEIO_gatt_write_char_by_uuid(handle, "fake_char_uuid", value, sizeof(value), on_write_complete, NULL);
+        fire_last_timeout();
+        ASSERT_ARE_EQUAL(BLEIO_GATT_RESULT, BLEIO_GATT_OK, g_io_result);
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, "FAKE_CHAR_UUID", on_read_complete, NULL);
+        fire_last_timeout();
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(BLEIO_GATT_RESULT, BLEIO_GATT_OK, g_io_result);
+        ASSERT_ARE_EQUAL(size_t, sizeof(value), g_value.size());
+        ASSERT_ARE_EQUAL(int, 0, memcmp(value, g_value.data(), sizeof(value)));
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_009: [ Once notifications have been started for a characteristic of a simulated handle, on_bleio_gatt_attrib_notify shall be invoked with a generated value every notify_interval_in_ms milliseconds until the handle is disconnected or destroyed. ]*/
+    TEST_FUNCTION(BLEIO_gatt_notify_on_sim_handle_notifies_periodically)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = create_connected_sim_handle(&g_sim_config);
+        auto result = BLEIO_gatt_notify_char_by_uuid(handle, "fake_char_uuid", on_notify_start_complete, on_notify, NULL);
+        fire_last_timeout();
+        ASSERT_ARE_EQUAL(int, 0, result);
+        ASSERT_ARE_EQUAL(BLEIO_GATT_RESULT, BLEIO_GATT_OK, g_io_result);
+        ASSERT_ARE_EQUAL(int, 1000, (int)g_timeout_interval);
+
+        ///act
+        gboolean keep_notifying = g_timeout_function(g_timeout_data);
+        (void)g_timeout_function(g_timeout_data);
+
+        ///assert
+        ASSERT_IS_TRUE(keep_notifying == G_SOURCE_CONTINUE);
+        ASSERT_ARE_EQUAL(size_t, 3, g_callback_count);
+        ASSERT_ARE_EQUAL(size_t, g_sim_config.value_size, g_value.size());
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_010: [ The random numbers of a simulated handle shall be seeded from the MAC address of the device so that runs are reproducible. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_on_sim_handles_of_the_same_device_return_the_same_values)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle1 = create_connected_sim_handle(&g_sim_config);
+        auto handle2 = create_connected_sim_handle(&g_sim_config);
+
+        ///act
+        (void)BLEIO_gatt_read_char_by_uuid(handle1, "fake_char_uuid", on_read_complete, NULL);
+        fire_last_timeout();
+        std::vector<unsigned char> value1 = g_value;
+        (void)BLEIO_gatt_read_char_by_uuid(handle2, "fake_char_uuid", on_read_complete, NULL);
+        fire_last_timeout();
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, g_sim_config.value_size, value1.size());
+        ASSERT_IS_TRUE(value1 == g_value);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle1);
+        BLEIO_gatt_destroy(handle2);
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_011: [ BLEIO_gatt_destroy shall cancel the pending operations of a simulated handle without invoking their callbacks. ]*/
+    TEST_FUNCTION(BLEIO_gatt_destroy_cancels_pending_sim_operations)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = create_connected_sim_handle(&g_sim_config);
+        (void)BLEIO_gatt_read_char_by_uuid(handle, "fake_char_uuid", on_read_complete, NULL);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, g_source_remove(g_timeout_source));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // the read's value
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // the read
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic UUID
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic value
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // characteristic
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // virtual device
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1); // handle
+
+        ///act
+        BLEIO_gatt_destroy(handle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(size_t, 0, g_callback_count);
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_BLEIO_GATT_49_012: [ The functions shall validate their arguments and the connection state of a simulated handle the same way as they do for a real device. ]*/
+    TEST_FUNCTION(BLEIO_gatt_read_on_sim_handle_returns_non_zero_when_not_connected)
+    {
+        ///arrange
+        CBLEGATTIOMocks mocks;
+        auto handle = BLEIO_gatt_sim_create(&g_device_config, &g_sim_config);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto result = BLEIO_gatt_read_char_by_uuid(handle, "fake_char_uuid", on_read_complete, NULL);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+        ///cleanup
+        BLEIO_gatt_destroy(handle);
+    }
+
 END_TEST_SUITE(gatt_io_ut)
@@ -13,10 +13,20 @@
 #define GW_SOURCE_BLE_TELEMETRY             "bleTelemetry"
 
 #define GW_IDMAP_MODULE                     "mapping"
+#define GW_IDMAP_UPDATE_PROPERTY            "identityMapUpdate"
+#define GW_IDMAP_UPDATE_ADD                 "add"
+#define GW_IDMAP_UPDATE_REMOVE              "remove"
 #define GW_IOTHUB_MODULE                    "iothub"
 
 #define GW_BLE_CONTROLLER_INDEX_PROPERTY    "bleControllerIndex"
 #define GW_TIMESTAMP_PROPERTY               "timestamp"
 #define GW_CHARACTERISTIC_UUID_PROPERTY     "characteristicUUID"
+#define GW_READ_GROUP_PROPERTY              "readGroup"
+
+#define GW_CONTENT_TYPE_PROPERTY            "contentType"
+#define GW_CONTENT_TYPE_BLE_INSTRUCTION     "application/x-ble-instruction"
+
+#define GW_SEQUENCE_NUMBER_PROPERTY         "sequenceNumber"
+#define GW_SEND_TIME_PROPERTY               "sendTime"
 
 #endif /*MESSAGEPROPERTIES_H*/
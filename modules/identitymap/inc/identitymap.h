@@ -5,6 +5,7 @@
 #define IDENTITYMAP_H
 
 #include "module.h"
+#include "azure_c_shared_utility/vector.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -18,6 +19,12 @@ typedef struct IDENTITY_MAP_CONFIG_TAG
     const char* deviceKey;
 } IDENTITY_MAP_CONFIG;
 
+typedef struct IDENTITY_MAP_MODULE_CONFIG_TAG
+{
+    VECTOR_HANDLE mapping;        /* of IDENTITY_MAP_CONFIG */
+    const char* updateSource;     /* "source" of the accepted update messages, NULL to accept none */
+} IDENTITY_MAP_MODULE_CONFIG;
+
 MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(IDENTITYMAP_MODULE)(MODULE_API_VERSION gateway_api_version);
 
 #ifdef __cplusplus
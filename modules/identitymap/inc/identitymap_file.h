@@ -0,0 +1,25 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IDENTITYMAP_FILE_H
+#define IDENTITYMAP_FILE_H
+
+#include "identitymap.h"
+#include "azure_c_shared_utility/vector.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*appends the triplets of a mapping file to mapping, a vector of IDENTITY_MAP_CONFIG.
+  each line of the file is "macAddress,deviceId,deviceKey", empty lines and lines
+  starting with '#' are skipped. the strings of the triplets are allocated one by one
+  and belong to the caller, also the ones appended before a failure*/
+extern int IdentityMapFile_Read(const char* fileName, VECTOR_HANDLE mapping);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*IDENTITYMAP_FILE_H*/
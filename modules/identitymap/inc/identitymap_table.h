@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IDENTITYMAP_TABLE_H
+#define IDENTITYMAP_TABLE_H
+
+#include "identitymap.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+/*mapping triplets found by MAC address and by deviceId, it is not thread safe*/
+typedef struct IDENTITY_MAP_TABLE_TAG* IDENTITY_MAP_TABLE_HANDLE;
+
+/*packs a MAC address in canonical form, in either case, into its 48 bits, false if it is not canonical*/
+extern bool IdentityMapTable_PackMac(const char* macAddress, uint64_t* mac);
+
+/*creates an empty table sized for expectedCount triplets, it grows past that as needed*/
+extern IDENTITY_MAP_TABLE_HANDLE IdentityMapTable_Create(size_t expectedCount);
+
+/*adds the triplet, or replaces the one of the same MAC address, the strings are copied.
+  a triplet of the same deviceId with another MAC address is removed*/
+extern int IdentityMapTable_Add(IDENTITY_MAP_TABLE_HANDLE handle, const IDENTITY_MAP_CONFIG* entry);
+
+/*removes the triplet of macAddress, non zero if there is none*/
+extern int IdentityMapTable_Remove(IDENTITY_MAP_TABLE_HANDLE handle, const char* macAddress);
+
+/*the triplet of macAddress, its macAddress is upper case. NULL if there is none.
+  it stays valid until the next IdentityMapTable_Add or IdentityMapTable_Remove*/
+extern const IDENTITY_MAP_CONFIG* IdentityMapTable_FindByMac(IDENTITY_MAP_TABLE_HANDLE handle, const char* macAddress);
+
+/*the triplet of deviceId, same as IdentityMapTable_FindByMac otherwise*/
+extern const IDENTITY_MAP_CONFIG* IdentityMapTable_FindByDeviceId(IDENTITY_MAP_TABLE_HANDLE handle, const char* deviceId);
+
+extern size_t IdentityMapTable_GetCount(IDENTITY_MAP_TABLE_HANDLE handle);
+
+extern void IdentityMapTable_Destroy(IDENTITY_MAP_TABLE_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*IDENTITYMAP_TABLE_H*/
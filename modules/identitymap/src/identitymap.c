@@ -15,6 +15,8 @@
 #include "message.h"
 #include "broker.h"
 #include "identitymap.h"
+#include "identitymap_table.h"
+#include "identitymap_file.h"
 #include "azure_c_shared_utility/constmap.h"
 #include "azure_c_shared_utility/constbuffer.h"
 #include "azure_c_shared_utility/xlogging.h"
@@ -25,9 +27,8 @@
 typedef struct IDENTITY_MAP_DATA_TAG
 {
     BROKER_HANDLE broker;
-    size_t mappingSize;
-    IDENTITY_MAP_CONFIG * macToDevIdArray;
-    IDENTITY_MAP_CONFIG * devIdToMacArray;
+    IDENTITY_MAP_TABLE_HANDLE table;
+    char * updateSource;
 } IDENTITY_MAP_DATA;
 
 #define IDENTITYMAP_RESULT_VALUES \
@@ -42,9 +43,13 @@ DEFINE_ENUM_STRINGS(BROKER_RESULT, BROKER_RESULT_VALUES);
 #define MACADDR "macAddress"
 #define DEVICENAME "deviceId"
 #define DEVICEKEY "deviceKey"
+#define MAPPINGFILE "mappingFile"
+#define MAPPING "mapping"
+#define UPDATESOURCE "updateSource"
 
 static IDENTITYMAP_RESULT IdentityMapConfig_CopyDeep(IDENTITY_MAP_CONFIG * dest, IDENTITY_MAP_CONFIG * source);
 static void IdentityMapConfig_Free(IDENTITY_MAP_CONFIG * element);
+static void IdentityMap_FreeMappingVector(VECTOR_HANDLE mappingVector);
 
 static bool addOneRecord(VECTOR_HANDLE inputVector, JSON_Object * record)
 {
@@ -235,25 +240,6 @@ static bool IdentityMapConfig_IsCanonicalMAC(const char * macAddress)
     return recognized;
 }
 
-/*
- * @brief    Comparison function by MAC address for two IDENTITY_MAP_CONFIG structures
- */
-static int IdentityMapConfig_MacCompare(const void * a, const void * b)
-{
-    const IDENTITY_MAP_CONFIG * idA = a;
-    const IDENTITY_MAP_CONFIG * idB = b;
-    return strcmp(idA->macAddress, idB->macAddress);
-}
-/*
-* @brief    Comparison function by deviceId for two IDENTITY_MAP_CONFIG structures
-*/
-static int IdentityMapConfig_IdCompare(const void * a, const void * b)
-{
-    const IDENTITY_MAP_CONFIG * idA = a;
-    const IDENTITY_MAP_CONFIG * idB = b;
-    return strcmp(idA->deviceId, idB->deviceId);
-}
-
 /*
  * @brief    Walks through our mappingVector to ensure it is correct for our identity map module.
  */
@@ -299,6 +285,17 @@ static bool IdentityMap_ValidateConfig(const VECTOR_HANDLE mappingVector)
     return mappingOk;
 }
 
+/*
+ * @brief    The sources of the other gateway messages, never accepted as the source of mapping updates.
+ */
+static bool IdentityMap_IsReservedSource(const char * source)
+{
+    return ((strcmp(source, GW_IOTHUB_MODULE) == 0) ||
+        (strcmp(source, GW_IDMAP_MODULE) == 0) ||
+        (strcmp(source, GW_SOURCE_BLE_TELEMETRY) == 0) ||
+        (strcmp(source, GW_SOURCE_BLE_COMMAND) == 0));
+}
+
 /*
  * @brief    Create an identity map module.
  */
@@ -314,92 +311,84 @@ static MODULE_HANDLE IdentityMap_Create(BROKER_HANDLE broker, const void* config
     }
     else
     {
-        VECTOR_HANDLE mappingVector = (VECTOR_HANDLE)configuration;
-        if (IdentityMap_ValidateConfig(mappingVector) == false)
+        const IDENTITY_MAP_MODULE_CONFIG * config = (const IDENTITY_MAP_MODULE_CONFIG *)configuration;
+        VECTOR_HANDLE mappingVector = config->mapping;
+        if (mappingVector == NULL)
+        {
+            /*Codes_SRS_IDMAP_38_030: [ If the mapping of the configuration is NULL, this function shall fail and return NULL. ]*/
+            LogError("invalid parameter (NULL mapping).");
+            result = NULL;
+        }
+        else if (IdentityMap_ValidateConfig(mappingVector) == false)
         {
             LogError("unable to validate mapping table");
             result = NULL;
         }
+        else if ((config->updateSource != NULL) && (IdentityMap_IsReservedSource(config->updateSource) == true))
+        {
+            /*Codes_SRS_IDMAP_38_031: [ If the updateSource of the configuration is "iothub", "mapping", "bleTelemetry" or "bleCommand", this function shall fail and return NULL. ]*/
+            LogError("%s cannot be the source of mapping updates", config->updateSource);
+            result = NULL;
+        }
+        else if ((result = (IDENTITY_MAP_DATA*)malloc(sizeof(IDENTITY_MAP_DATA))) == NULL)
+        {
+            /*Codes_SRS_IDMAP_17_010: [If IdentityMap_Create fails to allocate a new IDENTITY_MAP_DATA structure, then this function shall fail, and return NULL.]*/
+            LogError("Could not Allocate Module");
+        }
         else
         {
-            result = (IDENTITY_MAP_DATA*)malloc(sizeof(IDENTITY_MAP_DATA));
-            if (result == NULL)
+            result->updateSource = NULL;
+            if ((config->updateSource != NULL) && (mallocAndStrcpy_s(&result->updateSource, config->updateSource) != 0))
             {
-                /*Codes_SRS_IDMAP_17_010: [If IdentityMap_Create fails to allocate a new IDENTITY_MAP_DATA structure, then this function shall fail, and return NULL.]*/
-                LogError("Could not Allocate Module");
+                /*Codes_SRS_IDMAP_38_032: [ If the updateSource of the configuration cannot be copied, this function shall fail, release all resources, and return NULL. ]*/
+                LogError("Could not copy the update source");
+                free(result);
+                result = NULL;
             }
             else
             {
                 size_t mappingSize = VECTOR_size(mappingVector);
-                /* validation ensures the vector is greater than zero */
-                result->macToDevIdArray = (IDENTITY_MAP_CONFIG*)malloc(mappingSize*sizeof(IDENTITY_MAP_CONFIG));
-                if (result->macToDevIdArray == NULL)
+                /*Codes_SRS_IDMAP_38_016: [ IdentityMap_Create shall create the mapping table by calling IdentityMapTable_Create with the number of triplets in configuration. ]*/
+                result->table = IdentityMapTable_Create(mappingSize);
+                if (result->table == NULL)
                 {
-                    /*Codes_SRS_IDMAP_17_011: [If IdentityMap_Create fails to create memory for the macToDeviceArray, then this function shall fail and return NULL.*/
-                    LogError("Could not allocate mac to device mapping table");
+                    /*Codes_SRS_IDMAP_38_017: [ If IdentityMapTable_Create fails, then this function shall fail, release all resources, and return NULL. ]*/
+                    LogError("Could not create the mapping table");
+                    if (result->updateSource != NULL)
+                    {
+                        free(result->updateSource);
+                    }
                     free(result);
                     result = NULL;
                 }
                 else
                 {
-                    result->devIdToMacArray = (IDENTITY_MAP_CONFIG*)malloc(mappingSize*sizeof(IDENTITY_MAP_CONFIG));
-                    if (result->devIdToMacArray == NULL)
+                    size_t index;
+                    for (index = 0; index < mappingSize; index++)
+                    {
+                        /*Codes_SRS_IDMAP_38_018: [ IdentityMap_Create shall add each triplet of configuration to the mapping table by calling IdentityMapTable_Add. ]*/
+                        IDENTITY_MAP_CONFIG * element = (IDENTITY_MAP_CONFIG *)VECTOR_element(mappingVector, index);
+                        if (IdentityMapTable_Add(result->table, element) != 0)
+                        {
+                            LogError("Could not add the mapping of %s", element->macAddress);
+                            break;
+                        }
+                    }
+                    if (index < mappingSize)
                     {
-                        /*Codes_SRS_IDMAP_17_042: [ If IdentityMap_Create fails to create memory for the deviceToMacArray, then this function shall fail and return NULL. */
-                        LogError("Could not allocate devicee to mac mapping table");
-                        free(result->macToDevIdArray);
+                        /*Codes_SRS_IDMAP_38_019: [ If IdentityMapTable_Add fails, then this function shall fail, release all resources, and return NULL. ]*/
+                        IdentityMapTable_Destroy(result->table);
+                        if (result->updateSource != NULL)
+                        {
+                            free(result->updateSource);
+                        }
                         free(result);
                         result = NULL;
                     }
                     else
                     {
-
-                        size_t index;
-                        size_t failureIndex = mappingSize;
-                        for (index = 0; index < mappingSize; index++)
-                        {
-                            IDENTITY_MAP_CONFIG * element = (IDENTITY_MAP_CONFIG *)VECTOR_element(mappingVector, index);
-                            IDENTITY_MAP_CONFIG * dest = &(result->macToDevIdArray[index]);
-                            IDENTITYMAP_RESULT copyResult;
-                            copyResult = IdentityMapConfig_CopyDeep(dest, element);
-                            if (copyResult != IDENTITYMAP_OK)
-                            {
-                                failureIndex = index;
-                                break;
-                            }
-                            dest = &(result->devIdToMacArray[index]);
-                            copyResult = IdentityMapConfig_CopyDeep(dest, element);
-                            if (copyResult != IDENTITYMAP_OK)
-                            {
-                                IdentityMapConfig_Free(&(result->macToDevIdArray[index]));
-                                failureIndex = index;
-                                break;
-                            }
-                        }
-                        if (failureIndex < mappingSize)
-                        {
-                            /*Codes_SRS_IDMAP_17_012: [If IdentityMap_Create fails to add a MAC address triplet to the macToDeviceArray, then this function shall fail, release all resources, and return NULL.]*/
-                            /*Codes_SRS_IDMAP_17_043: [ If IdentityMap_Create fails to add a MAC address triplet to the deviceToMacArray, then this function shall fail, release all resources, and return NULL. */
-                            for (index = 0; index < failureIndex; index++)
-                            {
-                                IdentityMapConfig_Free(&(result->macToDevIdArray[index]));
-                                IdentityMapConfig_Free(&(result->devIdToMacArray[index]));
-                            }
-                            free(result->macToDevIdArray);
-                            free(result->devIdToMacArray);
-                            free(result);
-                            result = NULL;
-                        }
-                        else
-                        {
-                            /*Codes_SRS_IDMAP_17_003: [Upon success, this function shall return a valid pointer to a MODULE_HANDLE.]*/
-                            qsort(result->macToDevIdArray, mappingSize, sizeof(IDENTITY_MAP_CONFIG),
-                                IdentityMapConfig_MacCompare);
-                            qsort(result->devIdToMacArray, mappingSize, sizeof(IDENTITY_MAP_CONFIG),
-                                IdentityMapConfig_IdCompare);
-                            result->mappingSize = mappingSize;
-                            result->broker = broker;
-                        }
+                        /*Codes_SRS_IDMAP_17_003: [Upon success, this function shall return a valid pointer to a MODULE_HANDLE.]*/
+                        result->broker = broker;
                     }
                 }
             }
@@ -408,12 +397,130 @@ static MODULE_HANDLE IdentityMap_Create(BROKER_HANDLE broker, const void* config
     return result;
 }
 
+/*
+* @brief    Read the mapping of the configuration from a mapping file.
+*/
+static VECTOR_HANDLE IdentityMap_ReadMappingFile(const char * mappingFile)
+{
+    /*Codes_SRS_IDMAP_05_007: [ IdentityMap_ParseConfigurationFromJson shall call VECTOR_create to make the identity map module input vector. ]*/
+    VECTOR_HANDLE result = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+    if (result == NULL)
+    {
+        /*Codes_SRS_IDMAP_05_019: [ If creating the vector fails, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
+        LogError("Failed to create the input vector");
+    }
+    else
+    {
+        /*Codes_SRS_IDMAP_39_010: [ IdentityMap_ParseConfigurationFromJson shall read the triplets of the mapping file by calling IdentityMapFile_Read. ]*/
+        if (IdentityMapFile_Read(mappingFile, result) != 0)
+        {
+            /*Codes_SRS_IDMAP_39_011: [ If IdentityMapFile_Read fails, then IdentityMap_ParseConfigurationFromJson shall release all resources and return NULL. ]*/
+            LogError("Unable to read mapping file %s", mappingFile);
+            IdentityMap_FreeMappingVector(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/*
+* @brief    Parse a JSON array of triplets into a mapping vector.
+*/
+static VECTOR_HANDLE IdentityMap_ParseMappingArray(const JSON_Array * jsonArray)
+{
+    /*Codes_SRS_IDMAP_05_007: [ IdentityMap_ParseConfigurationFromJson shall call VECTOR_create to make the identity map module input vector. ]*/
+    VECTOR_HANDLE result = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+    if (result == NULL)
+    {
+        /*Codes_SRS_IDMAP_05_019: [ If creating the vector fails, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
+        LogError("Failed to create the input vector");
+    }
+    else
+    {
+        size_t numberOfRecords = json_array_get_count(jsonArray);
+        size_t record;
+        bool arrayParsed = true;
+        /*Codes_SRS_IDMAP_05_008: [ IdentityMap_ParseConfigurationFromJson shall walk through each object of the array. ]*/
+        for (record = 0; record < numberOfRecords; record++)
+        {
+            /*Codes_SRS_IDMAP_05_006: [ IdentityMap_ParseConfigurationFromJson shall parse the configuration as a JSON array of objects. ]*/
+            if (addOneRecord(result, json_array_get_object(jsonArray, record)) != true)
+            {
+                arrayParsed = false;
+                break;
+            }
+        }
+        if (arrayParsed != true)
+        {
+            /*Codes_SRS_IDMAP_05_005: [ If configuration is not a JSON array of JSON objects, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
+            IdentityMap_FreeMappingVector(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/*
+* @brief    Parse the object form of the configuration, an inline or file mapping and an optional update source.
+*/
+static bool IdentityMap_ParseConfigurationObject(const JSON_Object * jsonObject, IDENTITY_MAP_MODULE_CONFIG * config)
+{
+    bool result;
+    const JSON_Array * jsonArray = json_object_get_array(jsonObject, MAPPING);
+    const char * mappingFile;
+    if (jsonArray != NULL)
+    {
+        /*Codes_SRS_IDMAP_38_033: [ If configuration is a JSON object with a "mapping" array, then IdentityMap_ParseConfigurationFromJson shall parse the array as the mapping. ]*/
+        config->mapping = IdentityMap_ParseMappingArray(jsonArray);
+    }
+    else if ((mappingFile = json_object_get_string(jsonObject, MAPPINGFILE)) != NULL)
+    {
+        /*Codes_SRS_IDMAP_39_009: [ If configuration is a JSON object with a "mappingFile" value, then IdentityMap_ParseConfigurationFromJson shall read the mapping from the file it names. ]*/
+        config->mapping = IdentityMap_ReadMappingFile(mappingFile);
+    }
+    else
+    {
+        /*Codes_SRS_IDMAP_05_005: [ If configuration is not a JSON array of JSON objects, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
+        LogError("Expected a %s array or a %s in configuration", MAPPING, MAPPINGFILE);
+        config->mapping = NULL;
+    }
+
+    if (config->mapping == NULL)
+    {
+        result = false;
+    }
+    else
+    {
+        /*Codes_SRS_IDMAP_38_034: [ IdentityMap_ParseConfigurationFromJson shall copy the optional "updateSource" value of a JSON object configuration. ]*/
+        const char * updateSource = json_object_get_string(jsonObject, UPDATESOURCE);
+        char * temp;
+        if (updateSource == NULL)
+        {
+            result = true;
+        }
+        else if (mallocAndStrcpy_s(&temp, updateSource) != 0)
+        {
+            /*Codes_SRS_IDMAP_17_061: [ If allocation fails, IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
+            LogError("Could not copy the update source");
+            IdentityMap_FreeMappingVector(config->mapping);
+            config->mapping = NULL;
+            result = false;
+        }
+        else
+        {
+            config->updateSource = temp;
+            result = true;
+        }
+    }
+    return result;
+}
+
 /*
 * @brief    Parse configuration for identity map module.
 */
 static void * IdentityMap_ParseConfigurationFromJson(const char* configuration)
 {
-    VECTOR_HANDLE result;
+    IDENTITY_MAP_MODULE_CONFIG * result;
     if (configuration == NULL)
     {
         /*Codes_SRS_IDMAP_05_004: [ If configuration is NULL then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
@@ -432,81 +539,84 @@ static void * IdentityMap_ParseConfigurationFromJson(const char* configuration)
         }
         else
         {
-            /*Codes_SRS_IDMAP_05_006: [ IdentityMap_ParseConfigurationFromJson shall parse the configuration as a JSON array of objects. ]*/
-            JSON_Array *jsonArray = json_value_get_array(json);
-            if (jsonArray == NULL)
+            /*Codes_SRS_IDMAP_17_060: [ IdentityMap_ParseConfigurationFromJson shall allocate memory for the configuration vector. ]*/
+            result = (IDENTITY_MAP_MODULE_CONFIG *)malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG));
+            if (result == NULL)
             {
-                /*Codes_SRS_IDMAP_05_005: [ If configuration is not a JSON array of JSON objects, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
-                LogError("Expected a JSON Array in configuration");
-                result = NULL;
+                /*Codes_SRS_IDMAP_17_061: [ If allocation fails, IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
+                LogError("Failed to allocate the module configuration");
             }
             else
             {
-				/*Codes_SRS_IDMAP_17_060: [ IdentityMap_ParseConfigurationFromJson shall allocate memory for the configuration vector. ]*/
-				/*Codes_SRS_IDMAP_05_007: [ IdentityMap_ParseConfigurationFromJson shall call VECTOR_create to make the identity map module input vector. ]*/
-                result = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
-                if (result == NULL)
+                bool parsed;
+                /*Codes_SRS_IDMAP_05_006: [ IdentityMap_ParseConfigurationFromJson shall parse the configuration as a JSON array of objects. ]*/
+                JSON_Array *jsonArray = json_value_get_array(json);
+                result->updateSource = NULL;
+                if (jsonArray != NULL)
                 {
-                    //Codes_SRS_IDMAP_17_061: [ If allocation fails, IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]
-                    /*Codes_SRS_IDMAP_05_019: [ If creating the vector fails, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
-                    LogError("Failed to create the input vector");
-                    result = NULL;
+                    result->mapping = IdentityMap_ParseMappingArray(jsonArray);
+                    parsed = (result->mapping != NULL);
                 }
                 else
                 {
-                    size_t numberOfRecords = json_array_get_count(jsonArray);
-                    size_t record;
-                    bool arrayParsed = true;
-                    /*Codes_SRS_IDMAP_05_008: [ IdentityMap_ParseConfigurationFromJson shall walk through each object of the array. ]*/
-                    for (record = 0; record < numberOfRecords; record++)
+                    JSON_Object *jsonObject = json_value_get_object(json);
+                    if (jsonObject == NULL)
                     {
-                        /*Codes_SRS_IDMAP_05_006: [ IdentityMap_ParseConfigurationFromJson shall parse the configuration as a JSON array of objects. ]*/
-                        if (addOneRecord(result, json_array_get_object(jsonArray, record)) != true)
-                        {
-                            arrayParsed = false;
-                            break;
-                        }
-                    }
-                    if (arrayParsed != true)
-                    {
-                        numberOfRecords = VECTOR_size(result);
-                        for (record = 0; record < numberOfRecords; record++)
-                        {
-                            IDENTITY_MAP_CONFIG *element = (IDENTITY_MAP_CONFIG *)VECTOR_element(result, record);
-                            IdentityMapConfig_Free(element);
-                        }
-                        VECTOR_destroy(result);
                         /*Codes_SRS_IDMAP_05_005: [ If configuration is not a JSON array of JSON objects, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]*/
-                        result = NULL;
+                        LogError("Expected a JSON Array or a JSON Object in configuration");
+                        parsed = false;
                     }
                     else
                     {
-                        /*Codes_SRS_IDMAP_17_062: [ IdentityMap_ParseConfigurationFromJson shall return the pointer to the configuration vector on success. ]*/
+                        parsed = IdentityMap_ParseConfigurationObject(jsonObject, result);
                     }
                 }
+
+                if (parsed != true)
+                {
+                    free(result);
+                    result = NULL;
+                }
+                else
+                {
+                    /*Codes_SRS_IDMAP_17_062: [ IdentityMap_ParseConfigurationFromJson shall return the pointer to the configuration vector on success. ]*/
+                }
             }
-			json_value_free(json);
-		}
+            json_value_free(json);
+        }
     }
     return result;
 }
 
+/*
+ * @brief    Free the triplets of a mapping vector and the vector.
+ */
+static void IdentityMap_FreeMappingVector(VECTOR_HANDLE mappingVector)
+{
+    size_t map_size = VECTOR_size(mappingVector);
+    size_t record;
+    for (record = 0; record < map_size; record++)
+    {
+        /*Codes_SRS_IDMAP_05_016: [ IdentityMap_FreeConfiguration shall release all data IdentityMap_ParseConfigurationFromJson allocated. ]*/
+        IDENTITY_MAP_CONFIG * element = (IDENTITY_MAP_CONFIG *)VECTOR_element(mappingVector, record);
+        IdentityMapConfig_Free(element);
+    }
+    VECTOR_destroy(mappingVector);
+}
 
 static void IdentityMap_FreeConfiguration(void * configuration)
 {
     /*Codes_SRS_IDMAP_17_059: [ IdentityMap_FreeConfiguration shall do nothing if configuration is NULL. ]*/
     if (configuration != NULL)
     {
-        VECTOR_HANDLE map_vector = (VECTOR_HANDLE)configuration;
-        size_t map_size = VECTOR_size(map_vector);
-        size_t record;
-        for (record = 0; record < map_size; record++)
+        /*Codes_SRS_IDMAP_05_016: [ IdentityMap_FreeConfiguration shall release all data IdentityMap_ParseConfigurationFromJson allocated. ]*/
+        IDENTITY_MAP_MODULE_CONFIG * config = (IDENTITY_MAP_MODULE_CONFIG *)configuration;
+        IdentityMap_FreeMappingVector(config->mapping);
+        if (config->updateSource != NULL)
         {
-            /*Codes_SRS_IDMAP_05_016: [ IdentityMap_FreeConfiguration shall release all data IdentityMap_ParseConfigurationFromJson allocated. ]*/
-            IDENTITY_MAP_CONFIG * element = (IDENTITY_MAP_CONFIG *)VECTOR_element(map_vector, record);
-            IdentityMapConfig_Free(element);
+            free((void*)config->updateSource);
         }
-        VECTOR_destroy(map_vector);
+        free(config);
     }
 }
 /*
@@ -519,17 +629,152 @@ static void IdentityMap_Destroy(MODULE_HANDLE moduleHandle)
     {
         /*Codes_SRS_IDMAP_17_015: [IdentityMap_Destroy shall release all resources allocated for the module.]*/
         IDENTITY_MAP_DATA * idModule = (IDENTITY_MAP_DATA*)moduleHandle;
-        for (size_t index = 0; index < idModule->mappingSize; index++)
+        IdentityMapTable_Destroy(idModule->table);
+        if (idModule->updateSource != NULL)
         {
-            IdentityMapConfig_Free(&(idModule->macToDevIdArray[index]));
-            IdentityMapConfig_Free(&(idModule->devIdToMacArray[index]));
+            free(idModule->updateSource);
         }
-        free(idModule->macToDevIdArray);
-        free(idModule->devIdToMacArray);
         free(idModule);
     }
 }
 
+/*
+ * @brief    Add the triplets of an update message, the content is an inline JSON array of triplets.
+ */
+static void IdentityMap_AddMappings(IDENTITY_MAP_DATA * idModule, const char * content)
+{
+    JSON_Value* json = json_parse_string(content);
+    if (json == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_024: [ If the content does not parse or validate as an array of triplets, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Unable to parse json string");
+    }
+    else
+    {
+        JSON_Array * jsonArray = json_value_get_array(json);
+        VECTOR_HANDLE mappingVector;
+        if (jsonArray == NULL)
+        {
+            /*Codes_SRS_IDMAP_38_037: [ If the update is "add" and the message content is not a JSON array, in particular an object naming a mapping file, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+            LogError("Expected a JSON Array in the mappings to add");
+        }
+        /*Codes_SRS_IDMAP_38_023: [ If the update is "add", IdentityMap_Receive shall parse the message content as an inline JSON array of triplets, as the "mapping" array of the module configuration. ]*/
+        else if ((mappingVector = IdentityMap_ParseMappingArray(jsonArray)) == NULL)
+        {
+            /*Codes_SRS_IDMAP_38_024: [ If the content does not parse or validate as an array of triplets, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+            LogError("Could not parse the mappings to add");
+        }
+        else
+        {
+            if (IdentityMap_ValidateConfig(mappingVector) == false)
+            {
+                /*Codes_SRS_IDMAP_38_024: [ If the content does not parse or validate as an array of triplets, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+                LogError("unable to validate the mappings to add");
+            }
+            else
+            {
+                size_t mappingSize = VECTOR_size(mappingVector);
+                size_t index;
+                for (index = 0; index < mappingSize; index++)
+                {
+                    /*Codes_SRS_IDMAP_38_025: [ IdentityMap_Receive shall add each triplet to the mapping table by calling IdentityMapTable_Add. ]*/
+                    IDENTITY_MAP_CONFIG * element = (IDENTITY_MAP_CONFIG *)VECTOR_element(mappingVector, index);
+                    if (IdentityMapTable_Add(idModule->table, element) != 0)
+                    {
+                        LogError("Could not add the mapping of %s", element->macAddress);
+                    }
+                }
+            }
+            IdentityMap_FreeMappingVector(mappingVector);
+        }
+        json_value_free(json);
+    }
+}
+
+/*
+ * @brief    Remove the triplets of the MAC addresses of an update message.
+ */
+static void IdentityMap_RemoveMappings(IDENTITY_MAP_DATA * idModule, const char * content)
+{
+    JSON_Value* json = json_parse_string(content);
+    if (json == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_026: [ If the update is "remove" and the message content is not a JSON array, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Unable to parse json string");
+    }
+    else
+    {
+        JSON_Array * jsonArray = json_value_get_array(json);
+        if (jsonArray == NULL)
+        {
+            /*Codes_SRS_IDMAP_38_026: [ If the update is "remove" and the message content is not a JSON array, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+            LogError("Expected a JSON Array in the mappings to remove");
+        }
+        else
+        {
+            size_t numberOfRecords = json_array_get_count(jsonArray);
+            size_t record;
+            for (record = 0; record < numberOfRecords; record++)
+            {
+                const char * macAddress = json_object_get_string(json_array_get_object(jsonArray, record), MACADDR);
+                if (macAddress == NULL)
+                {
+                    LogError("Did not find expected %s in the mappings to remove", MACADDR);
+                }
+                /*Codes_SRS_IDMAP_38_027: [ IdentityMap_Receive shall remove the triplet of the "macAddress" of each object of the array by calling IdentityMapTable_Remove. ]*/
+                else if (IdentityMapTable_Remove(idModule->table, macAddress) != 0)
+                {
+                    LogInfo("No mapping to remove for %s", macAddress);
+                }
+            }
+        }
+        json_value_free(json);
+    }
+}
+
+/*
+ * @brief    Apply an update message to the mapping table.
+ */
+static void IdentityMap_Update(IDENTITY_MAP_DATA * idModule, MESSAGE_HANDLE messageHandle, const char * update)
+{
+    /*Codes_SRS_IDMAP_38_021: [ IdentityMap_Receive shall read the content of an update message as a JSON array of objects. ]*/
+    const CONSTBUFFER * content = Message_GetContent(messageHandle);
+    char * text;
+    if (content == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_022: [ If the update is neither "add" nor "remove", or the content cannot be read, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Could not extract message content");
+    }
+    else if ((text = (char*)malloc(content->size + 1)) == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_022: [ If the update is neither "add" nor "remove", or the content cannot be read, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Could not allocate the mapping update");
+    }
+    else
+    {
+        /*the content is not necessarily terminated*/
+        if (content->size > 0)
+        {
+            (void)memcpy(text, content->buffer, content->size);
+        }
+        text[content->size] = '\0';
+        if (strcmp(update, GW_IDMAP_UPDATE_ADD) == 0)
+        {
+            IdentityMap_AddMappings(idModule, text);
+        }
+        else if (strcmp(update, GW_IDMAP_UPDATE_REMOVE) == 0)
+        {
+            IdentityMap_RemoveMappings(idModule, text);
+        }
+        else
+        {
+            /*Codes_SRS_IDMAP_38_022: [ If the update is neither "add" nor "remove", or the content cannot be read, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+            LogError("Unknown mapping update %s, message dropped", update);
+        }
+        free(text);
+    }
+}
+
 static void publish_with_new_properties(MAP_HANDLE newProperties, MESSAGE_HANDLE messageHandle, IDENTITY_MAP_DATA * idModule)
 {
     /*Codes_SRS_IDMAP_17_034: [IdentityMap_Receive shall clone message content.] */
@@ -575,7 +820,7 @@ static void publish_with_new_properties(MAP_HANDLE newProperties, MESSAGE_HANDLE
 static void IdentityMap_RepublishD2C(
     IDENTITY_MAP_DATA * idModule,
     MESSAGE_HANDLE messageHandle,
-    IDENTITY_MAP_CONFIG * match)
+    const IDENTITY_MAP_CONFIG * match)
 {
     CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
     if (properties == NULL)
@@ -634,7 +879,7 @@ static void IdentityMap_RepublishD2C(
 static void IdentityMap_RepublishC2D(
     IDENTITY_MAP_DATA * idModule,
     MESSAGE_HANDLE messageHandle,
-    IDENTITY_MAP_CONFIG * match)
+    const IDENTITY_MAP_CONFIG * match)
 {
     CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
     if (properties == NULL)
@@ -687,6 +932,36 @@ static void IdentityMap_RepublishC2D(
     }
 }
 
+/* returns true if an update message of source may change the mapping */
+static bool IdentityMap_IsUpdateAccepted(const IDENTITY_MAP_DATA * idModule, const char * source)
+{
+    bool result;
+    if (idModule->updateSource == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_035: [ If the module configuration has no updateSource, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Mapping updates are not enabled, message dropped");
+        result = false;
+    }
+    else if (source == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_036: [ If the "source" property of the update message is missing, is "iothub", "mapping", "bleTelemetry" or "bleCommand", or is not the updateSource of the module configuration, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Mapping update did not contain a source, message dropped");
+        result = false;
+    }
+    else if ((IdentityMap_IsReservedSource(source) == true) ||
+        (strcmp(source, idModule->updateSource) != 0))
+    {
+        /*Codes_SRS_IDMAP_38_036: [ If the "source" property of the update message is missing, is "iothub", "mapping", "bleTelemetry" or "bleCommand", or is not the updateSource of the module configuration, then IdentityMap_Receive shall leave the mapping unchanged. ]*/
+        LogError("Mapping update from %s refused, message dropped", source);
+        result = false;
+    }
+    else
+    {
+        result = true;
+    }
+    return result;
+}
+
 /* returns true if the message should continue to be processed, sets direction */
 static bool determine_message_direction(const char * source, bool * isC2DMessage)
 {
@@ -738,71 +1013,72 @@ static void IdentityMap_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messa
 
         CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
 
-        const char * source = ConstMap_GetValue(properties, GW_SOURCE_PROPERTY);
-        bool isC2DMessage;
-        if (determine_message_direction(source, &isC2DMessage))
+        const char * update = ConstMap_GetValue(properties, GW_IDMAP_UPDATE_PROPERTY);
+        if (update != NULL)
         {
-            if (isC2DMessage == true)
+            /*Codes_SRS_IDMAP_38_020: [ If messageHandle properties contain an "identityMapUpdate" property, then IdentityMap_Receive shall apply the update to the mapping and shall not republish the message. ]*/
+            if (IdentityMap_IsUpdateAccepted(idModule, ConstMap_GetValue(properties, GW_SOURCE_PROPERTY)) == true)
             {
-                const char * deviceName = ConstMap_GetValue(properties, GW_DEVICENAME_PROPERTY);
-                /*Codes_SRS_IDMAP_17_045: [ If messageHandle properties does not contain "deviceName" property, then the message shall not be marked as a C2D message. */
-                if (deviceName != NULL)
-                {
-                    IDENTITY_MAP_CONFIG key = { NULL,deviceName,NULL };
-
-                    IDENTITY_MAP_CONFIG * match = bsearch(&key,
-                        idModule->devIdToMacArray, idModule->mappingSize,
-                        sizeof(IDENTITY_MAP_CONFIG),
-                        IdentityMapConfig_IdCompare);
-                    if (match == NULL)
-                    {
-                        /*Codes_SRS_IDMAP_17_048: [ If the deviceName of the message is not found in deviceToMacArray, then the message shall not be marked as a C2D message. ]*/
-                        LogInfo("Did not find device Id [%s] of current message", deviceName);
-                    }
-                    else
-                    {
-                        IdentityMap_RepublishC2D(idModule, messageHandle, match);
-                    }
-                }
+                IdentityMap_Update(idModule, messageHandle, update);
             }
-            else
+        }
+        else
+        {
+            const char * source = ConstMap_GetValue(properties, GW_SOURCE_PROPERTY);
+            bool isC2DMessage;
+            if (determine_message_direction(source, &isC2DMessage))
             {
-                const char * messageMac = IdentityMapConfig_ToUpperCase(
-                    ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY));
-
-                /*Codes_SRS_IDMAP_17_021: [If messageHandle properties does not contain "macAddress" property, then the function shall return.]*/
-                if (messageMac != NULL)
+                if (isC2DMessage == true)
                 {
-                    /*Codes_SRS_IDMAP_17_024: [If messageHandle properties contains properties "deviceName" and "deviceKey", then this function shall return.] */
-                    if ((ConstMap_GetValue(properties, GW_DEVICENAME_PROPERTY) == NULL ||
-                        ConstMap_GetValue(properties, GW_DEVICEKEY_PROPERTY) == NULL))
+                    const char * deviceName = ConstMap_GetValue(properties, GW_DEVICENAME_PROPERTY);
+                    /*Codes_SRS_IDMAP_17_045: [ If messageHandle properties does not contain "deviceName" property, then the message shall not be marked as a C2D message. */
+                    if (deviceName != NULL)
                     {
-                        if (IdentityMapConfig_IsCanonicalMAC(messageMac) == false)
+                        /*Codes_SRS_IDMAP_38_029: [ IdentityMap_Receive shall find the triplet of the message deviceName by calling IdentityMapTable_FindByDeviceId. ]*/
+                        const IDENTITY_MAP_CONFIG * match = IdentityMapTable_FindByDeviceId(idModule->table, deviceName);
+                        if (match == NULL)
                         {
-                            /*Codes_SRS_IDMAP_17_040: [If the macAddress of the message is not in canonical form, then this function shall return.]*/
-                            LogInfo("MAC address not valid: %s", messageMac);
+                            /*Codes_SRS_IDMAP_17_048: [ If the deviceName of the message is not found in deviceToMacArray, then the message shall not be marked as a C2D message. ]*/
+                            LogInfo("Did not find device Id [%s] of current message", deviceName);
                         }
                         else
                         {
-                            IDENTITY_MAP_CONFIG key = { messageMac,NULL,NULL };
+                            IdentityMap_RepublishC2D(idModule, messageHandle, match);
+                        }
+                    }
+                }
+                else
+                {
+                    const char * messageMac = ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY);
 
-                            IDENTITY_MAP_CONFIG * match = bsearch(&key,
-                                idModule->macToDevIdArray, idModule->mappingSize,
-                                sizeof(IDENTITY_MAP_CONFIG),
-                                IdentityMapConfig_MacCompare);
-                            if (match == NULL)
+                    /*Codes_SRS_IDMAP_17_021: [If messageHandle properties does not contain "macAddress" property, then the function shall return.]*/
+                    if (messageMac != NULL)
+                    {
+                        /*Codes_SRS_IDMAP_17_024: [If messageHandle properties contains properties "deviceName" and "deviceKey", then this function shall return.] */
+                        if ((ConstMap_GetValue(properties, GW_DEVICENAME_PROPERTY) == NULL ||
+                            ConstMap_GetValue(properties, GW_DEVICEKEY_PROPERTY) == NULL))
+                        {
+                            if (IdentityMapConfig_IsCanonicalMAC(messageMac) == false)
                             {
-                                /*Codes_SRS_IDMAP_17_025: [If the macAddress of the message is not found in the macToDeviceArray list, then this function shall return.]*/
-                                LogInfo("Did not find message MAC Address: %s", messageMac);
+                                /*Codes_SRS_IDMAP_17_040: [If the macAddress of the message is not in canonical form, then this function shall return.]*/
+                                LogInfo("MAC address not valid: %s", messageMac);
                             }
                             else
                             {
-                                IdentityMap_RepublishD2C(idModule, messageHandle, match);
+                                /*Codes_SRS_IDMAP_38_028: [ IdentityMap_Receive shall find the triplet of the message macAddress, in either case, by calling IdentityMapTable_FindByMac. ]*/
+                                const IDENTITY_MAP_CONFIG * match = IdentityMapTable_FindByMac(idModule->table, messageMac);
+                                if (match == NULL)
+                                {
+                                    /*Codes_SRS_IDMAP_17_025: [If the macAddress of the message is not found in the macToDeviceArray list, then this function shall return.]*/
+                                    LogInfo("Did not find message MAC Address: %s", messageMac);
+                                }
+                                else
+                                {
+                                    IdentityMap_RepublishD2C(idModule, messageHandle, match);
+                                }
                             }
                         }
                     }
-                    /*Codes_SRS_IDMAP_17_039: [IdentityMap_Receive will destroy all resources it created.]*/
-                    free((void*)messageMac);
                 }
             }
         }
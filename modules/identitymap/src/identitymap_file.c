@@ -0,0 +1,208 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "identitymap_file.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+
+/*
+ * The file is read a line at a time and the triplets are pushed into the
+ * vector a batch at a time, so a mapping of many devices is neither held
+ * twice in memory nor grown one element at a time.
+ */
+
+#define IDENTITY_MAP_FILE_LINE_SIZE 512
+#define IDENTITY_MAP_FILE_BATCH_SIZE 64
+
+static const char utf8ByteOrderMark[] = "\xEF\xBB\xBF";
+
+static char * IdentityMapFile_CopyField(const char * field, size_t length)
+{
+    char * result = (char*)malloc(length + 1);
+    if (result == NULL)
+    {
+        LogError("unable to allocate a mapping field");
+    }
+    else
+    {
+        (void)memcpy(result, field, length);
+        result[length] = '\0';
+    }
+    return result;
+}
+
+static void IdentityMapFile_FreeTriplets(IDENTITY_MAP_CONFIG * triplets, size_t count)
+{
+    size_t index;
+    for (index = 0; index < count; index++)
+    {
+        free((void*)triplets[index].macAddress);
+        free((void*)triplets[index].deviceId);
+        free((void*)triplets[index].deviceKey);
+    }
+}
+
+/*
+ * @brief    Split "macAddress,deviceId,deviceKey". A device ID may hold commas,
+ *            the MAC address ends at the first one and the key starts after the last one.
+ */
+static int IdentityMapFile_ParseLine(char * line, IDENTITY_MAP_CONFIG * triplet)
+{
+    int result;
+    char * firstComma = strchr(line, ',');
+    char * lastComma = strrchr(line, ',');
+    if ((firstComma == NULL) ||
+        (firstComma == line) ||
+        (lastComma == firstComma) ||
+        (lastComma == firstComma + 1) ||
+        (lastComma[1] == '\0'))
+    {
+        /*Codes_SRS_IDMAP_39_005: [ If a line does not have a non empty macAddress, deviceId and deviceKey, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+        result = __LINE__;
+    }
+    else
+    {
+        char * mac;
+        /*Codes_SRS_IDMAP_39_004: [ IdentityMapFile_Read shall upper case the macAddress, as IdentityMap_ParseConfigurationFromJson does. ]*/
+        for (mac = line; mac < firstComma; mac++)
+        {
+            *mac = (char)toupper((unsigned char)*mac);
+        }
+        triplet->macAddress = IdentityMapFile_CopyField(line, (size_t)(firstComma - line));
+        triplet->deviceId = IdentityMapFile_CopyField(firstComma + 1, (size_t)(lastComma - firstComma - 1));
+        triplet->deviceKey = IdentityMapFile_CopyField(lastComma + 1, strlen(lastComma + 1));
+        if ((triplet->macAddress == NULL) ||
+            (triplet->deviceId == NULL) ||
+            (triplet->deviceKey == NULL))
+        {
+            IdentityMapFile_FreeTriplets(triplet, 1);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static int IdentityMapFile_PushBatch(VECTOR_HANDLE mapping, IDENTITY_MAP_CONFIG * batch, size_t count)
+{
+    int result;
+    if (VECTOR_push_back(mapping, batch, count) != 0)
+    {
+        /*Codes_SRS_IDMAP_39_007: [ If pushing into mapping fails, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+        LogError("unable to push %lu triplets", (unsigned long)count);
+        IdentityMapFile_FreeTriplets(batch, count);
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+int IdentityMapFile_Read(const char* fileName, VECTOR_HANDLE mapping)
+{
+    int result;
+    if ((fileName == NULL) || (mapping == NULL))
+    {
+        /*Codes_SRS_IDMAP_39_001: [ If fileName or mapping is NULL, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+        LogError("invalid arguments fileName=%p, mapping=%p", fileName, mapping);
+        result = __LINE__;
+    }
+    else
+    {
+        FILE * file = fopen(fileName, "r");
+        if (file == NULL)
+        {
+            /*Codes_SRS_IDMAP_39_002: [ If the file cannot be opened or read, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+            LogError("unable to open mapping file %s", fileName);
+            result = __LINE__;
+        }
+        else
+        {
+            char line[IDENTITY_MAP_FILE_LINE_SIZE];
+            IDENTITY_MAP_CONFIG batch[IDENTITY_MAP_FILE_BATCH_SIZE];
+            size_t batchCount = 0;
+            unsigned long lineNumber = 0;
+
+            result = 0;
+            while ((result == 0) && (fgets(line, sizeof(line), file) != NULL))
+            {
+                char * text = line;
+                size_t length = strlen(line);
+                lineNumber++;
+                if ((lineNumber == 1) && (strncmp(text, utf8ByteOrderMark, sizeof(utf8ByteOrderMark) - 1) == 0))
+                {
+                    text += sizeof(utf8ByteOrderMark) - 1;
+                    length -= sizeof(utf8ByteOrderMark) - 1;
+                }
+
+                if ((length > 0) && (text[length - 1] == '\n'))
+                {
+                    text[--length] = '\0';
+                    if ((length > 0) && (text[length - 1] == '\r'))
+                    {
+                        text[--length] = '\0';
+                    }
+                }
+                else if (feof(file) == 0)
+                {
+                    /*Codes_SRS_IDMAP_39_006: [ If a line is longer than 510 characters, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+                    LogError("line %lu of %s is too long", lineNumber, fileName);
+                    result = __LINE__;
+                }
+
+                if ((result == 0) && (length > 0) && (text[0] != '#'))
+                {
+                    /*Codes_SRS_IDMAP_39_003: [ IdentityMapFile_Read shall append a triplet to mapping for each line of the file that is neither empty nor starts with '#'. ]*/
+                    if (IdentityMapFile_ParseLine(text, &batch[batchCount]) != 0)
+                    {
+                        LogError("unable to read the triplet of line %lu of %s", lineNumber, fileName);
+                        result = __LINE__;
+                    }
+                    else
+                    {
+                        batchCount++;
+                        if (batchCount == IDENTITY_MAP_FILE_BATCH_SIZE)
+                        {
+                            result = IdentityMapFile_PushBatch(mapping, batch, batchCount);
+                            batchCount = 0;
+                        }
+                    }
+                }
+            }
+
+            if ((result == 0) && (ferror(file) != 0))
+            {
+                /*Codes_SRS_IDMAP_39_002: [ If the file cannot be opened or read, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+                LogError("unable to read mapping file %s", fileName);
+                result = __LINE__;
+            }
+
+            if (result != 0)
+            {
+                IdentityMapFile_FreeTriplets(batch, batchCount);
+            }
+            else if (batchCount > 0)
+            {
+                result = IdentityMapFile_PushBatch(mapping, batch, batchCount);
+            }
+            else
+            {
+                /*Codes_SRS_IDMAP_39_008: [ Otherwise IdentityMapFile_Read shall return 0. ]*/
+            }
+            (void)fclose(file);
+        }
+    }
+    return result;
+}
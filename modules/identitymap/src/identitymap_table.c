@@ -0,0 +1,508 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "identitymap_table.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+
+/*
+ * The triplets are kept packed in one array. Two open addressing tables
+ * with linear probing index them, one by the 48 bit MAC address and one by
+ * deviceId, each slot holding the position of a triplet plus one so that 0
+ * is an empty slot. The tables are kept at most half full, and removing a
+ * slot shifts the slots after it back so no tombstones are left behind.
+ */
+
+#define IDENTITY_MAP_TABLE_MIN_SLOTS 16
+#define IDENTITY_MAP_TABLE_MIN_ENTRIES 8
+#define IDENTITY_MAP_TABLE_MAC_LENGTH 17
+
+typedef struct IDENTITY_MAP_TABLE_ENTRY_TAG
+{
+    /*macAddress points at macText, deviceId and deviceKey share one allocation*/
+    IDENTITY_MAP_CONFIG config;
+    uint64_t mac;
+    uint32_t idHash;
+    char macText[IDENTITY_MAP_TABLE_MAC_LENGTH + 1];
+} IDENTITY_MAP_TABLE_ENTRY;
+
+typedef struct IDENTITY_MAP_TABLE_TAG
+{
+    IDENTITY_MAP_TABLE_ENTRY* entries;
+    size_t count;
+    size_t capacity;
+    /*slotCount of each, a power of 2*/
+    uint32_t* macSlots;
+    uint32_t* idSlots;
+    size_t slotCount;
+} IDENTITY_MAP_TABLE;
+
+/*the splitmix64 finalizer, the low bits of a MAC address alone are poorly spread*/
+static size_t hash_mac(uint64_t mac)
+{
+    mac ^= mac >> 30;
+    mac *= 0xbf58476d1ce4e5b9ULL;
+    mac ^= mac >> 27;
+    mac *= 0x94d049bb133111ebULL;
+    mac ^= mac >> 31;
+    return (size_t)mac;
+}
+
+/*FNV-1a*/
+static uint32_t hash_device_id(const char* deviceId)
+{
+    uint32_t result = 2166136261u;
+    while (*deviceId != '\0')
+    {
+        result ^= (unsigned char)*deviceId++;
+        result *= 16777619u;
+    }
+    return result;
+}
+
+static int hex_value(char c)
+{
+    int result;
+    if (c >= '0' && c <= '9')
+    {
+        result = c - '0';
+    }
+    else if (c >= 'a' && c <= 'f')
+    {
+        result = c - 'a' + 10;
+    }
+    else if (c >= 'A' && c <= 'F')
+    {
+        result = c - 'A' + 10;
+    }
+    else
+    {
+        result = -1;
+    }
+    return result;
+}
+
+bool IdentityMapTable_PackMac(const char* macAddress, uint64_t* mac)
+{
+    bool result;
+    if (macAddress == NULL || mac == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_001: [ If macAddress or mac is NULL, or macAddress is not a canonical MAC address in either case, then IdentityMapTable_PackMac shall return false. ]*/
+        result = false;
+    }
+    else
+    {
+        /* "XX:XX:XX:XX:XX:XX", the terminator is checked last so a short string stops at it */
+        uint64_t packed = 0;
+        size_t index;
+        result = true;
+        for (index = 0; index < IDENTITY_MAP_TABLE_MAC_LENGTH; index++)
+        {
+            if (index % 3 == 2)
+            {
+                if (macAddress[index] != ':')
+                {
+                    result = false;
+                    break;
+                }
+            }
+            else
+            {
+                int digit = hex_value(macAddress[index]);
+                if (digit < 0)
+                {
+                    result = false;
+                    break;
+                }
+                packed = (packed << 4) | (uint64_t)digit;
+            }
+        }
+        if (result == true && macAddress[IDENTITY_MAP_TABLE_MAC_LENGTH] != '\0')
+        {
+            result = false;
+        }
+        if (result == true)
+        {
+            /*Codes_SRS_IDMAP_38_002: [ Otherwise IdentityMapTable_PackMac shall set mac to the 48 bits of macAddress and return true. ]*/
+            *mac = packed;
+        }
+    }
+    return result;
+}
+
+static void format_mac(uint64_t mac, char* macText)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    size_t index;
+    for (index = 0; index < 6; index++)
+    {
+        unsigned int octet = (unsigned int)((mac >> (8 * (5 - index))) & 0xFF);
+        macText[index * 3] = digits[octet >> 4];
+        macText[index * 3 + 1] = digits[octet & 0x0F];
+        macText[index * 3 + 2] = (index < 5) ? ':' : '\0';
+    }
+}
+
+static size_t slot_home(const IDENTITY_MAP_TABLE* table, const uint32_t* slots, uint32_t slot)
+{
+    const IDENTITY_MAP_TABLE_ENTRY* entry = &(table->entries[slot - 1]);
+    size_t hash = (slots == table->macSlots) ? hash_mac(entry->mac) : (size_t)entry->idHash;
+    return hash & (table->slotCount - 1);
+}
+
+/*the slot of mac, or the empty slot where it would go*/
+static size_t find_mac_slot(const IDENTITY_MAP_TABLE* table, uint64_t mac)
+{
+    size_t mask = table->slotCount - 1;
+    size_t index = hash_mac(mac) & mask;
+    while (table->macSlots[index] != 0 &&
+        table->entries[table->macSlots[index] - 1].mac != mac)
+    {
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+/*the slot of deviceId, or the empty slot where it would go*/
+static size_t find_id_slot(const IDENTITY_MAP_TABLE* table, const char* deviceId, uint32_t idHash)
+{
+    size_t mask = table->slotCount - 1;
+    size_t index = idHash & mask;
+    while (table->idSlots[index] != 0)
+    {
+        const IDENTITY_MAP_TABLE_ENTRY* entry = &(table->entries[table->idSlots[index] - 1]);
+        if (entry->idHash == idHash && strcmp(entry->config.deviceId, deviceId) == 0)
+        {
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+    return index;
+}
+
+/*empties a slot and moves back the slots after it that would not be found past the hole*/
+static void clear_slot(const IDENTITY_MAP_TABLE* table, uint32_t* slots, size_t hole)
+{
+    size_t mask = table->slotCount - 1;
+    size_t next = (hole + 1) & mask;
+    while (slots[next] != 0)
+    {
+        size_t home = slot_home(table, slots, slots[next]);
+        /*the slot can fill the hole if its home is not cyclically within (hole, next]*/
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            slots[hole] = slots[next];
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[hole] = 0;
+}
+
+static void index_entry(IDENTITY_MAP_TABLE* table, size_t position)
+{
+    const IDENTITY_MAP_TABLE_ENTRY* entry = &(table->entries[position]);
+    table->macSlots[find_mac_slot(table, entry->mac)] = (uint32_t)(position + 1);
+    table->idSlots[find_id_slot(table, entry->config.deviceId, entry->idHash)] = (uint32_t)(position + 1);
+}
+
+static void remove_entry(IDENTITY_MAP_TABLE* table, size_t position)
+{
+    IDENTITY_MAP_TABLE_ENTRY* entry = &(table->entries[position]);
+    size_t last = table->count - 1;
+
+    clear_slot(table, table->macSlots, find_mac_slot(table, entry->mac));
+    clear_slot(table, table->idSlots, find_id_slot(table, entry->config.deviceId, entry->idHash));
+    free((void*)entry->config.deviceId);
+
+    if (position != last)
+    {
+        /*the last triplet fills the gap, its slots are pointed at its new position*/
+        IDENTITY_MAP_TABLE_ENTRY* moved = &(table->entries[last]);
+        size_t macSlot = find_mac_slot(table, moved->mac);
+        size_t idSlot = find_id_slot(table, moved->config.deviceId, moved->idHash);
+        *entry = *moved;
+        entry->config.macAddress = entry->macText;
+        table->macSlots[macSlot] = (uint32_t)(position + 1);
+        table->idSlots[idSlot] = (uint32_t)(position + 1);
+    }
+    table->count--;
+}
+
+static size_t slots_for(size_t count)
+{
+    size_t result = IDENTITY_MAP_TABLE_MIN_SLOTS;
+    while (result < 2 * count)
+    {
+        result *= 2;
+    }
+    return result;
+}
+
+/*only ever grows, so the index IdentityMapTable_Create sized is kept*/
+static int reserve_slots(IDENTITY_MAP_TABLE* table, size_t count)
+{
+    int result;
+    size_t slotCount = slots_for(count);
+    if (slotCount <= table->slotCount)
+    {
+        result = 0;
+    }
+    else
+    {
+        uint32_t* macSlots = (uint32_t*)calloc(slotCount, sizeof(uint32_t));
+        uint32_t* idSlots = (uint32_t*)calloc(slotCount, sizeof(uint32_t));
+        if (macSlots == NULL || idSlots == NULL)
+        {
+            LogError("unable to allocate %lu slots", (unsigned long)slotCount);
+            free(macSlots);
+            free(idSlots);
+            result = __LINE__;
+        }
+        else
+        {
+            size_t position;
+            free(table->macSlots);
+            free(table->idSlots);
+            table->macSlots = macSlots;
+            table->idSlots = idSlots;
+            table->slotCount = slotCount;
+            for (position = 0; position < table->count; position++)
+            {
+                index_entry(table, position);
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static int reserve_entries(IDENTITY_MAP_TABLE* table, size_t count)
+{
+    int result;
+    if (count <= table->capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t capacity = table->capacity * 2;
+        IDENTITY_MAP_TABLE_ENTRY* entries;
+        if (capacity < count)
+        {
+            capacity = count;
+        }
+        entries = (IDENTITY_MAP_TABLE_ENTRY*)realloc(table->entries, capacity * sizeof(IDENTITY_MAP_TABLE_ENTRY));
+        if (entries == NULL)
+        {
+            LogError("unable to allocate %lu entries", (unsigned long)capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            size_t position;
+            table->entries = entries;
+            table->capacity = capacity;
+            for (position = 0; position < table->count; position++)
+            {
+                entries[position].config.macAddress = entries[position].macText;
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+IDENTITY_MAP_TABLE_HANDLE IdentityMapTable_Create(size_t expectedCount)
+{
+    IDENTITY_MAP_TABLE* result = (IDENTITY_MAP_TABLE*)malloc(sizeof(IDENTITY_MAP_TABLE));
+    if (result == NULL)
+    {
+        LogError("unable to allocate the identity map table");
+    }
+    else
+    {
+        /*Codes_SRS_IDMAP_38_003: [ Otherwise IdentityMapTable_Create shall return an empty table sized for expectedCount triplets. ]*/
+        size_t capacity = (expectedCount < IDENTITY_MAP_TABLE_MIN_ENTRIES) ? IDENTITY_MAP_TABLE_MIN_ENTRIES : expectedCount;
+        result->count = 0;
+        result->capacity = capacity;
+        result->slotCount = slots_for(capacity);
+        result->entries = (IDENTITY_MAP_TABLE_ENTRY*)malloc(capacity * sizeof(IDENTITY_MAP_TABLE_ENTRY));
+        result->macSlots = (uint32_t*)calloc(result->slotCount, sizeof(uint32_t));
+        result->idSlots = (uint32_t*)calloc(result->slotCount, sizeof(uint32_t));
+        if (result->entries == NULL || result->macSlots == NULL || result->idSlots == NULL)
+        {
+            LogError("unable to allocate the identity map table for %lu triplets", (unsigned long)capacity);
+            free(result->entries);
+            free(result->macSlots);
+            free(result->idSlots);
+            free(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+int IdentityMapTable_Add(IDENTITY_MAP_TABLE_HANDLE handle, const IDENTITY_MAP_CONFIG* entry)
+{
+    int result;
+    uint64_t mac;
+    /*Codes_SRS_IDMAP_38_004: [ If handle or entry is NULL, or any string of entry is NULL, or its macAddress is not canonical, then IdentityMapTable_Add shall fail and return a non-zero value. ]*/
+    if (handle == NULL || entry == NULL || entry->deviceId == NULL || entry->deviceKey == NULL)
+    {
+        LogError("invalid arg handle=%p, entry=%p", handle, entry);
+        result = __LINE__;
+    }
+    else if (IdentityMapTable_PackMac(entry->macAddress, &mac) == false)
+    {
+        LogError("Non-canonical MAC Address: %s", (entry->macAddress == NULL) ? "NULL" : entry->macAddress);
+        result = __LINE__;
+    }
+    /*room for one more is made first so a failure leaves the table as it was*/
+    else if (reserve_entries(handle, handle->count + 1) != 0 ||
+        reserve_slots(handle, handle->count + 1) != 0)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        size_t idLength = strlen(entry->deviceId);
+        size_t keyLength = strlen(entry->deviceKey);
+        char* strings = (char*)malloc(idLength + keyLength + 2);
+        if (strings == NULL)
+        {
+            LogError("unable to copy the strings of %s", entry->deviceId);
+            result = __LINE__;
+        }
+        else
+        {
+            uint32_t idHash = hash_device_id(entry->deviceId);
+            size_t slot;
+            IDENTITY_MAP_TABLE_ENTRY* added;
+
+            (void)memcpy(strings, entry->deviceId, idLength + 1);
+            (void)memcpy(strings + idLength + 1, entry->deviceKey, keyLength + 1);
+
+            /*Codes_SRS_IDMAP_38_005: [ IdentityMapTable_Add shall replace the triplet of the same macAddress. ]*/
+            slot = find_mac_slot(handle, mac);
+            if (handle->macSlots[slot] != 0)
+            {
+                remove_entry(handle, handle->macSlots[slot] - 1);
+            }
+            /*Codes_SRS_IDMAP_38_006: [ IdentityMapTable_Add shall remove the triplet of the same deviceId with another macAddress. ]*/
+            slot = find_id_slot(handle, entry->deviceId, idHash);
+            if (handle->idSlots[slot] != 0)
+            {
+                remove_entry(handle, handle->idSlots[slot] - 1);
+            }
+
+            /*Codes_SRS_IDMAP_38_007: [ Otherwise IdentityMapTable_Add shall add a copy of entry and return 0, growing the table as needed. ]*/
+            added = &(handle->entries[handle->count]);
+            added->mac = mac;
+            added->idHash = idHash;
+            format_mac(mac, added->macText);
+            added->config.macAddress = added->macText;
+            added->config.deviceId = strings;
+            added->config.deviceKey = strings + idLength + 1;
+            index_entry(handle, handle->count);
+            handle->count++;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+int IdentityMapTable_Remove(IDENTITY_MAP_TABLE_HANDLE handle, const char* macAddress)
+{
+    int result;
+    uint64_t mac;
+    if (handle == NULL || IdentityMapTable_PackMac(macAddress, &mac) == false)
+    {
+        /*Codes_SRS_IDMAP_38_008: [ If handle is NULL or there is no triplet for macAddress then IdentityMapTable_Remove shall return a non-zero value. ]*/
+        result = __LINE__;
+    }
+    else
+    {
+        size_t slot = find_mac_slot(handle, mac);
+        if (handle->macSlots[slot] == 0)
+        {
+            /*Codes_SRS_IDMAP_38_008: [ If handle is NULL or there is no triplet for macAddress then IdentityMapTable_Remove shall return a non-zero value. ]*/
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IDMAP_38_009: [ Otherwise IdentityMapTable_Remove shall remove the triplet of macAddress, whatever its case, and return 0. ]*/
+            remove_entry(handle, handle->macSlots[slot] - 1);
+            result = 0;
+        }
+    }
+    return result;
+}
+
+const IDENTITY_MAP_CONFIG* IdentityMapTable_FindByMac(IDENTITY_MAP_TABLE_HANDLE handle, const char* macAddress)
+{
+    const IDENTITY_MAP_CONFIG* result;
+    uint64_t mac;
+    if (handle == NULL || IdentityMapTable_PackMac(macAddress, &mac) == false)
+    {
+        /*Codes_SRS_IDMAP_38_010: [ If handle or macAddress is NULL, or there is no triplet for macAddress, then IdentityMapTable_FindByMac shall return NULL. ]*/
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IDMAP_38_010: [ If handle or macAddress is NULL, or there is no triplet for macAddress, then IdentityMapTable_FindByMac shall return NULL. ]*/
+        /*Codes_SRS_IDMAP_38_011: [ Otherwise IdentityMapTable_FindByMac shall return the triplet of macAddress, whatever its case, with an upper case macAddress. ]*/
+        uint32_t slot = handle->macSlots[find_mac_slot(handle, mac)];
+        result = (slot == 0) ? NULL : &(handle->entries[slot - 1].config);
+    }
+    return result;
+}
+
+const IDENTITY_MAP_CONFIG* IdentityMapTable_FindByDeviceId(IDENTITY_MAP_TABLE_HANDLE handle, const char* deviceId)
+{
+    const IDENTITY_MAP_CONFIG* result;
+    if (handle == NULL || deviceId == NULL)
+    {
+        /*Codes_SRS_IDMAP_38_012: [ If handle or deviceId is NULL, or there is no triplet for deviceId, then IdentityMapTable_FindByDeviceId shall return NULL. ]*/
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IDMAP_38_012: [ If handle or deviceId is NULL, or there is no triplet for deviceId, then IdentityMapTable_FindByDeviceId shall return NULL. ]*/
+        /*Codes_SRS_IDMAP_38_013: [ Otherwise IdentityMapTable_FindByDeviceId shall return the triplet of deviceId. ]*/
+        uint32_t slot = handle->idSlots[find_id_slot(handle, deviceId, hash_device_id(deviceId))];
+        result = (slot == 0) ? NULL : &(handle->entries[slot - 1].config);
+    }
+    return result;
+}
+
+size_t IdentityMapTable_GetCount(IDENTITY_MAP_TABLE_HANDLE handle)
+{
+    /*Codes_SRS_IDMAP_38_014: [ IdentityMapTable_GetCount shall return the number of triplets in the table, 0 if handle is NULL. ]*/
+    return (handle == NULL) ? 0 : handle->count;
+}
+
+void IdentityMapTable_Destroy(IDENTITY_MAP_TABLE_HANDLE handle)
+{
+    /*Codes_SRS_IDMAP_38_015: [ IdentityMapTable_Destroy shall free the table and its copies of the strings, and do nothing if handle is NULL. ]*/
+    if (handle != NULL)
+    {
+        size_t position;
+        for (position = 0; position < handle->count; position++)
+        {
+            free((void*)handle->entries[position].config.deviceId);
+        }
+        free(handle->entries);
+        free(handle->macSlots);
+        free(handle->idSlots);
+        free(handle);
+    }
+}
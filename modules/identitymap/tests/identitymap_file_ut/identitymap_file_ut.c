@@ -0,0 +1,215 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "identitymap_file.h"
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define TEST_FILE_NAME "identitymap_file_ut.csv"
+#define DEVICE_COUNT 1000
+
+static void write_test_file(const char* content)
+{
+    FILE* file = fopen(TEST_FILE_NAME, "wb");
+    ASSERT_IS_NOT_NULL(file);
+    ASSERT_ARE_EQUAL(size_t, strlen(content), fwrite(content, 1, strlen(content), file));
+    ASSERT_ARE_EQUAL(int, 0, fclose(file));
+}
+
+static void free_mapping(VECTOR_HANDLE mapping)
+{
+    size_t index;
+    for (index = 0; index < VECTOR_size(mapping); index++)
+    {
+        IDENTITY_MAP_CONFIG* triplet = (IDENTITY_MAP_CONFIG*)VECTOR_element(mapping, index);
+        free((void*)triplet->macAddress);
+        free((void*)triplet->deviceId);
+        free((void*)triplet->deviceKey);
+    }
+    VECTOR_destroy(mapping);
+}
+
+static void assert_triplet(VECTOR_HANDLE mapping, size_t index, const char* macAddress, const char* deviceId, const char* deviceKey)
+{
+    IDENTITY_MAP_CONFIG* triplet = (IDENTITY_MAP_CONFIG*)VECTOR_element(mapping, index);
+    ASSERT_IS_NOT_NULL(triplet);
+    ASSERT_ARE_EQUAL(char_ptr, macAddress, triplet->macAddress);
+    ASSERT_ARE_EQUAL(char_ptr, deviceId, triplet->deviceId);
+    ASSERT_ARE_EQUAL(char_ptr, deviceKey, triplet->deviceKey);
+}
+
+static int read_content(const char* content, VECTOR_HANDLE mapping)
+{
+    int result;
+    write_test_file(content);
+    result = IdentityMapFile_Read(TEST_FILE_NAME, mapping);
+    (void)remove(TEST_FILE_NAME);
+    return result;
+}
+
+BEGIN_TEST_SUITE(identitymap_file_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_IDMAP_39_001: [ If fileName or mapping is NULL, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IDMAP_39_002: [ If the file cannot be opened or read, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IdentityMapFile_Read_rejects_invalid_arguments)
+{
+    VECTOR_HANDLE mapping = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+    ASSERT_IS_NOT_NULL(mapping);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapFile_Read(NULL, mapping));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapFile_Read(TEST_FILE_NAME, NULL));
+    (void)remove(TEST_FILE_NAME);
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapFile_Read(TEST_FILE_NAME, mapping));
+    ASSERT_ARE_EQUAL(size_t, 0, VECTOR_size(mapping));
+
+    free_mapping(mapping);
+}
+
+/*Tests_SRS_IDMAP_39_003: [ IdentityMapFile_Read shall append a triplet to mapping for each line of the file that is neither empty nor starts with '#'. ]*/
+/*Tests_SRS_IDMAP_39_004: [ IdentityMapFile_Read shall upper case the macAddress, as IdentityMap_ParseConfigurationFromJson does. ]*/
+/*Tests_SRS_IDMAP_39_008: [ Otherwise IdentityMapFile_Read shall return 0. ]*/
+TEST_FUNCTION(IdentityMapFile_Read_reads_triplets)
+{
+    VECTOR_HANDLE mapping = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+    ASSERT_IS_NOT_NULL(mapping);
+
+    ASSERT_ARE_EQUAL(int, 0, read_content(
+        "\xEF\xBB\xBF# macAddress,deviceId,deviceKey\n"
+        "aa:bb:cc:dd:ee:ff,device1,key1\n"
+        "\n"
+        "01:02:03:04:05:06,device,with,commas,key2\r\n"
+        "\r\n"
+        "11:22:33:44:55:66,device3,a2V5Mw==", mapping));
+
+    ASSERT_ARE_EQUAL(size_t, 3, VECTOR_size(mapping));
+    assert_triplet(mapping, 0, "AA:BB:CC:DD:EE:FF", "device1", "key1");
+    assert_triplet(mapping, 1, "01:02:03:04:05:06", "device,with,commas", "key2");
+    assert_triplet(mapping, 2, "11:22:33:44:55:66", "device3", "a2V5Mw==");
+
+    /*a second file is appended*/
+    ASSERT_ARE_EQUAL(int, 0, read_content("22:22:22:22:22:22,device4,key4\n", mapping));
+    ASSERT_ARE_EQUAL(size_t, 4, VECTOR_size(mapping));
+    assert_triplet(mapping, 3, "22:22:22:22:22:22", "device4", "key4");
+
+    /*an empty file has no triplets*/
+    ASSERT_ARE_EQUAL(int, 0, read_content("", mapping));
+    ASSERT_ARE_EQUAL(size_t, 4, VECTOR_size(mapping));
+
+    free_mapping(mapping);
+}
+
+/*Tests_SRS_IDMAP_39_003: [ IdentityMapFile_Read shall append a triplet to mapping for each line of the file that is neither empty nor starts with '#'. ]*/
+TEST_FUNCTION(IdentityMapFile_Read_reads_many_triplets)
+{
+    VECTOR_HANDLE mapping = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+    FILE* file = fopen(TEST_FILE_NAME, "wb");
+    size_t i;
+    ASSERT_IS_NOT_NULL(mapping);
+    ASSERT_IS_NOT_NULL(file);
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        ASSERT_IS_TRUE(fprintf(file, "00:00:00:00:%02X:%02X,device%lu,key%lu\n",
+            (unsigned int)((i >> 8) & 0xFF), (unsigned int)(i & 0xFF), (unsigned long)i, (unsigned long)i) > 0);
+    }
+    ASSERT_ARE_EQUAL(int, 0, fclose(file));
+
+    ASSERT_ARE_EQUAL(int, 0, IdentityMapFile_Read(TEST_FILE_NAME, mapping));
+    (void)remove(TEST_FILE_NAME);
+
+    ASSERT_ARE_EQUAL(size_t, DEVICE_COUNT, VECTOR_size(mapping));
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        char mac[18];
+        char id[32];
+        char key[32];
+        (void)sprintf(mac, "00:00:00:00:%02X:%02X", (unsigned int)((i >> 8) & 0xFF), (unsigned int)(i & 0xFF));
+        (void)sprintf(id, "device%lu", (unsigned long)i);
+        (void)sprintf(key, "key%lu", (unsigned long)i);
+        assert_triplet(mapping, i, mac, id, key);
+    }
+
+    free_mapping(mapping);
+}
+
+/*Tests_SRS_IDMAP_39_005: [ If a line does not have a non empty macAddress, deviceId and deviceKey, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IDMAP_39_006: [ If a line is longer than 510 characters, then IdentityMapFile_Read shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IdentityMapFile_Read_fails_on_bad_lines)
+{
+    static const char* const badLines[] =
+    {
+        "aa:bb:cc:dd:ee:ff\n",
+        "aa:bb:cc:dd:ee:ff,device\n",
+        ",device,key\n",
+        "aa:bb:cc:dd:ee:ff,,key\n",
+        "aa:bb:cc:dd:ee:ff,device,\n",
+        "aa:bb:cc:dd:ee:ff,device,\r\n"
+    };
+    char longLine[600];
+    size_t i;
+    VECTOR_HANDLE mapping = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+    ASSERT_IS_NOT_NULL(mapping);
+
+    for (i = 0; i < sizeof(badLines) / sizeof(badLines[0]); i++)
+    {
+        char content[128];
+        (void)sprintf(content, "01:01:01:01:01:01,device,key\n%s02:02:02:02:02:02,device2,key2\n", badLines[i]);
+        ASSERT_ARE_NOT_EQUAL(int, 0, read_content(content, mapping));
+        ASSERT_ARE_EQUAL(size_t, 0, VECTOR_size(mapping));
+    }
+
+    (void)memset(longLine, 'k', sizeof(longLine) - 2);
+    (void)memcpy(longLine, "01:01:01:01:01:01,device,", 25);
+    longLine[sizeof(longLine) - 2] = '\n';
+    longLine[sizeof(longLine) - 1] = '\0';
+    ASSERT_ARE_NOT_EQUAL(int, 0, read_content(longLine, mapping));
+    ASSERT_ARE_EQUAL(size_t, 0, VECTOR_size(mapping));
+
+    /*just short enough*/
+    (void)strcpy(longLine + 510, "\n");
+    ASSERT_ARE_EQUAL(int, 0, read_content(longLine, mapping));
+    ASSERT_ARE_EQUAL(size_t, 1, VECTOR_size(mapping));
+    ASSERT_ARE_EQUAL(size_t, 485, strlen(((IDENTITY_MAP_CONFIG*)VECTOR_element(mapping, 0))->deviceKey));
+
+    free_mapping(mapping);
+}
+
+END_TEST_SUITE(identitymap_file_ut)
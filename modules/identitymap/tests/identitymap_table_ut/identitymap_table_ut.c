@@ -0,0 +1,307 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "identitymap_table.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define DEVICE_COUNT 1000
+
+static const char* mac_address(size_t index)
+{
+    static char mac[18];
+    (void)sprintf(mac, "00:00:00:00:%02X:%02X", (unsigned int)((index >> 8) & 0xFF), (unsigned int)(index & 0xFF));
+    return mac;
+}
+
+static const char* device_id(size_t index)
+{
+    static char id[32];
+    (void)sprintf(id, "device%lu", (unsigned long)index);
+    return id;
+}
+
+static int add_triplet(IDENTITY_MAP_TABLE_HANDLE table, const char* macAddress, const char* deviceId, const char* deviceKey)
+{
+    IDENTITY_MAP_CONFIG entry;
+    entry.macAddress = macAddress;
+    entry.deviceId = deviceId;
+    entry.deviceKey = deviceKey;
+    return IdentityMapTable_Add(table, &entry);
+}
+
+static int add_device(IDENTITY_MAP_TABLE_HANDLE table, size_t index)
+{
+    char mac[18];
+    (void)strcpy(mac, mac_address(index));
+    return add_triplet(table, mac, device_id(index), "key");
+}
+
+BEGIN_TEST_SUITE(identitymap_table_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_IDMAP_38_001: [ If macAddress or mac is NULL, or macAddress is not a canonical MAC address in either case, then IdentityMapTable_PackMac shall return false. ]*/
+/*Tests_SRS_IDMAP_38_002: [ Otherwise IdentityMapTable_PackMac shall set mac to the 48 bits of macAddress and return true. ]*/
+TEST_FUNCTION(IdentityMapTable_PackMac_packs_canonical_addresses)
+{
+    uint64_t mac = 0;
+
+    ASSERT_IS_TRUE(IdentityMapTable_PackMac("01:23:45:67:89:AB", &mac));
+    ASSERT_IS_TRUE(mac == 0x0123456789ABULL);
+    ASSERT_IS_TRUE(IdentityMapTable_PackMac("ff:ee:dd:cc:bb:aa", &mac));
+    ASSERT_IS_TRUE(mac == 0xFFEEDDCCBBAAULL);
+
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac(NULL, &mac));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("01:23:45:67:89:AB", NULL));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("", &mac));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("01:23:45:67:89", &mac));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("01:23:45:67:89:AB:", &mac));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("01-23-45-67-89-AB", &mac));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("01:23:45:67:89:AG", &mac));
+    ASSERT_IS_FALSE(IdentityMapTable_PackMac("0123:45:67:89:AB:", &mac));
+    ASSERT_IS_TRUE(mac == 0xFFEEDDCCBBAAULL);
+}
+
+/*Tests_SRS_IDMAP_38_004: [ If handle or entry is NULL, or any string of entry is NULL, or its macAddress is not canonical, then IdentityMapTable_Add shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IDMAP_38_008: [ If handle is NULL or there is no triplet for macAddress then IdentityMapTable_Remove shall return a non-zero value. ]*/
+/*Tests_SRS_IDMAP_38_010: [ If handle or macAddress is NULL, or there is no triplet for macAddress, then IdentityMapTable_FindByMac shall return NULL. ]*/
+/*Tests_SRS_IDMAP_38_012: [ If handle or deviceId is NULL, or there is no triplet for deviceId, then IdentityMapTable_FindByDeviceId shall return NULL. ]*/
+/*Tests_SRS_IDMAP_38_014: [ IdentityMapTable_GetCount shall return the number of triplets in the table, 0 if handle is NULL. ]*/
+/*Tests_SRS_IDMAP_38_015: [ IdentityMapTable_Destroy shall free the table and its copies of the strings, and do nothing if handle is NULL. ]*/
+TEST_FUNCTION(IdentityMapTable_rejects_invalid_arguments)
+{
+    IDENTITY_MAP_TABLE_HANDLE table = IdentityMapTable_Create(0);
+    ASSERT_IS_NOT_NULL(table);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, add_triplet(NULL, "01:23:45:67:89:AB", "device", "key"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapTable_Add(table, NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, add_triplet(table, NULL, "device", "key"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, add_triplet(table, "01:23:45:67:89:AB", NULL, "key"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, add_triplet(table, "01:23:45:67:89:AB", "device", NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, add_triplet(table, "01:23:45:67:89", "device", "key"));
+    ASSERT_ARE_EQUAL(size_t, 0, IdentityMapTable_GetCount(table));
+    ASSERT_ARE_EQUAL(size_t, 0, IdentityMapTable_GetCount(NULL));
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapTable_Remove(NULL, "01:23:45:67:89:AB"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapTable_Remove(table, NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapTable_Remove(table, "01:23:45:67:89:AB"));
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(NULL, "01:23:45:67:89:AB"));
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(table, NULL));
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(table, "01:23:45:67:89:AB"));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(NULL, "device"));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, NULL));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, "device"));
+
+    IdentityMapTable_Destroy(NULL);
+    IdentityMapTable_Destroy(table);
+}
+
+/*Tests_SRS_IDMAP_38_003: [ Otherwise IdentityMapTable_Create shall return an empty table sized for expectedCount triplets. ]*/
+/*Tests_SRS_IDMAP_38_007: [ Otherwise IdentityMapTable_Add shall add a copy of entry and return 0, growing the table as needed. ]*/
+/*Tests_SRS_IDMAP_38_011: [ Otherwise IdentityMapTable_FindByMac shall return the triplet of macAddress, whatever its case, with an upper case macAddress. ]*/
+/*Tests_SRS_IDMAP_38_013: [ Otherwise IdentityMapTable_FindByDeviceId shall return the triplet of deviceId. ]*/
+TEST_FUNCTION(IdentityMapTable_finds_what_was_added)
+{
+    IDENTITY_MAP_TABLE_HANDLE table = IdentityMapTable_Create(1);
+    char mac[] = "aa:bb:cc:dd:ee:ff";
+    char id[] = "device";
+    char key[] = "key";
+    const IDENTITY_MAP_CONFIG* found;
+    size_t i;
+    ASSERT_IS_NOT_NULL(table);
+
+    ASSERT_ARE_EQUAL(int, 0, add_triplet(table, mac, id, key));
+    /*the strings are copied*/
+    mac[0] = 'b';
+    id[0] = 'D';
+    key[0] = 'K';
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(table, mac));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, id));
+
+    found = IdentityMapTable_FindByMac(table, "AA:bb:CC:dd:EE:ff");
+    ASSERT_IS_NOT_NULL(found);
+    ASSERT_ARE_EQUAL(char_ptr, "AA:BB:CC:DD:EE:FF", found->macAddress);
+    ASSERT_ARE_EQUAL(char_ptr, "device", found->deviceId);
+    ASSERT_ARE_EQUAL(char_ptr, "key", found->deviceKey);
+    ASSERT_IS_TRUE(IdentityMapTable_FindByDeviceId(table, "device") == found);
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, "DEVICE"));
+
+    /*enough triplets for the table to grow a few times*/
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, add_device(table, i));
+    }
+    ASSERT_ARE_EQUAL(size_t, DEVICE_COUNT + 1, IdentityMapTable_GetCount(table));
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        found = IdentityMapTable_FindByMac(table, mac_address(i));
+        ASSERT_IS_NOT_NULL(found);
+        ASSERT_ARE_EQUAL(char_ptr, device_id(i), found->deviceId);
+        ASSERT_ARE_EQUAL(char_ptr, mac_address(i), found->macAddress);
+        ASSERT_IS_TRUE(IdentityMapTable_FindByDeviceId(table, device_id(i)) == found);
+    }
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(table, mac_address(DEVICE_COUNT)));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, device_id(DEVICE_COUNT)));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, ""));
+
+    IdentityMapTable_Destroy(table);
+}
+
+/*Tests_SRS_IDMAP_38_003: [ Otherwise IdentityMapTable_Create shall return an empty table sized for expectedCount triplets. ]*/
+TEST_FUNCTION(IdentityMapTable_Add_keeps_the_index_sized_by_Create)
+{
+    IDENTITY_MAP_TABLE_HANDLE table;
+    size_t used;
+    ASSERT_ARE_EQUAL(int, 0, gballoc_init());
+    table = IdentityMapTable_Create(DEVICE_COUNT);
+    ASSERT_IS_NOT_NULL(table);
+    used = gballoc_getCurrentMemoryUsed();
+
+    /*only the strings of the triplet are allocated, the index is neither shrunk nor grown*/
+    ASSERT_ARE_EQUAL(int, 0, add_device(table, 0));
+    ASSERT_ARE_EQUAL(size_t, used + sizeof("device0") + sizeof("key"), gballoc_getCurrentMemoryUsed());
+    ASSERT_ARE_EQUAL(int, 0, add_device(table, 1));
+    ASSERT_ARE_EQUAL(size_t, used + 2 * (sizeof("device0") + sizeof("key")), gballoc_getCurrentMemoryUsed());
+
+    IdentityMapTable_Destroy(table);
+    gballoc_deinit();
+}
+
+/*Tests_SRS_IDMAP_38_005: [ IdentityMapTable_Add shall replace the triplet of the same macAddress. ]*/
+/*Tests_SRS_IDMAP_38_006: [ IdentityMapTable_Add shall remove the triplet of the same deviceId with another macAddress. ]*/
+TEST_FUNCTION(IdentityMapTable_Add_replaces_triplets)
+{
+    IDENTITY_MAP_TABLE_HANDLE table = IdentityMapTable_Create(4);
+    const IDENTITY_MAP_CONFIG* found;
+    ASSERT_IS_NOT_NULL(table);
+
+    ASSERT_ARE_EQUAL(int, 0, add_triplet(table, "01:01:01:01:01:01", "first", "key1"));
+    ASSERT_ARE_EQUAL(int, 0, add_triplet(table, "02:02:02:02:02:02", "second", "key2"));
+
+    /*a new device on the first MAC address*/
+    ASSERT_ARE_EQUAL(int, 0, add_triplet(table, "01:01:01:01:01:01", "third", "key3"));
+    ASSERT_ARE_EQUAL(size_t, 2, IdentityMapTable_GetCount(table));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, "first"));
+    found = IdentityMapTable_FindByMac(table, "01:01:01:01:01:01");
+    ASSERT_IS_NOT_NULL(found);
+    ASSERT_ARE_EQUAL(char_ptr, "third", found->deviceId);
+    ASSERT_ARE_EQUAL(char_ptr, "key3", found->deviceKey);
+
+    /*the second device moves to a new MAC address*/
+    ASSERT_ARE_EQUAL(int, 0, add_triplet(table, "03:03:03:03:03:03", "second", "key4"));
+    ASSERT_ARE_EQUAL(size_t, 2, IdentityMapTable_GetCount(table));
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(table, "02:02:02:02:02:02"));
+    found = IdentityMapTable_FindByDeviceId(table, "second");
+    ASSERT_IS_NOT_NULL(found);
+    ASSERT_ARE_EQUAL(char_ptr, "03:03:03:03:03:03", found->macAddress);
+    ASSERT_ARE_EQUAL(char_ptr, "key4", found->deviceKey);
+
+    /*the third device moves onto the second MAC address, which replaces both*/
+    ASSERT_ARE_EQUAL(int, 0, add_triplet(table, "03:03:03:03:03:03", "third", "key5"));
+    ASSERT_ARE_EQUAL(size_t, 1, IdentityMapTable_GetCount(table));
+    ASSERT_IS_NULL(IdentityMapTable_FindByMac(table, "01:01:01:01:01:01"));
+    ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, "second"));
+    found = IdentityMapTable_FindByDeviceId(table, "third");
+    ASSERT_IS_NOT_NULL(found);
+    ASSERT_ARE_EQUAL(char_ptr, "03:03:03:03:03:03", found->macAddress);
+    ASSERT_ARE_EQUAL(char_ptr, "key5", found->deviceKey);
+
+    IdentityMapTable_Destroy(table);
+}
+
+/*Tests_SRS_IDMAP_38_009: [ Otherwise IdentityMapTable_Remove shall remove the triplet of macAddress, whatever its case, and return 0. ]*/
+TEST_FUNCTION(IdentityMapTable_Remove_keeps_the_other_triplets)
+{
+    IDENTITY_MAP_TABLE_HANDLE table = IdentityMapTable_Create(DEVICE_COUNT);
+    size_t i;
+    ASSERT_IS_NOT_NULL(table);
+
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, add_device(table, i));
+    }
+    ASSERT_ARE_EQUAL(int, 0, IdentityMapTable_Remove(table, "00:00:00:00:00:0a"));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IdentityMapTable_Remove(table, "00:00:00:00:00:0A"));
+
+    /*every third triplet goes*/
+    for (i = 0; i < DEVICE_COUNT; i += 3)
+    {
+        if (i != 10)
+        {
+            ASSERT_ARE_EQUAL(int, 0, IdentityMapTable_Remove(table, mac_address(i)));
+        }
+    }
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        const IDENTITY_MAP_CONFIG* found = IdentityMapTable_FindByMac(table, mac_address(i));
+        if (i % 3 == 0 || i == 10)
+        {
+            ASSERT_IS_NULL(found);
+            ASSERT_IS_NULL(IdentityMapTable_FindByDeviceId(table, device_id(i)));
+        }
+        else
+        {
+            ASSERT_IS_NOT_NULL(found);
+            ASSERT_ARE_EQUAL(char_ptr, device_id(i), found->deviceId);
+            ASSERT_IS_TRUE(IdentityMapTable_FindByDeviceId(table, device_id(i)) == found);
+        }
+    }
+    ASSERT_ARE_EQUAL(size_t, DEVICE_COUNT - (DEVICE_COUNT + 2) / 3 - 1, IdentityMapTable_GetCount(table));
+
+    /*removed triplets can come back*/
+    for (i = 0; i < DEVICE_COUNT; i += 3)
+    {
+        ASSERT_ARE_EQUAL(int, 0, add_device(table, i));
+    }
+    ASSERT_ARE_EQUAL(int, 0, add_device(table, 10));
+    ASSERT_ARE_EQUAL(size_t, DEVICE_COUNT, IdentityMapTable_GetCount(table));
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        ASSERT_IS_TRUE(IdentityMapTable_FindByDeviceId(table, device_id(i)) == IdentityMapTable_FindByMac(table, mac_address(i)));
+        ASSERT_IS_NOT_NULL(IdentityMapTable_FindByDeviceId(table, device_id(i)));
+    }
+
+    IdentityMapTable_Destroy(table);
+}
+
+END_TEST_SUITE(identitymap_table_ut)
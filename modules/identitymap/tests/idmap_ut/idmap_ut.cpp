@@ -3,6 +3,9 @@
 
 #include <cstdlib>
 #include <cstddef>
+#include <cctype>
+#include <string>
+#include <vector>
 #include "testrunnerswitcher.h"
 #include "micromock.h"
 #include "micromockcharstararenullterminatedstrings.h"
@@ -50,6 +53,8 @@ namespace BASEIMPLEMENTATION
 };
 
 #include "identitymap.h"
+#include "identitymap_table.h"
+#include "identitymap_file.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
 
 static size_t currentmalloc_call;
@@ -83,6 +88,12 @@ static size_t currentMessage_call;
 static size_t whenShallMessage_fail;
 static CONSTBUFFER messageContent;
 
+static size_t currentTable_Create_call;
+static size_t whenShallTable_Create_fail;
+
+static size_t currentTable_Add_call;
+static size_t whenShallTable_Add_fail;
+
 class RefCountObject
 {
 private:
@@ -110,11 +121,39 @@ public:
 typedef struct IDENTITY_MAP_DATA_TAG
 {
     BROKER_HANDLE broker;
-    size_t mappingSize;
-    IDENTITY_MAP_CONFIG * macToDevIdArray;
-    IDENTITY_MAP_CONFIG * devIdToMacArray;
+    IDENTITY_MAP_TABLE_HANDLE table;
+    char * updateSource;
 } IDENTITY_MAP_DATA;
 
+/*stands in for the mapping table, which has its own tests*/
+typedef struct TEST_TABLE_ENTRY_TAG
+{
+    std::string macAddress;
+    std::string deviceId;
+    std::string deviceKey;
+    IDENTITY_MAP_CONFIG config;
+} TEST_TABLE_ENTRY;
+
+typedef std::vector<TEST_TABLE_ENTRY> TEST_TABLE;
+
+static std::string test_table_upper(const char* macAddress)
+{
+    std::string result(macAddress);
+    for (size_t i = 0; i < result.size(); i++)
+    {
+        result[i] = (char)toupper(result[i]);
+    }
+    return result;
+}
+
+static const IDENTITY_MAP_CONFIG* test_table_config(TEST_TABLE_ENTRY& entry)
+{
+    entry.config.macAddress = entry.macAddress.c_str();
+    entry.config.deviceId = entry.deviceId.c_str();
+    entry.config.deviceKey = entry.deviceKey.c_str();
+    return &entry.config;
+}
+
 #define VALID_MAP_HANDLE    0xDEAF
 #define VALID_VALUE         "value"
 static MAP_RESULT currentMapResult;
@@ -122,6 +161,7 @@ static MAP_RESULT currentMapResult;
 static BROKER_RESULT currentBrokerResult;
 
 //CONSTMAP GetValue mocks
+static const char* updateProperties;
 static const char* macAddressProperties;
 static const char* sourceProperties;
 static const char* deviceNameProperties;
@@ -130,6 +170,16 @@ static const char* deviceKeyProperties;
 static VECTOR_HANDLE testVector1;
 static VECTOR_HANDLE testVector2;
 
+static IDENTITY_MAP_MODULE_CONFIG testModuleConfig;
+
+/*the module configuration of mapping, accepting the updates of updateSource*/
+static const IDENTITY_MAP_MODULE_CONFIG * moduleConfig(VECTOR_HANDLE mapping, const char * updateSource = NULL)
+{
+    testModuleConfig.mapping = mapping;
+    testModuleConfig.updateSource = updateSource;
+    return &testModuleConfig;
+}
+
 TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
     {
     public:
@@ -235,6 +285,10 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
         {
             result5 = deviceKeyProperties;
         }
+        else if (strcmp(GW_IDMAP_UPDATE_PROPERTY, key) == 0)
+        {
+            result5 = updateProperties;
+        }
     MOCK_METHOD_END(const char *, result5)
 
     // CONSTBUFFER mocks.
@@ -380,6 +434,17 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
         }
     MOCK_METHOD_END(JSON_Array*, object);
 
+    MOCK_STATIC_METHOD_1(, JSON_Object*, json_value_get_object, const JSON_Value*, value)
+        JSON_Object* object = NULL;
+        if (value != NULL)
+        {
+            object = (JSON_Object*)0x44;
+        }
+    MOCK_METHOD_END(JSON_Object*, object);
+
+    MOCK_STATIC_METHOD_2(, JSON_Array*, json_object_get_array, const JSON_Object*, object, const char*, name)
+    MOCK_METHOD_END(JSON_Array*, (JSON_Array*)NULL);
+
     MOCK_STATIC_METHOD_1(, size_t, json_array_get_count, const JSON_Array *, array)
     MOCK_METHOD_END(size_t, (size_t)0);
 
@@ -487,6 +552,94 @@ TYPED_MOCK_CLASS(CIdentitymapMocks, CGlobalMock)
 
     MOCK_STATIC_METHOD_3(, int, size_tToString, char*, destination, size_t, destinationSize, size_t, value)
     MOCK_METHOD_END(int, 0)
+
+    // identitymap_table.h
+    MOCK_STATIC_METHOD_1(, IDENTITY_MAP_TABLE_HANDLE, IdentityMapTable_Create, size_t, expectedCount)
+        IDENTITY_MAP_TABLE_HANDLE result1;
+        currentTable_Create_call++;
+        if (currentTable_Create_call == whenShallTable_Create_fail)
+        {
+            result1 = NULL;
+        }
+        else
+        {
+            result1 = (IDENTITY_MAP_TABLE_HANDLE)(new TEST_TABLE());
+        }
+    MOCK_METHOD_END(IDENTITY_MAP_TABLE_HANDLE, result1)
+
+    MOCK_STATIC_METHOD_2(, int, IdentityMapTable_Add, IDENTITY_MAP_TABLE_HANDLE, handle, const IDENTITY_MAP_CONFIG*, entry)
+        int result1;
+        currentTable_Add_call++;
+        if (currentTable_Add_call == whenShallTable_Add_fail)
+        {
+            result1 = 1;
+        }
+        else
+        {
+            TEST_TABLE* table = (TEST_TABLE*)handle;
+            TEST_TABLE_ENTRY added;
+            added.macAddress = test_table_upper(entry->macAddress);
+            added.deviceId = entry->deviceId;
+            added.deviceKey = entry->deviceKey;
+            for (size_t i = table->size(); i > 0; i--)
+            {
+                if ((*table)[i - 1].macAddress == added.macAddress || (*table)[i - 1].deviceId == added.deviceId)
+                {
+                    table->erase(table->begin() + (i - 1));
+                }
+            }
+            table->push_back(added);
+            result1 = 0;
+        }
+    MOCK_METHOD_END(int, result1)
+
+    MOCK_STATIC_METHOD_2(, int, IdentityMapTable_Remove, IDENTITY_MAP_TABLE_HANDLE, handle, const char*, macAddress)
+        TEST_TABLE* table = (TEST_TABLE*)handle;
+        int result1 = 1;
+        for (size_t i = 0; i < table->size(); i++)
+        {
+            if ((*table)[i].macAddress == test_table_upper(macAddress))
+            {
+                table->erase(table->begin() + i);
+                result1 = 0;
+                break;
+            }
+        }
+    MOCK_METHOD_END(int, result1)
+
+    MOCK_STATIC_METHOD_2(, const IDENTITY_MAP_CONFIG*, IdentityMapTable_FindByMac, IDENTITY_MAP_TABLE_HANDLE, handle, const char*, macAddress)
+        TEST_TABLE* table = (TEST_TABLE*)handle;
+        const IDENTITY_MAP_CONFIG* result1 = NULL;
+        for (size_t i = 0; i < table->size(); i++)
+        {
+            if ((*table)[i].macAddress == test_table_upper(macAddress))
+            {
+                result1 = test_table_config((*table)[i]);
+                break;
+            }
+        }
+    MOCK_METHOD_END(const IDENTITY_MAP_CONFIG*, result1)
+
+    MOCK_STATIC_METHOD_2(, const IDENTITY_MAP_CONFIG*, IdentityMapTable_FindByDeviceId, IDENTITY_MAP_TABLE_HANDLE, handle, const char*, deviceId)
+        TEST_TABLE* table = (TEST_TABLE*)handle;
+        const IDENTITY_MAP_CONFIG* result1 = NULL;
+        for (size_t i = 0; i < table->size(); i++)
+        {
+            if ((*table)[i].deviceId == deviceId)
+            {
+                result1 = test_table_config((*table)[i]);
+                break;
+            }
+        }
+    MOCK_METHOD_END(const IDENTITY_MAP_CONFIG*, result1)
+
+    MOCK_STATIC_METHOD_1(, void, IdentityMapTable_Destroy, IDENTITY_MAP_TABLE_HANDLE, handle)
+        delete (TEST_TABLE*)handle;
+    MOCK_VOID_METHOD_END()
+
+    // identitymap_file.h
+    MOCK_STATIC_METHOD_2(, int, IdentityMapFile_Read, const char*, fileName, VECTOR_HANDLE, mapping)
+    MOCK_METHOD_END(int, 0)
     };
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void*, gballoc_malloc, size_t, size);
@@ -525,6 +678,8 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , JSON_Value*, json_parse_string
 DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , JSON_Object *, json_array_get_object, const JSON_Array *, array, size_t, index);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , JSON_Array*, json_value_get_array, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , const char*, json_object_get_string, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , JSON_Array*, json_object_get_array, const JSON_Object*, object, const char*, name);
+DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , JSON_Object*, json_value_get_object, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , size_t, json_array_get_count, const JSON_Array *, array);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void, json_value_free, JSON_Value*, value);
 
@@ -544,6 +699,16 @@ DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , int, mallocAndStrcpy_s, char**
 DECLARE_GLOBAL_MOCK_METHOD_3(CIdentitymapMocks, , int, unsignedIntToString, char*, destination, size_t, destinationSize, unsigned int, value);
 DECLARE_GLOBAL_MOCK_METHOD_3(CIdentitymapMocks, , int, size_tToString, char*, destination, size_t, destinationSize, size_t, value);
 
+// identitymap_table.h
+DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , IDENTITY_MAP_TABLE_HANDLE, IdentityMapTable_Create, size_t, expectedCount);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , int, IdentityMapTable_Add, IDENTITY_MAP_TABLE_HANDLE, handle, const IDENTITY_MAP_CONFIG*, entry);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , int, IdentityMapTable_Remove, IDENTITY_MAP_TABLE_HANDLE, handle, const char*, macAddress);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , const IDENTITY_MAP_CONFIG*, IdentityMapTable_FindByMac, IDENTITY_MAP_TABLE_HANDLE, handle, const char*, macAddress);
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , const IDENTITY_MAP_CONFIG*, IdentityMapTable_FindByDeviceId, IDENTITY_MAP_TABLE_HANDLE, handle, const char*, deviceId);
+DECLARE_GLOBAL_MOCK_METHOD_1(CIdentitymapMocks, , void, IdentityMapTable_Destroy, IDENTITY_MAP_TABLE_HANDLE, handle);
+
+DECLARE_GLOBAL_MOCK_METHOD_2(CIdentitymapMocks, , int, IdentityMapFile_Read, const char*, fileName, VECTOR_HANDLE, mapping);
+
 
 BEGIN_TEST_SUITE(idmap_ut)
 
@@ -584,6 +749,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         whenShallStrdup_fail = 0;
         currentVectorElement_call = 0;
         whenShallVectorElement_fail = 0;
+        updateProperties = NULL;
         macAddressProperties = NULL;
         sourceProperties = NULL;
         deviceNameProperties = NULL;
@@ -595,6 +761,12 @@ BEGIN_TEST_SUITE(idmap_ut)
         currentMap_call = 0;
         whenShallMap_fail = 0;
         currentBrokerResult = BROKER_OK;
+        currentTable_Create_call = 0;
+        whenShallTable_Create_fail = 0;
+        currentTable_Add_call = 0;
+        whenShallTable_Add_fail = 0;
+        messageContent.buffer = NULL;
+        messageContent.size = 0;
 
         testVector1 = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
         IDENTITY_MAP_CONFIG c1 =
@@ -679,6 +851,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
@@ -729,6 +902,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 		const char* config = "pretend this is a valid JSON string";
 
 		STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+		STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
 		STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
 			.IgnoreArgument(1);
 		STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -755,9 +929,9 @@ BEGIN_TEST_SUITE(idmap_ut)
 		STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
-		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+		STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)) /*the triplets and the module configuration*/
 			.IgnoreArgument(1)
-			.ExpectedTimesExactly(6);
+			.ExpectedTimesExactly(7);
 		STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
@@ -795,6 +969,9 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -841,6 +1018,9 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -883,6 +1063,9 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -923,6 +1106,9 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -961,6 +1147,9 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -998,6 +1187,9 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
@@ -1025,11 +1217,17 @@ BEGIN_TEST_SUITE(idmap_ut)
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
             .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Object*)NULL);
 
         //Act
         auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
@@ -1042,15 +1240,28 @@ BEGIN_TEST_SUITE(idmap_ut)
     }
 
     //Tests_SRS_IDMAP_05_005: [ If configuration is not a JSON array of JSON objects, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]
-    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_parse_fails_returns_null)
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_object_without_mapping_file_returns_null)
     {
         ///Arrange
         CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
         const char* config = "pretend this is a valid JSON string";
 
-        STRICT_EXPECTED_CALL(mocks, json_parse_string(config))
-            .SetFailReturn((JSON_Value*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "mapping"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "mappingFile"))
+            .IgnoreArgument(1);
 
         //Act
         auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
@@ -1062,121 +1273,355 @@ BEGIN_TEST_SUITE(idmap_ut)
         ///Cleanup
     }
 
-    /*Tests_SRS_IDMAP_05_016: [ IdentityMap_FreeConfiguration shall release all data IdentityMap_ParseConfigurationFromJson allocated. ]*/
-    TEST_FUNCTION(IdentityMap_FreeConfiguration_frees_stuff)
+    //Tests_SRS_IDMAP_39_009: [ If configuration is a JSON object with a "mappingFile" value, then IdentityMap_ParseConfigurationFromJson shall read the mapping from the file it names. ]
+    //Tests_SRS_IDMAP_39_010: [ IdentityMap_ParseConfigurationFromJson shall read the triplets of the mapping file by calling IdentityMapFile_Read. ]
+    //Tests_SRS_IDMAP_17_062: [ IdentityMap_ParseConfigurationFromJson shall return the pointer to the configuration vector on success. ]
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_mapping_file_Success)
     {
         ///Arrange
         CIdentitymapMocks mocks;
-        const MODULE_API* theAPIS = Module_GetApi(MODULE_API_VERSION_1);
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
         const char* config = "pretend this is a valid JSON string";
 
         STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
         STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
-        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .SetReturn(1UL);
-        STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+            .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "macAddress"))
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "mapping"))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "deviceId"))
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "mappingFile"))
+            .IgnoreArgument(1)
+            .SetReturn("mapping.csv");
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, IdentityMapFile_Read("mapping.csv", IGNORED_PTR_ARG))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "updateSource"))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "deviceKey"))
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "00:00:00:00:00:00"))
+
+        //Act
+        auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
+
+        ///Assert
+        ASSERT_IS_NOT_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+        MODULE_FREE_CONFIGURATION(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_05_019: [ If creating the vector fails, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_mapping_file_vector_create_returns_null)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+        const char* config = "pretend this is a valid JSON string";
+
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "id"))
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "key"))
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "mapping"))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "mappingFile"))
             .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
+            .SetReturn("mapping.csv");
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)))
+            .SetFailReturn((VECTOR_HANDLE)NULL);
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
+        //Act
         auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
 
-        mocks.ResetAllCalls();
+        ///Assert
+        ASSERT_IS_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        ///Cleanup
+    }
+
+    //Tests_SRS_IDMAP_39_011: [ If IdentityMapFile_Read fails, then IdentityMap_ParseConfigurationFromJson shall release all resources and return NULL. ]
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_mapping_file_read_fails_returns_null)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+        const char* config = "pretend this is a valid JSON string";
+
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
             .IgnoreArgument(1)
-            .ExpectedTimesExactly(3);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "mapping"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "mappingFile"))
+            .IgnoreArgument(1)
+            .SetReturn("mapping.csv");
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, IdentityMapFile_Read("mapping.csv", IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .SetFailReturn(__LINE__);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
 
         //Act
-
-        ///Act
-        MODULE_FREE_CONFIGURATION(theAPIS)(n);
+        auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
 
         ///Assert
+        ASSERT_IS_NULL(n);
         mocks.AssertActualAndExpectedCalls();
 
         ///Cleanup
     }
 
-
-    /*Tests_SRS_IDMAP_17_059: [ IdentityMap_FreeConfiguration shall do nothing if configuration is NULL. ]*/
-    TEST_FUNCTION(IdentityMap_FreeConfiguration_does_nothing_with_null_config)
+    //Tests_SRS_IDMAP_38_033: [ If configuration is a JSON object with a "mapping" array, then IdentityMap_ParseConfigurationFromJson shall parse the array as the mapping. ]
+    //Tests_SRS_IDMAP_38_034: [ IdentityMap_ParseConfigurationFromJson shall copy the optional "updateSource" value of a JSON object configuration. ]
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_mapping_with_update_source_Success)
     {
         ///Arrange
         CIdentitymapMocks mocks;
-        const MODULE_API* theAPIS = Module_GetApi(MODULE_API_VERSION_1);
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+        const char* config = "pretend this is a valid JSON string";
 
-        ///Act
-        MODULE_FREE_CONFIGURATION(theAPIS)(NULL);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "mapping"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Array*)0x43);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "updateSource"))
+            .IgnoreArgument(1)
+            .SetReturn("provisioning");
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "provisioning"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        //Act
+        auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
 
         ///Assert
+        ASSERT_IS_NOT_NULL(n);
         mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(((IDENTITY_MAP_MODULE_CONFIG*)n)->mapping);
+        ASSERT_ARE_EQUAL(char_ptr, "provisioning", ((IDENTITY_MAP_MODULE_CONFIG*)n)->updateSource);
 
         ///Cleanup
+        MODULE_FREE_CONFIGURATION(theAPIS)(n);
     }
 
-    /*Tests_SRS_IDMAP_17_004: [If the broker is NULL, this function shall fail and return NULL.]*/
-    TEST_FUNCTION(IdentityMap_Create_Broker_Null)
+    //Tests_SRS_IDMAP_17_061: [ If allocation fails, IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_update_source_copy_fails_returns_null)
     {
         ///Arrange
+        CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
-        BROKER_HANDLE broker = NULL;
-        unsigned char config;
+        const char* config = "pretend this is a valid JSON string";
 
-        ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, &config);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetFailReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_array(IGNORED_PTR_ARG, "mapping"))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Array*)0x43);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "updateSource"))
+            .IgnoreArgument(1)
+            .SetReturn("provisioning");
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "provisioning"))
+            .IgnoreArgument(1)
+            .SetFailReturn(__LINE__);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        //Act
+        auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
 
         ///Assert
         ASSERT_IS_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
 
-        ///Ablution
+        ///Cleanup
     }
 
-    /*Tests_SRS_IDMAP_17_005: [If the configuration is NULL, this function shall fail and return NULL.]*/
-    TEST_FUNCTION(IdentityMap_Create_Config_Null)
+    //Tests_SRS_IDMAP_05_005: [ If configuration is not a JSON array of JSON objects, then IdentityMap_ParseConfigurationFromJson shall fail and return NULL. ]
+    TEST_FUNCTION(IdentityMap_ParseConfigurationFromJson_parse_fails_returns_null)
     {
         ///Arrange
+        CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
-        unsigned char fake;
-        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
-        void * config = NULL;
+        const char* config = "pretend this is a valid JSON string";
 
-        ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, config);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config))
+            .SetFailReturn((JSON_Value*)NULL);
+
+        //Act
+        auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
 
         ///Assert
         ASSERT_IS_NULL(n);
+        mocks.AssertActualAndExpectedCalls();
 
-        ///Ablution
+        ///Cleanup
     }
 
-    /*Tests_SRS_IDMAP_17_003: [Upon success, this function shall return a valid pointer to a MODULE_HANDLE.]*/
-    TEST_FUNCTION(IdentityMap_Create_Success_SingleEntry)
+    /*Tests_SRS_IDMAP_05_016: [ IdentityMap_FreeConfiguration shall release all data IdentityMap_ParseConfigurationFromJson allocated. ]*/
+    TEST_FUNCTION(IdentityMap_FreeConfiguration_frees_stuff)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS = Module_GetApi(MODULE_API_VERSION_1);
+        const char* config = "pretend this is a valid JSON string";
+
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(config));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IDENTITY_MAP_MODULE_CONFIG))); /*this is for the module configuration*/
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(1UL);
+        STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "macAddress"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "deviceId"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "00:00:00:00:00:00"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "id"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "key"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        auto n = MODULE_PARSE_CONFIGURATION_FROM_JSON(theAPIS)(config);
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)) /*the triplet and the module configuration*/
+            .IgnoreArgument(1)
+            .ExpectedTimesExactly(4);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        //Act
+
+        ///Act
+        MODULE_FREE_CONFIGURATION(theAPIS)(n);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+    }
+
+
+    /*Tests_SRS_IDMAP_17_059: [ IdentityMap_FreeConfiguration shall do nothing if configuration is NULL. ]*/
+    TEST_FUNCTION(IdentityMap_FreeConfiguration_does_nothing_with_null_config)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS = Module_GetApi(MODULE_API_VERSION_1);
+
+        ///Act
+        MODULE_FREE_CONFIGURATION(theAPIS)(NULL);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Cleanup
+    }
+
+    /*Tests_SRS_IDMAP_17_004: [If the broker is NULL, this function shall fail and return NULL.]*/
+    TEST_FUNCTION(IdentityMap_Create_Broker_Null)
+    {
+        ///Arrange
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+        BROKER_HANDLE broker = NULL;
+        unsigned char config;
+
+        ///Act
+        auto n = MODULE_CREATE(theAPIS)(broker, &config);
+
+        ///Assert
+        ASSERT_IS_NULL(n);
+
+        ///Ablution
+    }
+
+    /*Tests_SRS_IDMAP_17_005: [If the configuration is NULL, this function shall fail and return NULL.]*/
+    TEST_FUNCTION(IdentityMap_Create_Config_Null)
+    {
+        ///Arrange
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        void * config = NULL;
+
+        ///Act
+        auto n = MODULE_CREATE(theAPIS)(broker, config);
+
+        ///Assert
+        ASSERT_IS_NULL(n);
+
+        ///Ablution
+    }
+
+    /*Tests_SRS_IDMAP_17_003: [Upon success, this function shall return a valid pointer to a MODULE_HANDLE.]*/
+    /*Tests_SRS_IDMAP_38_016: [ IdentityMap_Create shall create the mapping table by calling IdentityMapTable_Create with the number of triplets in configuration. ]*/
+    /*Tests_SRS_IDMAP_38_018: [ IdentityMap_Create shall add each triplet of configuration to the mapping table by calling IdentityMapTable_Add. ]*/
+    TEST_FUNCTION(IdentityMap_Create_Success_SingleEntry)
     {
         ///Arrange
         CIdentitymapMocks mocks;
@@ -1193,30 +1638,15 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the d2c internal array*/
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the c2d internal array*/
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Create(1));
 
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1));
 
         ///Assert
         ASSERT_IS_NOT_NULL(n);
@@ -1242,7 +1672,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         ///Assert
         ASSERT_IS_NULL(n);
@@ -1294,11 +1724,11 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
 
         ///Act
-        auto n1 = MODULE_CREATE(theAPIS)(broker, v1);
+        auto n1 = MODULE_CREATE(theAPIS)(broker, moduleConfig(v1));
         ASSERT_IS_NULL(n1);
-        auto n2 = MODULE_CREATE(theAPIS)(broker, v2);
+        auto n2 = MODULE_CREATE(theAPIS)(broker, moduleConfig(v2));
         ASSERT_IS_NULL(n2);
-        auto n3 = MODULE_CREATE(theAPIS)(broker, v3);
+        auto n3 = MODULE_CREATE(theAPIS)(broker, moduleConfig(v3));
         ASSERT_IS_NULL(n3);
 
         ///Assert
@@ -1335,7 +1765,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
 
         ///Act
-        auto n1 = MODULE_CREATE(theAPIS)(broker, v1);
+        auto n1 = MODULE_CREATE(theAPIS)(broker, moduleConfig(v1));
         ASSERT_IS_NULL(n1);
 
 
@@ -1373,7 +1803,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
 
         ///Act
-        auto n2 = MODULE_CREATE(theAPIS)(broker, v2);
+        auto n2 = MODULE_CREATE(theAPIS)(broker, moduleConfig(v2));
         ASSERT_IS_NULL(n2);
 
 
@@ -1411,7 +1841,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         ///Act
 
-        auto n3 = MODULE_CREATE(theAPIS)(broker, v3);
+        auto n3 = MODULE_CREATE(theAPIS)(broker, moduleConfig(v3));
         ASSERT_IS_NULL(n3);
 
         ///Assert
@@ -1440,7 +1870,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1));
 
         ///Assert
         ASSERT_IS_NULL(n);
@@ -1449,8 +1879,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         ///Ablution
     }
 
-    /*Tests_SRS_IDMAP_17_011: [If IdentityMap_Create fails to create memory for the macToDeviceArray, then this function shall fail and return NULL.]*/
-    TEST_FUNCTION(IdentityMap_Create_internal_d2c_alloc_fail)
+    /*Tests_SRS_IDMAP_38_017: [ If IdentityMapTable_Create fails, then this function shall fail, release all resources, and return NULL. ]*/
+    TEST_FUNCTION(IdentityMap_Create_table_create_fails)
     {
         ///Arrange
         CIdentitymapMocks mocks;
@@ -1458,7 +1888,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         unsigned char fake;
         BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
 
-        whenShallmalloc_fail = 2;
+        whenShallTable_Create_fail = 1;
 
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
@@ -1467,15 +1897,11 @@ BEGIN_TEST_SUITE(idmap_ut)
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the internal array*/
-            .IgnoreArgument(1);
-
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Create(1));
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1));
 
         ///Assert
         ASSERT_IS_NULL(n);
@@ -1484,8 +1910,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         ///Ablution
     }
 
-    /*Tests_SRS_IDMAP_17_042: [ If IdentityMap_Create fails to create memory for the deviceToMacArray, then this function shall fail and return NULL. */
-    TEST_FUNCTION(IdentityMap_Create_internal_c2d_alloc_fail)
+    /*Tests_SRS_IDMAP_38_019: [ If IdentityMapTable_Add fails, then this function shall fail, release all resources, and return NULL. ]*/
+    TEST_FUNCTION(IdentityMap_Create_table_add_fails)
     {
         ///Arrange
         CIdentitymapMocks mocks;
@@ -1493,26 +1919,28 @@ BEGIN_TEST_SUITE(idmap_ut)
         unsigned char fake;
         BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
 
+        whenShallTable_Add_fail = 2;
+
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the internal array*/
-            .IgnoreArgument(1)
-            .SetFailReturn((void_ptr)NULL);
-
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Create(2));
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         ///Assert
         ASSERT_IS_NULL(n);
@@ -1520,8 +1948,9 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         ///Ablution
     }
-    /*Tests_SRS_IDMAP_17_012: [If IdentityMap_Create fails to add a MAC address triplet to the macToDeviceArray, then this function shall fail, release all resources, and return NULL.]*/
-    TEST_FUNCTION(IdentityMap_Create_DeepCopy_fail_mac1)
+
+    /*Tests_SRS_IDMAP_38_030: [ If the mapping of the configuration is NULL, this function shall fail and return NULL. ]*/
+    TEST_FUNCTION(IdentityMap_Create_mapping_NULL_fails)
     {
         ///Arrange
         CIdentitymapMocks mocks;
@@ -1529,56 +1958,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         unsigned char fake;
         BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
 
-        whenShallStrdup_fail =7;
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the D2C internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the C2D internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        /* 1st vector element */
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        /* 2nd vector element */
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(NULL));
 
         ///Assert
         ASSERT_IS_NULL(n);
@@ -1587,85 +1968,36 @@ BEGIN_TEST_SUITE(idmap_ut)
         ///Ablution
     }
 
-    //Tests_SRS_IDMAP_17_043: [ If IdentityMap_Create fails to add a MAC address triplet to the deviceToMacArray, then this function shall fail, release all resources, and return NULL. 
-    TEST_FUNCTION(IdentityMap_Create_DeepCopy_fail_mac2)
+    /*Tests_SRS_IDMAP_38_031: [ If the updateSource of the configuration is "iothub", "mapping", "bleTelemetry" or "bleCommand", this function shall fail and return NULL. ]*/
+    TEST_FUNCTION(IdentityMap_Create_reserved_update_source_fails)
     {
         ///Arrange
         CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
         unsigned char fake;
         BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        const char * reserved[] = { GW_IOTHUB_MODULE, GW_IDMAP_MODULE, GW_SOURCE_BLE_TELEMETRY, GW_SOURCE_BLE_COMMAND };
 
-        whenShallStrdup_fail = 10;
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the D2C internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the C2D internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        /* 1st vector element */
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        /* 2nd vector element */
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        for (size_t i = 0; i < sizeof(reserved) / sizeof(reserved[0]); i++)
+        {
+            mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
+            STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
 
-        ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+            ///Act
+            auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1, reserved[i]));
 
-        ///Assert
-        ASSERT_IS_NULL(n);
-        mocks.AssertActualAndExpectedCalls();
+            ///Assert
+            ASSERT_IS_NULL(n);
+            mocks.AssertActualAndExpectedCalls();
+        }
 
         ///Ablution
     }
 
-    /*Tests_SRS_IDMAP_17_012: [If IdentityMap_Create fails to add a MAC address triplet to the macToDeviceArray, then this function shall fail, release all resources, and return NULL.]*/
-    TEST_FUNCTION(IdentityMap_Create_DeepCopy_fail_id1)
+    /*Tests_SRS_IDMAP_17_003: [Upon success, this function shall return a valid pointer to a MODULE_HANDLE.]*/
+    TEST_FUNCTION(IdentityMap_Create_copies_update_source)
     {
         ///Arrange
         CIdentitymapMocks mocks;
@@ -1673,68 +2005,33 @@ BEGIN_TEST_SUITE(idmap_ut)
         unsigned char fake;
         BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
 
-
-        whenShallStrdup_fail = 8;
-
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the d2c internal array*/
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "provisioning"))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the c2d internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Create(1));
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        //1st vector element
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        /* 2nd vector element */
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1, "provisioning"));
 
         ///Assert
-        ASSERT_IS_NULL(n);
+        ASSERT_IS_NOT_NULL(n);
         mocks.AssertActualAndExpectedCalls();
 
         ///Ablution
+        MODULE_DESTROY(theAPIS)(n);
     }
 
-    TEST_FUNCTION(IdentityMap_Create_DeepCopy_fail_id2)
+    /*Tests_SRS_IDMAP_38_032: [ If the updateSource of the configuration cannot be copied, this function shall fail, release all resources, and return NULL. ]*/
+    TEST_FUNCTION(IdentityMap_Create_update_source_copy_fails)
     {
         ///Arrange
         CIdentitymapMocks mocks;
@@ -1742,69 +2039,18 @@ BEGIN_TEST_SUITE(idmap_ut)
         unsigned char fake;
         BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
 
-
-        whenShallStrdup_fail = 11;
-
         STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "provisioning"))
+            .IgnoreArgument(1)
+            .SetFailReturn(__LINE__);
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the d2c internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the c2d internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        //1st vector element
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        /* 2nd vector element */
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1, "provisioning"));
 
         ///Assert
         ASSERT_IS_NULL(n);
@@ -1813,216 +2059,66 @@ BEGIN_TEST_SUITE(idmap_ut)
         ///Ablution
     }
 
-
-    /*Tests_SRS_IDMAP_17_012: [If IdentityMap_Create fails to add a MAC address triplet to the macToDeviceArray, then this function shall fail, release all resources, and return NULL.]*/
-    TEST_FUNCTION(IdentityMap_Create_DeepCopy_fail_key1)
+    /*Tests_SRS_IDMAP_17_018: [If moduleHandle is NULL, IdentityMap_Destroy shall return.]*/
+    TEST_FUNCTION(IdentityMap_Destroy_NULL)
     {
         ///Arrange
         CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
-        unsigned char fake;
-        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
-
-        whenShallStrdup_fail = 9;
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the D2C internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the C2D internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        //1st vector element
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        // 2nd vector element
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-
-
 
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        MODULE_DESTROY(theAPIS)(NULL);
 
         ///Assert
-        ASSERT_IS_NULL(n);
         mocks.AssertActualAndExpectedCalls();
 
         ///Ablution
     }
 
-    TEST_FUNCTION(IdentityMap_Create_DeepCopy_fail_key2)
+    /*Tests_SRS_IDMAP_17_015: [IdentityMap_Destroy shall release all resources allocated for the module.]*/
+    TEST_FUNCTION(IdentityMap_Destroy_2Element)
     {
         ///Arrange
         CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
-        unsigned char fake;
-        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
-
-        whenShallStrdup_fail = 12;
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the module struct*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the D2C internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is for the C2D internal array*/
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1)).IgnoreArgument(1);
-
-        //1st vector element
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        BROKER_HANDLE broker = Broker_Create();
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
-        // 2nd vector element
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        mocks.ResetAllCalls();
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the mac address*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device name*/
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        //the mapping table and module data
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*this is for the device key*/
-            .IgnoreAllArguments();
-
-
-
         ///Act
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        MODULE_DESTROY(theAPIS)(n);
 
         ///Assert
-        ASSERT_IS_NULL(n);
         mocks.AssertActualAndExpectedCalls();
 
         ///Ablution
-    }
-
-    /*Tests_SRS_IDMAP_17_018: [If moduleHandle is NULL, IdentityMap_Destroy shall return.]*/
-    TEST_FUNCTION(IdentityMap_Destroy_NULL)
-    {
-        ///Arrange
-        CIdentitymapMocks mocks;
-        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
-
-        ///Act
-        MODULE_DESTROY(theAPIS)(NULL);
-
-        ///Assert
-        mocks.AssertActualAndExpectedCalls();
+        Broker_Destroy(broker);
 
-        ///Ablution
     }
 
     /*Tests_SRS_IDMAP_17_015: [IdentityMap_Destroy shall release all resources allocated for the module.]*/
-    TEST_FUNCTION(IdentityMap_Destroy_2Element)
+    TEST_FUNCTION(IdentityMap_Destroy_frees_update_source)
     {
         ///Arrange
         CIdentitymapMocks mocks;
         const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
         BROKER_HANDLE broker = Broker_Create();
 
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
 
         mocks.ResetAllCalls();
 
-        //1st vector element
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        //2nd vector element
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-
-        //internal struct and module data
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        //the mapping table, update source and module data
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .ExpectedTimesExactly(2);
 
         ///Act
         MODULE_DESTROY(theAPIS)(n);
@@ -2062,7 +2158,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2072,6 +2168,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
 
@@ -2097,7 +2195,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2109,12 +2207,12 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
 
 
         ///Act
@@ -2139,7 +2237,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2154,13 +2252,12 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
@@ -2189,7 +2286,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2204,13 +2301,12 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
@@ -2240,7 +2336,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2254,13 +2350,12 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
@@ -2290,7 +2385,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector1));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2304,13 +2399,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICEKEY_PROPERTY))
@@ -2339,7 +2435,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2352,13 +2448,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
 
@@ -2388,7 +2485,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2402,13 +2499,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2440,7 +2538,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2454,13 +2552,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2497,7 +2596,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2511,13 +2610,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2554,7 +2654,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2568,13 +2668,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2611,7 +2712,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2625,13 +2726,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2671,7 +2773,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2685,13 +2787,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2738,7 +2841,7 @@ BEGIN_TEST_SUITE(idmap_ut)
 
         unsigned char fake;
         BROKER_HANDLE broker = Broker_Create();
-        auto n = MODULE_CREATE(theAPIS)(broker, testVector2);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2753,13 +2856,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2829,7 +2933,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2843,13 +2947,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -2919,7 +3024,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -2933,13 +3038,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_MAC_ADDRESS_PROPERTY))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-            .IgnoreAllArguments();
-        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByMac(IGNORED_PTR_ARG, macAddressProperties))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
@@ -3015,7 +3121,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3029,10 +3135,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
             
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3100,7 +3210,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3114,10 +3224,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3186,7 +3300,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3200,10 +3314,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3263,7 +3381,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3277,10 +3395,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3338,7 +3460,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3352,10 +3474,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3415,7 +3541,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3429,10 +3555,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3489,7 +3619,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3503,10 +3633,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
@@ -3560,7 +3694,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3574,10 +3708,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m))
             .SetFailReturn((CONSTMAP_HANDLE)NULL);
@@ -3625,7 +3763,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3639,10 +3777,14 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
             .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_FindByDeviceId(IGNORED_PTR_ARG, deviceNameProperties))
+            .IgnoreArgument(1);
 
         ///Act
         MODULE_RECEIVE(theAPIS)(n, m);
@@ -3688,7 +3830,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3702,6 +3844,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_DEVICENAME_PROPERTY))
@@ -3750,7 +3894,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3764,6 +3908,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
 
@@ -3811,7 +3957,7 @@ BEGIN_TEST_SUITE(idmap_ut)
         VECTOR_push_back(v, &c7, 1);
         VECTOR_push_back(v, &c8, 1);
         VECTOR_push_back(v, &c9, 1);
-        auto n = MODULE_CREATE(theAPIS)(broker, v);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v));
 
         MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
         auto m = Message_Create(&cfg);
@@ -3827,6 +3973,8 @@ BEGIN_TEST_SUITE(idmap_ut)
         STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
         STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
             .IgnoreArgument(1);
 
@@ -3843,6 +3991,521 @@ BEGIN_TEST_SUITE(idmap_ut)
         MODULE_DESTROY(theAPIS)(n);
 
     }
+
+    //Tests_SRS_IDMAP_38_020: [ If messageHandle properties contain an "identityMapUpdate" property, then IdentityMap_Receive shall apply the update to the mapping and shall not republish the message. ]
+    //Tests_SRS_IDMAP_38_021: [ IdentityMap_Receive shall read the content of an update message as a JSON array of objects. ]
+    //Tests_SRS_IDMAP_38_023: [ If the update is "add", IdentityMap_Receive shall parse the message content as an inline JSON array of triplets, as the "mapping" array of the module configuration. ]
+    //Tests_SRS_IDMAP_38_025: [ IdentityMap_Receive shall add each triplet to the mapping table by calling IdentityMapTable_Add. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_add_adds_mappings)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char* update = "pretend this is a valid JSON string";
+        messageContent.buffer = (const unsigned char*)update;
+        messageContent.size = strlen(update);
+        updateProperties = GW_IDMAP_UPDATE_ADD;
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(m));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen(update) + 1));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(update));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_create(sizeof(IDENTITY_MAP_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(1UL);
+        STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "macAddress"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "deviceId"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "deviceKey"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "00:00:00:00:00:00"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "id"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, "key"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Add(((IDENTITY_MAP_DATA*)n)->table, IGNORED_PTR_ARG))
+            .IgnoreArgument(2);
+
+        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+        const IDENTITY_MAP_CONFIG* added = IdentityMapTable_FindByMac(((IDENTITY_MAP_DATA*)n)->table, "00:00:00:00:00:00");
+        ASSERT_IS_NOT_NULL(added);
+        ASSERT_ARE_EQUAL(char_ptr, "id", added->deviceId);
+        ASSERT_ARE_EQUAL(char_ptr, "key", added->deviceKey);
+        ASSERT_IS_NOT_NULL(IdentityMapTable_FindByDeviceId(((IDENTITY_MAP_DATA*)n)->table, "a2ndDevice"));
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_024: [ If the content does not parse or validate as an array of triplets, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_add_bad_content_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char* update = "pretend this is not JSON";
+        messageContent.buffer = (const unsigned char*)update;
+        messageContent.size = strlen(update);
+        updateProperties = GW_IDMAP_UPDATE_ADD;
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(m));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen(update) + 1));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(update))
+            .SetReturn((JSON_Value*)NULL);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_027: [ IdentityMap_Receive shall remove the triplet of the "macAddress" of each object of the array by calling IdentityMapTable_Remove. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_remove_removes_mappings)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        VECTOR_HANDLE v = VECTOR_create(sizeof(IDENTITY_MAP_CONFIG));
+
+        IDENTITY_MAP_CONFIG c1 = { "00:00:00:00:00:00", "Sensor0", "theKeyFor0" };
+        IDENTITY_MAP_CONFIG c2 = { "01:01:01:01:01:01", "Sensor1", "theKeyFor1" };
+        VECTOR_push_back(v, &c1, 1);
+        VECTOR_push_back(v, &c2, 1);
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(v, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char* update = "pretend this is a valid JSON string";
+        messageContent.buffer = (const unsigned char*)update;
+        messageContent.size = strlen(update);
+        updateProperties = GW_IDMAP_UPDATE_REMOVE;
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(m));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen(update) + 1));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(update));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_array_get_count(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn(1UL);
+        STRICT_EXPECTED_CALL(mocks, json_array_get_object(IGNORED_PTR_ARG, 0))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "macAddress"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IdentityMapTable_Remove(((IDENTITY_MAP_DATA*)n)->table, "00:00:00:00:00:00"));
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(IdentityMapTable_FindByMac(((IDENTITY_MAP_DATA*)n)->table, "00:00:00:00:00:00"));
+        ASSERT_IS_NOT_NULL(IdentityMapTable_FindByMac(((IDENTITY_MAP_DATA*)n)->table, "01:01:01:01:01:01"));
+
+        ///Ablution
+        Message_Destroy(m);
+        VECTOR_destroy(v);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_026: [ If the update is "remove" and the message content is not a JSON array, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_remove_not_array_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char* update = "pretend this is a JSON object";
+        messageContent.buffer = (const unsigned char*)update;
+        messageContent.size = strlen(update);
+        updateProperties = GW_IDMAP_UPDATE_REMOVE;
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(m));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen(update) + 1));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(update));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_022: [ If the update is neither "add" nor "remove", or the content cannot be read, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_unknown_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        updateProperties = "replace";
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(m));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(1));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_036: [ If the "source" property of the update message is missing, is "iothub", "mapping", "bleTelemetry" or "bleCommand", or is not the updateSource of the module configuration, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_from_iothub_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        /*a cloud to device message carrying an update*/
+        const char* update = "pretend this is a valid JSON string";
+        messageContent.buffer = (const unsigned char*)update;
+        messageContent.size = strlen(update);
+        updateProperties = GW_IDMAP_UPDATE_ADD;
+        sourceProperties = GW_IOTHUB_MODULE;
+        deviceNameProperties = "aNiceDevice";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NULL(IdentityMapTable_FindByMac(((IDENTITY_MAP_DATA*)n)->table, "00:00:00:00:00:00"));
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_036: [ If the "source" property of the update message is missing, is "iothub", "mapping", "bleTelemetry" or "bleCommand", or is not the updateSource of the module configuration, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_from_sensor_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char * sources[] = { GW_SOURCE_BLE_TELEMETRY, GW_SOURCE_BLE_COMMAND, GW_IDMAP_MODULE };
+        updateProperties = GW_IDMAP_UPDATE_REMOVE;
+
+        for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++)
+        {
+            sourceProperties = sources[i];
+
+            mocks.ResetAllCalls();
+
+            STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+            STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+                .IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+                .IgnoreArgument(1);
+
+            ///Act
+            MODULE_RECEIVE(theAPIS)(n, m);
+
+            ///Assert
+            mocks.AssertActualAndExpectedCalls();
+        }
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_036: [ If the "source" property of the update message is missing, is "iothub", "mapping", "bleTelemetry" or "bleCommand", or is not the updateSource of the module configuration, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_from_other_source_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char * sources[] = { "logger", NULL };
+        updateProperties = GW_IDMAP_UPDATE_REMOVE;
+
+        for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++)
+        {
+            sourceProperties = sources[i];
+
+            mocks.ResetAllCalls();
+
+            STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+            STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+                .IgnoreArgument(1);
+            STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+                .IgnoreArgument(1);
+
+            ///Act
+            MODULE_RECEIVE(theAPIS)(n, m);
+
+            ///Assert
+            mocks.AssertActualAndExpectedCalls();
+        }
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_035: [ If the module configuration has no updateSource, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_not_enabled_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        updateProperties = GW_IDMAP_UPDATE_REMOVE;
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_IS_NOT_NULL(IdentityMapTable_FindByDeviceId(((IDENTITY_MAP_DATA*)n)->table, "aNiceDevice"));
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
+
+    //Tests_SRS_IDMAP_38_037: [ If the update is "add" and the message content is not a JSON array, in particular an object naming a mapping file, then IdentityMap_Receive shall leave the mapping unchanged. ]
+    TEST_FUNCTION(IdentityMap_Receive_update_add_mapping_file_changes_nothing)
+    {
+        ///Arrange
+        CIdentitymapMocks mocks;
+        const MODULE_API* theAPIS= Module_GetApi(MODULE_API_VERSION_1);
+
+        unsigned char fake;
+        BROKER_HANDLE broker = (BROKER_HANDLE)&fake;
+        auto n = MODULE_CREATE(theAPIS)(broker, moduleConfig(testVector2, "provisioning"));
+
+        MESSAGE_CONFIG cfg = { 1, &fake, (MAP_HANDLE)&fake };
+        auto m = Message_Create(&cfg);
+
+        const char* update = "{ \"mappingFile\" : \"/etc/passwd\" }";
+        messageContent.buffer = (const unsigned char*)update;
+        messageContent.size = strlen(update);
+        updateProperties = GW_IDMAP_UPDATE_ADD;
+        sourceProperties = "provisioning";
+
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(m));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Create(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_IDMAP_UPDATE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(IGNORED_PTR_ARG, GW_SOURCE_PROPERTY))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Message_GetContent(m));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen(update) + 1));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(update));
+        STRICT_EXPECTED_CALL(mocks, json_value_get_array(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((JSON_Array*)NULL);
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///Act
+        MODULE_RECEIVE(theAPIS)(n, m);
+
+        ///Assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///Ablution
+        Message_Destroy(m);
+        MODULE_DESTROY(theAPIS)(n);
+    }
     //
 
 END_TEST_SUITE(idmap_ut)
@@ -5,6 +5,9 @@
 #define IOTHUB_H
 
 #include "module.h"
+#include "iothub_store.h"
+#include "iothub_batch.h"
+#include "iothub_device_map.h"
 #include <iothub_client_ll.h>
 
 #ifdef __cplusplus
@@ -17,6 +20,12 @@ typedef struct IOTHUB_CONFIG_TAG
     const char* IoTHubName;
     const char* IoTHubSuffix;
     IOTHUB_CLIENT_TRANSPORT_PROVIDER transportProvider;
+    /*when store.enabled is true messages are queued on disk and forwarded from there*/
+    IOTHUB_STORE_CONFIG store;
+    /*when batch.enabled is true the messages of a device are sent together as one event*/
+    IOTHUB_BATCH_CONFIG batch;
+    /*when devices.max_clients is not 0 the least recently used devices have their IoTHubClient closed*/
+    IOTHUB_DEVICE_MAP_CONFIG devices;
 }IOTHUB_CONFIG; /*this needs to be passed to the Module_Create function*/
 
 MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(IOTHUB_MODULE)(MODULE_API_VERSION gateway_api_version);
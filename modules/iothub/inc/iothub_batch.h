@@ -0,0 +1,93 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IOTHUB_BATCH_H
+#define IOTHUB_BATCH_H
+
+#include "message.h"
+#include "parson.h"
+#include "azure_c_shared_utility/tickcounter.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdbool>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+#define IOTHUB_BATCH_DEFAULT_MAX_MESSAGES 100
+/*IoT Hub refuses events larger than 256KB*/
+#define IOTHUB_BATCH_DEFAULT_MAX_BYTES (255 * 1024)
+#define IOTHUB_BATCH_DEFAULT_MAX_DELAY_MS 1000
+
+/*settings of per device batching, "enabled" is false when the args have no "batch"*/
+typedef struct IOTHUB_BATCH_CONFIG_TAG
+{
+    bool enabled;
+    /*a batch is sent once it holds this many messages*/
+    size_t max_messages;
+    /*a message that would take the encoded batch past this size goes into the next one*/
+    size_t max_bytes;
+    /*a batch is sent at the latest this long after its first message was added*/
+    size_t max_delay_ms;
+} IOTHUB_BATCH_CONFIG;
+
+/*a batch taken out of an IOTHUB_BATCH_HANDLE, ready to be sent as one event*/
+typedef struct IOTHUB_BATCH_EVENT_TAG
+{
+    /*
+     * a JSON array with an object per message,
+     * {"body":"<base64 content>","base64Encoded":true,"properties":{...}}
+     */
+    unsigned char* body;
+    size_t size;
+    size_t count;
+    /*the context passed to IoTHubBatch_Add for each message, oldest first*/
+    void** contexts;
+    /*NULL when taken, left to whoever sends the event*/
+    void* sender;
+} IOTHUB_BATCH_EVENT;
+
+typedef enum IOTHUB_BATCH_ADD_RESULT_TAG
+{
+    IOTHUB_BATCH_ADD_OK,
+    /*the message does not fit, take the batch and add it again*/
+    IOTHUB_BATCH_ADD_FULL,
+    IOTHUB_BATCH_ADD_ERROR
+} IOTHUB_BATCH_ADD_RESULT;
+
+typedef struct IOTHUB_BATCH_TAG* IOTHUB_BATCH_HANDLE;
+
+/*reads the "batch" object of the IoT Hub module's args*/
+extern int IoTHubBatch_ParseConfigurationFromJson(const JSON_Object* json, IOTHUB_BATCH_CONFIG* config);
+
+/*creates an empty batch for one device, it is not thread safe*/
+extern IOTHUB_BATCH_HANDLE IoTHubBatch_Create(const IOTHUB_BATCH_CONFIG* config);
+
+/*encodes message, without its "deviceName" and "deviceKey" properties, at the end of the batch*/
+extern IOTHUB_BATCH_ADD_RESULT IoTHubBatch_Add(IOTHUB_BATCH_HANDLE handle, MESSAGE_HANDLE message, void* context, tickcounter_ms_t now);
+
+extern size_t IoTHubBatch_GetCount(IOTHUB_BATCH_HANDLE handle);
+
+/*returns 0 and when the batch is due to be sent, non-zero if it is empty*/
+extern int IoTHubBatch_GetDueTime(IOTHUB_BATCH_HANDLE handle, tickcounter_ms_t* due);
+
+/*true when the batch holds max_messages messages, or is not empty and due at now*/
+extern bool IoTHubBatch_IsReady(IOTHUB_BATCH_HANDLE handle, tickcounter_ms_t now);
+
+/*returns the messages added so far and empties the batch, NULL if it is empty*/
+extern IOTHUB_BATCH_EVENT* IoTHubBatch_Take(IOTHUB_BATCH_HANDLE handle);
+
+extern void IoTHubBatch_DestroyEvent(IOTHUB_BATCH_EVENT* event);
+
+/*the contexts of messages still in the batch are dropped, take it first to keep them*/
+extern void IoTHubBatch_Destroy(IOTHUB_BATCH_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*IOTHUB_BATCH_H*/
@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IOTHUB_DEVICE_MAP_H
+#define IOTHUB_DEVICE_MAP_H
+
+#include "parson.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdbool>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+/*settings of the devices the IoT Hub module talks for, read from its "devices" args*/
+typedef struct IOTHUB_DEVICE_MAP_CONFIG_TAG
+{
+    /*the most devices with an open IoTHubClient, 0 when there is no limit*/
+    size_t max_clients;
+} IOTHUB_DEVICE_MAP_CONFIG;
+
+/*called for each device in the map, it must not add or remove devices*/
+typedef void(*IOTHUB_DEVICE_MAP_VISIT)(void* context, void* value);
+
+/*true when the device holding value may be taken out of the map*/
+typedef bool(*IOTHUB_DEVICE_MAP_ACCEPT)(void* context, void* value);
+
+/*values by deviceName, ordered from the most to the least recently found*/
+typedef struct IOTHUB_DEVICE_MAP_TAG* IOTHUB_DEVICE_MAP_HANDLE;
+
+extern int IoTHubDeviceMap_ParseConfigurationFromJson(const JSON_Object* json, IOTHUB_DEVICE_MAP_CONFIG* config);
+
+/*creates an empty map, it is not thread safe*/
+extern IOTHUB_DEVICE_MAP_HANDLE IoTHubDeviceMap_Create(void);
+
+/*returns the value of deviceName and makes it the most recently used, NULL if it is not in the map*/
+extern void* IoTHubDeviceMap_Find(IOTHUB_DEVICE_MAP_HANDLE handle, const char* deviceName);
+
+/*adds a device that is not in the map yet as the most recently used, deviceName is copied*/
+extern int IoTHubDeviceMap_Add(IOTHUB_DEVICE_MAP_HANDLE handle, const char* deviceName, void* value);
+
+extern size_t IoTHubDeviceMap_GetCount(IOTHUB_DEVICE_MAP_HANDLE handle);
+
+/*takes the device that was found the longest time ago out of the map and returns its value, NULL if the map is empty*/
+extern void* IoTHubDeviceMap_RemoveLeastRecentlyUsed(IOTHUB_DEVICE_MAP_HANDLE handle);
+
+/*takes the least recently used device that accept returns true for out of the map and returns its value, NULL if there is none*/
+extern void* IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IOTHUB_DEVICE_MAP_HANDLE handle, IOTHUB_DEVICE_MAP_ACCEPT accept, void* context);
+
+/*visits the devices from the most to the least recently used*/
+extern void IoTHubDeviceMap_ForEach(IOTHUB_DEVICE_MAP_HANDLE handle, IOTHUB_DEVICE_MAP_VISIT visit, void* context);
+
+/*the values are not touched, remove them first to destroy them*/
+extern void IoTHubDeviceMap_Destroy(IOTHUB_DEVICE_MAP_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*IOTHUB_DEVICE_MAP_H*/
@@ -0,0 +1,107 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef IOTHUB_STORE_H
+#define IOTHUB_STORE_H
+
+#include "parson.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include <cstdbool>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#endif
+
+#define IOTHUB_STORE_DEFAULT_MAX_BYTES (64 * 1024 * 1024)
+#define IOTHUB_STORE_DEFAULT_SEGMENT_BYTES (1024 * 1024)
+#define IOTHUB_STORE_DEFAULT_MAX_IN_FLIGHT 64
+#define IOTHUB_STORE_DEFAULT_SYNC_INTERVAL_MS 1000
+#define IOTHUB_STORE_DEFAULT_RETRY_INTERVAL_MS 5000
+
+/*settings of the store and forward queue, "enabled" is false when the args have no "store"*/
+typedef struct IOTHUB_STORE_CONFIG_TAG
+{
+    bool enabled;
+    /*segments are "<path>.<number>", the read position is kept in "<path>.checkpoint"*/
+    char* path;
+    /*messages are dropped while the queued records take this many bytes*/
+    size_t max_bytes;
+    /*a new segment is started before the current one grows past this size*/
+    size_t segment_bytes;
+    /*0 forwards as fast as the transport confirms*/
+    double messages_per_second;
+    /*most messages handed to the transport and not yet confirmed*/
+    size_t max_in_flight;
+    /*longest time an appended record or a confirmation stays unsynced*/
+    size_t sync_interval_ms;
+    /*wait after a failed send before sending again*/
+    size_t retry_interval_ms;
+    /*0 for no periodic queue depth report*/
+    size_t metrics_interval_s;
+} IOTHUB_STORE_CONFIG;
+
+typedef struct IOTHUB_STORE_METRICS_TAG
+{
+    /*stored and not confirmed yet, in flight ones included*/
+    size_t queued_messages;
+    uint64_t queued_bytes;
+    size_t in_flight;
+    uint64_t appended;
+    uint64_t delivered;
+    /*refused by IoTHubStore_Append because the store was full*/
+    uint64_t dropped;
+    /*sends that failed, their records are sent again*/
+    uint64_t failed;
+    /*records the send function could not make a message of*/
+    uint64_t discarded;
+} IOTHUB_STORE_METRICS;
+
+typedef enum IOTHUB_STORE_SEND_RESULT_TAG
+{
+    /*the record was handed to the transport, IoTHubStore_Complete follows*/
+    IOTHUB_STORE_SEND_ACCEPTED,
+    /*the record could not be sent now, it is sent again after retry_interval_ms*/
+    IOTHUB_STORE_SEND_RETRY,
+    /*the record can never be sent and is removed from the store*/
+    IOTHUB_STORE_SEND_DISCARD
+} IOTHUB_STORE_SEND_RESULT;
+
+typedef struct IOTHUB_STORE_TAG* IOTHUB_STORE_HANDLE;
+
+/*called on the forwarder thread for each stored record, oldest first, store is the handle to pass to IoTHubStore_Complete*/
+typedef IOTHUB_STORE_SEND_RESULT(*IOTHUB_STORE_SEND)(void* context, IOTHUB_STORE_HANDLE store, const unsigned char* record, size_t size, uint64_t sequence);
+
+/*reads the "store" object of the IoT Hub module's args*/
+extern int IoTHubStore_ParseConfigurationFromJson(const JSON_Object* json, IOTHUB_STORE_CONFIG* config);
+
+/*
+ * opens the store at config->path, picking up what an earlier run left
+ * unconfirmed, and starts the forwarder thread that passes records to send
+ */
+extern IOTHUB_STORE_HANDLE IoTHubStore_Create(const IOTHUB_STORE_CONFIG* config, IOTHUB_STORE_SEND send, void* send_context);
+
+/*stores a copy of record, must not be called concurrently for the same handle*/
+extern int IoTHubStore_Append(IOTHUB_STORE_HANDLE handle, const unsigned char* record, size_t size);
+
+/*reports the outcome of a send that returned IOTHUB_STORE_SEND_ACCEPTED, from any thread*/
+extern void IoTHubStore_Complete(IOTHUB_STORE_HANDLE handle, uint64_t sequence, bool delivered);
+
+extern int IoTHubStore_GetMetrics(IOTHUB_STORE_HANDLE handle, IOTHUB_STORE_METRICS* metrics);
+
+/*stops the forwarder thread, IoTHubStore_Complete can still be called until IoTHubStore_Destroy*/
+extern void IoTHubStore_Stop(IOTHUB_STORE_HANDLE handle);
+
+/*stops the forwarder thread if needed and saves the read position, unconfirmed records are sent by the next run*/
+extern void IoTHubStore_Destroy(IOTHUB_STORE_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*IOTHUB_STORE_H*/
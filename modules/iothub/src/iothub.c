@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <ctype.h>
 #include "azure_c_shared_utility/gballoc.h"
 
@@ -14,9 +15,13 @@
 #include "iothubtransportamqp.h"
 #include "iothubtransportmqtt.h"
 #include "iothub_message.h"
-#include "azure_c_shared_utility/vector.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "module_thread.h"
 #include "messageproperties.h"
 #include "broker.h"
 
@@ -29,20 +34,41 @@ typedef struct PERSONALITY_TAG
     IOTHUB_CLIENT_HANDLE iothubHandle;
     BROKER_HANDLE broker;
     MODULE_HANDLE module;
+    IOTHUB_BATCH_HANDLE batch; /*NULL unless the configuration has a "batch"*/
+    size_t inFlight; /*events IoT Hub has not confirmed yet, only counted when there is a max_clients*/
 }PERSONALITY;
 
 typedef PERSONALITY* PERSONALITY_PTR;
 
 typedef struct IOTHUB_HANDLE_DATA_TAG
 {
-    VECTOR_HANDLE personalities; /*holds PERSONALITYs*/
+    IOTHUB_DEVICE_MAP_HANDLE personalities; /*holds PERSONALITYs by deviceName*/
+    size_t maxClients; /*0 when every personality keeps its client*/
+    LOCK_HANDLE inFlightLock; /*guards the inFlight of the personalities, NULL when maxClients is 0*/
     STRING_HANDLE IoTHubName;
     STRING_HANDLE IoTHubSuffix;
     IOTHUB_CLIENT_TRANSPORT_PROVIDER transportProvider;
     TRANSPORT_HANDLE transportHandle;
     BROKER_HANDLE broker;
+    IOTHUB_STORE_HANDLE store; /*NULL unless the configuration has a "store"*/
+    unsigned char* storeBuffer; /*reused by IotHub_Receive to serialize messages for the store*/
+    int32_t storeBufferSize;
+    /*only used when batching, the lock then guards the personalities and their batches*/
+    IOTHUB_BATCH_CONFIG batchConfig;
+    LOCK_HANDLE lock;
+    COND_HANDLE flushWake;
+    THREAD_HANDLE flushThread;
+    TICK_COUNTER_HANDLE tickCounter;
+    bool stopping;
 }IOTHUB_HANDLE_DATA;
 
+typedef struct IOTHUB_STORED_EVENT_TAG
+{
+    IOTHUB_STORE_HANDLE store;
+    uint64_t sequence;
+    PERSONALITY* personality; /*NULL when the event is not counted or is in a batch*/
+}IOTHUB_STORED_EVENT;
+
 #define SOURCE "source"
 #define MAPPING "mapping"
 #define DEVICENAME "deviceName"
@@ -50,6 +76,12 @@ typedef struct IOTHUB_HANDLE_DATA_TAG
 #define SUFFIX "IoTHubSuffix"
 #define HUBNAME "IoTHubName"
 #define TRANSPORT "Transport"
+#define BATCHCOUNT "batchCount"
+
+static IOTHUB_STORE_SEND_RESULT IotHub_SendStored(void* context, IOTHUB_STORE_HANDLE store, const unsigned char* record, size_t size, uint64_t sequence);
+static int IotHub_FlushThread(void* context);
+static void PERSONALITY_flush(PERSONALITY* personality);
+static void PERSONALITY_flush_visit(void* context, void* value);
 
 static int strcmp_i(const char* lhs, const char* rhs)
 {
@@ -165,10 +197,51 @@ static void* IotHub_ParseConfigurationFromJson(const char* configuration)
 
                         if (config != NULL)
                         {
-                            strcpy(name, IoTHubName);
-                            strcpy(suffix, IoTHubSuffix);
-                            config->IoTHubName = name;
-                            config->IoTHubSuffix = suffix;
+                            /*Codes_SRS_IOTHUBMODULE_34_027: [ `IotHub_ParseConfigurationFromJson` shall read the "store" settings by calling `IoTHubStore_ParseConfigurationFromJson`. ]*/
+                            if (IoTHubStore_ParseConfigurationFromJson(obj, &config->store) != 0)
+                            {
+                                /*Codes_SRS_IOTHUBMODULE_34_028: [ If `IoTHubStore_ParseConfigurationFromJson` fails, `IotHub_ParseConfigurationFromJson` shall fail and return NULL. ]*/
+                                LogError("invalid store configuration");
+                                free(name);
+                                free(suffix);
+                                free(config);
+                                config = NULL;
+                            }
+                            /*Codes_SRS_IOTHUBMODULE_35_024: [ `IotHub_ParseConfigurationFromJson` shall read the "batch" settings by calling `IoTHubBatch_ParseConfigurationFromJson`. ]*/
+                            else if (IoTHubBatch_ParseConfigurationFromJson(obj, &config->batch) != 0)
+                            {
+                                /*Codes_SRS_IOTHUBMODULE_35_025: [ If `IoTHubBatch_ParseConfigurationFromJson` fails, `IotHub_ParseConfigurationFromJson` shall fail and return NULL. ]*/
+                                LogError("invalid batch configuration");
+                                if (config->store.path != NULL)
+                                {
+                                    free(config->store.path);
+                                }
+                                free(name);
+                                free(suffix);
+                                free(config);
+                                config = NULL;
+                            }
+                            /*Codes_SRS_IOTHUBMODULE_36_022: [ `IotHub_ParseConfigurationFromJson` shall read the "devices" settings by calling `IoTHubDeviceMap_ParseConfigurationFromJson`. ]*/
+                            else if (IoTHubDeviceMap_ParseConfigurationFromJson(obj, &config->devices) != 0)
+                            {
+                                /*Codes_SRS_IOTHUBMODULE_36_023: [ If `IoTHubDeviceMap_ParseConfigurationFromJson` fails, `IotHub_ParseConfigurationFromJson` shall fail and return NULL. ]*/
+                                LogError("invalid devices configuration");
+                                if (config->store.path != NULL)
+                                {
+                                    free(config->store.path);
+                                }
+                                free(name);
+                                free(suffix);
+                                free(config);
+                                config = NULL;
+                            }
+                            else
+                            {
+                                strcpy(name, IoTHubName);
+                                strcpy(suffix, IoTHubSuffix);
+                                config->IoTHubName = name;
+                                config->IoTHubSuffix = suffix;
+                            }
                         }
 
                         result = config;
@@ -191,10 +264,79 @@ static void IotHub_FreeConfiguration(void* configuration)
         /*Codes_SRS_IOTHUBMODULE_05_015: [ `IotHub_FreeConfiguration` shall free the strings referenced by the `IoTHubName` and `IoTHubSuffix` data members, and then free the `IOTHUB_CONFIG` structure itself. ]*/
         free((void*)config->IoTHubName);
         free((void*)config->IoTHubSuffix);
+        /*Codes_SRS_IOTHUBMODULE_34_029: [ `IotHub_FreeConfiguration` shall free the store's `path`. ]*/
+        if (config->store.path != NULL)
+        {
+            free(config->store.path);
+        }
         free(config);
     }
 }
 
+/*creates what the flush thread needs and starts it, returns 0 on success*/
+static int IotHub_StartBatching(IOTHUB_HANDLE_DATA* handleData)
+{
+    int result;
+    handleData->stopping = false;
+    if ((handleData->tickCounter = tickcounter_create()) == NULL)
+    {
+        LogError("unable to create a tick counter");
+        result = __LINE__;
+    }
+    else if ((handleData->lock = Lock_Init()) == NULL)
+    {
+        LogError("unable to create a lock");
+        tickcounter_destroy(handleData->tickCounter);
+        result = __LINE__;
+    }
+    else if ((handleData->flushWake = Condition_Init()) == NULL)
+    {
+        LogError("unable to create a condition");
+        (void)Lock_Deinit(handleData->lock);
+        tickcounter_destroy(handleData->tickCounter);
+        result = __LINE__;
+    }
+    else if (ModuleThread_Create(&handleData->flushThread, IotHub_FlushThread, handleData) != THREADAPI_OK)
+    {
+        LogError("unable to start the flush thread");
+        Condition_Deinit(handleData->flushWake);
+        (void)Lock_Deinit(handleData->lock);
+        tickcounter_destroy(handleData->tickCounter);
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+static void IotHub_StopFlushThread(IOTHUB_HANDLE_DATA* handleData)
+{
+    int notUsed;
+    if (Lock(handleData->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock, the flush thread is not stopped");
+    }
+    else
+    {
+        handleData->stopping = true;
+        (void)Condition_Post(handleData->flushWake);
+        (void)Unlock(handleData->lock);
+        if (ThreadAPI_Join(handleData->flushThread, &notUsed) != THREADAPI_OK)
+        {
+            LogError("unable to ThreadAPI_Join the flush thread");
+        }
+    }
+}
+
+static void IotHub_EndBatching(IOTHUB_HANDLE_DATA* handleData)
+{
+    Condition_Deinit(handleData->flushWake);
+    (void)Lock_Deinit(handleData->lock);
+    tickcounter_destroy(handleData->tickCounter);
+}
+
 static MODULE_HANDLE IotHub_Create(BROKER_HANDLE broker, const void* configuration)
 {
     IOTHUB_HANDLE_DATA *result;
@@ -235,14 +377,14 @@ static MODULE_HANDLE IotHub_Create(BROKER_HANDLE broker, const void* configurati
         }
         else
         {
-            /*Codes_SRS_IOTHUBMODULE_02_006: [ `IotHub_Create` shall create an empty `VECTOR` containing pointers to `PERSONALITY`s. ]*/
-            result->personalities = VECTOR_create(sizeof(PERSONALITY_PTR));
+            /*Codes_SRS_IOTHUBMODULE_02_006: [ `IotHub_Create` shall create an empty map of `PERSONALITY`s by device name by calling `IoTHubDeviceMap_Create`. ]*/
+            result->personalities = IoTHubDeviceMap_Create();
             if (result->personalities == NULL)
             {
-                /*Codes_SRS_IOTHUBMODULE_02_007: [ If creating the personality vector fails then `IotHub_Create` shall fail and return `NULL`. ]*/
+                /*Codes_SRS_IOTHUBMODULE_02_007: [ If creating the personality map fails then `IotHub_Create` shall fail and return `NULL`. ]*/
                 free(result);
                 result = NULL;
-                LogError("VECTOR_create returned NULL");
+                LogError("IoTHubDeviceMap_Create returned NULL");
             }
             else
             {
@@ -255,10 +397,10 @@ static MODULE_HANDLE IotHub_Create(BROKER_HANDLE broker, const void* configurati
                     if (result->transportHandle == NULL)
                     {
                         /*Codes_SRS_IOTHUBMODULE_17_002: [ If creating the shared transport fails, `IotHub_Create` shall fail and return `NULL`. ]*/
-                        VECTOR_destroy(result->personalities);
+                        IoTHubDeviceMap_Destroy(result->personalities);
                         free(result);
                         result = NULL;
-                        LogError("VECTOR_create returned NULL");
+                        LogError("IoTHubTransport_Create returned NULL");
                     }
                 }
                 else
@@ -274,7 +416,7 @@ static MODULE_HANDLE IotHub_Create(BROKER_HANDLE broker, const void* configurati
                     {
                         LogError("STRING_construct returned NULL");
                         IoTHubTransport_Destroy(result->transportHandle);
-                        VECTOR_destroy(result->personalities);
+                        IoTHubDeviceMap_Destroy(result->personalities);
                         free(result);
                         result = NULL;
                     }
@@ -283,7 +425,7 @@ static MODULE_HANDLE IotHub_Create(BROKER_HANDLE broker, const void* configurati
                         LogError("STRING_construct returned NULL");
                         STRING_delete(result->IoTHubName);
                         IoTHubTransport_Destroy(result->transportHandle);
-                        VECTOR_destroy(result->personalities);
+                        IoTHubDeviceMap_Destroy(result->personalities);
                         free(result);
                         result = NULL;
                     }
@@ -291,6 +433,74 @@ static MODULE_HANDLE IotHub_Create(BROKER_HANDLE broker, const void* configurati
                     {
                         /*Codes_SRS_IOTHUBMODULE_17_004: [ `IotHub_Create` shall store the broker. ]*/
                         result->broker = broker;
+                        /*Codes_SRS_IOTHUBMODULE_36_024: [ `IotHub_Create` shall keep at most `configuration->devices.max_clients` personalities, any number when it is 0. ]*/
+                        result->maxClients = config->devices.max_clients;
+                        result->inFlightLock = NULL;
+                        result->store = NULL;
+                        result->storeBuffer = NULL;
+                        result->storeBufferSize = 0;
+                        result->batchConfig = config->batch;
+                        result->lock = NULL;
+                        result->flushWake = NULL;
+                        result->flushThread = NULL;
+                        result->tickCounter = NULL;
+                        result->stopping = false;
+                        if (
+                            (result->maxClients != 0) &&
+                            ((result->inFlightLock = Lock_Init()) == NULL)
+                            )
+                        {
+                            /*Codes_SRS_IOTHUBMODULE_36_032: [ If `configuration->devices.max_clients` is not 0, `IotHub_Create` shall create a lock guarding the unconfirmed events of the personalities, and fail and return `NULL` if that fails. ]*/
+                            LogError("unable to Lock_Init");
+                            STRING_delete(result->IoTHubSuffix);
+                            STRING_delete(result->IoTHubName);
+                            IoTHubTransport_Destroy(result->transportHandle);
+                            IoTHubDeviceMap_Destroy(result->personalities);
+                            free(result);
+                            result = NULL;
+                        }
+                        /*Codes_SRS_IOTHUBMODULE_35_026: [ If `configuration->batch.enabled` is true, `IotHub_Create` shall create a lock, a condition and a tick counter and start a thread that sends the batches that are due. ]*/
+                        else if (
+                            (config->batch.enabled) &&
+                            (IotHub_StartBatching(result) != 0)
+                            )
+                        {
+                            /*Codes_SRS_IOTHUBMODULE_35_027: [ If batching cannot be started, `IotHub_Create` shall fail and return `NULL`. ]*/
+                            if (result->inFlightLock != NULL)
+                            {
+                                (void)Lock_Deinit(result->inFlightLock);
+                            }
+                            STRING_delete(result->IoTHubSuffix);
+                            STRING_delete(result->IoTHubName);
+                            IoTHubTransport_Destroy(result->transportHandle);
+                            IoTHubDeviceMap_Destroy(result->personalities);
+                            free(result);
+                            result = NULL;
+                        }
+                        else if (config->store.enabled)
+                        {
+                            /*Codes_SRS_IOTHUBMODULE_34_030: [ If `configuration->store.enabled` is true, `IotHub_Create` shall create the store by calling `IoTHubStore_Create` with `IotHub_SendStored` as the send function and the module as its context. ]*/
+                            if ((result->store = IoTHubStore_Create(&config->store, IotHub_SendStored, result)) == NULL)
+                            {
+                                /*Codes_SRS_IOTHUBMODULE_34_031: [ If `IoTHubStore_Create` fails, `IotHub_Create` shall fail and return `NULL`. ]*/
+                                LogError("IoTHubStore_Create returned NULL");
+                                if (config->batch.enabled)
+                                {
+                                    IotHub_StopFlushThread(result);
+                                    IotHub_EndBatching(result);
+                                }
+                                if (result->inFlightLock != NULL)
+                                {
+                                    (void)Lock_Deinit(result->inFlightLock);
+                                }
+                                STRING_delete(result->IoTHubSuffix);
+                                STRING_delete(result->IoTHubName);
+                                IoTHubTransport_Destroy(result->transportHandle);
+                                IoTHubDeviceMap_Destroy(result->personalities);
+                                free(result);
+                                result = NULL;
+                            }
+                        }
                         /*Codes_SRS_IOTHUBMODULE_02_008: [ Otherwise, `IotHub_Create` shall return a non-`NULL` handle. ]*/
                     }
                 }
@@ -311,28 +521,52 @@ static void IotHub_Destroy(MODULE_HANDLE moduleHandle)
     {
         /*Codes_SRS_IOTHUBMODULE_02_024: [ Otherwise `IotHub_Destroy` shall free all used resources. ]*/
         IOTHUB_HANDLE_DATA * handleData = moduleHandle;
-        size_t vectorSize = VECTOR_size(handleData->personalities);
-        for (size_t i = 0; i < vectorSize; i++)
+        PERSONALITY_PTR personality;
+        if (handleData->store != NULL)
         {
-            PERSONALITY_PTR* personality = VECTOR_element(handleData->personalities, i);
-            STRING_delete((*personality)->deviceKey);
-            STRING_delete((*personality)->deviceName);
-            IoTHubClient_Destroy((*personality)->iothubHandle);
-            free(*personality);
+            /*Codes_SRS_IOTHUBMODULE_34_032: [ If the module has a store, `IotHub_Destroy` shall stop its forwarder thread by calling `IoTHubStore_Stop` before destroying the personalities, and destroy it with `IoTHubStore_Destroy` after. ]*/
+            IoTHubStore_Stop(handleData->store);
+        }
+        if (handleData->batchConfig.enabled)
+        {
+            /*Codes_SRS_IOTHUBMODULE_35_028: [ When batching, `IotHub_Destroy` shall stop the flush thread and send what is left in the batches before destroying the personalities. ]*/
+            IotHub_StopFlushThread(handleData);
+            IoTHubDeviceMap_ForEach(handleData->personalities, PERSONALITY_flush_visit, NULL);
+        }
+        while ((personality = IoTHubDeviceMap_RemoveLeastRecentlyUsed(handleData->personalities)) != NULL)
+        {
+            STRING_delete(personality->deviceKey);
+            STRING_delete(personality->deviceName);
+            IoTHubClient_Destroy(personality->iothubHandle);
+            if (personality->batch != NULL)
+            {
+                IoTHubBatch_Destroy(personality->batch);
+            }
+            free(personality);
         }
         IoTHubTransport_Destroy(handleData->transportHandle);
-        VECTOR_destroy(handleData->personalities);
+        if (handleData->store != NULL)
+        {
+            /*destroying the clients confirms their pending events, so the store goes last*/
+            IoTHubStore_Destroy(handleData->store);
+            free(handleData->storeBuffer);
+        }
+        if (handleData->batchConfig.enabled)
+        {
+            IotHub_EndBatching(handleData);
+        }
+        if (handleData->inFlightLock != NULL)
+        {
+            /*destroying the clients confirms their pending events, these take the lock*/
+            (void)Lock_Deinit(handleData->inFlightLock);
+        }
+        IoTHubDeviceMap_Destroy(handleData->personalities);
         STRING_delete(handleData->IoTHubName);
         STRING_delete(handleData->IoTHubSuffix);
         free(handleData);
     }
 }
 
-static bool lookup_DeviceName(const void* element, const void* value)
-{
-    return (strcmp(STRING_c_str((*(PERSONALITY_PTR*)element)->deviceName), value) == 0);
-}
-
 static IOTHUBMESSAGE_DISPOSITION_RESULT IotHub_ReceiveMessageCallback(IOTHUB_MESSAGE_HANDLE msg, void* userContextCallback)
 {
     IOTHUBMESSAGE_DISPOSITION_RESULT result;
@@ -508,6 +742,21 @@ static PERSONALITY_PTR PERSONALITY_create(const char* deviceName, const char* de
                     /*it is all fine*/
                     result->broker = moduleHandleData->broker;
                     result->module = moduleHandleData;
+                    result->batch = NULL;
+                    result->inFlight = 0;
+                    /*Codes_SRS_IOTHUBMODULE_35_029: [ When batching, a new personality shall get its own batch by a call to `IoTHubBatch_Create`, and the personality is not created if that fails. ]*/
+                    if (
+                        (moduleHandleData->batchConfig.enabled) &&
+                        ((result->batch = IoTHubBatch_Create(&moduleHandleData->batchConfig)) == NULL)
+                        )
+                    {
+                        LogError("unable to create the batch of the device %s", deviceName);
+                        IoTHubClient_Destroy(result->iothubHandle);
+                        STRING_delete(result->deviceName);
+                        STRING_delete(result->deviceKey);
+                        free(result);
+                        result = NULL;
+                    }
                 }
             }
         }
@@ -520,42 +769,136 @@ static void PERSONALITY_destroy(PERSONALITY* personality)
     STRING_delete(personality->deviceName);
     STRING_delete(personality->deviceKey);
     IoTHubClient_Destroy(personality->iothubHandle);
+    if (personality->batch != NULL)
+    {
+        IoTHubBatch_Destroy(personality->batch);
+    }
+}
+
+/*counts one more event of personality waiting for its confirmation when there is a max_clients, returns 0 on success*/
+static int PERSONALITY_count_send(PERSONALITY* personality)
+{
+    int result;
+    IOTHUB_HANDLE_DATA* moduleHandleData = (IOTHUB_HANDLE_DATA*)personality->module;
+    if (moduleHandleData->inFlightLock == NULL)
+    {
+        /*not counted*/
+        result = 0;
+    }
+    else if (Lock(moduleHandleData->inFlightLock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        result = __LINE__;
+    }
+    else
+    {
+        personality->inFlight++;
+        (void)Unlock(moduleHandleData->inFlightLock);
+        result = 0;
+    }
+    return result;
+}
+
+/*undoes PERSONALITY_count_send once the event is confirmed, on the thread of the client, or could not be sent*/
+static void PERSONALITY_count_confirmation(PERSONALITY* personality)
+{
+    IOTHUB_HANDLE_DATA* moduleHandleData = (IOTHUB_HANDLE_DATA*)personality->module;
+    if (moduleHandleData->inFlightLock == NULL)
+    {
+        /*not counted*/
+    }
+    else if (Lock(moduleHandleData->inFlightLock) != LOCK_OK)
+    {
+        LogError("unable to Lock, the personality of %s is not evicted anymore", STRING_c_str(personality->deviceName));
+    }
+    else
+    {
+        personality->inFlight--;
+        (void)Unlock(moduleHandleData->inFlightLock);
+    }
+}
+
+/*Codes_SRS_IOTHUBMODULE_36_034: [ A personality is idle when none of its events waits for a confirmation and its batch, if any, is empty. ]*/
+static bool PERSONALITY_is_idle(void* context, void* value)
+{
+    bool result;
+    PERSONALITY* personality = (PERSONALITY*)value;
+    IOTHUB_HANDLE_DATA* moduleHandleData = (IOTHUB_HANDLE_DATA*)personality->module;
+    (void)context;
+    if (
+        (personality->batch != NULL) &&
+        (IoTHubBatch_GetCount(personality->batch) != 0)
+        )
+    {
+        result = false;
+    }
+    else if (Lock(moduleHandleData->inFlightLock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        result = false;
+    }
+    else
+    {
+        result = (personality->inFlight == 0);
+        (void)Unlock(moduleHandleData->inFlightLock);
+    }
+    return result;
+}
+
+/*destroys the least recently used idle personality, closing its client, to make room for a new one, returns 0 if there was one*/
+static int PERSONALITY_evict(IOTHUB_HANDLE_DATA* moduleHandleData)
+{
+    int result;
+    PERSONALITY* personality = IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(moduleHandleData->personalities, PERSONALITY_is_idle, NULL);
+    if (personality == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_035: [ If no personality is idle, none shall be evicted and the new device shall be refused as if its personality could not be created. ]*/
+        LogError("all %lu personalities wait for IoT Hub", (unsigned long)moduleHandleData->maxClients);
+        result = __LINE__;
+    }
+    else
+    {
+        /*destroying a client that has no event pending loses nothing*/
+        PERSONALITY_destroy(personality);
+        free(personality);
+        result = 0;
+    }
+    return result;
 }
 
 static PERSONALITY* PERSONALITY_find_or_create(IOTHUB_HANDLE_DATA* moduleHandleData, const char* deviceName, const char* deviceKey)
 {
     /*Codes_SRS_IOTHUBMODULE_02_017: [ Otherwise `IotHub_Receive` shall not create a new personality. ]*/
-    PERSONALITY* result;
-    PERSONALITY_PTR* resultPtr = VECTOR_find_if(moduleHandleData->personalities, lookup_DeviceName, deviceName);
-    if (resultPtr == NULL)
+    /*Codes_SRS_IOTHUBMODULE_36_025: [ `IotHub_Receive` shall look the personality up by calling `IoTHubDeviceMap_Find`, which makes it the most recently used one. ]*/
+    PERSONALITY* result = IoTHubDeviceMap_Find(moduleHandleData->personalities, deviceName);
+    if (result == NULL)
     {
         /*a new device has arrived!*/
         PERSONALITY_PTR personality;
-        if ((personality = PERSONALITY_create(deviceName, deviceKey, moduleHandleData)) == NULL)
+        if (
+            (moduleHandleData->maxClients != 0) &&
+            (IoTHubDeviceMap_GetCount(moduleHandleData->personalities) >= moduleHandleData->maxClients) &&
+            /*Codes_SRS_IOTHUBMODULE_36_026: [ If the module already has `max_clients` personalities, the least recently used idle one shall be taken out with `IoTHubDeviceMap_RemoveLeastRecentlyUsedIf` and destroyed before a new one is created. ]*/
+            (PERSONALITY_evict(moduleHandleData) != 0)
+            )
+        {
+            LogError("no room for a personality for the device %s", deviceName);
+        }
+        else if ((personality = PERSONALITY_create(deviceName, deviceKey, moduleHandleData)) == NULL)
         {
             LogError("unable to create a personality for the device %s", deviceName);
-            result = NULL;
+        }
+        else if (IoTHubDeviceMap_Add(moduleHandleData->personalities, deviceName, personality) != 0)
+        {
+            /*Codes_SRS_IOTHUBMODULE_02_016: [ If adding a new personality to the map fails, then `IoTHub_Receive` shall return. ]*/
+            LogError("IoTHubDeviceMap_Add failed");
+            PERSONALITY_destroy(personality);
+            free(personality);
         }
         else
         {
-            if ((VECTOR_push_back(moduleHandleData->personalities, &personality, 1)) != 0)
-            {
-                /*Codes_SRS_IOTHUBMODULE_02_016: [ If adding a new personality to the vector fails, then `IoTHub_Receive` shall return. ]*/
-                LogError("VECTOR_push_back failed");
-                PERSONALITY_destroy(personality);
-                free(personality);
-                result = NULL;
-            }
-            else
-            {
-                resultPtr = VECTOR_back(moduleHandleData->personalities);
-                result = *resultPtr;
-            }
-            }
+            result = personality;
         }
-    else
-    {
-        result = *resultPtr;
     }
     return result;
 }
@@ -622,6 +965,390 @@ static IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromGWMessage(MESSAGE_HANDLE me
     return result;
 }
 
+/*only asked for by IotHub_Receive when the events are counted*/
+static void IotHub_EventConfirmation(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
+{
+    (void)result;
+    /*Codes_SRS_IOTHUBMODULE_36_033: [ When the module has a `max_clients`, each personality shall count its events that `IoTHubClient_SendEventAsync` accepted until their confirmation callback runs, whatever the result. ]*/
+    PERSONALITY_count_confirmation((PERSONALITY*)userContextCallback);
+}
+
+static void IotHub_StoredEventConfirmation(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
+{
+    IOTHUB_STORED_EVENT* event = (IOTHUB_STORED_EVENT*)userContextCallback;
+    PERSONALITY* personality = event->personality;
+    /*Codes_SRS_IOTHUBMODULE_34_038: [ When the event is confirmed `IotHub_SendStored`'s confirmation callback shall call `IoTHubStore_Complete` with `delivered` true only if the result is `IOTHUB_CLIENT_CONFIRMATION_OK`. ]*/
+    IoTHubStore_Complete(event->store, event->sequence, result == IOTHUB_CLIENT_CONFIRMATION_OK);
+    free(event);
+    if (personality != NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_033: [ When the module has a `max_clients`, each personality shall count its events that `IoTHubClient_SendEventAsync` accepted until their confirmation callback runs, whatever the result. ]*/
+        PERSONALITY_count_confirmation(personality);
+    }
+}
+
+static void IotHub_BatchConfirmation(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
+{
+    IOTHUB_BATCH_EVENT* event = (IOTHUB_BATCH_EVENT*)userContextCallback;
+    PERSONALITY* sender = (PERSONALITY*)event->sender;
+    /*Codes_SRS_IOTHUBMODULE_35_034: [ When a batch is confirmed, each of its messages that came from the store shall be confirmed the way `IotHub_SendStored` confirms a single message. ]*/
+    for (size_t i = 0; i < event->count; i++)
+    {
+        if (event->contexts[i] != NULL)
+        {
+            IotHub_StoredEventConfirmation(result, event->contexts[i]);
+        }
+    }
+    IoTHubBatch_DestroyEvent(event);
+    if (sender != NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_033: [ When the module has a `max_clients`, each personality shall count its events that `IoTHubClient_SendEventAsync` accepted until their confirmation callback runs, whatever the result. ]*/
+        PERSONALITY_count_confirmation(sender);
+    }
+}
+
+/*sends what the batch of personality holds as one event, the module's lock must be held*/
+static void PERSONALITY_flush(PERSONALITY* personality)
+{
+    /*Codes_SRS_IOTHUBMODULE_35_030: [ A batch is sent by taking it with `IoTHubBatch_Take` and creating an IoT Hub message of its encoded body with `IoTHubMessage_CreateFromByteArray`. ]*/
+    IOTHUB_BATCH_EVENT* event = IoTHubBatch_Take(personality->batch);
+    if (event == NULL)
+    {
+        /*empty, or it is sent on the next attempt*/
+    }
+    else
+    {
+        IOTHUB_MESSAGE_HANDLE iotHubMessage = IoTHubMessage_CreateFromByteArray(event->body, event->size);
+        if (iotHubMessage == NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_35_033: [ If the batch cannot be sent, its messages shall be confirmed with `IOTHUB_CLIENT_CONFIRMATION_ERROR`. ]*/
+            LogError("unable to create a message for a batch of %lu messages", (unsigned long)event->count);
+            IotHub_BatchConfirmation(IOTHUB_CLIENT_CONFIRMATION_ERROR, event);
+        }
+        else
+        {
+            char count[24];
+            (void)sprintf(count, "%lu", (unsigned long)event->count);
+            /*Codes_SRS_IOTHUBMODULE_35_031: [ The message of a batch shall have a "batchCount" property holding the number of messages in it. ]*/
+            if (Map_AddOrUpdate(IoTHubMessage_Properties(iotHubMessage), BATCHCOUNT, count) != MAP_OK)
+            {
+                /*Codes_SRS_IOTHUBMODULE_35_033: [ If the batch cannot be sent, its messages shall be confirmed with `IOTHUB_CLIENT_CONFIRMATION_ERROR`. ]*/
+                LogError("unable to Map_AddOrUpdate");
+                IotHub_BatchConfirmation(IOTHUB_CLIENT_CONFIRMATION_ERROR, event);
+            }
+            else if (PERSONALITY_count_send(personality) != 0)
+            {
+                /*Codes_SRS_IOTHUBMODULE_35_033: [ If the batch cannot be sent, its messages shall be confirmed with `IOTHUB_CLIENT_CONFIRMATION_ERROR`. ]*/
+                IotHub_BatchConfirmation(IOTHUB_CLIENT_CONFIRMATION_ERROR, event);
+            }
+            else
+            {
+                /*the confirmation takes the batch off the count of personality*/
+                event->sender = (((IOTHUB_HANDLE_DATA*)personality->module)->inFlightLock != NULL) ? personality : NULL;
+                /*Codes_SRS_IOTHUBMODULE_35_032: [ The message of a batch shall be sent with `IoTHubClient_SendEventAsync`, passing a confirmation callback that receives the batch. ]*/
+                if (IoTHubClient_SendEventAsync(personality->iothubHandle, iotHubMessage, IotHub_BatchConfirmation, event) != IOTHUB_CLIENT_OK)
+                {
+                    /*Codes_SRS_IOTHUBMODULE_35_033: [ If the batch cannot be sent, its messages shall be confirmed with `IOTHUB_CLIENT_CONFIRMATION_ERROR`. ]*/
+                    LogError("unable to IoTHubClient_SendEventAsync");
+                    IotHub_BatchConfirmation(IOTHUB_CLIENT_CONFIRMATION_ERROR, event);
+                }
+                else
+                {
+                    /*the batch is confirmed later*/
+                }
+            }
+            IoTHubMessage_Destroy(iotHubMessage);
+        }
+    }
+}
+
+static void PERSONALITY_flush_visit(void* context, void* value)
+{
+    (void)context;
+    PERSONALITY_flush((PERSONALITY*)value);
+}
+
+/*adds the message to the batch of personality and sends the batch if it is ready, the module's lock must be held, returns 0 on success*/
+static int IotHub_AddToBatch(IOTHUB_HANDLE_DATA* moduleHandleData, PERSONALITY* personality, MESSAGE_HANDLE messageHandle, void* context)
+{
+    int result;
+    tickcounter_ms_t now;
+    if (tickcounter_get_current_ms(moduleHandleData->tickCounter, &now) != 0)
+    {
+        LogError("unable to tickcounter_get_current_ms");
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_35_035: [ When batching, a message shall be added to the batch of its device by calling `IoTHubBatch_Add`; if the batch is full it shall be sent first and the message added again. ]*/
+        IOTHUB_BATCH_ADD_RESULT addResult = IoTHubBatch_Add(personality->batch, messageHandle, context, now);
+        if (addResult == IOTHUB_BATCH_ADD_FULL)
+        {
+            PERSONALITY_flush(personality);
+            addResult = IoTHubBatch_Add(personality->batch, messageHandle, context, now);
+        }
+
+        if (addResult != IOTHUB_BATCH_ADD_OK)
+        {
+            LogError("unable to add the message to the batch of the device %s", STRING_c_str(personality->deviceName));
+            result = __LINE__;
+        }
+        else
+        {
+            if (IoTHubBatch_IsReady(personality->batch, now))
+            {
+                /*Codes_SRS_IOTHUBMODULE_35_036: [ If the batch is ready after adding the message, it shall be sent right away. ]*/
+                PERSONALITY_flush(personality);
+            }
+            else if (IoTHubBatch_GetCount(personality->batch) == 1)
+            {
+                /*Codes_SRS_IOTHUBMODULE_35_037: [ Otherwise, if the message started a new batch, the flush thread shall be woken up to wait for its due time. ]*/
+                (void)Condition_Post(moduleHandleData->flushWake);
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+/*one round of the flush thread over the personalities*/
+typedef struct IOTHUB_FLUSH_PASS_TAG
+{
+    tickcounter_ms_t now;
+    /*until the next batch is due, 0 when there is none*/
+    tickcounter_ms_t wait;
+}IOTHUB_FLUSH_PASS;
+
+static void PERSONALITY_flush_if_ready(void* context, void* value)
+{
+    IOTHUB_FLUSH_PASS* pass = (IOTHUB_FLUSH_PASS*)context;
+    PERSONALITY* personality = (PERSONALITY*)value;
+    tickcounter_ms_t due;
+    if (IoTHubBatch_IsReady(personality->batch, pass->now))
+    {
+        PERSONALITY_flush(personality);
+    }
+    else if (
+        (IoTHubBatch_GetDueTime(personality->batch, &due) == 0) &&
+        ((pass->wait == 0) || (due - pass->now < pass->wait))
+        )
+    {
+        pass->wait = due - pass->now;
+    }
+}
+
+/*Codes_SRS_IOTHUBMODULE_35_038: [ The flush thread shall send every batch that is ready, then sleep until the next batch is due or a new batch is started, until `IotHub_Destroy` stops it. ]*/
+static int IotHub_FlushThread(void* context)
+{
+    IOTHUB_HANDLE_DATA* moduleHandleData = (IOTHUB_HANDLE_DATA*)context;
+    if (Lock(moduleHandleData->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock, batches are only sent when full");
+    }
+    else
+    {
+        while (!moduleHandleData->stopping)
+        {
+            tickcounter_ms_t now;
+            /*0 waits until woken up*/
+            tickcounter_ms_t wait = 0;
+            if (tickcounter_get_current_ms(moduleHandleData->tickCounter, &now) != 0)
+            {
+                LogError("unable to tickcounter_get_current_ms");
+                wait = moduleHandleData->batchConfig.max_delay_ms;
+            }
+            else
+            {
+                IOTHUB_FLUSH_PASS pass;
+                pass.now = now;
+                pass.wait = 0;
+                IoTHubDeviceMap_ForEach(moduleHandleData->personalities, PERSONALITY_flush_if_ready, &pass);
+                wait = pass.wait;
+            }
+            (void)Condition_Wait(moduleHandleData->flushWake, moduleHandleData->lock, (int)wait);
+        }
+        (void)Unlock(moduleHandleData->lock);
+    }
+    return 0;
+}
+
+/*the store path of IotHub_SendStored when batching, the confirmation of the batch completes the record*/
+static IOTHUB_STORE_SEND_RESULT IotHub_AddStoredToBatch(IOTHUB_HANDLE_DATA* moduleHandleData, IOTHUB_STORE_HANDLE store, MESSAGE_HANDLE messageHandle, const char* deviceName, const char* deviceKey, uint64_t sequence)
+{
+    IOTHUB_STORE_SEND_RESULT result;
+    IOTHUB_STORED_EVENT* event = (IOTHUB_STORED_EVENT*)malloc(sizeof(IOTHUB_STORED_EVENT));
+    if (event == NULL)
+    {
+        LogError("unable to allocate the stored event");
+        result = IOTHUB_STORE_SEND_RETRY;
+    }
+    else if (Lock(moduleHandleData->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        free(event);
+        result = IOTHUB_STORE_SEND_RETRY;
+    }
+    else
+    {
+        PERSONALITY* whereIsIt = PERSONALITY_find_or_create(moduleHandleData, deviceName, deviceKey);
+        event->store = store;
+        event->sequence = sequence;
+        /*the batch counts for its messages*/
+        event->personality = NULL;
+        if (whereIsIt == NULL)
+        {
+            LogError("unable to PERSONALITY_find_or_create");
+            free(event);
+            result = IOTHUB_STORE_SEND_RETRY;
+        }
+        else if (IotHub_AddToBatch(moduleHandleData, whereIsIt, messageHandle, event) != 0)
+        {
+            free(event);
+            result = IOTHUB_STORE_SEND_RETRY;
+        }
+        else
+        {
+            result = IOTHUB_STORE_SEND_ACCEPTED;
+        }
+        (void)Unlock(moduleHandleData->lock);
+    }
+    return result;
+}
+
+/*runs on the store's forwarder thread, the only one that touches the personalities while there is a store and no batching*/
+static IOTHUB_STORE_SEND_RESULT IotHub_SendStored(void* context, IOTHUB_STORE_HANDLE store, const unsigned char* record, size_t size, uint64_t sequence)
+{
+    IOTHUB_STORE_SEND_RESULT result;
+    IOTHUB_HANDLE_DATA* moduleHandleData = (IOTHUB_HANDLE_DATA*)context;
+    /*Codes_SRS_IOTHUBMODULE_34_034: [ `IotHub_SendStored` shall recreate the message by calling `Message_CreateFromByteArray`. ]*/
+    MESSAGE_HANDLE messageHandle = Message_CreateFromByteArray(record, (int32_t)size);
+    if (messageHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_34_035: [ If the message cannot be recreated or has no "deviceName" or "deviceKey", `IotHub_SendStored` shall return `IOTHUB_STORE_SEND_DISCARD`. ]*/
+        LogError("unable to recreate a stored message, it is discarded");
+        result = IOTHUB_STORE_SEND_DISCARD;
+    }
+    else
+    {
+        CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
+        const char* deviceName = ConstMap_GetValue(properties, DEVICENAME);
+        const char* deviceKey = ConstMap_GetValue(properties, DEVICEKEY);
+        if (
+            (deviceName == NULL) ||
+            (deviceKey == NULL)
+            )
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_035: [ If the message cannot be recreated or has no "deviceName" or "deviceKey", `IotHub_SendStored` shall return `IOTHUB_STORE_SEND_DISCARD`. ]*/
+            LogError("a stored message has no device, it is discarded");
+            result = IOTHUB_STORE_SEND_DISCARD;
+        }
+        else if (moduleHandleData->batchConfig.enabled)
+        {
+            /*Codes_SRS_IOTHUBMODULE_35_039: [ When batching, `IotHub_SendStored` shall add the message to the batch of its device and return `IOTHUB_STORE_SEND_ACCEPTED`, or `IOTHUB_STORE_SEND_RETRY` if that fails. ]*/
+            result = IotHub_AddStoredToBatch(moduleHandleData, store, messageHandle, deviceName, deviceKey, sequence);
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_036: [ `IotHub_SendStored` shall send the message the way `IotHub_Receive` does without a store, passing a confirmation callback that reports the outcome to the store. ]*/
+            PERSONALITY* whereIsIt = PERSONALITY_find_or_create(moduleHandleData, deviceName, deviceKey);
+            if (whereIsIt == NULL)
+            {
+                /*Codes_SRS_IOTHUBMODULE_34_037: [ If any other step fails, `IotHub_SendStored` shall return `IOTHUB_STORE_SEND_RETRY`. ]*/
+                LogError("unable to PERSONALITY_find_or_create");
+                result = IOTHUB_STORE_SEND_RETRY;
+            }
+            else
+            {
+                IOTHUB_MESSAGE_HANDLE iotHubMessage = IoTHubMessage_CreateFromGWMessage(messageHandle);
+                if (iotHubMessage == NULL)
+                {
+                    LogError("unable to IoTHubMessage_CreateFromGWMessage (internal)");
+                    result = IOTHUB_STORE_SEND_RETRY;
+                }
+                else
+                {
+                    IOTHUB_STORED_EVENT* event = (IOTHUB_STORED_EVENT*)malloc(sizeof(IOTHUB_STORED_EVENT));
+                    if (event == NULL)
+                    {
+                        LogError("unable to allocate the stored event");
+                        result = IOTHUB_STORE_SEND_RETRY;
+                    }
+                    else
+                    {
+                        event->store = store;
+                        event->sequence = sequence;
+                        event->personality = (moduleHandleData->inFlightLock != NULL) ? whereIsIt : NULL;
+                        if (PERSONALITY_count_send(whereIsIt) != 0)
+                        {
+                            free(event);
+                            result = IOTHUB_STORE_SEND_RETRY;
+                        }
+                        else if (IoTHubClient_SendEventAsync(whereIsIt->iothubHandle, iotHubMessage, IotHub_StoredEventConfirmation, event) != IOTHUB_CLIENT_OK)
+                        {
+                            LogError("unable to IoTHubClient_SendEventAsync");
+                            PERSONALITY_count_confirmation(whereIsIt);
+                            free(event);
+                            result = IOTHUB_STORE_SEND_RETRY;
+                        }
+                        else
+                        {
+                            result = IOTHUB_STORE_SEND_ACCEPTED;
+                        }
+                    }
+                    IoTHubMessage_Destroy(iotHubMessage);
+                }
+            }
+        }
+        ConstMap_Destroy(properties);
+        Message_Destroy(messageHandle);
+    }
+    return result;
+}
+
+/*returns 0 when messageHandle is in the store*/
+static int IotHub_AppendToStore(IOTHUB_HANDLE_DATA* moduleHandleData, MESSAGE_HANDLE messageHandle)
+{
+    int result;
+    int32_t size = Message_ToByteArray(messageHandle, NULL, 0);
+    if (size <= 0)
+    {
+        LogError("unable to get the serialized size of the message");
+        result = __LINE__;
+    }
+    else
+    {
+        if (size > moduleHandleData->storeBufferSize)
+        {
+            /*the buffer only grows, its content does not need to survive*/
+            free(moduleHandleData->storeBuffer);
+            moduleHandleData->storeBufferSize = 0;
+            if ((moduleHandleData->storeBuffer = (unsigned char*)malloc(size)) == NULL)
+            {
+                LogError("unable to allocate %ld bytes", (long)size);
+            }
+            else
+            {
+                moduleHandleData->storeBufferSize = size;
+            }
+        }
+
+        if (size > moduleHandleData->storeBufferSize)
+        {
+            result = __LINE__;
+        }
+        else if (Message_ToByteArray(messageHandle, moduleHandleData->storeBuffer, size) != size)
+        {
+            LogError("unable to serialize the message");
+            result = __LINE__;
+        }
+        else
+        {
+            result = IoTHubStore_Append(moduleHandleData->store, moduleHandleData->storeBuffer, (size_t)size);
+        }
+    }
+    return result;
+}
+
 static void IotHub_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
 {
     /*Codes_SRS_IOTHUBMODULE_02_009: [ If `moduleHandle` or `messageHandle` is `NULL` then `IotHub_Receive` shall do nothing. ]*/
@@ -662,6 +1389,36 @@ static void IotHub_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHan
                 {
                     /*do nothing, missing device key*/
                 }
+                else if (((IOTHUB_HANDLE_DATA*)moduleHandle)->store != NULL)
+                {
+                    /*Codes_SRS_IOTHUBMODULE_34_033: [ If the module has a store, `IotHub_Receive` shall serialize the message with `Message_ToByteArray` and append it to the store with `IoTHubStore_Append` instead of sending it. ]*/
+                    if (IotHub_AppendToStore((IOTHUB_HANDLE_DATA*)moduleHandle, messageHandle) != 0)
+                    {
+                        LogError("unable to store the message for the device %s", deviceName);
+                    }
+                }
+                else if (((IOTHUB_HANDLE_DATA*)moduleHandle)->batchConfig.enabled)
+                {
+                    /*Codes_SRS_IOTHUBMODULE_35_040: [ When batching without a store, `IotHub_Receive` shall add the message to the batch of its device instead of sending it. ]*/
+                    IOTHUB_HANDLE_DATA* moduleHandleData = moduleHandle;
+                    if (Lock(moduleHandleData->lock) != LOCK_OK)
+                    {
+                        LogError("unable to Lock");
+                    }
+                    else
+                    {
+                        PERSONALITY* whereIsIt = PERSONALITY_find_or_create(moduleHandleData, deviceName, deviceKey);
+                        if (whereIsIt == NULL)
+                        {
+                            LogError("unable to PERSONALITY_find_or_create");
+                        }
+                        else if (IotHub_AddToBatch(moduleHandleData, whereIsIt, messageHandle, NULL) != 0)
+                        {
+                            LogError("unable to batch the message for the device %s", deviceName);
+                        }
+                        (void)Unlock(moduleHandleData->lock);
+                    }
+                }
                 else
                 {
                     IOTHUB_HANDLE_DATA* moduleHandleData = moduleHandle;
@@ -683,8 +1440,22 @@ static void IotHub_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHan
                         }
                         else
                         {
+                            IOTHUB_CLIENT_RESULT sendResult;
                             /*Codes_SRS_IOTHUBMODULE_02_020: [ `IotHub_Receive` shall call IoTHubClient_SendEventAsync passing the IOTHUB_MESSAGE_HANDLE. ]*/
-                            if (IoTHubClient_SendEventAsync(whereIsIt->iothubHandle, iotHubMessage, NULL, NULL) != IOTHUB_CLIENT_OK)
+                            if (moduleHandleData->inFlightLock == NULL)
+                            {
+                                sendResult = IoTHubClient_SendEventAsync(whereIsIt->iothubHandle, iotHubMessage, NULL, NULL);
+                            }
+                            else if (PERSONALITY_count_send(whereIsIt) != 0)
+                            {
+                                sendResult = IOTHUB_CLIENT_ERROR;
+                            }
+                            else if ((sendResult = IoTHubClient_SendEventAsync(whereIsIt->iothubHandle, iotHubMessage, IotHub_EventConfirmation, whereIsIt)) != IOTHUB_CLIENT_OK)
+                            {
+                                PERSONALITY_count_confirmation(whereIsIt);
+                            }
+
+                            if (sendResult != IOTHUB_CLIENT_OK)
                             {
                                 /*Codes_SRS_IOTHUBMODULE_02_021: [ If `IoTHubClient_SendEventAsync` fails then `IotHub_Receive` shall return. ]*/
                                 LogError("unable to IoTHubClient_SendEventAsync");
@@ -0,0 +1,534 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "iothub_batch.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/constmap.h>
+#include <azure_c_shared_utility/constbuffer.h>
+
+/*
+ * A batch is the JSON array IoT Hub accepts for batched device to cloud
+ * messages, kept encoded so taking it costs nothing:
+ *
+ *     [{"body":"<base64>","base64Encoded":true,"properties":{"k":"v"}},...]
+ *
+ * The buffer holds "[" and the entries; IoTHubBatch_Take closes the array
+ * and hands the buffer over.
+ */
+
+#define IOTHUB_BATCH_MAX_MESSAGES 10000
+#define IOTHUB_BATCH_MIN_BYTES 1024
+#define IOTHUB_BATCH_MAX_BYTES (256 * 1024)
+#define IOTHUB_BATCH_MAX_DELAY_MS (60 * 60 * 1000)
+#define IOTHUB_BATCH_MIN_CAPACITY 1024
+
+#define ENTRY_BODY "{\"body\":\""
+#define ENTRY_PROPERTIES "\",\"base64Encoded\":true,\"properties\":{"
+#define ENTRY_END "}}"
+#define LITERAL_SIZE(literal) (sizeof(literal) - 1)
+
+static const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char hex_digits[] = "0123456789abcdef";
+
+typedef struct IOTHUB_BATCH_TAG
+{
+    size_t max_messages;
+    size_t max_bytes;
+    size_t max_delay_ms;
+    unsigned char* buffer;
+    size_t size;
+    size_t capacity;
+    /*max_messages of them*/
+    void** contexts;
+    size_t count;
+    tickcounter_ms_t first_added;
+} IOTHUB_BATCH;
+
+static int read_size(const JSON_Value* value, size_t minimum, size_t maximum, size_t* result_value)
+{
+    int result;
+    double number;
+    if (json_value_get_type(value) != JSONNumber)
+    {
+        result = __LINE__;
+    }
+    else if (
+        ((number = json_value_get_number(value)) < (double)minimum) ||
+        (number > (double)maximum) ||
+        ((double)(size_t)number != number)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *result_value = (size_t)number;
+        result = 0;
+    }
+    return result;
+}
+
+int IoTHubBatch_ParseConfigurationFromJson(const JSON_Object* json, IOTHUB_BATCH_CONFIG* config)
+{
+    int result;
+    /*Codes_SRS_IOTHUBMODULE_35_001: [ If json or config is NULL then IoTHubBatch_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+    if (
+        (json == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg json=%p config=%p", json, config);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Value* batch = json_object_get_value(json, "batch");
+        JSON_Object* settings = json_value_get_object(batch);
+
+        /*Codes_SRS_IOTHUBMODULE_35_002: [ Values that are not present shall default to max_messages IOTHUB_BATCH_DEFAULT_MAX_MESSAGES, max_bytes IOTHUB_BATCH_DEFAULT_MAX_BYTES and max_delay_ms IOTHUB_BATCH_DEFAULT_MAX_DELAY_MS. ]*/
+        config->enabled = false;
+        config->max_messages = IOTHUB_BATCH_DEFAULT_MAX_MESSAGES;
+        config->max_bytes = IOTHUB_BATCH_DEFAULT_MAX_BYTES;
+        config->max_delay_ms = IOTHUB_BATCH_DEFAULT_MAX_DELAY_MS;
+
+        if (batch == NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_35_003: [ If there is no "batch" then IoTHubBatch_ParseConfigurationFromJson shall set enabled to false and succeed. ]*/
+            result = 0;
+        }
+        /*Codes_SRS_IOTHUBMODULE_35_004: [ If "batch" is not an object then IoTHubBatch_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        else if (settings == NULL)
+        {
+            LogError("\"batch\" must be an object");
+            result = __LINE__;
+        }
+        else
+        {
+            JSON_Value* max_messages = json_object_get_value(settings, "max_messages");
+            JSON_Value* max_bytes = json_object_get_value(settings, "max_bytes");
+            JSON_Value* max_delay = json_object_get_value(settings, "max_delay_ms");
+
+            /*Codes_SRS_IOTHUBMODULE_35_005: [ If a value of "batch" is present and is not a number in range then IoTHubBatch_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+            if (
+                (max_messages != NULL) &&
+                (read_size(max_messages, 1, IOTHUB_BATCH_MAX_MESSAGES, &config->max_messages) != 0)
+                )
+            {
+                LogError("\"max_messages\" must be a whole number from 1 to %d", IOTHUB_BATCH_MAX_MESSAGES);
+                result = __LINE__;
+            }
+            else if (
+                (max_bytes != NULL) &&
+                (read_size(max_bytes, IOTHUB_BATCH_MIN_BYTES, IOTHUB_BATCH_MAX_BYTES, &config->max_bytes) != 0)
+                )
+            {
+                LogError("\"max_bytes\" must be a whole number from %d to %d", IOTHUB_BATCH_MIN_BYTES, IOTHUB_BATCH_MAX_BYTES);
+                result = __LINE__;
+            }
+            else if (
+                (max_delay != NULL) &&
+                (read_size(max_delay, 1, IOTHUB_BATCH_MAX_DELAY_MS, &config->max_delay_ms) != 0)
+                )
+            {
+                LogError("\"max_delay_ms\" must be a whole number from 1 to %d", IOTHUB_BATCH_MAX_DELAY_MS);
+                result = __LINE__;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBMODULE_35_006: [ Otherwise IoTHubBatch_ParseConfigurationFromJson shall set enabled to true and succeed. ]*/
+                config->enabled = true;
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_BATCH_HANDLE IoTHubBatch_Create(const IOTHUB_BATCH_CONFIG* config)
+{
+    IOTHUB_BATCH* result;
+    /*Codes_SRS_IOTHUBMODULE_35_007: [ If config is NULL or any of its limits is 0 then IoTHubBatch_Create shall fail and return NULL. ]*/
+    if (
+        (config == NULL) ||
+        (config->max_messages == 0) ||
+        (config->max_bytes == 0) ||
+        (config->max_delay_ms == 0)
+        )
+    {
+        LogError("invalid arg config=%p", config);
+        result = NULL;
+    }
+    else if ((result = (IOTHUB_BATCH*)malloc(sizeof(IOTHUB_BATCH))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_35_008: [ If any allocation fails then IoTHubBatch_Create shall fail and return NULL. ]*/
+        LogError("unable to allocate a batch");
+    }
+    else if ((result->contexts = (void**)malloc(config->max_messages * sizeof(void*))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_35_008: [ If any allocation fails then IoTHubBatch_Create shall fail and return NULL. ]*/
+        LogError("unable to allocate room for %lu contexts", (unsigned long)config->max_messages);
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_35_009: [ Otherwise IoTHubBatch_Create shall return an empty batch. ]*/
+        result->max_messages = config->max_messages;
+        result->max_bytes = config->max_bytes;
+        result->max_delay_ms = config->max_delay_ms;
+        result->buffer = NULL;
+        result->size = 0;
+        result->capacity = 0;
+        result->count = 0;
+        result->first_added = 0;
+    }
+    return result;
+}
+
+static bool is_device_property(const char* key)
+{
+    return (strcmp(key, "deviceName") == 0) || (strcmp(key, "deviceKey") == 0);
+}
+
+static size_t escaped_size(const char* text)
+{
+    size_t result = 0;
+    const unsigned char* c;
+    for (c = (const unsigned char*)text; *c != '\0'; c++)
+    {
+        if ((*c == '"') || (*c == '\\') || (*c == '\b') || (*c == '\f') || (*c == '\n') || (*c == '\r') || (*c == '\t'))
+        {
+            result += 2;
+        }
+        else if (*c < 0x20)
+        {
+            result += 6;
+        }
+        else
+        {
+            result++;
+        }
+    }
+    return result;
+}
+
+static unsigned char* append_escaped(unsigned char* destination, const char* text)
+{
+    const unsigned char* c;
+    for (c = (const unsigned char*)text; *c != '\0'; c++)
+    {
+        switch (*c)
+        {
+        case '"': *destination++ = '\\'; *destination++ = '"'; break;
+        case '\\': *destination++ = '\\'; *destination++ = '\\'; break;
+        case '\b': *destination++ = '\\'; *destination++ = 'b'; break;
+        case '\f': *destination++ = '\\'; *destination++ = 'f'; break;
+        case '\n': *destination++ = '\\'; *destination++ = 'n'; break;
+        case '\r': *destination++ = '\\'; *destination++ = 'r'; break;
+        case '\t': *destination++ = '\\'; *destination++ = 't'; break;
+        default:
+            if (*c < 0x20)
+            {
+                *destination++ = '\\';
+                *destination++ = 'u';
+                *destination++ = '0';
+                *destination++ = '0';
+                *destination++ = (unsigned char)hex_digits[*c >> 4];
+                *destination++ = (unsigned char)hex_digits[*c & 0x0F];
+            }
+            else
+            {
+                *destination++ = *c;
+            }
+            break;
+        }
+    }
+    return destination;
+}
+
+static unsigned char* append_base64(unsigned char* destination, const unsigned char* source, size_t size)
+{
+    size_t i;
+    for (i = 0; i + 2 < size; i += 3)
+    {
+        *destination++ = (unsigned char)base64_alphabet[source[i] >> 2];
+        *destination++ = (unsigned char)base64_alphabet[((source[i] & 0x03) << 4) | (source[i + 1] >> 4)];
+        *destination++ = (unsigned char)base64_alphabet[((source[i + 1] & 0x0F) << 2) | (source[i + 2] >> 6)];
+        *destination++ = (unsigned char)base64_alphabet[source[i + 2] & 0x3F];
+    }
+    if (i + 1 == size)
+    {
+        *destination++ = (unsigned char)base64_alphabet[source[i] >> 2];
+        *destination++ = (unsigned char)base64_alphabet[(source[i] & 0x03) << 4];
+        *destination++ = '=';
+        *destination++ = '=';
+    }
+    else if (i + 2 == size)
+    {
+        *destination++ = (unsigned char)base64_alphabet[source[i] >> 2];
+        *destination++ = (unsigned char)base64_alphabet[((source[i] & 0x03) << 4) | (source[i + 1] >> 4)];
+        *destination++ = (unsigned char)base64_alphabet[(source[i + 1] & 0x0F) << 2];
+        *destination++ = '=';
+    }
+    return destination;
+}
+
+static unsigned char* append_text(unsigned char* destination, const char* text, size_t size)
+{
+    (void)memcpy(destination, text, size);
+    return destination + size;
+}
+
+/*makes room for size more bytes, the buffer at least doubles so appending stays linear*/
+static int reserve(IOTHUB_BATCH* batch, size_t size)
+{
+    int result;
+    if (batch->capacity - batch->size >= size)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t capacity = (batch->capacity < IOTHUB_BATCH_MIN_CAPACITY) ? IOTHUB_BATCH_MIN_CAPACITY : batch->capacity * 2;
+        unsigned char* buffer;
+        if (capacity - batch->size < size)
+        {
+            capacity = batch->size + size;
+        }
+
+        if ((buffer = (unsigned char*)realloc(batch->buffer, capacity)) == NULL)
+        {
+            LogError("unable to grow the batch to %lu bytes", (unsigned long)capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            batch->buffer = buffer;
+            batch->capacity = capacity;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+IOTHUB_BATCH_ADD_RESULT IoTHubBatch_Add(IOTHUB_BATCH_HANDLE handle, MESSAGE_HANDLE message, void* context, tickcounter_ms_t now)
+{
+    IOTHUB_BATCH_ADD_RESULT result;
+    /*Codes_SRS_IOTHUBMODULE_35_010: [ If handle or message is NULL then IoTHubBatch_Add shall fail and return IOTHUB_BATCH_ADD_ERROR. ]*/
+    if (
+        (handle == NULL) ||
+        (message == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p message=%p", handle, message);
+        result = IOTHUB_BATCH_ADD_ERROR;
+    }
+    else
+    {
+        const CONSTBUFFER* content = Message_GetContent(message);
+        CONSTMAP_HANDLE properties = Message_GetProperties(message);
+        const char* const* keys;
+        const char* const* values;
+        size_t nProperties;
+        if (
+            (content == NULL) ||
+            (properties == NULL) ||
+            (ConstMap_GetInternals(properties, &keys, &values, &nProperties) != CONSTMAP_OK)
+            )
+        {
+            LogError("unable to get the content and properties of the message");
+            result = IOTHUB_BATCH_ADD_ERROR;
+        }
+        else
+        {
+            size_t i;
+            size_t written = 0;
+            /*the separator, the fixed parts and the body*/
+            size_t entry_size = ((handle->count == 0) ? 0 : 1) +
+                LITERAL_SIZE(ENTRY_BODY) + 4 * ((content->size + 2) / 3) + LITERAL_SIZE(ENTRY_PROPERTIES) + LITERAL_SIZE(ENTRY_END);
+            for (i = 0; i < nProperties; i++)
+            {
+                if (!is_device_property(keys[i]))
+                {
+                    /*"key":"value" and the separator*/
+                    entry_size += escaped_size(keys[i]) + escaped_size(values[i]) + ((written == 0) ? 5 : 6);
+                    written++;
+                }
+            }
+
+            /*Codes_SRS_IOTHUBMODULE_35_011: [ If the batch holds max_messages messages, or is not empty and the encoded batch with message would be larger than max_bytes, then IoTHubBatch_Add shall leave the batch as is and return IOTHUB_BATCH_ADD_FULL. ]*/
+            if (
+                (handle->count == handle->max_messages) ||
+                ((handle->count > 0) && (handle->size + entry_size + 1 > handle->max_bytes))
+                )
+            {
+                result = IOTHUB_BATCH_ADD_FULL;
+            }
+            /*Codes_SRS_IOTHUBMODULE_35_013: [ If any allocation fails then IoTHubBatch_Add shall return IOTHUB_BATCH_ADD_ERROR and leave the batch as is. ]*/
+            else if (reserve(handle, entry_size + ((handle->count == 0) ? 1 : 0)) != 0)
+            {
+                result = IOTHUB_BATCH_ADD_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBMODULE_35_012: [ Otherwise IoTHubBatch_Add shall append the content as base64 and the properties other than "deviceName" and "deviceKey" to the batch, remember context and return IOTHUB_BATCH_ADD_OK. ]*/
+                unsigned char* destination = handle->buffer + handle->size;
+                if (handle->count == 0)
+                {
+                    *destination++ = '[';
+                    /*Codes_SRS_IOTHUBMODULE_35_014: [ The first message added to an empty batch shall start its delay at now. ]*/
+                    handle->first_added = now;
+                }
+                else
+                {
+                    *destination++ = ',';
+                }
+                destination = append_text(destination, ENTRY_BODY, LITERAL_SIZE(ENTRY_BODY));
+                destination = append_base64(destination, content->buffer, content->size);
+                destination = append_text(destination, ENTRY_PROPERTIES, LITERAL_SIZE(ENTRY_PROPERTIES));
+                written = 0;
+                for (i = 0; i < nProperties; i++)
+                {
+                    if (!is_device_property(keys[i]))
+                    {
+                        if (written++ > 0)
+                        {
+                            *destination++ = ',';
+                        }
+                        *destination++ = '"';
+                        destination = append_escaped(destination, keys[i]);
+                        destination = append_text(destination, "\":\"", 3);
+                        destination = append_escaped(destination, values[i]);
+                        *destination++ = '"';
+                    }
+                }
+                destination = append_text(destination, ENTRY_END, LITERAL_SIZE(ENTRY_END));
+
+                handle->size = (size_t)(destination - handle->buffer);
+                handle->contexts[handle->count++] = context;
+                result = IOTHUB_BATCH_ADD_OK;
+            }
+        }
+
+        if (properties != NULL)
+        {
+            ConstMap_Destroy(properties);
+        }
+    }
+    return result;
+}
+
+size_t IoTHubBatch_GetCount(IOTHUB_BATCH_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUBMODULE_35_015: [ IoTHubBatch_GetCount shall return the number of messages in the batch, 0 if handle is NULL. ]*/
+    return (handle == NULL) ? 0 : handle->count;
+}
+
+int IoTHubBatch_GetDueTime(IOTHUB_BATCH_HANDLE handle, tickcounter_ms_t* due)
+{
+    int result;
+    /*Codes_SRS_IOTHUBMODULE_35_016: [ If handle or due is NULL, or the batch is empty, then IoTHubBatch_GetDueTime shall return a non-zero value. ]*/
+    if (
+        (handle == NULL) ||
+        (due == NULL) ||
+        (handle->count == 0)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_35_017: [ Otherwise IoTHubBatch_GetDueTime shall set due to max_delay_ms after the first message was added and return 0. ]*/
+        *due = handle->first_added + handle->max_delay_ms;
+        result = 0;
+    }
+    return result;
+}
+
+bool IoTHubBatch_IsReady(IOTHUB_BATCH_HANDLE handle, tickcounter_ms_t now)
+{
+    /*Codes_SRS_IOTHUBMODULE_35_018: [ IoTHubBatch_IsReady shall return true if the batch holds max_messages messages, or is not empty and max_delay_ms have passed since its first message was added. ]*/
+    return
+        (handle != NULL) &&
+        (handle->count > 0) &&
+        (
+            (handle->count == handle->max_messages) ||
+            ((now - handle->first_added) >= handle->max_delay_ms)
+        );
+}
+
+IOTHUB_BATCH_EVENT* IoTHubBatch_Take(IOTHUB_BATCH_HANDLE handle)
+{
+    IOTHUB_BATCH_EVENT* result;
+    /*Codes_SRS_IOTHUBMODULE_35_019: [ If handle is NULL or the batch is empty then IoTHubBatch_Take shall return NULL. ]*/
+    if (
+        (handle == NULL) ||
+        (handle->count == 0)
+        )
+    {
+        result = NULL;
+    }
+    /*Codes_SRS_IOTHUBMODULE_35_020: [ If any allocation fails then IoTHubBatch_Take shall return NULL and leave the batch as is. ]*/
+    else if (reserve(handle, 1) != 0)
+    {
+        result = NULL;
+    }
+    else if ((result = (IOTHUB_BATCH_EVENT*)malloc(sizeof(IOTHUB_BATCH_EVENT))) == NULL)
+    {
+        LogError("unable to allocate a batch event");
+    }
+    else if ((result->contexts = (void**)malloc(handle->count * sizeof(void*))) == NULL)
+    {
+        LogError("unable to allocate room for %lu contexts", (unsigned long)handle->count);
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_35_021: [ Otherwise IoTHubBatch_Take shall close the JSON array, hand the encoded batch and the contexts of its messages over to the returned event and empty the batch. ]*/
+        handle->buffer[handle->size++] = ']';
+        (void)memcpy(result->contexts, handle->contexts, handle->count * sizeof(void*));
+        result->body = handle->buffer;
+        result->size = handle->size;
+        result->count = handle->count;
+        result->sender = NULL;
+        handle->buffer = NULL;
+        handle->size = 0;
+        handle->capacity = 0;
+        handle->count = 0;
+    }
+    return result;
+}
+
+void IoTHubBatch_DestroyEvent(IOTHUB_BATCH_EVENT* event)
+{
+    /*Codes_SRS_IOTHUBMODULE_35_022: [ IoTHubBatch_DestroyEvent shall free the event, its body and its contexts array, and do nothing if event is NULL. ]*/
+    if (event != NULL)
+    {
+        free(event->body);
+        free(event->contexts);
+        free(event);
+    }
+}
+
+void IoTHubBatch_Destroy(IOTHUB_BATCH_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUBMODULE_35_023: [ IoTHubBatch_Destroy shall free all the resources of the batch, and do nothing if handle is NULL. ]*/
+    if (handle != NULL)
+    {
+        if (handle->count > 0)
+        {
+            LogError("%lu messages in the batch were not sent", (unsigned long)handle->count);
+        }
+        free(handle->buffer);
+        free(handle->contexts);
+        free(handle);
+    }
+}
@@ -0,0 +1,422 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "iothub_device_map.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+
+/*
+ * A chained hash table of entries that are also on a doubly linked list,
+ * most recently found first, so that finding a device, moving it to the
+ * front and taking the least recently used one out are all O(1).
+ */
+
+#define IOTHUB_DEVICE_MAP_MAX_CLIENTS 1000000
+#define IOTHUB_DEVICE_MAP_MIN_BUCKETS 16
+
+typedef struct DEVICE_ENTRY_TAG
+{
+    struct DEVICE_ENTRY_TAG* next_in_bucket;
+    struct DEVICE_ENTRY_TAG* more_recent;
+    struct DEVICE_ENTRY_TAG* less_recent;
+    uint32_t hash;
+    void* value;
+    /*allocated with the entry*/
+    char* deviceName;
+} DEVICE_ENTRY;
+
+typedef struct IOTHUB_DEVICE_MAP_TAG
+{
+    /*bucket_count of them, a power of 2*/
+    DEVICE_ENTRY** buckets;
+    size_t bucket_count;
+    size_t count;
+    DEVICE_ENTRY* most_recent;
+    DEVICE_ENTRY* least_recent;
+} IOTHUB_DEVICE_MAP;
+
+/*FNV-1a*/
+static uint32_t hash_device_name(const char* deviceName)
+{
+    uint32_t result = 2166136261u;
+    while (*deviceName != '\0')
+    {
+        result ^= (unsigned char)*deviceName++;
+        result *= 16777619u;
+    }
+    return result;
+}
+
+static void unlink_recent(IOTHUB_DEVICE_MAP* map, DEVICE_ENTRY* entry)
+{
+    if (entry->more_recent == NULL)
+    {
+        map->most_recent = entry->less_recent;
+    }
+    else
+    {
+        entry->more_recent->less_recent = entry->less_recent;
+    }
+
+    if (entry->less_recent == NULL)
+    {
+        map->least_recent = entry->more_recent;
+    }
+    else
+    {
+        entry->less_recent->more_recent = entry->more_recent;
+    }
+}
+
+static void link_most_recent(IOTHUB_DEVICE_MAP* map, DEVICE_ENTRY* entry)
+{
+    entry->more_recent = NULL;
+    entry->less_recent = map->most_recent;
+    if (map->most_recent == NULL)
+    {
+        map->least_recent = entry;
+    }
+    else
+    {
+        map->most_recent->more_recent = entry;
+    }
+    map->most_recent = entry;
+}
+
+/*takes entry out of its bucket and the recent list, frees it and returns its value*/
+static void* remove_entry(IOTHUB_DEVICE_MAP* map, DEVICE_ENTRY* entry)
+{
+    void* result = entry->value;
+    DEVICE_ENTRY** link = &map->buckets[entry->hash & (map->bucket_count - 1)];
+    while (*link != entry)
+    {
+        link = &(*link)->next_in_bucket;
+    }
+    *link = entry->next_in_bucket;
+    unlink_recent(map, entry);
+    map->count--;
+    free(entry);
+    return result;
+}
+
+/*doubles the buckets, on failure the chains just get longer*/
+static void grow(IOTHUB_DEVICE_MAP* map)
+{
+    size_t bucket_count = map->bucket_count * 2;
+    DEVICE_ENTRY** buckets = (DEVICE_ENTRY**)calloc(bucket_count, sizeof(DEVICE_ENTRY*));
+    if (buckets == NULL)
+    {
+        LogError("unable to grow the device map to %lu buckets", (unsigned long)bucket_count);
+    }
+    else
+    {
+        DEVICE_ENTRY* entry;
+        for (entry = map->most_recent; entry != NULL; entry = entry->less_recent)
+        {
+            size_t index = entry->hash & (bucket_count - 1);
+            entry->next_in_bucket = buckets[index];
+            buckets[index] = entry;
+        }
+        free(map->buckets);
+        map->buckets = buckets;
+        map->bucket_count = bucket_count;
+    }
+}
+
+int IoTHubDeviceMap_ParseConfigurationFromJson(const JSON_Object* json, IOTHUB_DEVICE_MAP_CONFIG* config)
+{
+    int result;
+    /*Codes_SRS_IOTHUBMODULE_36_001: [ If json or config is NULL then IoTHubDeviceMap_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+    if (
+        (json == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg json=%p config=%p", json, config);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Value* devices = json_object_get_value(json, "devices");
+        JSON_Object* settings = json_value_get_object(devices);
+
+        /*Codes_SRS_IOTHUBMODULE_36_002: [ If there is no "devices" or it has no "max_clients" then IoTHubDeviceMap_ParseConfigurationFromJson shall set max_clients to 0 and succeed. ]*/
+        config->max_clients = 0;
+
+        if (devices == NULL)
+        {
+            result = 0;
+        }
+        /*Codes_SRS_IOTHUBMODULE_36_003: [ If "devices" is not an object then IoTHubDeviceMap_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        else if (settings == NULL)
+        {
+            LogError("\"devices\" must be an object");
+            result = __LINE__;
+        }
+        else
+        {
+            JSON_Value* max_clients = json_object_get_value(settings, "max_clients");
+            double number;
+            if (max_clients == NULL)
+            {
+                result = 0;
+            }
+            /*Codes_SRS_IOTHUBMODULE_36_004: [ If "max_clients" is not a whole number from 1 to IOTHUB_DEVICE_MAP_MAX_CLIENTS then IoTHubDeviceMap_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+            else if (
+                (json_value_get_type(max_clients) != JSONNumber) ||
+                ((number = json_value_get_number(max_clients)) < 1) ||
+                (number > IOTHUB_DEVICE_MAP_MAX_CLIENTS) ||
+                ((double)(size_t)number != number)
+                )
+            {
+                LogError("\"max_clients\" must be a whole number from 1 to %d", IOTHUB_DEVICE_MAP_MAX_CLIENTS);
+                result = __LINE__;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBMODULE_36_005: [ Otherwise IoTHubDeviceMap_ParseConfigurationFromJson shall set max_clients to the value of "max_clients" and succeed. ]*/
+                config->max_clients = (size_t)number;
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_DEVICE_MAP_HANDLE IoTHubDeviceMap_Create(void)
+{
+    IOTHUB_DEVICE_MAP* result = (IOTHUB_DEVICE_MAP*)malloc(sizeof(IOTHUB_DEVICE_MAP));
+    if (result == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_006: [ If any allocation fails then IoTHubDeviceMap_Create shall fail and return NULL. ]*/
+        LogError("unable to allocate a device map");
+    }
+    else if ((result->buckets = (DEVICE_ENTRY**)calloc(IOTHUB_DEVICE_MAP_MIN_BUCKETS, sizeof(DEVICE_ENTRY*))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_006: [ If any allocation fails then IoTHubDeviceMap_Create shall fail and return NULL. ]*/
+        LogError("unable to allocate the buckets of a device map");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_007: [ Otherwise IoTHubDeviceMap_Create shall return an empty map. ]*/
+        result->bucket_count = IOTHUB_DEVICE_MAP_MIN_BUCKETS;
+        result->count = 0;
+        result->most_recent = NULL;
+        result->least_recent = NULL;
+    }
+    return result;
+}
+
+void* IoTHubDeviceMap_Find(IOTHUB_DEVICE_MAP_HANDLE handle, const char* deviceName)
+{
+    void* result;
+    /*Codes_SRS_IOTHUBMODULE_36_008: [ If handle or deviceName is NULL then IoTHubDeviceMap_Find shall return NULL. ]*/
+    if (
+        (handle == NULL) ||
+        (deviceName == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p deviceName=%p", handle, deviceName);
+        result = NULL;
+    }
+    else
+    {
+        uint32_t hash = hash_device_name(deviceName);
+        DEVICE_ENTRY* entry = handle->buckets[hash & (handle->bucket_count - 1)];
+        while (
+            (entry != NULL) &&
+            ((entry->hash != hash) || (strcmp(entry->deviceName, deviceName) != 0))
+            )
+        {
+            entry = entry->next_in_bucket;
+        }
+
+        if (entry == NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_009: [ If deviceName is not in the map then IoTHubDeviceMap_Find shall return NULL. ]*/
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_010: [ Otherwise IoTHubDeviceMap_Find shall make deviceName the most recently used device and return its value. ]*/
+            if (entry != handle->most_recent)
+            {
+                unlink_recent(handle, entry);
+                link_most_recent(handle, entry);
+            }
+            result = entry->value;
+        }
+    }
+    return result;
+}
+
+int IoTHubDeviceMap_Add(IOTHUB_DEVICE_MAP_HANDLE handle, const char* deviceName, void* value)
+{
+    int result;
+    /*Codes_SRS_IOTHUBMODULE_36_011: [ If handle, deviceName or value is NULL then IoTHubDeviceMap_Add shall fail and return a non-zero value. ]*/
+    if (
+        (handle == NULL) ||
+        (deviceName == NULL) ||
+        (value == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p deviceName=%p value=%p", handle, deviceName, value);
+        result = __LINE__;
+    }
+    else
+    {
+        uint32_t hash = hash_device_name(deviceName);
+        size_t index = hash & (handle->bucket_count - 1);
+        size_t nameSize = strlen(deviceName) + 1;
+        DEVICE_ENTRY* entry = handle->buckets[index];
+        while (
+            (entry != NULL) &&
+            ((entry->hash != hash) || (strcmp(entry->deviceName, deviceName) != 0))
+            )
+        {
+            entry = entry->next_in_bucket;
+        }
+
+        if (entry != NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_012: [ If deviceName is already in the map then IoTHubDeviceMap_Add shall fail and return a non-zero value. ]*/
+            LogError("the device %s is already in the map", deviceName);
+            result = __LINE__;
+        }
+        else if ((entry = (DEVICE_ENTRY*)malloc(sizeof(DEVICE_ENTRY) + nameSize)) == NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_013: [ If any allocation fails then IoTHubDeviceMap_Add shall fail and return a non-zero value. ]*/
+            LogError("unable to allocate an entry for the device %s", deviceName);
+            result = __LINE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_014: [ Otherwise IoTHubDeviceMap_Add shall add a copy of deviceName with value as the most recently used device and return 0. ]*/
+            entry->deviceName = (char*)(entry + 1);
+            (void)memcpy(entry->deviceName, deviceName, nameSize);
+            entry->hash = hash;
+            entry->value = value;
+            entry->next_in_bucket = handle->buckets[index];
+            handle->buckets[index] = entry;
+            link_most_recent(handle, entry);
+            handle->count++;
+
+            /*Codes_SRS_IOTHUBMODULE_36_015: [ IoTHubDeviceMap_Add shall double the buckets when the map holds more devices than buckets. ]*/
+            if (handle->count > handle->bucket_count)
+            {
+                grow(handle);
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+size_t IoTHubDeviceMap_GetCount(IOTHUB_DEVICE_MAP_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUBMODULE_36_016: [ IoTHubDeviceMap_GetCount shall return the number of devices in the map, 0 if handle is NULL. ]*/
+    return (handle == NULL) ? 0 : handle->count;
+}
+
+void* IoTHubDeviceMap_RemoveLeastRecentlyUsed(IOTHUB_DEVICE_MAP_HANDLE handle)
+{
+    void* result;
+    /*Codes_SRS_IOTHUBMODULE_36_017: [ If handle is NULL or the map is empty then IoTHubDeviceMap_RemoveLeastRecentlyUsed shall return NULL. ]*/
+    if (
+        (handle == NULL) ||
+        (handle->least_recent == NULL)
+        )
+    {
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_018: [ Otherwise IoTHubDeviceMap_RemoveLeastRecentlyUsed shall take the least recently used device out of the map and return its value. ]*/
+        result = remove_entry(handle, handle->least_recent);
+    }
+    return result;
+}
+
+void* IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IOTHUB_DEVICE_MAP_HANDLE handle, IOTHUB_DEVICE_MAP_ACCEPT accept, void* context)
+{
+    void* result;
+    /*Codes_SRS_IOTHUBMODULE_36_028: [ If handle or accept is NULL then IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall return NULL. ]*/
+    if (
+        (handle == NULL) ||
+        (accept == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p accept=%p", handle, accept);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_029: [ Otherwise IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall call accept with context and the value of each device, from the least to the most recently used, until it returns true. ]*/
+        DEVICE_ENTRY* entry = handle->least_recent;
+        while (
+            (entry != NULL) &&
+            (!accept(context, entry->value))
+            )
+        {
+            entry = entry->more_recent;
+        }
+
+        if (entry == NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_030: [ If accept returns false for every device then IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall return NULL. ]*/
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMODULE_36_031: [ Otherwise IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall take that device out of the map and return its value. ]*/
+            result = remove_entry(handle, entry);
+        }
+    }
+    return result;
+}
+
+void IoTHubDeviceMap_ForEach(IOTHUB_DEVICE_MAP_HANDLE handle, IOTHUB_DEVICE_MAP_VISIT visit, void* context)
+{
+    /*Codes_SRS_IOTHUBMODULE_36_019: [ If handle or visit is NULL then IoTHubDeviceMap_ForEach shall do nothing. ]*/
+    if (
+        (handle == NULL) ||
+        (visit == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p visit=%p", handle, visit);
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_36_020: [ Otherwise IoTHubDeviceMap_ForEach shall call visit with context and the value of each device, from the most to the least recently used. ]*/
+        DEVICE_ENTRY* entry;
+        for (entry = handle->most_recent; entry != NULL; entry = entry->less_recent)
+        {
+            visit(context, entry->value);
+        }
+    }
+}
+
+void IoTHubDeviceMap_Destroy(IOTHUB_DEVICE_MAP_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUBMODULE_36_021: [ IoTHubDeviceMap_Destroy shall free the map and its entries but not their values, and do nothing if handle is NULL. ]*/
+    if (handle != NULL)
+    {
+        DEVICE_ENTRY* entry = handle->most_recent;
+        while (entry != NULL)
+        {
+            DEVICE_ENTRY* next = entry->less_recent;
+            free(entry);
+            entry = next;
+        }
+        free(handle->buckets);
+        free(handle);
+    }
+}
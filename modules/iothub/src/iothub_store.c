@@ -0,0 +1,1333 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "iothub_store.h"
+#include "module_thread.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/crt_abstractions.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/condition.h>
+#include <azure_c_shared_utility/threadapi.h>
+#include <azure_c_shared_utility/tickcounter.h>
+
+/*
+ * The store is a series of append only segments, "<path>.1", "<path>.2" and
+ * so on, each starting with a small header and holding records of
+ *
+ *     uint32 payload size | uint32 CRC-32 of the payload | payload
+ *
+ * (big endian). "<path>.checkpoint" holds the segment and offset of the
+ * first record that was not confirmed yet; it is replaced, never rewritten
+ * in place. A record torn by a crash fails its CRC and ends its segment, so
+ * a restart always appends to a new segment.
+ *
+ * Only IoTHubStore_Append writes the segments and only the forwarder thread
+ * reads them and writes the checkpoint. The lock guards the write position,
+ * the window of records in flight and the counters.
+ */
+
+#define IOTHUB_STORE_SEGMENT_HEADER_SIZE 8
+#define IOTHUB_STORE_RECORD_HEADER_SIZE 8
+#define IOTHUB_STORE_CHECKPOINT_SIZE 16
+#define IOTHUB_STORE_VERSION 1
+#define IOTHUB_STORE_CHECKPOINT_SUFFIX ".checkpoint"
+#define IOTHUB_STORE_CHECKPOINT_TEMP_SUFFIX ".checkpoint.tmp"
+/*room for the longest suffix, a segment number or a checkpoint suffix*/
+#define IOTHUB_STORE_NAME_SUFFIX_SIZE 24
+
+#define IOTHUB_STORE_MAX_STORE_BYTES ((uint64_t)1 << 50)
+#define IOTHUB_STORE_MIN_SEGMENT_BYTES 4096
+#define IOTHUB_STORE_MAX_SEGMENT_BYTES 0x7FFFFFFFL
+#define IOTHUB_STORE_MAX_MESSAGES_PER_SECOND 1000000
+#define IOTHUB_STORE_MAX_IN_FLIGHT 10000
+#define IOTHUB_STORE_MAX_INTERVAL_MS (60 * 60 * 1000)
+#define IOTHUB_STORE_MAX_METRICS_INTERVAL_S (24 * 60 * 60)
+
+static const unsigned char segment_magic[4] = { 'G', 'W', 'S', 'F' };
+static const unsigned char checkpoint_magic[4] = { 'G', 'W', 'S', 'C' };
+
+/*CRC-32 (IEEE 802.3) a nibble at a time*/
+static const uint32_t crc_table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+typedef struct IOTHUB_STORE_POSITION_TAG
+{
+    uint32_t segment;
+    uint32_t offset;
+} IOTHUB_STORE_POSITION;
+
+typedef enum IOTHUB_STORE_SLOT_STATE_TAG
+{
+    IOTHUB_STORE_SLOT_SENDING,
+    IOTHUB_STORE_SLOT_DELIVERED,
+    IOTHUB_STORE_SLOT_DISCARDED,
+    IOTHUB_STORE_SLOT_FAILED
+} IOTHUB_STORE_SLOT_STATE;
+
+typedef struct IOTHUB_STORE_SLOT_TAG
+{
+    /*where the record after this one starts*/
+    IOTHUB_STORE_POSITION end;
+    size_t bytes;
+    IOTHUB_STORE_SLOT_STATE state;
+} IOTHUB_STORE_SLOT;
+
+typedef struct IOTHUB_STORE_TAG
+{
+    IOTHUB_STORE_SEND send;
+    void* send_context;
+    uint64_t max_bytes;
+    size_t segment_bytes;
+    double messages_per_second;
+    size_t max_in_flight;
+    size_t sync_interval_ms;
+    size_t retry_interval_ms;
+    size_t metrics_interval_s;
+    char* path;
+    LOCK_HANDLE lock;
+    COND_HANDLE wake;
+    THREAD_HANDLE thread;
+    TICK_COUNTER_HANDLE tick_counter;
+    /*guarded by lock*/
+    FILE* write_file;
+    char* write_name;
+    IOTHUB_STORE_POSITION write;
+    bool write_failed;
+    bool unsynced;
+    bool full;
+    /*the end of the oldest records that are all confirmed*/
+    IOTHUB_STORE_POSITION confirmed;
+    bool checkpoint_dirty;
+    IOTHUB_STORE_SLOT* slots;
+    /*the oldest record in flight that is not confirmed, and the next one to read*/
+    uint64_t first_sequence;
+    uint64_t next_sequence;
+    size_t outstanding;
+    bool failed_pending;
+    bool forwarder_waiting;
+    bool stopping;
+    IOTHUB_STORE_METRICS metrics;
+    /*from here on only touched by the forwarder thread (and by Create and Destroy when it is not running)*/
+    FILE* read_file;
+    uint32_t read_file_segment;
+    char* read_name;
+    IOTHUB_STORE_POSITION read;
+    uint32_t first_segment;
+    unsigned char* read_buffer;
+    size_t read_buffer_capacity;
+} IOTHUB_STORE;
+
+static uint32_t crc32_of(const unsigned char* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    size_t i;
+    for (i = 0; i < size; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_table[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void put_uint32(unsigned char* destination, uint32_t value)
+{
+    destination[0] = (unsigned char)(value >> 24);
+    destination[1] = (unsigned char)(value >> 16);
+    destination[2] = (unsigned char)(value >> 8);
+    destination[3] = (unsigned char)value;
+}
+
+static uint32_t get_uint32(const unsigned char* source)
+{
+    return ((uint32_t)source[0] << 24) | ((uint32_t)source[1] << 16) | ((uint32_t)source[2] << 8) | (uint32_t)source[3];
+}
+
+static int compare_positions(IOTHUB_STORE_POSITION left, IOTHUB_STORE_POSITION right)
+{
+    int result;
+    if (left.segment != right.segment)
+    {
+        result = (left.segment < right.segment) ? -1 : 1;
+    }
+    else if (left.offset != right.offset)
+    {
+        result = (left.offset < right.offset) ? -1 : 1;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+static void segment_name(char* destination, const char* path, uint32_t segment)
+{
+    (void)sprintf(destination, "%s.%lu", path, (unsigned long)segment);
+}
+
+static int sync_file(FILE* f)
+{
+    int result;
+    if (fflush(f) != 0)
+    {
+        result = __LINE__;
+    }
+#ifdef _WIN32
+    else if (_commit(_fileno(f)) != 0)
+#else
+    else if (fsync(fileno(f)) != 0)
+#endif
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+static int replace_file(const char* from, const char* to)
+{
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) ? 0 : __LINE__;
+#else
+    return rename(from, to);
+#endif
+}
+
+static int read_size(const JSON_Value* value, size_t minimum, size_t maximum, size_t* result_value)
+{
+    int result;
+    double number;
+    if (json_value_get_type(value) != JSONNumber)
+    {
+        result = __LINE__;
+    }
+    else if (
+        ((number = json_value_get_number(value)) < (double)minimum) ||
+        (number > (double)maximum) ||
+        ((double)(size_t)number != number)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *result_value = (size_t)number;
+        result = 0;
+    }
+    return result;
+}
+
+static int read_bytes(const JSON_Value* value, uint64_t* result_value)
+{
+    int result;
+    double number;
+    if (json_value_get_type(value) != JSONNumber)
+    {
+        result = __LINE__;
+    }
+    else if (
+        ((number = json_value_get_number(value)) < 1) ||
+        (number > (double)IOTHUB_STORE_MAX_STORE_BYTES) ||
+        ((double)(uint64_t)number != number)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *result_value = (uint64_t)number;
+        result = 0;
+    }
+    return result;
+}
+
+int IoTHubStore_ParseConfigurationFromJson(const JSON_Object* json, IOTHUB_STORE_CONFIG* config)
+{
+    int result;
+    /*Codes_SRS_IOTHUBMODULE_34_001: [ If json or config is NULL then IoTHubStore_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+    if (
+        (json == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg json=%p config=%p", json, config);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Value* store = json_object_get_value(json, "store");
+        JSON_Object* settings = json_value_get_object(store);
+
+        /*Codes_SRS_IOTHUBMODULE_34_002: [ Values that are not present shall default to max_bytes IOTHUB_STORE_DEFAULT_MAX_BYTES, segment_bytes IOTHUB_STORE_DEFAULT_SEGMENT_BYTES, no rate limit, max_in_flight IOTHUB_STORE_DEFAULT_MAX_IN_FLIGHT, sync_interval_ms IOTHUB_STORE_DEFAULT_SYNC_INTERVAL_MS, retry_interval_ms IOTHUB_STORE_DEFAULT_RETRY_INTERVAL_MS and no metrics report. ]*/
+        uint64_t max_bytes = IOTHUB_STORE_DEFAULT_MAX_BYTES;
+        config->enabled = false;
+        config->path = NULL;
+        config->segment_bytes = IOTHUB_STORE_DEFAULT_SEGMENT_BYTES;
+        config->messages_per_second = 0;
+        config->max_in_flight = IOTHUB_STORE_DEFAULT_MAX_IN_FLIGHT;
+        config->sync_interval_ms = IOTHUB_STORE_DEFAULT_SYNC_INTERVAL_MS;
+        config->retry_interval_ms = IOTHUB_STORE_DEFAULT_RETRY_INTERVAL_MS;
+        config->metrics_interval_s = 0;
+
+        if (store == NULL)
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_003: [ If there is no "store" then IoTHubStore_ParseConfigurationFromJson shall set enabled to false and succeed. ]*/
+            config->max_bytes = (size_t)max_bytes;
+            result = 0;
+        }
+        /*Codes_SRS_IOTHUBMODULE_34_004: [ If "store" is not an object or has no "path" string then IoTHubStore_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        else if (settings == NULL)
+        {
+            LogError("\"store\" must be an object");
+            result = __LINE__;
+        }
+        else
+        {
+            const char* path = json_object_get_string(settings, "path");
+            JSON_Value* max_bytes_value = json_object_get_value(settings, "max_bytes");
+            JSON_Value* segment_bytes = json_object_get_value(settings, "segment_bytes");
+            JSON_Value* rate = json_object_get_value(settings, "messages_per_second");
+            JSON_Value* max_in_flight = json_object_get_value(settings, "max_in_flight");
+            JSON_Value* sync_interval = json_object_get_value(settings, "sync_interval_ms");
+            JSON_Value* retry_interval = json_object_get_value(settings, "retry_interval_ms");
+            JSON_Value* metrics_interval = json_object_get_value(settings, "metrics_interval_s");
+
+            if (path == NULL)
+            {
+                LogError("\"store\" needs a \"path\" string");
+                result = __LINE__;
+            }
+            /*Codes_SRS_IOTHUBMODULE_34_005: [ If a value of "store" is present and is not a number in range then IoTHubStore_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+            else if (
+                (max_bytes_value != NULL) &&
+                (read_bytes(max_bytes_value, &max_bytes) != 0)
+                )
+            {
+                LogError("\"max_bytes\" must be a whole number from 1 to 2^50");
+                result = __LINE__;
+            }
+            else if (
+                (segment_bytes != NULL) &&
+                (read_size(segment_bytes, IOTHUB_STORE_MIN_SEGMENT_BYTES, IOTHUB_STORE_MAX_SEGMENT_BYTES, &config->segment_bytes) != 0)
+                )
+            {
+                LogError("\"segment_bytes\" must be a whole number from %d to %ld", IOTHUB_STORE_MIN_SEGMENT_BYTES, (long)IOTHUB_STORE_MAX_SEGMENT_BYTES);
+                result = __LINE__;
+            }
+            else if (
+                (rate != NULL) &&
+                (
+                    (json_value_get_type(rate) != JSONNumber) ||
+                    ((config->messages_per_second = json_value_get_number(rate)) < 0) ||
+                    (config->messages_per_second > IOTHUB_STORE_MAX_MESSAGES_PER_SECOND)
+                )
+                )
+            {
+                LogError("\"messages_per_second\" must be a number from 0 to %d", IOTHUB_STORE_MAX_MESSAGES_PER_SECOND);
+                result = __LINE__;
+            }
+            else if (
+                (max_in_flight != NULL) &&
+                (read_size(max_in_flight, 1, IOTHUB_STORE_MAX_IN_FLIGHT, &config->max_in_flight) != 0)
+                )
+            {
+                LogError("\"max_in_flight\" must be a whole number from 1 to %d", IOTHUB_STORE_MAX_IN_FLIGHT);
+                result = __LINE__;
+            }
+            else if (
+                ((sync_interval != NULL) && (read_size(sync_interval, 1, IOTHUB_STORE_MAX_INTERVAL_MS, &config->sync_interval_ms) != 0)) ||
+                ((retry_interval != NULL) && (read_size(retry_interval, 1, IOTHUB_STORE_MAX_INTERVAL_MS, &config->retry_interval_ms) != 0))
+                )
+            {
+                LogError("\"sync_interval_ms\" and \"retry_interval_ms\" must be whole numbers from 1 to %d", IOTHUB_STORE_MAX_INTERVAL_MS);
+                result = __LINE__;
+            }
+            else if (
+                (metrics_interval != NULL) &&
+                (read_size(metrics_interval, 0, IOTHUB_STORE_MAX_METRICS_INTERVAL_S, &config->metrics_interval_s) != 0)
+                )
+            {
+                LogError("\"metrics_interval_s\" must be a whole number from 0 to %d", IOTHUB_STORE_MAX_METRICS_INTERVAL_S);
+                result = __LINE__;
+            }
+            else if ((size_t)max_bytes != max_bytes)
+            {
+                LogError("\"max_bytes\" is too large for this platform");
+                result = __LINE__;
+            }
+            else if (mallocAndStrcpy_s(&config->path, path) != 0)
+            {
+                LogError("unable to copy the store path");
+                result = __LINE__;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBMODULE_34_006: [ Otherwise IoTHubStore_ParseConfigurationFromJson shall set enabled to true and copy "path". ]*/
+                config->max_bytes = (size_t)max_bytes;
+                config->enabled = true;
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+static int write_segment_header(FILE* f)
+{
+    unsigned char header[IOTHUB_STORE_SEGMENT_HEADER_SIZE];
+    (void)memcpy(header, segment_magic, sizeof(segment_magic));
+    header[4] = IOTHUB_STORE_VERSION;
+    header[5] = 0;
+    header[6] = 0;
+    header[7] = 0;
+    return ((fwrite(header, 1, sizeof(header), f) == sizeof(header)) && (fflush(f) == 0)) ? 0 : __LINE__;
+}
+
+static bool read_segment_header(FILE* f)
+{
+    unsigned char header[IOTHUB_STORE_SEGMENT_HEADER_SIZE];
+    return
+        (fseek(f, 0, SEEK_SET) == 0) &&
+        (fread(header, 1, sizeof(header), f) == sizeof(header)) &&
+        (memcmp(header, segment_magic, sizeof(segment_magic)) == 0) &&
+        (header[4] == IOTHUB_STORE_VERSION);
+}
+
+static int reserve_read_buffer(IOTHUB_STORE* store, size_t size)
+{
+    int result;
+    if (size <= store->read_buffer_capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        unsigned char* grown = (unsigned char*)realloc(store->read_buffer, size);
+        if (grown == NULL)
+        {
+            LogError("unable to allocate %lu bytes to read a record", (unsigned long)size);
+            result = __LINE__;
+        }
+        else
+        {
+            store->read_buffer = grown;
+            store->read_buffer_capacity = size;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+/*reads the record at offset into read_buffer, fails if it is cut short or its CRC does not match*/
+static int read_record_at(IOTHUB_STORE* store, FILE* f, uint32_t offset, size_t* size)
+{
+    int result;
+    unsigned char header[IOTHUB_STORE_RECORD_HEADER_SIZE];
+    uint32_t payload_size;
+    if (
+        (fseek(f, (long)offset, SEEK_SET) != 0) ||
+        (fread(header, 1, sizeof(header), f) != sizeof(header))
+        )
+    {
+        result = __LINE__;
+    }
+    else if ((payload_size = get_uint32(header)) > (uint32_t)IOTHUB_STORE_MAX_SEGMENT_BYTES - offset - IOTHUB_STORE_RECORD_HEADER_SIZE)
+    {
+        result = __LINE__;
+    }
+    else if (
+        (reserve_read_buffer(store, payload_size == 0 ? 1 : payload_size) != 0) ||
+        (fread(store->read_buffer, 1, payload_size, f) != payload_size) ||
+        (crc32_of(store->read_buffer, payload_size) != get_uint32(header + 4))
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *size = payload_size;
+        result = 0;
+    }
+    return result;
+}
+
+static int load_checkpoint(const char* file_name, IOTHUB_STORE_POSITION* position)
+{
+    int result;
+    FILE* f = fopen(file_name, "rb");
+    if (f == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        unsigned char checkpoint[IOTHUB_STORE_CHECKPOINT_SIZE];
+        if (
+            (fread(checkpoint, 1, sizeof(checkpoint), f) != sizeof(checkpoint)) ||
+            (memcmp(checkpoint, checkpoint_magic, sizeof(checkpoint_magic)) != 0) ||
+            (crc32_of(checkpoint, 12) != get_uint32(checkpoint + 12)) ||
+            (get_uint32(checkpoint + 4) == 0)
+            )
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            position->segment = get_uint32(checkpoint + 4);
+            position->offset = get_uint32(checkpoint + 8);
+            result = 0;
+        }
+        (void)fclose(f);
+    }
+    return result;
+}
+
+static void checkpoint_name(char* destination, const char* path, const char* suffix)
+{
+    (void)strcpy(destination, path);
+    (void)strcat(destination, suffix);
+}
+
+/*writes the checkpoint next to the current one and then replaces it, so a crash leaves one of the two*/
+static int save_checkpoint(IOTHUB_STORE* store, IOTHUB_STORE_POSITION position)
+{
+    int result;
+    unsigned char checkpoint[IOTHUB_STORE_CHECKPOINT_SIZE];
+    char* final_name = store->read_name + strlen(store->path) + IOTHUB_STORE_NAME_SUFFIX_SIZE;
+    FILE* f;
+
+    (void)memcpy(checkpoint, checkpoint_magic, sizeof(checkpoint_magic));
+    put_uint32(checkpoint + 4, position.segment);
+    put_uint32(checkpoint + 8, position.offset);
+    put_uint32(checkpoint + 12, crc32_of(checkpoint, 12));
+
+    checkpoint_name(store->read_name, store->path, IOTHUB_STORE_CHECKPOINT_TEMP_SUFFIX);
+    checkpoint_name(final_name, store->path, IOTHUB_STORE_CHECKPOINT_SUFFIX);
+    if ((f = fopen(store->read_name, "wb")) == NULL)
+    {
+        LogError("unable to create %s", store->read_name);
+        result = __LINE__;
+    }
+    else
+    {
+        bool written =
+            (fwrite(checkpoint, 1, sizeof(checkpoint), f) == sizeof(checkpoint)) &&
+            (sync_file(f) == 0);
+        (void)fclose(f);
+        if (!written)
+        {
+            LogError("unable to write %s", store->read_name);
+            result = __LINE__;
+        }
+        else if (replace_file(store->read_name, final_name) != 0)
+        {
+            LogError("unable to replace %s", final_name);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+/*removes the segments that only hold confirmed records*/
+static void remove_confirmed_segments(IOTHUB_STORE* store, uint32_t confirmed_segment)
+{
+    while (store->first_segment < confirmed_segment)
+    {
+        if (store->read_file_segment == store->first_segment)
+        {
+            (void)fclose(store->read_file);
+            store->read_file = NULL;
+            store->read_file_segment = 0;
+        }
+        segment_name(store->read_name, store->path, store->first_segment);
+        if (remove(store->read_name) != 0)
+        {
+            LogError("unable to remove %s", store->read_name);
+        }
+        store->first_segment++;
+    }
+}
+
+/*
+ * picks up an earlier run: removes the segments its last checkpoint made
+ * obsolete, counts the unconfirmed records of the others and starts a new
+ * segment after them
+ */
+static int recover(IOTHUB_STORE* store)
+{
+    int result;
+    IOTHUB_STORE_POSITION start;
+    uint32_t segment;
+    bool found = false;
+
+    /*Codes_SRS_IOTHUBMODULE_34_009: [ IoTHubStore_Create shall resume from the position saved in "<path>.checkpoint", or from the first segment if there is none. ]*/
+    checkpoint_name(store->read_name, store->path, IOTHUB_STORE_CHECKPOINT_SUFFIX);
+    if (load_checkpoint(store->read_name, &start) != 0)
+    {
+        /*a crash between writing the new checkpoint and replacing the old one leaves only the new one*/
+        checkpoint_name(store->read_name, store->path, IOTHUB_STORE_CHECKPOINT_TEMP_SUFFIX);
+        if (load_checkpoint(store->read_name, &start) != 0)
+        {
+            start.segment = 1;
+            start.offset = 0;
+        }
+    }
+    if (start.offset < IOTHUB_STORE_SEGMENT_HEADER_SIZE)
+    {
+        start.offset = IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+    }
+
+    /*segments before the checkpoint are left behind when a run stops between saving it and removing them*/
+    for (segment = start.segment - 1; segment > 0; segment--)
+    {
+        segment_name(store->read_name, store->path, segment);
+        if (remove(store->read_name) != 0)
+        {
+            break;
+        }
+    }
+
+    /*Codes_SRS_IOTHUBMODULE_34_010: [ IoTHubStore_Create shall count the records left in the segments from the saved position on, each segment ending at its first record that is cut short or fails its CRC. ]*/
+    for (segment = start.segment; ; segment++)
+    {
+        FILE* f;
+        segment_name(store->read_name, store->path, segment);
+        if ((f = fopen(store->read_name, "rb")) == NULL)
+        {
+            break;
+        }
+        else
+        {
+            found = true;
+            if (!read_segment_header(f))
+            {
+                LogError("%s is not a store segment, it is skipped", store->read_name);
+            }
+            else
+            {
+                uint32_t offset = (segment == start.segment) ? start.offset : IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+                size_t size;
+                while (read_record_at(store, f, offset, &size) == 0)
+                {
+                    store->metrics.queued_messages++;
+                    store->metrics.queued_bytes += IOTHUB_STORE_RECORD_HEADER_SIZE + size;
+                    offset += (uint32_t)(IOTHUB_STORE_RECORD_HEADER_SIZE + size);
+                }
+            }
+            (void)fclose(f);
+        }
+    }
+
+    /*Codes_SRS_IOTHUBMODULE_34_011: [ IoTHubStore_Create shall append to a new segment after the existing ones. ]*/
+    store->write.segment = found ? segment : start.segment;
+    store->write.offset = IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+    if (!found)
+    {
+        start.segment = store->write.segment;
+        start.offset = IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+    }
+    store->read = start;
+    store->confirmed = start;
+    store->first_segment = start.segment;
+
+    segment_name(store->write_name, store->path, store->write.segment);
+    if ((store->write_file = fopen(store->write_name, "wb")) == NULL)
+    {
+        LogError("unable to create %s", store->write_name);
+        result = __LINE__;
+    }
+    else if (write_segment_header(store->write_file) != 0)
+    {
+        LogError("unable to write %s", store->write_name);
+        result = __LINE__;
+    }
+    else
+    {
+        if (store->metrics.queued_messages > 0)
+        {
+            LogInfo("store %s: %lu messages from an earlier run are queued", store->path, (unsigned long)store->metrics.queued_messages);
+        }
+        result = 0;
+    }
+    return result;
+}
+
+/*starts the next segment, with the lock held*/
+static int roll_segment(IOTHUB_STORE* store)
+{
+    int result;
+    if (store->write_file != NULL)
+    {
+        if (sync_file(store->write_file) != 0)
+        {
+            LogError("unable to sync %s", store->write_name);
+        }
+        (void)fclose(store->write_file);
+        store->write_file = NULL;
+    }
+    store->write.segment++;
+    store->write.offset = IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+    store->unsynced = false;
+    segment_name(store->write_name, store->path, store->write.segment);
+    if ((store->write_file = fopen(store->write_name, "wb")) == NULL)
+    {
+        LogError("unable to create %s", store->write_name);
+        result = __LINE__;
+    }
+    else if (write_segment_header(store->write_file) != 0)
+    {
+        LogError("unable to write %s", store->write_name);
+        (void)fclose(store->write_file);
+        store->write_file = NULL;
+        result = __LINE__;
+    }
+    else
+    {
+        store->write_failed = false;
+        result = 0;
+    }
+    return result;
+}
+
+/*returns 0 and the next record in read_buffer, or non-zero if there is none before limit*/
+static int next_record(IOTHUB_STORE* store, IOTHUB_STORE_POSITION limit, size_t* size)
+{
+    int result = __LINE__;
+    bool done = false;
+    while (!done)
+    {
+        if (compare_positions(store->read, limit) >= 0)
+        {
+            done = true;
+        }
+        else
+        {
+            bool skip_segment = false;
+            if (store->read_file_segment != store->read.segment)
+            {
+                if (store->read_file != NULL)
+                {
+                    (void)fclose(store->read_file);
+                    store->read_file_segment = 0;
+                }
+                segment_name(store->read_name, store->path, store->read.segment);
+                if ((store->read_file = fopen(store->read_name, "rb")) == NULL)
+                {
+                    LogError("unable to open %s", store->read_name);
+                    skip_segment = true;
+                }
+                else if (!read_segment_header(store->read_file))
+                {
+                    LogError("%s is not a store segment, it is skipped", store->read_name);
+                    skip_segment = true;
+                }
+                else
+                {
+                    store->read_file_segment = store->read.segment;
+                }
+            }
+
+            if (!skip_segment)
+            {
+                if (store->read.offset < IOTHUB_STORE_SEGMENT_HEADER_SIZE)
+                {
+                    store->read.offset = IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+                }
+                if (read_record_at(store, store->read_file, store->read.offset, size) == 0)
+                {
+                    store->read.offset += (uint32_t)(IOTHUB_STORE_RECORD_HEADER_SIZE + *size);
+                    result = 0;
+                    done = true;
+                }
+                else if (store->read.segment == limit.segment)
+                {
+                    /*the segment being appended to ends at limit*/
+                    done = true;
+                }
+                else
+                {
+                    /*the end of a segment, or the rest of it was lost*/
+                    skip_segment = true;
+                }
+            }
+
+            if (skip_segment)
+            {
+                store->read.segment++;
+                store->read.offset = IOTHUB_STORE_SEGMENT_HEADER_SIZE;
+            }
+        }
+    }
+    return result;
+}
+
+/*records the outcome of a send with the lock held*/
+static void resolve_locked(IOTHUB_STORE* store, uint64_t sequence, IOTHUB_STORE_SLOT_STATE state)
+{
+    IOTHUB_STORE_SLOT* slot;
+    if (
+        (sequence < store->first_sequence) ||
+        (sequence >= store->next_sequence) ||
+        ((slot = &store->slots[sequence % store->max_in_flight])->state != IOTHUB_STORE_SLOT_SENDING)
+        )
+    {
+        LogError("no record %llu is in flight", (unsigned long long)sequence);
+    }
+    else
+    {
+        slot->state = state;
+        store->outstanding--;
+        if (state == IOTHUB_STORE_SLOT_FAILED)
+        {
+            store->failed_pending = true;
+            store->metrics.failed++;
+        }
+
+        /*Codes_SRS_IOTHUBMODULE_34_018: [ A record shall be removed from the store only once it and every record before it is delivered or discarded. ]*/
+        while (store->first_sequence < store->next_sequence)
+        {
+            slot = &store->slots[store->first_sequence % store->max_in_flight];
+            if (slot->state == IOTHUB_STORE_SLOT_DELIVERED)
+            {
+                store->metrics.delivered++;
+            }
+            else if (slot->state == IOTHUB_STORE_SLOT_DISCARDED)
+            {
+                store->metrics.discarded++;
+            }
+            else
+            {
+                break;
+            }
+            store->confirmed = slot->end;
+            store->checkpoint_dirty = true;
+            store->metrics.queued_messages--;
+            store->metrics.queued_bytes -= slot->bytes;
+            store->first_sequence++;
+        }
+        (void)Condition_Post(store->wake);
+    }
+}
+
+static void report_metrics(IOTHUB_STORE* store)
+{
+    IOTHUB_STORE_METRICS metrics;
+    if (IoTHubStore_GetMetrics(store, &metrics) == 0)
+    {
+        LogInfo("store %s: %lu messages (%llu bytes) queued, %lu in flight, %llu delivered, %llu dropped, %llu failed sends",
+            store->path,
+            (unsigned long)metrics.queued_messages,
+            (unsigned long long)metrics.queued_bytes,
+            (unsigned long)metrics.in_flight,
+            (unsigned long long)metrics.delivered,
+            (unsigned long long)metrics.dropped,
+            (unsigned long long)metrics.failed);
+    }
+}
+
+static tickcounter_ms_t ms_until(tickcounter_ms_t now, tickcounter_ms_t due)
+{
+    return (due > now) ? due - now : 0;
+}
+
+static int forwarder_thread(void* context)
+{
+    IOTHUB_STORE* store = (IOTHUB_STORE*)context;
+    tickcounter_ms_t now = 0;
+    tickcounter_ms_t sync_due_ms;
+    tickcounter_ms_t metrics_due_ms;
+    tickcounter_ms_t retry_due_ms = 0;
+    double send_due_ms = 0;
+    bool stopping = false;
+
+    (void)tickcounter_get_current_ms(store->tick_counter, &now);
+    sync_due_ms = now + store->sync_interval_ms;
+    metrics_due_ms = now + store->metrics_interval_s * 1000;
+
+    while (!stopping)
+    {
+        IOTHUB_STORE_POSITION limit;
+        IOTHUB_STORE_POSITION checkpoint;
+        bool save = false;
+        bool window_open = false;
+
+        if (tickcounter_get_current_ms(store->tick_counter, &now) != 0)
+        {
+            LogError("unable to get the current time");
+        }
+
+        if (Lock(store->lock) != LOCK_OK)
+        {
+            LogError("unable to lock");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_019: [ Once every send in flight has completed after a failed one, the forwarder thread shall wait retry_interval_ms and send again from the oldest record that is not confirmed. ]*/
+            if (
+                store->failed_pending &&
+                (store->outstanding == 0)
+                )
+            {
+                store->failed_pending = false;
+                store->next_sequence = store->first_sequence;
+                store->read = store->confirmed;
+                retry_due_ms = now + store->retry_interval_ms;
+            }
+
+            /*Codes_SRS_IOTHUBMODULE_34_020: [ Every sync_interval_ms the forwarder thread shall sync the segment being appended to and save the position of the oldest record that is not confirmed. ]*/
+            if (now >= sync_due_ms)
+            {
+                if (
+                    store->unsynced &&
+                    (store->write_file != NULL)
+                    )
+                {
+                    if (sync_file(store->write_file) != 0)
+                    {
+                        LogError("unable to sync %s", store->write_name);
+                    }
+                    store->unsynced = false;
+                }
+                save = store->checkpoint_dirty;
+                store->checkpoint_dirty = false;
+                checkpoint = store->confirmed;
+                sync_due_ms = now + store->sync_interval_ms;
+            }
+
+            stopping = store->stopping;
+            limit = store->write;
+            window_open =
+                !store->failed_pending &&
+                (now >= retry_due_ms) &&
+                (store->next_sequence - store->first_sequence < store->max_in_flight);
+            (void)Unlock(store->lock);
+        }
+
+        if (save)
+        {
+            if (save_checkpoint(store, checkpoint) == 0)
+            {
+                remove_confirmed_segments(store, checkpoint.segment);
+            }
+        }
+
+        /*Codes_SRS_IOTHUBMODULE_34_022: [ If metrics_interval_s is not 0, the forwarder thread shall log the queue depth every metrics_interval_s seconds. ]*/
+        if (
+            (store->metrics_interval_s != 0) &&
+            (now >= metrics_due_ms)
+            )
+        {
+            report_metrics(store);
+            metrics_due_ms = now + store->metrics_interval_s * 1000;
+        }
+
+        if (!stopping)
+        {
+            size_t size;
+            /*Codes_SRS_IOTHUBMODULE_34_021: [ If messages_per_second is not 0, the forwarder thread shall not send faster than messages_per_second on average. ]*/
+            bool send_due = (store->messages_per_second == 0) || ((double)now >= send_due_ms);
+            bool sent = false;
+
+            /*Codes_SRS_IOTHUBMODULE_34_016: [ The forwarder thread shall pass the stored records to send oldest first, with no more than max_in_flight of them not completed. ]*/
+            if (
+                window_open &&
+                send_due &&
+                (next_record(store, limit, &size) == 0)
+                )
+            {
+                uint64_t sequence = 0;
+                IOTHUB_STORE_SEND_RESULT send_result;
+                if (Lock(store->lock) != LOCK_OK)
+                {
+                    LogError("unable to lock");
+                }
+                else
+                {
+                    IOTHUB_STORE_SLOT* slot;
+                    sequence = store->next_sequence++;
+                    slot = &store->slots[sequence % store->max_in_flight];
+                    slot->end = store->read;
+                    slot->bytes = IOTHUB_STORE_RECORD_HEADER_SIZE + size;
+                    slot->state = IOTHUB_STORE_SLOT_SENDING;
+                    store->outstanding++;
+                    (void)Unlock(store->lock);
+                }
+
+                send_result = store->send(store->send_context, store, store->read_buffer, size, sequence);
+                if (send_result != IOTHUB_STORE_SEND_ACCEPTED)
+                {
+                    if (Lock(store->lock) != LOCK_OK)
+                    {
+                        LogError("unable to lock");
+                    }
+                    else
+                    {
+                        /*Codes_SRS_IOTHUBMODULE_34_017: [ If send returns IOTHUB_STORE_SEND_DISCARD the record shall be removed from the store, if it returns IOTHUB_STORE_SEND_RETRY it shall be sent again. ]*/
+                        resolve_locked(store, sequence, (send_result == IOTHUB_STORE_SEND_DISCARD) ? IOTHUB_STORE_SLOT_DISCARDED : IOTHUB_STORE_SLOT_FAILED);
+                        (void)Unlock(store->lock);
+                    }
+                }
+
+                if (store->messages_per_second != 0)
+                {
+                    send_due_ms = ((send_due_ms > (double)now) ? send_due_ms : (double)now) + 1000.0 / store->messages_per_second;
+                }
+                sent = true;
+            }
+
+            if (!sent)
+            {
+                if (Lock(store->lock) != LOCK_OK)
+                {
+                    LogError("unable to lock");
+                }
+                else
+                {
+                    bool record_waiting = compare_positions(store->read, store->write) < 0;
+                    bool can_send =
+                        !store->failed_pending &&
+                        (store->next_sequence - store->first_sequence < store->max_in_flight);
+                    if (
+                        !store->stopping &&
+                        !(store->failed_pending && (store->outstanding == 0)) &&
+                        !(record_waiting && can_send && send_due && (now >= retry_due_ms))
+                        )
+                    {
+                        tickcounter_ms_t timeout_ms = ms_until(now, sync_due_ms);
+                        if (
+                            record_waiting &&
+                            can_send
+                            )
+                        {
+                            tickcounter_ms_t until_send = (now < retry_due_ms) ? ms_until(now, retry_due_ms) : (tickcounter_ms_t)(send_due_ms - (double)now);
+                            timeout_ms = (until_send < timeout_ms) ? until_send : timeout_ms;
+                        }
+                        if (
+                            (store->metrics_interval_s != 0) &&
+                            (ms_until(now, metrics_due_ms) < timeout_ms)
+                            )
+                        {
+                            timeout_ms = ms_until(now, metrics_due_ms);
+                        }
+                        store->forwarder_waiting = true;
+                        (void)Condition_Wait(store->wake, store->lock, (timeout_ms == 0) ? 1 : (int)timeout_ms);
+                        store->forwarder_waiting = false;
+                    }
+                    (void)Unlock(store->lock);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static void free_store(IOTHUB_STORE* store)
+{
+    if (store->write_file != NULL)
+    {
+        (void)fclose(store->write_file);
+    }
+    if (store->read_file != NULL)
+    {
+        (void)fclose(store->read_file);
+    }
+    if (store->tick_counter != NULL)
+    {
+        tickcounter_destroy(store->tick_counter);
+    }
+    if (store->wake != NULL)
+    {
+        Condition_Deinit(store->wake);
+    }
+    if (store->lock != NULL)
+    {
+        (void)Lock_Deinit(store->lock);
+    }
+    free(store->read_buffer);
+    free(store->slots);
+    free(store->read_name);
+    free(store->write_name);
+    free(store->path);
+    free(store);
+}
+
+IOTHUB_STORE_HANDLE IoTHubStore_Create(const IOTHUB_STORE_CONFIG* config, IOTHUB_STORE_SEND send, void* send_context)
+{
+    IOTHUB_STORE* result;
+    /*Codes_SRS_IOTHUBMODULE_34_007: [ If config, config->path or send is NULL, or config->max_in_flight is 0, then IoTHubStore_Create shall fail and return NULL. ]*/
+    if (
+        (config == NULL) ||
+        (config->path == NULL) ||
+        (send == NULL) ||
+        (config->max_in_flight == 0)
+        )
+    {
+        LogError("invalid arg config=%p send=%p", config, send);
+        result = NULL;
+    }
+    else if ((result = (IOTHUB_STORE*)malloc(sizeof(IOTHUB_STORE))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBMODULE_34_008: [ If any step fails then IoTHubStore_Create shall release what it acquired and return NULL. ]*/
+        LogError("malloc failed");
+    }
+    else
+    {
+        size_t name_size = strlen(config->path) + IOTHUB_STORE_NAME_SUFFIX_SIZE;
+
+        (void)memset(result, 0, sizeof(IOTHUB_STORE));
+        result->send = send;
+        result->send_context = send_context;
+        result->max_bytes = config->max_bytes;
+        result->segment_bytes = config->segment_bytes;
+        result->messages_per_second = config->messages_per_second;
+        result->max_in_flight = config->max_in_flight;
+        result->sync_interval_ms = (config->sync_interval_ms == 0) ? 1 : config->sync_interval_ms;
+        result->retry_interval_ms = config->retry_interval_ms;
+        result->metrics_interval_s = config->metrics_interval_s;
+
+        if (
+            (mallocAndStrcpy_s(&result->path, config->path) != 0) ||
+            ((result->write_name = (char*)malloc(name_size)) == NULL) ||
+            /*the checkpoint is written under a temporary name first, read_name holds both*/
+            ((result->read_name = (char*)malloc(name_size * 2)) == NULL) ||
+            ((result->slots = (IOTHUB_STORE_SLOT*)malloc(sizeof(IOTHUB_STORE_SLOT) * result->max_in_flight)) == NULL) ||
+            ((result->lock = Lock_Init()) == NULL) ||
+            ((result->wake = Condition_Init()) == NULL) ||
+            ((result->tick_counter = tickcounter_create()) == NULL)
+            )
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_008: [ If any step fails then IoTHubStore_Create shall release what it acquired and return NULL. ]*/
+            LogError("unable to allocate the store");
+            free_store(result);
+            result = NULL;
+        }
+        else if (recover(result) != 0)
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_008: [ If any step fails then IoTHubStore_Create shall release what it acquired and return NULL. ]*/
+            LogError("unable to open the store %s", config->path);
+            free_store(result);
+            result = NULL;
+        }
+        /*Codes_SRS_IOTHUBMODULE_34_012: [ IoTHubStore_Create shall start the forwarder thread with ModuleThread_Create. ]*/
+        else if (ModuleThread_Create(&result->thread, forwarder_thread, result) != THREADAPI_OK)
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_008: [ If any step fails then IoTHubStore_Create shall release what it acquired and return NULL. ]*/
+            LogError("unable to start the store forwarder thread");
+            free_store(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+int IoTHubStore_Append(IOTHUB_STORE_HANDLE handle, const unsigned char* record, size_t size)
+{
+    int result;
+    /*Codes_SRS_IOTHUBMODULE_34_013: [ If handle or record is NULL, or the record is too large for a segment, then IoTHubStore_Append shall fail and return a non-zero value. ]*/
+    if (
+        (handle == NULL) ||
+        (record == NULL) ||
+        (size > (size_t)IOTHUB_STORE_MAX_SEGMENT_BYTES - IOTHUB_STORE_SEGMENT_HEADER_SIZE - IOTHUB_STORE_RECORD_HEADER_SIZE)
+        )
+    {
+        LogError("invalid arg handle=%p record=%p size=%lu", handle, record, (unsigned long)size);
+        result = __LINE__;
+    }
+    else if (Lock(handle->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t record_bytes = IOTHUB_STORE_RECORD_HEADER_SIZE + size;
+        /*Codes_SRS_IOTHUBMODULE_34_014: [ If the queued records would take more than max_bytes then IoTHubStore_Append shall drop the record, count it and return a non-zero value. ]*/
+        if (handle->metrics.queued_bytes + record_bytes > handle->max_bytes)
+        {
+            handle->metrics.dropped++;
+            if (!handle->full)
+            {
+                LogError("store %s is full, messages are dropped", handle->path);
+                handle->full = true;
+            }
+            result = __LINE__;
+        }
+        else if (
+            (
+                handle->write_failed ||
+                (handle->write_file == NULL) ||
+                (
+                    (handle->write.offset > IOTHUB_STORE_SEGMENT_HEADER_SIZE) &&
+                    ((size_t)handle->write.offset + record_bytes > handle->segment_bytes)
+                )
+            ) &&
+            (roll_segment(handle) != 0)
+            )
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            unsigned char header[IOTHUB_STORE_RECORD_HEADER_SIZE];
+            put_uint32(header, (uint32_t)size);
+            put_uint32(header + 4, crc32_of(record, size));
+
+            /*Codes_SRS_IOTHUBMODULE_34_015: [ IoTHubStore_Append shall append the record and its CRC to the current segment, starting a new one first if the record would take it past segment_bytes, and wake the forwarder thread. ]*/
+            if (
+                (fwrite(header, 1, sizeof(header), handle->write_file) != sizeof(header)) ||
+                (fwrite(record, 1, size, handle->write_file) != size) ||
+                (fflush(handle->write_file) != 0)
+                )
+            {
+                /*what was written of the record ends the segment for the reader*/
+                LogError("unable to write to %s", handle->write_name);
+                handle->write_failed = true;
+                result = __LINE__;
+            }
+            else
+            {
+                handle->full = false;
+                handle->write.offset += (uint32_t)record_bytes;
+                handle->unsynced = true;
+                handle->metrics.queued_messages++;
+                handle->metrics.queued_bytes += record_bytes;
+                handle->metrics.appended++;
+                if (handle->forwarder_waiting)
+                {
+                    (void)Condition_Post(handle->wake);
+                }
+                result = 0;
+            }
+        }
+        (void)Unlock(handle->lock);
+    }
+    return result;
+}
+
+void IoTHubStore_Complete(IOTHUB_STORE_HANDLE handle, uint64_t sequence, bool delivered)
+{
+    if (handle == NULL)
+    {
+        LogError("invalid arg handle=NULL");
+    }
+    else if (Lock(handle->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_34_023: [ IoTHubStore_Complete shall confirm the record if delivered is true and have it sent again otherwise. ]*/
+        resolve_locked(handle, sequence, delivered ? IOTHUB_STORE_SLOT_DELIVERED : IOTHUB_STORE_SLOT_FAILED);
+        (void)Unlock(handle->lock);
+    }
+}
+
+int IoTHubStore_GetMetrics(IOTHUB_STORE_HANDLE handle, IOTHUB_STORE_METRICS* metrics)
+{
+    int result;
+    if (
+        (handle == NULL) ||
+        (metrics == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p metrics=%p", handle, metrics);
+        result = __LINE__;
+    }
+    else if (Lock(handle->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+        result = __LINE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_34_024: [ IoTHubStore_GetMetrics shall return the number and size of the queued records, the number in flight, and the totals appended, delivered, dropped, failed and discarded. ]*/
+        *metrics = handle->metrics;
+        metrics->in_flight = handle->outstanding;
+        (void)Unlock(handle->lock);
+        result = 0;
+    }
+    return result;
+}
+
+void IoTHubStore_Stop(IOTHUB_STORE_HANDLE handle)
+{
+    if (handle == NULL)
+    {
+        LogError("invalid arg handle=NULL");
+    }
+    else if (handle->thread != NULL)
+    {
+        int thread_result;
+        if (Lock(handle->lock) != LOCK_OK)
+        {
+            LogError("unable to lock");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMODULE_34_025: [ IoTHubStore_Stop shall stop the forwarder thread and wait for it to end. ]*/
+            handle->stopping = true;
+            (void)Condition_Post(handle->wake);
+            (void)Unlock(handle->lock);
+        }
+        if (ThreadAPI_Join(handle->thread, &thread_result) != THREADAPI_OK)
+        {
+            LogError("unable to join the store forwarder thread");
+        }
+        handle->thread = NULL;
+    }
+}
+
+void IoTHubStore_Destroy(IOTHUB_STORE_HANDLE handle)
+{
+    if (handle == NULL)
+    {
+        LogError("invalid arg handle=NULL");
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMODULE_34_026: [ IoTHubStore_Destroy shall stop the forwarder thread, sync the current segment, save the position of the oldest record that is not confirmed and free all resources. ]*/
+        IoTHubStore_Stop(handle);
+        if (
+            (handle->write_file != NULL) &&
+            (sync_file(handle->write_file) != 0)
+            )
+        {
+            LogError("unable to sync %s", handle->write_name);
+        }
+        if (
+            handle->checkpoint_dirty &&
+            (save_checkpoint(handle, handle->confirmed) == 0)
+            )
+        {
+            remove_confirmed_segments(handle, handle->confirmed.segment);
+        }
+        free_store(handle);
+    }
+}
@@ -0,0 +1,370 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/map.h"
+#include "message.h"
+#include "iothub_batch.h"
+
+#include <parson.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+static int g_context[8];
+
+static IOTHUB_BATCH_CONFIG test_config(size_t max_messages, size_t max_bytes, size_t max_delay_ms)
+{
+    IOTHUB_BATCH_CONFIG config;
+    config.enabled = true;
+    config.max_messages = max_messages;
+    config.max_bytes = max_bytes;
+    config.max_delay_ms = max_delay_ms;
+    return config;
+}
+
+static int parse_batch_config(const char* args, IOTHUB_BATCH_CONFIG* config)
+{
+    int result;
+    JSON_Value* json = json_parse_string(args);
+    ASSERT_IS_NOT_NULL(json);
+    result = IoTHubBatch_ParseConfigurationFromJson(json_value_get_object(json), config);
+    json_value_free(json);
+    return result;
+}
+
+/*a message for deviceName "device" with content and, if key is not NULL, a key:value property*/
+static MESSAGE_HANDLE create_message(const char* content, size_t size, const char* key, const char* value)
+{
+    MESSAGE_HANDLE result;
+    MESSAGE_CONFIG config;
+    MAP_HANDLE properties = Map_Create(NULL);
+    ASSERT_IS_NOT_NULL(properties);
+    ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, "deviceName", "device"));
+    ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, "deviceKey", "secret"));
+    if (key != NULL)
+    {
+        ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, key, value));
+    }
+    config.source = (const unsigned char*)content;
+    config.size = size;
+    config.sourceProperties = properties;
+    result = Message_Create(&config);
+    ASSERT_IS_NOT_NULL(result);
+    Map_Destroy(properties);
+    return result;
+}
+
+static IOTHUB_BATCH_ADD_RESULT add_message(IOTHUB_BATCH_HANDLE batch, const char* content, void* context, tickcounter_ms_t now)
+{
+    MESSAGE_HANDLE message = create_message(content, strlen(content), NULL, NULL);
+    IOTHUB_BATCH_ADD_RESULT result = IoTHubBatch_Add(batch, message, context, now);
+    Message_Destroy(message);
+    return result;
+}
+
+/*parses the body of event, it must be a JSON array of count entries*/
+static JSON_Value* parse_event(const IOTHUB_BATCH_EVENT* event, size_t count)
+{
+    JSON_Value* result;
+    char* text = (char*)malloc(event->size + 1);
+    ASSERT_IS_NOT_NULL(text);
+    (void)memcpy(text, event->body, event->size);
+    text[event->size] = '\0';
+    result = json_parse_string(text);
+    free(text);
+    ASSERT_IS_NOT_NULL(result);
+    ASSERT_ARE_EQUAL(int, (int)JSONArray, (int)json_value_get_type(result));
+    ASSERT_ARE_EQUAL(size_t, count, json_array_get_count(json_value_get_array(result)));
+    return result;
+}
+
+static JSON_Object* get_entry(JSON_Value* array, size_t index)
+{
+    JSON_Object* result = json_value_get_object(json_array_get_value(json_value_get_array(array), index));
+    ASSERT_IS_NOT_NULL(result);
+    return result;
+}
+
+BEGIN_TEST_SUITE(iothub_batch_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_IOTHUBMODULE_35_001: [ If json or config is NULL then IoTHubBatch_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_002: [ Values that are not present shall default to max_messages IOTHUB_BATCH_DEFAULT_MAX_MESSAGES, max_bytes IOTHUB_BATCH_DEFAULT_MAX_BYTES and max_delay_ms IOTHUB_BATCH_DEFAULT_MAX_DELAY_MS. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_003: [ If there is no "batch" then IoTHubBatch_ParseConfigurationFromJson shall set enabled to false and succeed. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_006: [ Otherwise IoTHubBatch_ParseConfigurationFromJson shall set enabled to true and succeed. ]*/
+TEST_FUNCTION(IoTHubBatch_ParseConfigurationFromJson_reads_settings)
+{
+    IOTHUB_BATCH_CONFIG config;
+    JSON_Value* json = json_parse_string("{}");
+    ASSERT_IS_NOT_NULL(json);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubBatch_ParseConfigurationFromJson(NULL, &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubBatch_ParseConfigurationFromJson(json_value_get_object(json), NULL));
+    json_value_free(json);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_batch_config("{ \"IoTHubName\": \"hub\" }", &config));
+    ASSERT_IS_FALSE(config.enabled);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_batch_config("{ \"batch\": { } }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_BATCH_DEFAULT_MAX_MESSAGES, config.max_messages);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_BATCH_DEFAULT_MAX_BYTES, config.max_bytes);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_BATCH_DEFAULT_MAX_DELAY_MS, config.max_delay_ms);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_batch_config("{ \"batch\": { \"max_messages\": 20, \"max_bytes\": 65536, \"max_delay_ms\": 250 } }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(size_t, 20, config.max_messages);
+    ASSERT_ARE_EQUAL(size_t, 65536, config.max_bytes);
+    ASSERT_ARE_EQUAL(size_t, 250, config.max_delay_ms);
+}
+
+/*Tests_SRS_IOTHUBMODULE_35_004: [ If "batch" is not an object then IoTHubBatch_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_005: [ If a value of "batch" is present and is not a number in range then IoTHubBatch_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubBatch_ParseConfigurationFromJson_rejects_bad_values)
+{
+    static const char* const bad_args[] =
+    {
+        "{ \"batch\": true }",
+        "{ \"batch\": { \"max_messages\": 0 } }",
+        "{ \"batch\": { \"max_messages\": 2.5 } }",
+        "{ \"batch\": { \"max_messages\": \"many\" } }",
+        "{ \"batch\": { \"max_bytes\": 100 } }",
+        "{ \"batch\": { \"max_bytes\": 1000000 } }",
+        "{ \"batch\": { \"max_delay_ms\": 0 } }",
+        "{ \"batch\": { \"max_delay_ms\": -5 } }"
+    };
+    size_t i;
+    for (i = 0; i < sizeof(bad_args) / sizeof(bad_args[0]); i++)
+    {
+        IOTHUB_BATCH_CONFIG config;
+        ASSERT_ARE_NOT_EQUAL(int, 0, parse_batch_config(bad_args[i], &config));
+    }
+}
+
+/*Tests_SRS_IOTHUBMODULE_35_007: [ If config is NULL or any of its limits is 0 then IoTHubBatch_Create shall fail and return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_010: [ If handle or message is NULL then IoTHubBatch_Add shall fail and return IOTHUB_BATCH_ADD_ERROR. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_019: [ If handle is NULL or the batch is empty then IoTHubBatch_Take shall return NULL. ]*/
+TEST_FUNCTION(IoTHubBatch_rejects_invalid_arguments)
+{
+    IOTHUB_BATCH_CONFIG config = test_config(0, 4096, 100);
+    IOTHUB_BATCH_HANDLE batch;
+    MESSAGE_HANDLE message = create_message("m", 1, NULL, NULL);
+    tickcounter_ms_t due;
+
+    ASSERT_IS_NULL(IoTHubBatch_Create(NULL));
+    ASSERT_IS_NULL(IoTHubBatch_Create(&config));
+    config.max_messages = 4;
+    config.max_delay_ms = 0;
+    ASSERT_IS_NULL(IoTHubBatch_Create(&config));
+    config.max_delay_ms = 100;
+    batch = IoTHubBatch_Create(&config);
+    ASSERT_IS_NOT_NULL(batch);
+
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_ERROR, (int)IoTHubBatch_Add(NULL, message, NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_ERROR, (int)IoTHubBatch_Add(batch, NULL, NULL, 0));
+    ASSERT_IS_NULL(IoTHubBatch_Take(NULL));
+    ASSERT_IS_NULL(IoTHubBatch_Take(batch));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubBatch_GetDueTime(batch, &due));
+    ASSERT_IS_FALSE(IoTHubBatch_IsReady(batch, 1000000));
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubBatch_GetCount(NULL));
+
+    IoTHubBatch_Destroy(batch);
+    IoTHubBatch_Destroy(NULL);
+    IoTHubBatch_DestroyEvent(NULL);
+    Message_Destroy(message);
+}
+
+/*Tests_SRS_IOTHUBMODULE_35_009: [ Otherwise IoTHubBatch_Create shall return an empty batch. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_012: [ Otherwise IoTHubBatch_Add shall append the content as base64 and the properties other than "deviceName" and "deviceKey" to the batch, remember context and return IOTHUB_BATCH_ADD_OK. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_015: [ IoTHubBatch_GetCount shall return the number of messages in the batch, 0 if handle is NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_021: [ Otherwise IoTHubBatch_Take shall close the JSON array, hand the encoded batch and the contexts of its messages over to the returned event and empty the batch. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_022: [ IoTHubBatch_DestroyEvent shall free the event, its body and its contexts array, and do nothing if event is NULL. ]*/
+TEST_FUNCTION(IoTHubBatch_encodes_messages_as_a_json_array)
+{
+    IOTHUB_BATCH_CONFIG config = test_config(8, 4096, 100);
+    IOTHUB_BATCH_HANDLE batch = IoTHubBatch_Create(&config);
+    static const char binary[] = { 'a', '\0', 'b' };
+    MESSAGE_HANDLE quoted = create_message("abc", 3, "note", "say \"hi\"\n\\ \x01");
+    MESSAGE_HANDLE zeroes = create_message(binary, sizeof(binary), NULL, NULL);
+    IOTHUB_BATCH_EVENT* event;
+    JSON_Value* json;
+    JSON_Object* entry;
+    JSON_Object* properties;
+    ASSERT_IS_NOT_NULL(batch);
+
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "hello", &g_context[0], 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)IoTHubBatch_Add(batch, quoted, &g_context[1], 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "a", NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)IoTHubBatch_Add(batch, zeroes, &g_context[3], 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "", &g_context[4], 0));
+    ASSERT_ARE_EQUAL(size_t, 5, IoTHubBatch_GetCount(batch));
+
+    event = IoTHubBatch_Take(batch);
+    ASSERT_IS_NOT_NULL(event);
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubBatch_GetCount(batch));
+    ASSERT_IS_NULL(IoTHubBatch_Take(batch));
+    ASSERT_ARE_EQUAL(size_t, 5, event->count);
+    ASSERT_IS_TRUE(event->contexts[0] == &g_context[0]);
+    ASSERT_IS_TRUE(event->contexts[1] == &g_context[1]);
+    ASSERT_IS_NULL(event->contexts[2]);
+    ASSERT_IS_TRUE(event->contexts[3] == &g_context[3]);
+    ASSERT_IS_TRUE(event->contexts[4] == &g_context[4]);
+    ASSERT_IS_NULL(event->sender);
+
+    json = parse_event(event, 5);
+    entry = get_entry(json, 0);
+    ASSERT_ARE_EQUAL(char_ptr, "aGVsbG8=", json_object_get_string(entry, "body"));
+    ASSERT_ARE_EQUAL(int, 1, json_object_get_boolean(entry, "base64Encoded"));
+    properties = json_object_get_object(entry, "properties");
+    ASSERT_IS_NOT_NULL(properties);
+    ASSERT_IS_NULL(json_object_get_value(properties, "deviceName"));
+    ASSERT_IS_NULL(json_object_get_value(properties, "deviceKey"));
+
+    entry = get_entry(json, 1);
+    ASSERT_ARE_EQUAL(char_ptr, "YWJj", json_object_get_string(entry, "body"));
+    properties = json_object_get_object(entry, "properties");
+    ASSERT_ARE_EQUAL(char_ptr, "say \"hi\"\n\\ \x01", json_object_get_string(properties, "note"));
+    ASSERT_IS_NULL(json_object_get_value(properties, "deviceKey"));
+
+    ASSERT_ARE_EQUAL(char_ptr, "YQ==", json_object_get_string(get_entry(json, 2), "body"));
+    ASSERT_ARE_EQUAL(char_ptr, "YQBi", json_object_get_string(get_entry(json, 3), "body"));
+    ASSERT_ARE_EQUAL(char_ptr, "", json_object_get_string(get_entry(json, 4), "body"));
+    json_value_free(json);
+    IoTHubBatch_DestroyEvent(event);
+
+    /*the batch is reused after a take*/
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "ab", &g_context[5], 0));
+    event = IoTHubBatch_Take(batch);
+    ASSERT_IS_NOT_NULL(event);
+    json = parse_event(event, 1);
+    ASSERT_ARE_EQUAL(char_ptr, "YWI=", json_object_get_string(get_entry(json, 0), "body"));
+    json_value_free(json);
+    IoTHubBatch_DestroyEvent(event);
+
+    Message_Destroy(quoted);
+    Message_Destroy(zeroes);
+    IoTHubBatch_Destroy(batch);
+}
+
+/*Tests_SRS_IOTHUBMODULE_35_011: [ If the batch holds max_messages messages, or is not empty and the encoded batch with message would be larger than max_bytes, then IoTHubBatch_Add shall leave the batch as is and return IOTHUB_BATCH_ADD_FULL. ]*/
+TEST_FUNCTION(IoTHubBatch_Add_reports_a_full_batch)
+{
+    IOTHUB_BATCH_CONFIG config = test_config(3, 1024, 100);
+    IOTHUB_BATCH_HANDLE batch = IoTHubBatch_Create(&config);
+    char large[1500];
+    IOTHUB_BATCH_EVENT* event;
+    JSON_Value* json;
+    ASSERT_IS_NOT_NULL(batch);
+    (void)memset(large, 'x', sizeof(large) - 1);
+    large[sizeof(large) - 1] = '\0';
+
+    /*by count*/
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "1", NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "2", NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "3", NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_FULL, (int)add_message(batch, "4", NULL, 0));
+    ASSERT_ARE_EQUAL(size_t, 3, IoTHubBatch_GetCount(batch));
+    event = IoTHubBatch_Take(batch);
+    ASSERT_IS_NOT_NULL(event);
+    json = parse_event(event, 3);
+    json_value_free(json);
+    IoTHubBatch_DestroyEvent(event);
+
+    /*by size, an event never grows past max_bytes*/
+    (void)memset(large, 'y', 600);
+    large[600] = '\0';
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, large, NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_FULL, (int)add_message(batch, large, NULL, 0));
+    event = IoTHubBatch_Take(batch);
+    ASSERT_IS_NOT_NULL(event);
+    ASSERT_ARE_EQUAL(size_t, 1, event->count);
+    ASSERT_IS_TRUE(event->size <= 1024);
+    IoTHubBatch_DestroyEvent(event);
+
+    /*a message too large for any batch still goes into an empty one*/
+    (void)memset(large, 'z', sizeof(large) - 1);
+    large[sizeof(large) - 1] = '\0';
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, large, NULL, 0));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_FULL, (int)add_message(batch, "1", NULL, 0));
+    event = IoTHubBatch_Take(batch);
+    ASSERT_IS_NOT_NULL(event);
+    json = parse_event(event, 1);
+    json_value_free(json);
+    IoTHubBatch_DestroyEvent(event);
+
+    IoTHubBatch_Destroy(batch);
+}
+
+/*Tests_SRS_IOTHUBMODULE_35_014: [ The first message added to an empty batch shall start its delay at now. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_016: [ If handle or due is NULL, or the batch is empty, then IoTHubBatch_GetDueTime shall return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_017: [ Otherwise IoTHubBatch_GetDueTime shall set due to max_delay_ms after the first message was added and return 0. ]*/
+/*Tests_SRS_IOTHUBMODULE_35_018: [ IoTHubBatch_IsReady shall return true if the batch holds max_messages messages, or is not empty and max_delay_ms have passed since its first message was added. ]*/
+TEST_FUNCTION(IoTHubBatch_is_ready_when_full_or_due)
+{
+    IOTHUB_BATCH_CONFIG config = test_config(2, 4096, 100);
+    IOTHUB_BATCH_HANDLE batch = IoTHubBatch_Create(&config);
+    tickcounter_ms_t due;
+    ASSERT_IS_NOT_NULL(batch);
+
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "1", NULL, 1000));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubBatch_GetDueTime(batch, NULL));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubBatch_GetDueTime(batch, &due));
+    ASSERT_IS_TRUE(due == 1100);
+    ASSERT_IS_FALSE(IoTHubBatch_IsReady(batch, 1000));
+    ASSERT_IS_FALSE(IoTHubBatch_IsReady(batch, 1099));
+    ASSERT_IS_TRUE(IoTHubBatch_IsReady(batch, 1100));
+
+    /*the delay runs from the first message*/
+    IoTHubBatch_DestroyEvent(IoTHubBatch_Take(batch));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "1", NULL, 2000));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubBatch_GetDueTime(batch, &due));
+    ASSERT_IS_TRUE(due == 2100);
+    ASSERT_IS_FALSE(IoTHubBatch_IsReady(batch, 2050));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_BATCH_ADD_OK, (int)add_message(batch, "2", NULL, 2050));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubBatch_GetDueTime(batch, &due));
+    ASSERT_IS_TRUE(due == 2100);
+    ASSERT_IS_TRUE(IoTHubBatch_IsReady(batch, 2050));
+
+    IoTHubBatch_DestroyEvent(IoTHubBatch_Take(batch));
+    ASSERT_IS_FALSE(IoTHubBatch_IsReady(batch, 5000));
+    IoTHubBatch_Destroy(batch);
+}
+
+END_TEST_SUITE(iothub_batch_ut)
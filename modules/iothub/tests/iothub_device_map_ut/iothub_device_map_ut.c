@@ -0,0 +1,294 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "iothub_device_map.h"
+
+#include <parson.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define DEVICE_COUNT 1000
+
+static int g_value[DEVICE_COUNT];
+
+static int parse_devices_config(const char* args, IOTHUB_DEVICE_MAP_CONFIG* config)
+{
+    int result;
+    JSON_Value* json = json_parse_string(args);
+    ASSERT_IS_NOT_NULL(json);
+    result = IoTHubDeviceMap_ParseConfigurationFromJson(json_value_get_object(json), config);
+    json_value_free(json);
+    return result;
+}
+
+static const char* device_name(size_t index)
+{
+    static char name[32];
+    (void)sprintf(name, "device%lu", (unsigned long)index);
+    return name;
+}
+
+/*records the visited values in order*/
+typedef struct VISITED_TAG
+{
+    void* values[8];
+    size_t count;
+} VISITED;
+
+static void record_visit(void* context, void* value)
+{
+    VISITED* visited = (VISITED*)context;
+    ASSERT_IS_TRUE(visited->count < sizeof(visited->values) / sizeof(visited->values[0]));
+    visited->values[visited->count++] = value;
+}
+
+/*records the offered values like record_visit and accepts only context->accepted*/
+typedef struct OFFERED_TAG
+{
+    VISITED visited;
+    void* accepted;
+} OFFERED;
+
+static bool accept_one(void* context, void* value)
+{
+    OFFERED* offered = (OFFERED*)context;
+    record_visit(&offered->visited, value);
+    return value == offered->accepted;
+}
+
+BEGIN_TEST_SUITE(iothub_device_map_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_IOTHUBMODULE_36_001: [ If json or config is NULL then IoTHubDeviceMap_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_002: [ If there is no "devices" or it has no "max_clients" then IoTHubDeviceMap_ParseConfigurationFromJson shall set max_clients to 0 and succeed. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_005: [ Otherwise IoTHubDeviceMap_ParseConfigurationFromJson shall set max_clients to the value of "max_clients" and succeed. ]*/
+TEST_FUNCTION(IoTHubDeviceMap_ParseConfigurationFromJson_reads_settings)
+{
+    IOTHUB_DEVICE_MAP_CONFIG config;
+    JSON_Value* json = json_parse_string("{}");
+    ASSERT_IS_NOT_NULL(json);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubDeviceMap_ParseConfigurationFromJson(NULL, &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubDeviceMap_ParseConfigurationFromJson(json_value_get_object(json), NULL));
+    json_value_free(json);
+
+    config.max_clients = 42;
+    ASSERT_ARE_EQUAL(int, 0, parse_devices_config("{}", &config));
+    ASSERT_ARE_EQUAL(size_t, 0, config.max_clients);
+
+    config.max_clients = 42;
+    ASSERT_ARE_EQUAL(int, 0, parse_devices_config("{\"devices\":{}}", &config));
+    ASSERT_ARE_EQUAL(size_t, 0, config.max_clients);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_devices_config("{\"devices\":{\"max_clients\":5000}}", &config));
+    ASSERT_ARE_EQUAL(size_t, 5000, config.max_clients);
+}
+
+/*Tests_SRS_IOTHUBMODULE_36_003: [ If "devices" is not an object then IoTHubDeviceMap_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_004: [ If "max_clients" is not a whole number from 1 to IOTHUB_DEVICE_MAP_MAX_CLIENTS then IoTHubDeviceMap_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubDeviceMap_ParseConfigurationFromJson_rejects_bad_values)
+{
+    IOTHUB_DEVICE_MAP_CONFIG config;
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_devices_config("{\"devices\":5000}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_devices_config("{\"devices\":{\"max_clients\":\"5000\"}}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_devices_config("{\"devices\":{\"max_clients\":0}}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_devices_config("{\"devices\":{\"max_clients\":-1}}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_devices_config("{\"devices\":{\"max_clients\":1.5}}", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_devices_config("{\"devices\":{\"max_clients\":1000001}}", &config));
+}
+
+/*Tests_SRS_IOTHUBMODULE_36_008: [ If handle or deviceName is NULL then IoTHubDeviceMap_Find shall return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_011: [ If handle, deviceName or value is NULL then IoTHubDeviceMap_Add shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_016: [ IoTHubDeviceMap_GetCount shall return the number of devices in the map, 0 if handle is NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_017: [ If handle is NULL or the map is empty then IoTHubDeviceMap_RemoveLeastRecentlyUsed shall return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_019: [ If handle or visit is NULL then IoTHubDeviceMap_ForEach shall do nothing. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_028: [ If handle or accept is NULL then IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_021: [ IoTHubDeviceMap_Destroy shall free the map and its entries but not their values, and do nothing if handle is NULL. ]*/
+TEST_FUNCTION(IoTHubDeviceMap_rejects_invalid_arguments)
+{
+    IOTHUB_DEVICE_MAP_HANDLE map = IoTHubDeviceMap_Create();
+    VISITED visited;
+    ASSERT_IS_NOT_NULL(map);
+    visited.count = 0;
+
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(NULL, "device"));
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubDeviceMap_Add(NULL, "device", &g_value[0]));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubDeviceMap_Add(map, NULL, &g_value[0]));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "device", NULL));
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubDeviceMap_GetCount(NULL));
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubDeviceMap_GetCount(map));
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsed(NULL));
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map));
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(NULL, accept_one, NULL));
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(map, NULL, NULL));
+    IoTHubDeviceMap_ForEach(NULL, record_visit, &visited);
+    IoTHubDeviceMap_ForEach(map, NULL, &visited);
+    IoTHubDeviceMap_ForEach(map, record_visit, &visited);
+    ASSERT_ARE_EQUAL(size_t, 0, visited.count);
+
+    IoTHubDeviceMap_Destroy(NULL);
+    IoTHubDeviceMap_Destroy(map);
+}
+
+/*Tests_SRS_IOTHUBMODULE_36_007: [ Otherwise IoTHubDeviceMap_Create shall return an empty map. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_009: [ If deviceName is not in the map then IoTHubDeviceMap_Find shall return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_012: [ If deviceName is already in the map then IoTHubDeviceMap_Add shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_014: [ Otherwise IoTHubDeviceMap_Add shall add a copy of deviceName with value as the most recently used device and return 0. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_015: [ IoTHubDeviceMap_Add shall double the buckets when the map holds more devices than buckets. ]*/
+TEST_FUNCTION(IoTHubDeviceMap_finds_what_was_added)
+{
+    IOTHUB_DEVICE_MAP_HANDLE map = IoTHubDeviceMap_Create();
+    char name[] = "device";
+    size_t i;
+    ASSERT_IS_NOT_NULL(map);
+
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, name, &g_value[0]));
+    /*the name is copied*/
+    name[0] = 'D';
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, name));
+    ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, "device") == &g_value[0]);
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "device", &g_value[1]));
+    ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, "device") == &g_value[0]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[0]);
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, "device"));
+
+    /*enough devices for the buckets to grow a few times*/
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, device_name(i), &g_value[i]));
+    }
+    ASSERT_ARE_EQUAL(size_t, DEVICE_COUNT, IoTHubDeviceMap_GetCount(map));
+    for (i = 0; i < DEVICE_COUNT; i++)
+    {
+        ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, device_name(i)) == &g_value[i]);
+    }
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, device_name(DEVICE_COUNT)));
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, ""));
+
+    IoTHubDeviceMap_Destroy(map);
+}
+
+/*Tests_SRS_IOTHUBMODULE_36_010: [ Otherwise IoTHubDeviceMap_Find shall make deviceName the most recently used device and return its value. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_018: [ Otherwise IoTHubDeviceMap_RemoveLeastRecentlyUsed shall take the least recently used device out of the map and return its value. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_020: [ Otherwise IoTHubDeviceMap_ForEach shall call visit with context and the value of each device, from the most to the least recently used. ]*/
+TEST_FUNCTION(IoTHubDeviceMap_removes_the_least_recently_used_device)
+{
+    IOTHUB_DEVICE_MAP_HANDLE map = IoTHubDeviceMap_Create();
+    VISITED visited;
+    ASSERT_IS_NOT_NULL(map);
+
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "a", &g_value[0]));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "b", &g_value[1]));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "c", &g_value[2]));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "d", &g_value[3]));
+
+    /*c a d b*/
+    ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, "a") == &g_value[0]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, "d") == &g_value[3]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, "a") == &g_value[0]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_Find(map, "c") == &g_value[2]);
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, "e"));
+
+    visited.count = 0;
+    IoTHubDeviceMap_ForEach(map, record_visit, &visited);
+    ASSERT_ARE_EQUAL(size_t, 4, visited.count);
+    ASSERT_IS_TRUE(visited.values[0] == &g_value[2]);
+    ASSERT_IS_TRUE(visited.values[1] == &g_value[0]);
+    ASSERT_IS_TRUE(visited.values[2] == &g_value[3]);
+    ASSERT_IS_TRUE(visited.values[3] == &g_value[1]);
+
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[1]);
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, "b"));
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[3]);
+    ASSERT_ARE_EQUAL(size_t, 2, IoTHubDeviceMap_GetCount(map));
+
+    /*a removed device can come back, as the most recently used one*/
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "b", &g_value[1]));
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[0]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[2]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[1]);
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map));
+    ASSERT_ARE_EQUAL(size_t, 0, IoTHubDeviceMap_GetCount(map));
+
+    IoTHubDeviceMap_Destroy(map);
+}
+
+/*Tests_SRS_IOTHUBMODULE_36_029: [ Otherwise IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall call accept with context and the value of each device, from the least to the most recently used, until it returns true. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_030: [ If accept returns false for every device then IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_36_031: [ Otherwise IoTHubDeviceMap_RemoveLeastRecentlyUsedIf shall take that device out of the map and return its value. ]*/
+TEST_FUNCTION(IoTHubDeviceMap_removes_the_least_recently_used_accepted_device)
+{
+    IOTHUB_DEVICE_MAP_HANDLE map = IoTHubDeviceMap_Create();
+    OFFERED offered;
+    ASSERT_IS_NOT_NULL(map);
+
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "a", &g_value[0]));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "b", &g_value[1]));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubDeviceMap_Add(map, "c", &g_value[2]));
+
+    /*nothing accepted, everything offered from the least recently used*/
+    offered.visited.count = 0;
+    offered.accepted = NULL;
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(map, accept_one, &offered));
+    ASSERT_ARE_EQUAL(size_t, 3, offered.visited.count);
+    ASSERT_IS_TRUE(offered.visited.values[0] == &g_value[0]);
+    ASSERT_IS_TRUE(offered.visited.values[1] == &g_value[1]);
+    ASSERT_IS_TRUE(offered.visited.values[2] == &g_value[2]);
+    ASSERT_ARE_EQUAL(size_t, 3, IoTHubDeviceMap_GetCount(map));
+
+    /*the search stops at the accepted device*/
+    offered.visited.count = 0;
+    offered.accepted = &g_value[1];
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(map, accept_one, &offered) == &g_value[1]);
+    ASSERT_ARE_EQUAL(size_t, 2, offered.visited.count);
+    ASSERT_ARE_EQUAL(size_t, 2, IoTHubDeviceMap_GetCount(map));
+    ASSERT_IS_NULL(IoTHubDeviceMap_Find(map, "b"));
+
+    /*the others keep their order*/
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[0]);
+    ASSERT_IS_TRUE(IoTHubDeviceMap_RemoveLeastRecentlyUsed(map) == &g_value[2]);
+    ASSERT_IS_NULL(IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(map, accept_one, &offered));
+
+    IoTHubDeviceMap_Destroy(map);
+}
+
+END_TEST_SUITE(iothub_device_map_ut)
@@ -0,0 +1,650 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "iothub_store.h"
+
+#include <parson.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define TEST_STORE_PATH "iothub_store_ut.q"
+#define TEST_MAX_SEGMENTS 64
+#define TEST_MAX_RECORDS 256
+#define WAIT_TIMEOUT_MS 10000
+
+/*
+ * stands in for IoT Hub: it keeps what it is sent and either confirms it
+ * right away or leaves it in flight until the test completes it
+ */
+typedef struct TEST_TRANSPORT_TAG
+{
+    LOCK_HANDLE lock;
+    /*confirm each accepted record from inside send*/
+    bool confirm;
+    /*the send with this number (from 1) returns IOTHUB_STORE_SEND_RETRY, 0 for none*/
+    size_t retry_send;
+    /*records starting with this byte are discarded*/
+    unsigned char discard_mark;
+    size_t send_count;
+    size_t record_count;
+    char records[TEST_MAX_RECORDS][32];
+    uint64_t sequences[TEST_MAX_RECORDS];
+} TEST_TRANSPORT;
+
+static TEST_TRANSPORT g_transport;
+
+static IOTHUB_STORE_SEND_RESULT test_send(void* context, IOTHUB_STORE_HANDLE store, const unsigned char* record, size_t size, uint64_t sequence)
+{
+    TEST_TRANSPORT* transport = (TEST_TRANSPORT*)context;
+    IOTHUB_STORE_SEND_RESULT result;
+    bool confirm;
+    ASSERT_ARE_EQUAL(int, (int)LOCK_OK, (int)Lock(transport->lock));
+    transport->send_count++;
+    if (transport->send_count == transport->retry_send)
+    {
+        result = IOTHUB_STORE_SEND_RETRY;
+    }
+    else if (
+        (size > 0) &&
+        (transport->discard_mark != 0) &&
+        (record[0] == transport->discard_mark)
+        )
+    {
+        result = IOTHUB_STORE_SEND_DISCARD;
+    }
+    else
+    {
+        /*long records are only kept in part*/
+        size_t kept = (size < sizeof(transport->records[0])) ? size : sizeof(transport->records[0]) - 1;
+        ASSERT_IS_TRUE(transport->record_count < TEST_MAX_RECORDS);
+        (void)memcpy(transport->records[transport->record_count], record, kept);
+        transport->records[transport->record_count][kept] = '\0';
+        transport->sequences[transport->record_count] = sequence;
+        transport->record_count++;
+        result = IOTHUB_STORE_SEND_ACCEPTED;
+    }
+    confirm = transport->confirm;
+    (void)Unlock(transport->lock);
+
+    if (
+        (result == IOTHUB_STORE_SEND_ACCEPTED) &&
+        confirm
+        )
+    {
+        IoTHubStore_Complete(store, sequence, true);
+    }
+    return result;
+}
+
+static size_t transport_record_count(void)
+{
+    size_t result;
+    ASSERT_ARE_EQUAL(int, (int)LOCK_OK, (int)Lock(g_transport.lock));
+    result = g_transport.record_count;
+    (void)Unlock(g_transport.lock);
+    return result;
+}
+
+static void reset_transport(bool confirm)
+{
+    LOCK_HANDLE lock = g_transport.lock;
+    (void)memset(&g_transport, 0, sizeof(g_transport));
+    g_transport.lock = lock;
+    g_transport.confirm = confirm;
+}
+
+static void remove_store(void)
+{
+    char name[64];
+    size_t segment;
+    (void)remove(TEST_STORE_PATH ".checkpoint");
+    (void)remove(TEST_STORE_PATH ".checkpoint.tmp");
+    for (segment = 1; segment <= TEST_MAX_SEGMENTS; segment++)
+    {
+        (void)sprintf(name, "%s.%lu", TEST_STORE_PATH, (unsigned long)segment);
+        (void)remove(name);
+    }
+}
+
+static size_t count_segments(void)
+{
+    char name[64];
+    size_t segment;
+    size_t result = 0;
+    for (segment = 1; segment <= TEST_MAX_SEGMENTS; segment++)
+    {
+        FILE* f;
+        (void)sprintf(name, "%s.%lu", TEST_STORE_PATH, (unsigned long)segment);
+        if ((f = fopen(name, "rb")) != NULL)
+        {
+            (void)fclose(f);
+            result++;
+        }
+    }
+    return result;
+}
+
+static IOTHUB_STORE_CONFIG test_config(void)
+{
+    IOTHUB_STORE_CONFIG result;
+    result.enabled = true;
+    result.path = (char*)TEST_STORE_PATH;
+    result.max_bytes = IOTHUB_STORE_DEFAULT_MAX_BYTES;
+    result.segment_bytes = IOTHUB_STORE_DEFAULT_SEGMENT_BYTES;
+    result.messages_per_second = 0;
+    result.max_in_flight = IOTHUB_STORE_DEFAULT_MAX_IN_FLIGHT;
+    result.sync_interval_ms = 10;
+    result.retry_interval_ms = 10;
+    result.metrics_interval_s = 0;
+    return result;
+}
+
+static void append_text(IOTHUB_STORE_HANDLE store, const char* text)
+{
+    ASSERT_ARE_EQUAL(int, 0, IoTHubStore_Append(store, (const unsigned char*)text, strlen(text)));
+}
+
+static void append_numbered(IOTHUB_STORE_HANDLE store, size_t first, size_t count)
+{
+    char text[32];
+    size_t i;
+    for (i = first; i < first + count; i++)
+    {
+        (void)sprintf(text, "message %lu", (unsigned long)i);
+        append_text(store, text);
+    }
+}
+
+static void wait_for_records(size_t count)
+{
+    size_t waited_ms = 0;
+    while (
+        (transport_record_count() < count) &&
+        (waited_ms < WAIT_TIMEOUT_MS)
+        )
+    {
+        ThreadAPI_Sleep(1);
+        waited_ms++;
+    }
+    ASSERT_ARE_EQUAL(size_t, count, transport_record_count());
+}
+
+static void wait_for_queue(IOTHUB_STORE_HANDLE store, size_t queued)
+{
+    IOTHUB_STORE_METRICS metrics;
+    size_t waited_ms = 0;
+    do
+    {
+        ThreadAPI_Sleep(1);
+        waited_ms++;
+        ASSERT_ARE_EQUAL(int, 0, IoTHubStore_GetMetrics(store, &metrics));
+    } while (
+        (metrics.queued_messages != queued) &&
+        (waited_ms < WAIT_TIMEOUT_MS)
+        );
+    ASSERT_ARE_EQUAL(size_t, queued, metrics.queued_messages);
+}
+
+static void assert_numbered(size_t index, size_t number)
+{
+    char text[32];
+    (void)sprintf(text, "message %lu", (unsigned long)number);
+    ASSERT_ARE_EQUAL(char_ptr, text, g_transport.records[index]);
+}
+
+static int parse_store_config(const char* args, IOTHUB_STORE_CONFIG* config)
+{
+    JSON_Value* json = json_parse_string(args);
+    int result;
+    ASSERT_IS_NOT_NULL(json);
+    result = IoTHubStore_ParseConfigurationFromJson(json_value_get_object(json), config);
+    json_value_free(json);
+    return result;
+}
+
+BEGIN_TEST_SUITE(iothub_store_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+    g_transport.lock = Lock_Init();
+    ASSERT_IS_NOT_NULL(g_transport.lock);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    (void)Lock_Deinit(g_transport.lock);
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+    remove_store();
+    reset_transport(true);
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    remove_store();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_001: [ If json or config is NULL then IoTHubStore_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_002: [ Values that are not present shall default to max_bytes IOTHUB_STORE_DEFAULT_MAX_BYTES, segment_bytes IOTHUB_STORE_DEFAULT_SEGMENT_BYTES, no rate limit, max_in_flight IOTHUB_STORE_DEFAULT_MAX_IN_FLIGHT, sync_interval_ms IOTHUB_STORE_DEFAULT_SYNC_INTERVAL_MS, retry_interval_ms IOTHUB_STORE_DEFAULT_RETRY_INTERVAL_MS and no metrics report. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_003: [ If there is no "store" then IoTHubStore_ParseConfigurationFromJson shall set enabled to false and succeed. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_006: [ Otherwise IoTHubStore_ParseConfigurationFromJson shall set enabled to true and copy "path". ]*/
+TEST_FUNCTION(IoTHubStore_ParseConfigurationFromJson_reads_settings)
+{
+    IOTHUB_STORE_CONFIG config;
+    JSON_Value* json = json_parse_string("{}");
+    ASSERT_IS_NOT_NULL(json);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_ParseConfigurationFromJson(NULL, &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_ParseConfigurationFromJson(json_value_get_object(json), NULL));
+    json_value_free(json);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_store_config("{ \"IoTHubName\": \"hub\" }", &config));
+    ASSERT_IS_FALSE(config.enabled);
+    ASSERT_IS_NULL(config.path);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_store_config("{ \"store\": { \"path\": \"q\" } }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(char_ptr, "q", config.path);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_STORE_DEFAULT_MAX_BYTES, config.max_bytes);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_STORE_DEFAULT_SEGMENT_BYTES, config.segment_bytes);
+    ASSERT_IS_TRUE(config.messages_per_second == 0);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_STORE_DEFAULT_MAX_IN_FLIGHT, config.max_in_flight);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_STORE_DEFAULT_SYNC_INTERVAL_MS, config.sync_interval_ms);
+    ASSERT_ARE_EQUAL(size_t, IOTHUB_STORE_DEFAULT_RETRY_INTERVAL_MS, config.retry_interval_ms);
+    ASSERT_ARE_EQUAL(size_t, 0, config.metrics_interval_s);
+    free(config.path);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_store_config(
+        "{ \"store\": { \"path\": \"q\", \"max_bytes\": 1000000, \"segment_bytes\": 65536, \"messages_per_second\": 2.5, "
+        "\"max_in_flight\": 8, \"sync_interval_ms\": 50, \"retry_interval_ms\": 2000, \"metrics_interval_s\": 60 } }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(size_t, 1000000, config.max_bytes);
+    ASSERT_ARE_EQUAL(size_t, 65536, config.segment_bytes);
+    ASSERT_IS_TRUE(config.messages_per_second == 2.5);
+    ASSERT_ARE_EQUAL(size_t, 8, config.max_in_flight);
+    ASSERT_ARE_EQUAL(size_t, 50, config.sync_interval_ms);
+    ASSERT_ARE_EQUAL(size_t, 2000, config.retry_interval_ms);
+    ASSERT_ARE_EQUAL(size_t, 60, config.metrics_interval_s);
+    free(config.path);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_004: [ If "store" is not an object or has no "path" string then IoTHubStore_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_005: [ If a value of "store" is present and is not a number in range then IoTHubStore_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubStore_ParseConfigurationFromJson_rejects_bad_values)
+{
+    static const char* const bad_args[] =
+    {
+        "{ \"store\": \"q\" }",
+        "{ \"store\": { } }",
+        "{ \"store\": { \"path\": 1 } }",
+        "{ \"store\": { \"path\": \"q\", \"max_bytes\": 0 } }",
+        "{ \"store\": { \"path\": \"q\", \"max_bytes\": \"big\" } }",
+        "{ \"store\": { \"path\": \"q\", \"segment_bytes\": 100 } }",
+        "{ \"store\": { \"path\": \"q\", \"messages_per_second\": -1 } }",
+        "{ \"store\": { \"path\": \"q\", \"max_in_flight\": 0 } }",
+        "{ \"store\": { \"path\": \"q\", \"max_in_flight\": 1.5 } }",
+        "{ \"store\": { \"path\": \"q\", \"sync_interval_ms\": 0 } }",
+        "{ \"store\": { \"path\": \"q\", \"retry_interval_ms\": 0 } }",
+        "{ \"store\": { \"path\": \"q\", \"metrics_interval_s\": -1 } }"
+    };
+    size_t i;
+    for (i = 0; i < sizeof(bad_args) / sizeof(bad_args[0]); i++)
+    {
+        IOTHUB_STORE_CONFIG config;
+        ASSERT_ARE_NOT_EQUAL(int, 0, parse_store_config(bad_args[i], &config));
+    }
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_007: [ If config, config->path or send is NULL, or config->max_in_flight is 0, then IoTHubStore_Create shall fail and return NULL. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_013: [ If handle or record is NULL, or the record is too large for a segment, then IoTHubStore_Append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubStore_rejects_invalid_arguments)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_METRICS metrics;
+    IOTHUB_STORE_HANDLE store;
+
+    ASSERT_IS_NULL(IoTHubStore_Create(NULL, test_send, &g_transport));
+    ASSERT_IS_NULL(IoTHubStore_Create(&config, NULL, &g_transport));
+    config.path = NULL;
+    ASSERT_IS_NULL(IoTHubStore_Create(&config, test_send, &g_transport));
+    config = test_config();
+    config.max_in_flight = 0;
+    ASSERT_IS_NULL(IoTHubStore_Create(&config, test_send, &g_transport));
+
+    config = test_config();
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_Append(NULL, (const unsigned char*)"a", 1));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_Append(store, NULL, 1));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_GetMetrics(store, NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_GetMetrics(NULL, &metrics));
+    IoTHubStore_Complete(NULL, 0, true);
+    IoTHubStore_Stop(NULL);
+    IoTHubStore_Destroy(NULL);
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_012: [ IoTHubStore_Create shall start the forwarder thread with ModuleThread_Create. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_015: [ IoTHubStore_Append shall append the record and its CRC to the current segment, starting a new one first if the record would take it past segment_bytes, and wake the forwarder thread. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_016: [ The forwarder thread shall pass the stored records to send oldest first, with no more than max_in_flight of them not completed. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_024: [ IoTHubStore_GetMetrics shall return the number and size of the queued records, the number in flight, and the totals appended, delivered, dropped, failed and discarded. ]*/
+TEST_FUNCTION(IoTHubStore_forwards_records_in_order)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_METRICS metrics;
+    IOTHUB_STORE_HANDLE store = IoTHubStore_Create(&config, test_send, &g_transport);
+    size_t i;
+    ASSERT_IS_NOT_NULL(store);
+
+    append_numbered(store, 0, 100);
+    wait_for_records(100);
+    wait_for_queue(store, 0);
+
+    for (i = 0; i < 100; i++)
+    {
+        assert_numbered(i, i);
+    }
+    ASSERT_ARE_EQUAL(int, 0, IoTHubStore_GetMetrics(store, &metrics));
+    ASSERT_ARE_EQUAL(int, 100, (int)metrics.appended);
+    ASSERT_ARE_EQUAL(int, 100, (int)metrics.delivered);
+    ASSERT_ARE_EQUAL(int, 0, (int)metrics.queued_bytes);
+    ASSERT_ARE_EQUAL(size_t, 0, metrics.in_flight);
+    ASSERT_ARE_EQUAL(int, 0, (int)metrics.dropped);
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_016: [ The forwarder thread shall pass the stored records to send oldest first, with no more than max_in_flight of them not completed. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_023: [ IoTHubStore_Complete shall confirm the record if delivered is true and have it sent again otherwise. ]*/
+TEST_FUNCTION(IoTHubStore_keeps_no_more_than_max_in_flight_unconfirmed)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_METRICS metrics;
+    IOTHUB_STORE_HANDLE store;
+    size_t i;
+
+    reset_transport(false);
+    config.max_in_flight = 3;
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+
+    append_numbered(store, 0, 10);
+    wait_for_records(3);
+    ThreadAPI_Sleep(50);
+    ASSERT_ARE_EQUAL(size_t, 3, transport_record_count());
+    ASSERT_ARE_EQUAL(int, 0, IoTHubStore_GetMetrics(store, &metrics));
+    ASSERT_ARE_EQUAL(size_t, 3, metrics.in_flight);
+    ASSERT_ARE_EQUAL(size_t, 10, metrics.queued_messages);
+
+    /*confirmations may come out of order, the window only moves past the oldest*/
+    IoTHubStore_Complete(store, g_transport.sequences[1], true);
+    ThreadAPI_Sleep(50);
+    ASSERT_ARE_EQUAL(size_t, 3, transport_record_count());
+    IoTHubStore_Complete(store, g_transport.sequences[0], true);
+    wait_for_records(5);
+    wait_for_queue(store, 8);
+
+    /*each confirmation lets one more go*/
+    for (i = 2; i < 10; i++)
+    {
+        IoTHubStore_Complete(store, g_transport.sequences[i], true);
+        wait_for_records((i + 4 < 10) ? i + 4 : 10);
+    }
+    wait_for_queue(store, 0);
+    for (i = 0; i < 10; i++)
+    {
+        assert_numbered(i, i);
+    }
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_009: [ IoTHubStore_Create shall resume from the position saved in "<path>.checkpoint", or from the first segment if there is none. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_010: [ IoTHubStore_Create shall count the records left in the segments from the saved position on, each segment ending at its first record that is cut short or fails its CRC. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_026: [ IoTHubStore_Destroy shall stop the forwarder thread, sync the current segment, save the position of the oldest record that is not confirmed and free all resources. ]*/
+TEST_FUNCTION(IoTHubStore_sends_unconfirmed_records_again_after_a_restart)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_METRICS metrics;
+    IOTHUB_STORE_HANDLE store;
+    size_t i;
+
+    /*the uplink is down, nothing gets confirmed*/
+    reset_transport(false);
+    config.max_in_flight = 4;
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    append_numbered(store, 0, 20);
+    wait_for_records(4);
+    IoTHubStore_Complete(store, g_transport.sequences[0], true);
+    IoTHubStore_Complete(store, g_transport.sequences[1], true);
+    wait_for_queue(store, 18);
+    IoTHubStore_Destroy(store);
+
+    /*the next run sends what was not confirmed*/
+    reset_transport(true);
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    wait_for_records(18);
+    wait_for_queue(store, 0);
+    for (i = 0; i < 18; i++)
+    {
+        assert_numbered(i, i + 2);
+    }
+    append_numbered(store, 20, 2);
+    wait_for_records(20);
+    assert_numbered(18, 20);
+    assert_numbered(19, 21);
+    wait_for_queue(store, 0);
+    IoTHubStore_Destroy(store);
+
+    /*and the one after that has nothing left*/
+    reset_transport(true);
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    ThreadAPI_Sleep(50);
+    ASSERT_ARE_EQUAL(size_t, 0, transport_record_count());
+    ASSERT_ARE_EQUAL(int, 0, IoTHubStore_GetMetrics(store, &metrics));
+    ASSERT_ARE_EQUAL(size_t, 0, metrics.queued_messages);
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_010: [ IoTHubStore_Create shall count the records left in the segments from the saved position on, each segment ending at its first record that is cut short or fails its CRC. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_011: [ IoTHubStore_Create shall append to a new segment after the existing ones. ]*/
+TEST_FUNCTION(IoTHubStore_drops_a_torn_record_after_a_crash)
+{
+    static const unsigned char torn_record[] = { 0x00, 0x00, 0x00, 0x20, 0x12, 0x34, 0x56, 0x78, 'p', 'a', 'r', 't' };
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_HANDLE store;
+    FILE* f;
+
+    reset_transport(false);
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    append_numbered(store, 0, 3);
+    wait_for_records(3);
+    IoTHubStore_Destroy(store);
+
+    /*a crash in the middle of an append leaves part of a record behind*/
+    f = fopen(TEST_STORE_PATH ".1", "ab");
+    ASSERT_IS_NOT_NULL(f);
+    ASSERT_ARE_EQUAL(size_t, sizeof(torn_record), fwrite(torn_record, 1, sizeof(torn_record), f));
+    (void)fclose(f);
+
+    reset_transport(true);
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    wait_for_queue(store, 0);
+    append_numbered(store, 3, 1);
+    wait_for_records(4);
+    wait_for_queue(store, 0);
+    assert_numbered(0, 0);
+    assert_numbered(1, 1);
+    assert_numbered(2, 2);
+    assert_numbered(3, 3);
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_017: [ If send returns IOTHUB_STORE_SEND_DISCARD the record shall be removed from the store, if it returns IOTHUB_STORE_SEND_RETRY it shall be sent again. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_019: [ Once every send in flight has completed after a failed one, the forwarder thread shall wait retry_interval_ms and send again from the oldest record that is not confirmed. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_023: [ IoTHubStore_Complete shall confirm the record if delivered is true and have it sent again otherwise. ]*/
+TEST_FUNCTION(IoTHubStore_sends_failed_records_again)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_METRICS metrics;
+    IOTHUB_STORE_HANDLE store;
+    size_t i;
+
+    /*the third send fails right away*/
+    g_transport.retry_send = 3;
+    g_transport.discard_mark = '!';
+    config.max_in_flight = 1;
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    append_numbered(store, 0, 3);
+    append_text(store, "!poison");
+    append_numbered(store, 3, 2);
+    wait_for_records(5);
+    wait_for_queue(store, 0);
+    for (i = 0; i < 5; i++)
+    {
+        assert_numbered(i, i);
+    }
+    ASSERT_ARE_EQUAL(int, 0, IoTHubStore_GetMetrics(store, &metrics));
+    ASSERT_ARE_EQUAL(int, 1, (int)metrics.failed);
+    ASSERT_ARE_EQUAL(int, 1, (int)metrics.discarded);
+    ASSERT_ARE_EQUAL(int, 5, (int)metrics.delivered);
+
+    /*a send that is accepted and then fails is sent again too*/
+    reset_transport(false);
+    append_numbered(store, 5, 1);
+    wait_for_records(1);
+    IoTHubStore_Complete(store, g_transport.sequences[0], false);
+    wait_for_records(2);
+    assert_numbered(0, 5);
+    assert_numbered(1, 5);
+    IoTHubStore_Complete(store, g_transport.sequences[1], true);
+    wait_for_queue(store, 0);
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_014: [ If the queued records would take more than max_bytes then IoTHubStore_Append shall drop the record, count it and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubStore_drops_records_when_full)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_METRICS metrics;
+    IOTHUB_STORE_HANDLE store;
+
+    reset_transport(false);
+    config.max_in_flight = 1;
+    /*two records of 8 bytes and their 8 byte headers*/
+    config.max_bytes = 32;
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    append_text(store, "record 1");
+    append_text(store, "record 2");
+    ASSERT_ARE_NOT_EQUAL(int, 0, IoTHubStore_Append(store, (const unsigned char*)"record 3", 8));
+    ASSERT_ARE_EQUAL(int, 0, IoTHubStore_GetMetrics(store, &metrics));
+    ASSERT_ARE_EQUAL(int, 1, (int)metrics.dropped);
+    ASSERT_ARE_EQUAL(size_t, 2, metrics.queued_messages);
+    ASSERT_ARE_EQUAL(int, 32, (int)metrics.queued_bytes);
+
+    /*confirming makes room again*/
+    wait_for_records(1);
+    IoTHubStore_Complete(store, g_transport.sequences[0], true);
+    wait_for_queue(store, 1);
+    append_text(store, "record 4");
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_015: [ IoTHubStore_Append shall append the record and its CRC to the current segment, starting a new one first if the record would take it past segment_bytes, and wake the forwarder thread. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_018: [ A record shall be removed from the store only once it and every record before it is delivered or discarded. ]*/
+/*Tests_SRS_IOTHUBMODULE_34_020: [ Every sync_interval_ms the forwarder thread shall sync the segment being appended to and save the position of the oldest record that is not confirmed. ]*/
+TEST_FUNCTION(IoTHubStore_removes_confirmed_segments)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_HANDLE store;
+    char text[1000];
+    size_t i;
+    size_t waited_ms;
+
+    reset_transport(false);
+    config.segment_bytes = 4096;
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    (void)memset(text, 'x', sizeof(text));
+    /*4 records fit in a segment*/
+    for (i = 0; i < 12; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, IoTHubStore_Append(store, (const unsigned char*)text, sizeof(text)));
+    }
+    ASSERT_ARE_EQUAL(size_t, 3, count_segments());
+
+    /*nothing is removed before it is confirmed*/
+    ThreadAPI_Sleep(50);
+    ASSERT_ARE_EQUAL(size_t, 3, count_segments());
+
+    wait_for_records(12);
+    for (i = 0; i < 9; i++)
+    {
+        IoTHubStore_Complete(store, g_transport.sequences[i], true);
+    }
+    wait_for_queue(store, 3);
+    waited_ms = 0;
+    while (
+        (count_segments() != 1) &&
+        (waited_ms < WAIT_TIMEOUT_MS)
+        )
+    {
+        ThreadAPI_Sleep(1);
+        waited_ms++;
+    }
+    ASSERT_ARE_EQUAL(size_t, 1, count_segments());
+    IoTHubStore_Destroy(store);
+}
+
+/*Tests_SRS_IOTHUBMODULE_34_021: [ If messages_per_second is not 0, the forwarder thread shall not send faster than messages_per_second on average. ]*/
+TEST_FUNCTION(IoTHubStore_limits_the_drain_rate)
+{
+    IOTHUB_STORE_CONFIG config = test_config();
+    IOTHUB_STORE_HANDLE store;
+
+    config.messages_per_second = 50;
+    store = IoTHubStore_Create(&config, test_send, &g_transport);
+    ASSERT_IS_NOT_NULL(store);
+    append_numbered(store, 0, 20);
+    ThreadAPI_Sleep(200);
+    /*about 10 are sent by now, allow for a slow test machine but not for an unlimited rate*/
+    ASSERT_IS_TRUE(transport_record_count() <= 12);
+    ASSERT_IS_TRUE(transport_record_count() >= 1);
+    wait_for_records(20);
+    IoTHubStore_Destroy(store);
+}
+
+END_TEST_SUITE(iothub_store_ut)
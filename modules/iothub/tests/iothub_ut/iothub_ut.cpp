@@ -10,8 +10,10 @@
 #include "module.h"
 #include "module_access.h"
 #include "azure_c_shared_utility/lock.h"
-#include "azure_c_shared_utility/vector.h"
-#include "azure_c_shared_utility/vector_types_internal.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "module_thread.h"
 #include "azure_c_shared_utility/strings.h"
 #include "iothubtransport.h"
 #include "iothub_message.h"
@@ -41,7 +43,6 @@ namespace BASEIMPLEMENTATION
 #undef Lock_Init
 #undef Lock_Deinit
 
-#include "vector.c"
 #include "strings.c"
 };
 
@@ -56,8 +57,8 @@ DEFINE_MICROMOCK_ENUM_TO_STRING(IOTHUBMESSAGE_DISPOSITION_RESULT, IOTHUBMESSAGE_
 static MICROMOCK_MUTEX_HANDLE g_testByTest;
 static MICROMOCK_GLOBAL_SEMAPHORE_HANDLE g_dllByDll;
 
-static size_t currentVECTOR_push_back_call;
-static size_t whenShallVECTOR_push_back_fail;
+static size_t currentIoTHubDeviceMap_Add_call;
+static size_t whenShallIoTHubDeviceMap_Add_fail;
 
 /*different STRING constructors*/
 static size_t currentSTRING_construct_call;
@@ -69,6 +70,19 @@ static size_t whenShallIoTHubMessage_CreateFromByteArray_fail;
 static size_t currentIoTHubClient_Create_call;
 static size_t whenShallIoTHubClient_Create_fail;
 
+static IOTHUB_STORE_SEND IotHub_Store_send_function;
+static void* IotHub_Store_send_context;
+static MESSAGE_HANDLE IotHub_Stored_message;
+static IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK IotHub_SendEventAsync_callback_function;
+static void* IotHub_SendEventAsync_userContext;
+
+/*what the IoTHubBatch mocks report, a batch holds at most the last context it was given*/
+static IOTHUB_BATCH_ADD_RESULT IotHub_Batch_add_result;
+static bool IotHub_Batch_ready;
+static size_t IotHub_Batch_count;
+static bool IotHub_Batch_pending;
+static void* IotHub_Batch_context;
+
 static IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC IotHub_Receive_message_callback_function;
 static void * IotHub_Receive_message_userContext;
 static const char * IotHub_Receive_message_content;
@@ -81,20 +95,47 @@ typedef struct PERSONALITY_TAG
     IOTHUB_CLIENT_HANDLE iothubHandle;
     BROKER_HANDLE broker;
     MODULE_HANDLE module;
+    IOTHUB_BATCH_HANDLE batch;
+    size_t inFlight;
 }PERSONALITY;
 
 typedef PERSONALITY* PERSONALITY_PTR;
 
 typedef struct IOTHUB_HANDLE_DATA_TAG
 {
-    VECTOR_HANDLE personalities; /*holds PERSONALITYs*/
+    IOTHUB_DEVICE_MAP_HANDLE personalities;
+    size_t maxClients;
+    LOCK_HANDLE inFlightLock;
     STRING_HANDLE IoTHubName;
     STRING_HANDLE IoTHubSuffix;
     IOTHUB_CLIENT_TRANSPORT_PROVIDER transportProvider;
     TRANSPORT_HANDLE transportHandle;
     BROKER_HANDLE broker;
+    IOTHUB_STORE_HANDLE store;
+    unsigned char* storeBuffer;
+    int32_t storeBufferSize;
+    IOTHUB_BATCH_CONFIG batchConfig;
+    LOCK_HANDLE lock;
+    COND_HANDLE flushWake;
+    THREAD_HANDLE flushThread;
+    TICK_COUNTER_HANDLE tickCounter;
+    bool stopping;
 }IOTHUB_HANDLE_DATA;
 
+/*what the IoTHubDeviceMap mocks keep, the most recently used device first*/
+#define TEST_DEVICE_MAP_SIZE 8
+typedef struct TEST_DEVICE_MAP_TAG
+{
+    char* deviceNames[TEST_DEVICE_MAP_SIZE];
+    void* values[TEST_DEVICE_MAP_SIZE];
+    size_t count;
+}TEST_DEVICE_MAP;
+
+static size_t personality_count(MODULE_HANDLE module)
+{
+    return ((TEST_DEVICE_MAP*)((IOTHUB_HANDLE_DATA*)module)->personalities)->count;
+}
+
 // NOTE Each of these dummy transport provider functions have to do something a
 // little different (e.g. return a different ptr value), or else the optimizer
 // will collapse them into one function in Release builds.
@@ -229,38 +270,117 @@ public:
         }
     MOCK_METHOD_END(CONSTMAP_RESULT, CONSTMAP_OK)
 
-    MOCK_STATIC_METHOD_1(, VECTOR_HANDLE, VECTOR_create, size_t, elementSize)
-        VECTOR_HANDLE result2 = BASEIMPLEMENTATION::VECTOR_create(elementSize);
-    MOCK_METHOD_END(VECTOR_HANDLE, result2)
+    // device map
+    MOCK_STATIC_METHOD_2(, int, IoTHubDeviceMap_ParseConfigurationFromJson, const JSON_Object*, json, IOTHUB_DEVICE_MAP_CONFIG*, config)
+        config->max_clients = 0;
+    MOCK_METHOD_END(int, 0)
 
-    MOCK_STATIC_METHOD_1(, void, VECTOR_destroy, VECTOR_HANDLE, handle)
-        BASEIMPLEMENTATION::VECTOR_destroy(handle);
-    MOCK_VOID_METHOD_END()
+    MOCK_STATIC_METHOD_0(, IOTHUB_DEVICE_MAP_HANDLE, IoTHubDeviceMap_Create)
+        TEST_DEVICE_MAP* result2 = (TEST_DEVICE_MAP*)BASEIMPLEMENTATION::gballoc_malloc(sizeof(TEST_DEVICE_MAP));
+        result2->count = 0;
+    MOCK_METHOD_END(IOTHUB_DEVICE_MAP_HANDLE, (IOTHUB_DEVICE_MAP_HANDLE)result2)
 
-    MOCK_STATIC_METHOD_3(, int, VECTOR_push_back, VECTOR_HANDLE, handle, const void*, elements, size_t, numElements)
+    MOCK_STATIC_METHOD_2(, void*, IoTHubDeviceMap_Find, IOTHUB_DEVICE_MAP_HANDLE, handle, const char*, deviceName)
+        TEST_DEVICE_MAP* map = (TEST_DEVICE_MAP*)handle;
+        void* result2 = NULL;
+        for (size_t i = 0; i < map->count; i++)
+        {
+            if (strcmp(map->deviceNames[i], deviceName) == 0)
+            {
+                char* foundName = map->deviceNames[i];
+                result2 = map->values[i];
+                for (; i > 0; i--)
+                {
+                    map->deviceNames[i] = map->deviceNames[i - 1];
+                    map->values[i] = map->values[i - 1];
+                }
+                map->deviceNames[0] = foundName;
+                map->values[0] = result2;
+                break;
+            }
+        }
+    MOCK_METHOD_END(void*, result2)
+
+    MOCK_STATIC_METHOD_3(, int, IoTHubDeviceMap_Add, IOTHUB_DEVICE_MAP_HANDLE, handle, const char*, deviceName, void*, value)
+        TEST_DEVICE_MAP* map = (TEST_DEVICE_MAP*)handle;
         int result2;
-        currentVECTOR_push_back_call++;
-        if (currentVECTOR_push_back_call == whenShallVECTOR_push_back_fail)
+        currentIoTHubDeviceMap_Add_call++;
+        if (
+            (currentIoTHubDeviceMap_Add_call == whenShallIoTHubDeviceMap_Add_fail) ||
+            (map->count == TEST_DEVICE_MAP_SIZE)
+            )
         {
             result2 = __LINE__;
         }
         else
         {
-            result2 = BASEIMPLEMENTATION::VECTOR_push_back(handle, elements, numElements);
+            for (size_t i = map->count; i > 0; i--)
+            {
+                map->deviceNames[i] = map->deviceNames[i - 1];
+                map->values[i] = map->values[i - 1];
+            }
+            map->deviceNames[0] = (char*)BASEIMPLEMENTATION::gballoc_malloc(strlen(deviceName) + 1);
+            strcpy(map->deviceNames[0], deviceName);
+            map->values[0] = value;
+            map->count++;
+            result2 = 0;
         }
     MOCK_METHOD_END(int, result2)
 
-    MOCK_STATIC_METHOD_2(, void*, VECTOR_element, VECTOR_HANDLE, handle, size_t, index)
-    MOCK_METHOD_END(void*, BASEIMPLEMENTATION::VECTOR_element(handle, index))
+    MOCK_STATIC_METHOD_1(, size_t, IoTHubDeviceMap_GetCount, IOTHUB_DEVICE_MAP_HANDLE, handle)
+    MOCK_METHOD_END(size_t, ((TEST_DEVICE_MAP*)handle)->count)
+
+    MOCK_STATIC_METHOD_1(, void*, IoTHubDeviceMap_RemoveLeastRecentlyUsed, IOTHUB_DEVICE_MAP_HANDLE, handle)
+        TEST_DEVICE_MAP* map = (TEST_DEVICE_MAP*)handle;
+        void* result2;
+        if (map->count == 0)
+        {
+            result2 = NULL;
+        }
+        else
+        {
+            map->count--;
+            BASEIMPLEMENTATION::gballoc_free(map->deviceNames[map->count]);
+            result2 = map->values[map->count];
+        }
+    MOCK_METHOD_END(void*, result2)
 
-    MOCK_STATIC_METHOD_3(, void*, VECTOR_find_if, VECTOR_HANDLE, handle, PREDICATE_FUNCTION, pred, const void*, value)
-    MOCK_METHOD_END(void*, BASEIMPLEMENTATION::VECTOR_find_if(handle, pred, value))
+    MOCK_STATIC_METHOD_3(, void*, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf, IOTHUB_DEVICE_MAP_HANDLE, handle, IOTHUB_DEVICE_MAP_ACCEPT, accept, void*, context)
+        TEST_DEVICE_MAP* map = (TEST_DEVICE_MAP*)handle;
+        void* result2 = NULL;
+        for (size_t i = map->count; i > 0; i--)
+        {
+            if (accept(context, map->values[i - 1]))
+            {
+                result2 = map->values[i - 1];
+                BASEIMPLEMENTATION::gballoc_free(map->deviceNames[i - 1]);
+                for (; i < map->count; i++)
+                {
+                    map->deviceNames[i - 1] = map->deviceNames[i];
+                    map->values[i - 1] = map->values[i];
+                }
+                map->count--;
+                break;
+            }
+        }
+    MOCK_METHOD_END(void*, result2)
 
-    MOCK_STATIC_METHOD_1(, size_t, VECTOR_size, VECTOR_HANDLE, handle)
-    MOCK_METHOD_END(size_t, BASEIMPLEMENTATION::VECTOR_size(handle))
+    MOCK_STATIC_METHOD_3(, void, IoTHubDeviceMap_ForEach, IOTHUB_DEVICE_MAP_HANDLE, handle, IOTHUB_DEVICE_MAP_VISIT, visit, void*, context)
+        TEST_DEVICE_MAP* map = (TEST_DEVICE_MAP*)handle;
+        for (size_t i = 0; i < map->count; i++)
+        {
+            visit(context, map->values[i]);
+        }
+    MOCK_VOID_METHOD_END()
 
-    MOCK_STATIC_METHOD_1(, void*, VECTOR_back, VECTOR_HANDLE, handle)
-    MOCK_METHOD_END(void*, BASEIMPLEMENTATION::VECTOR_back(handle))
+    MOCK_STATIC_METHOD_1(, void, IoTHubDeviceMap_Destroy, IOTHUB_DEVICE_MAP_HANDLE, handle)
+        TEST_DEVICE_MAP* map = (TEST_DEVICE_MAP*)handle;
+        for (size_t i = 0; i < map->count; i++)
+        {
+            BASEIMPLEMENTATION::gballoc_free(map->deviceNames[i]);
+        }
+        BASEIMPLEMENTATION::gballoc_free(map);
+    MOCK_VOID_METHOD_END()
 
     MOCK_STATIC_METHOD_1(, void, STRING_delete, STRING_HANDLE, s)
         BASEIMPLEMENTATION::STRING_delete(s);
@@ -346,6 +466,10 @@ public:
         {
             result2 = CONSTMAP_HANDLE_VALID_2;
         }
+        else if ((message != NULL) && (message == IotHub_Stored_message))
+        {
+            result2 = CONSTMAP_HANDLE_VALID_1;
+        }
         else
         {
             result2 = NULL;
@@ -408,6 +532,8 @@ public:
     MOCK_METHOD_END(MAP_RESULT, MAP_OK)
 
     MOCK_STATIC_METHOD_4(, IOTHUB_CLIENT_RESULT, IoTHubClient_SendEventAsync, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback)
+        IotHub_SendEventAsync_callback_function = eventConfirmationCallback;
+        IotHub_SendEventAsync_userContext = userContextCallback;
     MOCK_METHOD_END(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK)
 
     MOCK_STATIC_METHOD_3(, IOTHUB_CLIENT_RESULT, IoTHubClient_SetMessageCallback, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC, messageCallback, void*, userContextCallback)
@@ -434,12 +560,161 @@ public:
         {
             result2 = CONSTBUFFER_VALID_2;
         }
+        else if ((message != NULL) && (message == IotHub_Stored_message))
+        {
+            result2 = CONSTBUFFER_VALID_1;
+        }
         else
         {
             result2 = NULL;
         }
     MOCK_METHOD_END(const CONSTBUFFER *, result2)
 
+    MOCK_STATIC_METHOD_3(, int32_t, Message_ToByteArray, MESSAGE_HANDLE, messageHandle, unsigned char*, buf, int32_t, size)
+        if ((buf != NULL) && (size >= 4))
+        {
+            memcpy(buf, "GWMS", 4);
+        }
+    MOCK_METHOD_END(int32_t, 4)
+
+    MOCK_STATIC_METHOD_2(, MESSAGE_HANDLE, Message_CreateFromByteArray, const unsigned char*, source, int32_t, size)
+        IotHub_Stored_message = (MESSAGE_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1);
+    MOCK_METHOD_END(MESSAGE_HANDLE, IotHub_Stored_message)
+
+    // store
+    MOCK_STATIC_METHOD_2(, int, IoTHubStore_ParseConfigurationFromJson, const JSON_Object*, json, IOTHUB_STORE_CONFIG*, config)
+        config->enabled = false;
+        config->path = NULL;
+    MOCK_METHOD_END(int, 0)
+
+    MOCK_STATIC_METHOD_3(, IOTHUB_STORE_HANDLE, IoTHubStore_Create, const IOTHUB_STORE_CONFIG*, config, IOTHUB_STORE_SEND, send, void*, send_context)
+        IotHub_Store_send_function = send;
+        IotHub_Store_send_context = send_context;
+    MOCK_METHOD_END(IOTHUB_STORE_HANDLE, (IOTHUB_STORE_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
+
+    MOCK_STATIC_METHOD_3(, int, IoTHubStore_Append, IOTHUB_STORE_HANDLE, handle, const unsigned char*, record, size_t, size)
+    MOCK_METHOD_END(int, 0)
+
+    MOCK_STATIC_METHOD_3(, void, IoTHubStore_Complete, IOTHUB_STORE_HANDLE, handle, uint64_t, sequence, bool, delivered)
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, void, IoTHubStore_Stop, IOTHUB_STORE_HANDLE, handle)
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, void, IoTHubStore_Destroy, IOTHUB_STORE_HANDLE, handle)
+        BASEIMPLEMENTATION::gballoc_free(handle);
+    MOCK_VOID_METHOD_END()
+
+    // batch
+    MOCK_STATIC_METHOD_2(, int, IoTHubBatch_ParseConfigurationFromJson, const JSON_Object*, json, IOTHUB_BATCH_CONFIG*, config)
+        config->enabled = false;
+    MOCK_METHOD_END(int, 0)
+
+    MOCK_STATIC_METHOD_1(, IOTHUB_BATCH_HANDLE, IoTHubBatch_Create, const IOTHUB_BATCH_CONFIG*, config)
+    MOCK_METHOD_END(IOTHUB_BATCH_HANDLE, (IOTHUB_BATCH_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
+
+    MOCK_STATIC_METHOD_4(, IOTHUB_BATCH_ADD_RESULT, IoTHubBatch_Add, IOTHUB_BATCH_HANDLE, handle, MESSAGE_HANDLE, message, void*, context, tickcounter_ms_t, now)
+        IOTHUB_BATCH_ADD_RESULT result2 = IotHub_Batch_add_result;
+        if (result2 == IOTHUB_BATCH_ADD_OK)
+        {
+            IotHub_Batch_pending = true;
+            IotHub_Batch_context = context;
+        }
+        else if (result2 == IOTHUB_BATCH_ADD_FULL)
+        {
+            /*the next add succeeds*/
+            IotHub_Batch_pending = true;
+            IotHub_Batch_add_result = IOTHUB_BATCH_ADD_OK;
+        }
+    MOCK_METHOD_END(IOTHUB_BATCH_ADD_RESULT, result2)
+
+    MOCK_STATIC_METHOD_1(, size_t, IoTHubBatch_GetCount, IOTHUB_BATCH_HANDLE, handle)
+    MOCK_METHOD_END(size_t, IotHub_Batch_count)
+
+    MOCK_STATIC_METHOD_2(, int, IoTHubBatch_GetDueTime, IOTHUB_BATCH_HANDLE, handle, tickcounter_ms_t*, due)
+    MOCK_METHOD_END(int, __LINE__)
+
+    MOCK_STATIC_METHOD_2(, bool, IoTHubBatch_IsReady, IOTHUB_BATCH_HANDLE, handle, tickcounter_ms_t, now)
+    MOCK_METHOD_END(bool, IotHub_Batch_ready)
+
+    MOCK_STATIC_METHOD_1(, IOTHUB_BATCH_EVENT*, IoTHubBatch_Take, IOTHUB_BATCH_HANDLE, handle)
+        IOTHUB_BATCH_EVENT* result2;
+        if (!IotHub_Batch_pending)
+        {
+            result2 = NULL;
+        }
+        else
+        {
+            IotHub_Batch_pending = false;
+            result2 = (IOTHUB_BATCH_EVENT*)BASEIMPLEMENTATION::gballoc_malloc(sizeof(IOTHUB_BATCH_EVENT));
+            result2->body = (unsigned char*)BASEIMPLEMENTATION::gballoc_malloc(2);
+            result2->body[0] = '[';
+            result2->body[1] = ']';
+            result2->size = 2;
+            result2->count = 1;
+            result2->contexts = (void**)BASEIMPLEMENTATION::gballoc_malloc(sizeof(void*));
+            result2->contexts[0] = IotHub_Batch_context;
+            result2->sender = NULL;
+            IotHub_Batch_context = NULL;
+        }
+    MOCK_METHOD_END(IOTHUB_BATCH_EVENT*, result2)
+
+    MOCK_STATIC_METHOD_1(, void, IoTHubBatch_DestroyEvent, IOTHUB_BATCH_EVENT*, event)
+        BASEIMPLEMENTATION::gballoc_free(event->body);
+        BASEIMPLEMENTATION::gballoc_free(event->contexts);
+        BASEIMPLEMENTATION::gballoc_free(event);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_1(, void, IoTHubBatch_Destroy, IOTHUB_BATCH_HANDLE, handle)
+        BASEIMPLEMENTATION::gballoc_free(handle);
+    MOCK_VOID_METHOD_END()
+
+    // lock, condition, thread and tick counter of the batching
+    MOCK_STATIC_METHOD_0(, LOCK_HANDLE, Lock_Init)
+    MOCK_METHOD_END(LOCK_HANDLE, (LOCK_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
+
+    MOCK_STATIC_METHOD_1(, LOCK_RESULT, Lock, LOCK_HANDLE, handle)
+    MOCK_METHOD_END(LOCK_RESULT, LOCK_OK)
+
+    MOCK_STATIC_METHOD_1(, LOCK_RESULT, Unlock, LOCK_HANDLE, handle)
+    MOCK_METHOD_END(LOCK_RESULT, LOCK_OK)
+
+    MOCK_STATIC_METHOD_1(, LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, handle)
+        BASEIMPLEMENTATION::gballoc_free(handle);
+    MOCK_METHOD_END(LOCK_RESULT, LOCK_OK)
+
+    MOCK_STATIC_METHOD_0(, COND_HANDLE, Condition_Init)
+    MOCK_METHOD_END(COND_HANDLE, (COND_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
+
+    MOCK_STATIC_METHOD_1(, COND_RESULT, Condition_Post, COND_HANDLE, handle)
+    MOCK_METHOD_END(COND_RESULT, COND_OK)
+
+    MOCK_STATIC_METHOD_3(, COND_RESULT, Condition_Wait, COND_HANDLE, handle, LOCK_HANDLE, lock, int, timeout_milliseconds)
+    MOCK_METHOD_END(COND_RESULT, COND_OK)
+
+    MOCK_STATIC_METHOD_1(, void, Condition_Deinit, COND_HANDLE, handle)
+        BASEIMPLEMENTATION::gballoc_free(handle);
+    MOCK_VOID_METHOD_END()
+
+    /*the flush thread is not started, the tests send the batches*/
+    MOCK_STATIC_METHOD_3(, THREADAPI_RESULT, ModuleThread_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg)
+        *threadHandle = (THREAD_HANDLE)0x42;
+    MOCK_METHOD_END(THREADAPI_RESULT, THREADAPI_OK)
+
+    MOCK_STATIC_METHOD_2(, THREADAPI_RESULT, ThreadAPI_Join, THREAD_HANDLE, threadHandle, int*, res)
+    MOCK_METHOD_END(THREADAPI_RESULT, THREADAPI_OK)
+
+    MOCK_STATIC_METHOD_0(, TICK_COUNTER_HANDLE, tickcounter_create)
+    MOCK_METHOD_END(TICK_COUNTER_HANDLE, (TICK_COUNTER_HANDLE)BASEIMPLEMENTATION::gballoc_malloc(1))
+
+    MOCK_STATIC_METHOD_1(, void, tickcounter_destroy, TICK_COUNTER_HANDLE, tick_counter)
+        BASEIMPLEMENTATION::gballoc_free(tick_counter);
+    MOCK_VOID_METHOD_END()
+
+    MOCK_STATIC_METHOD_2(, int, tickcounter_get_current_ms, TICK_COUNTER_HANDLE, tick_counter, tickcounter_ms_t*, current_ms)
+        *current_ms = 1000;
+    MOCK_METHOD_END(int, 0)
+
     // IoTHubMessage
 
     MOCK_STATIC_METHOD_1(, void, IoTHubMessage_Destroy, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
@@ -549,12 +824,15 @@ DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void*, gballoc_malloc, size_t, size)
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, gballoc_free, void*, ptr);
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , CONSTMAP_HANDLE, ConstMap_Clone, CONSTMAP_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, ConstMap_Destroy, CONSTMAP_HANDLE, map);
-DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , VECTOR_HANDLE, VECTOR_create, size_t, elementSize)
-DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , int, VECTOR_push_back, VECTOR_HANDLE, handle, const void*, elements, size_t, numElements)
-DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , void*, VECTOR_element, VECTOR_HANDLE, handle, size_t, index)
-DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , void*, VECTOR_find_if, VECTOR_HANDLE, handle, PREDICATE_FUNCTION, pred, const void*, value)
-DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , size_t, VECTOR_size, VECTOR_HANDLE, handle)
-DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, VECTOR_destroy, VECTOR_HANDLE, handle)
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , int, IoTHubDeviceMap_ParseConfigurationFromJson, const JSON_Object*, json, IOTHUB_DEVICE_MAP_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_0(IotHubMocks, , IOTHUB_DEVICE_MAP_HANDLE, IoTHubDeviceMap_Create);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , void*, IoTHubDeviceMap_Find, IOTHUB_DEVICE_MAP_HANDLE, handle, const char*, deviceName);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , int, IoTHubDeviceMap_Add, IOTHUB_DEVICE_MAP_HANDLE, handle, const char*, deviceName, void*, value);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , size_t, IoTHubDeviceMap_GetCount, IOTHUB_DEVICE_MAP_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void*, IoTHubDeviceMap_RemoveLeastRecentlyUsed, IOTHUB_DEVICE_MAP_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , void*, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf, IOTHUB_DEVICE_MAP_HANDLE, handle, IOTHUB_DEVICE_MAP_ACCEPT, accept, void*, context);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , void, IoTHubDeviceMap_ForEach, IOTHUB_DEVICE_MAP_HANDLE, handle, IOTHUB_DEVICE_MAP_VISIT, visit, void*, context);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, IoTHubDeviceMap_Destroy, IOTHUB_DEVICE_MAP_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, STRING_delete, STRING_HANDLE, s);
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , STRING_HANDLE, STRING_construct, const char*, source);
 DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , int, STRING_concat, STRING_HANDLE, s1, const char*, s2);
@@ -580,7 +858,6 @@ DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , MAP_HANDLE, IoTHubMessage_Properties
 DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , IOTHUB_MESSAGE_RESULT, IoTHubMessage_GetByteArray, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, const unsigned char**, buffer, size_t*, size)
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , const char*, IoTHubMessage_GetString, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , IOTHUBMESSAGE_CONTENT_TYPE, IoTHubMessage_GetContentType, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
-DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void*, VECTOR_back, VECTOR_HANDLE, handle)
 DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , TRANSPORT_HANDLE, IoTHubTransport_Create, IOTHUB_CLIENT_TRANSPORT_PROVIDER, protocol, const char*, iotHubName, const char*, iotHubSuffix)
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, IoTHubTransport_Destroy, TRANSPORT_HANDLE, transportHlHandle)
 DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , BROKER_RESULT, Broker_Publish, BROKER_HANDLE, broker, MODULE_HANDLE, source, MESSAGE_HANDLE, message)
@@ -588,6 +865,36 @@ DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , JSON_Value*, json_parse_string, cons
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , JSON_Object*, json_value_get_object, const JSON_Value*, value);
 DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , const char*, json_object_get_string, const JSON_Object*, object, const char*, name);
 DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, json_value_free, JSON_Value*, value);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , int32_t, Message_ToByteArray, MESSAGE_HANDLE, messageHandle, unsigned char*, buf, int32_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , MESSAGE_HANDLE, Message_CreateFromByteArray, const unsigned char*, source, int32_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , int, IoTHubStore_ParseConfigurationFromJson, const JSON_Object*, json, IOTHUB_STORE_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , IOTHUB_STORE_HANDLE, IoTHubStore_Create, const IOTHUB_STORE_CONFIG*, config, IOTHUB_STORE_SEND, send, void*, send_context);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , int, IoTHubStore_Append, IOTHUB_STORE_HANDLE, handle, const unsigned char*, record, size_t, size);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , void, IoTHubStore_Complete, IOTHUB_STORE_HANDLE, handle, uint64_t, sequence, bool, delivered);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, IoTHubStore_Stop, IOTHUB_STORE_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, IoTHubStore_Destroy, IOTHUB_STORE_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , int, IoTHubBatch_ParseConfigurationFromJson, const JSON_Object*, json, IOTHUB_BATCH_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , IOTHUB_BATCH_HANDLE, IoTHubBatch_Create, const IOTHUB_BATCH_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_4(IotHubMocks, , IOTHUB_BATCH_ADD_RESULT, IoTHubBatch_Add, IOTHUB_BATCH_HANDLE, handle, MESSAGE_HANDLE, message, void*, context, tickcounter_ms_t, now);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , size_t, IoTHubBatch_GetCount, IOTHUB_BATCH_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , int, IoTHubBatch_GetDueTime, IOTHUB_BATCH_HANDLE, handle, tickcounter_ms_t*, due);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , bool, IoTHubBatch_IsReady, IOTHUB_BATCH_HANDLE, handle, tickcounter_ms_t, now);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , IOTHUB_BATCH_EVENT*, IoTHubBatch_Take, IOTHUB_BATCH_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, IoTHubBatch_DestroyEvent, IOTHUB_BATCH_EVENT*, event);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, IoTHubBatch_Destroy, IOTHUB_BATCH_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_0(IotHubMocks, , LOCK_HANDLE, Lock_Init);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , LOCK_RESULT, Lock, LOCK_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , LOCK_RESULT, Unlock, LOCK_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , LOCK_RESULT, Lock_Deinit, LOCK_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_0(IotHubMocks, , COND_HANDLE, Condition_Init);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , COND_RESULT, Condition_Post, COND_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , COND_RESULT, Condition_Wait, COND_HANDLE, handle, LOCK_HANDLE, lock, int, timeout_milliseconds);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, Condition_Deinit, COND_HANDLE, handle);
+DECLARE_GLOBAL_MOCK_METHOD_3(IotHubMocks, , THREADAPI_RESULT, ModuleThread_Create, THREAD_HANDLE*, threadHandle, THREAD_START_FUNC, func, void*, arg);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , THREADAPI_RESULT, ThreadAPI_Join, THREAD_HANDLE, threadHandle, int*, res);
+DECLARE_GLOBAL_MOCK_METHOD_0(IotHubMocks, , TICK_COUNTER_HANDLE, tickcounter_create);
+DECLARE_GLOBAL_MOCK_METHOD_1(IotHubMocks, , void, tickcounter_destroy, TICK_COUNTER_HANDLE, tick_counter);
+DECLARE_GLOBAL_MOCK_METHOD_2(IotHubMocks, , int, tickcounter_get_current_ms, TICK_COUNTER_HANDLE, tick_counter, tickcounter_ms_t*, current_ms);
 
 BEGIN_TEST_SUITE(iothub_ut)
 
@@ -618,8 +925,8 @@ BEGIN_TEST_SUITE(iothub_ut)
             ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
         }
 
-        currentVECTOR_push_back_call = 0;
-        whenShallVECTOR_push_back_fail = 0;
+        currentIoTHubDeviceMap_Add_call = 0;
+        whenShallIoTHubDeviceMap_Add_fail = 0;
 
         currentSTRING_construct_call = 0;
         whenShallSTRING_construct_fail = 0;
@@ -630,6 +937,17 @@ BEGIN_TEST_SUITE(iothub_ut)
         currentIoTHubClient_Create_call = 0;
         whenShallIoTHubClient_Create_fail = 0;
 
+        IotHub_Store_send_function = NULL;
+        IotHub_Store_send_context = NULL;
+        IotHub_Stored_message = NULL;
+        IotHub_SendEventAsync_callback_function = NULL;
+        IotHub_SendEventAsync_userContext = NULL;
+        IotHub_Batch_add_result = IOTHUB_BATCH_ADD_OK;
+        IotHub_Batch_ready = false;
+        IotHub_Batch_count = 1;
+        IotHub_Batch_pending = false;
+        IotHub_Batch_context = NULL;
+
     }
 
     TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -682,6 +1000,12 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen("aHubName") + 1));
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(strlen("suffix.name") + 1));
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(IOTHUB_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
         STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
@@ -696,6 +1020,84 @@ BEGIN_TEST_SUITE(iothub_ut)
         Module_FreeConfiguration(result);
     }
 
+    /*Tests_SRS_IOTHUBMODULE_34_027: [ `IotHub_ParseConfigurationFromJson` shall read the "store" settings by calling `IoTHubStore_ParseConfigurationFromJson`. ]*/
+    /*Tests_SRS_IOTHUBMODULE_34_028: [ If `IoTHubStore_ParseConfigurationFromJson` fails, `IotHub_ParseConfigurationFromJson` shall fail and return NULL. ]*/
+    TEST_FUNCTION(IotHub_ParseConfigurationFromJson_returns_NULL_when_the_store_configuration_is_invalid)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "Transport"))
+            .IgnoreArgument(1)
+            .SetReturn("HTTP");
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn(__LINE__);
+
+        ///act
+        auto result = Module_ParseConfigurationFromJson("don't care");
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_024: [ `IotHub_ParseConfigurationFromJson` shall read the "batch" settings by calling `IoTHubBatch_ParseConfigurationFromJson`. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_025: [ If `IoTHubBatch_ParseConfigurationFromJson` fails, `IotHub_ParseConfigurationFromJson` shall fail and return NULL. ]*/
+    TEST_FUNCTION(IotHub_ParseConfigurationFromJson_returns_NULL_when_the_batch_configuration_is_invalid)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "Transport"))
+            .IgnoreArgument(1)
+            .SetReturn("HTTP");
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn(__LINE__);
+
+        ///act
+        auto result = Module_ParseConfigurationFromJson("don't care");
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_022: [ `IotHub_ParseConfigurationFromJson` shall read the "devices" settings by calling `IoTHubDeviceMap_ParseConfigurationFromJson`. ]*/
+    /*Tests_SRS_IOTHUBMODULE_36_023: [ If `IoTHubDeviceMap_ParseConfigurationFromJson` fails, `IotHub_ParseConfigurationFromJson` shall fail and return NULL. ]*/
+    TEST_FUNCTION(IotHub_ParseConfigurationFromJson_returns_NULL_when_the_devices_configuration_is_invalid)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "Transport"))
+            .IgnoreArgument(1)
+            .SetReturn("HTTP");
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn(__LINE__);
+
+        ///act
+        auto result = Module_ParseConfigurationFromJson("don't care");
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
     TEST_FUNCTION(IotHub_ParseConfigurationFromJson_returns_NULL_when_malloc_fails_1)
     {
         ///arrange
@@ -1160,7 +1562,7 @@ BEGIN_TEST_SUITE(iothub_ut)
     }
 
     /*Tests_SRS_IOTHUBMODULE_02_008: [ Otherwise, `IotHub_Create` shall return a non-`NULL` handle. ]*/
-    /*Tests_SRS_IOTHUBMODULE_02_006: [ `IotHub_Create` shall create an empty `VECTOR` containing pointers to `PERSONALITY`s. ]*/
+    /*Tests_SRS_IOTHUBMODULE_02_006: [ `IotHub_Create` shall create an empty map of `PERSONALITY`s by device name by calling `IoTHubDeviceMap_Create`. ]*/
     /*Tests_SRS_IOTHUBMODULE_17_001: [ If `configuration->transportProvider` is `HTTP_Protocol` or `AMQP_Protocol`, `IotHub_Create` shall create a shared transport by calling `IoTHubTransport_Create`. ]*/
     /*Tests_SRS_IOTHUBMODULE_02_029: [ `IotHub_Create` shall create a copy of `configuration->IoTHubSuffix`. ]*/
     /*Tests_SRS_IOTHUBMODULE_02_028: [ `IotHub_Create` shall create a copy of `configuration->IoTHubName`. ]*/
@@ -1175,8 +1577,7 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
 
         STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
 
@@ -1204,7 +1605,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG));
 
-        EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG));
+        EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
 
         EXPECTED_CALL(mocks, STRING_construct(name));
 
@@ -1232,7 +1633,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG));
 
-        EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG));
+        EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
 
         EXPECTED_CALL(mocks, STRING_construct(name));
 
@@ -1261,7 +1662,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG));
 
-        EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG));
+        EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
 
         EXPECTED_CALL(mocks, STRING_construct(name));
 
@@ -1294,9 +1695,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
@@ -1334,9 +1734,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix))
@@ -1371,9 +1770,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-            .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix))
@@ -1390,8 +1788,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         Module_Destroy(module);
     }
 
-    /*Tests_SRS_IOTHUBMODULE_02_007: [ If creating the personality vector fails then `IotHub_Create` shall fail and return `NULL`. ]*/
-    TEST_FUNCTION(IotHub_Create_fails_when_VECTOR_create_fails)
+    /*Tests_SRS_IOTHUBMODULE_02_007: [ If creating the personality map fails then `IotHub_Create` shall fail and return `NULL`. ]*/
+    TEST_FUNCTION(IotHub_Create_fails_when_IoTHubDeviceMap_Create_fails)
     {
         ///arrange
         IotHubMocks mocks;
@@ -1403,9 +1801,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_create(IGNORED_NUM_ARG))
-            .IgnoreArgument(1)
-            .SetFailReturn((VECTOR_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create())
+            .SetFailReturn((IOTHUB_DEVICE_MAP_HANDLE)NULL);
 
         ///act
         auto module = Module_Create(BROKER_HANDLE_VALID, config);
@@ -1440,6 +1837,111 @@ BEGIN_TEST_SUITE(iothub_ut)
     }
 
     /*Tests_SRS_IOTHUBMODULE_02_023: [ If `moduleHandle` is `NULL` then `IotHub_Destroy` shall return. ]*/
+    /*Tests_SRS_IOTHUBMODULE_34_029: [ `IotHub_FreeConfiguration` shall free the store's `path`. ]*/
+    TEST_FUNCTION(Module_FreeConfiguration_deallocates_the_store_path)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        IOTHUB_CONFIG config = CreateConfig();
+        auto configp = (IOTHUB_CONFIG*)malloc(sizeof(IOTHUB_CONFIG));
+        memcpy(configp, &config, sizeof(IOTHUB_CONFIG));
+        configp->store.enabled = true;
+        configp->store.path = (char*)malloc(2);
+        strcpy(configp->store.path, "q");
+        mocks.ResetAllCalls();
+
+        /*IoTHubName, IoTHubSuffix, store.path and the configuration*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_FreeConfiguration(configp);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_030: [ If `configuration->store.enabled` is true, `IotHub_Create` shall create the store by calling `IoTHubStore_Create` with `IotHub_SendStored` as the send function and the module as its context. ]*/
+    TEST_FUNCTION(IotHub_Create_with_a_store_creates_it)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Create(&((IOTHUB_CONFIG*)config)->store, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(2)
+            .IgnoreArgument(3);
+
+        ///act
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(module);
+        ASSERT_IS_NOT_NULL((void*)IotHub_Store_send_function);
+        ASSERT_ARE_EQUAL(void_ptr, (void*)module, IotHub_Store_send_context);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_031: [ If `IoTHubStore_Create` fails, `IotHub_Create` shall fail and return `NULL`. ]*/
+    TEST_FUNCTION(IotHub_Create_fails_when_IoTHubStore_Create_fails)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn((IOTHUB_STORE_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+
+        ///assert
+        ASSERT_IS_NULL(module);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
     TEST_FUNCTION(IotHub_Destroy_with_NULL_returns)
     {
         ///arrange
@@ -1467,10 +1969,10 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         /*IoTHubName cache*/
@@ -1513,11 +2015,11 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         /*this is the loop trying to dispose of all personalities*/
         /*none for this case*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        /*this is VECTOR<PERSONALITY>*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        /*this is the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         /* transport handle */
@@ -1557,9 +2059,9 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         /*this is the loop trying to dispose of all personalities*/
         /*1 for this case*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1574,8 +2076,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        /*this is VECTOR<PERSONALITY>*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        /*this is the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         /*this is allocated memory*/
@@ -1612,10 +2114,10 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         /*this is the loop trying to dispose of all personalities*/
         /*1 for this case*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_size(IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         /*first element*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 0))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1627,7 +2129,7 @@ BEGIN_TEST_SUITE(iothub_ut)
             .IgnoreArgument(1);
 
         /*second element*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_element(IGNORED_PTR_ARG, 1))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
         STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
@@ -1642,8 +2144,8 @@ BEGIN_TEST_SUITE(iothub_ut)
         STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
-        /*this is VECTOR<PERSONALITY>*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_destroy(IGNORED_PTR_ARG))
+        /*this is the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
             .IgnoreArgument(1);
 
         /*this is allocated memory*/
@@ -1660,30 +2162,70 @@ BEGIN_TEST_SUITE(iothub_ut)
     }
 
     /*Tests_SRS_IOTHUBMODULE_02_009: [ If `moduleHandle` or `messageHandle` is `NULL` then `IotHub_Receive` shall do nothing. ]*/
-    TEST_FUNCTION(IotHub_Receive_with_NULL_moduleHandle_returns)
-    {
-        ///arrange
-        IotHubMocks mocks;
-
-        ///act
-        Module_Receive(NULL, MESSAGE_HANDLE_VALID);
-
-        ///assert
-        mocks.AssertActualAndExpectedCalls();
-
-        ///cleanup
-    }
-
-    /*Tests_SRS_IOTHUBMODULE_02_009: [ If `moduleHandle` or `messageHandle` is `NULL` then `IotHub_Receive` shall do nothing. ]*/
-    TEST_FUNCTION(IotHub_Receive_with_NULL_messageHandle_returns)
+    /*Tests_SRS_IOTHUBMODULE_34_032: [ If the module has a store, `IotHub_Destroy` shall stop its forwarder thread by calling `IoTHubStore_Stop` before destroying the personalities, and destroy it with `IoTHubStore_Destroy` after. ]*/
+    TEST_FUNCTION(IotHub_Destroy_module_with_a_store_stops_it_first_and_destroys_it_last)
     {
         ///arrange
         IotHubMocks mocks;
         AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
         auto module = Module_Create(BROKER_HANDLE_VALID, config);
         mocks.ResetAllCalls();
 
-        ///act
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Stop(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        /*the serialization buffer*/
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Destroy(module);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    TEST_FUNCTION(IotHub_Receive_with_NULL_moduleHandle_returns)
+    {
+        ///arrange
+        IotHubMocks mocks;
+
+        ///act
+        Module_Receive(NULL, MESSAGE_HANDLE_VALID);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_02_009: [ If `moduleHandle` or `messageHandle` is `NULL` then `IotHub_Receive` shall do nothing. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_NULL_messageHandle_returns)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        mocks.ResetAllCalls();
+
+        ///act
         Module_Receive(module, NULL);
 
         ///assert
@@ -1718,8 +2260,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -1751,14 +2292,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -1906,11 +2442,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. One in this test*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
@@ -1990,11 +2522,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_2, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. One in this test*/
-        STRICT_EXPECTED_CALL(mocks, STRING_c_str(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
-
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2026,14 +2554,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -2104,8 +2627,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2137,14 +2659,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -2220,8 +2737,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2254,14 +2770,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -2332,8 +2843,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2366,14 +2876,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -2440,8 +2945,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2472,14 +2976,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -2542,8 +3041,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2574,14 +3072,9 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
-
-        /*getting the location of the personality in the VECTOR*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_back(IGNORED_PTR_ARG))
-            .IgnoreArgument(1);
+        /*adding the personality to the map of personalities*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         { /*scope for creating the IOTHUBMESSAGE from GWMESSAGE*/
 
@@ -2605,7 +3098,7 @@ BEGIN_TEST_SUITE(iothub_ut)
         Module_Destroy(module);
     }
 
-    /*Tests_SRS_IOTHUBMODULE_02_016: [ If adding a new personality to the vector fails, then `IoTHub_Receive` shall return. ]*/
+    /*Tests_SRS_IOTHUBMODULE_02_016: [ If adding a new personality to the map fails, then `IoTHub_Receive` shall return. ]*/
     TEST_FUNCTION(IotHub_Receive_when_adding_the_personality_fails_it_fails)
     {
         ///arrange
@@ -2624,8 +3117,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2666,11 +3158,10 @@ BEGIN_TEST_SUITE(iothub_ut)
                 .IgnoreArgument(3);
         }
 
-        /*adding the personality to the VECTOR or personalities*/
-        whenShallVECTOR_push_back_fail = currentVECTOR_push_back_call + 1;
-        STRICT_EXPECTED_CALL(mocks, VECTOR_push_back(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 1))
-            .IgnoreArgument(1)
-            .IgnoreArgument(2);
+        /*adding the personality to the map of personalities*/
+        whenShallIoTHubDeviceMap_Add_fail = currentIoTHubDeviceMap_Add_call + 1;
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         ///act
         Module_Receive(module, MESSAGE_HANDLE_VALID_1);
@@ -2701,8 +3192,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2748,8 +3238,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2814,8 +3303,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2886,8 +3374,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -2937,8 +3424,7 @@ BEGIN_TEST_SUITE(iothub_ut)
 
         STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
 
-        /*VECTOR_find_if incurs a STRING_c_str until it find the deviceName. None in this test*/
-        STRICT_EXPECTED_CALL(mocks, VECTOR_find_if(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreAllArguments();
 
         /*because the deviceName is brand new, it will be added as a new personality*/
@@ -3453,4 +3939,945 @@ BEGIN_TEST_SUITE(iothub_ut)
         Module_Destroy(module);
     }
 
+    /*Tests_SRS_IOTHUBMODULE_34_033: [ If the module has a store, `IotHub_Receive` shall serialize the message with `Message_ToByteArray` and append it to the store with `IoTHubStore_Append` instead of sending it. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_a_store_appends_the_message)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+
+        /*the serialized size, the buffer for it and the serialization*/
+        STRICT_EXPECTED_CALL(mocks, Message_ToByteArray(MESSAGE_HANDLE_VALID_1, NULL, 0));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(NULL));
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(4));
+        STRICT_EXPECTED_CALL(mocks, Message_ToByteArray(MESSAGE_HANDLE_VALID_1, IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Append(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(1)
+            .ValidateArgumentBuffer(2, "GWMS", 4);
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_033: [ If the module has a store, `IotHub_Receive` shall serialize the message with `Message_ToByteArray` and append it to the store with `IoTHubStore_Append` instead of sending it. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_a_store_reuses_the_serialization_buffer)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_GetProperties(MESSAGE_HANDLE_VALID_1));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "source"));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceName"));
+        STRICT_EXPECTED_CALL(mocks, ConstMap_GetValue(CONSTMAP_HANDLE_VALID_1, "deviceKey"));
+        STRICT_EXPECTED_CALL(mocks, Message_ToByteArray(MESSAGE_HANDLE_VALID_1, NULL, 0));
+        STRICT_EXPECTED_CALL(mocks, Message_ToByteArray(MESSAGE_HANDLE_VALID_1, IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Append(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 4))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_034: [ `IotHub_SendStored` shall recreate the message by calling `Message_CreateFromByteArray`. ]*/
+    /*Tests_SRS_IOTHUBMODULE_34_036: [ `IotHub_SendStored` shall send the message the way `IotHub_Receive` does without a store, passing a confirmation callback that reports the outcome to the store. ]*/
+    /*Tests_SRS_IOTHUBMODULE_34_038: [ When the event is confirmed `IotHub_SendStored`'s confirmation callback shall call `IoTHubStore_Complete` with `delivered` true only if the result is `IOTHUB_CLIENT_CONFIRMATION_OK`. ]*/
+    TEST_FUNCTION(IotHub_SendStored_sends_the_message_and_completes_it_when_confirmed)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_CreateFromByteArray(IGNORED_PTR_ARG, 4))
+            .ValidateArgumentBuffer(1, "GWMS", 4);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_CreateWithTransport(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_CreateFromByteArray(IGNORED_PTR_ARG, 1))
+            .ValidateArgumentBuffer(1, CONSTBUFFER_VALID_CONTENT1.buffer, 1);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "somethingExtra", "blue"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+
+        ///act
+        auto result = IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"GWMS", 4, 7);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_STORE_SEND_ACCEPTED, (int)result);
+        ASSERT_IS_NOT_NULL((void*)IotHub_SendEventAsync_callback_function);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///arrange
+        mocks.ResetAllCalls();
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Complete(store, 7, true));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IotHub_SendEventAsync_userContext));
+
+        ///act
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_OK, IotHub_SendEventAsync_userContext);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_038: [ When the event is confirmed `IotHub_SendStored`'s confirmation callback shall call `IoTHubStore_Complete` with `delivered` true only if the result is `IOTHUB_CLIENT_CONFIRMATION_OK`. ]*/
+    TEST_FUNCTION(IotHub_SendStored_completes_a_message_that_timed_out_as_not_delivered)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        (void)IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"GWMS", 4, 8);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Complete(store, 8, false));
+
+        ///act
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, IotHub_SendEventAsync_userContext);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_035: [ If the message cannot be recreated or has no "deviceName" or "deviceKey", `IotHub_SendStored` shall return `IOTHUB_STORE_SEND_DISCARD`. ]*/
+    TEST_FUNCTION(IotHub_SendStored_discards_a_record_that_is_not_a_message)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Message_CreateFromByteArray(IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreAllArguments()
+            .SetReturn((MESSAGE_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+
+        ///act
+        auto result = IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"junk", 4, 9);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_STORE_SEND_DISCARD, (int)result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_34_037: [ If any other step fails, `IotHub_SendStored` shall return `IOTHUB_STORE_SEND_RETRY`. ]*/
+    TEST_FUNCTION(IotHub_SendStored_asks_for_a_retry_when_IoTHubClient_SendEventAsync_fails)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn(IOTHUB_CLIENT_ERROR);
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Complete(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+
+        ///act
+        auto result = IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"GWMS", 4, 10);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_STORE_SEND_RETRY, (int)result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_026: [ If `configuration->batch.enabled` is true, `IotHub_Create` shall create a lock, a condition and a tick counter and start a thread that sends the batches that are due. ]*/
+    TEST_FUNCTION(IotHub_Create_with_batching_starts_the_flush_thread)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
+        STRICT_EXPECTED_CALL(mocks, tickcounter_create());
+        STRICT_EXPECTED_CALL(mocks, Lock_Init());
+        STRICT_EXPECTED_CALL(mocks, Condition_Init());
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+
+        ///act
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(module);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_027: [ If batching cannot be started, `IotHub_Create` shall fail and return `NULL`. ]*/
+    TEST_FUNCTION(IotHub_Create_fails_when_the_flush_thread_cannot_be_started)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
+        STRICT_EXPECTED_CALL(mocks, tickcounter_create());
+        STRICT_EXPECTED_CALL(mocks, Lock_Init());
+        STRICT_EXPECTED_CALL(mocks, Condition_Init());
+        STRICT_EXPECTED_CALL(mocks, ModuleThread_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn(THREADAPI_ERROR);
+        STRICT_EXPECTED_CALL(mocks, Condition_Deinit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, tickcounter_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+
+        ///assert
+        ASSERT_IS_NULL(module);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_029: [ When batching, a new personality shall get its own batch by a call to `IoTHubBatch_Create`, and the personality is not created if that fails. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_035: [ When batching, a message shall be added to the batch of its device by calling `IoTHubBatch_Add`; if the batch is full it shall be sent first and the message added again. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_037: [ Otherwise, if the message started a new batch, the flush thread shall be woken up to wait for its due time. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_040: [ When batching without a store, `IotHub_Receive` shall add the message to the batch of its device instead of sending it. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_batching_adds_the_message_to_the_batch_of_the_device)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_CreateWithTransport(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Create(&((IOTHUB_HANDLE_DATA*)module)->batchConfig));
+        STRICT_EXPECTED_CALL(mocks, tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, MESSAGE_HANDLE_VALID_1, NULL, 1000))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_IsReady(IGNORED_PTR_ARG, 1000))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_029: [ When batching, a new personality shall get its own batch by a call to `IoTHubBatch_Create`, and the personality is not created if that fails. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_batching_does_not_create_a_personality_without_a_batch)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .SetReturn((IOTHUB_BATCH_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 0, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_030: [ A batch is sent by taking it with `IoTHubBatch_Take` and creating an IoT Hub message of its encoded body with `IoTHubMessage_CreateFromByteArray`. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_031: [ The message of a batch shall have a "batchCount" property holding the number of messages in it. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_032: [ The message of a batch shall be sent with `IoTHubClient_SendEventAsync`, passing a confirmation callback that receives the batch. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_036: [ If the batch is ready after adding the message, it shall be sent right away. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_batching_sends_a_batch_that_is_ready)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        mocks.ResetAllCalls();
+        IotHub_Batch_ready = true;
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, MESSAGE_HANDLE_VALID_1, NULL, 1000))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Take(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_CreateFromByteArray(IGNORED_PTR_ARG, 2))
+            .ValidateArgumentBuffer(1, "[]", 2);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "batchCount", "1"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        ASSERT_IS_NOT_NULL((void*)IotHub_SendEventAsync_callback_function);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///arrange
+        mocks.ResetAllCalls();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_DestroyEvent((IOTHUB_BATCH_EVENT*)IotHub_SendEventAsync_userContext));
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Complete(IGNORED_PTR_ARG, IGNORED_NUM_ARG, IGNORED_NUM_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+
+        ///act
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_OK, IotHub_SendEventAsync_userContext);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_035: [ When batching, a message shall be added to the batch of its device by calling `IoTHubBatch_Add`; if the batch is full it shall be sent first and the message added again. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_batching_sends_a_full_batch_before_adding_the_message)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+        IotHub_Batch_add_result = IOTHUB_BATCH_ADD_FULL;
+        IotHub_Batch_count = 1;
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, MESSAGE_HANDLE_VALID_1, NULL, 1000))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Take(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, MESSAGE_HANDLE_VALID_1, NULL, 1000))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_OK, IotHub_SendEventAsync_userContext);
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_033: [ If the batch cannot be sent, its messages shall be confirmed with `IOTHUB_CLIENT_CONFIRMATION_ERROR`. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_034: [ When a batch is confirmed, each of its messages that came from the store shall be confirmed the way `IotHub_SendStored` confirms a single message. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_039: [ When batching, `IotHub_SendStored` shall add the message to the batch of its device and return `IOTHUB_STORE_SEND_ACCEPTED`, or `IOTHUB_STORE_SEND_RETRY` if that fails. ]*/
+    TEST_FUNCTION(IotHub_SendStored_with_batching_fails_the_stored_messages_of_a_batch_that_cannot_be_sent)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        mocks.ResetAllCalls();
+        IotHub_Batch_ready = true;
+
+        STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, IotHub_Stored_message, IGNORED_PTR_ARG, 1000))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetReturn(IOTHUB_CLIENT_ERROR);
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Complete(store, 11, false));
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_DestroyEvent(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"GWMS", 4, 11);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_STORE_SEND_ACCEPTED, (int)result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_034: [ When a batch is confirmed, each of its messages that came from the store shall be confirmed the way `IotHub_SendStored` confirms a single message. ]*/
+    /*Tests_SRS_IOTHUBMODULE_35_039: [ When batching, `IotHub_SendStored` shall add the message to the batch of its device and return `IOTHUB_STORE_SEND_ACCEPTED`, or `IOTHUB_STORE_SEND_RETRY` if that fails. ]*/
+    TEST_FUNCTION(IotHub_SendStored_with_batching_completes_the_message_when_its_batch_is_confirmed)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        IotHub_Batch_ready = true;
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_STORE_SEND_ACCEPTED, (int)IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"GWMS", 4, 12));
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubStore_Complete(store, 12, true));
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_DestroyEvent((IOTHUB_BATCH_EVENT*)IotHub_SendEventAsync_userContext));
+
+        ///act
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_OK, IotHub_SendEventAsync_userContext);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_039: [ When batching, `IotHub_SendStored` shall add the message to the batch of its device and return `IOTHUB_STORE_SEND_ACCEPTED`, or `IOTHUB_STORE_SEND_RETRY` if that fails. ]*/
+    TEST_FUNCTION(IotHub_SendStored_with_batching_asks_for_a_retry_when_IoTHubBatch_Add_fails)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->store.enabled = true;
+        ((IOTHUB_CONFIG*)config)->store.path = (char*)"q";
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        IOTHUB_STORE_HANDLE store = ((IOTHUB_HANDLE_DATA*)module)->store;
+        mocks.ResetAllCalls();
+        IotHub_Batch_add_result = IOTHUB_BATCH_ADD_ERROR;
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_NUM_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = IotHub_Store_send_function(IotHub_Store_send_context, store, (const unsigned char*)"GWMS", 4, 13);
+
+        ///assert
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_STORE_SEND_RETRY, (int)result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_35_028: [ When batching, `IotHub_Destroy` shall stop the flush thread and send what is left in the batches before destroying the personalities. ]*/
+    TEST_FUNCTION(IotHub_Destroy_with_batching_stops_the_flush_thread_and_sends_the_last_batches)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Lock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Condition_Post(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Unlock(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, ThreadAPI_Join(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+
+        /*the last batch is sent*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_ForEach(IGNORED_PTR_ARG, IGNORED_PTR_ARG, NULL))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Take(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_CreateFromByteArray(IGNORED_PTR_ARG, 2))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Map_AddOrUpdate(IGNORED_PTR_ARG, "batchCount", "1"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        /*then the personality and the module*/
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsed(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Condition_Deinit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, Lock_Deinit(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, tickcounter_destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        Module_Destroy(module);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, IotHub_SendEventAsync_userContext);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_032: [ If `configuration->devices.max_clients` is not 0, `IotHub_Create` shall create a lock guarding the unconfirmed events of the personalities, and fail and return `NULL` if that fails. ]*/
+    TEST_FUNCTION(IotHub_Create_with_max_clients_creates_a_lock)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
+        STRICT_EXPECTED_CALL(mocks, Lock_Init());
+
+        ///act
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(module);
+        ASSERT_IS_NOT_NULL(((IOTHUB_HANDLE_DATA*)module)->inFlightLock);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_032: [ If `configuration->devices.max_clients` is not 0, `IotHub_Create` shall create a lock guarding the unconfirmed events of the personalities, and fail and return `NULL` if that fails. ]*/
+    TEST_FUNCTION(IotHub_Create_with_max_clients_fails_when_the_lock_cannot_be_created)
+    {
+        ///arrange
+        IotHubMocks mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Create());
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(name));
+        STRICT_EXPECTED_CALL(mocks, STRING_construct(suffix));
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Create(HTTP_Protocol, name, suffix));
+        STRICT_EXPECTED_CALL(mocks, Lock_Init())
+            .SetFailReturn((LOCK_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubTransport_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+
+        ///assert
+        ASSERT_IS_NULL(module);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_024: [ `IotHub_Create` shall keep at most `configuration->devices.max_clients` personalities, any number when it is 0. ]*/
+    /*Tests_SRS_IOTHUBMODULE_36_026: [ If the module already has `max_clients` personalities, the least recently used idle one shall be taken out with `IoTHubDeviceMap_RemoveLeastRecentlyUsedIf` and destroyed before a new one is created. ]*/
+    TEST_FUNCTION(IotHub_Receive_evicts_the_least_recently_used_personality_when_max_clients_is_reached)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        IotHub_SendEventAsync_callback_function(IOTHUB_CLIENT_CONFIRMATION_OK, IotHub_SendEventAsync_userContext);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, "secondDevice"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_GetCount(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_CreateWithTransport(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, "secondDevice", IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_033: [ When the module has a `max_clients`, each personality shall count its events that `IoTHubClient_SendEventAsync` accepted until their confirmation callback runs, whatever the result. ]*/
+    /*Tests_SRS_IOTHUBMODULE_36_034: [ A personality is idle when none of its events waits for a confirmation and its batch, if any, is empty. ]*/
+    /*Tests_SRS_IOTHUBMODULE_36_035: [ If no personality is idle, none shall be evicted and the new device shall be refused as if its personality could not be created. ]*/
+    TEST_FUNCTION(IotHub_Receive_does_not_evict_a_personality_with_an_unconfirmed_event)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK confirm = IotHub_SendEventAsync_callback_function;
+        void* confirmContext = IotHub_SendEventAsync_userContext;
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_CreateWithTransport(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+
+        ///assert
+        ASSERT_IS_NOT_NULL((void*)confirm);
+        /*the client with the event was not destroyed, so the event was not completed with IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY*/
+        ASSERT_ARE_EQUAL(size_t, 1, personality_count(module));
+        ASSERT_ARE_EQUAL(size_t, 1, ((PERSONALITY*)confirmContext)->inFlight);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_033: [ When the module has a `max_clients`, each personality shall count its events that `IoTHubClient_SendEventAsync` accepted until their confirmation callback runs, whatever the result. ]*/
+    TEST_FUNCTION(IotHub_Receive_evicts_a_personality_once_its_event_is_confirmed)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK confirm = IotHub_SendEventAsync_callback_function;
+        void* confirmContext = IotHub_SendEventAsync_userContext;
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+        confirm(IOTHUB_CLIENT_CONFIRMATION_ERROR, confirmContext);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, "secondDevice", IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_033: [ When the module has a `max_clients`, each personality shall count its events that `IoTHubClient_SendEventAsync` accepted until their confirmation callback runs, whatever the result. ]*/
+    TEST_FUNCTION(IotHub_Receive_evicts_a_personality_whose_event_could_not_be_sent)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetFailReturn(IOTHUB_CLIENT_ERROR);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Add(IGNORED_PTR_ARG, "secondDevice", IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(3);
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_025: [ `IotHub_Receive` shall look the personality up by calling `IoTHubDeviceMap_Find`, which makes it the most recently used one. ]*/
+    TEST_FUNCTION(IotHub_Receive_does_not_evict_when_the_device_already_has_a_personality)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_Find(IGNORED_PTR_ARG, "firstDevice"))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_GetCount(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_SendEventAsync(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_024: [ `IotHub_Create` shall keep at most `configuration->devices.max_clients` personalities, any number when it is 0. ]*/
+    TEST_FUNCTION(IotHub_Receive_does_not_evict_when_max_clients_is_0)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 2, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Module_Destroy(module);
+    }
+
+    /*Tests_SRS_IOTHUBMODULE_36_034: [ A personality is idle when none of its events waits for a confirmation and its batch, if any, is empty. ]*/
+    /*Tests_SRS_IOTHUBMODULE_36_035: [ If no personality is idle, none shall be evicted and the new device shall be refused as if its personality could not be created. ]*/
+    TEST_FUNCTION(IotHub_Receive_with_batching_does_not_evict_a_personality_with_a_pending_batch)
+    {
+        ///arrange
+        CNiceCallComparer<IotHubMocks> mocks;
+        AutoConfig config;
+        ((IOTHUB_CONFIG*)config)->batch.enabled = true;
+        ((IOTHUB_CONFIG*)config)->devices.max_clients = 1;
+        auto module = Module_Create(BROKER_HANDLE_VALID, config);
+        Module_Receive(module, MESSAGE_HANDLE_VALID_1);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, IoTHubDeviceMap_RemoveLeastRecentlyUsedIf(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Take(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubClient_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Create(IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+        STRICT_EXPECTED_CALL(mocks, IoTHubBatch_Add(IGNORED_PTR_ARG, MESSAGE_HANDLE_VALID_2, NULL, 1000))
+            .IgnoreArgument(1)
+            .NeverInvoked();
+
+        ///act
+        Module_Receive(module, MESSAGE_HANDLE_VALID_2);
+
+        ///assert
+        ASSERT_ARE_EQUAL(size_t, 1, personality_count(module));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        /*the batch would be sent by Module_Destroy and confirmed after its personality is gone*/
+        IotHub_Batch_pending = false;
+        Module_Destroy(module);
+    }
+
 END_TEST_SUITE(iothub_ut)
@@ -5,6 +5,7 @@
 #define LOGGER_H
 
 #include "module.h"
+#include "logger_async.h"
 
 typedef enum LOGGER_TYPE_TAG
 {
@@ -21,6 +22,7 @@ typedef struct LOGGER_CONFIG_TAG
             const char * name;
         } loggerConfigFile;
     } selectee;
+    LOGGER_ASYNC_CONFIG async;
 } LOGGER_CONFIG; /*this needs to be passed to the Module_Create function*/
 
 #ifdef __cplusplus
@@ -0,0 +1,62 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LOGGER_ASYNC_H
+#define LOGGER_ASYNC_H
+
+#include "message.h"
+#include "parson.h"
+#include "logger_segments.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdbool>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdbool.h>
+#endif
+
+#define LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS 1000
+#define LOGGER_ASYNC_DEFAULT_FLUSH_BYTES (256 * 1024)
+
+typedef enum LOGGER_FORMAT_TAG
+{
+    /*one JSON object per line*/
+    LOGGER_FORMAT_JSON,
+    /*length prefixed records holding serialized messages, see logger_binary.h*/
+    LOGGER_FORMAT_BINARY
+} LOGGER_FORMAT;
+
+/*settings of the asynchronous writer, "enabled" is false for the synchronous JSON array writer*/
+typedef struct LOGGER_ASYNC_CONFIG_TAG
+{
+    bool enabled;
+    /*longest time a logged message stays in memory before it is written*/
+    size_t flush_interval_ms;
+    /*amount of buffered output that causes a write*/
+    size_t flush_bytes;
+    LOGGER_FORMAT format;
+    LOGGER_SEGMENTS_CONFIG segments;
+} LOGGER_ASYNC_CONFIG;
+
+typedef struct LOGGER_ASYNC_TAG* LOGGER_ASYNC_HANDLE;
+
+/*reads "async", "flush_interval_ms", "flush_bytes", "format", "max_file_bytes", "max_age_since_open_s", "max_files" and "compress" from the logger's args*/
+extern int LoggerAsync_ParseConfigurationFromJson(const JSON_Object* json, LOGGER_ASYNC_CONFIG* config);
+
+/*opens file_name for appending and starts the writer thread*/
+extern LOGGER_ASYNC_HANDLE LoggerAsync_Create(const char* file_name, const LOGGER_ASYNC_CONFIG* config);
+
+/*queues a clone of message for the writer thread, must not be called concurrently for the same handle*/
+extern int LoggerAsync_Log(LOGGER_ASYNC_HANDLE handle, MESSAGE_HANDLE message);
+
+/*writes what is queued, stops the writer thread and closes the file*/
+extern void LoggerAsync_Destroy(LOGGER_ASYNC_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*LOGGER_ASYNC_H*/
@@ -0,0 +1,60 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LOGGER_BINARY_H
+#define LOGGER_BINARY_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+/*
+ * A binary segment starts with an 8 byte header: "GWLG", the format version
+ * and 3 reserved zero bytes. Records follow back to back, each one being
+ *
+ *     uint32  length of the rest of the record (big endian)
+ *     uint8   LOGGER_BINARY_RECORD_KIND
+ *     int64   time the record was logged, seconds since the epoch (big endian)
+ *     payload for LOGGER_BINARY_RECORD_MESSAGE, the message as serialized by
+ *             Message_ToByteArray, nothing for the other kinds
+ */
+#define LOGGER_BINARY_VERSION 1
+#define LOGGER_BINARY_SEGMENT_HEADER_SIZE 8
+#define LOGGER_BINARY_RECORD_HEADER_SIZE 13
+
+typedef enum LOGGER_BINARY_RECORD_KIND_TAG
+{
+    LOGGER_BINARY_RECORD_MESSAGE = 1,
+    LOGGER_BINARY_RECORD_LOG_STARTED = 2,
+    LOGGER_BINARY_RECORD_LOG_STOPPED = 3
+} LOGGER_BINARY_RECORD_KIND;
+
+typedef struct LOGGER_BINARY_RECORD_TAG
+{
+    LOGGER_BINARY_RECORD_KIND kind;
+    int64_t time;
+    const unsigned char* payload;
+    size_t payload_size;
+} LOGGER_BINARY_RECORD;
+
+extern void LoggerBinary_WriteSegmentHeader(unsigned char* destination);
+
+/*returns 0 if data starts with a segment header of a version this build reads*/
+extern int LoggerBinary_CheckSegmentHeader(const unsigned char* data, size_t size);
+
+extern void LoggerBinary_WriteRecordHeader(unsigned char* destination, LOGGER_BINARY_RECORD_KIND kind, int64_t time, size_t payload_size);
+
+/*reads the record at the start of data, returns 0 and sets *record_size to the bytes it takes, non-zero if data does not hold a whole record*/
+extern int LoggerBinary_ReadRecord(const unsigned char* data, size_t size, LOGGER_BINARY_RECORD* record, size_t* record_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*LOGGER_BINARY_H*/
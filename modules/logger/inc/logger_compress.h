@@ -0,0 +1,39 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LOGGER_COMPRESS_H
+#define LOGGER_COMPRESS_H
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#endif
+
+/*zstd and LZ4 are only available when the logger is built with enable_logger_zstd or enable_logger_lz4*/
+typedef enum LOGGER_COMPRESSION_TAG
+{
+    LOGGER_COMPRESSION_NONE,
+    LOGGER_COMPRESSION_ZSTD,
+    LOGGER_COMPRESSION_LZ4
+} LOGGER_COMPRESSION;
+
+/*maps "none", "zstd" or "lz4" to a LOGGER_COMPRESSION, fails for compressions this build does not have*/
+extern int LoggerCompress_FromString(const char* name, LOGGER_COMPRESSION* compression);
+
+/*file name extension of a compressed segment, "" for LOGGER_COMPRESSION_NONE*/
+extern const char* LoggerCompress_GetExtension(LOGGER_COMPRESSION compression);
+
+/*writes a compressed copy of source_file_name to destination_file_name*/
+extern int LoggerCompress_CompressFile(LOGGER_COMPRESSION compression, const char* source_file_name, const char* destination_file_name);
+
+/*reads file_name into a malloc'ed buffer, decompressing it when its extension says it is compressed*/
+extern int LoggerCompress_ReadFile(const char* file_name, unsigned char** content, size_t* size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*LOGGER_COMPRESS_H*/
@@ -0,0 +1,68 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LOGGER_READER_H
+#define LOGGER_READER_H
+
+#include "logger_binary.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+/*a sparse index entry is kept for every this many records of a segment*/
+#define LOGGER_READER_INDEX_STRIDE 64
+
+/*the most rotated segments LoggerReader_Open looks for, the same as the largest "max_files"*/
+#define LOGGER_READER_MAX_SEGMENTS 1000
+
+typedef struct LOGGER_READER_FILTER_TAG
+{
+    /*messages logged before this time are skipped, seconds since the epoch*/
+    int64_t start_time;
+    /*messages logged at this time or later are skipped, 0 for no limit*/
+    int64_t end_time;
+    /*messages without this property are skipped, NULL for no property filter*/
+    const char* property_name;
+    /*NULL if property_name only has to be present*/
+    const char* property_value;
+} LOGGER_READER_FILTER;
+
+typedef enum LOGGER_READER_RESULT_TAG
+{
+    LOGGER_READER_OK,
+    LOGGER_READER_END,
+    LOGGER_READER_ERROR
+} LOGGER_READER_RESULT;
+
+typedef struct LOGGER_READER_TAG* LOGGER_READER_HANDLE;
+
+/*
+ * maps the binary segments of the log written to file_name, rotated ones
+ * first, oldest to newest, and indexes them by time. Compressed segments
+ * are decompressed into memory instead.
+ */
+extern LOGGER_READER_HANDLE LoggerReader_Open(const char* file_name, const LOGGER_READER_FILTER* filter);
+
+/*
+ * returns the next message record that passes the filter, record->payload
+ * points into the mapping and stays valid until LoggerReader_Close
+ */
+extern LOGGER_READER_RESULT LoggerReader_Next(LOGGER_READER_HANDLE handle, LOGGER_BINARY_RECORD* record);
+
+/*goes back to the first message that passes the filter*/
+extern void LoggerReader_Rewind(LOGGER_READER_HANDLE handle);
+
+extern void LoggerReader_Close(LOGGER_READER_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*LOGGER_READER_H*/
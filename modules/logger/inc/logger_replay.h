@@ -0,0 +1,38 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LOGGER_REPLAY_H
+#define LOGGER_REPLAY_H
+
+#include "module.h"
+
+#ifdef __cplusplus
+#include <cstdint>
+extern "C"
+{
+#else
+#include <stdint.h>
+#endif
+
+/*publishes the messages a logger wrote with "format": "binary" back into the broker*/
+typedef struct LOGGER_REPLAY_CONFIG_TAG
+{
+    /*the "filename" the logger wrote to, its rotated segments are replayed first*/
+    char* file_name;
+    /*0 publishes as fast as the broker takes the messages*/
+    double messages_per_second;
+    int64_t start_time;
+    /*0 for no limit*/
+    int64_t end_time;
+    /*NULL to replay messages whatever their properties*/
+    char* property_name;
+    char* property_value;
+} LOGGER_REPLAY_CONFIG; /*this needs to be passed to the Module_Create function*/
+
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(LOGGER_REPLAY_MODULE)(MODULE_API_VERSION gateway_api_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*LOGGER_REPLAY_H*/
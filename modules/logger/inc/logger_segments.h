@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LOGGER_SEGMENTS_H
+#define LOGGER_SEGMENTS_H
+
+#include "logger_compress.h"
+
+#ifdef __cplusplus
+#include <cstddef>
+extern "C"
+{
+#else
+#include <stddef.h>
+#endif
+
+#define LOGGER_SEGMENTS_DEFAULT_MAX_FILES 8
+
+/*
+ * The active segment is the configured file name. Rotating renames it to
+ * "<name>.1" (compressed to "<name>.1.zst" or "<name>.1.lz4" when asked),
+ * after shifting "<name>.N" to "<name>.N+1" and deleting what would go past
+ * max_files.
+ */
+typedef struct LOGGER_SEGMENTS_CONFIG_TAG
+{
+    /*rotate before the active segment would grow past this, 0 for no limit*/
+    size_t max_file_bytes;
+    /*rotate once the active segment has been open for this long, a restart opens it again, 0 for no limit*/
+    size_t max_age_since_open_s;
+    /*number of rotated segments kept*/
+    size_t max_files;
+    LOGGER_COMPRESSION compression;
+} LOGGER_SEGMENTS_CONFIG;
+
+typedef struct LOGGER_SEGMENTS_TAG* LOGGER_SEGMENTS_HANDLE;
+
+/*opens file_name for appending, header is written at the start of every new segment*/
+extern LOGGER_SEGMENTS_HANDLE LoggerSegments_Open(const char* file_name, const LOGGER_SEGMENTS_CONFIG* config, const unsigned char* header, size_t header_size);
+
+/*appends data to the active segment, rotating first when it is due, data is never split across segments*/
+extern int LoggerSegments_Write(LOGGER_SEGMENTS_HANDLE handle, const unsigned char* data, size_t size);
+
+extern void LoggerSegments_Close(LOGGER_SEGMENTS_HANDLE handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*LOGGER_SEGMENTS_H*/
@@ -24,6 +24,7 @@
 typedef struct LOGGER_HANDLE_DATA_TAG
 {
     FILE* fout;
+    LOGGER_ASYNC_HANDLE async_writer;
 }LOGGER_HANDLE_DATA;
 
 /*this function adds a JSON object to the output*/
@@ -166,8 +167,22 @@ static MODULE_HANDLE Logger_Create(BROKER_HANDLE broker, const void* configurati
                     LogError("malloc failed");
                     /*return as is*/
                 }
+                else if (config->async.enabled)
+                {
+                    /*Codes_SRS_LOGGER_31_018: [ If configuration->async.enabled is true then Logger_Create shall create the writer with LoggerAsync_Create instead of opening the file itself. ]*/
+                    result->fout = NULL;
+                    result->async_writer = LoggerAsync_Create(config->selectee.loggerConfigFile.name, &config->async);
+                    if (result->async_writer == NULL)
+                    {
+                        /*Codes_SRS_LOGGER_02_007: [If Logger_Create encounters any errors while creating the LOGGER_HANDLE_DATA then it shall fail and return NULL.]*/
+                        LogError("unable to create the asynchronous writer for %s", config->selectee.loggerConfigFile.name);
+                        free(result);
+                        result = NULL;
+                    }
+                }
                 else
                 {
+                    result->async_writer = NULL;
                     /*Codes_SRS_LOGGER_02_006: [Logger_Create shall open the file configuration the filename selectee.loggerConfigFile.name in update (reading and writing) mode and assign the result of fopen to fout field. ]*/
                     result->fout = fopen(config->selectee.loggerConfigFile.name, "r+b"); /*open binary file for update (reading and writing)*/
                     if (result->fout == NULL)
@@ -332,11 +347,23 @@ static void* Logger_ParseConfigurationFromJson(const char* configuration)
                         }
                         else
                         {
-                            /*Codes_SRS_LOGGER_17_006: [ Logger_ParseConfigurationFromJson shall return a pointer to the created LOGGER_CONFIG structure. ]*/
-                            /**
-                             * Everything's good.
-                             */
-                             result->selectee.loggerConfigFile.name = (const char *)logfileName;
+                            /*Codes_SRS_LOGGER_31_017: [ Logger_ParseConfigurationFromJson shall read the asynchronous writer settings with LoggerAsync_ParseConfigurationFromJson. ]*/
+                            if (LoggerAsync_ParseConfigurationFromJson(obj, &result->async) != 0)
+                            {
+                                /*Codes_SRS_LOGGER_17_003: [ If any system call fails, Logger_ParseConfigurationFromJson shall fail and return NULL. ]*/
+                                LogError("unable to read the asynchronous writer settings");
+                                free(logfileName);
+                                free(result);
+                                result = NULL;
+                            }
+                            else
+                            {
+                                /*Codes_SRS_LOGGER_17_006: [ Logger_ParseConfigurationFromJson shall return a pointer to the created LOGGER_CONFIG structure. ]*/
+                                /**
+                                 * Everything's good.
+                                 */
+                                result->selectee.loggerConfigFile.name = (const char *)logfileName;
+                            }
                         }
                     }
                 }
@@ -371,15 +398,23 @@ static void Logger_Destroy(MODULE_HANDLE module)
     {
         /*Codes_SRS_LOGGER_02_019: [Logger_Destroy shall add to the log file the following end of log JSON object:]*/
         LOGGER_HANDLE_DATA* moduleHandleData = (LOGGER_HANDLE_DATA *)module;
-        if (append_logStartStop(moduleHandleData->fout, false, false) != 0)
+        if (moduleHandleData->async_writer != NULL)
         {
-            LogError("unable to append log ending time");
+            /*Codes_SRS_LOGGER_31_020: [ If the module has an asynchronous writer then Logger_Destroy shall destroy it with LoggerAsync_Destroy. ]*/
+            LoggerAsync_Destroy(moduleHandleData->async_writer);
         }
-
-        /*Codes_SRS_LOGGER_02_015: [Otherwise Logger_Destroy shall unuse all used resources.]*/
-        if (fclose(moduleHandleData->fout) != 0)
+        else
         {
-            LogError("unable to fclose");
+            if (append_logStartStop(moduleHandleData->fout, false, false) != 0)
+            {
+                LogError("unable to append log ending time");
+            }
+
+            /*Codes_SRS_LOGGER_02_015: [Otherwise Logger_Destroy shall unuse all used resources.]*/
+            if (fclose(moduleHandleData->fout) != 0)
+            {
+                LogError("unable to fclose");
+            }
         }
 
         free(moduleHandleData);
@@ -398,6 +433,14 @@ static void Logger_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHan
     {
         LogError("invalid arg moduleHandle = %p", moduleHandle);
     }
+    else if (((LOGGER_HANDLE_DATA *)moduleHandle)->async_writer != NULL)
+    {
+        /*Codes_SRS_LOGGER_31_019: [ If the module has an asynchronous writer then Logger_Receive shall pass messageHandle to LoggerAsync_Log and return. ]*/
+        if (LoggerAsync_Log(((LOGGER_HANDLE_DATA *)moduleHandle)->async_writer, messageHandle) != 0)
+        {
+            LogError("unable to queue the message for the log writer");
+        }
+    }
     else
     {
         /*Codes_SRS_LOGGER_02_011: [Logger_Receive shall write in the fout FILE the following information in JSON format:]*/
@@ -0,0 +1,859 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger_async.h"
+#include "logger_binary.h"
+#include "module_thread.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/condition.h>
+#include <azure_c_shared_utility/threadapi.h>
+#include <azure_c_shared_utility/tickcounter.h>
+#include <azure_c_shared_utility/constmap.h>
+
+/*
+ * The handoff between Logger_Receive and the writer thread is a single
+ * producer, single consumer ring: the broker never calls a module's
+ * Module_Receive concurrently, so only one thread ever advances "head" and
+ * only the writer thread ever advances "tail". Neither side takes a lock to
+ * pass a message, the lock only guards the writer's sleep.
+ */
+
+#ifdef _MSC_VER
+#include <windows.h>
+typedef volatile LONG LOGGER_ASYNC_INDEX;
+#define LOGGER_ASYNC_READ(index) ((unsigned long)InterlockedCompareExchange(&(index), 0, 0))
+#define LOGGER_ASYNC_PUBLISH(index, value) (void)InterlockedExchange(&(index), (LONG)(value))
+#else
+typedef volatile long LOGGER_ASYNC_INDEX;
+#define LOGGER_ASYNC_READ(index) ((unsigned long)__sync_fetch_and_add(&(index), 0))
+#define LOGGER_ASYNC_PUBLISH(index, value) do { __sync_synchronize(); (void)__sync_lock_test_and_set(&(index), (long)(value)); __sync_synchronize(); } while (0)
+#endif
+
+/*must be a power of 2 so that the free running indexes wrap cleanly*/
+#define LOGGER_ASYNC_QUEUE_CAPACITY 4096
+#define LOGGER_ASYNC_QUEUE_MASK (LOGGER_ASYNC_QUEUE_CAPACITY - 1)
+
+/*room above flush_bytes so the record that crosses the threshold does not grow the buffer*/
+#define LOGGER_ASYNC_BUFFER_HEADROOM 4096
+
+#define LOGGER_ASYNC_MAX_FLUSH_INTERVAL_MS (60 * 60 * 1000)
+#define LOGGER_ASYNC_MAX_FLUSH_BYTES (1024 * 1024 * 1024)
+#define LOGGER_ASYNC_MAX_FILE_BYTES 0x7FFFFFFFL
+#define LOGGER_ASYNC_MAX_AGE_SINCE_OPEN_S (366 * 24 * 60 * 60)
+#define LOGGER_ASYNC_MAX_FILES 1000
+
+/*flush_bytes is capped so that a size limited segment takes at least this many flushes*/
+#define LOGGER_ASYNC_FLUSHES_PER_SEGMENT 8
+
+#define LOGGER_ASYNC_TIME_FORMAT "%c"
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+typedef struct LOGGER_ASYNC_ENTRY_TAG
+{
+    MESSAGE_HANDLE message;
+    time_t time;
+} LOGGER_ASYNC_ENTRY;
+
+typedef struct LOGGER_ASYNC_TAG
+{
+    LOGGER_SEGMENTS_HANDLE segments;
+    LOGGER_FORMAT format;
+    size_t flush_interval_ms;
+    size_t flush_bytes;
+    LOGGER_ASYNC_ENTRY* entries;
+    /*number of entries ever queued, only written by the producer*/
+    LOGGER_ASYNC_INDEX head;
+    /*number of entries ever taken, only written by the writer thread*/
+    LOGGER_ASYNC_INDEX tail;
+    LOGGER_ASYNC_INDEX writer_waiting;
+    LOGGER_ASYNC_INDEX stopping;
+    LOCK_HANDLE lock;
+    COND_HANDLE wake;
+    THREAD_HANDLE thread;
+    TICK_COUNTER_HANDLE tick_counter;
+    /*from here on only touched by the writer thread (and by Create before it starts)*/
+    char* buffer;
+    size_t buffer_size;
+    size_t buffer_capacity;
+    tickcounter_ms_t first_unwritten_ms;
+    time_t formatted_time;
+    char formatted_time_text[80];
+} LOGGER_ASYNC;
+
+static int read_size(const JSON_Value* value, size_t minimum, size_t maximum, size_t* result_value)
+{
+    int result;
+    double number;
+    if (json_value_get_type(value) != JSONNumber)
+    {
+        result = __LINE__;
+    }
+    else if (
+        ((number = json_value_get_number(value)) < (double)minimum) ||
+        (number > (double)maximum) ||
+        ((double)(size_t)number != number)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        *result_value = (size_t)number;
+        result = 0;
+    }
+    return result;
+}
+
+static int read_format(const JSON_Value* value, LOGGER_FORMAT* format)
+{
+    int result;
+    const char* name = json_value_get_string(value);
+    if (name == NULL)
+    {
+        result = __LINE__;
+    }
+    else if (strcmp(name, "json") == 0)
+    {
+        *format = LOGGER_FORMAT_JSON;
+        result = 0;
+    }
+    else if (strcmp(name, "binary") == 0)
+    {
+        *format = LOGGER_FORMAT_BINARY;
+        result = 0;
+    }
+    else
+    {
+        result = __LINE__;
+    }
+    return result;
+}
+
+int LoggerAsync_ParseConfigurationFromJson(const JSON_Object* json, LOGGER_ASYNC_CONFIG* config)
+{
+    int result;
+    /*Codes_SRS_LOGGER_31_001: [ If json or config is NULL then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+    if (
+        (json == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg json=%p config=%p", json, config);
+        result = __LINE__;
+    }
+    else
+    {
+        JSON_Value* async = json_object_get_value(json, "async");
+        JSON_Value* flush_interval = json_object_get_value(json, "flush_interval_ms");
+        JSON_Value* flush_bytes = json_object_get_value(json, "flush_bytes");
+        JSON_Value* format = json_object_get_value(json, "format");
+        JSON_Value* max_file_bytes = json_object_get_value(json, "max_file_bytes");
+        JSON_Value* max_age_since_open = json_object_get_value(json, "max_age_since_open_s");
+        JSON_Value* max_files = json_object_get_value(json, "max_files");
+        JSON_Value* compress = json_object_get_value(json, "compress");
+        bool rotates;
+
+        /*Codes_SRS_LOGGER_31_002: [ Values that are not present shall default to async false, flush_interval_ms LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS and flush_bytes LOGGER_ASYNC_DEFAULT_FLUSH_BYTES. ]*/
+        config->enabled = false;
+        config->flush_interval_ms = LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS;
+        config->flush_bytes = LOGGER_ASYNC_DEFAULT_FLUSH_BYTES;
+        /*Codes_SRS_LOGGER_32_001: [ Values that are not present shall default to format "json", no rotation, max_files LOGGER_SEGMENTS_DEFAULT_MAX_FILES and no compression. ]*/
+        config->format = LOGGER_FORMAT_JSON;
+        config->segments.max_file_bytes = 0;
+        config->segments.max_age_since_open_s = 0;
+        config->segments.max_files = LOGGER_SEGMENTS_DEFAULT_MAX_FILES;
+        config->segments.compression = LOGGER_COMPRESSION_NONE;
+
+        /*Codes_SRS_LOGGER_31_003: [ If "async" is not a boolean, or "flush_interval_ms" or "flush_bytes" is not a whole number in range, then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        if (
+            (async != NULL) &&
+            (json_value_get_type(async) != JSONBoolean)
+            )
+        {
+            LogError("\"async\" must be true or false");
+            result = __LINE__;
+        }
+        else if (
+            (flush_interval != NULL) &&
+            (read_size(flush_interval, 1, LOGGER_ASYNC_MAX_FLUSH_INTERVAL_MS, &config->flush_interval_ms) != 0)
+            )
+        {
+            LogError("\"flush_interval_ms\" must be a whole number from 1 to %d", LOGGER_ASYNC_MAX_FLUSH_INTERVAL_MS);
+            result = __LINE__;
+        }
+        else if (
+            (flush_bytes != NULL) &&
+            (read_size(flush_bytes, 1, LOGGER_ASYNC_MAX_FLUSH_BYTES, &config->flush_bytes) != 0)
+            )
+        {
+            LogError("\"flush_bytes\" must be a whole number from 1 to %d", LOGGER_ASYNC_MAX_FLUSH_BYTES);
+            result = __LINE__;
+        }
+        /*Codes_SRS_LOGGER_32_002: [ If "format" is not "json" or "binary" then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        else if (
+            (format != NULL) &&
+            (read_format(format, &config->format) != 0)
+            )
+        {
+            LogError("\"format\" must be \"json\" or \"binary\"");
+            result = __LINE__;
+        }
+        /*Codes_SRS_LOGGER_32_003: [ If "max_file_bytes", "max_age_since_open_s" or "max_files" is not a whole number in range then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        else if (
+            (max_file_bytes != NULL) &&
+            (read_size(max_file_bytes, 1, LOGGER_ASYNC_MAX_FILE_BYTES, &config->segments.max_file_bytes) != 0)
+            )
+        {
+            LogError("\"max_file_bytes\" must be a whole number from 1 to %ld", (long)LOGGER_ASYNC_MAX_FILE_BYTES);
+            result = __LINE__;
+        }
+        else if (
+            (max_age_since_open != NULL) &&
+            (read_size(max_age_since_open, 1, LOGGER_ASYNC_MAX_AGE_SINCE_OPEN_S, &config->segments.max_age_since_open_s) != 0)
+            )
+        {
+            LogError("\"max_age_since_open_s\" must be a whole number from 1 to %d", LOGGER_ASYNC_MAX_AGE_SINCE_OPEN_S);
+            result = __LINE__;
+        }
+        else if (
+            (max_files != NULL) &&
+            (read_size(max_files, 0, LOGGER_ASYNC_MAX_FILES, &config->segments.max_files) != 0)
+            )
+        {
+            LogError("\"max_files\" must be a whole number from 0 to %d", LOGGER_ASYNC_MAX_FILES);
+            result = __LINE__;
+        }
+        /*Codes_SRS_LOGGER_32_004: [ If "compress" is not a compression this build supports then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+        else if (
+            (compress != NULL) &&
+            (
+                (json_value_get_type(compress) != JSONString) ||
+                (LoggerCompress_FromString(json_value_get_string(compress), &config->segments.compression) != 0)
+            )
+            )
+        {
+            LogError("\"compress\" must be \"none\" or a compression this gateway was built with");
+            result = __LINE__;
+        }
+        else
+        {
+            rotates = (config->segments.max_file_bytes != 0) || (config->segments.max_age_since_open_s != 0);
+            /*Codes_SRS_LOGGER_32_005: [ If "async" is false and "format" is "binary" or a rotation limit is set then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+            if (
+                (async != NULL) &&
+                (json_value_get_boolean(async) != 1) &&
+                ((config->format != LOGGER_FORMAT_JSON) || rotates)
+                )
+            {
+                LogError("\"format\": \"binary\", \"max_file_bytes\" and \"max_age_since_open_s\" need \"async\"");
+                result = __LINE__;
+            }
+            /*Codes_SRS_LOGGER_32_006: [ If "compress" or "max_files" is given without "max_file_bytes" or "max_age_since_open_s" then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+            else if (
+                !rotates &&
+                ((compress != NULL) || (max_files != NULL))
+                )
+            {
+                LogError("\"compress\" and \"max_files\" need \"max_file_bytes\" or \"max_age_since_open_s\"");
+                result = __LINE__;
+            }
+            else
+            {
+                /*Codes_SRS_LOGGER_32_007: [ "format": "binary" and the rotation limits shall enable the asynchronous writer. ]*/
+                config->enabled =
+                    ((async != NULL) && (json_value_get_boolean(async) == 1)) ||
+                    (config->format != LOGGER_FORMAT_JSON) ||
+                    rotates;
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+static size_t json_escaped_length(const char* text)
+{
+    size_t result = 0;
+    const unsigned char* c;
+    for (c = (const unsigned char*)text; *c != '\0'; c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            result += 2;
+        }
+        else if (*c < 0x20)
+        {
+            result += 6;
+        }
+        else
+        {
+            result += 1;
+        }
+    }
+    return result;
+}
+
+/*callers reserve room first, none of the append functions check the capacity*/
+static void append_text(LOGGER_ASYNC* writer, const char* text, size_t length)
+{
+    (void)memcpy(writer->buffer + writer->buffer_size, text, length);
+    writer->buffer_size += length;
+}
+
+static void append_escaped(LOGGER_ASYNC* writer, const char* text)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+    char* out = writer->buffer + writer->buffer_size;
+    const unsigned char* c;
+    for (c = (const unsigned char*)text; *c != '\0'; c++)
+    {
+        if ((*c == '"') || (*c == '\\'))
+        {
+            *out++ = '\\';
+            *out++ = (char)*c;
+        }
+        else if (*c < 0x20)
+        {
+            *out++ = '\\';
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = hex_digits[*c >> 4];
+            *out++ = hex_digits[*c & 0x0F];
+        }
+        else
+        {
+            *out++ = (char)*c;
+        }
+    }
+    writer->buffer_size = out - writer->buffer;
+}
+
+static void append_base64(LOGGER_ASYNC* writer, const unsigned char* source, size_t size)
+{
+    char* out = writer->buffer + writer->buffer_size;
+    size_t i;
+    for (i = 0; i + 2 < size; i += 3)
+    {
+        *out++ = base64_chars[source[i] >> 2];
+        *out++ = base64_chars[((source[i] & 0x03) << 4) | (source[i + 1] >> 4)];
+        *out++ = base64_chars[((source[i + 1] & 0x0F) << 2) | (source[i + 2] >> 6)];
+        *out++ = base64_chars[source[i + 2] & 0x3F];
+    }
+    if (i + 1 == size)
+    {
+        *out++ = base64_chars[source[i] >> 2];
+        *out++ = base64_chars[(source[i] & 0x03) << 4];
+        *out++ = '=';
+        *out++ = '=';
+    }
+    else if (i + 2 == size)
+    {
+        *out++ = base64_chars[source[i] >> 2];
+        *out++ = base64_chars[((source[i] & 0x03) << 4) | (source[i + 1] >> 4)];
+        *out++ = base64_chars[(source[i + 1] & 0x0F) << 2];
+        *out++ = '=';
+    }
+    writer->buffer_size = out - writer->buffer;
+}
+
+static int reserve(LOGGER_ASYNC* writer, size_t length)
+{
+    int result;
+    if (writer->buffer_size + length <= writer->buffer_capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t new_capacity = writer->buffer_capacity;
+        char* new_buffer;
+        while (new_capacity < writer->buffer_size + length)
+        {
+            new_capacity *= 2;
+        }
+        new_buffer = (char*)realloc(writer->buffer, new_capacity);
+        if (new_buffer == NULL)
+        {
+            LogError("unable to grow the log buffer to %zu bytes", new_capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            writer->buffer = new_buffer;
+            writer->buffer_capacity = new_capacity;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static const char* format_time(LOGGER_ASYNC* writer, time_t time_value)
+{
+    /*messages arrive many to a second, strftime only runs when the second changes*/
+    if (
+        (writer->formatted_time_text[0] == '\0') ||
+        (writer->formatted_time != time_value)
+        )
+    {
+        struct tm* t = localtime(&time_value);
+        if (
+            (t == NULL) ||
+            (strftime(writer->formatted_time_text, sizeof(writer->formatted_time_text), LOGGER_ASYNC_TIME_FORMAT, t) == 0)
+            )
+        {
+            LogError("unable to format the time");
+            writer->formatted_time_text[0] = '\0';
+        }
+        writer->formatted_time = time_value;
+    }
+    return writer->formatted_time_text;
+}
+
+static void flush_buffer(LOGGER_ASYNC* writer)
+{
+    if (writer->buffer_size > 0)
+    {
+        /*Codes_SRS_LOGGER_31_014: [ The writer thread shall only append to the file, it shall never seek or rewrite what is written. ]*/
+        /*the buffer only ever holds whole records, so a rotation in LoggerSegments_Write falls on a record boundary*/
+        if (LoggerSegments_Write(writer->segments, (const unsigned char*)writer->buffer, writer->buffer_size) != 0)
+        {
+            LogError("unable to write %zu bytes to the log file", writer->buffer_size);
+        }
+        writer->buffer_size = 0;
+    }
+}
+
+static void note_first_unwritten(LOGGER_ASYNC* writer)
+{
+    if (writer->buffer_size == 0)
+    {
+        if (tickcounter_get_current_ms(writer->tick_counter, &writer->first_unwritten_ms) != 0)
+        {
+            LogError("unable to get the current time");
+        }
+    }
+}
+
+static int append_marker(LOGGER_ASYNC* writer, time_t time_value, LOGGER_BINARY_RECORD_KIND kind, const char* content)
+{
+    int result;
+    if (writer->format == LOGGER_FORMAT_BINARY)
+    {
+        if (reserve(writer, LOGGER_BINARY_RECORD_HEADER_SIZE) != 0)
+        {
+            LogError("unable to add \"%s\" to the log", content);
+            result = __LINE__;
+        }
+        else
+        {
+            note_first_unwritten(writer);
+            LoggerBinary_WriteRecordHeader((unsigned char*)writer->buffer + writer->buffer_size, kind, (int64_t)time_value, 0);
+            writer->buffer_size += LOGGER_BINARY_RECORD_HEADER_SIZE;
+            result = 0;
+        }
+    }
+    else
+    {
+        const char* time_text = format_time(writer, time_value);
+        size_t time_length = strlen(time_text);
+        size_t content_length = strlen(content);
+        /*{"time":"","content":""}\n*/
+        if (reserve(writer, time_length + content_length + 25) != 0)
+        {
+            LogError("unable to add \"%s\" to the log", content);
+            result = __LINE__;
+        }
+        else
+        {
+            note_first_unwritten(writer);
+            append_text(writer, "{\"time\":\"", 9);
+            append_text(writer, time_text, time_length);
+            append_text(writer, "\",\"content\":\"", 13);
+            append_text(writer, content, content_length);
+            append_text(writer, "\"}\n", 3);
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static void append_message_binary(LOGGER_ASYNC* writer, const LOGGER_ASYNC_ENTRY* entry)
+{
+    int32_t payload_size = Message_ToByteArray(entry->message, NULL, 0);
+    if (payload_size <= 0)
+    {
+        LogError("unable to get the serialized size of a message");
+    }
+    else if (reserve(writer, LOGGER_BINARY_RECORD_HEADER_SIZE + (size_t)payload_size) != 0)
+    {
+        LogError("unable to add a message to the log");
+    }
+    else
+    {
+        unsigned char* record = (unsigned char*)writer->buffer + writer->buffer_size;
+        /*Codes_SRS_LOGGER_32_008: [ With "format": "binary" the writer thread shall write each message as a LOGGER_BINARY_RECORD_MESSAGE record holding the message serialized by Message_ToByteArray. ]*/
+        if (Message_ToByteArray(entry->message, record + LOGGER_BINARY_RECORD_HEADER_SIZE, payload_size) != payload_size)
+        {
+            LogError("unable to serialize a message");
+        }
+        else
+        {
+            note_first_unwritten(writer);
+            LoggerBinary_WriteRecordHeader(record, LOGGER_BINARY_RECORD_MESSAGE, (int64_t)entry->time, (size_t)payload_size);
+            writer->buffer_size += LOGGER_BINARY_RECORD_HEADER_SIZE + (size_t)payload_size;
+        }
+    }
+}
+
+static void append_message(LOGGER_ASYNC* writer, const LOGGER_ASYNC_ENTRY* entry)
+{
+    CONSTMAP_HANDLE properties = Message_GetProperties(entry->message); /*by contract this is never NULL*/
+    const CONSTBUFFER* content = Message_GetContent(entry->message); /*by contract this is never NULL*/
+    const char* const* keys;
+    const char* const* values;
+    size_t count;
+    if (properties == NULL)
+    {
+        LogError("unable to get the message properties");
+    }
+    else
+    {
+        if (ConstMap_GetInternals(properties, &keys, &values, &count) != CONSTMAP_OK)
+        {
+            LogError("unable to read the message properties");
+        }
+        else
+        {
+            const unsigned char* content_bytes = ((content == NULL) || (content->buffer == NULL)) ? NULL : content->buffer;
+            size_t content_size = (content_bytes == NULL) ? 0 : content->size;
+            const char* time_text = format_time(writer, entry->time);
+            size_t time_length = strlen(time_text);
+            /*{"time":"","properties":{},"content":""}\n*/
+            size_t length = time_length + 42 + 4 * ((content_size + 2) / 3);
+            size_t i;
+            for (i = 0; i < count; i++)
+            {
+                /*"key":"value",*/
+                length += json_escaped_length(keys[i]) + json_escaped_length(values[i]) + 6;
+            }
+
+            if (reserve(writer, length) != 0)
+            {
+                LogError("unable to add a message to the log");
+            }
+            else
+            {
+                /*Codes_SRS_LOGGER_31_012: [ The writer thread shall write each message as one line holding a JSON object with "time", "properties" and "content" (base64) members. ]*/
+                note_first_unwritten(writer);
+                append_text(writer, "{\"time\":\"", 9);
+                append_text(writer, time_text, time_length);
+                append_text(writer, "\",\"properties\":{", 16);
+                for (i = 0; i < count; i++)
+                {
+                    if (i > 0)
+                    {
+                        append_text(writer, ",", 1);
+                    }
+                    append_text(writer, "\"", 1);
+                    append_escaped(writer, keys[i]);
+                    append_text(writer, "\":\"", 3);
+                    append_escaped(writer, values[i]);
+                    append_text(writer, "\"", 1);
+                }
+                append_text(writer, "},\"content\":\"", 13);
+                append_base64(writer, content_bytes, content_size);
+                append_text(writer, "\"}\n", 3);
+            }
+        }
+        ConstMap_Destroy(properties);
+    }
+}
+
+static void wake_writer(LOGGER_ASYNC* writer)
+{
+    if (Lock(writer->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+    }
+    else
+    {
+        (void)Condition_Post(writer->wake);
+        (void)Unlock(writer->lock);
+    }
+}
+
+static void wait_for_messages(LOGGER_ASYNC* writer, unsigned long tail, tickcounter_ms_t now)
+{
+    if (Lock(writer->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+    }
+    else
+    {
+        /*producers only take the lock when they see writer_waiting, so it is set before the last look at head*/
+        LOGGER_ASYNC_PUBLISH(writer->writer_waiting, 1);
+        if (
+            (LOGGER_ASYNC_READ(writer->head) == tail) &&
+            (LOGGER_ASYNC_READ(writer->stopping) == 0)
+            )
+        {
+            int timeout_ms;
+            if (writer->buffer_size == 0)
+            {
+                /*nothing is due, sleep until a message arrives*/
+                timeout_ms = 0;
+            }
+            else
+            {
+                tickcounter_ms_t elapsed = now - writer->first_unwritten_ms;
+                timeout_ms = (elapsed >= writer->flush_interval_ms) ? 1 : (int)(writer->flush_interval_ms - elapsed);
+            }
+            (void)Condition_Wait(writer->wake, writer->lock, timeout_ms);
+        }
+        LOGGER_ASYNC_PUBLISH(writer->writer_waiting, 0);
+        (void)Unlock(writer->lock);
+    }
+}
+
+static int writer_thread(void* context)
+{
+    LOGGER_ASYNC* writer = (LOGGER_ASYNC*)context;
+    unsigned long tail = LOGGER_ASYNC_READ(writer->tail);
+    bool stopping = false;
+    while (!stopping)
+    {
+        unsigned long head = LOGGER_ASYNC_READ(writer->head);
+        tickcounter_ms_t now;
+        while (tail != head)
+        {
+            LOGGER_ASYNC_ENTRY* entry = &writer->entries[tail & LOGGER_ASYNC_QUEUE_MASK];
+            if (writer->format == LOGGER_FORMAT_BINARY)
+            {
+                append_message_binary(writer, entry);
+            }
+            else
+            {
+                append_message(writer, entry);
+            }
+            Message_Destroy(entry->message);
+            tail++;
+            /*hand the slot back right away so a producer waiting on a full ring can go on*/
+            LOGGER_ASYNC_PUBLISH(writer->tail, tail);
+
+            /*Codes_SRS_LOGGER_31_013: [ The writer thread shall write its buffer to the file when it holds flush_bytes or more, or when the oldest record in it has waited flush_interval_ms. ]*/
+            if (writer->buffer_size >= writer->flush_bytes)
+            {
+                flush_buffer(writer);
+            }
+        }
+
+        if (tickcounter_get_current_ms(writer->tick_counter, &now) != 0)
+        {
+            LogError("unable to get the current time");
+            now = writer->first_unwritten_ms + writer->flush_interval_ms;
+        }
+        if (
+            (writer->buffer_size > 0) &&
+            (now - writer->first_unwritten_ms >= writer->flush_interval_ms)
+            )
+        {
+            flush_buffer(writer);
+        }
+
+        /*stopping is published after the last message, so reading it first makes the head read below final*/
+        stopping = (LOGGER_ASYNC_READ(writer->stopping) != 0) && (LOGGER_ASYNC_READ(writer->head) == tail);
+        if (!stopping)
+        {
+            wait_for_messages(writer, tail, now);
+        }
+    }
+
+    /*Codes_SRS_LOGGER_31_016: [ LoggerAsync_Destroy shall have the writer thread write every queued message followed by {"time":"...","content":"Log stopped"}, then wait for it to finish, close the file and free all resources. ]*/
+    (void)append_marker(writer, time(NULL), LOGGER_BINARY_RECORD_LOG_STOPPED, "Log stopped");
+    flush_buffer(writer);
+    return 0;
+}
+
+static void free_writer(LOGGER_ASYNC* writer)
+{
+    if (writer->tick_counter != NULL)
+    {
+        tickcounter_destroy(writer->tick_counter);
+    }
+    if (writer->wake != NULL)
+    {
+        Condition_Deinit(writer->wake);
+    }
+    if (writer->lock != NULL)
+    {
+        (void)Lock_Deinit(writer->lock);
+    }
+    free(writer->buffer);
+    free(writer->entries);
+    free(writer);
+}
+
+LOGGER_ASYNC_HANDLE LoggerAsync_Create(const char* file_name, const LOGGER_ASYNC_CONFIG* config)
+{
+    LOGGER_ASYNC* result;
+    /*Codes_SRS_LOGGER_31_004: [ If file_name or config is NULL then LoggerAsync_Create shall fail and return NULL. ]*/
+    if (
+        (file_name == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg file_name=%p config=%p", file_name, config);
+        result = NULL;
+    }
+    else if ((result = (LOGGER_ASYNC*)malloc(sizeof(LOGGER_ASYNC))) == NULL)
+    {
+        /*Codes_SRS_LOGGER_31_007: [ If any step fails then LoggerAsync_Create shall release what it acquired and return NULL. ]*/
+        LogError("malloc failed");
+    }
+    else
+    {
+        unsigned char header[LOGGER_BINARY_SEGMENT_HEADER_SIZE];
+        size_t header_size;
+
+        (void)memset(result, 0, sizeof(LOGGER_ASYNC));
+        result->format = config->format;
+        result->flush_interval_ms = config->flush_interval_ms;
+        result->flush_bytes = config->flush_bytes;
+        /*a flush goes to a single segment, keeping it well under max_file_bytes keeps rotated segments close to full*/
+        if (
+            (config->segments.max_file_bytes != 0) &&
+            (result->flush_bytes > config->segments.max_file_bytes / LOGGER_ASYNC_FLUSHES_PER_SEGMENT)
+            )
+        {
+            result->flush_bytes = (config->segments.max_file_bytes < LOGGER_ASYNC_FLUSHES_PER_SEGMENT) ? 1 : config->segments.max_file_bytes / LOGGER_ASYNC_FLUSHES_PER_SEGMENT;
+        }
+        if (result->format == LOGGER_FORMAT_BINARY)
+        {
+            LoggerBinary_WriteSegmentHeader(header);
+            header_size = LOGGER_BINARY_SEGMENT_HEADER_SIZE;
+        }
+        else
+        {
+            header_size = 0;
+        }
+        result->buffer_capacity = result->flush_bytes + LOGGER_ASYNC_BUFFER_HEADROOM;
+
+        if (
+            ((result->entries = (LOGGER_ASYNC_ENTRY*)malloc(sizeof(LOGGER_ASYNC_ENTRY) * LOGGER_ASYNC_QUEUE_CAPACITY)) == NULL) ||
+            ((result->buffer = (char*)malloc(result->buffer_capacity)) == NULL) ||
+            ((result->lock = Lock_Init()) == NULL) ||
+            ((result->wake = Condition_Init()) == NULL) ||
+            ((result->tick_counter = tickcounter_create()) == NULL)
+            )
+        {
+            /*Codes_SRS_LOGGER_31_007: [ If any step fails then LoggerAsync_Create shall release what it acquired and return NULL. ]*/
+            LogError("unable to allocate the log writer");
+            free_writer(result);
+            result = NULL;
+        }
+        /*Codes_SRS_LOGGER_31_005: [ LoggerAsync_Create shall open file_name for appending. ]*/
+        else if ((result->segments = LoggerSegments_Open(file_name, &config->segments, header, header_size)) == NULL)
+        {
+            /*Codes_SRS_LOGGER_31_007: [ If any step fails then LoggerAsync_Create shall release what it acquired and return NULL. ]*/
+            LogError("unable to open file %s", file_name);
+            free_writer(result);
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_LOGGER_31_006: [ LoggerAsync_Create shall buffer {"time":"...","content":"Log started"} and start the writer thread with ModuleThread_Create. ]*/
+            if (
+                (append_marker(result, time(NULL), LOGGER_BINARY_RECORD_LOG_STARTED, "Log started") != 0) ||
+                (ModuleThread_Create(&result->thread, writer_thread, result) != THREADAPI_OK)
+                )
+            {
+                /*Codes_SRS_LOGGER_31_007: [ If any step fails then LoggerAsync_Create shall release what it acquired and return NULL. ]*/
+                LogError("unable to start the log writer thread");
+                LoggerSegments_Close(result->segments);
+                free_writer(result);
+                result = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+int LoggerAsync_Log(LOGGER_ASYNC_HANDLE handle, MESSAGE_HANDLE message)
+{
+    int result;
+    /*Codes_SRS_LOGGER_31_008: [ If handle or message is NULL then LoggerAsync_Log shall fail and return a non-zero value. ]*/
+    if (
+        (handle == NULL) ||
+        (message == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p message=%p", handle, message);
+        result = __LINE__;
+    }
+    else
+    {
+        unsigned long head = LOGGER_ASYNC_READ(handle->head);
+        time_t now = time(NULL);
+
+        /*Codes_SRS_LOGGER_31_010: [ If the queue is full, LoggerAsync_Log shall wake the writer thread and wait for room instead of dropping the message. ]*/
+        while (head - LOGGER_ASYNC_READ(handle->tail) >= LOGGER_ASYNC_QUEUE_CAPACITY)
+        {
+            wake_writer(handle);
+            ThreadAPI_Sleep(1);
+        }
+
+        /*Codes_SRS_LOGGER_31_009: [ LoggerAsync_Log shall queue a clone of message and the current time for the writer thread without taking a lock. ]*/
+        LOGGER_ASYNC_ENTRY* entry = &handle->entries[head & LOGGER_ASYNC_QUEUE_MASK];
+        entry->message = Message_Clone(message);
+        if (entry->message == NULL)
+        {
+            LogError("unable to clone the message");
+            result = __LINE__;
+        }
+        else
+        {
+            entry->time = now;
+            LOGGER_ASYNC_PUBLISH(handle->head, head + 1);
+
+            /*Codes_SRS_LOGGER_31_011: [ LoggerAsync_Log shall wake the writer thread only if it is waiting. ]*/
+            if (LOGGER_ASYNC_READ(handle->writer_waiting) != 0)
+            {
+                wake_writer(handle);
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+void LoggerAsync_Destroy(LOGGER_ASYNC_HANDLE handle)
+{
+    /*Codes_SRS_LOGGER_31_015: [ If handle is NULL then LoggerAsync_Destroy shall return. ]*/
+    if (handle != NULL)
+    {
+        int thread_result;
+
+        /*Codes_SRS_LOGGER_31_016: [ LoggerAsync_Destroy shall have the writer thread write every queued message followed by {"time":"...","content":"Log stopped"}, then wait for it to finish, close the file and free all resources. ]*/
+        LOGGER_ASYNC_PUBLISH(handle->stopping, 1);
+        wake_writer(handle);
+        if (ThreadAPI_Join(handle->thread, &thread_result) != THREADAPI_OK)
+        {
+            LogError("unable to join the log writer thread");
+        }
+
+        LoggerSegments_Close(handle->segments);
+        free_writer(handle);
+    }
+}
@@ -0,0 +1,105 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logger_binary.h"
+
+#include <azure_c_shared_utility/xlogging.h>
+
+static const unsigned char segment_magic[4] = { 'G', 'W', 'L', 'G' };
+
+void LoggerBinary_WriteSegmentHeader(unsigned char* destination)
+{
+    /*Codes_SRS_LOGGER_32_016: [ A binary segment shall start with "GWLG", LOGGER_BINARY_VERSION and 3 zero bytes. ]*/
+    (void)memcpy(destination, segment_magic, sizeof(segment_magic));
+    destination[4] = LOGGER_BINARY_VERSION;
+    destination[5] = 0;
+    destination[6] = 0;
+    destination[7] = 0;
+}
+
+int LoggerBinary_CheckSegmentHeader(const unsigned char* data, size_t size)
+{
+    int result;
+    if (
+        (data == NULL) ||
+        (size < LOGGER_BINARY_SEGMENT_HEADER_SIZE) ||
+        (memcmp(data, segment_magic, sizeof(segment_magic)) != 0)
+        )
+    {
+        result = __LINE__;
+    }
+    else if (data[4] != LOGGER_BINARY_VERSION)
+    {
+        LogError("binary log version %d is not supported", (int)data[4]);
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+void LoggerBinary_WriteRecordHeader(unsigned char* destination, LOGGER_BINARY_RECORD_KIND kind, int64_t time, size_t payload_size)
+{
+    /*Codes_SRS_LOGGER_32_017: [ Every record shall start with its length as a big endian uint32, its kind as a uint8 and its time as a big endian int64 of seconds since the epoch. ]*/
+    uint32_t length = (uint32_t)(LOGGER_BINARY_RECORD_HEADER_SIZE - 4 + payload_size);
+    uint64_t time_bits = (uint64_t)time;
+    int i;
+    destination[0] = (unsigned char)(length >> 24);
+    destination[1] = (unsigned char)(length >> 16);
+    destination[2] = (unsigned char)(length >> 8);
+    destination[3] = (unsigned char)length;
+    destination[4] = (unsigned char)kind;
+    for (i = 0; i < 8; i++)
+    {
+        destination[5 + i] = (unsigned char)(time_bits >> (56 - 8 * i));
+    }
+}
+
+int LoggerBinary_ReadRecord(const unsigned char* data, size_t size, LOGGER_BINARY_RECORD* record, size_t* record_size)
+{
+    int result;
+    if (
+        (data == NULL) ||
+        (record == NULL) ||
+        (record_size == NULL) ||
+        (size < LOGGER_BINARY_RECORD_HEADER_SIZE)
+        )
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        uint32_t length = ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+        if (
+            (length < LOGGER_BINARY_RECORD_HEADER_SIZE - 4) ||
+            ((size_t)length > size - 4)
+            )
+        {
+            /*a torn last record after a power loss ends up here*/
+            result = __LINE__;
+        }
+        else
+        {
+            uint64_t time_bits = 0;
+            int i;
+            for (i = 0; i < 8; i++)
+            {
+                time_bits = (time_bits << 8) | data[5 + i];
+            }
+            record->kind = (LOGGER_BINARY_RECORD_KIND)data[4];
+            record->time = (int64_t)time_bits;
+            record->payload = data + LOGGER_BINARY_RECORD_HEADER_SIZE;
+            record->payload_size = (size_t)length - (LOGGER_BINARY_RECORD_HEADER_SIZE - 4);
+            *record_size = (size_t)length + 4;
+            result = 0;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,566 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger_compress.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+
+#ifdef LOGGER_USE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef LOGGER_USE_LZ4
+#include <lz4frame.h>
+#endif
+
+#define LOGGER_COMPRESS_CHUNK_SIZE (64 * 1024)
+
+/*zstd's default level, fast enough for a gateway to compress a segment between two flushes*/
+#define LOGGER_COMPRESS_ZSTD_LEVEL 3
+
+#define LOGGER_COMPRESS_ZSTD_EXTENSION ".zst"
+#define LOGGER_COMPRESS_LZ4_EXTENSION ".lz4"
+
+int LoggerCompress_FromString(const char* name, LOGGER_COMPRESSION* compression)
+{
+    int result;
+    if (
+        (name == NULL) ||
+        (compression == NULL)
+        )
+    {
+        LogError("invalid arg name=%p compression=%p", name, compression);
+        result = __LINE__;
+    }
+    else if (strcmp(name, "none") == 0)
+    {
+        *compression = LOGGER_COMPRESSION_NONE;
+        result = 0;
+    }
+    else if (strcmp(name, "zstd") == 0)
+    {
+#ifdef LOGGER_USE_ZSTD
+        *compression = LOGGER_COMPRESSION_ZSTD;
+        result = 0;
+#else
+        LogError("the logger was built without zstd, build it with enable_logger_zstd");
+        result = __LINE__;
+#endif
+    }
+    else if (strcmp(name, "lz4") == 0)
+    {
+#ifdef LOGGER_USE_LZ4
+        *compression = LOGGER_COMPRESSION_LZ4;
+        result = 0;
+#else
+        LogError("the logger was built without LZ4, build it with enable_logger_lz4");
+        result = __LINE__;
+#endif
+    }
+    else
+    {
+        LogError("unknown compression \"%s\", expected \"none\", \"zstd\" or \"lz4\"", name);
+        result = __LINE__;
+    }
+    return result;
+}
+
+const char* LoggerCompress_GetExtension(LOGGER_COMPRESSION compression)
+{
+    const char* result;
+    switch (compression)
+    {
+        case LOGGER_COMPRESSION_ZSTD:
+            result = LOGGER_COMPRESS_ZSTD_EXTENSION;
+            break;
+        case LOGGER_COMPRESSION_LZ4:
+            result = LOGGER_COMPRESS_LZ4_EXTENSION;
+            break;
+        default:
+            result = "";
+            break;
+    }
+    return result;
+}
+
+static bool has_extension(const char* file_name, const char* extension)
+{
+    size_t name_length = strlen(file_name);
+    size_t extension_length = strlen(extension);
+    return (name_length > extension_length) && (strcmp(file_name + name_length - extension_length, extension) == 0);
+}
+
+#if defined(LOGGER_USE_ZSTD) || defined(LOGGER_USE_LZ4)
+static int write_all(FILE* out, const unsigned char* data, size_t size)
+{
+    int result;
+    if (fwrite(data, 1, size, out) != size)
+    {
+        LogError("unable to write %zu compressed bytes", size);
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+/*makes room for at least LOGGER_COMPRESS_CHUNK_SIZE more bytes of decompressed output*/
+static int grow_output(unsigned char** buffer, size_t used, size_t* capacity)
+{
+    int result;
+    if (*capacity - used >= LOGGER_COMPRESS_CHUNK_SIZE)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t new_capacity = (*capacity * 2) + LOGGER_COMPRESS_CHUNK_SIZE;
+        unsigned char* new_buffer = (unsigned char*)realloc(*buffer, new_capacity);
+        if (new_buffer == NULL)
+        {
+            LogError("unable to grow the decompression buffer to %zu bytes", new_capacity);
+            result = __LINE__;
+        }
+        else
+        {
+            *buffer = new_buffer;
+            *capacity = new_capacity;
+            result = 0;
+        }
+    }
+    return result;
+}
+#endif
+
+#ifdef LOGGER_USE_ZSTD
+static int compress_zstd(FILE* in, FILE* out)
+{
+    int result;
+    ZSTD_CCtx* context = ZSTD_createCCtx();
+    size_t out_capacity = ZSTD_CStreamOutSize();
+    unsigned char* in_buffer = (unsigned char*)malloc(LOGGER_COMPRESS_CHUNK_SIZE);
+    unsigned char* out_buffer = (unsigned char*)malloc(out_capacity);
+    if (
+        (context == NULL) ||
+        (in_buffer == NULL) ||
+        (out_buffer == NULL)
+        )
+    {
+        LogError("unable to allocate the zstd compressor");
+        result = __LINE__;
+    }
+    else if (ZSTD_isError(ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, LOGGER_COMPRESS_ZSTD_LEVEL)))
+    {
+        LogError("unable to set the zstd compression level");
+        result = __LINE__;
+    }
+    else
+    {
+        bool finished = false;
+        result = 0;
+        while ((result == 0) && !finished)
+        {
+            size_t read = fread(in_buffer, 1, LOGGER_COMPRESS_CHUNK_SIZE, in);
+            ZSTD_EndDirective mode = (read < LOGGER_COMPRESS_CHUNK_SIZE) ? ZSTD_e_end : ZSTD_e_continue;
+            ZSTD_inBuffer input = { in_buffer, read, 0 };
+            bool chunk_done = false;
+            if (ferror(in))
+            {
+                LogError("unable to read the segment");
+                result = __LINE__;
+            }
+            while ((result == 0) && !chunk_done)
+            {
+                ZSTD_outBuffer output = { out_buffer, out_capacity, 0 };
+                size_t remaining = ZSTD_compressStream2(context, &output, &input, mode);
+                if (ZSTD_isError(remaining))
+                {
+                    LogError("zstd compression failed: %s", ZSTD_getErrorName(remaining));
+                    result = __LINE__;
+                }
+                else if (write_all(out, out_buffer, output.pos) != 0)
+                {
+                    result = __LINE__;
+                }
+                else
+                {
+                    /*the last chunk is done once zstd has nothing left to flush, others once zstd took all the input*/
+                    chunk_done = (mode == ZSTD_e_end) ? (remaining == 0) : (input.pos == input.size);
+                }
+            }
+            finished = (mode == ZSTD_e_end);
+        }
+    }
+    (void)ZSTD_freeCCtx(context);
+    free(in_buffer);
+    free(out_buffer);
+    return result;
+}
+
+static int decompress_zstd(const unsigned char* source, size_t source_size, unsigned char** content, size_t* size)
+{
+    int result;
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    unsigned char* buffer = NULL;
+    size_t capacity = 0;
+    size_t used = 0;
+    if (context == NULL)
+    {
+        LogError("unable to allocate the zstd decompressor");
+        result = __LINE__;
+    }
+    else
+    {
+        ZSTD_inBuffer input = { source, source_size, 0 };
+        size_t pending = 0;
+        bool output_full = false;
+        result = 0;
+        while ((result == 0) && ((input.pos < input.size) || output_full))
+        {
+            if (grow_output(&buffer, used, &capacity) != 0)
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                ZSTD_outBuffer output = { buffer + used, capacity - used, 0 };
+                pending = ZSTD_decompressStream(context, &output, &input);
+                if (ZSTD_isError(pending))
+                {
+                    LogError("zstd decompression failed: %s", ZSTD_getErrorName(pending));
+                    result = __LINE__;
+                }
+                else
+                {
+                    used += output.pos;
+                    output_full = (output.pos == output.size);
+                }
+            }
+        }
+
+        if (
+            (result == 0) &&
+            (pending != 0)
+            )
+        {
+            LogError("the zstd segment is truncated");
+            result = __LINE__;
+        }
+        (void)ZSTD_freeDCtx(context);
+    }
+
+    if (result != 0)
+    {
+        free(buffer);
+    }
+    else
+    {
+        *content = buffer;
+        *size = used;
+    }
+    return result;
+}
+#endif
+
+#ifdef LOGGER_USE_LZ4
+static int compress_lz4(FILE* in, FILE* out)
+{
+    int result;
+    LZ4F_cctx* context = NULL;
+    size_t out_capacity = LZ4F_compressBound(LOGGER_COMPRESS_CHUNK_SIZE, NULL);
+    unsigned char* in_buffer = (unsigned char*)malloc(LOGGER_COMPRESS_CHUNK_SIZE);
+    unsigned char* out_buffer = (unsigned char*)malloc(out_capacity);
+    size_t written;
+    if (
+        (in_buffer == NULL) ||
+        (out_buffer == NULL) ||
+        LZ4F_isError(LZ4F_createCompressionContext(&context, LZ4F_VERSION))
+        )
+    {
+        LogError("unable to allocate the LZ4 compressor");
+        result = __LINE__;
+    }
+    else if (
+        LZ4F_isError(written = LZ4F_compressBegin(context, out_buffer, out_capacity, NULL)) ||
+        (write_all(out, out_buffer, written) != 0)
+        )
+    {
+        LogError("unable to start the LZ4 frame");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t read;
+        result = 0;
+        do
+        {
+            read = fread(in_buffer, 1, LOGGER_COMPRESS_CHUNK_SIZE, in);
+            if (ferror(in))
+            {
+                LogError("unable to read the segment");
+                result = __LINE__;
+            }
+            else if (
+                LZ4F_isError(written = LZ4F_compressUpdate(context, out_buffer, out_capacity, in_buffer, read, NULL)) ||
+                (write_all(out, out_buffer, written) != 0)
+                )
+            {
+                LogError("LZ4 compression failed");
+                result = __LINE__;
+            }
+        } while ((result == 0) && (read == LOGGER_COMPRESS_CHUNK_SIZE));
+
+        if (
+            (result == 0) &&
+            (LZ4F_isError(written = LZ4F_compressEnd(context, out_buffer, out_capacity, NULL)) ||
+            (write_all(out, out_buffer, written) != 0))
+            )
+        {
+            LogError("unable to end the LZ4 frame");
+            result = __LINE__;
+        }
+    }
+    if (context != NULL)
+    {
+        (void)LZ4F_freeCompressionContext(context);
+    }
+    free(in_buffer);
+    free(out_buffer);
+    return result;
+}
+
+static int decompress_lz4(const unsigned char* source, size_t source_size, unsigned char** content, size_t* size)
+{
+    int result;
+    LZ4F_dctx* context = NULL;
+    unsigned char* buffer = NULL;
+    size_t capacity = 0;
+    size_t used = 0;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION)))
+    {
+        LogError("unable to allocate the LZ4 decompressor");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t consumed = 0;
+        /*LZ4F_decompress returns 0 once the frame is complete*/
+        size_t hint = 1;
+        bool output_full = false;
+        result = 0;
+        while ((result == 0) && (hint != 0) && ((consumed < source_size) || output_full))
+        {
+            if (grow_output(&buffer, used, &capacity) != 0)
+            {
+                result = __LINE__;
+            }
+            else
+            {
+                size_t offered = capacity - used;
+                size_t produced = offered;
+                size_t taken = source_size - consumed;
+                hint = LZ4F_decompress(context, buffer + used, &produced, source + consumed, &taken, NULL);
+                if (LZ4F_isError(hint))
+                {
+                    LogError("LZ4 decompression failed: %s", LZ4F_getErrorName(hint));
+                    result = __LINE__;
+                }
+                else
+                {
+                    used += produced;
+                    consumed += taken;
+                    output_full = (produced == offered);
+                }
+            }
+        }
+
+        if (
+            (result == 0) &&
+            (hint != 0)
+            )
+        {
+            LogError("the LZ4 segment is truncated");
+            result = __LINE__;
+        }
+        (void)LZ4F_freeDecompressionContext(context);
+    }
+
+    if (result != 0)
+    {
+        free(buffer);
+    }
+    else
+    {
+        *content = buffer;
+        *size = used;
+    }
+    return result;
+}
+#endif
+
+int LoggerCompress_CompressFile(LOGGER_COMPRESSION compression, const char* source_file_name, const char* destination_file_name)
+{
+    int result;
+    if (
+        (source_file_name == NULL) ||
+        (destination_file_name == NULL)
+        )
+    {
+        LogError("invalid arg source_file_name=%p destination_file_name=%p", source_file_name, destination_file_name);
+        result = __LINE__;
+    }
+    else
+    {
+        FILE* in = fopen(source_file_name, "rb");
+        if (in == NULL)
+        {
+            LogError("unable to open %s", source_file_name);
+            result = __LINE__;
+        }
+        else
+        {
+            FILE* out = fopen(destination_file_name, "wb");
+            if (out == NULL)
+            {
+                LogError("unable to create %s", destination_file_name);
+                result = __LINE__;
+            }
+            else
+            {
+                switch (compression)
+                {
+#ifdef LOGGER_USE_ZSTD
+                    case LOGGER_COMPRESSION_ZSTD:
+                        result = compress_zstd(in, out);
+                        break;
+#endif
+#ifdef LOGGER_USE_LZ4
+                    case LOGGER_COMPRESSION_LZ4:
+                        result = compress_lz4(in, out);
+                        break;
+#endif
+                    default:
+                        LogError("compression %d is not available", (int)compression);
+                        result = __LINE__;
+                        break;
+                }
+
+                if (fclose(out) != 0)
+                {
+                    LogError("unable to close %s", destination_file_name);
+                    result = __LINE__;
+                }
+                if (result != 0)
+                {
+                    /*a partial file would look like a good segment*/
+                    (void)remove(destination_file_name);
+                }
+            }
+            (void)fclose(in);
+        }
+    }
+    return result;
+}
+
+static int read_whole_file(const char* file_name, unsigned char** content, size_t* size)
+{
+    int result;
+    FILE* in = fopen(file_name, "rb");
+    if (in == NULL)
+    {
+        LogError("unable to open %s", file_name);
+        result = __LINE__;
+    }
+    else
+    {
+        long file_size;
+        if (
+            (fseek(in, 0, SEEK_END) != 0) ||
+            ((file_size = ftell(in)) < 0) ||
+            (fseek(in, 0, SEEK_SET) != 0)
+            )
+        {
+            LogError("unable to get the size of %s", file_name);
+            result = __LINE__;
+        }
+        else
+        {
+            /*one extra byte so that an empty file still gets a buffer*/
+            unsigned char* buffer = (unsigned char*)malloc((size_t)file_size + 1);
+            if (buffer == NULL)
+            {
+                LogError("unable to allocate %ld bytes", file_size);
+                result = __LINE__;
+            }
+            else if (fread(buffer, 1, (size_t)file_size, in) != (size_t)file_size)
+            {
+                LogError("unable to read %s", file_name);
+                free(buffer);
+                result = __LINE__;
+            }
+            else
+            {
+                *content = buffer;
+                *size = (size_t)file_size;
+                result = 0;
+            }
+        }
+        (void)fclose(in);
+    }
+    return result;
+}
+
+int LoggerCompress_ReadFile(const char* file_name, unsigned char** content, size_t* size)
+{
+    int result;
+    unsigned char* raw;
+    size_t raw_size;
+    if (
+        (file_name == NULL) ||
+        (content == NULL) ||
+        (size == NULL)
+        )
+    {
+        LogError("invalid arg file_name=%p content=%p size=%p", file_name, content, size);
+        result = __LINE__;
+    }
+    else if (read_whole_file(file_name, &raw, &raw_size) != 0)
+    {
+        result = __LINE__;
+    }
+    else if (has_extension(file_name, LOGGER_COMPRESS_ZSTD_EXTENSION))
+    {
+#ifdef LOGGER_USE_ZSTD
+        result = decompress_zstd(raw, raw_size, content, size);
+#else
+        LogError("%s is compressed with zstd, build with enable_logger_zstd to read it", file_name);
+        result = __LINE__;
+#endif
+        free(raw);
+    }
+    else if (has_extension(file_name, LOGGER_COMPRESS_LZ4_EXTENSION))
+    {
+#ifdef LOGGER_USE_LZ4
+        result = decompress_lz4(raw, raw_size, content, size);
+#else
+        LogError("%s is compressed with LZ4, build with enable_logger_lz4 to read it", file_name);
+        result = __LINE__;
+#endif
+        free(raw);
+    }
+    else
+    {
+        *content = raw;
+        *size = raw_size;
+        result = 0;
+    }
+    return result;
+}
@@ -0,0 +1,665 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "logger_reader.h"
+#include "logger_compress.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/crt_abstractions.h>
+
+/*room for ".<index>" and the longest compression extension*/
+#define LOGGER_READER_SUFFIX_LENGTH 32
+
+/*the start of a message as serialized by Message_ToByteArray: 0xA1 0x60, total size, property count*/
+#define LOGGER_READER_MESSAGE_HEADER_SIZE 10
+
+static const LOGGER_COMPRESSION all_compressions[] =
+{
+    LOGGER_COMPRESSION_NONE,
+    LOGGER_COMPRESSION_ZSTD,
+    LOGGER_COMPRESSION_LZ4
+};
+
+typedef struct LOGGER_READER_INDEX_ENTRY_TAG
+{
+    size_t offset;
+    /*latest time of the records before offset, so that it only grows even if the clock went back while logging*/
+    int64_t time_before;
+} LOGGER_READER_INDEX_ENTRY;
+
+typedef struct LOGGER_READER_SEGMENT_TAG
+{
+    const unsigned char* data;
+    size_t size;
+    /*data is mapped, or malloc'ed for a compressed segment*/
+    bool in_heap;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+    LOGGER_READER_INDEX_ENTRY* index;
+    size_t index_count;
+    int64_t min_time;
+    int64_t max_time;
+    /*records after this are torn*/
+    size_t end;
+} LOGGER_READER_SEGMENT;
+
+typedef struct LOGGER_READER_TAG
+{
+    LOGGER_READER_FILTER filter;
+    char* property_name;
+    char* property_value;
+    LOGGER_READER_SEGMENT* segments;
+    size_t segment_count;
+    size_t current_segment;
+    size_t current_offset;
+    /*false until current_offset is positioned in current_segment*/
+    bool positioned;
+} LOGGER_READER;
+
+static uint32_t read_uint32(const unsigned char* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+static bool file_exists(const char* file_name)
+{
+    FILE* f = fopen(file_name, "rb");
+    if (f != NULL)
+    {
+        (void)fclose(f);
+    }
+    return f != NULL;
+}
+
+/*returns the extension the segment numbered index has, NULL if there is none*/
+static const char* find_segment(const char* file_name, size_t index, char* scratch)
+{
+    const char* result = NULL;
+    size_t i;
+    for (i = 0; (result == NULL) && (i < sizeof(all_compressions) / sizeof(all_compressions[0])); i++)
+    {
+        (void)sprintf(scratch, "%s.%lu%s", file_name, (unsigned long)index, LoggerCompress_GetExtension(all_compressions[i]));
+        if (file_exists(scratch))
+        {
+            result = LoggerCompress_GetExtension(all_compressions[i]);
+        }
+    }
+    return result;
+}
+
+#ifdef _WIN32
+static int map_segment(const char* file_name, LOGGER_READER_SEGMENT* segment)
+{
+    int result;
+    LARGE_INTEGER size;
+    segment->file = CreateFileA(file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (segment->file == INVALID_HANDLE_VALUE)
+    {
+        LogError("unable to open %s", file_name);
+        segment->file = NULL;
+        result = __LINE__;
+    }
+    else if (!GetFileSizeEx(segment->file, &size))
+    {
+        LogError("unable to get the size of %s", file_name);
+        result = __LINE__;
+    }
+    else if (size.QuadPart == 0)
+    {
+        /*an empty file cannot be mapped and holds nothing anyway*/
+        segment->data = NULL;
+        segment->size = 0;
+        result = 0;
+    }
+    else if ((segment->mapping = CreateFileMappingA(segment->file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL)
+    {
+        LogError("unable to map %s", file_name);
+        result = __LINE__;
+    }
+    else if ((segment->data = (const unsigned char*)MapViewOfFile(segment->mapping, FILE_MAP_READ, 0, 0, 0)) == NULL)
+    {
+        LogError("unable to map %s", file_name);
+        result = __LINE__;
+    }
+    else
+    {
+        segment->size = (size_t)size.QuadPart;
+        result = 0;
+    }
+    return result;
+}
+
+static void unmap_segment(LOGGER_READER_SEGMENT* segment)
+{
+    if (segment->data != NULL)
+    {
+        (void)UnmapViewOfFile(segment->data);
+    }
+    if (segment->mapping != NULL)
+    {
+        (void)CloseHandle(segment->mapping);
+    }
+    if (segment->file != NULL)
+    {
+        (void)CloseHandle(segment->file);
+    }
+}
+#else
+static int map_segment(const char* file_name, LOGGER_READER_SEGMENT* segment)
+{
+    int result;
+    int fd = open(file_name, O_RDONLY);
+    if (fd < 0)
+    {
+        LogError("unable to open %s", file_name);
+        result = __LINE__;
+    }
+    else
+    {
+        struct stat file_stat;
+        void* data;
+        if (fstat(fd, &file_stat) != 0)
+        {
+            LogError("unable to get the size of %s", file_name);
+            result = __LINE__;
+        }
+        else if (file_stat.st_size == 0)
+        {
+            /*an empty file cannot be mapped and holds nothing anyway*/
+            segment->data = NULL;
+            segment->size = 0;
+            result = 0;
+        }
+        else if ((data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+        {
+            LogError("unable to map %s", file_name);
+            result = __LINE__;
+        }
+        else
+        {
+            /*records are read front to back*/
+            (void)madvise(data, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+            segment->data = (const unsigned char*)data;
+            segment->size = (size_t)file_stat.st_size;
+            result = 0;
+        }
+        /*the mapping keeps the file*/
+        (void)close(fd);
+    }
+    return result;
+}
+
+static void unmap_segment(LOGGER_READER_SEGMENT* segment)
+{
+    if (segment->data != NULL)
+    {
+        (void)munmap((void*)segment->data, segment->size);
+    }
+}
+#endif
+
+static void release_segment(LOGGER_READER_SEGMENT* segment)
+{
+    if (segment->in_heap)
+    {
+        free((void*)segment->data);
+    }
+    else
+    {
+        unmap_segment(segment);
+    }
+    free(segment->index);
+}
+
+/*walks the record headers once, the payloads are not touched*/
+static int index_segment(const char* file_name, LOGGER_READER_SEGMENT* segment)
+{
+    int result;
+    size_t record_count = 0;
+    size_t offset = LOGGER_BINARY_SEGMENT_HEADER_SIZE;
+    size_t capacity = 0;
+    LOGGER_BINARY_RECORD record;
+    size_t record_size;
+
+    segment->min_time = INT64_MAX;
+    segment->max_time = INT64_MIN;
+    result = 0;
+    while (
+        (result == 0) &&
+        (offset < segment->size) &&
+        (LoggerBinary_ReadRecord(segment->data + offset, segment->size - offset, &record, &record_size) == 0)
+        )
+    {
+        if (record_count % LOGGER_READER_INDEX_STRIDE == 0)
+        {
+            if (segment->index_count == capacity)
+            {
+                size_t new_capacity = (capacity == 0) ? 16 : capacity * 2;
+                LOGGER_READER_INDEX_ENTRY* new_index = (LOGGER_READER_INDEX_ENTRY*)realloc(segment->index, new_capacity * sizeof(LOGGER_READER_INDEX_ENTRY));
+                if (new_index == NULL)
+                {
+                    LogError("unable to grow the index of %s", file_name);
+                    result = __LINE__;
+                }
+                else
+                {
+                    segment->index = new_index;
+                    capacity = new_capacity;
+                }
+            }
+            if (result == 0)
+            {
+                segment->index[segment->index_count].offset = offset;
+                segment->index[segment->index_count].time_before = segment->max_time;
+                segment->index_count++;
+            }
+        }
+        if (record.time < segment->min_time)
+        {
+            segment->min_time = record.time;
+        }
+        if (record.time > segment->max_time)
+        {
+            segment->max_time = record.time;
+        }
+        record_count++;
+        offset += record_size;
+    }
+
+    segment->end = offset;
+    if (
+        (result == 0) &&
+        (offset < segment->size)
+        )
+    {
+        /*the logger was stopped in the middle of a write*/
+        LogError("%s ends with %lu bytes of an incomplete record, they are skipped", file_name, (unsigned long)(segment->size - offset));
+    }
+    return result;
+}
+
+static int open_segment(const char* file_name, const char* extension, LOGGER_READER_SEGMENT* segment)
+{
+    int result;
+    (void)memset(segment, 0, sizeof(LOGGER_READER_SEGMENT));
+    if (extension[0] != '\0')
+    {
+        unsigned char* content;
+        if (LoggerCompress_ReadFile(file_name, &content, &segment->size) != 0)
+        {
+            LogError("unable to read %s", file_name);
+            result = __LINE__;
+        }
+        else
+        {
+            segment->data = content;
+            segment->in_heap = true;
+            result = 0;
+        }
+    }
+    else
+    {
+        result = map_segment(file_name, segment);
+    }
+
+    if (result == 0)
+    {
+        if (LoggerBinary_CheckSegmentHeader(segment->data, segment->size) != 0)
+        {
+            /*JSON lines or an empty file, neither has anything to replay*/
+            LogError("%s is not a binary log segment, it is skipped", file_name);
+            segment->end = 0;
+            segment->min_time = INT64_MAX;
+            segment->max_time = INT64_MIN;
+        }
+        else if (index_segment(file_name, segment) != 0)
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            /*indexed*/
+        }
+    }
+
+    if (result != 0)
+    {
+        release_segment(segment);
+    }
+    return result;
+}
+
+static int open_segments(LOGGER_READER* reader, const char* file_name)
+{
+    int result;
+    char* scratch = (char*)malloc(strlen(file_name) + LOGGER_READER_SUFFIX_LENGTH);
+    if (scratch == NULL)
+    {
+        LogError("malloc failed");
+        result = __LINE__;
+    }
+    else
+    {
+        size_t rotated_count = 0;
+        /*rotation keeps the numbers contiguous, the first gap ends the log*/
+        while (
+            (rotated_count < LOGGER_READER_MAX_SEGMENTS) &&
+            (find_segment(file_name, rotated_count + 1, scratch) != NULL)
+            )
+        {
+            rotated_count++;
+        }
+
+        reader->segments = (LOGGER_READER_SEGMENT*)malloc((rotated_count + 1) * sizeof(LOGGER_READER_SEGMENT));
+        if (reader->segments == NULL)
+        {
+            LogError("malloc failed");
+            result = __LINE__;
+        }
+        else
+        {
+            size_t index;
+            result = 0;
+            /*Codes_SRS_LOGGER_33_003: [ LoggerReader_Open shall read the rotated segments from the oldest ("<file_name>.<highest number>") to the newest, then file_name itself if it exists. ]*/
+            for (index = rotated_count; (result == 0) && (index > 0); index--)
+            {
+                const char* extension = find_segment(file_name, index, scratch);
+                if (extension == NULL)
+                {
+                    LogError("segment %lu of %s went away", (unsigned long)index, file_name);
+                    result = __LINE__;
+                }
+                else if (open_segment(scratch, extension, &reader->segments[reader->segment_count]) != 0)
+                {
+                    result = __LINE__;
+                }
+                else
+                {
+                    reader->segment_count++;
+                }
+            }
+            if (
+                (result == 0) &&
+                file_exists(file_name)
+                )
+            {
+                if (open_segment(file_name, "", &reader->segments[reader->segment_count]) != 0)
+                {
+                    result = __LINE__;
+                }
+                else
+                {
+                    reader->segment_count++;
+                }
+            }
+            if (
+                (result == 0) &&
+                (reader->segment_count == 0)
+                )
+            {
+                LogError("there is no log named %s", file_name);
+                result = __LINE__;
+            }
+        }
+        free(scratch);
+    }
+    return result;
+}
+
+static void free_reader(LOGGER_READER* reader)
+{
+    size_t i;
+    for (i = 0; i < reader->segment_count; i++)
+    {
+        release_segment(&reader->segments[i]);
+    }
+    free(reader->segments);
+    free(reader->property_value);
+    free(reader->property_name);
+    free(reader);
+}
+
+LOGGER_READER_HANDLE LoggerReader_Open(const char* file_name, const LOGGER_READER_FILTER* filter)
+{
+    LOGGER_READER* result;
+    /*Codes_SRS_LOGGER_33_001: [ If file_name or filter is NULL, or filter has a property_value without a property_name, then LoggerReader_Open shall fail and return NULL. ]*/
+    if (
+        (file_name == NULL) ||
+        (filter == NULL) ||
+        ((filter->property_name == NULL) && (filter->property_value != NULL))
+        )
+    {
+        LogError("invalid arg file_name=%p filter=%p", file_name, filter);
+        result = NULL;
+    }
+    else if ((result = (LOGGER_READER*)malloc(sizeof(LOGGER_READER))) == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        (void)memset(result, 0, sizeof(LOGGER_READER));
+        result->filter = *filter;
+        if (
+            ((filter->property_name != NULL) && (mallocAndStrcpy_s(&result->property_name, filter->property_name) != 0)) ||
+            ((filter->property_value != NULL) && (mallocAndStrcpy_s(&result->property_value, filter->property_value) != 0))
+            )
+        {
+            /*Codes_SRS_LOGGER_33_002: [ If any step fails then LoggerReader_Open shall release what it acquired and return NULL. ]*/
+            LogError("unable to copy the filter");
+            free_reader(result);
+            result = NULL;
+        }
+        /*Codes_SRS_LOGGER_33_004: [ LoggerReader_Open shall map each uncompressed segment into memory, read compressed segments into memory, and index every LOGGER_READER_INDEX_STRIDE-th record by time. ]*/
+        else if (open_segments(result, file_name) != 0)
+        {
+            /*Codes_SRS_LOGGER_33_002: [ If any step fails then LoggerReader_Open shall release what it acquired and return NULL. ]*/
+            free_reader(result);
+            result = NULL;
+        }
+        else
+        {
+            result->filter.property_name = result->property_name;
+            result->filter.property_value = result->property_value;
+        }
+    }
+    return result;
+}
+
+static bool is_in_time_range(const LOGGER_READER_FILTER* filter, int64_t time)
+{
+    return
+        (time >= filter->start_time) &&
+        ((filter->end_time == 0) || (time < filter->end_time));
+}
+
+/*looks at the serialized properties in place, the message is never created*/
+static bool has_property(const LOGGER_READER_FILTER* filter, const unsigned char* payload, size_t size)
+{
+    bool result;
+    if (filter->property_name == NULL)
+    {
+        result = true;
+    }
+    else if (size < LOGGER_READER_MESSAGE_HEADER_SIZE)
+    {
+        result = false;
+    }
+    else
+    {
+        uint32_t property_count = read_uint32(payload + 6);
+        size_t position = LOGGER_READER_MESSAGE_HEADER_SIZE;
+        uint32_t i;
+        result = false;
+        for (i = 0; i < property_count; i++)
+        {
+            const unsigned char* name_end = (const unsigned char*)memchr(payload + position, '\0', size - position);
+            const unsigned char* value_end;
+            size_t value_position;
+            if (name_end == NULL)
+            {
+                break;
+            }
+            value_position = (name_end - payload) + 1;
+            value_end = (const unsigned char*)memchr(payload + value_position, '\0', size - value_position);
+            if (value_end == NULL)
+            {
+                break;
+            }
+            if (strcmp((const char*)payload + position, filter->property_name) == 0)
+            {
+                /*names are unique within a message*/
+                result =
+                    (filter->property_value == NULL) ||
+                    (strcmp((const char*)payload + value_position, filter->property_value) == 0);
+                break;
+            }
+            position = (value_end - payload) + 1;
+        }
+    }
+    return result;
+}
+
+/*offset of the first record of the segment that can be at or after start_time*/
+static size_t seek_segment(const LOGGER_READER_SEGMENT* segment, int64_t start_time)
+{
+    size_t result;
+    if (segment->index_count == 0)
+    {
+        result = segment->end;
+    }
+    else
+    {
+        /*the last index entry whose records before it are all earlier than start_time*/
+        size_t low = 0;
+        size_t high = segment->index_count;
+        while (high - low > 1)
+        {
+            size_t middle = low + (high - low) / 2;
+            if (segment->index[middle].time_before < start_time)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        result = segment->index[low].offset;
+    }
+    return result;
+}
+
+LOGGER_READER_RESULT LoggerReader_Next(LOGGER_READER_HANDLE handle, LOGGER_BINARY_RECORD* record)
+{
+    LOGGER_READER_RESULT result;
+    /*Codes_SRS_LOGGER_33_005: [ If handle or record is NULL then LoggerReader_Next shall fail and return LOGGER_READER_ERROR. ]*/
+    if (
+        (handle == NULL) ||
+        (record == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p record=%p", handle, record);
+        result = LOGGER_READER_ERROR;
+    }
+    else
+    {
+        result = LOGGER_READER_END;
+        while (
+            (result == LOGGER_READER_END) &&
+            (handle->current_segment < handle->segment_count)
+            )
+        {
+            LOGGER_READER_SEGMENT* segment = &handle->segments[handle->current_segment];
+            if (!handle->positioned)
+            {
+                /*Codes_SRS_LOGGER_33_006: [ LoggerReader_Next shall skip segments whose records are all outside the filter's time range and use the index to start reading a segment close to start_time. ]*/
+                if (
+                    (segment->max_time < handle->filter.start_time) ||
+                    ((handle->filter.end_time != 0) && (segment->min_time >= handle->filter.end_time))
+                    )
+                {
+                    handle->current_offset = segment->end;
+                }
+                else
+                {
+                    handle->current_offset = seek_segment(segment, handle->filter.start_time);
+                }
+                handle->positioned = true;
+            }
+
+            while (
+                (result == LOGGER_READER_END) &&
+                (handle->current_offset < segment->end)
+                )
+            {
+                size_t record_size;
+                if (LoggerBinary_ReadRecord(segment->data + handle->current_offset, segment->end - handle->current_offset, record, &record_size) != 0)
+                {
+                    /*cannot happen, the segment was walked when indexed*/
+                    handle->current_offset = segment->end;
+                }
+                else
+                {
+                    handle->current_offset += record_size;
+                    /*Codes_SRS_LOGGER_33_007: [ LoggerReader_Next shall return LOGGER_READER_OK and the next message record whose time is in the filter's range and whose serialized properties match the filter, without deserializing the message. ]*/
+                    if (
+                        (record->kind == LOGGER_BINARY_RECORD_MESSAGE) &&
+                        is_in_time_range(&handle->filter, record->time) &&
+                        has_property(&handle->filter, record->payload, record->payload_size)
+                        )
+                    {
+                        result = LOGGER_READER_OK;
+                    }
+                }
+            }
+
+            if (result == LOGGER_READER_END)
+            {
+                handle->current_segment++;
+                handle->positioned = false;
+            }
+        }
+        /*Codes_SRS_LOGGER_33_008: [ LoggerReader_Next shall return LOGGER_READER_END once every segment has been read. ]*/
+    }
+    return result;
+}
+
+void LoggerReader_Rewind(LOGGER_READER_HANDLE handle)
+{
+    if (handle != NULL)
+    {
+        /*Codes_SRS_LOGGER_33_009: [ LoggerReader_Rewind shall make LoggerReader_Next start again from the first segment. ]*/
+        handle->current_segment = 0;
+        handle->positioned = false;
+    }
+}
+
+void LoggerReader_Close(LOGGER_READER_HANDLE handle)
+{
+    /*Codes_SRS_LOGGER_33_010: [ LoggerReader_Close shall unmap the segments and free all resources. ]*/
+    if (handle != NULL)
+    {
+        free_reader(handle);
+    }
+}
@@ -0,0 +1,416 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "logger_replay.h"
+#include "logger_reader.h"
+#include "broker.h"
+#include "message.h"
+#include "module_thread.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/crt_abstractions.h>
+#include <azure_c_shared_utility/lock.h>
+#include <azure_c_shared_utility/condition.h>
+#include <azure_c_shared_utility/threadapi.h>
+#include <azure_c_shared_utility/tickcounter.h>
+
+#include "parson.h"
+
+/*the largest whole number a JSON number (a double) holds exactly*/
+#define LOGGER_REPLAY_MAX_TIME 9007199254740991.0
+#define LOGGER_REPLAY_MAX_MESSAGES_PER_SECOND 1000000.0
+
+typedef struct LOGGER_REPLAY_HANDLE_DATA_TAG
+{
+    BROKER_HANDLE broker;
+    LOGGER_READER_HANDLE reader;
+    double messages_per_second;
+    THREAD_HANDLE thread;
+    LOCK_HANDLE lock;
+    COND_HANDLE wake;
+    /*guarded by lock*/
+    bool stopping;
+    TICK_COUNTER_HANDLE tick_counter;
+} LOGGER_REPLAY_HANDLE_DATA;
+
+static void free_configuration(LOGGER_REPLAY_CONFIG* config)
+{
+    free(config->property_value);
+    free(config->property_name);
+    free(config->file_name);
+    free(config);
+}
+
+static int read_time(const JSON_Object* json, const char* name, int64_t* time_value)
+{
+    int result;
+    JSON_Value* value = json_object_get_value(json, name);
+    double number;
+    if (value == NULL)
+    {
+        *time_value = 0;
+        result = 0;
+    }
+    else if (
+        (json_value_get_type(value) != JSONNumber) ||
+        ((number = json_value_get_number(value)) < 0) ||
+        (number > LOGGER_REPLAY_MAX_TIME) ||
+        ((double)(int64_t)number != number)
+        )
+    {
+        LogError("\"%s\" must be a whole number of seconds since the epoch", name);
+        result = __LINE__;
+    }
+    else
+    {
+        *time_value = (int64_t)number;
+        result = 0;
+    }
+    return result;
+}
+
+static int copy_optional_string(const JSON_Object* json, const char* name, char** destination)
+{
+    int result;
+    JSON_Value* value = json_object_get_value(json, name);
+    if (value == NULL)
+    {
+        *destination = NULL;
+        result = 0;
+    }
+    else if (json_value_get_type(value) != JSONString)
+    {
+        LogError("\"%s\" must be a string", name);
+        result = __LINE__;
+    }
+    else if (mallocAndStrcpy_s(destination, json_value_get_string(value)) != 0)
+    {
+        LogError("unable to copy \"%s\"", name);
+        result = __LINE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+static void* LoggerReplay_ParseConfigurationFromJson(const char* configuration)
+{
+    LOGGER_REPLAY_CONFIG* result;
+    /*Codes_SRS_LOGGER_33_011: [ If configuration is NULL, is not a JSON object or has no "filename" string then LoggerReplay_ParseConfigurationFromJson shall fail and return NULL. ]*/
+    if (configuration == NULL)
+    {
+        LogError("invalid arg configuration=NULL");
+        result = NULL;
+    }
+    else
+    {
+        JSON_Value* json = json_parse_string(configuration);
+        if (json == NULL)
+        {
+            LogError("unable to json_parse_string");
+            result = NULL;
+        }
+        else
+        {
+            JSON_Object* obj = json_value_get_object(json);
+            const char* file_name;
+            if (obj == NULL)
+            {
+                LogError("unable to json_value_get_object");
+                result = NULL;
+            }
+            else if ((file_name = json_object_get_string(obj, "filename")) == NULL)
+            {
+                LogError("\"filename\" is required");
+                result = NULL;
+            }
+            else if ((result = (LOGGER_REPLAY_CONFIG*)malloc(sizeof(LOGGER_REPLAY_CONFIG))) == NULL)
+            {
+                LogError("malloc failed");
+            }
+            else
+            {
+                JSON_Value* rate = json_object_get_value(obj, "messages_per_second");
+                (void)memset(result, 0, sizeof(LOGGER_REPLAY_CONFIG));
+                /*Codes_SRS_LOGGER_33_012: [ If "messages_per_second" is present and is not a number from 0 to 1000000, or "start_time" or "end_time" is not a whole number of seconds, or "property_name" or "property_value" is not a string, then LoggerReplay_ParseConfigurationFromJson shall fail and return NULL. ]*/
+                if (mallocAndStrcpy_s(&result->file_name, file_name) != 0)
+                {
+                    LogError("unable to copy \"filename\"");
+                    free_configuration(result);
+                    result = NULL;
+                }
+                else if (
+                    (rate != NULL) &&
+                    (
+                        (json_value_get_type(rate) != JSONNumber) ||
+                        ((result->messages_per_second = json_value_get_number(rate)) < 0) ||
+                        (result->messages_per_second > LOGGER_REPLAY_MAX_MESSAGES_PER_SECOND)
+                    )
+                    )
+                {
+                    LogError("\"messages_per_second\" must be a number from 0 (no limit) to %.0f", LOGGER_REPLAY_MAX_MESSAGES_PER_SECOND);
+                    free_configuration(result);
+                    result = NULL;
+                }
+                else if (
+                    (read_time(obj, "start_time", &result->start_time) != 0) ||
+                    (read_time(obj, "end_time", &result->end_time) != 0) ||
+                    (copy_optional_string(obj, "property_name", &result->property_name) != 0) ||
+                    (copy_optional_string(obj, "property_value", &result->property_value) != 0)
+                    )
+                {
+                    free_configuration(result);
+                    result = NULL;
+                }
+                /*Codes_SRS_LOGGER_33_013: [ If "property_value" is present without "property_name" then LoggerReplay_ParseConfigurationFromJson shall fail and return NULL. ]*/
+                else if (
+                    (result->property_name == NULL) &&
+                    (result->property_value != NULL)
+                    )
+                {
+                    LogError("\"property_value\" needs \"property_name\"");
+                    free_configuration(result);
+                    result = NULL;
+                }
+                else
+                {
+                    /*Codes_SRS_LOGGER_33_014: [ Otherwise LoggerReplay_ParseConfigurationFromJson shall return a LOGGER_REPLAY_CONFIG, absent values being 0 or NULL. ]*/
+                }
+            }
+            json_value_free(json);
+        }
+    }
+    return result;
+}
+
+static void LoggerReplay_FreeConfiguration(void* configuration)
+{
+    /*Codes_SRS_LOGGER_33_015: [ LoggerReplay_FreeConfiguration shall free configuration and the strings it holds, and do nothing if it is NULL. ]*/
+    if (configuration != NULL)
+    {
+        free_configuration((LOGGER_REPLAY_CONFIG*)configuration);
+    }
+}
+
+static void free_module(LOGGER_REPLAY_HANDLE_DATA* module)
+{
+    if (module->tick_counter != NULL)
+    {
+        tickcounter_destroy(module->tick_counter);
+    }
+    if (module->wake != NULL)
+    {
+        Condition_Deinit(module->wake);
+    }
+    if (module->lock != NULL)
+    {
+        (void)Lock_Deinit(module->lock);
+    }
+    LoggerReader_Close(module->reader);
+    free(module);
+}
+
+static MODULE_HANDLE LoggerReplay_Create(BROKER_HANDLE broker, const void* configuration)
+{
+    LOGGER_REPLAY_HANDLE_DATA* result;
+    const LOGGER_REPLAY_CONFIG* config = (const LOGGER_REPLAY_CONFIG*)configuration;
+    /*Codes_SRS_LOGGER_33_016: [ If broker or configuration is NULL then LoggerReplay_Create shall fail and return NULL. ]*/
+    if (
+        (broker == NULL) ||
+        (config == NULL)
+        )
+    {
+        LogError("invalid arg broker=%p configuration=%p", broker, configuration);
+        result = NULL;
+    }
+    else if ((result = (LOGGER_REPLAY_HANDLE_DATA*)malloc(sizeof(LOGGER_REPLAY_HANDLE_DATA))) == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        LOGGER_READER_FILTER filter;
+        filter.start_time = config->start_time;
+        filter.end_time = config->end_time;
+        filter.property_name = config->property_name;
+        filter.property_value = config->property_value;
+
+        (void)memset(result, 0, sizeof(LOGGER_REPLAY_HANDLE_DATA));
+        result->broker = broker;
+        result->messages_per_second = config->messages_per_second;
+        /*Codes_SRS_LOGGER_33_017: [ LoggerReplay_Create shall open the log with LoggerReader_Open so that a missing or unreadable log fails the module's creation. ]*/
+        if (
+            ((result->reader = LoggerReader_Open(config->file_name, &filter)) == NULL) ||
+            ((result->lock = Lock_Init()) == NULL) ||
+            ((result->wake = Condition_Init()) == NULL) ||
+            ((result->tick_counter = tickcounter_create()) == NULL)
+            )
+        {
+            /*Codes_SRS_LOGGER_33_018: [ If any step fails then LoggerReplay_Create shall release what it acquired and return NULL. ]*/
+            LogError("unable to create the replay of %s", config->file_name);
+            free_module(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/*waits until the tick counter reaches due_ms, returns true if the module is being destroyed*/
+static bool wait_until(LOGGER_REPLAY_HANDLE_DATA* module, tickcounter_ms_t due_ms)
+{
+    bool result;
+    if (Lock(module->lock) != LOCK_OK)
+    {
+        LogError("unable to lock");
+        result = true;
+    }
+    else
+    {
+        tickcounter_ms_t now;
+        while (
+            !module->stopping &&
+            (tickcounter_get_current_ms(module->tick_counter, &now) == 0) &&
+            (now < due_ms)
+            )
+        {
+            (void)Condition_Wait(module->wake, module->lock, (int)(due_ms - now));
+        }
+        result = module->stopping;
+        (void)Unlock(module->lock);
+    }
+    return result;
+}
+
+static int replay_thread(void* context)
+{
+    LOGGER_REPLAY_HANDLE_DATA* module = (LOGGER_REPLAY_HANDLE_DATA*)context;
+    LOGGER_BINARY_RECORD record;
+    tickcounter_ms_t started_ms;
+    size_t published = 0;
+    bool stopping = false;
+
+    if (tickcounter_get_current_ms(module->tick_counter, &started_ms) != 0)
+    {
+        LogError("unable to get the current time");
+        started_ms = 0;
+    }
+
+    /*Codes_SRS_LOGGER_33_020: [ The replay thread shall publish every message LoggerReader_Next returns, in the order it was logged, with Broker_Publish. ]*/
+    while (
+        !stopping &&
+        (LoggerReader_Next(module->reader, &record) == LOGGER_READER_OK)
+        )
+    {
+        MESSAGE_HANDLE message = Message_CreateFromByteArray(record.payload, (int32_t)record.payload_size);
+        if (message == NULL)
+        {
+            LogError("unable to deserialize a logged message, it is skipped");
+        }
+        else
+        {
+            if (Broker_Publish(module->broker, (MODULE_HANDLE)module, message) != BROKER_OK)
+            {
+                LogError("unable to publish a replayed message");
+            }
+            Message_Destroy(message);
+            published++;
+        }
+
+        /*Codes_SRS_LOGGER_33_021: [ If messages_per_second is not 0, the replay thread shall not publish faster than messages_per_second on average. ]*/
+        /*pacing against the start rather than after each message keeps the rate right when the waits are coarse*/
+        stopping = wait_until(
+            module,
+            (module->messages_per_second > 0) ? started_ms + (tickcounter_ms_t)((double)published * 1000.0 / module->messages_per_second) : 0);
+    }
+
+    /*Codes_SRS_LOGGER_33_022: [ Once every message is published the replay thread shall end. ]*/
+    LogInfo("replayed %lu messages", (unsigned long)published);
+    return 0;
+}
+
+static void LoggerReplay_Start(MODULE_HANDLE moduleHandle)
+{
+    /*Codes_SRS_LOGGER_33_019: [ LoggerReplay_Start shall start the replay thread with ModuleThread_Create. ]*/
+    if (moduleHandle == NULL)
+    {
+        LogError("invalid arg moduleHandle=NULL");
+    }
+    else
+    {
+        LOGGER_REPLAY_HANDLE_DATA* module = (LOGGER_REPLAY_HANDLE_DATA*)moduleHandle;
+        if (ModuleThread_Create(&module->thread, replay_thread, module) != THREADAPI_OK)
+        {
+            LogError("unable to start the replay thread");
+            module->thread = NULL;
+        }
+    }
+}
+
+static void LoggerReplay_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
+{
+    /*Codes_SRS_LOGGER_33_023: [ LoggerReplay_Receive shall ignore the message. ]*/
+    (void)moduleHandle;
+    (void)messageHandle;
+}
+
+static void LoggerReplay_Destroy(MODULE_HANDLE moduleHandle)
+{
+    /*Codes_SRS_LOGGER_33_024: [ LoggerReplay_Destroy shall stop the replay thread, wait for it to end and free all resources. ]*/
+    if (moduleHandle != NULL)
+    {
+        LOGGER_REPLAY_HANDLE_DATA* module = (LOGGER_REPLAY_HANDLE_DATA*)moduleHandle;
+        if (Lock(module->lock) != LOCK_OK)
+        {
+            LogError("unable to lock");
+        }
+        else
+        {
+            module->stopping = true;
+            (void)Condition_Post(module->wake);
+            (void)Unlock(module->lock);
+        }
+        if (module->thread != NULL)
+        {
+            int thread_result;
+            if (ThreadAPI_Join(module->thread, &thread_result) != THREADAPI_OK)
+            {
+                LogError("unable to join the replay thread");
+            }
+        }
+        free_module(module);
+    }
+}
+
+/*
+ *    Required for all modules:  the public API and the designated implementation functions.
+ */
+static const MODULE_API_1 LoggerReplay_APIS_all =
+{
+    {MODULE_API_VERSION_1},
+
+    LoggerReplay_ParseConfigurationFromJson,
+    LoggerReplay_FreeConfiguration,
+    LoggerReplay_Create,
+    LoggerReplay_Destroy,
+    LoggerReplay_Receive,
+    LoggerReplay_Start
+};
+
+#ifdef BUILD_MODULE_TYPE_STATIC
+MODULE_EXPORT const MODULE_API* MODULE_STATIC_GETAPI(LOGGER_REPLAY_MODULE)(MODULE_API_VERSION gateway_api_version)
+#else
+MODULE_EXPORT const MODULE_API* Module_GetApi(MODULE_API_VERSION gateway_api_version)
+#endif
+{
+    (void)gateway_api_version;
+    return (const MODULE_API *)&LoggerReplay_APIS_all;
+}
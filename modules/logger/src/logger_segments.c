@@ -0,0 +1,379 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "logger_segments.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/crt_abstractions.h>
+#include <azure_c_shared_utility/tickcounter.h>
+
+/*room for ".<index>" and the longest compression extension*/
+#define LOGGER_SEGMENTS_SUFFIX_LENGTH 32
+
+/*every extension a rotated segment can have, so that changing "compress" between runs does not strand old segments*/
+static const LOGGER_COMPRESSION all_compressions[] =
+{
+    LOGGER_COMPRESSION_NONE,
+    LOGGER_COMPRESSION_ZSTD,
+    LOGGER_COMPRESSION_LZ4
+};
+
+typedef struct LOGGER_SEGMENTS_TAG
+{
+    char* file_name;
+    /*scratch space for "<file_name>.<index><extension>"*/
+    char* from_name;
+    char* to_name;
+    LOGGER_SEGMENTS_CONFIG config;
+    unsigned char* header;
+    /*what an existing file starts with, compared to header*/
+    unsigned char* existing_header;
+    size_t header_size;
+    FILE* fout;
+    /*bytes in the active segment*/
+    size_t size;
+    TICK_COUNTER_HANDLE tick_counter;
+    tickcounter_ms_t opened_ms;
+} LOGGER_SEGMENTS;
+
+static void make_name(const LOGGER_SEGMENTS* segments, char* destination, size_t index, LOGGER_COMPRESSION compression)
+{
+    (void)sprintf(destination, "%s.%lu%s", segments->file_name, (unsigned long)index, LoggerCompress_GetExtension(compression));
+}
+
+static int open_active(LOGGER_SEGMENTS* segments)
+{
+    int result;
+    /*Codes_SRS_LOGGER_32_010: [ LoggerSegments_Open shall open file_name for appending and write header to it if it is empty. ]*/
+    segments->fout = fopen(segments->file_name, "ab");
+    if (segments->fout == NULL)
+    {
+        LogError("unable to open file %s", segments->file_name);
+        result = __LINE__;
+    }
+    else
+    {
+        long existing_size;
+        /*the caller hands fwrite large blocks, stdio buffering would only add a copy*/
+        (void)setvbuf(segments->fout, NULL, _IONBF, 0);
+        if (
+            (fseek(segments->fout, 0, SEEK_END) != 0) ||
+            ((existing_size = ftell(segments->fout)) < 0)
+            )
+        {
+            LogError("unable to get the size of %s", segments->file_name);
+            (void)fclose(segments->fout);
+            segments->fout = NULL;
+            result = __LINE__;
+        }
+        else if (
+            (existing_size == 0) &&
+            (segments->header_size > 0) &&
+            (fwrite(segments->header, 1, segments->header_size, segments->fout) != segments->header_size)
+            )
+        {
+            LogError("unable to write the segment header to %s", segments->file_name);
+            (void)fclose(segments->fout);
+            segments->fout = NULL;
+            result = __LINE__;
+        }
+        else
+        {
+            segments->size = (existing_size == 0) ? segments->header_size : (size_t)existing_size;
+            if (tickcounter_get_current_ms(segments->tick_counter, &segments->opened_ms) != 0)
+            {
+                LogError("unable to get the current time");
+            }
+            result = 0;
+        }
+    }
+    return result;
+}
+
+/*moves the closed active segment out of the way, returns whether "<file_name>.1" is left to compress*/
+static bool shift_segments(LOGGER_SEGMENTS* segments)
+{
+    bool result;
+    size_t index;
+    size_t i;
+
+    /*Codes_SRS_LOGGER_32_013: [ Rotating shall delete the segments numbered max_files and shift the others up by one. ]*/
+    for (i = 0; i < sizeof(all_compressions) / sizeof(all_compressions[0]); i++)
+    {
+        make_name(segments, segments->from_name, segments->config.max_files, all_compressions[i]);
+        (void)remove(segments->from_name);
+    }
+    for (index = segments->config.max_files; index > 1; index--)
+    {
+        for (i = 0; i < sizeof(all_compressions) / sizeof(all_compressions[0]); i++)
+        {
+            make_name(segments, segments->from_name, index - 1, all_compressions[i]);
+            make_name(segments, segments->to_name, index, all_compressions[i]);
+            /*most of these do not exist*/
+            (void)rename(segments->from_name, segments->to_name);
+        }
+    }
+
+    if (segments->config.max_files == 0)
+    {
+        if (remove(segments->file_name) != 0)
+        {
+            LogError("unable to remove %s", segments->file_name);
+        }
+        result = false;
+    }
+    else
+    {
+        /*Codes_SRS_LOGGER_32_014: [ Rotating shall rename the active segment to "<file_name>.1" and, if compression is not LOGGER_COMPRESSION_NONE, replace it with a compressed "<file_name>.1<extension>" once the new active segment is started. ]*/
+        make_name(segments, segments->to_name, 1, LOGGER_COMPRESSION_NONE);
+        if (rename(segments->file_name, segments->to_name) != 0)
+        {
+            LogError("unable to rename %s to %s", segments->file_name, segments->to_name);
+            result = false;
+        }
+        else
+        {
+            result = (segments->config.compression != LOGGER_COMPRESSION_NONE);
+        }
+    }
+    return result;
+}
+
+static void compress_first_segment(LOGGER_SEGMENTS* segments)
+{
+    make_name(segments, segments->to_name, 1, LOGGER_COMPRESSION_NONE);
+    make_name(segments, segments->from_name, 1, segments->config.compression);
+    if (LoggerCompress_CompressFile(segments->config.compression, segments->to_name, segments->from_name) != 0)
+    {
+        /*the plain segment is kept*/
+        LogError("unable to compress %s", segments->to_name);
+    }
+    else if (remove(segments->to_name) != 0)
+    {
+        LogError("unable to remove %s", segments->to_name);
+    }
+}
+
+static void rotate(LOGGER_SEGMENTS* segments)
+{
+    bool compress;
+
+    if (fclose(segments->fout) != 0)
+    {
+        LogError("unable to close %s", segments->file_name);
+    }
+    segments->fout = NULL;
+
+    compress = shift_segments(segments);
+
+    /*Codes_SRS_LOGGER_32_015: [ Rotating shall start a new active segment that begins with header. ]*/
+    if (open_active(segments) != 0)
+    {
+        LogError("unable to start a new segment, the next write tries again");
+    }
+
+    /*compressing last, so that there is an active segment to write to as soon as this returns*/
+    if (compress)
+    {
+        compress_first_segment(segments);
+    }
+}
+
+/*a file left by another program, or by a run with another format, is not appended to*/
+static void rotate_out_foreign_file(LOGGER_SEGMENTS* segments)
+{
+    FILE* fin;
+    if (
+        (segments->header_size > 0) &&
+        ((fin = fopen(segments->file_name, "rb")) != NULL)
+        )
+    {
+        /*a file shorter than the header reads short*/
+        size_t read_size = fread(segments->existing_header, 1, segments->header_size, fin);
+        (void)fclose(fin);
+        if (
+            (read_size != 0) &&
+            (
+                (read_size != segments->header_size) ||
+                (memcmp(segments->existing_header, segments->header, segments->header_size) != 0)
+            )
+            )
+        {
+            /*Codes_SRS_LOGGER_32_018: [ If file_name is not empty and does not start with header then LoggerSegments_Open shall rotate it out before appending to it. ]*/
+            LogError("%s does not start with the segment header, rotating it out", segments->file_name);
+            if (shift_segments(segments))
+            {
+                compress_first_segment(segments);
+            }
+        }
+    }
+}
+
+static bool is_rotation_due(LOGGER_SEGMENTS* segments, size_t size)
+{
+    bool result;
+    /*a segment holding only its header is never rotated, so a record bigger than max_file_bytes still gets written*/
+    if (segments->size <= segments->header_size)
+    {
+        result = false;
+    }
+    /*Codes_SRS_LOGGER_32_011: [ LoggerSegments_Write shall rotate before writing if the active segment would grow past max_file_bytes. ]*/
+    else if (
+        (segments->config.max_file_bytes != 0) &&
+        (segments->size + size > segments->config.max_file_bytes)
+        )
+    {
+        result = true;
+    }
+    /*Codes_SRS_LOGGER_32_012: [ LoggerSegments_Write shall rotate before writing if max_age_since_open_s seconds or more have passed since the active segment was opened. ]*/
+    else if (segments->config.max_age_since_open_s != 0)
+    {
+        tickcounter_ms_t now;
+        if (tickcounter_get_current_ms(segments->tick_counter, &now) != 0)
+        {
+            LogError("unable to get the current time");
+            result = false;
+        }
+        else
+        {
+            result = (now - segments->opened_ms) >= (tickcounter_ms_t)segments->config.max_age_since_open_s * 1000;
+        }
+    }
+    else
+    {
+        result = false;
+    }
+    return result;
+}
+
+static void free_segments(LOGGER_SEGMENTS* segments)
+{
+    if (segments->tick_counter != NULL)
+    {
+        tickcounter_destroy(segments->tick_counter);
+    }
+    free(segments->existing_header);
+    free(segments->header);
+    free(segments->to_name);
+    free(segments->from_name);
+    free(segments->file_name);
+    free(segments);
+}
+
+LOGGER_SEGMENTS_HANDLE LoggerSegments_Open(const char* file_name, const LOGGER_SEGMENTS_CONFIG* config, const unsigned char* header, size_t header_size)
+{
+    LOGGER_SEGMENTS* result;
+    /*Codes_SRS_LOGGER_32_009: [ If file_name or config is NULL, or header is NULL and header_size is not 0, then LoggerSegments_Open shall fail and return NULL. ]*/
+    if (
+        (file_name == NULL) ||
+        (config == NULL) ||
+        ((header == NULL) && (header_size != 0))
+        )
+    {
+        LogError("invalid arg file_name=%p config=%p header=%p", file_name, config, header);
+        result = NULL;
+    }
+    else if ((result = (LOGGER_SEGMENTS*)malloc(sizeof(LOGGER_SEGMENTS))) == NULL)
+    {
+        LogError("malloc failed");
+    }
+    else
+    {
+        size_t name_length = strlen(file_name) + LOGGER_SEGMENTS_SUFFIX_LENGTH;
+        (void)memset(result, 0, sizeof(LOGGER_SEGMENTS));
+        result->config = *config;
+        result->header_size = header_size;
+        if (
+            (mallocAndStrcpy_s(&result->file_name, file_name) != 0) ||
+            ((result->from_name = (char*)malloc(name_length)) == NULL) ||
+            ((result->to_name = (char*)malloc(name_length)) == NULL) ||
+            ((header_size > 0) && ((result->header = (unsigned char*)malloc(header_size)) == NULL)) ||
+            ((header_size > 0) && ((result->existing_header = (unsigned char*)malloc(header_size)) == NULL)) ||
+            ((result->tick_counter = tickcounter_create()) == NULL)
+            )
+        {
+            LogError("unable to allocate the segments");
+            free_segments(result);
+            result = NULL;
+        }
+        else
+        {
+            if (header_size > 0)
+            {
+                (void)memcpy(result->header, header, header_size);
+            }
+            rotate_out_foreign_file(result);
+            if (open_active(result) != 0)
+            {
+                free_segments(result);
+                result = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+int LoggerSegments_Write(LOGGER_SEGMENTS_HANDLE handle, const unsigned char* data, size_t size)
+{
+    int result;
+    if (
+        (handle == NULL) ||
+        (data == NULL)
+        )
+    {
+        LogError("invalid arg handle=%p data=%p", handle, data);
+        result = __LINE__;
+    }
+    else
+    {
+        if (
+            (handle->fout != NULL) &&
+            is_rotation_due(handle, size)
+            )
+        {
+            rotate(handle);
+        }
+
+        if (
+            (handle->fout == NULL) &&
+            (open_active(handle) != 0)
+            )
+        {
+            LogError("dropping %lu bytes, there is no segment to write them to", (unsigned long)size);
+            result = __LINE__;
+        }
+        else if (fwrite(data, 1, size, handle->fout) != size)
+        {
+            LogError("unable to write %lu bytes to %s", (unsigned long)size, handle->file_name);
+            result = __LINE__;
+        }
+        else
+        {
+            handle->size += size;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+void LoggerSegments_Close(LOGGER_SEGMENTS_HANDLE handle)
+{
+    if (handle != NULL)
+    {
+        if (
+            (handle->fout != NULL) &&
+            (fclose(handle->fout) != 0)
+            )
+        {
+            LogError("unable to close %s", handle->file_name);
+        }
+        free_segments(handle);
+    }
+}
@@ -0,0 +1,655 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "message.h"
+#include "logger_async.h"
+#include "logger_binary.h"
+#include "logger_compress.h"
+
+#include <parson.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define TEST_LOG_FILE "logger_async_ut.log"
+#define WAIT_TIMEOUT_MS 10000
+#define TEST_MAX_FILES 2
+
+static void remove_segments(void)
+{
+    static const char* const extensions[] = { "", ".zst", ".lz4" };
+    char name[64];
+    size_t index;
+    size_t i;
+    (void)remove(TEST_LOG_FILE);
+    for (index = 1; index <= TEST_MAX_FILES + 1; index++)
+    {
+        for (i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+        {
+            (void)sprintf(name, "%s.%lu%s", TEST_LOG_FILE, (unsigned long)index, extensions[i]);
+            (void)remove(name);
+        }
+    }
+}
+
+static bool file_exists(const char* file_name)
+{
+    FILE* f = fopen(file_name, "rb");
+    if (f != NULL)
+    {
+        (void)fclose(f);
+    }
+    return f != NULL;
+}
+
+static char* read_log(void)
+{
+    char* result;
+    FILE* f = fopen(TEST_LOG_FILE, "rb");
+    if (f == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        long size;
+        ASSERT_ARE_EQUAL(int, 0, fseek(f, 0, SEEK_END));
+        size = ftell(f);
+        ASSERT_IS_TRUE(size >= 0);
+        ASSERT_ARE_EQUAL(int, 0, fseek(f, 0, SEEK_SET));
+        result = (char*)malloc((size_t)size + 1);
+        ASSERT_IS_NOT_NULL(result);
+        ASSERT_ARE_EQUAL(size_t, (size_t)size, fread(result, 1, (size_t)size, f));
+        result[size] = '\0';
+        (void)fclose(f);
+    }
+    return result;
+}
+
+/*splits the log in place, returns the number of lines and checks every line ends with a newline*/
+static size_t split_lines(char* text, char** lines, size_t max_lines)
+{
+    size_t result = 0;
+    char* line = text;
+    while (*line != '\0')
+    {
+        char* end = strchr(line, '\n');
+        ASSERT_IS_NOT_NULL(end);
+        *end = '\0';
+        if (result < max_lines)
+        {
+            lines[result] = line;
+        }
+        result++;
+        line = end + 1;
+    }
+    return result;
+}
+
+static MESSAGE_HANDLE create_message(const char* key, const char* value, const unsigned char* content, size_t size)
+{
+    MESSAGE_HANDLE result;
+    MESSAGE_CONFIG config;
+    MAP_HANDLE properties = Map_Create(NULL);
+    ASSERT_IS_NOT_NULL(properties);
+    if (key != NULL)
+    {
+        ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, key, value));
+    }
+    config.size = size;
+    config.source = content;
+    config.sourceProperties = properties;
+    result = Message_Create(&config);
+    ASSERT_IS_NOT_NULL(result);
+    Map_Destroy(properties);
+    return result;
+}
+
+static int parse_async_config(const char* args, LOGGER_ASYNC_CONFIG* config)
+{
+    JSON_Value* json = json_parse_string(args);
+    int result;
+    ASSERT_IS_NOT_NULL(json);
+    result = LoggerAsync_ParseConfigurationFromJson(json_value_get_object(json), config);
+    json_value_free(json);
+    return result;
+}
+
+static void assert_marker(const char* line, const char* content)
+{
+    JSON_Value* json = json_parse_string(line);
+    JSON_Object* object;
+    ASSERT_IS_NOT_NULL(json);
+    object = json_value_get_object(json);
+    ASSERT_IS_NOT_NULL(object);
+    ASSERT_IS_NOT_NULL(json_object_get_string(object, "time"));
+    ASSERT_ARE_EQUAL(char_ptr, content, json_object_get_string(object, "content"));
+    json_value_free(json);
+}
+
+BEGIN_TEST_SUITE(logger_async_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+    remove_segments();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    remove_segments();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_LOGGER_31_001: [ If json or config is NULL then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_31_002: [ Values that are not present shall default to async false, flush_interval_ms LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS and flush_bytes LOGGER_ASYNC_DEFAULT_FLUSH_BYTES. ]*/
+TEST_FUNCTION(LoggerAsync_ParseConfigurationFromJson_reads_settings)
+{
+    LOGGER_ASYNC_CONFIG config;
+    JSON_Value* json = json_parse_string("{}");
+    ASSERT_IS_NOT_NULL(json);
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerAsync_ParseConfigurationFromJson(NULL, &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerAsync_ParseConfigurationFromJson(json_value_get_object(json), NULL));
+    json_value_free(json);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"filename\": \"a.txt\" }", &config));
+    ASSERT_IS_FALSE(config.enabled);
+    ASSERT_ARE_EQUAL(size_t, LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS, config.flush_interval_ms);
+    ASSERT_ARE_EQUAL(size_t, LOGGER_ASYNC_DEFAULT_FLUSH_BYTES, config.flush_bytes);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"flush_interval_ms\": 250, \"flush_bytes\": 4096 }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(size_t, 250, config.flush_interval_ms);
+    ASSERT_ARE_EQUAL(size_t, 4096, config.flush_bytes);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"async\": false }", &config));
+    ASSERT_IS_FALSE(config.enabled);
+}
+
+/*Tests_SRS_LOGGER_31_003: [ If "async" is not a boolean, or "flush_interval_ms" or "flush_bytes" is not a whole number in range, then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(LoggerAsync_ParseConfigurationFromJson_rejects_bad_values)
+{
+    LOGGER_ASYNC_CONFIG config;
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": \"yes\" }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"flush_interval_ms\": 0 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"flush_interval_ms\": 1.5 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"flush_interval_ms\": \"10\" }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"flush_bytes\": -1 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"flush_bytes\": 1e12 }", &config));
+}
+
+/*Tests_SRS_LOGGER_31_004: [ If file_name or config is NULL then LoggerAsync_Create shall fail and return NULL. ]*/
+/*Tests_SRS_LOGGER_31_008: [ If handle or message is NULL then LoggerAsync_Log shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_31_015: [ If handle is NULL then LoggerAsync_Destroy shall return. ]*/
+TEST_FUNCTION(LoggerAsync_rejects_invalid_arguments)
+{
+    LOGGER_ASYNC_CONFIG config = { true, LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS, LOGGER_ASYNC_DEFAULT_FLUSH_BYTES };
+    MESSAGE_HANDLE message = create_message(NULL, NULL, NULL, 0);
+    LOGGER_ASYNC_HANDLE handle;
+
+    ASSERT_IS_NULL(LoggerAsync_Create(NULL, &config));
+    ASSERT_IS_NULL(LoggerAsync_Create(TEST_LOG_FILE, NULL));
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerAsync_Log(NULL, message));
+    LoggerAsync_Destroy(NULL);
+
+    handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    ASSERT_IS_NOT_NULL(handle);
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerAsync_Log(handle, NULL));
+    LoggerAsync_Destroy(handle);
+
+    Message_Destroy(message);
+}
+
+/*Tests_SRS_LOGGER_31_005: [ LoggerAsync_Create shall open file_name for appending. ]*/
+/*Tests_SRS_LOGGER_31_006: [ LoggerAsync_Create shall buffer {"time":"...","content":"Log started"} and start the writer thread with ModuleThread_Create. ]*/
+/*Tests_SRS_LOGGER_31_009: [ LoggerAsync_Log shall queue a clone of message and the current time for the writer thread without taking a lock. ]*/
+/*Tests_SRS_LOGGER_31_012: [ The writer thread shall write each message as one line holding a JSON object with "time", "properties" and "content" (base64) members. ]*/
+/*Tests_SRS_LOGGER_31_016: [ LoggerAsync_Destroy shall have the writer thread write every queued message followed by {"time":"...","content":"Log stopped"}, then wait for it to finish, close the file and free all resources. ]*/
+TEST_FUNCTION(LoggerAsync_writes_one_json_line_per_message)
+{
+    static const unsigned char contents[3][3] = { { 'a', 'b', 'c' }, { 'a', 'b', 0 }, { 'a', 0, 0 } };
+    static const char* const encoded[4] = { "YWJj", "YWI=", "YQ==", "" };
+    LOGGER_ASYNC_CONFIG config = { true, LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS, LOGGER_ASYNC_DEFAULT_FLUSH_BYTES };
+    LOGGER_ASYNC_HANDLE handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    char* log;
+    char* lines[8];
+    size_t i;
+    ASSERT_IS_NOT_NULL(handle);
+
+    for (i = 0; i < 4; i++)
+    {
+        MESSAGE_HANDLE message = create_message("name", "quote\" backslash\\ newline\n", (i < 3) ? contents[i] : NULL, 3 - i);
+        ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(handle, message));
+        /*the logger keeps its own reference*/
+        Message_Destroy(message);
+    }
+    LoggerAsync_Destroy(handle);
+
+    log = read_log();
+    ASSERT_IS_NOT_NULL(log);
+    ASSERT_ARE_EQUAL(size_t, 6, split_lines(log, lines, 8));
+    assert_marker(lines[0], "Log started");
+    for (i = 0; i < 4; i++)
+    {
+        JSON_Value* json = json_parse_string(lines[i + 1]);
+        JSON_Object* object;
+        JSON_Object* properties;
+        ASSERT_IS_NOT_NULL(json);
+        object = json_value_get_object(json);
+        ASSERT_IS_NOT_NULL(object);
+        ASSERT_IS_NOT_NULL(json_object_get_string(object, "time"));
+        properties = json_object_get_object(object, "properties");
+        ASSERT_IS_NOT_NULL(properties);
+        ASSERT_ARE_EQUAL(char_ptr, "quote\" backslash\\ newline\n", json_object_get_string(properties, "name"));
+        ASSERT_ARE_EQUAL(char_ptr, encoded[i], json_object_get_string(object, "content"));
+        json_value_free(json);
+    }
+    assert_marker(lines[5], "Log stopped");
+    free(log);
+}
+
+/*Tests_SRS_LOGGER_31_005: [ LoggerAsync_Create shall open file_name for appending. ]*/
+/*Tests_SRS_LOGGER_31_014: [ The writer thread shall only append to the file, it shall never seek or rewrite what is written. ]*/
+TEST_FUNCTION(LoggerAsync_appends_to_an_existing_file)
+{
+    LOGGER_ASYNC_CONFIG config = { true, LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS, LOGGER_ASYNC_DEFAULT_FLUSH_BYTES };
+    FILE* f = fopen(TEST_LOG_FILE, "wb");
+    LOGGER_ASYNC_HANDLE handle;
+    char* log;
+    char* lines[4];
+    ASSERT_IS_NOT_NULL(f);
+    ASSERT_IS_TRUE(fputs("{\"content\":\"earlier\"}\n", f) >= 0);
+    (void)fclose(f);
+
+    handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    ASSERT_IS_NOT_NULL(handle);
+    LoggerAsync_Destroy(handle);
+
+    log = read_log();
+    ASSERT_IS_NOT_NULL(log);
+    ASSERT_ARE_EQUAL(size_t, 3, split_lines(log, lines, 4));
+    ASSERT_ARE_EQUAL(char_ptr, "{\"content\":\"earlier\"}", lines[0]);
+    assert_marker(lines[1], "Log started");
+    assert_marker(lines[2], "Log stopped");
+    free(log);
+}
+
+/*Tests_SRS_LOGGER_31_013: [ The writer thread shall write its buffer to the file when it holds flush_bytes or more, or when the oldest record in it has waited flush_interval_ms. ]*/
+TEST_FUNCTION(LoggerAsync_writes_when_the_flush_interval_elapses)
+{
+    LOGGER_ASYNC_CONFIG config = { true, 20, LOGGER_ASYNC_DEFAULT_FLUSH_BYTES };
+    LOGGER_ASYNC_HANDLE handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    MESSAGE_HANDLE message = create_message("name", "value", NULL, 0);
+    size_t line_count = 0;
+    size_t waited_ms;
+    ASSERT_IS_NOT_NULL(handle);
+
+    ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(handle, message));
+    for (waited_ms = 0; (line_count < 2) && (waited_ms < WAIT_TIMEOUT_MS); waited_ms += 10)
+    {
+        char* lines[4];
+        char* log;
+        ThreadAPI_Sleep(10);
+        log = read_log();
+        ASSERT_IS_NOT_NULL(log);
+        line_count = split_lines(log, lines, 4);
+        free(log);
+    }
+    /*both records are on disk before the logger is destroyed*/
+    ASSERT_ARE_EQUAL(size_t, 2, line_count);
+
+    LoggerAsync_Destroy(handle);
+    Message_Destroy(message);
+}
+
+/*Tests_SRS_LOGGER_31_010: [ If the queue is full, LoggerAsync_Log shall wake the writer thread and wait for room instead of dropping the message. ]*/
+/*Tests_SRS_LOGGER_31_013: [ The writer thread shall write its buffer to the file when it holds flush_bytes or more, or when the oldest record in it has waited flush_interval_ms. ]*/
+TEST_FUNCTION(LoggerAsync_keeps_every_message_when_the_queue_fills)
+{
+    const size_t message_count = 20000;
+    LOGGER_ASYNC_CONFIG config = { true, LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS, 1024 };
+    LOGGER_ASYNC_HANDLE handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    MESSAGE_HANDLE message = create_message("name", "value", (const unsigned char*)"content", 7);
+    char* log;
+    size_t i;
+    ASSERT_IS_NOT_NULL(handle);
+
+    for (i = 0; i < message_count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(handle, message));
+    }
+    LoggerAsync_Destroy(handle);
+    Message_Destroy(message);
+
+    log = read_log();
+    ASSERT_IS_NOT_NULL(log);
+    ASSERT_ARE_EQUAL(size_t, message_count + 2, split_lines(log, NULL, 0));
+    free(log);
+}
+
+/*Tests_SRS_LOGGER_32_001: [ Values that are not present shall default to format "json", no rotation, max_files LOGGER_SEGMENTS_DEFAULT_MAX_FILES and no compression. ]*/
+/*Tests_SRS_LOGGER_32_007: [ "format": "binary" and the rotation limits shall enable the asynchronous writer. ]*/
+TEST_FUNCTION(LoggerAsync_ParseConfigurationFromJson_reads_format_and_rotation)
+{
+    LOGGER_ASYNC_CONFIG config;
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"async\": true }", &config));
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_FORMAT_JSON, (int)config.format);
+    ASSERT_ARE_EQUAL(size_t, 0, config.segments.max_file_bytes);
+    ASSERT_ARE_EQUAL(size_t, 0, config.segments.max_age_since_open_s);
+    ASSERT_ARE_EQUAL(size_t, LOGGER_SEGMENTS_DEFAULT_MAX_FILES, config.segments.max_files);
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_COMPRESSION_NONE, (int)config.segments.compression);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"format\": \"binary\" }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_FORMAT_BINARY, (int)config.format);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"max_file_bytes\": 1048576, \"max_age_since_open_s\": 3600, \"max_files\": 0, \"compress\": \"none\" }", &config));
+    ASSERT_IS_TRUE(config.enabled);
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_FORMAT_JSON, (int)config.format);
+    ASSERT_ARE_EQUAL(size_t, 1048576, config.segments.max_file_bytes);
+    ASSERT_ARE_EQUAL(size_t, 3600, config.segments.max_age_since_open_s);
+    ASSERT_ARE_EQUAL(size_t, 0, config.segments.max_files);
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"format\": \"json\" }", &config));
+    ASSERT_IS_FALSE(config.enabled);
+}
+
+/*Tests_SRS_LOGGER_32_002: [ If "format" is not "json" or "binary" then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_32_003: [ If "max_file_bytes", "max_age_since_open_s" or "max_files" is not a whole number in range then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_32_004: [ If "compress" is not a compression this build supports then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_32_005: [ If "async" is false and "format" is "binary" or a rotation limit is set then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_32_006: [ If "compress" or "max_files" is given without "max_file_bytes" or "max_age_since_open_s" then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(LoggerAsync_ParseConfigurationFromJson_rejects_bad_format_and_rotation)
+{
+    LOGGER_ASYNC_CONFIG config;
+
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"format\": \"xml\" }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"format\": 1 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"max_file_bytes\": 0 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"max_file_bytes\": 4294967296 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"max_age_since_open_s\": 0.5 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"max_file_bytes\": 1024, \"max_files\": 1001 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"max_file_bytes\": 1024, \"compress\": \"bogus\" }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"max_file_bytes\": 1024, \"compress\": true }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": false, \"format\": \"binary\" }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": false, \"max_age_since_open_s\": 60 }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"compress\": \"none\" }", &config));
+    ASSERT_ARE_NOT_EQUAL(int, 0, parse_async_config("{ \"async\": true, \"max_files\": 4 }", &config));
+}
+
+/*Tests_SRS_LOGGER_32_016: [ A binary segment shall start with "GWLG", LOGGER_BINARY_VERSION and 3 zero bytes. ]*/
+/*Tests_SRS_LOGGER_32_017: [ Every record shall start with its length as a big endian uint32, its kind as a uint8 and its time as a big endian int64 of seconds since the epoch. ]*/
+TEST_FUNCTION(LoggerBinary_reads_what_it_writes)
+{
+    static const unsigned char payload[3] = { 1, 2, 3 };
+    static const unsigned char expected_header[LOGGER_BINARY_RECORD_HEADER_SIZE] = { 0, 0, 0, 12, LOGGER_BINARY_RECORD_MESSAGE, 0, 0, 0, 0, 0x58, 0x9A, 0xBC, 0xDE };
+    unsigned char segment_header[LOGGER_BINARY_SEGMENT_HEADER_SIZE];
+    unsigned char record_bytes[LOGGER_BINARY_RECORD_HEADER_SIZE + sizeof(payload)];
+    LOGGER_BINARY_RECORD record;
+    size_t record_size;
+
+    LoggerBinary_WriteSegmentHeader(segment_header);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(segment_header, "GWLG", 4));
+    ASSERT_ARE_EQUAL(int, 0, LoggerBinary_CheckSegmentHeader(segment_header, sizeof(segment_header)));
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerBinary_CheckSegmentHeader(segment_header, sizeof(segment_header) - 1));
+    segment_header[4] = LOGGER_BINARY_VERSION + 1;
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerBinary_CheckSegmentHeader(segment_header, sizeof(segment_header)));
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerBinary_CheckSegmentHeader((const unsigned char*)"{\"time\"", 7));
+
+    LoggerBinary_WriteRecordHeader(record_bytes, LOGGER_BINARY_RECORD_MESSAGE, 0x589ABCDE, sizeof(payload));
+    ASSERT_ARE_EQUAL(int, 0, memcmp(record_bytes, expected_header, sizeof(expected_header)));
+    (void)memcpy(record_bytes + LOGGER_BINARY_RECORD_HEADER_SIZE, payload, sizeof(payload));
+
+    ASSERT_ARE_EQUAL(int, 0, LoggerBinary_ReadRecord(record_bytes, sizeof(record_bytes), &record, &record_size));
+    ASSERT_ARE_EQUAL(size_t, sizeof(record_bytes), record_size);
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_BINARY_RECORD_MESSAGE, (int)record.kind);
+    ASSERT_IS_TRUE(record.time == 0x589ABCDE);
+    ASSERT_ARE_EQUAL(size_t, sizeof(payload), record.payload_size);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(record.payload, payload, sizeof(payload)));
+
+    /*a torn record*/
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerBinary_ReadRecord(record_bytes, sizeof(record_bytes) - 1, &record, &record_size));
+    ASSERT_ARE_NOT_EQUAL(int, 0, LoggerBinary_ReadRecord(record_bytes, LOGGER_BINARY_RECORD_HEADER_SIZE - 1, &record, &record_size));
+}
+
+/*Tests_SRS_LOGGER_32_008: [ With "format": "binary" the writer thread shall write each message as a LOGGER_BINARY_RECORD_MESSAGE record holding the message serialized by Message_ToByteArray. ]*/
+/*Tests_SRS_LOGGER_32_010: [ LoggerSegments_Open shall open file_name for appending and write header to it if it is empty. ]*/
+TEST_FUNCTION(LoggerAsync_writes_binary_records)
+{
+    LOGGER_ASYNC_CONFIG config;
+    LOGGER_ASYNC_HANDLE handle;
+    unsigned char* log;
+    size_t size;
+    size_t offset;
+    size_t i;
+    LOGGER_BINARY_RECORD record;
+    size_t record_size;
+
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"format\": \"binary\" }", &config));
+    /*the second run appends to the first one's segment without a second header*/
+    for (i = 0; i < 2; i++)
+    {
+        MESSAGE_HANDLE message = create_message("name", "value", (const unsigned char*)"abc", 3);
+        handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+        ASSERT_IS_NOT_NULL(handle);
+        ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(handle, message));
+        LoggerAsync_Destroy(handle);
+        Message_Destroy(message);
+    }
+
+    ASSERT_ARE_EQUAL(int, 0, LoggerCompress_ReadFile(TEST_LOG_FILE, &log, &size));
+    ASSERT_ARE_EQUAL(int, 0, LoggerBinary_CheckSegmentHeader(log, size));
+    offset = LOGGER_BINARY_SEGMENT_HEADER_SIZE;
+    for (i = 0; i < 2; i++)
+    {
+        MESSAGE_HANDLE message;
+        CONSTMAP_HANDLE properties;
+        const CONSTBUFFER* content;
+
+        ASSERT_ARE_EQUAL(int, 0, LoggerBinary_ReadRecord(log + offset, size - offset, &record, &record_size));
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_BINARY_RECORD_LOG_STARTED, (int)record.kind);
+        ASSERT_ARE_EQUAL(size_t, 0, record.payload_size);
+        offset += record_size;
+
+        ASSERT_ARE_EQUAL(int, 0, LoggerBinary_ReadRecord(log + offset, size - offset, &record, &record_size));
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_BINARY_RECORD_MESSAGE, (int)record.kind);
+        message = Message_CreateFromByteArray(record.payload, (int32_t)record.payload_size);
+        ASSERT_IS_NOT_NULL(message);
+        properties = Message_GetProperties(message);
+        ASSERT_IS_NOT_NULL(properties);
+        ASSERT_ARE_EQUAL(char_ptr, "value", ConstMap_GetValue(properties, "name"));
+        content = Message_GetContent(message);
+        ASSERT_ARE_EQUAL(size_t, 3, content->size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(content->buffer, "abc", 3));
+        ConstMap_Destroy(properties);
+        Message_Destroy(message);
+        offset += record_size;
+
+        ASSERT_ARE_EQUAL(int, 0, LoggerBinary_ReadRecord(log + offset, size - offset, &record, &record_size));
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_BINARY_RECORD_LOG_STOPPED, (int)record.kind);
+        offset += record_size;
+    }
+    ASSERT_ARE_EQUAL(size_t, size, offset);
+    free(log);
+}
+
+static void log_until_rotated(const LOGGER_ASYNC_CONFIG* config, size_t message_count)
+{
+    LOGGER_ASYNC_HANDLE handle = LoggerAsync_Create(TEST_LOG_FILE, config);
+    MESSAGE_HANDLE message = create_message("name", "value", (const unsigned char*)"0123456789", 10);
+    size_t i;
+    ASSERT_IS_NOT_NULL(handle);
+    for (i = 0; i < message_count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(handle, message));
+    }
+    LoggerAsync_Destroy(handle);
+    Message_Destroy(message);
+}
+
+static void assert_binary_segment(const char* file_name, size_t max_file_bytes)
+{
+    unsigned char* log;
+    size_t size;
+    size_t offset = LOGGER_BINARY_SEGMENT_HEADER_SIZE;
+    ASSERT_ARE_EQUAL(int, 0, LoggerCompress_ReadFile(file_name, &log, &size));
+    ASSERT_IS_TRUE(size <= max_file_bytes);
+    ASSERT_ARE_EQUAL(int, 0, LoggerBinary_CheckSegmentHeader(log, size));
+    /*rotation only happens between records*/
+    while (offset < size)
+    {
+        LOGGER_BINARY_RECORD record;
+        size_t record_size;
+        ASSERT_ARE_EQUAL(int, 0, LoggerBinary_ReadRecord(log + offset, size - offset, &record, &record_size));
+        offset += record_size;
+    }
+    ASSERT_ARE_EQUAL(size_t, size, offset);
+    free(log);
+}
+
+/*Tests_SRS_LOGGER_32_011: [ LoggerSegments_Write shall rotate before writing if the active segment would grow past max_file_bytes. ]*/
+/*Tests_SRS_LOGGER_32_013: [ Rotating shall delete the segments numbered max_files and shift the others up by one. ]*/
+/*Tests_SRS_LOGGER_32_014: [ Rotating shall rename the active segment to "<file_name>.1" and, if compression is not LOGGER_COMPRESSION_NONE, replace it with a compressed "<file_name>.1<extension>" once the new active segment is started. ]*/
+/*Tests_SRS_LOGGER_32_015: [ Rotating shall start a new active segment that begins with header. ]*/
+TEST_FUNCTION(LoggerAsync_rotates_segments_by_size)
+{
+    LOGGER_ASYNC_CONFIG config;
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"format\": \"binary\", \"max_file_bytes\": 512, \"max_files\": 2 }", &config));
+
+    log_until_rotated(&config, 200);
+
+    assert_binary_segment(TEST_LOG_FILE, 512);
+    assert_binary_segment(TEST_LOG_FILE ".1", 512);
+    assert_binary_segment(TEST_LOG_FILE ".2", 512);
+    ASSERT_IS_FALSE(file_exists(TEST_LOG_FILE ".3"));
+}
+
+/*Tests_SRS_LOGGER_32_012: [ LoggerSegments_Write shall rotate before writing if max_age_since_open_s seconds or more have passed since the active segment was opened. ]*/
+TEST_FUNCTION(LoggerAsync_rotates_segments_by_age)
+{
+    LOGGER_ASYNC_CONFIG config;
+    LOGGER_ASYNC_HANDLE handle;
+    MESSAGE_HANDLE message = create_message("name", "value", NULL, 0);
+    char* log;
+    char* lines[4];
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"max_age_since_open_s\": 1, \"max_files\": 2, \"flush_interval_ms\": 10 }", &config));
+
+    handle = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    ASSERT_IS_NOT_NULL(handle);
+    ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(handle, message));
+    ThreadAPI_Sleep(1100);
+    LoggerAsync_Destroy(handle);
+    Message_Destroy(message);
+
+    /*"Log started" and the message went out before the segment got old, "Log stopped" after*/
+    ASSERT_IS_TRUE(file_exists(TEST_LOG_FILE ".1"));
+    log = read_log();
+    ASSERT_IS_NOT_NULL(log);
+    ASSERT_ARE_EQUAL(size_t, 1, split_lines(log, lines, 4));
+    assert_marker(lines[0], "Log stopped");
+    free(log);
+}
+
+/*Tests_SRS_LOGGER_32_018: [ If file_name is not empty and does not start with header then LoggerSegments_Open shall rotate it out before appending to it. ]*/
+TEST_FUNCTION(LoggerAsync_rotates_out_a_file_without_the_segment_header)
+{
+    /*a JSON log and a segment torn inside its header*/
+    static const char* const contents[] = { "{\"content\":\"earlier\"}\n", "GW" };
+    LOGGER_ASYNC_CONFIG config;
+    size_t i;
+    ASSERT_ARE_EQUAL(int, 0, parse_async_config("{ \"format\": \"binary\" }", &config));
+    for (i = 0; i < sizeof(contents) / sizeof(contents[0]); i++)
+    {
+        FILE* f = fopen(TEST_LOG_FILE, "wb");
+        unsigned char* rotated;
+        size_t size;
+        ASSERT_IS_NOT_NULL(f);
+        ASSERT_IS_TRUE(fputs(contents[i], f) >= 0);
+        (void)fclose(f);
+
+        log_until_rotated(&config, 1);
+
+        assert_binary_segment(TEST_LOG_FILE, 512);
+        ASSERT_ARE_EQUAL(int, 0, LoggerCompress_ReadFile(TEST_LOG_FILE ".1", &rotated, &size));
+        ASSERT_ARE_EQUAL(size_t, strlen(contents[i]), size);
+        ASSERT_ARE_EQUAL(int, 0, memcmp(rotated, contents[i], size));
+        free(rotated);
+        remove_segments();
+    }
+}
+
+/*Tests_SRS_LOGGER_32_004: [ If "compress" is not a compression this build supports then LoggerAsync_ParseConfigurationFromJson shall fail and return a non-zero value. ]*/
+/*Tests_SRS_LOGGER_32_014: [ Rotating shall rename the active segment to "<file_name>.1" and, if compression is not LOGGER_COMPRESSION_NONE, replace it with a compressed "<file_name>.1<extension>" once the new active segment is started. ]*/
+TEST_FUNCTION(LoggerAsync_compresses_rotated_segments)
+{
+    static const char* const compressions[] = { "zstd", "lz4" };
+    static const char* const rotated[] = { TEST_LOG_FILE ".1.zst", TEST_LOG_FILE ".1.lz4" };
+#ifdef LOGGER_USE_ZSTD
+    static const bool built_in[] = { true,
+#else
+    static const bool built_in[] = { false,
+#endif
+#ifdef LOGGER_USE_LZ4
+        true };
+#else
+        false };
+#endif
+    size_t i;
+    for (i = 0; i < sizeof(compressions) / sizeof(compressions[0]); i++)
+    {
+        LOGGER_COMPRESSION compression;
+        if (!built_in[i])
+        {
+            ASSERT_ARE_NOT_EQUAL(int, 0, LoggerCompress_FromString(compressions[i], &compression));
+        }
+        else
+        {
+            LOGGER_ASYNC_CONFIG config;
+            char args[128];
+            (void)sprintf(args, "{ \"format\": \"binary\", \"max_file_bytes\": 512, \"max_files\": 2, \"compress\": \"%s\" }", compressions[i]);
+            ASSERT_ARE_EQUAL(int, 0, parse_async_config(args, &config));
+
+            log_until_rotated(&config, 50);
+
+            ASSERT_IS_FALSE(file_exists(TEST_LOG_FILE ".1"));
+            assert_binary_segment(rotated[i], 512);
+            remove_segments();
+        }
+    }
+}
+
+END_TEST_SUITE(logger_async_ut)
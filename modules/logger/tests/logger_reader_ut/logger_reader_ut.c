@@ -0,0 +1,474 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/constmap.h"
+#include "message.h"
+#include "module.h"
+#include "logger_async.h"
+#include "logger_binary.h"
+#include "logger_compress.h"
+#include "logger_reader.h"
+#include "logger_replay.h"
+
+#include <parson.h>
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+#define TEST_LOG_FILE "logger_reader_ut.log"
+#define TEST_MAX_FILES 5
+
+/*more records than one index stride, so that seeking uses more than the first index entry*/
+#define TEST_RECORD_COUNT (LOGGER_READER_INDEX_STRIDE * 4 + 4)
+#define TEST_FIRST_TIME 1000000
+
+static void remove_segments(void)
+{
+    static const char* const extensions[] = { "", ".zst", ".lz4" };
+    char name[64];
+    size_t index;
+    size_t i;
+    (void)remove(TEST_LOG_FILE);
+    for (index = 1; index <= TEST_MAX_FILES + 1; index++)
+    {
+        for (i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+        {
+            (void)sprintf(name, "%s.%lu%s", TEST_LOG_FILE, (unsigned long)index, extensions[i]);
+            (void)remove(name);
+        }
+    }
+}
+
+static MESSAGE_HANDLE create_message(const char* source, size_t sequence)
+{
+    MESSAGE_HANDLE result;
+    MESSAGE_CONFIG config;
+    char sequence_text[32];
+    MAP_HANDLE properties = Map_Create(NULL);
+    ASSERT_IS_NOT_NULL(properties);
+    (void)sprintf(sequence_text, "%lu", (unsigned long)sequence);
+    if (source != NULL)
+    {
+        ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, "source", source));
+    }
+    ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, "sequence", sequence_text));
+    config.size = strlen(sequence_text);
+    config.source = (const unsigned char*)sequence_text;
+    config.sourceProperties = properties;
+    result = Message_Create(&config);
+    ASSERT_IS_NOT_NULL(result);
+    Map_Destroy(properties);
+    return result;
+}
+
+static size_t get_sequence(const LOGGER_BINARY_RECORD* record)
+{
+    size_t result;
+    MESSAGE_HANDLE message = Message_CreateFromByteArray(record->payload, (int32_t)record->payload_size);
+    CONSTMAP_HANDLE properties;
+    ASSERT_IS_NOT_NULL(message);
+    properties = Message_GetProperties(message);
+    ASSERT_IS_NOT_NULL(properties);
+    ASSERT_IS_NOT_NULL(ConstMap_GetValue(properties, "sequence"));
+    result = (size_t)strtoul(ConstMap_GetValue(properties, "sequence"), NULL, 10);
+    ConstMap_Destroy(properties);
+    Message_Destroy(message);
+    return result;
+}
+
+/*writes a binary segment by hand so that the record times are known, message i gets times[i] and source "a" or "b" by turns*/
+static void write_segment(const char* file_name, const int64_t* times, size_t count, size_t first_sequence)
+{
+    FILE* f = fopen(file_name, "wb");
+    unsigned char header[LOGGER_BINARY_RECORD_HEADER_SIZE];
+    size_t i;
+    ASSERT_IS_NOT_NULL(f);
+    LoggerBinary_WriteSegmentHeader(header);
+    ASSERT_ARE_EQUAL(size_t, LOGGER_BINARY_SEGMENT_HEADER_SIZE, fwrite(header, 1, LOGGER_BINARY_SEGMENT_HEADER_SIZE, f));
+    LoggerBinary_WriteRecordHeader(header, LOGGER_BINARY_RECORD_LOG_STARTED, times[0], 0);
+    ASSERT_ARE_EQUAL(size_t, sizeof(header), fwrite(header, 1, sizeof(header), f));
+    for (i = 0; i < count; i++)
+    {
+        MESSAGE_HANDLE message = create_message(((first_sequence + i) % 2 == 0) ? "a" : "b", first_sequence + i);
+        int32_t size = Message_ToByteArray(message, NULL, 0);
+        unsigned char* payload;
+        ASSERT_IS_TRUE(size > 0);
+        payload = (unsigned char*)malloc((size_t)size);
+        ASSERT_IS_NOT_NULL(payload);
+        ASSERT_ARE_EQUAL(int, (int)size, (int)Message_ToByteArray(message, payload, size));
+        LoggerBinary_WriteRecordHeader(header, LOGGER_BINARY_RECORD_MESSAGE, times[i], (size_t)size);
+        ASSERT_ARE_EQUAL(size_t, sizeof(header), fwrite(header, 1, sizeof(header), f));
+        ASSERT_ARE_EQUAL(size_t, (size_t)size, fwrite(payload, 1, (size_t)size, f));
+        free(payload);
+        Message_Destroy(message);
+    }
+    (void)fclose(f);
+}
+
+/*the sequence numbers LoggerReader_Next returns, in order*/
+static size_t read_all(const LOGGER_READER_FILTER* filter, size_t* sequences, size_t max_sequences)
+{
+    size_t result = 0;
+    LOGGER_BINARY_RECORD record;
+    LOGGER_READER_RESULT read_result;
+    LOGGER_READER_HANDLE reader = LoggerReader_Open(TEST_LOG_FILE, filter);
+    ASSERT_IS_NOT_NULL(reader);
+    while ((read_result = LoggerReader_Next(reader, &record)) == LOGGER_READER_OK)
+    {
+        ASSERT_IS_TRUE(result < max_sequences);
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_BINARY_RECORD_MESSAGE, (int)record.kind);
+        sequences[result++] = get_sequence(&record);
+    }
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_END, (int)read_result);
+    LoggerReader_Close(reader);
+    return result;
+}
+
+static void fill_times(int64_t* times, size_t count)
+{
+    size_t i;
+    /*two records a second*/
+    for (i = 0; i < count; i++)
+    {
+        times[i] = TEST_FIRST_TIME + (int64_t)(i / 2);
+    }
+}
+
+static void* parse_replay_config(const char* args)
+{
+    const MODULE_API_1* apis = (const MODULE_API_1*)Module_GetApi(MODULE_API_VERSION_1);
+    ASSERT_IS_NOT_NULL(apis);
+    return apis->Module_ParseConfigurationFromJson(args);
+}
+
+BEGIN_TEST_SUITE(logger_reader_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+    remove_segments();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    remove_segments();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/*Tests_SRS_LOGGER_33_001: [ If file_name or filter is NULL, or filter has a property_value without a property_name, then LoggerReader_Open shall fail and return NULL. ]*/
+/*Tests_SRS_LOGGER_33_002: [ If any step fails then LoggerReader_Open shall release what it acquired and return NULL. ]*/
+/*Tests_SRS_LOGGER_33_005: [ If handle or record is NULL then LoggerReader_Next shall fail and return LOGGER_READER_ERROR. ]*/
+TEST_FUNCTION(LoggerReader_rejects_invalid_arguments)
+{
+    LOGGER_READER_FILTER filter = { 0, 0, NULL, NULL };
+    LOGGER_READER_FILTER value_without_name = { 0, 0, NULL, "a" };
+    LOGGER_BINARY_RECORD record;
+    int64_t times[1] = { TEST_FIRST_TIME };
+    LOGGER_READER_HANDLE reader;
+
+    ASSERT_IS_NULL(LoggerReader_Open(NULL, &filter));
+    ASSERT_IS_NULL(LoggerReader_Open(TEST_LOG_FILE, NULL));
+    /*there is no log yet*/
+    ASSERT_IS_NULL(LoggerReader_Open(TEST_LOG_FILE, &filter));
+
+    write_segment(TEST_LOG_FILE, times, 1, 0);
+    ASSERT_IS_NULL(LoggerReader_Open(TEST_LOG_FILE, &value_without_name));
+    reader = LoggerReader_Open(TEST_LOG_FILE, &filter);
+    ASSERT_IS_NOT_NULL(reader);
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_ERROR, (int)LoggerReader_Next(NULL, &record));
+    ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_ERROR, (int)LoggerReader_Next(reader, NULL));
+    LoggerReader_Close(reader);
+    LoggerReader_Close(NULL);
+}
+
+/*Tests_SRS_LOGGER_33_003: [ LoggerReader_Open shall read the rotated segments from the oldest ("<file_name>.<highest number>") to the newest, then file_name itself if it exists. ]*/
+/*Tests_SRS_LOGGER_33_004: [ LoggerReader_Open shall map each uncompressed segment into memory, read compressed segments into memory, and index every LOGGER_READER_INDEX_STRIDE-th record by time. ]*/
+/*Tests_SRS_LOGGER_33_008: [ LoggerReader_Next shall return LOGGER_READER_END once every segment has been read. ]*/
+TEST_FUNCTION(LoggerReader_reads_what_the_logger_wrote_across_segments)
+{
+    const size_t message_count = 100;
+    LOGGER_ASYNC_CONFIG config;
+    LOGGER_ASYNC_HANDLE writer;
+    JSON_Value* json = json_parse_string("{ \"format\": \"binary\", \"max_file_bytes\": 1024, \"max_files\": 5 }");
+    LOGGER_READER_FILTER filter = { 0, 0, NULL, NULL };
+    size_t sequences[100];
+    size_t i;
+    ASSERT_IS_NOT_NULL(json);
+    ASSERT_ARE_EQUAL(int, 0, LoggerAsync_ParseConfigurationFromJson(json_value_get_object(json), &config));
+    json_value_free(json);
+
+    writer = LoggerAsync_Create(TEST_LOG_FILE, &config);
+    ASSERT_IS_NOT_NULL(writer);
+    for (i = 0; i < message_count; i++)
+    {
+        MESSAGE_HANDLE message = create_message("a", i);
+        ASSERT_ARE_EQUAL(int, 0, LoggerAsync_Log(writer, message));
+        Message_Destroy(message);
+    }
+    LoggerAsync_Destroy(writer);
+
+    /*the oldest segments were rotated away, what is left is the newest messages in order*/
+    {
+        size_t count = read_all(&filter, sequences, message_count);
+        FILE* oldest = fopen(TEST_LOG_FILE ".5", "rb");
+        ASSERT_IS_NOT_NULL(oldest);
+        (void)fclose(oldest);
+        ASSERT_IS_TRUE(count > 0);
+        ASSERT_ARE_EQUAL(size_t, message_count - 1, sequences[count - 1]);
+        for (i = 1; i < count; i++)
+        {
+            ASSERT_ARE_EQUAL(size_t, sequences[i - 1] + 1, sequences[i]);
+        }
+    }
+}
+
+/*Tests_SRS_LOGGER_33_006: [ LoggerReader_Next shall skip segments whose records are all outside the filter's time range and use the index to start reading a segment close to start_time. ]*/
+/*Tests_SRS_LOGGER_33_007: [ LoggerReader_Next shall return LOGGER_READER_OK and the next message record whose time is in the filter's range and whose serialized properties match the filter, without deserializing the message. ]*/
+TEST_FUNCTION(LoggerReader_filters_by_time)
+{
+    int64_t times[TEST_RECORD_COUNT];
+    size_t sequences[2 * TEST_RECORD_COUNT];
+    LOGGER_READER_FILTER filter = { 0, 0, NULL, NULL };
+    size_t count;
+    size_t i;
+    fill_times(times, TEST_RECORD_COUNT);
+    write_segment(TEST_LOG_FILE ".1", times, TEST_RECORD_COUNT, 0);
+    /*message k is logged at TEST_FIRST_TIME + k / 2 in both segments*/
+    for (i = 0; i < TEST_RECORD_COUNT; i++)
+    {
+        times[i] += TEST_RECORD_COUNT / 2;
+    }
+    write_segment(TEST_LOG_FILE, times, TEST_RECORD_COUNT, TEST_RECORD_COUNT);
+
+    ASSERT_ARE_EQUAL(size_t, 2 * TEST_RECORD_COUNT, read_all(&filter, sequences, 2 * TEST_RECORD_COUNT));
+
+    /*from the middle of the first segment's third index stride to the second segment's first*/
+    filter.start_time = TEST_FIRST_TIME + LOGGER_READER_INDEX_STRIDE + 5;
+    filter.end_time = TEST_FIRST_TIME + TEST_RECORD_COUNT / 2 + 10;
+    count = read_all(&filter, sequences, 2 * TEST_RECORD_COUNT);
+    ASSERT_ARE_EQUAL(size_t, (size_t)(2 * (filter.end_time - filter.start_time)), count);
+    for (i = 0; i < count; i++)
+    {
+        ASSERT_ARE_EQUAL(size_t, 2 * (LOGGER_READER_INDEX_STRIDE + 5) + i, sequences[i]);
+    }
+
+    /*only the second segment*/
+    filter.start_time = TEST_FIRST_TIME + TEST_RECORD_COUNT / 2;
+    filter.end_time = 0;
+    count = read_all(&filter, sequences, 2 * TEST_RECORD_COUNT);
+    ASSERT_ARE_EQUAL(size_t, TEST_RECORD_COUNT, count);
+    ASSERT_ARE_EQUAL(size_t, TEST_RECORD_COUNT, sequences[0]);
+
+    /*nothing*/
+    filter.start_time = TEST_FIRST_TIME + 2 * TEST_RECORD_COUNT;
+    ASSERT_ARE_EQUAL(size_t, 0, read_all(&filter, sequences, 2 * TEST_RECORD_COUNT));
+}
+
+/*Tests_SRS_LOGGER_33_006: [ LoggerReader_Next shall skip segments whose records are all outside the filter's time range and use the index to start reading a segment close to start_time. ]*/
+TEST_FUNCTION(LoggerReader_finds_records_logged_after_the_clock_went_back)
+{
+    int64_t times[TEST_RECORD_COUNT];
+    size_t sequences[TEST_RECORD_COUNT];
+    LOGGER_READER_FILTER filter = { 0, 0, NULL, NULL };
+    fill_times(times, TEST_RECORD_COUNT);
+    /*the last record has the first record's time*/
+    times[TEST_RECORD_COUNT - 1] = TEST_FIRST_TIME;
+    write_segment(TEST_LOG_FILE, times, TEST_RECORD_COUNT, 0);
+
+    filter.start_time = TEST_FIRST_TIME;
+    filter.end_time = TEST_FIRST_TIME + 1;
+    ASSERT_ARE_EQUAL(size_t, 3, read_all(&filter, sequences, TEST_RECORD_COUNT));
+    ASSERT_ARE_EQUAL(size_t, 0, sequences[0]);
+    ASSERT_ARE_EQUAL(size_t, 1, sequences[1]);
+    ASSERT_ARE_EQUAL(size_t, TEST_RECORD_COUNT - 1, sequences[2]);
+}
+
+/*Tests_SRS_LOGGER_33_007: [ LoggerReader_Next shall return LOGGER_READER_OK and the next message record whose time is in the filter's range and whose serialized properties match the filter, without deserializing the message. ]*/
+TEST_FUNCTION(LoggerReader_filters_by_property)
+{
+    int64_t times[10];
+    size_t sequences[10];
+    LOGGER_READER_FILTER filter = { 0, 0, "source", "b" };
+    size_t count;
+    size_t i;
+    fill_times(times, 10);
+    write_segment(TEST_LOG_FILE, times, 10, 0);
+
+    count = read_all(&filter, sequences, 10);
+    ASSERT_ARE_EQUAL(size_t, 5, count);
+    for (i = 0; i < count; i++)
+    {
+        ASSERT_ARE_EQUAL(size_t, 2 * i + 1, sequences[i]);
+    }
+
+    filter.property_value = NULL;
+    ASSERT_ARE_EQUAL(size_t, 10, read_all(&filter, sequences, 10));
+
+    filter.property_name = "destination";
+    ASSERT_ARE_EQUAL(size_t, 0, read_all(&filter, sequences, 10));
+
+    /*the value has to match all of it*/
+    filter.property_name = "sequence";
+    filter.property_value = "1";
+    ASSERT_ARE_EQUAL(size_t, 1, read_all(&filter, sequences, 10));
+    ASSERT_ARE_EQUAL(size_t, 1, sequences[0]);
+}
+
+/*Tests_SRS_LOGGER_33_009: [ LoggerReader_Rewind shall make LoggerReader_Next start again from the first segment. ]*/
+TEST_FUNCTION(LoggerReader_stops_at_a_torn_record_and_rewinds)
+{
+    static const unsigned char torn[5] = { 0, 0, 1, 0, LOGGER_BINARY_RECORD_MESSAGE };
+    int64_t times[3] = { TEST_FIRST_TIME, TEST_FIRST_TIME, TEST_FIRST_TIME };
+    LOGGER_READER_FILTER filter = { 0, 0, NULL, NULL };
+    LOGGER_BINARY_RECORD record;
+    LOGGER_READER_HANDLE reader;
+    FILE* f;
+    size_t i;
+    write_segment(TEST_LOG_FILE, times, 3, 0);
+    f = fopen(TEST_LOG_FILE, "ab");
+    ASSERT_IS_NOT_NULL(f);
+    ASSERT_ARE_EQUAL(size_t, sizeof(torn), fwrite(torn, 1, sizeof(torn), f));
+    (void)fclose(f);
+
+    reader = LoggerReader_Open(TEST_LOG_FILE, &filter);
+    ASSERT_IS_NOT_NULL(reader);
+    for (i = 0; i < 2; i++)
+    {
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_OK, (int)LoggerReader_Next(reader, &record));
+        ASSERT_ARE_EQUAL(size_t, 0, get_sequence(&record));
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_OK, (int)LoggerReader_Next(reader, &record));
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_OK, (int)LoggerReader_Next(reader, &record));
+        ASSERT_ARE_EQUAL(size_t, 2, get_sequence(&record));
+        ASSERT_ARE_EQUAL(int, (int)LOGGER_READER_END, (int)LoggerReader_Next(reader, &record));
+        LoggerReader_Rewind(reader);
+    }
+    LoggerReader_Close(reader);
+}
+
+/*Tests_SRS_LOGGER_33_004: [ LoggerReader_Open shall map each uncompressed segment into memory, read compressed segments into memory, and index every LOGGER_READER_INDEX_STRIDE-th record by time. ]*/
+TEST_FUNCTION(LoggerReader_reads_compressed_segments)
+{
+    static const LOGGER_COMPRESSION compressions[] = { LOGGER_COMPRESSION_ZSTD, LOGGER_COMPRESSION_LZ4 };
+    static const char* const names[] = { "zstd", "lz4" };
+    static const char* const rotated[] = { TEST_LOG_FILE ".1.zst", TEST_LOG_FILE ".1.lz4" };
+    size_t i;
+    for (i = 0; i < sizeof(compressions) / sizeof(compressions[0]); i++)
+    {
+        LOGGER_COMPRESSION compression;
+        if (LoggerCompress_FromString(names[i], &compression) == 0)
+        {
+            int64_t times[TEST_RECORD_COUNT];
+            size_t sequences[2 * TEST_RECORD_COUNT];
+            LOGGER_READER_FILTER filter = { 0, 0, NULL, NULL };
+            fill_times(times, TEST_RECORD_COUNT);
+            write_segment(TEST_LOG_FILE ".1", times, TEST_RECORD_COUNT, 0);
+            ASSERT_ARE_EQUAL(int, 0, LoggerCompress_CompressFile(compressions[i], TEST_LOG_FILE ".1", rotated[i]));
+            ASSERT_ARE_EQUAL(int, 0, remove(TEST_LOG_FILE ".1"));
+            write_segment(TEST_LOG_FILE, times, 1, TEST_RECORD_COUNT);
+
+            ASSERT_ARE_EQUAL(size_t, TEST_RECORD_COUNT + 1, read_all(&filter, sequences, 2 * TEST_RECORD_COUNT));
+            ASSERT_ARE_EQUAL(size_t, 0, sequences[0]);
+            ASSERT_ARE_EQUAL(size_t, TEST_RECORD_COUNT, sequences[TEST_RECORD_COUNT]);
+            remove_segments();
+        }
+    }
+}
+
+/*Tests_SRS_LOGGER_33_011: [ If configuration is NULL, is not a JSON object or has no "filename" string then LoggerReplay_ParseConfigurationFromJson shall fail and return NULL. ]*/
+/*Tests_SRS_LOGGER_33_012: [ If "messages_per_second" is present and is not a number from 0 to 1000000, or "start_time" or "end_time" is not a whole number of seconds, or "property_name" or "property_value" is not a string, then LoggerReplay_ParseConfigurationFromJson shall fail and return NULL. ]*/
+/*Tests_SRS_LOGGER_33_013: [ If "property_value" is present without "property_name" then LoggerReplay_ParseConfigurationFromJson shall fail and return NULL. ]*/
+/*Tests_SRS_LOGGER_33_014: [ Otherwise LoggerReplay_ParseConfigurationFromJson shall return a LOGGER_REPLAY_CONFIG, absent values being 0 or NULL. ]*/
+/*Tests_SRS_LOGGER_33_015: [ LoggerReplay_FreeConfiguration shall free configuration and the strings it holds, and do nothing if it is NULL. ]*/
+TEST_FUNCTION(LoggerReplay_parses_its_configuration)
+{
+    const MODULE_API_1* apis = (const MODULE_API_1*)Module_GetApi(MODULE_API_VERSION_1);
+    LOGGER_REPLAY_CONFIG* config;
+
+    ASSERT_IS_NULL(parse_replay_config(NULL));
+    ASSERT_IS_NULL(parse_replay_config("[]"));
+    ASSERT_IS_NULL(parse_replay_config("{}"));
+    ASSERT_IS_NULL(parse_replay_config("{ \"filename\": \"a.log\", \"messages_per_second\": -1 }"));
+    ASSERT_IS_NULL(parse_replay_config("{ \"filename\": \"a.log\", \"messages_per_second\": \"10\" }"));
+    ASSERT_IS_NULL(parse_replay_config("{ \"filename\": \"a.log\", \"start_time\": 1.5 }"));
+    ASSERT_IS_NULL(parse_replay_config("{ \"filename\": \"a.log\", \"end_time\": -1 }"));
+    ASSERT_IS_NULL(parse_replay_config("{ \"filename\": \"a.log\", \"property_name\": 1 }"));
+    ASSERT_IS_NULL(parse_replay_config("{ \"filename\": \"a.log\", \"property_value\": \"b\" }"));
+
+    config = (LOGGER_REPLAY_CONFIG*)parse_replay_config("{ \"filename\": \"a.log\" }");
+    ASSERT_IS_NOT_NULL(config);
+    ASSERT_ARE_EQUAL(char_ptr, "a.log", config->file_name);
+    ASSERT_IS_TRUE(config->messages_per_second == 0);
+    ASSERT_IS_TRUE(config->start_time == 0);
+    ASSERT_IS_TRUE(config->end_time == 0);
+    ASSERT_IS_NULL(config->property_name);
+    ASSERT_IS_NULL(config->property_value);
+    apis->Module_FreeConfiguration(config);
+
+    config = (LOGGER_REPLAY_CONFIG*)parse_replay_config("{ \"filename\": \"a.log\", \"messages_per_second\": 2.5, \"start_time\": 1000, \"end_time\": 2000, \"property_name\": \"source\", \"property_value\": \"b\" }");
+    ASSERT_IS_NOT_NULL(config);
+    ASSERT_IS_TRUE(config->messages_per_second == 2.5);
+    ASSERT_IS_TRUE(config->start_time == 1000);
+    ASSERT_IS_TRUE(config->end_time == 2000);
+    ASSERT_ARE_EQUAL(char_ptr, "source", config->property_name);
+    ASSERT_ARE_EQUAL(char_ptr, "b", config->property_value);
+    apis->Module_FreeConfiguration(config);
+    apis->Module_FreeConfiguration(NULL);
+}
+
+/*Tests_SRS_LOGGER_33_016: [ If broker or configuration is NULL then LoggerReplay_Create shall fail and return NULL. ]*/
+/*Tests_SRS_LOGGER_33_017: [ LoggerReplay_Create shall open the log with LoggerReader_Open so that a missing or unreadable log fails the module's creation. ]*/
+/*Tests_SRS_LOGGER_33_024: [ LoggerReplay_Destroy shall stop the replay thread, wait for it to end and free all resources. ]*/
+TEST_FUNCTION(LoggerReplay_needs_a_log_to_replay)
+{
+    const MODULE_API_1* apis = (const MODULE_API_1*)Module_GetApi(MODULE_API_VERSION_1);
+    /*the replay is not started, so the broker is never used*/
+    BROKER_HANDLE broker = (BROKER_HANDLE)0x42;
+    LOGGER_REPLAY_CONFIG* config = (LOGGER_REPLAY_CONFIG*)parse_replay_config("{ \"filename\": \"" TEST_LOG_FILE "\" }");
+    int64_t times[1] = { TEST_FIRST_TIME };
+    MODULE_HANDLE module;
+    ASSERT_IS_NOT_NULL(config);
+
+    ASSERT_IS_NULL(apis->Module_Create(NULL, config));
+    ASSERT_IS_NULL(apis->Module_Create(broker, NULL));
+    ASSERT_IS_NULL(apis->Module_Create(broker, config));
+
+    write_segment(TEST_LOG_FILE, times, 1, 0);
+    module = apis->Module_Create(broker, config);
+    ASSERT_IS_NOT_NULL(module);
+    apis->Module_Destroy(module);
+
+    apis->Module_FreeConfiguration(config);
+}
+
+END_TEST_SUITE(logger_reader_ut)
@@ -133,6 +133,7 @@ namespace BASEIMPLEMENTATION
 typedef struct LOGGER_HANDLE_DATA_TAG
 {
     FILE* fout;
+    LOGGER_ASYNC_HANDLE async_writer;
 }LOGGER_HANDLE_DATA;
 
 static MICROMOCK_MUTEX_HANDLE g_testByTest;
@@ -165,6 +166,15 @@ static LOGGER_CONFIG invalidConfig_selector =
     NULL
 };
 
+static LOGGER_CONFIG asyncConfig =
+{
+    LOGGING_TO_FILE,
+    { { "a.txt" } },
+    { true, LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS, LOGGER_ASYNC_DEFAULT_FLUSH_BYTES }
+};
+
+static LOGGER_ASYNC_HANDLE validAsyncHandle = (LOGGER_ASYNC_HANDLE)0x33;
+
 #define VALID_CONFIG_STRING "{\"filename\":\"log.txt\"}"
 
 #define TIME_IN_STRFTIME "time"
@@ -310,6 +320,22 @@ public:
             strcpy(s, TIME_IN_STRFTIME);
         }
     MOCK_METHOD_END(size_t, maxsize);
+
+    //logger_async
+    MOCK_STATIC_METHOD_2(, int, LoggerAsync_ParseConfigurationFromJson, const JSON_Object*, json, LOGGER_ASYNC_CONFIG*, config)
+        config->enabled = false;
+        config->flush_interval_ms = LOGGER_ASYNC_DEFAULT_FLUSH_INTERVAL_MS;
+        config->flush_bytes = LOGGER_ASYNC_DEFAULT_FLUSH_BYTES;
+    MOCK_METHOD_END(int, 0);
+
+    MOCK_STATIC_METHOD_2(, LOGGER_ASYNC_HANDLE, LoggerAsync_Create, const char*, file_name, const LOGGER_ASYNC_CONFIG*, config)
+    MOCK_METHOD_END(LOGGER_ASYNC_HANDLE, validAsyncHandle);
+
+    MOCK_STATIC_METHOD_2(, int, LoggerAsync_Log, LOGGER_ASYNC_HANDLE, handle, MESSAGE_HANDLE, message)
+    MOCK_METHOD_END(int, 0);
+
+    MOCK_STATIC_METHOD_1(, void, LoggerAsync_Destroy, LOGGER_ASYNC_HANDLE, handle)
+    MOCK_VOID_METHOD_END()
 };
 
 DECLARE_GLOBAL_MOCK_METHOD_1(CLoggerMocks, , JSON_Value*, json_parse_string, const char *, filename);
@@ -348,6 +374,11 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CLoggerMocks, , time_t, gb_time, time_t*, timer);
 DECLARE_GLOBAL_MOCK_METHOD_1(CLoggerMocks, , struct tm*, gb_localtime, const time_t*, timer);
 DECLARE_GLOBAL_MOCK_METHOD_4(CLoggerMocks, , size_t, gb_strftime, char*, s, size_t, maxsize, const char *, format, const struct tm *, timeptr);
 
+DECLARE_GLOBAL_MOCK_METHOD_2(CLoggerMocks, , int, LoggerAsync_ParseConfigurationFromJson, const JSON_Object*, json, LOGGER_ASYNC_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_2(CLoggerMocks, , LOGGER_ASYNC_HANDLE, LoggerAsync_Create, const char*, file_name, const LOGGER_ASYNC_CONFIG*, config);
+DECLARE_GLOBAL_MOCK_METHOD_2(CLoggerMocks, , int, LoggerAsync_Log, LOGGER_ASYNC_HANDLE, handle, MESSAGE_HANDLE, message);
+DECLARE_GLOBAL_MOCK_METHOD_1(CLoggerMocks, , void, LoggerAsync_Destroy, LOGGER_ASYNC_HANDLE, handle);
+
 
 static void mocks_ResetAllCounters(void)
 {
@@ -416,6 +447,7 @@ BEGIN_TEST_SUITE(logger_ut)
     /*Tests_SRS_LOGGER_17_002: [ Logger_ParseConfigurationFromJson shall duplicate the filename string into the LOGGER_CONFIG structure. ]*/
     /*Tests_SRS_LOGGER_17_006: [ Logger_ParseConfigurationFromJson shall return a pointer to the created LOGGER_CONFIG structure. ]*/
     /*Tests_SRS_LOGGER_17_007: [ Logger_ParseConfigurationFromJson shall set the selector in LOGGER_CONFIG to LOGGING_TO_FILE. ]*/
+    /*Tests_SRS_LOGGER_31_017: [ Logger_ParseConfigurationFromJson shall read the asynchronous writer settings with LoggerAsync_ParseConfigurationFromJson. ]*/
     TEST_FUNCTION(Logger_ParseConfigurationFromJson_happy_path_succeeds)
     {
         ///arrange
@@ -432,6 +464,8 @@ BEGIN_TEST_SUITE(logger_ut)
 		STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 			.IgnoreArgument(1)
 			.IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, LoggerAsync_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments();
 
         ///act
         auto result = Logger_ParseConfigurationFromJson(VALID_CONFIG_STRING);
@@ -439,12 +473,48 @@ BEGIN_TEST_SUITE(logger_ut)
         ///assert
         ASSERT_IS_NOT_NULL(result);
         ASSERT_ARE_EQUAL(int, (int)((LOGGER_CONFIG*)result)->selector, (int)LOGGING_TO_FILE);
+        ASSERT_IS_FALSE(((LOGGER_CONFIG*)result)->async.enabled);
         mocks.AssertActualAndExpectedCalls();
 
         ///cleanup
         Logger_FreeConfiguration(result);
     }
 
+    /*Tests_SRS_LOGGER_17_003: [ If any system call fails, Logger_ParseConfigurationFromJson shall fail and return NULL. ]*/
+    TEST_FUNCTION(Logger_ParseConfigurationFromJson_fails_when_LoggerAsync_ParseConfigurationFromJson_fails)
+    {
+        ///arrange
+        CLoggerMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, json_parse_string(VALID_CONFIG_STRING)); /*this is creating the JSON from the string*/
+        STRICT_EXPECTED_CALL(mocks, json_value_free(IGNORED_PTR_ARG)) /*this is destroy of the json value created from the string*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_value_get_object(IGNORED_PTR_ARG)) /*getting the json object out of the json value*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, json_object_get_string(IGNORED_PTR_ARG, "filename")) /*this is getting a json string that is what follows "filename": in the json*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(sizeof(LOGGER_CONFIG)));
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreArgument(1)
+            .IgnoreArgument(2);
+        STRICT_EXPECTED_CALL(mocks, LoggerAsync_ParseConfigurationFromJson(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+            .IgnoreAllArguments()
+            .SetFailReturn(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)) /*this is the file name*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)) /*this is the LOGGER_CONFIG*/
+            .IgnoreArgument(1);
+
+        ///act
+        auto result = Logger_ParseConfigurationFromJson(VALID_CONFIG_STRING);
+
+        ///assert
+        ASSERT_IS_NULL(result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
     /*Tests_SRS_LOGGER_17_003: [ If any system call fails, Logger_ParseConfigurationFromJson shall fail and return NULL. ]*/
 	TEST_FUNCTION(Logger_ParseConfigurationFromJson_string_copy_fails)
 	{
@@ -2385,6 +2455,92 @@ BEGIN_TEST_SUITE(logger_ut)
         ///cleanup
     }
 
+    /*Tests_SRS_LOGGER_31_018: [ If configuration->async.enabled is true then Logger_Create shall create the writer with LoggerAsync_Create instead of opening the file itself. ]*/
+    TEST_FUNCTION(Logger_Create_async_happy_path)
+    {
+        ///arrange
+        CLoggerMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is the handle*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, LoggerAsync_Create(asyncConfig.selectee.loggerConfigFile.name, &asyncConfig.async));
+
+        ///act
+        auto handle = Logger_Create(validBrokerHandle, &asyncConfig);
+
+        ///assert
+        ASSERT_IS_NOT_NULL(handle);
+        mocks.AssertActualAndExpectedCalls();
+        ASSERT_ARE_EQUAL(size_t, 0, CURRENT_API_CALL(gb_fprintf));
+
+        ///cleanup
+        Logger_Destroy(handle);
+    }
+
+    /*Tests_SRS_LOGGER_02_007: [If Logger_Create encounters any errors while creating the LOGGER_HANDLE_DATA then it shall fail and return NULL.]*/
+    TEST_FUNCTION(Logger_Create_async_fails_when_LoggerAsync_Create_fails)
+    {
+        ///arrange
+        CLoggerMocks mocks;
+
+        STRICT_EXPECTED_CALL(mocks, gballoc_malloc(IGNORED_NUM_ARG)) /*this is the handle*/
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, LoggerAsync_Create(asyncConfig.selectee.loggerConfigFile.name, &asyncConfig.async))
+            .SetFailReturn((LOGGER_ASYNC_HANDLE)NULL);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+
+        ///act
+        auto handle = Logger_Create(validBrokerHandle, &asyncConfig);
+
+        ///assert
+        ASSERT_IS_NULL(handle);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
+    /*Tests_SRS_LOGGER_31_019: [ If the module has an asynchronous writer then Logger_Receive shall pass messageHandle to LoggerAsync_Log and return. ]*/
+    TEST_FUNCTION(Logger_Receive_async_passes_the_message_to_LoggerAsync_Log)
+    {
+        ///arrange
+        CLoggerMocks mocks;
+        auto moduleHandle = Logger_Create(validBrokerHandle, &asyncConfig);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, LoggerAsync_Log(validAsyncHandle, validMessageHandle));
+
+        ///act
+        Logger_Receive(moduleHandle, validMessageHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        Logger_Destroy(moduleHandle);
+    }
+
+    /*Tests_SRS_LOGGER_31_020: [ If the module has an asynchronous writer then Logger_Destroy shall destroy it with LoggerAsync_Destroy. ]*/
+    TEST_FUNCTION(Logger_Destroy_async_destroys_the_writer)
+    {
+        ///arrange
+        CLoggerMocks mocks;
+        auto moduleHandle = Logger_Create(validBrokerHandle, &asyncConfig);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, LoggerAsync_Destroy(validAsyncHandle));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)) /*this frees the memory allocated for the handle data*/
+            .IgnoreArgument(1);
+
+        ///act
+        Logger_Destroy(moduleHandle);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+    }
+
     /*Tests_SRS_LOGGER_26_001: [ `Module_GetApi` shall return a pointer to a  `MODULE_API` structure with the required function pointers. ]*/
     TEST_FUNCTION(Module_GetApi_returns_non_NULL_and_non_NULL_fields)
     {
@@ -0,0 +1,184 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+ * Converts logger segments, binary or JSON lines, plain or compressed, to
+ * JSON lines on stdout. Segments are printed in the order they are given,
+ * so pass the oldest first: logger_to_json log.bin.3 log.bin.2 log.bin.1 log.bin
+ */
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "message.h"
+#include "logger_binary.h"
+#include "logger_compress.h"
+
+#include <azure_c_shared_utility/gballoc.h>
+#include <azure_c_shared_utility/xlogging.h>
+#include <azure_c_shared_utility/base64.h>
+#include <azure_c_shared_utility/strings.h>
+#include <azure_c_shared_utility/map.h>
+#include <azure_c_shared_utility/constmap.h>
+
+static void print_time(int64_t time_value)
+{
+    char time_text[80];
+    time_t t = (time_t)time_value;
+    struct tm* local = localtime(&t);
+    if (
+        (local == NULL) ||
+        (strftime(time_text, sizeof(time_text), "%c", local) == 0)
+        )
+    {
+        time_text[0] = '\0';
+    }
+    (void)printf("{\"time\":\"%s\"", time_text);
+}
+
+static int print_message(const LOGGER_BINARY_RECORD* record)
+{
+    int result;
+    MESSAGE_HANDLE message = Message_CreateFromByteArray(record->payload, (int32_t)record->payload_size);
+    if (message == NULL)
+    {
+        result = __LINE__;
+    }
+    else
+    {
+        CONSTMAP_HANDLE properties = Message_GetProperties(message);
+        MAP_HANDLE properties_as_map = (properties == NULL) ? NULL : ConstMap_CloneWriteable(properties);
+        STRING_HANDLE properties_as_json = (properties_as_map == NULL) ? NULL : Map_ToJSON(properties_as_map);
+        const CONSTBUFFER* content = Message_GetContent(message);
+        STRING_HANDLE content_as_base64 = ((content == NULL) || (content->size == 0)) ?
+            STRING_construct_n("", 0) :
+            Base64_Encode_Bytes(content->buffer, content->size);
+
+        if (
+            (properties_as_json == NULL) ||
+            (content_as_base64 == NULL)
+            )
+        {
+            result = __LINE__;
+        }
+        else
+        {
+            print_time(record->time);
+            (void)printf(",\"properties\":%s,\"content\":\"%s\"}\n", STRING_c_str(properties_as_json), STRING_c_str(content_as_base64));
+            result = 0;
+        }
+
+        STRING_delete(content_as_base64);
+        STRING_delete(properties_as_json);
+        if (properties_as_map != NULL)
+        {
+            Map_Destroy(properties_as_map);
+        }
+        if (properties != NULL)
+        {
+            ConstMap_Destroy(properties);
+        }
+        Message_Destroy(message);
+    }
+    return result;
+}
+
+static int print_binary_segment(const char* file_name, const unsigned char* data, size_t size)
+{
+    int result = 0;
+    size_t offset = LOGGER_BINARY_SEGMENT_HEADER_SIZE;
+    while (offset < size)
+    {
+        LOGGER_BINARY_RECORD record;
+        size_t record_size;
+        if (LoggerBinary_ReadRecord(data + offset, size - offset, &record, &record_size) != 0)
+        {
+            /*the writer was stopped in the middle of a record, everything before it is good*/
+            (void)fprintf(stderr, "%s: ignoring %lu bytes of an incomplete record at offset %lu\n", file_name, (unsigned long)(size - offset), (unsigned long)offset);
+            break;
+        }
+        else
+        {
+            switch (record.kind)
+            {
+            case LOGGER_BINARY_RECORD_MESSAGE:
+                if (print_message(&record) != 0)
+                {
+                    (void)fprintf(stderr, "%s: unable to read the message at offset %lu\n", file_name, (unsigned long)offset);
+                    result = __LINE__;
+                }
+                break;
+            case LOGGER_BINARY_RECORD_LOG_STARTED:
+                print_time(record.time);
+                (void)printf(",\"content\":\"Log started\"}\n");
+                break;
+            case LOGGER_BINARY_RECORD_LOG_STOPPED:
+                print_time(record.time);
+                (void)printf(",\"content\":\"Log stopped\"}\n");
+                break;
+            default:
+                /*kinds added by later versions are skipped, the length prefix says how*/
+                break;
+            }
+            offset += record_size;
+        }
+    }
+    return result;
+}
+
+static int print_segment(const char* file_name)
+{
+    int result;
+    unsigned char* data;
+    size_t size;
+    if (LoggerCompress_ReadFile(file_name, &data, &size) != 0)
+    {
+        (void)fprintf(stderr, "%s: unable to read the file\n", file_name);
+        result = __LINE__;
+    }
+    else
+    {
+        if (LoggerBinary_CheckSegmentHeader(data, size) == 0)
+        {
+            result = print_binary_segment(file_name, data, size);
+        }
+        else if (fwrite(data, 1, size, stdout) != size)
+        {
+            /*"format": "json" segments already are JSON lines*/
+            (void)fprintf(stderr, "%s: unable to write to stdout\n", file_name);
+            result = __LINE__;
+        }
+        else
+        {
+            result = 0;
+        }
+        free(data);
+    }
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    int result;
+    if (argc < 2)
+    {
+        (void)fprintf(stderr, "usage: %s segment [segment...]\n", argv[0]);
+        (void)fprintf(stderr, "prints logger segments as JSON lines, pass the oldest segment first\n");
+        result = 1;
+    }
+    else
+    {
+        int i;
+        result = 0;
+        for (i = 1; i < argc; i++)
+        {
+            if (print_segment(argv[i]) != 0)
+            {
+                result = 1;
+            }
+        }
+    }
+    return result;
+}
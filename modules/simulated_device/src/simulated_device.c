@@ -2,6 +2,16 @@
 // Licensed under the MIT license. See LICENSE file in the project root for full license information.
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
 
 #include "simulated_device.h"
 #include "azure_c_shared_utility/threadapi.h"
@@ -11,36 +21,200 @@
 #include "message.h"
 #include "module.h"
 #include "broker.h"
+#include "module_thread.h"
 
 #include <parson.h>
 
+#define SIMULATEDDEVICE_MAX_DEVICE_COUNT 1000000
+#define SIMULATEDDEVICE_MAX_PAYLOAD_SIZE (1024 * 1024)
+#define SIMULATEDDEVICE_MAX_BURST 1000000000
+#define SIMULATEDDEVICE_MIN_PAYLOAD_CAPACITY 64
+#define SIMULATEDDEVICE_MAC_LENGTH 17
+#define SIMULATEDDEVICE_MAX_MAC 0xFFFFFFFFFFFFULL
+/*the token bucket holds this many microseconds of messages by default, more than a sleep overshoots*/
+#define SIMULATEDDEVICE_DEFAULT_BURST_US 2000
+#define SIMULATEDDEVICE_REPORT_INTERVAL_US (10 * 1000000ULL)
+
+#define SIMULATEDDEVICE_AVG_TEMPERATURE 10.0
+#define SIMULATEDDEVICE_MAX_TEMPERATURE 40.0
+
+#define SIMULATEDDEVICE_PADDING_HEAD ", \"padding\": \""
+#define SIMULATEDDEVICE_PADDING_TAIL "\"}"
+
+#define SIMULATEDDEVICE_MAC_TEMPLATE "${macAddress}"
+#define SIMULATEDDEVICE_INDEX_TEMPLATE "${deviceIndex}"
+
+typedef struct SIMULATEDDEVICE_PROPERTY_TAG
+{
+    char *              name;
+    char *              value;
+} SIMULATEDDEVICE_PROPERTY;
+
+typedef struct SIMULATEDDEVICE_DEVICE_TAG
+{
+    /*built once, only the sequence number and the send time change per message*/
+    MAP_HANDLE          properties;
+    char                macAddress[SIMULATEDDEVICE_MAC_LENGTH + 1];
+    uint64_t            sequenceNumber;
+    double              additionalTemp;
+} SIMULATEDDEVICE_DEVICE;
+
 typedef struct SIMULATEDDEVICE_DATA_TAG
 {
     BROKER_HANDLE       broker;
     THREAD_HANDLE       simulatedDeviceThread;
     const char *        fakeMacAddress;
+    uint64_t            firstMac;
+    SIMULATEDDEVICE_DEVICE * devices;
+    size_t              deviceCount;
     unsigned int        messagePeriod;
+    double              messagesPerSecond;
+    size_t              burst;
+    /*every message is formatted in this buffer, Message_Create copies it*/
+    char *              payload;
+    size_t              payloadCapacity;
+    size_t              payloadSize;
     unsigned int        simulatedDeviceRunning : 1;
 } SIMULATEDDEVICE_DATA;
 
 typedef struct SIMULATEDDEVICE_CONFIG_TAG
 {
     char *              macAddress;
+    /*milliseconds between the messages of a device, 0 when paced by messagesPerSecond*/
     unsigned int        messagePeriod;
+    size_t              deviceCount;
+    /*messages per second of each device, 0 is as fast as the broker takes them*/
+    double              messagesPerSecond;
+    /*depth of the token bucket, 0 picks one*/
+    size_t              burst;
+    size_t              payloadSize;
+    SIMULATEDDEVICE_PROPERTY * properties;
+    size_t              propertyCount;
 } SIMULATEDDEVICE_CONFIG;
 
+#ifdef _WIN32
+static uint64_t wall_clock_us(void)
+{
+    FILETIME now;
+    ULARGE_INTEGER ticks;
+    GetSystemTimeAsFileTime(&now);
+    ticks.LowPart = now.dwLowDateTime;
+    ticks.HighPart = now.dwHighDateTime;
+    /*100ns ticks since 1601*/
+    return (ticks.QuadPart - 116444736000000000ULL) / 10;
+}
+
+static uint64_t monotonic_us(void)
+{
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    (void)QueryPerformanceFrequency(&frequency);
+    (void)QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+        (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / (uint64_t)frequency.QuadPart;
+}
+#else
+static uint64_t clock_us(clockid_t clock)
+{
+    struct timespec now;
+    uint64_t result;
+    if (clock_gettime(clock, &now) != 0)
+    {
+        result = 0;
+    }
+    else
+    {
+        result = (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+    }
+    return result;
+}
+
+static uint64_t wall_clock_us(void)
+{
+    return clock_us(CLOCK_REALTIME);
+}
+
+static uint64_t monotonic_us(void)
+{
+    return clock_us(CLOCK_MONOTONIC);
+}
+#endif
+
+/*"XX:XX:XX:XX:XX:XX" in either case*/
+static bool parse_mac(const char* text, uint64_t* mac)
+{
+    bool result = (strlen(text) == SIMULATEDDEVICE_MAC_LENGTH);
+    size_t i;
+    uint64_t value = 0;
+    for (i = 0; (result == true) && (i < SIMULATEDDEVICE_MAC_LENGTH); i++)
+    {
+        char c = text[i];
+        if (i % 3 == 2)
+        {
+            result = (c == ':');
+        }
+        else if ((c >= '0') && (c <= '9'))
+        {
+            value = (value << 4) | (uint64_t)(c - '0');
+        }
+        else if ((c >= 'a') && (c <= 'f'))
+        {
+            value = (value << 4) | (uint64_t)(c - 'a' + 10);
+        }
+        else if ((c >= 'A') && (c <= 'F'))
+        {
+            value = (value << 4) | (uint64_t)(c - 'A' + 10);
+        }
+        else
+        {
+            result = false;
+        }
+    }
+    if (result == true)
+    {
+        *mac = value;
+    }
+    return result;
+}
+
+static void format_mac(uint64_t mac, char* text)
+{
+    (void)sprintf(text, "%02X:%02X:%02X:%02X:%02X:%02X",
+        (unsigned int)((mac >> 40) & 0xFF), (unsigned int)((mac >> 32) & 0xFF),
+        (unsigned int)((mac >> 24) & 0xFF), (unsigned int)((mac >> 16) & 0xFF),
+        (unsigned int)((mac >> 8) & 0xFF), (unsigned int)(mac & 0xFF));
+}
+
+static bool is_device_address(SIMULATEDDEVICE_DATA* module_data, const char* macAddress)
+{
+    bool result;
+    uint64_t mac;
+    if (module_data->deviceCount == 1)
+    {
+        result = (strcmp(module_data->fakeMacAddress, macAddress) == 0);
+    }
+    else
+    {
+        result =
+            (parse_mac(macAddress, &mac) == true) &&
+            (mac >= module_data->firstMac) &&
+            (mac - module_data->firstMac < module_data->deviceCount);
+    }
+    return result;
+}
+
 static void SimulatedDevice_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE messageHandle)
 {
     // Print the properties & content of the received message
     CONSTMAP_HANDLE properties = Message_GetProperties(messageHandle);
     if (properties != NULL)
     {
-        const char* addr = ((SIMULATEDDEVICE_DATA*)moduleHandle)->fakeMacAddress;
+        SIMULATEDDEVICE_DATA* module_data = (SIMULATEDDEVICE_DATA*)moduleHandle;
 
         // We're only interested in cloud-to-device (C2D) messages addressed to
         // this device
         if (ConstMap_ContainsKey(properties, GW_MAC_ADDRESS_PROPERTY) == true &&
-            strcmp(addr, ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY)) == 0)
+            is_device_address(module_data, ConstMap_GetValue(properties, GW_MAC_ADDRESS_PROPERTY)) == true)
         {
             const char* const * keys;
             const char* const * values;
@@ -74,6 +248,25 @@ static void SimulatedDevice_Receive(MODULE_HANDLE moduleHandle, MESSAGE_HANDLE m
     return;
 }
 
+static void free_module_data(SIMULATEDDEVICE_DATA* module_data)
+{
+    if (module_data->devices != NULL)
+    {
+        size_t i;
+        for (i = 0; i < module_data->deviceCount; i++)
+        {
+            if (module_data->devices[i].properties != NULL)
+            {
+                Map_Destroy(module_data->devices[i].properties);
+            }
+        }
+        free(module_data->devices);
+    }
+    free(module_data->payload);
+    free((void*)module_data->fakeMacAddress);
+    free(module_data);
+}
+
 static void SimulatedDevice_Destroy(MODULE_HANDLE moduleHandle)
 {
     if (moduleHandle == NULL)
@@ -88,85 +281,223 @@ static void SimulatedDevice_Destroy(MODULE_HANDLE moduleHandle)
         /* Tell thread to stop */
         module_data->simulatedDeviceRunning = 0;
         /* join the thread */
-        ThreadAPI_Join(module_data->simulatedDeviceThread, &result);
+        if (module_data->simulatedDeviceThread != NULL)
+        {
+            ThreadAPI_Join(module_data->simulatedDeviceThread, &result);
+        }
         /* free module data */
-        free((void*)module_data->fakeMacAddress);
-        free(module_data);
+        free_module_data(module_data);
     }
 }
 
-static int simulated_device_worker(void * user_data)
+/*
+ * @brief    Writes the message content in the module payload buffer, padded up to payloadSize.
+ */
+static size_t format_payload(SIMULATEDDEVICE_DATA* module_data, double temperature)
 {
-    SIMULATEDDEVICE_DATA* module_data = (SIMULATEDDEVICE_DATA*)user_data;
-    double avgTemperature = 10.0;
-    double additionalTemp = 0.0;
-    double maxSpeed = 40.0;
+    size_t result;
+    int length = sprintf_s(module_data->payload, module_data->payloadCapacity, "{\"temperature\": %.2f", temperature);
+    if (length < 0)
+    {
+        result = 0;
+    }
+    else
+    {
+        const size_t paddingOverhead = sizeof(SIMULATEDDEVICE_PADDING_HEAD) - 1 + sizeof(SIMULATEDDEVICE_PADDING_TAIL) - 1;
+        result = (size_t)length;
+        if (module_data->payloadSize >= result + paddingOverhead)
+        {
+            size_t paddingSize = module_data->payloadSize - result - paddingOverhead;
+            (void)memcpy(module_data->payload + result, SIMULATEDDEVICE_PADDING_HEAD, sizeof(SIMULATEDDEVICE_PADDING_HEAD) - 1);
+            result += sizeof(SIMULATEDDEVICE_PADDING_HEAD) - 1;
+            (void)memset(module_data->payload + result, 'x', paddingSize);
+            result += paddingSize;
+            (void)memcpy(module_data->payload + result, SIMULATEDDEVICE_PADDING_TAIL, sizeof(SIMULATEDDEVICE_PADDING_TAIL) - 1);
+            result += sizeof(SIMULATEDDEVICE_PADDING_TAIL) - 1;
+        }
+        else
+        {
+            module_data->payload[result++] = '}';
+        }
+    }
+    return result;
+}
 
-    if (user_data != NULL)
+static bool send_message(SIMULATEDDEVICE_DATA* module_data, SIMULATEDDEVICE_DEVICE* device, bool print)
+{
+    bool result;
+    char number[24];
+    double temperature;
+
+    if ((SIMULATEDDEVICE_AVG_TEMPERATURE + device->additionalTemp) > SIMULATEDDEVICE_MAX_TEMPERATURE)
     {
+        device->additionalTemp = 0.0;
+    }
+    temperature = SIMULATEDDEVICE_AVG_TEMPERATURE + device->additionalTemp;
 
-        while (module_data->simulatedDeviceRunning)
+    device->sequenceNumber++;
+    (void)sprintf(number, "%llu", (unsigned long long)device->sequenceNumber);
+    if (Map_AddOrUpdate(device->properties, GW_SEQUENCE_NUMBER_PROPERTY, number) != MAP_OK)
+    {
+        LogError("Failed to set sequence number property");
+        result = false;
+    }
+    else
+    {
+        (void)sprintf(number, "%llu", (unsigned long long)wall_clock_us());
+        if (Map_AddOrUpdate(device->properties, GW_SEND_TIME_PROPERTY, number) != MAP_OK)
+        {
+            LogError("Failed to set send time property");
+            result = false;
+        }
+        else
         {
             MESSAGE_CONFIG newMessageCfg;
-            MAP_HANDLE newProperties = Map_Create(NULL);
-            if (newProperties == NULL)
+            newMessageCfg.size = format_payload(module_data, temperature);
+            if (newMessageCfg.size == 0)
             {
-                LogError("Failed to create message properties");
+                LogError("Failed to set message text");
+                result = false;
             }
-
             else
             {
-                if (Map_Add(newProperties, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY) != MAP_OK)
+                MESSAGE_HANDLE newMessage;
+                if (print)
                 {
-                    LogError("Failed to set source property");
+                    (void)printf("Device: %s, Temperature: %.2f\r\n",
+                        device->macAddress,
+                        temperature
+                        );
+                    (void)fflush(stdout);
                 }
-                else if (Map_Add(newProperties, GW_MAC_ADDRESS_PROPERTY, module_data->fakeMacAddress) != MAP_OK)
+
+                newMessageCfg.source = (const unsigned char*)module_data->payload;
+                newMessageCfg.sourceProperties = device->properties;
+                newMessage = Message_Create(&newMessageCfg);
+                if (newMessage == NULL)
                 {
-                    LogError("Failed to set source property");
+                    LogError("Failed to create new message");
+                    result = false;
                 }
                 else
                 {
-                    char msgText[128];
-
-                    newMessageCfg.sourceProperties = newProperties;
-                    if ((avgTemperature + additionalTemp) > maxSpeed)
-                        additionalTemp = 0.0;
-
-                    if (sprintf_s(msgText, sizeof(msgText), "{\"temperature\": %.2f}", avgTemperature + additionalTemp) < 0)
+                    if (Broker_Publish(module_data->broker, (MODULE_HANDLE)module_data, newMessage) != BROKER_OK)
                     {
-                        LogError("Failed to set message text");
+                        LogError("Failed to publish new message");
+                        result = false;
                     }
                     else
                     {
-                        (void)printf("Device: %s, Temperature: %.2f\r\n",
-                            module_data->fakeMacAddress,
-                            avgTemperature + additionalTemp
-                            );
-                        (void)fflush(stdout);
+                        result = true;
+                    }
 
-                        newMessageCfg.size = strlen(msgText);
-                        newMessageCfg.source = (const unsigned char*)msgText;
+                    device->additionalTemp += 1.0;
+                    Message_Destroy(newMessage);
+                }
+            }
+        }
+    }
+    return result;
+}
 
-                        MESSAGE_HANDLE newMessage = Message_Create(&newMessageCfg);
-                        if (newMessage == NULL)
-                        {
-                            LogError("Failed to create new message");
-                        }
-                        else
-                        {
-                            if (Broker_Publish(module_data->broker, (MODULE_HANDLE)module_data, newMessage) != BROKER_OK)
-                            {
-                                LogError("Failed to create new message");
-                            }
+/*
+ * @brief    Every device sends a message, then the worker sleeps messagePeriod milliseconds.
+ */
+static void run_periodic(SIMULATEDDEVICE_DATA* module_data)
+{
+    while (module_data->simulatedDeviceRunning)
+    {
+        size_t i;
+        for (i = 0; (i < module_data->deviceCount) && (module_data->simulatedDeviceRunning); i++)
+        {
+            (void)send_message(module_data, &module_data->devices[i], true);
+        }
+        ThreadAPI_Sleep(module_data->messagePeriod);
+    }
+}
 
-                            additionalTemp += 1.0;
-                            Message_Destroy(newMessage);
-                        }
-                    }
-                }
-                Map_Destroy(newProperties);
+/*
+ * @brief    The devices send in turn, paced by a token bucket filled at messagesPerSecond
+ *            for each device. A wake up sends all the tokens gathered while sleeping, so the
+ *            rate is not bound by the millisecond granularity of ThreadAPI_Sleep.
+ */
+static void run_paced(SIMULATEDDEVICE_DATA* module_data)
+{
+    double rate = module_data->messagesPerSecond * (double)module_data->deviceCount;
+    double tokens = 1.0;
+    uint64_t now = monotonic_us();
+    uint64_t last = now;
+    uint64_t reportDue = now + SIMULATEDDEVICE_REPORT_INTERVAL_US;
+    uint64_t reportStart = now;
+    unsigned long long sent = 0;
+    unsigned long long failed = 0;
+    size_t next = 0;
+
+    while (module_data->simulatedDeviceRunning)
+    {
+        if (rate > 0.0)
+        {
+            tokens += (double)(now - last) * rate / 1000000.0;
+            last = now;
+            if (tokens > (double)module_data->burst)
+            {
+                tokens = (double)module_data->burst;
             }
-            ThreadAPI_Sleep(module_data -> messagePeriod);
+        }
+        else
+        {
+            /*unthrottled, one message per turn so that a stop is seen*/
+            tokens = 1.0;
+        }
+
+        if ((rate > 0.0) && (tokens < 1.0))
+        {
+            /*at least a millisecond, the bucket is deep enough to catch up*/
+            ThreadAPI_Sleep((unsigned int)((1.0 - tokens) * 1000.0 / rate) + 1);
+        }
+        else
+        {
+            do
+            {
+                if (send_message(module_data, &module_data->devices[next], false))
+                {
+                    sent++;
+                }
+                else
+                {
+                    failed++;
+                }
+                next = (next + 1 == module_data->deviceCount) ? 0 : next + 1;
+                tokens -= 1.0;
+            } while ((tokens >= 1.0) && (module_data->simulatedDeviceRunning));
+        }
+
+        now = monotonic_us();
+        if (now >= reportDue)
+        {
+            LogInfo("simulated devices %s: %llu messages sent (%.0f/s), %llu failed",
+                module_data->fakeMacAddress, sent, (double)sent * 1000000.0 / (double)(now - reportStart), failed);
+            sent = 0;
+            failed = 0;
+            reportStart = now;
+            reportDue = now + SIMULATEDDEVICE_REPORT_INTERVAL_US;
+        }
+    }
+}
+
+static int simulated_device_worker(void * user_data)
+{
+    SIMULATEDDEVICE_DATA* module_data = (SIMULATEDDEVICE_DATA*)user_data;
+
+    if (user_data != NULL)
+    {
+        if (module_data->messagePeriod > 0)
+        {
+            run_periodic(module_data);
+        }
+        else
+        {
+            run_paced(module_data);
         }
     }
 
@@ -183,13 +514,13 @@ static void SimulatedDevice_Start(MODULE_HANDLE moduleHandle)
     {
         SIMULATEDDEVICE_DATA* module_data = (SIMULATEDDEVICE_DATA*)moduleHandle;
         /* OK to start */
-        /* Create a fake data thread.  */
-        if (ThreadAPI_Create(
+        /* Create a fake data thread, placed by the module's gateway settings.  */
+        if (ModuleThread_Create(
             &(module_data->simulatedDeviceThread),
             simulated_device_worker,
             (void*)module_data) != THREADAPI_OK)
         {
-            LogError("ThreadAPI_Create failed");
+            LogError("ModuleThread_Create failed");
             module_data->simulatedDeviceThread = NULL;
         }
         else
@@ -199,19 +530,163 @@ static void SimulatedDevice_Start(MODULE_HANDLE moduleHandle)
     }
 }
 
+/*
+ * @brief    Appends source to dest at *length, or only counts when dest is NULL.
+ */
+static void append_text(char* dest, size_t* length, const char* source, size_t sourceLength)
+{
+    if (dest != NULL)
+    {
+        (void)memcpy(dest + *length, source, sourceLength);
+    }
+    *length += sourceLength;
+}
+
+static size_t expand_template_into(char* dest, const char* text, const char* macAddress, const char* index)
+{
+    size_t length = 0;
+    while (*text != '\0')
+    {
+        if (strncmp(text, SIMULATEDDEVICE_MAC_TEMPLATE, sizeof(SIMULATEDDEVICE_MAC_TEMPLATE) - 1) == 0)
+        {
+            append_text(dest, &length, macAddress, strlen(macAddress));
+            text += sizeof(SIMULATEDDEVICE_MAC_TEMPLATE) - 1;
+        }
+        else if (strncmp(text, SIMULATEDDEVICE_INDEX_TEMPLATE, sizeof(SIMULATEDDEVICE_INDEX_TEMPLATE) - 1) == 0)
+        {
+            append_text(dest, &length, index, strlen(index));
+            text += sizeof(SIMULATEDDEVICE_INDEX_TEMPLATE) - 1;
+        }
+        else
+        {
+            append_text(dest, &length, text, 1);
+            text++;
+        }
+    }
+    if (dest != NULL)
+    {
+        dest[length] = '\0';
+    }
+    return length;
+}
+
+/*
+ * @brief    Copies a property template with ${macAddress} and ${deviceIndex} replaced by the device's.
+ */
+static char* expand_template(const char* text, const char* macAddress, size_t deviceIndex)
+{
+    char index[24];
+    char* result;
+    (void)sprintf(index, "%lu", (unsigned long)deviceIndex);
+    result = (char*)malloc(expand_template_into(NULL, text, macAddress, index) + 1);
+    if (result == NULL)
+    {
+        LogError("unable to allocate property value");
+    }
+    else
+    {
+        (void)expand_template_into(result, text, macAddress, index);
+    }
+    return result;
+}
+
+static MAP_HANDLE create_device_properties(const SIMULATEDDEVICE_CONFIG* config, const char* macAddress, size_t deviceIndex)
+{
+    MAP_HANDLE result = Map_Create(NULL);
+    if (result == NULL)
+    {
+        LogError("Failed to create message properties");
+    }
+    else if (Map_Add(result, GW_SOURCE_PROPERTY, GW_SOURCE_BLE_TELEMETRY) != MAP_OK)
+    {
+        LogError("Failed to set source property");
+        Map_Destroy(result);
+        result = NULL;
+    }
+    else if (Map_Add(result, GW_MAC_ADDRESS_PROPERTY, macAddress) != MAP_OK)
+    {
+        LogError("Failed to set mac address property");
+        Map_Destroy(result);
+        result = NULL;
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < config->propertyCount; i++)
+        {
+            char* value = expand_template(config->properties[i].value, macAddress, deviceIndex);
+            MAP_RESULT added = (value == NULL) ? MAP_ERROR : Map_Add(result, config->properties[i].name, value);
+            free(value);
+            if (added != MAP_OK)
+            {
+                LogError("Failed to set property %s", config->properties[i].name);
+                break;
+            }
+        }
+        if (i < config->propertyCount)
+        {
+            Map_Destroy(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+static bool create_devices(SIMULATEDDEVICE_DATA* module_data, const SIMULATEDDEVICE_CONFIG* config)
+{
+    bool result;
+    module_data->devices = (SIMULATEDDEVICE_DEVICE*)calloc(config->deviceCount, sizeof(SIMULATEDDEVICE_DEVICE));
+    if (module_data->devices == NULL)
+    {
+        LogError("couldn't allocate %lu simulated devices", (unsigned long)config->deviceCount);
+        result = false;
+    }
+    else
+    {
+        size_t i;
+        module_data->deviceCount = config->deviceCount;
+        result = true;
+        for (i = 0; (result == true) && (i < config->deviceCount); i++)
+        {
+            SIMULATEDDEVICE_DEVICE* device = &module_data->devices[i];
+            if (config->deviceCount == 1)
+            {
+                /*a single device keeps the configured address as it is*/
+                (void)snprintf(device->macAddress, sizeof(device->macAddress), "%s", config->macAddress);
+            }
+            else
+            {
+                format_mac(module_data->firstMac + i, device->macAddress);
+            }
+            device->properties = create_device_properties(config, (config->deviceCount == 1) ? config->macAddress : device->macAddress, i);
+            result = (device->properties != NULL);
+        }
+    }
+    return result;
+}
+
 static MODULE_HANDLE SimulatedDevice_Create(BROKER_HANDLE broker, const void* configuration)
 {
     SIMULATEDDEVICE_DATA * result;
     SIMULATEDDEVICE_CONFIG * config = (SIMULATEDDEVICE_CONFIG *) configuration;
+    uint64_t firstMac = 0;
     if (broker == NULL || config == NULL)
     {
         LogError("invalid SIMULATED DEVICE module args.");
         result = NULL;
     }
+    else if (
+        (config->deviceCount > 1) &&
+        ((parse_mac(config->macAddress, &firstMac) == false) || (SIMULATEDDEVICE_MAX_MAC - firstMac < config->deviceCount - 1))
+        )
+    {
+        LogError("macAddress %s cannot be the first of %lu simulated devices", config->macAddress, (unsigned long)config->deviceCount);
+        result = NULL;
+    }
     else
     {
         /* allocate module data struct */
-        result = (SIMULATEDDEVICE_DATA*)malloc(sizeof(SIMULATEDDEVICE_DATA));
+        result = (SIMULATEDDEVICE_DATA*)calloc(1, sizeof(SIMULATEDDEVICE_DATA));
         if (result == NULL)
         {
             LogError("couldn't allocate memory for BLE Module");
@@ -222,23 +697,188 @@ static MODULE_HANDLE SimulatedDevice_Create(BROKER_HANDLE broker, const void* co
             result->broker = broker;
             /* set module is running to true */
             result->simulatedDeviceRunning = 1;
+            result->simulatedDeviceThread = NULL;
+            result->firstMac = firstMac;
+            result->messagePeriod = config->messagePeriod;
+            result->messagesPerSecond = config->messagesPerSecond;
+            result->burst = config->burst;
+            if (result->burst == 0)
+            {
+                double burst = config->messagesPerSecond * (double)config->deviceCount * SIMULATEDDEVICE_DEFAULT_BURST_US / 1000000.0;
+                result->burst = (burst >= SIMULATEDDEVICE_MAX_BURST) ? SIMULATEDDEVICE_MAX_BURST : (size_t)burst + 1;
+            }
+            result->payloadSize = config->payloadSize;
+            result->payloadCapacity = ((config->payloadSize > SIMULATEDDEVICE_MIN_PAYLOAD_CAPACITY) ? config->payloadSize : SIMULATEDDEVICE_MIN_PAYLOAD_CAPACITY) + 1;
             /* save fake MacAddress */
             char * newFakeAddress;
-            int status = mallocAndStrcpy_s(&newFakeAddress, config -> macAddress);
-
-            if (status != 0)
+            if (mallocAndStrcpy_s(&newFakeAddress, config -> macAddress) != 0)
             {
                 LogError("MacAddress did not copy");
+                free_module_data(result);
+                result = NULL;
             }
             else
             {
                 result->fakeMacAddress = newFakeAddress;
-                result -> messagePeriod = config -> messagePeriod;
-                result->simulatedDeviceThread = NULL;
+                result->payload = (char*)malloc(result->payloadCapacity);
+                if (result->payload == NULL)
+                {
+                    LogError("couldn't allocate a %lu bytes payload", (unsigned long)result->payloadCapacity);
+                    free_module_data(result);
+                    result = NULL;
+                }
+                else if (create_devices(result, config) == false)
+                {
+                    free_module_data(result);
+                    result = NULL;
+                }
+                else
+                {
+                    /* module created, the devices start sending in SimulatedDevice_Start */
+                }
+            }
+        }
+    }
+    return result;
+}
 
+/*
+ * @brief    Reads an optional whole number in [min, max], value is left as it is when absent.
+ */
+static bool read_count(const JSON_Object* root, const char* name, double min, double max, size_t* value)
+{
+    bool result;
+    JSON_Value* number = json_object_get_value(root, name);
+    if (number == NULL)
+    {
+        result = true;
+    }
+    else
+    {
+        double read = json_value_get_number(number);
+        if ((json_value_get_type(number) != JSONNumber) || (read < min) || (read > max) || (read != (double)(size_t)read))
+        {
+            LogError("\"%s\" must be a whole number from %.0f to %.0f", name, min, max);
+            result = false;
+        }
+        else
+        {
+            *value = (size_t)read;
+            result = true;
+        }
+    }
+    return result;
+}
+
+static void free_properties(SIMULATEDDEVICE_PROPERTY* properties, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        free(properties[i].name);
+        free(properties[i].value);
+    }
+    free(properties);
+}
+
+/*
+ * @brief    Copies the "properties" object, all of its values must be strings.
+ */
+static bool read_properties(const JSON_Object* root, SIMULATEDDEVICE_CONFIG* config)
+{
+    bool result;
+    JSON_Value* value = json_object_get_value(root, "properties");
+    if (value == NULL)
+    {
+        result = true;
+    }
+    else
+    {
+        JSON_Object* properties = json_value_get_object(value);
+        if (properties == NULL)
+        {
+            LogError("\"properties\" must be an object");
+            result = false;
+        }
+        else
+        {
+            size_t count = json_object_get_count(properties);
+            config->properties = (count == 0) ? NULL : (SIMULATEDDEVICE_PROPERTY*)calloc(count, sizeof(SIMULATEDDEVICE_PROPERTY));
+            if ((count > 0) && (config->properties == NULL))
+            {
+                LogError("allocation of properties failed");
+                result = false;
             }
+            else
+            {
+                size_t i;
+                result = true;
+                for (i = 0; (result == true) && (i < count); i++)
+                {
+                    const char* name = json_object_get_name(properties, i);
+                    const char* text = json_object_get_string(properties, name);
+                    if (text == NULL)
+                    {
+                        LogError("property %s must be a string", name);
+                        result = false;
+                    }
+                    else if (
+                        (mallocAndStrcpy_s(&config->properties[i].name, name) != 0) ||
+                        (mallocAndStrcpy_s(&config->properties[i].value, text) != 0)
+                        )
+                    {
+                        LogError("allocation of property %s failed", name);
+                        result = false;
+                    }
+                    else
+                    {
+                        config->propertyCount = i + 1;
+                    }
+                }
+                if (result == false)
+                {
+                    /*a name copied without its value is freed too*/
+                    free_properties(config->properties, count);
+                    config->properties = NULL;
+                    config->propertyCount = 0;
+                }
+            }
+        }
+    }
+    return result;
+}
 
+/*
+ * @brief    Reads messagePeriod, or messagesPerSecond and burst which replace it.
+ */
+static bool read_rate(const JSON_Object* root, SIMULATEDDEVICE_CONFIG* config)
+{
+    bool result;
+    JSON_Value* rate = json_object_get_value(root, "messagesPerSecond");
+    if (rate == NULL)
+    {
+        int period = (int)json_object_get_number(root, "messagePeriod");
+        if (period <= 0)
+        {
+            LogError("Invalid period time specified");
+            result = false;
         }
+        else
+        {
+            config->messagePeriod = period;
+            result = true;
+        }
+    }
+    else if ((json_value_get_type(rate) != JSONNumber) || (json_value_get_number(rate) < 0.0))
+    {
+        LogError("\"messagesPerSecond\" must be a number, 0 for no limit");
+        result = false;
+    }
+    else
+    {
+        config->messagePeriod = 0;
+        config->messagesPerSecond = json_value_get_number(rate);
+        result = read_count(root, "burst", 1, SIMULATEDDEVICE_MAX_BURST, &config->burst);
     }
     return result;
 }
@@ -271,37 +911,43 @@ static void * SimulatedDevice_ParseConfigurationFromJson(const char* configurati
             {
                 SIMULATEDDEVICE_CONFIG config;
                 const char* macAddress = json_object_get_string(root, "macAddress");
+                (void)memset(&config, 0, sizeof(config));
+                config.deviceCount = 1;
                 if (macAddress == NULL)
                 {
                     LogError("unable to json_object_get_string");
                     result = NULL;
                 }
+                else if (
+                    (read_rate(root, &config) == false) ||
+                    (read_count(root, "deviceCount", 1, SIMULATEDDEVICE_MAX_DEVICE_COUNT, &config.deviceCount) == false) ||
+                    (read_count(root, "payloadSize", 0, SIMULATEDDEVICE_MAX_PAYLOAD_SIZE, &config.payloadSize) == false)
+                    )
+                {
+                    result = NULL;
+                }
+                else if (read_properties(root, &config) == false)
+                {
+                    result = NULL;
+                }
                 else
                 {
-                    int period = (int)json_object_get_number(root, "messagePeriod");
-                    if (period <= 0)
+                    if (mallocAndStrcpy_s(&(config.macAddress), macAddress) != 0)
                     {
-                        LogError("Invalid period time specified");
+                        free_properties(config.properties, config.propertyCount);
                         result = NULL;
                     }
                     else
                     {
-                        if (mallocAndStrcpy_s(&(config.macAddress), macAddress) != 0)
-                        {
-                            result = NULL;
+                        result = malloc(sizeof(SIMULATEDDEVICE_CONFIG));
+                        if (result == NULL) {
+                            free(config.macAddress);
+                            free_properties(config.properties, config.propertyCount);
+                            LogError("allocation of configuration failed");
                         }
                         else
                         {
-                            config.messagePeriod = period;
-                            result = malloc(sizeof(SIMULATEDDEVICE_CONFIG));
-                            if (result == NULL) {
-                                free(config.macAddress);
-                                LogError("allocation of configuration failed");
-                            }
-                            else
-                            {
-                                *result = config;
-                            }
+                            *result = config;
                         }
                     }
                 }
@@ -318,6 +964,7 @@ void SimulatedDevice_FreeConfiguration(void * configuration)
 	{
         SIMULATEDDEVICE_CONFIG * config = (SIMULATEDDEVICE_CONFIG *)configuration;
         free(config->macAddress);
+        free_properties(config->properties, config->propertyCount);
         free(config);
 	}
 }
@@ -0,0 +1,241 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "testrunnerswitcher.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "broker.h"
+#include "module.h"
+#include "simulated_device.h"
+
+//=============================================================================
+//Globals
+//=============================================================================
+
+#ifdef WIN32
+static TEST_MUTEX_HANDLE g_dllByDll;
+#endif
+static TEST_MUTEX_HANDLE g_testByTest;
+
+/*never dereferenced, Broker_Publish below stands in for the broker*/
+#define TEST_BROKER ((BROKER_HANDLE)0x42)
+
+/*
+ * A local stand-in for the broker: this Broker_Publish takes the place of the
+ * real one, counts the messages and can hold the module's thread in it until
+ * the test opens the gate, like a broker that stalls.
+ */
+static struct
+{
+    LOCK_HANDLE lock;
+    COND_HANDLE changed;
+    size_t published;
+    bool gateClosed;
+} g_broker;
+
+BROKER_RESULT Broker_Publish(BROKER_HANDLE broker, MODULE_HANDLE source, MESSAGE_HANDLE message)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_BROKER, broker);
+    ASSERT_IS_NOT_NULL(source);
+    ASSERT_IS_NOT_NULL(message);
+    (void)Lock(g_broker.lock);
+    while (g_broker.gateClosed)
+    {
+        (void)Condition_Wait(g_broker.changed, g_broker.lock, 100);
+    }
+    g_broker.published++;
+    (void)Condition_Post(g_broker.changed);
+    (void)Unlock(g_broker.lock);
+    return BROKER_OK;
+}
+
+static size_t get_published(void)
+{
+    size_t result;
+    (void)Lock(g_broker.lock);
+    result = g_broker.published;
+    (void)Unlock(g_broker.lock);
+    return result;
+}
+
+static void wait_for_published(size_t published)
+{
+    int tries = 0;
+    (void)Lock(g_broker.lock);
+    while (
+        (g_broker.published < published) &&
+        (tries++ < 100)
+        )
+    {
+        (void)Condition_Wait(g_broker.changed, g_broker.lock, 100);
+    }
+    ASSERT_IS_TRUE(g_broker.published >= published);
+    (void)Unlock(g_broker.lock);
+}
+
+static void set_gate(bool closed)
+{
+    (void)Lock(g_broker.lock);
+    g_broker.gateClosed = closed;
+    (void)Condition_Post(g_broker.changed);
+    (void)Unlock(g_broker.lock);
+}
+
+static const MODULE_API_1* get_api(void)
+{
+    const MODULE_API_1* result = (const MODULE_API_1*)Module_GetApi(MODULE_API_VERSION_1);
+    ASSERT_IS_NOT_NULL(result);
+    return result;
+}
+
+static bool is_valid_configuration(const char* args)
+{
+    void* configuration = get_api()->Module_ParseConfigurationFromJson(args);
+    get_api()->Module_FreeConfiguration(configuration);
+    return configuration != NULL;
+}
+
+static MODULE_HANDLE create_module(const char* args)
+{
+    void* configuration = get_api()->Module_ParseConfigurationFromJson(args);
+    MODULE_HANDLE result;
+    ASSERT_IS_NOT_NULL(configuration);
+    result = get_api()->Module_Create(TEST_BROKER, configuration);
+    get_api()->Module_FreeConfiguration(configuration);
+    return result;
+}
+
+BEGIN_TEST_SUITE(simulated_device_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+    g_broker.lock = Lock_Init();
+    ASSERT_IS_NOT_NULL(g_broker.lock);
+    g_broker.changed = Condition_Init();
+    ASSERT_IS_NOT_NULL(g_broker.changed);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    Condition_Deinit(g_broker.changed);
+    (void)Lock_Deinit(g_broker.lock);
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest) != 0)
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+    g_broker.published = 0;
+    g_broker.gateClosed = false;
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+TEST_FUNCTION(SimulatedDevice_ParseConfigurationFromJson_reads_load_settings)
+{
+    ASSERT_IS_TRUE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagePeriod\": 2000 }"));
+    ASSERT_IS_TRUE(is_valid_configuration("{ \"macAddress\": \"01:01:01:00:00:00\", \"messagesPerSecond\": 0 }"));
+    ASSERT_IS_TRUE(is_valid_configuration(
+        "{ \"macAddress\": \"01:01:01:00:00:00\", \"deviceCount\": 1000, \"messagesPerSecond\": 10, \"burst\": 5, \"payloadSize\": 512, "
+        "\"properties\": { \"deviceName\": \"load-${deviceIndex}\" } }"));
+}
+
+TEST_FUNCTION(SimulatedDevice_ParseConfigurationFromJson_rejects_bad_values)
+{
+    /*read_rate*/
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\" }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagePeriod\": 0 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": -1 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": \"10\" }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"burst\": 0 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"burst\": 1.5 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"burst\": 1000000001 }"));
+
+    /*read_count*/
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"deviceCount\": 0 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"deviceCount\": 1000001 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"deviceCount\": 2.5 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"deviceCount\": \"2\" }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"payloadSize\": -1 }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"payloadSize\": 1048577 }"));
+
+    /*read_properties*/
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"properties\": [ \"a\" ] }"));
+    ASSERT_IS_FALSE(is_valid_configuration("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"properties\": { \"a\": \"b\", \"c\": 1 } }"));
+}
+
+TEST_FUNCTION(SimulatedDevice_Create_rejects_addresses_that_run_out)
+{
+    void* configuration = get_api()->Module_ParseConfigurationFromJson("{ \"macAddress\": \"FF:FF:FF:FF:FF:FF\", \"deviceCount\": 2, \"messagesPerSecond\": 10 }");
+    ASSERT_IS_NOT_NULL(configuration);
+    ASSERT_IS_NULL(get_api()->Module_Create(TEST_BROKER, configuration));
+    get_api()->Module_FreeConfiguration(configuration);
+}
+
+TEST_FUNCTION(SimulatedDevice_sends_unthrottled_when_messagesPerSecond_is_0)
+{
+    MODULE_HANDLE module = create_module("{ \"macAddress\": \"01:01:01:00:00:00\", \"deviceCount\": 10, \"messagesPerSecond\": 0 }");
+    ASSERT_IS_NOT_NULL(module);
+
+    get_api()->Module_Start(module);
+    ThreadAPI_Sleep(200);
+    get_api()->Module_Destroy(module);
+
+    /*far more than the millisecond sleep of a paced device would let through*/
+    ASSERT_IS_TRUE(get_published() > 1000);
+}
+
+TEST_FUNCTION(SimulatedDevice_paces_messagesPerSecond)
+{
+    MODULE_HANDLE module = create_module("{ \"macAddress\": \"01:01:01:00:00:00\", \"deviceCount\": 2, \"messagesPerSecond\": 10 }");
+    size_t published;
+    ASSERT_IS_NOT_NULL(module);
+
+    get_api()->Module_Start(module);
+    ThreadAPI_Sleep(1000);
+    get_api()->Module_Destroy(module);
+
+    /*20 a second for the two devices, give or take the first token and the sleeps*/
+    published = get_published();
+    ASSERT_IS_TRUE(published >= 15);
+    ASSERT_IS_TRUE(published <= 25);
+}
+
+TEST_FUNCTION(SimulatedDevice_catches_up_no_more_than_burst_after_a_stall)
+{
+    MODULE_HANDLE module = create_module("{ \"macAddress\": \"01:01:01:01:01:01\", \"messagesPerSecond\": 10, \"burst\": 2 }");
+    size_t stalled;
+    ASSERT_IS_NOT_NULL(module);
+
+    get_api()->Module_Start(module);
+    wait_for_published(1);
+    /*the next message is held in Broker_Publish for a second, 10 messages worth*/
+    set_gate(true);
+    ThreadAPI_Sleep(1000);
+    stalled = get_published();
+    set_gate(false);
+    ThreadAPI_Sleep(50);
+    get_api()->Module_Destroy(module);
+
+    /*the held message, then the bucket of 2 instead of the 10 the stall was worth*/
+    ASSERT_ARE_EQUAL(size_t, 1, stalled);
+    ASSERT_IS_TRUE(get_published() <= stalled + 1 + 2);
+}
+
+END_TEST_SUITE(simulated_device_ut)
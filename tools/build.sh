@@ -22,6 +22,9 @@ toolchainfile=
 dependency_install_prefix="-Ddependency_install_prefix=$local_install"
 build_config=Debug
 use_xplat_uuid=OFF
+enable_alloc_profiling=OFF
+enable_logger_zstd=OFF
+enable_logger_lz4=OFF
 if [[ $(uname -s) == Darwin ]]
 then
     # Don't build BLE for macOS, even if the caller doesn't pass `--disable-ble-module`
@@ -38,6 +41,9 @@ usage ()
     echo "   Example: -cl -O1 -cl ..."
     echo " -f,  --config <value>           Build configuration (e.g. [Debug], Release)"
     echo " --disable-ble-module            Do not build the BLE module"
+    echo " --enable-alloc-profiling        Build the allocation profiling hooks into the gateway"
+    echo " --enable-logger-zstd            Let the logger compress rotated segments with zstd"
+    echo " --enable-logger-lz4             Let the logger compress rotated segments with LZ4"
     echo " --enable-dotnet-core-binding    Build the .NET Core binding"
     echo " --enable-java-binding           Build Java binding"
     echo "                                 (JAVA_HOME must be defined in your environment)"
@@ -103,6 +109,9 @@ process_args ()
               "--system-deps-path" ) dependency_install_prefix=;;
               "-f" | "--config" ) save_next_arg=3;;
               "--use-xplat-uuid" ) use_xplat_uuid=ON;;
+              "--enable-alloc-profiling" ) enable_alloc_profiling=ON;;
+              "--enable-logger-zstd" ) enable_logger_zstd=ON;;
+              "--enable-logger-lz4" ) enable_logger_lz4=ON;;
               * ) usage;;
           esac
       fi
@@ -220,6 +229,9 @@ cmake $toolchainfile \
       -Dbuild_cores=$CORES \
       -Drebuild_deps:BOOL=$rebuild_deps \
       -Duse_xplat_uuid:BOOL=$use_xplat_uuid \
+      -Denable_alloc_profiling:BOOL=$enable_alloc_profiling \
+      -Denable_logger_zstd:BOOL=$enable_logger_zstd \
+      -Denable_logger_lz4:BOOL=$enable_logger_lz4 \
       "$build_root"
 
 make --jobs=$CORES